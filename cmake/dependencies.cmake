@@ -5,6 +5,9 @@ include(FetchContent)
 # OpenGL
 find_package(OpenGL REQUIRED)
 
+# 线程库（线程池等并行计算使用）
+find_package(Threads REQUIRED)
+
 # GLAD - 使用本地版本
 add_library(glad STATIC
     ${CMAKE_SOURCE_DIR}/include/glad/glad.c
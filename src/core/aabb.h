@@ -0,0 +1,86 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <limits>
+
+namespace mcnp::core {
+
+// 轴对齐包围盒；默认构造为空盒
+struct Aabb {
+    glm::dvec3 min{std::numeric_limits<double>::max()};
+    glm::dvec3 max{std::numeric_limits<double>::lowest()};
+
+    static Aabb infinite()
+    {
+        Aabb box;
+        box.min = glm::dvec3(std::numeric_limits<double>::lowest());
+        box.max = glm::dvec3(std::numeric_limits<double>::max());
+        return box;
+    }
+
+    bool empty() const noexcept { return min.x > max.x || min.y > max.y || min.z > max.z; }
+
+    bool isFinite() const noexcept
+    {
+        const double limit = std::numeric_limits<double>::max() * 0.5;
+        return !empty() && min.x > -limit && min.y > -limit && min.z > -limit &&
+               max.x < limit && max.y < limit && max.z < limit;
+    }
+
+    void expand(const glm::dvec3& p)
+    {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+
+    void expand(const Aabb& other)
+    {
+        if (other.empty()) {
+            return;
+        }
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    // 与另一盒求交，结果可能为空
+    void intersect(const Aabb& other)
+    {
+        min = glm::max(min, other.min);
+        max = glm::min(max, other.max);
+    }
+
+    bool contains(const glm::dvec3& p) const noexcept
+    {
+        return p.x >= min.x && p.x <= max.x && p.y >= min.y && p.y <= max.y && p.z >= min.z && p.z <= max.z;
+    }
+
+    bool intersects(const Aabb& other) const noexcept
+    {
+        return min.x <= other.max.x && max.x >= other.min.x && min.y <= other.max.y &&
+               max.y >= other.min.y && min.z <= other.max.z && max.z >= other.min.z;
+    }
+
+    glm::dvec3 center() const { return (min + max) * 0.5; }
+    glm::dvec3 extent() const { return max - min; }
+
+    // 仿射变换后的包围盒（取 8 个角点）
+    Aabb transformed(const glm::dmat4& m) const
+    {
+        if (!isFinite()) {
+            return empty() ? Aabb{} : infinite();
+        }
+        Aabb out;
+        for (int i = 0; i < 8; ++i) {
+            const glm::dvec3 corner((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z);
+            out.expand(glm::dvec3(m * glm::dvec4(corner, 1.0)));
+        }
+        return out;
+    }
+};
+
+} // namespace mcnp::core
+
+#endif // AABB_H
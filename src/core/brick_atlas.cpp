@@ -0,0 +1,129 @@
+#include "brick_atlas.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace mcnp::core {
+
+void BrickAtlas::reset(std::size_t slots) {
+    slotBrick_.assign(slots, npos);
+    std::fill(brickSlot_.begin(), brickSlot_.end(), npos);
+    stats_.residentBricks = 0;
+}
+
+void BrickAtlas::classify(const VoxelBrickStore& store, std::size_t channel,
+                          const std::function<bool(float, float)>& visible) {
+    const auto bricks = store.bricksPerAxis();
+    const std::size_t count = bricks[0] * bricks[1] * bricks[2];
+    const std::size_t first = store.brickIndex(0, 0, 0, channel);
+    if (bricks != bricks_ || first != firstBrick_ || brickSlot_.size() != count) {
+        // 换了数据或通道：图集中的砖块全部作废
+        bricks_ = bricks;
+        firstBrick_ = first;
+        brickSlot_.assign(count, npos);
+        reset(slotBrick_.size());
+    }
+    brickSize_ = static_cast<float>(store.options().brickSize);
+
+    visible_.assign(count, 0);
+    visibleList_.clear();
+    for (std::size_t local = 0; local < count; ++local) {
+        const VoxelBrickInfo& info = store.brickInfo(first + local);
+        if (visible(info.min, info.max)) {
+            visible_[local] = 1;
+            visibleList_.push_back(first + local);
+        }
+    }
+    stats_.visibleBricks = visibleList_.size();
+    stats_.skippedBricks = count - visibleList_.size();
+    stats_.full = visibleList_.size() > slotBrick_.size();
+}
+
+std::size_t BrickAtlas::slot(std::size_t brick) const {
+    return brick >= firstBrick_ && brick - firstBrick_ < brickSlot_.size() ? brickSlot_[brick - firstBrick_] : npos;
+}
+
+bool BrickAtlas::visible(std::size_t brick) const {
+    return brick >= firstBrick_ && brick - firstBrick_ < visible_.size() && visible_[brick - firstBrick_];
+}
+
+float BrickAtlas::distance(std::size_t brick, const glm::vec3& eye) const {
+    const std::size_t local = brick - firstBrick_;
+    const std::size_t bz = local % bricks_[2];
+    const std::size_t by = local / bricks_[2] % bricks_[1];
+    const std::size_t bx = local / (bricks_[1] * bricks_[2]);
+    const glm::vec3 center = (glm::vec3(bx, by, bz) + 0.5f) * brickSize_;
+    return glm::distance(center, eye);
+}
+
+std::vector<BrickUpload> BrickAtlas::schedule(const glm::vec3& eye, std::size_t budget) {
+    std::vector<BrickUpload> uploads;
+    std::vector<std::pair<float, std::size_t>> missing;
+    std::size_t resident = 0;
+    for (const std::size_t brick : visibleList_) {
+        if (brickSlot_[brick - firstBrick_] == npos) {
+            missing.emplace_back(distance(brick, eye), brick);
+        } else {
+            ++resident;
+        }
+    }
+    stats_.residentBricks = resident;
+    if (missing.empty() || budget == 0 || slotBrick_.empty()) {
+        return uploads;
+    }
+    const std::size_t wanted = std::min(budget, missing.size());
+    std::partial_sort(missing.begin(), missing.begin() + static_cast<std::ptrdiff_t>(wanted), missing.end());
+
+    // 可直接使用的槽位：空槽与已不可见砖块占用的槽
+    std::vector<std::size_t> reclaimable;
+    for (std::size_t s = 0; s < slotBrick_.size(); ++s) {
+        if (slotBrick_[s] == npos || !visible_[slotBrick_[s] - firstBrick_]) {
+            reclaimable.push_back(s);
+        }
+    }
+    std::vector<std::pair<float, std::size_t>> farthest;  // 仍可见的驻留砖块，由远到近
+    bool builtFarthest = false;
+    std::size_t nextReclaim = 0;
+    std::size_t nextFar = 0;
+
+    for (std::size_t i = 0; i < wanted; ++i) {
+        const auto [distanceToEye, brick] = missing[i];
+        std::size_t s = npos;
+        if (nextReclaim < reclaimable.size()) {
+            s = reclaimable[nextReclaim++];
+        } else {
+            if (!builtFarthest) {
+                for (std::size_t slot = 0; slot < slotBrick_.size(); ++slot) {
+                    farthest.emplace_back(distance(slotBrick_[slot], eye), slot);
+                }
+                std::sort(farthest.begin(), farthest.end(), std::greater<>());
+                builtFarthest = true;
+            }
+            // 至少远一个砖块边长才替换，避免视点微动时来回换入换出
+            if (nextFar < farthest.size() && farthest[nextFar].first > distanceToEye + brickSize_) {
+                s = farthest[nextFar++].second;
+            }
+        }
+        if (s == npos) {
+            stats_.full = true;
+            break;
+        }
+        BrickUpload upload;
+        upload.brick = brick;
+        upload.slot = s;
+        if (slotBrick_[s] != npos) {
+            upload.evicted = slotBrick_[s];
+            brickSlot_[upload.evicted - firstBrick_] = npos;
+            if (visible_[upload.evicted - firstBrick_]) {
+                --stats_.residentBricks;
+            }
+        }
+        slotBrick_[s] = brick;
+        brickSlot_[brick - firstBrick_] = s;
+        ++stats_.residentBricks;
+        uploads.push_back(upload);
+    }
+    return uploads;
+}
+
+} // namespace mcnp::core
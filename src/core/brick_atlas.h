@@ -0,0 +1,70 @@
+#ifndef BRICK_ATLAS_H
+#define BRICK_ATLAS_H
+
+#include "voxel_store.h"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <vector>
+
+namespace mcnp::core {
+
+// 一次砖块上传：把 brick 写入图集槽位 slot；evicted 为被替换出的砖块（无则为 npos）
+struct BrickUpload {
+    std::size_t brick = 0;
+    std::size_t slot = 0;
+    std::size_t evicted = std::numeric_limits<std::size_t>::max();
+};
+
+struct BrickAtlasStats {
+    std::size_t visibleBricks = 0;   // 按传输函数可能不透明的砖块
+    std::size_t skippedBricks = 0;   // 整块透明，光线直接跳过
+    std::size_t residentBricks = 0;  // 已在图集中的可见砖块
+    bool full = false;               // 图集容纳不下全部可见砖块，最远的砖块暂不显示
+};
+
+// 体绘制的砖块调度（与图形 API 无关）：按砖块的值上下界判定整块透明的砖块，
+// 可见砖块按距视点由近到远分配固定数量的图集槽位，每帧至多上传 budget 个，
+// 槽位不足时先替换已不可见的砖块，再用近处砖块替换远处砖块。
+class BrickAtlas {
+public:
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    explicit BrickAtlas(std::size_t slots = 0) { reset(slots); }
+
+    // 清空全部槽位；slots 为图集容量（砖块数）
+    void reset(std::size_t slots);
+
+    // 按 visible(min, max) 重新判定 channel 的可见砖块；已驻留的砖块保留在图集中
+    void classify(const VoxelBrickStore& store, std::size_t channel,
+                  const std::function<bool(float low, float high)>& visible);
+
+    // 选出本帧上传的砖块并分配槽位；eye 为体素坐标中的视点
+    std::vector<BrickUpload> schedule(const glm::vec3& eye, std::size_t budget);
+
+    // 砖块所在槽位；未驻留返回 npos
+    std::size_t slot(std::size_t brick) const;
+    bool visible(std::size_t brick) const;
+    std::size_t slots() const noexcept { return slotBrick_.size(); }
+    const BrickAtlasStats& stats() const noexcept { return stats_; }
+
+private:
+    float distance(std::size_t brick, const glm::vec3& eye) const;
+
+    std::vector<std::size_t> slotBrick_;  // 槽位 -> 砖块
+    std::vector<std::size_t> brickSlot_;  // 砖块 -> 槽位（只含当前通道）
+    std::vector<char> visible_;
+    std::vector<std::size_t> visibleList_;
+    std::size_t firstBrick_ = 0;  // 当前通道首个砖块的编号
+    std::array<std::size_t, 3> bricks_{};
+    float brickSize_ = 1.0f;
+    BrickAtlasStats stats_;
+};
+
+} // namespace mcnp::core
+
+#endif // BRICK_ATLAS_H
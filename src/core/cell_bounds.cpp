@@ -0,0 +1,228 @@
+#include "cell_bounds.h"
+
+#include <algorithm>
+
+namespace mcnp::core {
+
+namespace {
+
+CellBounds::Coverage complement(CellBounds::Coverage coverage) {
+    switch (coverage) {
+        case CellBounds::Coverage::Outside:
+            return CellBounds::Coverage::Inside;
+        case CellBounds::Coverage::Inside:
+            return CellBounds::Coverage::Outside;
+        default:
+            return coverage;
+    }
+}
+
+// f < 0 为负侧；f = 0 归正侧，与 SurfaceTable::sense 一致
+CellBounds::Coverage negative_side(const SurfaceTable::ValueRange& range) {
+    if (range.low >= 0.0) {
+        return CellBounds::Coverage::Outside;
+    }
+    return range.high < 0.0 ? CellBounds::Coverage::Inside : CellBounds::Coverage::Partial;
+}
+
+} // namespace
+
+CellBounds::CellBounds(const CsgDag& dag, const SurfaceTable& surfaces, CellBoundsOptions options)
+    : dag_(dag), surfaces_(surfaces), options_(options) {}
+
+Aabb CellBounds::halfspace(const CsgNode& n) const {
+    if (n.facet == 0) {
+        if (const SurfaceTable::MacroBody* body = surfaces_.findMacroBody(n.surface)) {
+            if (!n.negative) {
+                return Aabb::infinite();
+            }
+            Aabb box = Aabb::infinite();
+            for (std::uint32_t i = 0; i < body->facetCount; ++i) {
+                box.intersect(surfaces_.bounds(body->firstRow + i, true));
+            }
+            return box;
+        }
+    }
+    const auto row = surfaces_.find(n.surface, n.facet);
+    if (!row) {
+        // 与 CsgDag::contains 一致：未定义的曲面视为正侧
+        return n.negative ? Aabb{} : Aabb::infinite();
+    }
+    return surfaces_.bounds(*row, n.negative);
+}
+
+const Aabb& CellBounds::coarse(CsgDag::NodeId id) {
+    const auto it = coarse_.find(id);
+    if (it != coarse_.end()) {
+        return it->second;
+    }
+    const CsgNode& n = dag_.node(id);
+    Aabb box;
+    switch (n.op) {
+        case CsgOp::Empty:
+            break;
+        case CsgOp::Universe:
+            box = Aabb::infinite();
+            break;
+        case CsgOp::Halfspace:
+            box = halfspace(n);
+            break;
+        case CsgOp::Intersection:
+            box = Aabb::infinite();
+            for (const CsgDag::NodeId child : dag_.children(id)) {
+                box.intersect(coarse(child));
+                if (box.empty()) {
+                    box = Aabb{};
+                    break;
+                }
+            }
+            break;
+        case CsgOp::Union:
+            for (const CsgDag::NodeId child : dag_.children(id)) {
+                box.expand(coarse(child));
+            }
+            break;
+    }
+    return coarse_.emplace(id, box).first->second;
+}
+
+CellBounds::Coverage CellBounds::classifyHalfspace(const CsgNode& n, const Aabb& box) const {
+    if (n.facet == 0) {
+        if (const SurfaceTable::MacroBody* body = surfaces_.findMacroBody(n.surface)) {
+            Coverage inside = Coverage::Inside;
+            for (std::uint32_t i = 0; i < body->facetCount && inside != Coverage::Outside; ++i) {
+                const Coverage facet = negative_side(surfaces_.range(body->firstRow + i, box));
+                inside = facet == Coverage::Inside ? inside : facet;
+            }
+            return n.negative ? inside : complement(inside);
+        }
+    }
+    const auto row = surfaces_.find(n.surface, n.facet);
+    if (!row) {
+        return n.negative ? Coverage::Outside : Coverage::Inside;
+    }
+    const Coverage inside = negative_side(surfaces_.range(*row, box));
+    return n.negative ? inside : complement(inside);
+}
+
+CellBounds::Coverage CellBounds::classify(CsgDag::NodeId id, const Aabb& box) {
+    if (!coarse(id).intersects(box)) {
+        return Coverage::Outside;
+    }
+    const CsgNode& n = dag_.node(id);
+    switch (n.op) {
+        case CsgOp::Empty:
+            return Coverage::Outside;
+        case CsgOp::Universe:
+            return Coverage::Inside;
+        case CsgOp::Halfspace:
+            return classifyHalfspace(n, box);
+        case CsgOp::Intersection: {
+            Coverage result = Coverage::Inside;
+            for (const CsgDag::NodeId child : dag_.children(id)) {
+                const Coverage c = classify(child, box);
+                if (c == Coverage::Outside) {
+                    return c;
+                }
+                result = c == Coverage::Partial ? c : result;
+            }
+            return result;
+        }
+        case CsgOp::Union: {
+            Coverage result = Coverage::Outside;
+            for (const CsgDag::NodeId child : dag_.children(id)) {
+                const Coverage c = classify(child, box);
+                if (c == Coverage::Inside) {
+                    return c;
+                }
+                result = c == Coverage::Partial ? c : result;
+            }
+            return result;
+        }
+    }
+    return Coverage::Partial;
+}
+
+Aabb CellBounds::contract(CsgDag::NodeId region, Aabb box) {
+    const int slices = std::max(2, options_.slices);
+    for (int pass = 0; pass < options_.passes; ++pass) {
+        bool changed = false;
+        for (int axis = 0; axis < 3; ++axis) {
+            const double low = box.min[axis];
+            const double width = (box.max[axis] - low) / slices;
+            if (!(width > 0.0)) {
+                continue;
+            }
+            auto slice = [&](int i) {
+                Aabb s = box;
+                s.min[axis] = low + width * i;
+                s.max[axis] = i + 1 == slices ? box.max[axis] : low + width * (i + 1);
+                return s;
+            };
+            int first = 0;
+            while (first < slices && classify(region, slice(first)) == Coverage::Outside) {
+                ++first;
+            }
+            if (first == slices) {
+                return Aabb{};
+            }
+            int last = slices - 1;
+            while (last > first && classify(region, slice(last)) == Coverage::Outside) {
+                --last;
+            }
+            if (first > 0 || last < slices - 1) {
+                box.min[axis] = slice(first).min[axis];
+                box.max[axis] = slice(last).max[axis];
+                changed = true;
+            }
+        }
+        if (!changed) {
+            break;
+        }
+    }
+    return box;
+}
+
+Aabb CellBounds::sample(CsgDag::NodeId region, const Aabb& box) const {
+    const int n = options_.samples;
+    const glm::dvec3 step = box.extent() / static_cast<double>(n);
+    Aabb found;
+    for (int k = 0; k < n; ++k) {
+        for (int j = 0; j < n; ++j) {
+            for (int i = 0; i < n; ++i) {
+                const glm::dvec3 p = box.min + step * (glm::dvec3(i, j, k) + 0.5);
+                if (dag_.contains(region, p, surfaces_)) {
+                    found.expand(p);
+                }
+            }
+        }
+    }
+    if (found.empty()) {
+        return box;  // 没有采到点不能说明区域为空（可能是薄层）
+    }
+    found.min -= step * 0.5;
+    found.max += step * 0.5;
+    found.intersect(box);
+    return found;
+}
+
+Aabb CellBounds::bounds(CsgDag::NodeId region) {
+    Aabb box = coarse(region);
+    if (box.empty()) {
+        return Aabb{};
+    }
+    box.intersect(options_.world);
+    if (box.empty()) {
+        return Aabb{};
+    }
+    if (!box.isFinite()) {
+        return box;
+    }
+    box = contract(region, box);
+    if (options_.samples > 0 && !box.empty()) {
+        box = sample(region, box);
+    }
+    return box;
+}
+
+} // namespace mcnp::core
@@ -0,0 +1,54 @@
+#ifndef CELL_BOUNDS_H
+#define CELL_BOUNDS_H
+
+#include "aabb.h"
+#include "csg_dag.h"
+#include "surface_table.h"
+
+#include <cstdint>
+#include <unordered_map>
+
+namespace mcnp::core {
+
+struct CellBoundsOptions {
+    Aabb world = Aabb::infinite();  // 传播后仍无界的方向截断到此盒；仍无界时不做收缩
+    int slices = 16;                // 收缩时每轴的切片数
+    int passes = 4;                 // 三轴轮流收缩的最多轮数
+    int samples = 0;                // >0 时再按 samples³ 网格点采样收紧（非保守，外扩半个网格）
+};
+
+// 单元的轴对齐包围盒。先自下而上传播区间：半空间取精确范围，交取交集、并取并集；
+// 再在有界盒内沿各轴切片，用区间算术剔除确定在区域之外的切片，反复收缩。
+// 除采样收紧外结果是保守的。结果按节点缓存，非线程安全，每个线程各用一个实例。
+class CellBounds {
+public:
+    enum class Coverage : std::uint8_t {
+        Outside,
+        Inside,
+        Partial
+    };
+
+    CellBounds(const CsgDag& dag, const SurfaceTable& surfaces, CellBoundsOptions options = {});
+
+    // 区域为空时返回空盒
+    Aabb bounds(CsgDag::NodeId region);
+    // 仅自下而上的区间传播
+    const Aabb& coarse(CsgDag::NodeId id);
+    // 区域与盒的关系（区间算术，Partial 表示不确定）
+    Coverage classify(CsgDag::NodeId id, const Aabb& box);
+
+private:
+    Aabb halfspace(const CsgNode& node) const;
+    Coverage classifyHalfspace(const CsgNode& node, const Aabb& box) const;
+    Aabb contract(CsgDag::NodeId region, Aabb box);
+    Aabb sample(CsgDag::NodeId region, const Aabb& box) const;
+
+    const CsgDag& dag_;
+    const SurfaceTable& surfaces_;
+    CellBoundsOptions options_;
+    std::unordered_map<CsgDag::NodeId, Aabb> coarse_;
+};
+
+} // namespace mcnp::core
+
+#endif // CELL_BOUNDS_H
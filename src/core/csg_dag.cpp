@@ -0,0 +1,314 @@
+#include "csg_dag.h"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+
+namespace mcnp::core {
+
+namespace {
+
+constexpr std::uint64_t kHashSeed = 0x9e3779b97f4a7c15ull;
+
+std::uint64_t mix(std::uint64_t h, std::uint64_t v) {
+    h ^= v + kHashSeed + (h << 6) + (h >> 2);
+    return h * 0xff51afd7ed558ccdull;
+}
+
+std::uint64_t hash_node(const CsgNode& key, std::span<const CsgDag::NodeId> children) {
+    std::uint64_t h = mix(static_cast<std::uint64_t>(key.op), static_cast<std::uint64_t>(key.negative));
+    h = mix(h, static_cast<std::uint64_t>(static_cast<std::uint16_t>(key.facet)));
+    h = mix(h, static_cast<std::uint64_t>(static_cast<std::uint32_t>(key.surface)));
+    for (const CsgDag::NodeId child : children) {
+        h = mix(h, child);
+    }
+    return h;
+}
+
+PrimitiveType primitive_for(SurfaceType type) {
+    switch (type) {
+        case SurfaceType::Plane:
+            return PrimitiveType::Plane;
+        case SurfaceType::Sphere:
+            return PrimitiveType::Sphere;
+        case SurfaceType::Cylinder:
+            return PrimitiveType::Cylinder;
+        case SurfaceType::Cone:
+            return PrimitiveType::Cone;
+        default:
+            return PrimitiveType::Unknown;
+    }
+}
+
+PrimitiveType primitive_for(const SurfaceTable& surfaces, const CsgNode& n) {
+    if (n.facet == 0) {
+        if (const SurfaceTable::MacroBody* body = surfaces.findMacroBody(n.surface)) {
+            switch (body->type) {
+                case MacroBodyType::Sph:
+                    return PrimitiveType::Sphere;
+                case MacroBodyType::Rcc:
+                    return PrimitiveType::Cylinder;
+                case MacroBodyType::Trc:
+                    return PrimitiveType::Cone;
+                default:
+                    return PrimitiveType::Box;
+            }
+        }
+    }
+    const auto row = surfaces.find(n.surface, n.facet);
+    return row ? primitive_for(surfaces.type(*row)) : PrimitiveType::Unknown;
+}
+
+} // namespace
+
+CsgDag::CsgDag() {
+    CsgNode empty;
+    empty.op = CsgOp::Empty;
+    intern(empty, {});
+    CsgNode universe;
+    universe.op = CsgOp::Universe;
+    intern(universe, {});
+}
+
+std::span<const CsgDag::NodeId> CsgDag::children(NodeId id) const {
+    const CsgNode& n = nodes_[id];
+    return {childPool_.data() + n.firstChild, n.childCount};
+}
+
+bool CsgDag::sameNode(NodeId id, const CsgNode& key, std::span<const NodeId> children) const {
+    const CsgNode& n = nodes_[id];
+    if (n.op != key.op || n.negative != key.negative || n.facet != key.facet || n.surface != key.surface ||
+        n.childCount != children.size()) {
+        return false;
+    }
+    return std::equal(children.begin(), children.end(), childPool_.begin() + n.firstChild);
+}
+
+CsgDag::NodeId CsgDag::lookup(const CsgNode& key, std::span<const NodeId> children, std::size_t* slot) const {
+    if (slots_.empty()) {
+        return kInvalid;
+    }
+    const auto hash = static_cast<std::uint32_t>(key.hash);
+    const std::size_t mask = slots_.size() - 1;
+    std::size_t index = (key.hash >> 32) & mask;
+    while (slots_[index].id != kInvalid) {
+        if (slots_[index].hash == hash && sameNode(slots_[index].id, key, children)) {
+            return slots_[index].id;
+        }
+        index = (index + 1) & mask;
+    }
+    if (slot) {
+        *slot = index;
+    }
+    return kInvalid;
+}
+
+void CsgDag::grow() {
+    std::vector<Slot> slots(std::max<std::size_t>(64, slots_.size() * 2), Slot{kInvalid, 0});
+    const std::size_t mask = slots.size() - 1;
+    for (NodeId id = 0; id < nodes_.size(); ++id) {
+        std::size_t index = (nodes_[id].hash >> 32) & mask;
+        while (slots[index].id != kInvalid) {
+            index = (index + 1) & mask;
+        }
+        slots[index] = {id, static_cast<std::uint32_t>(nodes_[id].hash)};
+    }
+    slots_ = std::move(slots);
+}
+
+CsgDag::NodeId CsgDag::intern(const CsgNode& key, std::span<const NodeId> children) {
+    if ((nodes_.size() + 1) * 2 > slots_.size()) {
+        grow();
+    }
+    CsgNode node = key;
+    node.hash = hash_node(key, children);
+    std::size_t slot = 0;
+    const NodeId existing = lookup(node, children, &slot);
+    if (existing != kInvalid) {
+        return existing;
+    }
+    node.firstChild = static_cast<std::uint32_t>(childPool_.size());
+    node.childCount = static_cast<std::uint32_t>(children.size());
+    childPool_.insert(childPool_.end(), children.begin(), children.end());
+    const auto id = static_cast<NodeId>(nodes_.size());
+    nodes_.push_back(node);
+    complements_.push_back(kInvalid);
+    slots_[slot] = {id, static_cast<std::uint32_t>(node.hash)};
+    return id;
+}
+
+CsgDag::NodeId CsgDag::halfspace(int surface, bool negative, int facet) {
+    CsgNode key;
+    key.op = CsgOp::Halfspace;
+    key.surface = surface;
+    key.negative = negative;
+    key.facet = static_cast<std::int16_t>(facet);
+    return intern(key, {});
+}
+
+CsgDag::NodeId CsgDag::intersection(std::span<const NodeId> children) {
+    return combine(CsgOp::Intersection, children);
+}
+
+CsgDag::NodeId CsgDag::unite(std::span<const NodeId> children) {
+    return combine(CsgOp::Union, children);
+}
+
+CsgDag::NodeId CsgDag::combine(CsgOp op, std::span<const NodeId> children) {
+    // 交：全空间为单位元，空集为零元；并相反
+    const NodeId identity = op == CsgOp::Intersection ? universe() : empty();
+    const NodeId absorbing = op == CsgOp::Intersection ? empty() : universe();
+
+    std::vector<NodeId> flat;
+    flat.reserve(children.size());
+    for (const NodeId child : children) {
+        if (child == absorbing) {
+            return absorbing;
+        }
+        if (child == identity) {
+            continue;
+        }
+        if (nodes_[child].op == op) {
+            const auto nested = this->children(child);
+            flat.insert(flat.end(), nested.begin(), nested.end());
+        } else {
+            flat.push_back(child);
+        }
+    }
+    std::sort(flat.begin(), flat.end());
+    flat.erase(std::unique(flat.begin(), flat.end()), flat.end());
+    if (flat.empty()) {
+        return identity;
+    }
+    if (flat.size() == 1) {
+        return flat.front();
+    }
+
+    // 同时含 s 与 -s：交为空，并为全空间
+    for (const NodeId child : flat) {
+        const CsgNode& n = nodes_[child];
+        if (n.op != CsgOp::Halfspace) {
+            continue;
+        }
+        CsgNode opposite = n;
+        opposite.negative = !n.negative;
+        opposite.hash = hash_node(opposite, {});
+        const NodeId other = lookup(opposite, {}, nullptr);
+        if (other != kInvalid && std::binary_search(flat.begin(), flat.end(), other)) {
+            return absorbing;
+        }
+    }
+
+    CsgNode key;
+    key.op = op;
+    return intern(key, flat);
+}
+
+CsgDag::NodeId CsgDag::complement(NodeId id) {
+    if (complements_[id] != kInvalid) {
+        return complements_[id];
+    }
+    const CsgNode n = nodes_[id];
+    NodeId result = kInvalid;
+    switch (n.op) {
+        case CsgOp::Empty:
+            result = universe();
+            break;
+        case CsgOp::Universe:
+            result = empty();
+            break;
+        case CsgOp::Halfspace:
+            result = halfspace(n.surface, !n.negative, n.facet);
+            break;
+        case CsgOp::Intersection:
+        case CsgOp::Union: {
+            // De Morgan：~(a ∩ b) = ~a ∪ ~b
+            std::vector<NodeId> negated;
+            negated.reserve(n.childCount);
+            for (std::uint32_t i = 0; i < n.childCount; ++i) {
+                negated.push_back(complement(childPool_[n.firstChild + i]));
+            }
+            result = n.op == CsgOp::Intersection ? unite(negated) : intersection(negated);
+            break;
+        }
+    }
+    complements_[id] = result;
+    complements_[result] = id;
+    return result;
+}
+
+bool CsgDag::contains(NodeId id, const glm::dvec3& p, const SurfaceTable& surfaces) const {
+    const CsgNode& n = nodes_[id];
+    switch (n.op) {
+        case CsgOp::Empty:
+            return false;
+        case CsgOp::Universe:
+            return true;
+        case CsgOp::Halfspace: {
+            bool inside = false;
+            const SurfaceTable::MacroBody* body = n.facet == 0 ? surfaces.findMacroBody(n.surface) : nullptr;
+            if (body) {
+                inside = surfaces.insideMacroBody(*body, p);
+            } else if (const auto row = surfaces.find(n.surface, n.facet)) {
+                inside = surfaces.evaluate(*row, p) < 0.0;
+            }
+            return inside == n.negative;
+        }
+        case CsgOp::Intersection:
+            for (const NodeId child : children(id)) {
+                if (!contains(child, p, surfaces)) {
+                    return false;
+                }
+            }
+            return true;
+        case CsgOp::Union:
+            for (const NodeId child : children(id)) {
+                if (contains(child, p, surfaces)) {
+                    return true;
+                }
+            }
+            return false;
+    }
+    return false;
+}
+
+std::shared_ptr<GeometryNode> CsgDag::toGeometry(NodeId root, const SurfaceTable* surfaces) const {
+    std::unordered_map<NodeId, std::shared_ptr<GeometryNode>> built;
+    auto build = [&](auto&& self, NodeId id) -> std::shared_ptr<GeometryNode> {
+        const auto it = built.find(id);
+        if (it != built.end()) {
+            return it->second;
+        }
+        const CsgNode& n = nodes_[id];
+        auto geometry = std::make_shared<GeometryNode>();
+        switch (n.op) {
+            case CsgOp::Halfspace: {
+                geometry->id = n.surface;
+                geometry->label = (n.negative ? "-" : "+") + std::to_string(n.surface) +
+                                  (n.facet != 0 ? "." + std::to_string(n.facet) : std::string());
+                if (surfaces) {
+                    geometry->primitive = primitive_for(*surfaces, n);
+                }
+                break;
+            }
+            case CsgOp::Intersection:
+            case CsgOp::Union:
+                geometry->booleanOp = n.op == CsgOp::Union ? BooleanOperation::Union : BooleanOperation::Intersection;
+                for (const NodeId child : children(id)) {
+                    geometry->children.push_back(self(self, child));
+                }
+                break;
+            case CsgOp::Empty:
+                geometry->label = "empty";
+                break;
+            case CsgOp::Universe:
+                geometry->label = "universe";
+                break;
+        }
+        built.emplace(id, geometry);
+        return geometry;
+    };
+    return build(build, root);
+}
+
+} // namespace mcnp::core
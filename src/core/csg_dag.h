@@ -0,0 +1,82 @@
+#ifndef CSG_DAG_H
+#define CSG_DAG_H
+
+#include "geometry_model.h"
+#include "surface_table.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace mcnp::core {
+
+enum class CsgOp : std::uint8_t {
+    Halfspace,     // 曲面（或宏体、宏体的面）的一侧
+    Intersection,
+    Union,
+    Empty,
+    Universe
+};
+
+struct CsgNode {
+    CsgOp op = CsgOp::Empty;
+    bool negative = false;    // Halfspace：负侧（-n）
+    std::int16_t facet = 0;   // Halfspace：宏体面号，0 表示整个曲面/宏体
+    int surface = 0;          // Halfspace：曲面号
+    std::uint32_t firstChild = 0;
+    std::uint32_t childCount = 0;
+    std::uint64_t hash = 0;
+};
+
+// 哈希共享（hash-consing）的 CSG 有向无环图：结构相同的子表达式只存一份。
+// 补运算按 De Morgan 律下推到半空间并缓存，因此图中只有交、并与半空间（否定范式）。
+class CsgDag {
+public:
+    using NodeId = std::uint32_t;
+    static constexpr NodeId kInvalid = ~NodeId{0};
+
+    CsgDag();
+
+    NodeId empty() const noexcept { return 0; }
+    NodeId universe() const noexcept { return 1; }
+    NodeId halfspace(int surface, bool negative, int facet = 0);
+    // 子节点会被展平、排序、去重；含互补半空间的交为空，并为全空间
+    NodeId intersection(std::span<const NodeId> children);
+    NodeId unite(std::span<const NodeId> children);
+    NodeId complement(NodeId node);
+
+    std::size_t size() const noexcept { return nodes_.size(); }
+    const CsgNode& node(NodeId id) const { return nodes_[id]; }
+    std::span<const NodeId> children(NodeId id) const;
+
+    // 点分类：宏体整体引用通过 insideMacroBody 判定；曲面表中不存在的曲面视为正侧
+    bool contains(NodeId id, const glm::dvec3& p, const SurfaceTable& surfaces) const;
+
+    // 导出为 GeometryNode 树，共享子表达式对应同一个 shared_ptr
+    std::shared_ptr<GeometryNode> toGeometry(NodeId id, const SurfaceTable* surfaces = nullptr) const;
+
+private:
+    struct Slot {
+        NodeId id;
+        std::uint32_t hash;
+    };
+
+    NodeId combine(CsgOp op, std::span<const NodeId> children);
+    NodeId intern(const CsgNode& key, std::span<const NodeId> children);
+    NodeId lookup(const CsgNode& key, std::span<const NodeId> children, std::size_t* slot) const;
+    bool sameNode(NodeId id, const CsgNode& key, std::span<const NodeId> children) const;
+    void grow();
+
+    std::vector<CsgNode> nodes_;
+    std::vector<NodeId> childPool_;
+    std::vector<NodeId> complements_;  // 补运算缓存
+    std::vector<Slot> slots_;
+};
+
+} // namespace mcnp::core
+
+#endif // CSG_DAG_H
@@ -2,6 +2,10 @@
 
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <cmath>
+
+namespace mcnp::core {
+
 glm::mat4 Transform::toMatrix() const {
     glm::mat4 matrix(1.0f);
     matrix = glm::translate(matrix, translation);
@@ -11,3 +15,31 @@ glm::mat4 Transform::toMatrix() const {
     matrix = glm::scale(matrix, scale);
     return matrix;
 }
+
+Transform Transform::fromMatrix(const glm::mat4& matrix) {
+    Transform t;
+    t.translation = glm::vec3(matrix[3]);
+    glm::vec3 axes[3] = {glm::vec3(matrix[0]), glm::vec3(matrix[1]), glm::vec3(matrix[2])};
+    for (int i = 0; i < 3; ++i) {
+        t.scale[i] = glm::length(axes[i]);
+        axes[i] = t.scale[i] > 0.0f ? axes[i] / t.scale[i] : glm::vec3(0.0f);
+    }
+    // 镜像变换把符号记在 x 缩放上
+    if (glm::dot(glm::cross(axes[0], axes[1]), axes[2]) < 0.0f) {
+        t.scale.x = -t.scale.x;
+        axes[0] = -axes[0];
+    }
+    // R = Rx·Ry·Rz：第三列为 (sin y, -sin x cos y, cos x cos y)，第一行为 (cos y cos z, -cos y sin z, sin y)
+    const float sy = glm::clamp(axes[2].x, -1.0f, 1.0f);
+    t.rotation.y = std::asin(sy);
+    if (std::abs(sy) < 0.99999f) {
+        t.rotation.x = std::atan2(-axes[2].y, axes[2].z);
+        t.rotation.z = std::atan2(-axes[1].x, axes[0].x);
+    } else {
+        // 万向锁：x 与 z 的转角合并到 z 上
+        t.rotation.z = std::atan2(axes[0].y, axes[1].y);
+    }
+    return t;
+}
+
+} // namespace mcnp::core
@@ -8,19 +8,27 @@
 #include <string>
 #include <vector>
 
+// 放入 mcnp::core，避免与 vertex_mesh.h 中全局的 BooleanOperation 冲突
+namespace mcnp::core {
+
 struct MaterialInfo {
     std::string name;
-    double density = 0.0;
+    double density = 0.0;          // g/cm^3
+    double massAttenuation = 0.0;  // 质量衰减系数 cm^2/g（点核屏蔽计算使用）
 };
 
 struct SourceInfo {
     std::string name;
     glm::vec3 position{0.0f};
+    double strength = 1.0;  // 源强 (particles/s)
+    double energy = 1.0;    // 代表能量 (MeV)
 };
 
 struct DetectorInfo {
     std::string name;
     int id = -1;
+    glm::vec3 position{0.0f};
+    double responseFactor = 1.0;  // 通量-剂量转换因子
 };
 
 enum class PrimitiveType {
@@ -44,6 +52,8 @@ struct Transform {
     glm::vec3 scale{1.0f};
 
     glm::mat4 toMatrix() const;
+    // toMatrix 的逆：把不含剪切的 平移·旋转·缩放 矩阵分解回各分量
+    static Transform fromMatrix(const glm::mat4& matrix);
 };
 
 struct GeometryNode {
@@ -58,4 +68,6 @@ struct GeometryNode {
     std::vector<std::shared_ptr<GeometryNode>> children;
 };
 
+} // namespace mcnp::core
+
 #endif // GEOMETRY_MODEL_H
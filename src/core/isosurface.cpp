@@ -0,0 +1,568 @@
+#include "isosurface.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace mcnp::core {
+
+namespace {
+
+// 体元角点 i 的偏移为 (i & 1, (i >> 1) & 1, (i >> 2) & 1)；
+// 边号 axis * 4 + k，k 的两位依次为起点在另外两轴 (axis + 1, axis + 2) 上的偏移
+int EdgeBetween(int a, int b)
+{
+    const int axis = std::countr_zero(static_cast<unsigned>(a ^ b));
+    const int origin = a & b;
+    return axis * 4 + ((origin >> ((axis + 1) % 3)) & 1) + 2 * ((origin >> ((axis + 2) % 3)) & 1);
+}
+
+int EdgeOrigin(int edge)
+{
+    const int axis = edge / 4;
+    return (((edge & 1) << ((axis + 1) % 3)) | (((edge >> 1) & 1) << ((axis + 2) % 3)));
+}
+
+// 由面上的角点状态生成三角形表：每个面上连续的“内”角点（值不低于等值）被一条线段切下，
+// 线段方向使内侧位于左手（自体元外看，角点按逆时针排列）。相邻体元对公共面的判定相同，
+// 因此歧义面的连法一致，拼接后的等值面没有裂缝。线段首尾相接成环，再扇形剖分。
+struct MarchingTables {
+    std::array<std::array<std::int8_t, 30>, 256> triangles{};  // 边号三元组，-1 结束
+    std::array<std::array<std::int8_t, 3>, 12> origins{};      // 边起点相对体元的偏移
+
+    MarchingTables()
+    {
+        static constexpr int kFaces[6][4] = {
+            {0, 4, 6, 2}, {1, 3, 7, 5}, {0, 1, 5, 4}, {2, 6, 7, 3}, {0, 2, 3, 1}, {4, 5, 7, 6},
+        };
+        for (int edge = 0; edge < 12; ++edge) {
+            const int corner = EdgeOrigin(edge);
+            origins[edge] = {static_cast<std::int8_t>(corner & 1), static_cast<std::int8_t>((corner >> 1) & 1),
+                             static_cast<std::int8_t>((corner >> 2) & 1)};
+        }
+        std::array<unsigned, 12> faceMask{};  // 边所在的面
+        for (int face = 0; face < 6; ++face) {
+            for (int i = 0; i < 4; ++i) {
+                faceMask[EdgeBetween(kFaces[face][i], kFaces[face][(i + 1) % 4])] |= 1u << face;
+            }
+        }
+        for (int cube = 0; cube < 256; ++cube) {
+            const auto inside = [cube](int corner) { return ((cube >> corner) & 1) != 0; };
+            std::array<int, 12> next;
+            next.fill(-1);
+            for (const auto& face : kFaces) {
+                for (int i = 0; i < 4; ++i) {
+                    if (!inside(face[i]) || inside(face[(i + 3) % 4])) {
+                        continue;
+                    }
+                    int last = i;
+                    while (inside(face[(last + 1) % 4])) {
+                        last = (last + 1) % 4;
+                    }
+                    next[EdgeBetween(face[last], face[(last + 1) % 4])] = EdgeBetween(face[(i + 3) % 4], face[i]);
+                }
+            }
+            auto& out = triangles[cube];
+            out.fill(-1);
+            int count = 0;
+            std::array<bool, 12> used{};
+            for (int start = 0; start < 12; ++start) {
+                if (next[start] < 0 || used[start]) {
+                    continue;
+                }
+                std::array<int, 12> loop;
+                int size = 0;
+                for (int edge = start; !used[edge]; edge = next[edge]) {
+                    used[edge] = true;
+                    loop[size++] = edge;
+                }
+                // 扇形的对角线若连接同一面上的两点，会与相邻体元的对角线重合而形成非流形边；
+                // 选一个对角线都不落在面上的顶点作扇心（每种环都存在这样的顶点）
+                int apex = 0;
+                for (; apex < size; ++apex) {
+                    bool valid = true;
+                    for (int j = 2; j + 1 < size && valid; ++j) {
+                        valid = (faceMask[loop[apex]] & faceMask[loop[(apex + j) % size]]) == 0;
+                    }
+                    if (valid) {
+                        break;
+                    }
+                }
+                for (int i = 1; i + 1 < size; ++i) {
+                    out[count++] = static_cast<std::int8_t>(loop[apex]);
+                    out[count++] = static_cast<std::int8_t>(loop[(apex + i + 1) % size]);
+                    out[count++] = static_cast<std::int8_t>(loop[(apex + i) % size]);
+                }
+            }
+        }
+    }
+};
+
+const MarchingTables& Tables()
+{
+    static const MarchingTables tables;
+    return tables;
+}
+
+std::uint64_t Word(const std::uint8_t* bytes)
+{
+    std::uint64_t word;
+    std::memcpy(&word, bytes, sizeof(word));
+    return word;
+}
+
+// 每线程的工作区：带 1 体素边框（低侧 1 层、高侧 2 层）的砖块值与块内边 -> 顶点表
+struct Scratch {
+    std::vector<float> block;
+    std::vector<std::uint8_t> inside;
+    std::vector<std::int32_t> edgeVertex;
+};
+
+} // namespace
+
+struct IsosurfaceExtractor::BrickResult {
+    struct External {
+        std::uint32_t at = 0;        // 在 indices 中的位置
+        std::uint32_t neighbour = 0;  // 前向相邻砖块的偏移位：x | y << 1 | z << 2
+        std::uint32_t edge = 0;       // 相邻砖块内的边号
+    };
+
+    std::size_t bx = 0;
+    std::size_t by = 0;
+    std::size_t bz = 0;
+    bool cells = false;  // 是否提取本块的体元；否则只生成被相邻砖块引用的顶点
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<std::uint32_t> indices;  // 本块顶点的局部编号，外部引用在合并时填入
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> faceEdges;  // 起点位于低侧面的边 -> 局部顶点，按边号升序
+    std::vector<External> external;
+    std::size_t vertexOffset = 0;
+    std::size_t indexOffset = 0;
+};
+
+IsosurfaceExtractor::IsosurfaceExtractor(VoxelBrickStore& store, std::size_t channel, IsosurfaceOptions options)
+    : store_(store),
+      channel_(channel),
+      options_(options),
+      dims_(store.dims()),
+      bricks_(store.bricksPerAxis()),
+      brickSize_(store.options().brickSize),
+      values_(bricks_[0] * bricks_[1] * bricks_[2]),
+      lruAt_(values_.size()),
+      usedInPass_(values_.size(), 0)
+{
+    // 体素中心：给出分档边界时取相邻边界的中点，否则等分 [boxMin, boxMax]
+    for (int axis = 0; axis < 3; ++axis) {
+        const std::size_t n = dims_[axis];
+        const std::vector<double>& edges = options_.edges[axis];
+        auto& centers = centers_[axis];
+        centers.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            centers[i] = edges.size() == n + 1
+                ? static_cast<float>(0.5 * (edges[i] + edges[i + 1]))
+                : options_.boxMin[axis] +
+                      (static_cast<float>(i) + 0.5f) * (options_.boxMax[axis] - options_.boxMin[axis]) / static_cast<float>(n);
+        }
+        // 边界上的差分退化为单侧（gather 按最近体素延拓）
+        auto& scale = gradientScale_[axis];
+        scale.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            const float span = centers[std::min(i + 1, n - 1)] - centers[i == 0 ? 0 : i - 1];
+            scale[i] = span != 0.0f ? 1.0f / span : 1.0f;
+        }
+    }
+    const std::size_t budget = options_.cacheBytes ? options_.cacheBytes : store.options().memoryBudget;
+    capacity_ = std::max<std::size_t>(1, budget / (brickSize_ * brickSize_ * brickSize_ * sizeof(float)));
+}
+
+void IsosurfaceExtractor::clearCache()
+{
+    for (auto& brick : values_) {
+        brick = std::vector<float>();
+    }
+    lru_.clear();
+    cached_ = 0;
+}
+
+void IsosurfaceExtractor::touch(std::size_t bx, std::size_t by, std::size_t bz)
+{
+    const std::size_t index = localIndex(bx, by, bz);
+    usedInPass_[index] = pass_;
+    auto& values = values_[index];
+    if (!values.empty()) {
+        lru_.splice(lru_.begin(), lru_, lruAt_[index]);
+        return;
+    }
+    // 本批用到的砖块都已前移，队尾若属于本批则整批都放不下，只能暂时超出上限
+    while (cached_ >= capacity_ && !lru_.empty() && usedInPass_[lru_.back()] != pass_) {
+        values_[lru_.back()] = std::vector<float>();
+        lru_.pop_back();
+        --cached_;
+    }
+    values.resize(brickSize_ * brickSize_ * brickSize_);
+    store_.readBrick(store_.brickIndex(bx, by, bz, channel_), values.data());
+    lru_.push_front(index);
+    lruAt_[index] = lru_.begin();
+    ++cached_;
+    ++stats_.decodedBricks;
+}
+
+void IsosurfaceExtractor::gather(std::size_t bx, std::size_t by, std::size_t bz, std::vector<float>& block) const
+{
+    // 边框之外按最近的体素延拓（网格边界上的梯度退化为单侧差分）
+    const std::size_t size = brickSize_;
+    const std::size_t padded = size + 3;
+    std::array<std::vector<std::size_t>, 3> brickAt;
+    std::array<std::vector<std::size_t>, 3> localAt;
+    const std::array<std::size_t, 3> origin{bx * size, by * size, bz * size};
+    for (int axis = 0; axis < 3; ++axis) {
+        brickAt[axis].resize(padded);
+        localAt[axis].resize(padded);
+        for (std::size_t i = 0; i < padded; ++i) {
+            const std::ptrdiff_t at = static_cast<std::ptrdiff_t>(origin[axis] + i) - 1;
+            const auto clamped = static_cast<std::size_t>(
+                std::clamp<std::ptrdiff_t>(at, 0, static_cast<std::ptrdiff_t>(dims_[axis]) - 1));
+            brickAt[axis][i] = clamped / size;
+            localAt[axis][i] = clamped % size;
+        }
+    }
+    // z 方向拆成若干段，每段落在同一砖块内且连续，整段复制
+    struct Run {
+        std::size_t begin;
+        std::size_t length;
+        std::size_t brick;
+        std::size_t local;
+    };
+    std::vector<Run> runs;
+    for (std::size_t k = 0; k < padded; ++k) {
+        if (!runs.empty() && brickAt[2][k] == runs.back().brick &&
+            localAt[2][k] == runs.back().local + runs.back().length) {
+            ++runs.back().length;
+        } else {
+            runs.push_back({k, 1, brickAt[2][k], localAt[2][k]});
+        }
+    }
+    block.resize(padded * padded * padded);
+    float* out = block.data();
+    for (std::size_t i = 0; i < padded; ++i) {
+        for (std::size_t j = 0; j < padded; ++j, out += padded) {
+            const std::size_t row = localIndex(brickAt[0][i], brickAt[1][j], 0);
+            const std::size_t localRow = (localAt[0][i] * size + localAt[1][j]) * size;
+            for (const Run& run : runs) {
+                std::copy_n(values_[row + run.brick].data() + localRow + run.local, run.length, out + run.begin);
+            }
+        }
+    }
+}
+
+void IsosurfaceExtractor::march(std::size_t bx, std::size_t by, std::size_t bz, float iso, BrickResult& result) const
+{
+    static thread_local Scratch scratch;
+    gather(bx, by, bz, scratch.block);
+    const float* block = scratch.block.data();
+    const std::ptrdiff_t size = static_cast<std::ptrdiff_t>(brickSize_);
+    const std::ptrdiff_t padded = size + 3;
+    const std::array<std::ptrdiff_t, 3> origin{static_cast<std::ptrdiff_t>(bx) * size,
+                                               static_cast<std::ptrdiff_t>(by) * size,
+                                               static_cast<std::ptrdiff_t>(bz) * size};
+    std::array<std::ptrdiff_t, 3> owned{};
+    for (int axis = 0; axis < 3; ++axis) {
+        owned[axis] = std::min(size, static_cast<std::ptrdiff_t>(dims_[axis]) - origin[axis]);
+    }
+    const std::array<std::ptrdiff_t, 3> stride{padded * padded, padded, 1};
+    const auto gradient = [&stride](const float* p) {
+        return glm::vec3(p[stride[0]] - p[-stride[0]], p[stride[1]] - p[-stride[1]], p[1] - p[-1]);
+    };
+    const auto edgeKey = [size](std::ptrdiff_t x, std::ptrdiff_t y, std::ptrdiff_t z, int axis) {
+        return static_cast<std::uint32_t>(((x * size + y) * size + z) * 3 + axis);
+    };
+
+    // 各体素是否不低于等值，体元与边的判定只读这张表
+    const std::size_t count = scratch.block.size();
+    scratch.inside.resize(count);
+    std::uint8_t* inside = scratch.inside.data();
+    for (std::size_t i = 0; i < count; ++i) {
+        inside[i] = block[i] >= iso;
+    }
+    const auto row = [inside, padded](std::ptrdiff_t x, std::ptrdiff_t y) {
+        return inside + ((x + 1) * padded + (y + 1)) * padded + 1;
+    };
+    std::array<std::ptrdiff_t, 3> limit{};  // 本块内起点坐标低于 limit 的边（或体元）终点仍在网格内
+    for (int axis = 0; axis < 3; ++axis) {
+        limit[axis] = std::min(size, static_cast<std::ptrdiff_t>(dims_[axis]) - 1 - origin[axis]);
+    }
+
+    // 本块拥有的边：起点在块内、终点在网格内。
+    // 体元只引用穿过等值面的边，它们在本次循环中都已写入，表无需清空
+    scratch.edgeVertex.resize(static_cast<std::size_t>(size * size * size * 3));
+    for (std::ptrdiff_t x = 0; x < owned[0]; ++x) {
+        for (std::ptrdiff_t y = 0; y < owned[1]; ++y) {
+            const std::uint8_t* here = row(x, y);
+            const std::uint8_t* nextX = row(x + 1, y);
+            const std::uint8_t* nextY = row(x, y + 1);
+            const unsigned hasX = x < limit[0] ? 1u : 0u;
+            const unsigned hasY = y < limit[1] ? 2u : 0u;
+            for (std::ptrdiff_t z = 0; z < owned[2]; ++z) {
+                // 按 8 个体素一组跳过三个方向都没有变化的整段
+                if ((z & 7) == 0 && z + 8 <= owned[2]) {
+                    const std::uint64_t word = Word(here + z);
+                    if ((((word ^ Word(nextX + z)) & (hasX ? ~0ull : 0ull)) |
+                         ((word ^ Word(nextY + z)) & (hasY ? ~0ull : 0ull)) | (word ^ Word(here + z + 1))) == 0) {
+                        z += 7;
+                        continue;
+                    }
+                }
+                const unsigned hasZ = z < limit[2] ? 4u : 0u;
+                const unsigned cross = (static_cast<unsigned>(here[z] ^ nextX[z]) * hasX) |
+                                       (static_cast<unsigned>(here[z] ^ nextY[z]) * hasY) |
+                                       (static_cast<unsigned>(here[z] ^ here[z + 1]) * hasZ);
+                if (cross == 0) {
+                    continue;
+                }
+                const float* p = block + (x + 1) * stride[0] + (y + 1) * stride[1] + (z + 1);
+                const float v0 = *p;
+                const std::array<std::size_t, 3> at{static_cast<std::size_t>(origin[0] + x),
+                                                    static_cast<std::size_t>(origin[1] + y),
+                                                    static_cast<std::size_t>(origin[2] + z)};
+                const glm::vec3 center(centers_[0][at[0]], centers_[1][at[1]], centers_[2][at[2]]);
+                const glm::vec3 scale0(gradientScale_[0][at[0]], gradientScale_[1][at[1]], gradientScale_[2][at[2]]);
+                const glm::vec3 g0 = gradient(p) * scale0;
+                for (int axis = 0; axis < 3; ++axis) {
+                    if ((cross & (1u << axis)) == 0) {
+                        continue;
+                    }
+                    const float* q = p + stride[axis];
+                    const float t = (iso - v0) / (*q - v0);
+                    // 在相邻两个体素中心之间线性插值，分档不等距时同样落在世界坐标中
+                    glm::vec3 position = center;
+                    position[axis] += t * (centers_[axis][at[axis] + 1] - center[axis]);
+                    glm::vec3 scale1 = scale0;
+                    scale1[axis] = gradientScale_[axis][at[axis] + 1];
+                    const glm::vec3 g = glm::mix(g0, gradient(q) * scale1, t);
+                    const float length = glm::length(g);
+                    const std::uint32_t key = edgeKey(x, y, z, axis);
+                    const auto vertex = static_cast<std::uint32_t>(result.positions.size());
+                    scratch.edgeVertex[key] = static_cast<std::int32_t>(vertex);
+                    result.positions.push_back(position);
+                    result.normals.push_back(length > 0.0f ? g * (-1.0f / length) : glm::vec3(0.0f, 0.0f, 1.0f));
+                    if (x == 0 || y == 0 || z == 0) {
+                        result.faceEdges.emplace_back(key, vertex);
+                    }
+                }
+            }
+        }
+    }
+    if (!result.cells) {
+        return;
+    }
+
+    // 起点在本块内的体元，同样按 8 个一组跳过角点全部相同的整段。引用到相邻砖块的边记下，合并时解析
+    const MarchingTables& tables = Tables();
+    for (std::ptrdiff_t x = 0; x < limit[0]; ++x) {
+        for (std::ptrdiff_t y = 0; y < limit[1]; ++y) {
+            const std::uint8_t* r00 = row(x, y);
+            const std::uint8_t* r10 = row(x + 1, y);
+            const std::uint8_t* r01 = row(x, y + 1);
+            const std::uint8_t* r11 = row(x + 1, y + 1);
+            for (std::ptrdiff_t z = 0; z < limit[2]; ++z) {
+                if ((z & 7) == 0 && z + 8 <= limit[2]) {
+                    const std::uint64_t word = Word(r00 + z);
+                    if (((word ^ Word(r10 + z)) | (word ^ Word(r01 + z)) | (word ^ Word(r11 + z)) |
+                         (word ^ Word(r00 + z + 1)) | (word ^ Word(r10 + z + 1)) | (word ^ Word(r01 + z + 1)) |
+                         (word ^ Word(r11 + z + 1))) == 0) {
+                        z += 7;
+                        continue;
+                    }
+                }
+                const unsigned cube = r00[z] | r10[z] << 1 | r01[z] << 2 | r11[z] << 3 | r00[z + 1] << 4 |
+                                      r10[z + 1] << 5 | r01[z + 1] << 6 | r11[z + 1] << 7;
+                if (cube == 0 || cube == 255) {
+                    continue;
+                }
+                for (const std::int8_t edge : tables.triangles[cube]) {
+                    if (edge < 0) {
+                        break;
+                    }
+                    const auto& offset = tables.origins[static_cast<std::size_t>(edge)];
+                    std::ptrdiff_t p[3] = {x + offset[0], y + offset[1], z + offset[2]};
+                    std::uint32_t neighbour = 0;
+                    for (int axis = 0; axis < 3; ++axis) {
+                        if (p[axis] == size) {
+                            neighbour |= 1u << axis;
+                            p[axis] = 0;
+                        }
+                    }
+                    const std::uint32_t key = edgeKey(p[0], p[1], p[2], edge / 4);
+                    if (neighbour != 0) {
+                        result.external.push_back({static_cast<std::uint32_t>(result.indices.size()), neighbour, key});
+                        result.indices.push_back(0);
+                    } else {
+                        result.indices.push_back(static_cast<std::uint32_t>(scratch.edgeVertex[key]));
+                    }
+                }
+            }
+        }
+    }
+}
+
+Mesh IsosurfaceExtractor::extract(float iso)
+{
+    stats_ = IsosurfaceStats();
+    Mesh mesh("Isosurface");
+    mesh.baseColor = options_.color;
+    const std::size_t total = values_.size();
+    if (total == 0) {
+        return mesh;
+    }
+
+    // 体元横跨本块与前向相邻砖块：取这些砖块值范围的并判定等值面是否可能穿过
+    const auto info = [this](std::size_t bx, std::size_t by, std::size_t bz) -> const VoxelBrickInfo& {
+        return store_.brickInfo(store_.brickIndex(bx, by, bz, channel_));
+    };
+    std::vector<char> active(total, 0);
+    std::vector<char> needed(total, 0);
+    for (std::size_t bx = 0; bx < bricks_[0]; ++bx) {
+        for (std::size_t by = 0; by < bricks_[1]; ++by) {
+            for (std::size_t bz = 0; bz < bricks_[2]; ++bz) {
+                if (bx * brickSize_ + 1 >= dims_[0] || by * brickSize_ + 1 >= dims_[1] ||
+                    bz * brickSize_ + 1 >= dims_[2]) {
+                    continue;
+                }
+                float low = info(bx, by, bz).min;
+                float high = info(bx, by, bz).max;
+                for (int neighbour = 1; neighbour < 8; ++neighbour) {
+                    const std::size_t nx = bx + (neighbour & 1);
+                    const std::size_t ny = by + ((neighbour >> 1) & 1);
+                    const std::size_t nz = bz + ((neighbour >> 2) & 1);
+                    if (nx < bricks_[0] && ny < bricks_[1] && nz < bricks_[2]) {
+                        low = std::min(low, info(nx, ny, nz).min);
+                        high = std::max(high, info(nx, ny, nz).max);
+                    }
+                }
+                if (!(low < iso && iso <= high)) {
+                    continue;
+                }
+                active[localIndex(bx, by, bz)] = 1;
+                ++stats_.activeBricks;
+                // 体元引用的边可能属于前向相邻砖块
+                for (int neighbour = 0; neighbour < 8; ++neighbour) {
+                    const std::size_t nx = bx + (neighbour & 1);
+                    const std::size_t ny = by + ((neighbour >> 1) & 1);
+                    const std::size_t nz = bz + ((neighbour >> 2) & 1);
+                    if (nx < bricks_[0] && ny < bricks_[1] && nz < bricks_[2]) {
+                        needed[localIndex(nx, ny, nz)] = 1;
+                    }
+                }
+            }
+        }
+    }
+    stats_.skippedBricks = total - stats_.activeBricks;
+
+    std::vector<BrickResult> results;
+    std::vector<std::int32_t> resultOf(total, -1);
+    for (std::size_t bx = 0; bx < bricks_[0]; ++bx) {
+        for (std::size_t by = 0; by < bricks_[1]; ++by) {
+            for (std::size_t bz = 0; bz < bricks_[2]; ++bz) {
+                const std::size_t index = localIndex(bx, by, bz);
+                if (!needed[index]) {
+                    continue;
+                }
+                resultOf[index] = static_cast<std::int32_t>(results.size());
+                BrickResult& result = results.emplace_back();
+                result.bx = bx;
+                result.by = by;
+                result.bz = bz;
+                result.cells = active[index] != 0;
+            }
+        }
+    }
+    if (results.empty()) {
+        return mesh;
+    }
+
+    // 存储非线程安全：每批先在本线程解码所需砖块及其 26 邻域，提取时只读缓存。
+    // 按砖块顺序累积，新增的邻域砖块会使本批超出缓存上限时先提取已累积的部分
+    ThreadPool& pool = options_.pool ? *options_.pool : ThreadPool::shared();
+    const auto neighbours = [this](const BrickResult& result, auto&& visit) {
+        for (std::size_t nx = result.bx == 0 ? 0 : result.bx - 1; nx <= std::min(result.bx + 1, bricks_[0] - 1); ++nx) {
+            for (std::size_t ny = result.by == 0 ? 0 : result.by - 1; ny <= std::min(result.by + 1, bricks_[1] - 1); ++ny) {
+                for (std::size_t nz = result.bz == 0 ? 0 : result.bz - 1; nz <= std::min(result.bz + 1, bricks_[2] - 1);
+                     ++nz) {
+                    visit(nx, ny, nz);
+                }
+            }
+        }
+    };
+    const auto run = [&](std::size_t first, std::size_t last) {
+        pool.parallelFor(last - first, 4, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = first + begin; i < first + end; ++i) {
+                march(results[i].bx, results[i].by, results[i].bz, iso, results[i]);
+            }
+        });
+        ++stats_.passes;
+    };
+    ++pass_;
+    std::size_t first = 0;
+    std::size_t pinned = 0;
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        std::size_t fresh = 0;
+        neighbours(results[i], [&](std::size_t nx, std::size_t ny, std::size_t nz) {
+            fresh += usedInPass_[localIndex(nx, ny, nz)] != pass_;
+        });
+        if (i > first && pinned + fresh > capacity_) {
+            run(first, i);
+            first = i;
+            pinned = 0;
+            ++pass_;
+        }
+        neighbours(results[i], [&](std::size_t nx, std::size_t ny, std::size_t nz) {
+            if (usedInPass_[localIndex(nx, ny, nz)] != pass_) {
+                ++pinned;
+                touch(nx, ny, nz);
+            }
+        });
+    }
+    run(first, results.size());
+
+    std::size_t vertices = 0;
+    std::size_t indices = 0;
+    for (BrickResult& result : results) {
+        result.vertexOffset = vertices;
+        result.indexOffset = indices;
+        vertices += result.positions.size();
+        indices += result.indices.size();
+    }
+    stats_.vertices = vertices;
+    stats_.triangles = indices / 3;
+    mesh.vertices.assign(vertices, Vertex(glm::vec3(0.0f), glm::vec3(0.0f), options_.color));
+    mesh.indices.resize(indices);
+
+    // 合并：局部编号加上偏移，外部引用在相邻砖块的低侧面边表中查找
+    pool.parallelFor(results.size(), 16, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            const BrickResult& result = results[i];
+            for (std::size_t v = 0; v < result.positions.size(); ++v) {
+                Vertex& vertex = mesh.vertices[result.vertexOffset + v];
+                vertex.position = result.positions[v];
+                vertex.normal = result.normals[v];
+            }
+            unsigned int* out = mesh.indices.data() + result.indexOffset;
+            for (std::size_t k = 0; k < result.indices.size(); ++k) {
+                out[k] = static_cast<unsigned int>(result.indices[k] + result.vertexOffset);
+            }
+            for (const auto& external : result.external) {
+                const BrickResult& owner = results[static_cast<std::size_t>(
+                    resultOf[localIndex(result.bx + (external.neighbour & 1), result.by + ((external.neighbour >> 1) & 1),
+                                        result.bz + ((external.neighbour >> 2) & 1))])];
+                const auto found = std::lower_bound(owner.faceEdges.begin(), owner.faceEdges.end(),
+                                                    std::make_pair(external.edge, std::uint32_t(0)));
+                out[external.at] = static_cast<unsigned int>(owner.vertexOffset + found->second);
+            }
+        }
+    });
+    return mesh;
+}
+
+} // namespace mcnp::core
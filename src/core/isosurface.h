@@ -0,0 +1,83 @@
+#ifndef ISOSURFACE_H
+#define ISOSURFACE_H
+
+#include "thread_pool.h"
+#include "vertex_mesh.h"
+#include "voxel_store.h"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <vector>
+
+namespace mcnp::core {
+
+struct IsosurfaceOptions {
+    glm::vec3 boxMin{0.0f};  // 体素网格铺满的世界坐标盒，体素中心位于 boxMin + (i + 0.5) * 体素尺寸
+    glm::vec3 boxMax{1.0f};
+    std::array<std::vector<double>, 3> edges;  // 各轴分档边界（体素数 + 1 个，可不等距）；给出时取代 boxMin/boxMax
+    glm::vec3 color{0.9f, 0.75f, 0.3f};
+    std::size_t cacheBytes = 0;  // 解码砖块缓存的字节上限；0 表示沿用存储的 memoryBudget
+    ThreadPool* pool = nullptr;  // 为空时使用共享线程池
+};
+
+struct IsosurfaceStats {
+    std::size_t activeBricks = 0;   // 含等值面穿过的体元的砖块
+    std::size_t skippedBricks = 0;  // 值范围不含等值的砖块，整块跳过
+    std::size_t decodedBricks = 0;  // 本次新解码进缓存的砖块
+    std::size_t passes = 0;         // 所需砖块超出缓存上限时分批提取的批数
+    std::size_t vertices = 0;
+    std::size_t triangles = 0;
+};
+
+// 分砖存储上的并行 marching cubes。砖块（连同前向相邻砖块）的值上下界不含等值时整块跳过；
+// 其余砖块在线程池上各自提取，每条穿过等值面的体素边只由其起点所在砖块生成一个顶点，
+// 相邻砖块按全局边号引用，输出的网格无重复顶点且闭合（体元面上的歧义按面内角点统一分离）。
+// 解码后的砖块按 LRU 缓存在提取器中，总量不超过 cacheBytes，改变等值时命中的砖块只重算三角形；
+// 所需砖块（连同 26 邻域）放不下时按砖块顺序分批解码、提取。法线取插值后的负梯度，指向值减小的一侧。
+class IsosurfaceExtractor {
+public:
+    IsosurfaceExtractor(VoxelBrickStore& store, std::size_t channel, IsosurfaceOptions options = {});
+
+    Mesh extract(float iso);
+
+    const IsosurfaceStats& stats() const noexcept { return stats_; }
+    std::size_t cachedBricks() const noexcept { return cached_; }
+    std::size_t cachedBytes() const noexcept { return cached_ * brickSize_ * brickSize_ * brickSize_ * sizeof(float); }
+    void clearCache();
+
+private:
+    struct BrickResult;
+
+    std::size_t localIndex(std::size_t bx, std::size_t by, std::size_t bz) const {
+        return (bx * bricks_[1] + by) * bricks_[2] + bz;
+    }
+    // 解码（或在 LRU 中前移）一个砖块并标记为本批使用；只换出不属于本批的砖块
+    void touch(std::size_t bx, std::size_t by, std::size_t bz);
+    void gather(std::size_t bx, std::size_t by, std::size_t bz, std::vector<float>& block) const;
+    void march(std::size_t bx, std::size_t by, std::size_t bz, float iso, BrickResult& result) const;
+
+    VoxelBrickStore& store_;
+    std::size_t channel_;
+    IsosurfaceOptions options_;
+    std::array<std::size_t, 3> dims_;
+    std::array<std::size_t, 3> bricks_;
+    std::size_t brickSize_;
+    std::array<std::vector<float>, 3> centers_;   // 各轴体素中心的世界坐标
+    std::array<std::vector<float>, 3> gradientScale_;  // 中心差分跨距的倒数
+    std::vector<std::vector<float>> values_;  // 解码后的砖块（按通道内砖块编号），未解码为空
+    std::list<std::size_t> lru_;              // 已解码的砖块，最近使用的在前
+    std::vector<std::list<std::size_t>::iterator> lruAt_;
+    std::vector<std::uint64_t> usedInPass_;   // 砖块最后一次被哪一批使用
+    std::uint64_t pass_ = 0;
+    std::size_t capacity_ = 1;                // 缓存上限（砖块数）
+    std::size_t cached_ = 0;
+    IsosurfaceStats stats_;
+};
+
+} // namespace mcnp::core
+
+#endif // ISOSURFACE_H
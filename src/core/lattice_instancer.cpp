@@ -0,0 +1,197 @@
+#include "lattice_instancer.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+namespace mcnp::core {
+
+namespace {
+
+constexpr double kSqrt3 = 1.7320508075688772;
+constexpr int kMaxNesting = 64;
+// 无界方向用有限大值代替，保证变换后的包围盒仍可参与剔除
+constexpr double kUnboundedHalf = 1.0e6;
+
+} // namespace
+
+Frustum Frustum::fromMatrix(const glm::dmat4& m) {
+    const glm::dvec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    const glm::dvec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    const glm::dvec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    const glm::dvec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+    Frustum frustum;
+    frustum.planes[0] = row3 + row0;
+    frustum.planes[1] = row3 - row0;
+    frustum.planes[2] = row3 + row1;
+    frustum.planes[3] = row3 - row1;
+    frustum.planes[4] = row3 + row2;
+    frustum.planes[5] = row3 - row2;
+
+    // 视锥角点的包围盒，用于排除逐平面测试对细长包围盒的误判
+    const glm::dmat4 inverse = glm::inverse(m);
+    for (int corner = 0; corner < 8; ++corner) {
+        const glm::dvec4 ndc((corner & 1) ? 1.0 : -1.0, (corner & 2) ? 1.0 : -1.0, (corner & 4) ? 1.0 : -1.0, 1.0);
+        const glm::dvec4 world = inverse * ndc;
+        frustum.bounds.expand(glm::dvec3(world) / world.w);
+    }
+    return frustum;
+}
+
+bool Frustum::intersects(const Aabb& box) const {
+    if (box.empty()) {
+        return false;
+    }
+    if (!box.isFinite()) {
+        return true;
+    }
+    if (!bounds.intersects(box)) {
+        return false;
+    }
+    for (const auto& plane : planes) {
+        // 取沿平面法向最远的角点
+        const glm::dvec3 p(plane.x >= 0.0 ? box.max.x : box.min.x,
+                           plane.y >= 0.0 ? box.max.y : box.min.y,
+                           plane.z >= 0.0 ? box.max.z : box.min.z);
+        if (plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w < 0.0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct LatticeInstancer::Context {
+    const Frustum* frustum = nullptr;
+    std::vector<InstanceBatch>* batches = nullptr;
+    std::unordered_map<int, std::size_t> batchIndex;
+    InstanceStats stats;
+};
+
+InstanceStats LatticeInstancer::collect(int rootUniverse, const Frustum* frustum, std::vector<InstanceBatch>& batches) const {
+    // 保留各批次的容量，逐帧复用
+    for (auto& batch : batches) {
+        batch.transforms.clear();
+    }
+    Context context;
+    context.frustum = frustum;
+    context.batches = &batches;
+    for (std::size_t i = 0; i < batches.size(); ++i) {
+        context.batchIndex[batches[i].universe] = i;
+    }
+    visit(context, rootUniverse, glm::dmat4(1.0), 0);
+    batches.erase(std::remove_if(batches.begin(), batches.end(),
+                                 [](const InstanceBatch& batch) { return batch.transforms.empty(); }),
+                  batches.end());
+    return context.stats;
+}
+
+void LatticeInstancer::visit(Context& context, int universeId, const glm::dmat4& localToWorld, int depth) const {
+    const Universe* universe = resolver_.findUniverse(universeId);
+    if (!universe || depth > kMaxNesting) {
+        return;
+    }
+    if (!drawable_ || drawable_(universeId)) {
+        auto [it, inserted] = context.batchIndex.emplace(universeId, context.batches->size());
+        if (inserted) {
+            context.batches->push_back({universeId, {}});
+        }
+        (*context.batches)[it->second].transforms.push_back(glm::mat4(localToWorld));
+        ++context.stats.instances;
+    }
+
+    for (const auto& cell : universe->cells) {
+        if (cell.lattice) {
+            visitLattice(context, cell, localToWorld * cell.fillTransform, depth);
+        } else if (cell.fill >= 0) {
+            const glm::dmat4 childToWorld = localToWorld * cell.fillTransform;
+            if (context.frustum) {
+                // 优先用单元自身包围盒，否则用被填充宇宙的包围盒
+                const Aabb bounds = cell.bounds ? cell.bounds->transformed(localToWorld)
+                                                : resolver_.universeBounds(cell.fill).transformed(childToWorld);
+                if (!context.frustum->intersects(bounds)) {
+                    continue;
+                }
+            }
+            visit(context, cell.fill, childToWorld, depth + 1);
+        }
+    }
+}
+
+void LatticeInstancer::visitLattice(Context& context, const UniverseCell& cell, const glm::dmat4& latticeToWorld, int depth) const {
+    const LatticeSpec& lattice = *cell.lattice;
+    glm::ivec3 lower = lattice.lower;
+    glm::ivec3 upper = lattice.upper;
+
+    // 单个元素在栅格坐标系下的半尺寸；节距为 0 的方向取填充宇宙的包围盒
+    glm::dvec3 half = lattice.type == LatticeType::Rectangular
+        ? lattice.pitch * 0.5
+        : glm::dvec3(lattice.pitch.x * 0.5, lattice.pitch.x / kSqrt3, lattice.pitch.z * 0.5);
+    Aabb childBounds;
+    for (int id : lattice.fill) {
+        if (id >= 0) {
+            childBounds.expand(resolver_.universeBounds(id));
+        }
+    }
+    for (int axis = 0; axis < 3; ++axis) {
+        if (half[axis] <= 0.0) {
+            half[axis] = childBounds.isFinite()
+                ? std::max(std::abs(childBounds.min[axis]), std::abs(childBounds.max[axis]))
+                : kUnboundedHalf;
+        }
+    }
+
+    // 矩形栅格可用单元包围盒裁掉不可见的下标范围
+    if (lattice.type == LatticeType::Rectangular && cell.bounds && cell.bounds->isFinite()) {
+        const Aabb local = cell.bounds->transformed(glm::inverse(cell.fillTransform));
+        for (int axis = 0; axis < 3; ++axis) {
+            const double pitch = lattice.pitch[axis];
+            if (pitch <= 0.0) {
+                continue;
+            }
+            lower[axis] = std::max(lower[axis], static_cast<int>(std::floor(local.min[axis] / pitch + 0.5)));
+            upper[axis] = std::min(upper[axis], static_cast<int>(std::floor(local.max[axis] / pitch + 0.5)));
+        }
+    }
+
+    const int block = blockSize_;
+    for (int bk = lower.z; bk <= upper.z; bk += block) {
+        for (int bj = lower.y; bj <= upper.y; bj += block) {
+            for (int bi = lower.x; bi <= upper.x; bi += block) {
+                const glm::ivec3 first(bi, bj, bk);
+                const glm::ivec3 last = glm::min(first + glm::ivec3(block - 1), upper);
+                ++context.stats.visitedBlocks;
+                if (context.frustum) {
+                    Aabb blockBounds;
+                    for (int corner = 0; corner < 8; ++corner) {
+                        const glm::ivec3 index((corner & 1) ? last.x : first.x, (corner & 2) ? last.y : first.y,
+                                               (corner & 4) ? last.z : first.z);
+                        const glm::dvec3 center = lattice.centerOf(index);
+                        blockBounds.expand(center - half);
+                        blockBounds.expand(center + half);
+                    }
+                    if (!context.frustum->intersects(blockBounds.transformed(latticeToWorld))) {
+                        ++context.stats.culledBlocks;
+                        continue;
+                    }
+                }
+                for (int k = first.z; k <= last.z; ++k) {
+                    for (int j = first.y; j <= last.y; ++j) {
+                        for (int i = first.x; i <= last.x; ++i) {
+                            const glm::ivec3 index(i, j, k);
+                            const int universe = lattice.universeAt(index);
+                            if (universe < 0) {
+                                continue;
+                            }
+                            const glm::dmat4 elementToWorld = glm::translate(latticeToWorld, lattice.centerOf(index));
+                            visit(context, universe, elementToWorld, depth + 1);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+} // namespace mcnp::core
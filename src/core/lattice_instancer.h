@@ -0,0 +1,61 @@
+#ifndef LATTICE_INSTANCER_H
+#define LATTICE_INSTANCER_H
+
+#include "aabb.h"
+#include "universe_resolver.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace mcnp::core {
+
+// 视锥体（由 projection * view 提取的 6 个平面）
+struct Frustum {
+    glm::dvec4 planes[6];
+    Aabb bounds;
+
+    static Frustum fromMatrix(const glm::dmat4& viewProjection);
+    bool intersects(const Aabb& box) const;
+};
+
+// 某个宇宙的全部实例变换（宇宙局部坐标到世界坐标）
+struct InstanceBatch {
+    int universe = 0;
+    std::vector<glm::mat4> transforms;
+};
+
+struct InstanceStats {
+    std::size_t instances = 0;
+    std::size_t visitedBlocks = 0;
+    std::size_t culledBlocks = 0;
+};
+
+// 按 FILL/LAT 层次即时生成实例变换，而不是把每个实例展开为独立网格。
+// 栅格按 blockSize³ 个元素分块，整块包围盒在视锥外时跳过整块。
+class LatticeInstancer {
+public:
+    explicit LatticeInstancer(const UniverseResolver& resolver) : resolver_(resolver) {}
+
+    // 只为 drawable 返回真的宇宙输出实例（通常是已生成网格的宇宙）
+    void setDrawable(std::function<bool(int universe)> drawable) { drawable_ = std::move(drawable); }
+    void setBlockSize(int blockSize) { blockSize_ = blockSize > 0 ? blockSize : 1; }
+
+    // frustum 为空时不做剔除；batches 会被清空后重新填充
+    InstanceStats collect(int rootUniverse, const Frustum* frustum, std::vector<InstanceBatch>& batches) const;
+
+private:
+    struct Context;
+    void visit(Context& context, int universe, const glm::dmat4& localToWorld, int depth) const;
+    void visitLattice(Context& context, const UniverseCell& cell, const glm::dmat4& latticeToWorld, int depth) const;
+
+    const UniverseResolver& resolver_;
+    std::function<bool(int)> drawable_;
+    int blockSize_{8};
+};
+
+} // namespace mcnp::core
+
+#endif // LATTICE_INSTANCER_H
@@ -0,0 +1,255 @@
+#include "point_kernel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace mcnp::core {
+
+namespace {
+
+constexpr double kFourPi = 4.0 * 3.14159265358979323846;
+constexpr double kMinDistance2 = 1e-12;
+
+// 求解 a·t² + b·t + c <= 0 的区间，与 [t0, t1] 求交
+bool clipQuadratic(double a, double b, double c, double& t0, double& t1) {
+    if (std::abs(a) < 1e-14) {
+        if (std::abs(b) < 1e-14) {
+            return c <= 0.0;
+        }
+        const double root = -c / b;
+        if (b > 0.0) {
+            t1 = std::min(t1, root);
+        } else {
+            t0 = std::max(t0, root);
+        }
+        return t0 < t1;
+    }
+    const double disc = b * b - 4.0 * a * c;
+    if (disc <= 0.0) {
+        return false;
+    }
+    const double sq = std::sqrt(disc);
+    const double r0 = (-b - sq) / (2.0 * a);
+    const double r1 = (-b + sq) / (2.0 * a);
+    t0 = std::max(t0, r0);
+    t1 = std::min(t1, r1);
+    return t0 < t1;
+}
+
+bool clipSlab(double origin, double dir, double half, double& t0, double& t1) {
+    if (std::abs(dir) < 1e-14) {
+        return std::abs(origin) <= half;
+    }
+    double near = (-half - origin) / dir;
+    double far = (half - origin) / dir;
+    if (near > far) {
+        std::swap(near, far);
+    }
+    t0 = std::max(t0, near);
+    t1 = std::min(t1, far);
+    return t0 < t1;
+}
+
+// 局部坐标下线段 a + t·d (t∈[0,1]) 穿过基本体的参数长度
+double chordFraction(const ShieldBody& body, const glm::dvec3& a, const glm::dvec3& d) {
+    double t0 = 0.0;
+    double t1 = 1.0;
+    const glm::dvec3 h(body.halfExtents);
+    switch (body.primitive) {
+        case PrimitiveType::Box:
+            if (!clipSlab(a.x, d.x, h.x, t0, t1) || !clipSlab(a.y, d.y, h.y, t0, t1) ||
+                !clipSlab(a.z, d.z, h.z, t0, t1)) {
+                return 0.0;
+            }
+            break;
+        case PrimitiveType::Sphere:
+            if (!clipQuadratic(glm::dot(d, d), 2.0 * glm::dot(a, d), glm::dot(a, a) - h.x * h.x, t0, t1)) {
+                return 0.0;
+            }
+            break;
+        case PrimitiveType::Cylinder: {
+            const double qa = d.x * d.x + d.z * d.z;
+            const double qb = 2.0 * (a.x * d.x + a.z * d.z);
+            const double qc = a.x * a.x + a.z * a.z - h.x * h.x;
+            if (!clipQuadratic(qa, qb, qc, t0, t1) || !clipSlab(a.y, d.y, h.y, t0, t1)) {
+                return 0.0;
+            }
+            break;
+        }
+        default:
+            return 0.0;
+    }
+    return std::max(0.0, t1 - t0);
+}
+
+struct PreparedBody {
+    const ShieldBody* body;
+    glm::dmat4 worldToLocal;
+};
+
+std::vector<PreparedBody> prepareBodies(const std::vector<ShieldBody>& bodies) {
+    std::vector<PreparedBody> prepared;
+    prepared.reserve(bodies.size());
+    for (const auto& body : bodies) {
+        if (body.material < 0) {
+            continue;
+        }
+        prepared.push_back({&body, glm::inverse(glm::dmat4(body.localToWorld))});
+    }
+    return prepared;
+}
+
+double traceSegment(const std::vector<PreparedBody>& bodies,
+                    const std::vector<ShieldMaterial>& materials,
+                    const glm::dvec3& from, const glm::dvec3& to,
+                    std::vector<double>& perMaterial) {
+    perMaterial.assign(materials.size(), 0.0);
+    const double worldLength = glm::length(to - from);
+    double total = 0.0;
+    for (const auto& prepared : bodies) {
+        const auto material = static_cast<std::size_t>(prepared.body->material);
+        if (material >= materials.size()) {
+            continue;
+        }
+        const glm::dvec3 a = glm::dvec3(prepared.worldToLocal * glm::dvec4(from, 1.0));
+        const glm::dvec3 b = glm::dvec3(prepared.worldToLocal * glm::dvec4(to, 1.0));
+        // 仿射变换保持线段参数比例，局部参数长度即世界弦长占比
+        const double fraction = chordFraction(*prepared.body, a, b - a);
+        if (fraction <= 0.0) {
+            continue;
+        }
+        const double mfp = fraction * worldLength * materials[material].linearAttenuation();
+        perMaterial[material] += mfp;
+        total += mfp;
+    }
+    return total;
+}
+
+} // namespace
+
+double TaylorBuildup::evaluate(double mfp) const {
+    return A * std::exp(-alpha1 * mfp) + (1.0 - A) * std::exp(-alpha2 * mfp);
+}
+
+bool ShieldBody::containsLocal(const glm::vec3& p) const {
+    switch (primitive) {
+        case PrimitiveType::Box:
+            return std::abs(p.x) <= halfExtents.x && std::abs(p.y) <= halfExtents.y &&
+                   std::abs(p.z) <= halfExtents.z;
+        case PrimitiveType::Sphere:
+            return glm::dot(p, p) <= halfExtents.x * halfExtents.x;
+        case PrimitiveType::Cylinder:
+            return p.x * p.x + p.z * p.z <= halfExtents.x * halfExtents.x &&
+                   std::abs(p.y) <= halfExtents.y;
+        default:
+            return false;
+    }
+}
+
+int PointKernelEngine::addMaterial(const ShieldMaterial& material) {
+    materials_.push_back(material);
+    return static_cast<int>(materials_.size()) - 1;
+}
+
+double PointKernelEngine::opticalThickness(const glm::vec3& from, const glm::vec3& to,
+                                           std::vector<double>& perMaterial) const {
+    return traceSegment(prepareBodies(bodies_), materials_, glm::dvec3(from), glm::dvec3(to), perMaterial);
+}
+
+std::vector<PointKernelEngine::SubSource> PointKernelEngine::buildSubSources() const {
+    std::vector<SubSource> subSources;
+    if (!source_.volumetric) {
+        subSources.push_back({source_.info.position, 1.0});
+        return subSources;
+    }
+
+    // 在基本体的局部包围盒内取 n³ 个子体积中心，保留落在体内的部分
+    const ShieldBody& volume = source_.volume;
+    const int n = std::max(1, source_.subdivisions);
+    glm::vec3 half = volume.halfExtents;
+    if (volume.primitive == PrimitiveType::Sphere) {
+        half = glm::vec3(volume.halfExtents.x);
+    } else if (volume.primitive == PrimitiveType::Cylinder) {
+        half = glm::vec3(volume.halfExtents.x, volume.halfExtents.y, volume.halfExtents.x);
+    }
+    const glm::vec3 step = (half * 2.0f) / static_cast<float>(n);
+    subSources.reserve(static_cast<std::size_t>(n) * n * n);
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            for (int k = 0; k < n; ++k) {
+                const glm::vec3 local = -half + step * glm::vec3(i + 0.5f, j + 0.5f, k + 0.5f);
+                if (!volume.containsLocal(local)) {
+                    continue;
+                }
+                subSources.push_back({glm::vec3(volume.localToWorld * glm::vec4(local, 1.0f)), 1.0});
+            }
+        }
+    }
+    if (subSources.empty()) {
+        subSources.push_back({glm::vec3(volume.localToWorld[3]), 1.0});
+    }
+    const double weight = 1.0 / static_cast<double>(subSources.size());
+    for (auto& sub : subSources) {
+        sub.weight = weight;
+    }
+    return subSources;
+}
+
+std::vector<DetectorResult> PointKernelEngine::evaluate(ThreadPool& pool) const {
+    std::vector<DetectorResult> results(detectors_.size());
+    for (std::size_t d = 0; d < detectors_.size(); ++d) {
+        results[d].detector = detectors_[d];
+    }
+    if (detectors_.empty()) {
+        return results;
+    }
+
+    const std::vector<SubSource> subSources = buildSubSources();
+    const std::vector<PreparedBody> bodies = prepareBodies(bodies_);
+    const std::size_t detectorCount = detectors_.size();
+    const std::size_t grain = 64;
+    const std::size_t chunks = (subSources.size() + grain - 1) / grain;
+
+    // 每块独立累加 (uncollided, buildup) 两个分量
+    std::vector<double> partial(chunks * detectorCount * 2, 0.0);
+    pool.parallelFor(subSources.size(), grain, [&](std::size_t begin, std::size_t end) {
+        const std::size_t chunk = begin / grain;
+        double* out = partial.data() + chunk * detectorCount * 2;
+        std::vector<double> perMaterial;
+        for (std::size_t s = begin; s < end; ++s) {
+            const glm::dvec3 origin(subSources[s].position);
+            for (std::size_t d = 0; d < detectorCount; ++d) {
+                const glm::dvec3 target(detectors_[d].position);
+                const glm::dvec3 delta = target - origin;
+                const double r2 = std::max(glm::dot(delta, delta), kMinDistance2);
+                const double mfp = traceSegment(bodies, materials_, origin, target, perMaterial);
+
+                // 积累因子取光学厚度贡献最大的材料（主导材料近似）
+                double buildup = 1.0;
+                if (mfp > 0.0) {
+                    const auto dominant = std::max_element(perMaterial.begin(), perMaterial.end());
+                    buildup = materials_[static_cast<std::size_t>(dominant - perMaterial.begin())].buildup.evaluate(mfp);
+                }
+                const double uncollided = subSources[s].weight * std::exp(-mfp) / (kFourPi * r2);
+                out[d * 2] += uncollided;
+                out[d * 2 + 1] += uncollided * buildup;
+            }
+        }
+    });
+
+    const double strength = source_.info.strength;
+    for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+        const double* in = partial.data() + chunk * detectorCount * 2;
+        for (std::size_t d = 0; d < detectorCount; ++d) {
+            results[d].uncollidedFlux += strength * in[d * 2];
+            results[d].flux += strength * in[d * 2 + 1];
+        }
+    }
+    for (auto& result : results) {
+        result.dose = result.flux * result.detector.responseFactor;
+    }
+    return results;
+}
+
+} // namespace mcnp::core
@@ -0,0 +1,100 @@
+#ifndef POINT_KERNEL_H
+#define POINT_KERNEL_H
+
+#include "geometry_model.h"
+#include "thread_pool.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace mcnp::core {
+
+// Taylor 形式积累因子: B(μr) = A·exp(-α1·μr) + (1-A)·exp(-α2·μr)
+// 默认参数 (A=1, α=0) 即不考虑积累 (B=1)
+struct TaylorBuildup {
+    double A = 1.0;
+    double alpha1 = 0.0;
+    double alpha2 = 0.0;
+
+    double evaluate(double mfp) const;
+};
+
+struct ShieldMaterial {
+    MaterialInfo info;
+    TaylorBuildup buildup;
+
+    // 线衰减系数 μ (1/cm)
+    double linearAttenuation() const { return info.massAttenuation * info.density; }
+};
+
+// 屏蔽体：基本体在局部坐标系下由半尺寸描述，worldToLocal 为世界到局部的仿射变换
+//  Box      : |x|<=h.x, |y|<=h.y, |z|<=h.z
+//  Sphere   : |p| <= h.x
+//  Cylinder : 轴沿局部 y，x²+z² <= h.x², |y| <= h.y
+struct ShieldBody {
+    std::string label;
+    PrimitiveType primitive = PrimitiveType::Box;
+    glm::vec3 halfExtents{0.5f};
+    glm::mat4 localToWorld{1.0f};
+    int material = -1;  // 材料表下标，<0 表示真空
+
+    bool containsLocal(const glm::vec3& p) const;
+};
+
+// 点源或体源；体源按 subdivisions³ 网格划分子体积并行积分
+struct PointKernelSource {
+    SourceInfo info;
+    bool volumetric = false;
+    ShieldBody volume;  // 仅 volumetric 时使用其形状与变换
+    int subdivisions = 8;
+};
+
+struct DetectorResult {
+    DetectorInfo detector;
+    double uncollidedFlux = 0.0;  // 未碰撞通量
+    double flux = 0.0;            // 含积累因子的通量
+    double dose = 0.0;            // flux × responseFactor
+};
+
+class PointKernelEngine {
+public:
+    int addMaterial(const ShieldMaterial& material);
+    void clearMaterials() { materials_.clear(); }
+    const std::vector<ShieldMaterial>& materials() const noexcept { return materials_; }
+
+    void setBodies(std::vector<ShieldBody> bodies) { bodies_ = std::move(bodies); }
+    std::vector<ShieldBody>& bodies() noexcept { return bodies_; }
+    const std::vector<ShieldBody>& bodies() const noexcept { return bodies_; }
+
+    void setSource(const PointKernelSource& source) { source_ = source; }
+    const PointKernelSource& source() const noexcept { return source_; }
+
+    void setDetectors(std::vector<DetectorInfo> detectors) { detectors_ = std::move(detectors); }
+    const std::vector<DetectorInfo>& detectors() const noexcept { return detectors_; }
+
+    // 沿线段 from->to 按材料累计光学厚度（单位：平均自由程），返回总光学厚度
+    double opticalThickness(const glm::vec3& from, const glm::vec3& to,
+                            std::vector<double>& perMaterial) const;
+
+    // 计算全部探测器的响应；子体积在线程池中并行积分，按块顺序归约保证结果确定
+    std::vector<DetectorResult> evaluate(ThreadPool& pool = ThreadPool::shared()) const;
+
+private:
+    struct SubSource {
+        glm::vec3 position;
+        double weight;
+    };
+    std::vector<SubSource> buildSubSources() const;
+
+    std::vector<ShieldMaterial> materials_;
+    std::vector<ShieldBody> bodies_;
+    PointKernelSource source_;
+    std::vector<DetectorInfo> detectors_;
+};
+
+} // namespace mcnp::core
+
+#endif // POINT_KERNEL_H
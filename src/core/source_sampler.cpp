@@ -0,0 +1,518 @@
+#include "source_sampler.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <sstream>
+
+namespace mcnp::core {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kDefaultEnergy = 14.0;  // MCNP 默认 ERG=14 MeV
+
+std::uint32_t mulhilo(std::uint32_t a, std::uint32_t b, std::uint32_t& hi) noexcept {
+    const std::uint64_t product = static_cast<std::uint64_t>(a) * b;
+    hi = static_cast<std::uint32_t>(product >> 32);
+    return static_cast<std::uint32_t>(product);
+}
+
+// 构造与 axis 正交的单位基
+void orthonormalBasis(const glm::dvec3& axis, glm::dvec3& u, glm::dvec3& v) {
+    const glm::dvec3 helper = std::abs(axis.x) < 0.9 ? glm::dvec3(1.0, 0.0, 0.0) : glm::dvec3(0.0, 1.0, 0.0);
+    u = glm::normalize(glm::cross(axis, helper));
+    v = glm::cross(axis, u);
+}
+
+std::string lower(std::string_view text) {
+    std::string out(text);
+    std::transform(out.begin(), out.end(), out.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return out;
+}
+
+bool parseNumber(const std::string& token, double& value) {
+    try {
+        std::size_t consumed = 0;
+        value = std::stod(token, &consumed);
+        return consumed == token.size();
+    } catch (...) {
+        return false;
+    }
+}
+
+// 把累积/未归一化的概率转换为归一化 CDF
+bool buildCdf(std::vector<double> weights, std::vector<double>& cdf) {
+    double total = 0.0;
+    cdf.resize(weights.size());
+    for (std::size_t i = 0; i < weights.size(); ++i) {
+        if (weights[i] < 0.0) {
+            return false;
+        }
+        total += weights[i];
+        cdf[i] = total;
+    }
+    if (total <= 0.0) {
+        return false;
+    }
+    for (auto& value : cdf) {
+        value /= total;
+    }
+    cdf.back() = 1.0;
+    return true;
+}
+
+std::size_t pickBin(const std::vector<double>& cdf, double u) {
+    const auto it = std::upper_bound(cdf.begin(), cdf.end(), u);
+    return std::min<std::size_t>(static_cast<std::size_t>(it - cdf.begin()), cdf.size() - 1);
+}
+
+double sampleMaxwell(double a, RandomStream& stream) {
+    const double c = std::cos(0.5 * kPi * stream.next());
+    return -a * (std::log(stream.next()) + std::log(stream.next()) * c * c);
+}
+
+struct RawDistribution {
+    std::string siOption = "h";
+    std::vector<double> si;
+    std::string spOption = "d";
+    std::vector<double> sp;
+    int builtin = 0;
+    bool hasSi = false;
+    bool hasSp = false;
+};
+
+} // namespace
+
+std::array<std::uint32_t, 4> CounterRng::block(std::uint64_t counter, std::uint32_t draw) const noexcept {
+    std::array<std::uint32_t, 4> c{static_cast<std::uint32_t>(counter), static_cast<std::uint32_t>(counter >> 32), draw, 0u};
+    std::uint32_t k0 = key_[0];
+    std::uint32_t k1 = key_[1];
+    for (int round = 0; round < 10; ++round) {
+        std::uint32_t hi0 = 0;
+        std::uint32_t hi1 = 0;
+        const std::uint32_t lo0 = mulhilo(0xD2511F53u, c[0], hi0);
+        const std::uint32_t lo1 = mulhilo(0xCD9E8D57u, c[2], hi1);
+        c = {hi1 ^ c[1] ^ k0, lo1, hi0 ^ c[3] ^ k1, lo0};
+        k0 += 0x9E3779B9u;
+        k1 += 0xBB67AE85u;
+    }
+    return c;
+}
+
+double SourceDistribution::sample(RandomStream& stream) const {
+    switch (kind) {
+        case Kind::Histogram: {
+            const std::size_t bin = pickBin(cdf, stream.next());
+            const double lo = values[bin];
+            const double hi = values[bin + 1];
+            return lo + (hi - lo) * stream.next();
+        }
+        case Kind::Discrete:
+            return values[pickBin(cdf, stream.next())];
+        case Kind::Linear: {
+            // cdf 按线段累积；段内密度线性变化，解析反演
+            const std::size_t seg = pickBin(cdf, stream.next());
+            const double d0 = densities[seg];
+            const double d1 = densities[seg + 1];
+            const double u = stream.next();
+            double t = u;
+            if (std::abs(d1 - d0) > 1e-12 * std::max(d0, d1)) {
+                t = (-d0 + std::sqrt(d0 * d0 + u * (d1 * d1 - d0 * d0))) / (d1 - d0);
+            }
+            return values[seg] + t * (values[seg + 1] - values[seg]);
+        }
+        case Kind::PowerLaw: {
+            const double lo = values.size() >= 2 ? values[0] : 0.0;
+            const double hi = values.size() >= 2 ? values[1] : 1.0;
+            if (a == 0.0) {
+                return lo + (hi - lo) * stream.next();
+            }
+            if (lo >= 0.0) {
+                if (std::abs(a + 1.0) < 1e-12) {
+                    return lo * std::pow(hi / lo, stream.next());
+                }
+                const double e = a + 1.0;
+                const double l = std::pow(lo, e);
+                return std::pow(l + stream.next() * (std::pow(hi, e) - l), 1.0 / e);
+            }
+            // 区间跨越 0：对 |x| 抽样并随机取号，落在区间外则重抽
+            const double m = std::max(std::abs(lo), std::abs(hi));
+            for (;;) {
+                const double mag = m * std::pow(stream.next(), 1.0 / (a + 1.0));
+                const double x = stream.next() < 0.5 ? -mag : mag;
+                if (x >= lo && x <= hi) {
+                    return x;
+                }
+            }
+        }
+        case Kind::Maxwell: {
+            const double cutoff = values.empty() ? 0.0 : values.back();
+            for (;;) {
+                const double e = sampleMaxwell(a, stream);
+                if (cutoff <= 0.0 || e <= cutoff) {
+                    return e;
+                }
+            }
+        }
+        case Kind::Watt: {
+            // Everett–Cashwell 拒绝抽样
+            const double k = 1.0 + a * b / 8.0;
+            const double l = a * (k + std::sqrt(k * k - 1.0));
+            const double m = l / a - 1.0;
+            const double cutoff = values.empty() ? 0.0 : values.back();
+            for (;;) {
+                const double x = -std::log(stream.next());
+                const double y = -std::log(stream.next());
+                const double t = y - m * (x + 1.0);
+                if (t * t <= b * l * x) {
+                    const double e = l * x;
+                    if (cutoff <= 0.0 || e <= cutoff) {
+                        return e;
+                    }
+                }
+            }
+        }
+    }
+    return 0.0;
+}
+
+void SourceSamples::resize(std::size_t count) {
+    x.resize(count);
+    y.resize(count);
+    z.resize(count);
+    u.resize(count);
+    v.resize(count);
+    w.resize(count);
+    energy.resize(count);
+}
+
+SourceParseResult parseSourceCards(std::string_view text) {
+    SourceParseResult result;
+    SourceDefinition& def = result.definition;
+    std::map<int, RawDistribution> raw;
+    std::map<std::string, int> references;  // 变量名 -> 引用的 Dn
+
+    std::istringstream stream{std::string(text)};
+    std::string line;
+    std::size_t lineNumber = 0;
+    while (std::getline(stream, line)) {
+        ++lineNumber;
+        const auto dollar = line.find('$');
+        if (dollar != std::string::npos) {
+            line.erase(dollar);
+        }
+        std::string normalized;
+        for (char ch : line) {
+            if (ch == '=') {
+                normalized += " = ";
+            } else {
+                normalized += ch;
+            }
+        }
+        std::istringstream tokensStream(normalized);
+        std::vector<std::string> tokens;
+        for (std::string token; tokensStream >> token;) {
+            tokens.push_back(lower(token));
+        }
+        if (tokens.empty() || tokens[0] == "c") {
+            continue;
+        }
+        const std::string where = "line " + std::to_string(lineNumber) + ": ";
+        const std::string& name = tokens[0];
+
+        if (name == "sdef") {
+            std::vector<std::size_t> keys;
+            for (std::size_t i = 1; i + 1 < tokens.size(); ++i) {
+                if (tokens[i + 1] == "=") {
+                    keys.push_back(i);
+                }
+            }
+            for (std::size_t k = 0; k < keys.size(); ++k) {
+                const std::string& key = tokens[keys[k]];
+                const std::size_t end = k + 1 < keys.size() ? keys[k + 1] : tokens.size();
+                std::vector<std::string> values(tokens.begin() + static_cast<std::ptrdiff_t>(keys[k] + 2),
+                                                tokens.begin() + static_cast<std::ptrdiff_t>(end));
+                if (values.empty()) {
+                    result.errors.push_back(where + "missing value for " + key);
+                    continue;
+                }
+                if (key == "par") {
+                    const std::string& p = values[0];
+                    def.particle = p == "n" ? 1 : p == "p" ? 2 : p == "e" ? 3 : std::atoi(p.c_str());
+                    continue;
+                }
+                SourceVariable variable;
+                if (values[0].size() > 1 && values[0][0] == 'd') {
+                    variable.distribution = std::atoi(values[0].c_str() + 1);
+                    references[key] = variable.distribution;
+                } else {
+                    for (const auto& value : values) {
+                        double number = 0.0;
+                        if (!parseNumber(value, number)) {
+                            result.errors.push_back(where + "invalid number '" + value + "' for " + key);
+                            break;
+                        }
+                        variable.fixed.push_back(number);
+                    }
+                }
+                auto vector3 = [&](std::optional<glm::dvec3>& target) {
+                    if (variable.fixed.size() != 3) {
+                        result.errors.push_back(where + key + " requires three values");
+                        return;
+                    }
+                    target = glm::dvec3(variable.fixed[0], variable.fixed[1], variable.fixed[2]);
+                };
+                if (key == "pos") {
+                    std::optional<glm::dvec3> pos;
+                    vector3(pos);
+                    if (pos) {
+                        def.pos = *pos;
+                    }
+                } else if (key == "axs") {
+                    vector3(def.axs);
+                } else if (key == "vec") {
+                    vector3(def.vec);
+                } else if (key == "rad") {
+                    def.rad = variable;
+                } else if (key == "ext") {
+                    def.ext = variable;
+                } else if (key == "erg") {
+                    def.erg = variable;
+                } else if (key == "dir") {
+                    def.dir = variable;
+                }
+            }
+            continue;
+        }
+
+        const bool isSi = name.rfind("si", 0) == 0;
+        const bool isSp = name.rfind("sp", 0) == 0;
+        if (!isSi && !isSp) {
+            continue;
+        }
+        const int index = std::atoi(name.c_str() + 2);
+        if (index <= 0) {
+            result.errors.push_back(where + "invalid distribution number in " + name);
+            continue;
+        }
+        RawDistribution& dist = raw[index];
+        std::size_t first = 1;
+        if (first < tokens.size() && std::isalpha(static_cast<unsigned char>(tokens[first][0]))) {
+            (isSi ? dist.siOption : dist.spOption) = tokens[first];
+            ++first;
+        }
+        std::vector<double> numbers;
+        for (std::size_t i = first; i < tokens.size(); ++i) {
+            double number = 0.0;
+            if (!parseNumber(tokens[i], number)) {
+                result.errors.push_back(where + "invalid number '" + tokens[i] + "' in " + name);
+                continue;
+            }
+            numbers.push_back(number);
+        }
+        if (isSi) {
+            dist.si = std::move(numbers);
+            dist.hasSi = true;
+        } else {
+            dist.hasSp = true;
+            if (!numbers.empty() && numbers[0] < 0.0 && first == 1) {
+                dist.builtin = static_cast<int>(numbers[0]);
+                numbers.erase(numbers.begin());
+            }
+            dist.sp = std::move(numbers);
+        }
+    }
+
+    for (auto& [index, dist] : raw) {
+        SourceDistribution out;
+        const std::string where = "D" + std::to_string(index) + ": ";
+        bool isRad = references.count("rad") && references["rad"] == index;
+        if (!dist.hasSp && isRad) {
+            // RAD 缺省 SP -21：球 a=2，圆柱 a=1
+            dist.builtin = -21;
+            dist.sp = {def.axs ? 1.0 : 2.0};
+        }
+        if (dist.builtin != 0) {
+            const double p0 = dist.sp.size() > 0 ? dist.sp[0] : 0.0;
+            const double p1 = dist.sp.size() > 1 ? dist.sp[1] : 0.0;
+            out.values = dist.si;
+            if (dist.builtin == -21) {
+                out.kind = SourceDistribution::Kind::PowerLaw;
+                out.a = dist.sp.empty() ? 1.0 : p0;
+                if (out.values.size() < 2) {
+                    out.values = {0.0, out.values.empty() ? 1.0 : out.values.back()};
+                }
+            } else if (dist.builtin == -2) {
+                out.kind = SourceDistribution::Kind::Maxwell;
+                out.a = dist.sp.empty() ? 1.2895 : p0;
+            } else if (dist.builtin == -3) {
+                out.kind = SourceDistribution::Kind::Watt;
+                out.a = dist.sp.size() > 0 ? p0 : 0.965;
+                out.b = dist.sp.size() > 1 ? p1 : 2.29;
+            } else {
+                result.errors.push_back(where + "unsupported built-in function " + std::to_string(dist.builtin));
+                continue;
+            }
+            def.distributions[index] = std::move(out);
+            continue;
+        }
+
+        if (dist.si.empty()) {
+            result.errors.push_back(where + "missing SI data");
+            continue;
+        }
+        std::vector<double> weights = dist.sp;
+        if (dist.spOption == "c" && !weights.empty()) {
+            for (std::size_t i = weights.size() - 1; i > 0; --i) {
+                weights[i] -= weights[i - 1];
+            }
+        }
+        if (dist.siOption == "l" || dist.siOption == "a") {
+            out.kind = dist.siOption == "l" ? SourceDistribution::Kind::Discrete : SourceDistribution::Kind::Linear;
+            out.values = dist.si;
+            if (weights.empty()) {
+                weights.assign(out.values.size(), 1.0);
+            }
+            if (weights.size() != out.values.size()) {
+                result.errors.push_back(where + "SI and SP entry counts differ");
+                continue;
+            }
+            if (out.kind == SourceDistribution::Kind::Linear) {
+                if (out.values.size() < 2) {
+                    result.errors.push_back(where + "SI A needs at least two points");
+                    continue;
+                }
+                out.densities = weights;
+                std::vector<double> areas(out.values.size() - 1);
+                for (std::size_t i = 0; i + 1 < out.values.size(); ++i) {
+                    areas[i] = 0.5 * (weights[i] + weights[i + 1]) * (out.values[i + 1] - out.values[i]);
+                }
+                weights = std::move(areas);
+            }
+        } else {
+            out.kind = SourceDistribution::Kind::Histogram;
+            out.values = dist.si;
+            if (out.values.size() < 2) {
+                result.errors.push_back(where + "SI H needs at least two bin boundaries");
+                continue;
+            }
+            const std::size_t bins = out.values.size() - 1;
+            if (weights.empty()) {
+                // 缺省按箱宽均匀分布
+                for (std::size_t i = 0; i < bins; ++i) {
+                    weights.push_back(out.values[i + 1] - out.values[i]);
+                }
+            } else if (weights.size() == bins + 1) {
+                weights.erase(weights.begin());
+            }
+            if (weights.size() != bins) {
+                result.errors.push_back(where + "SI and SP entry counts differ");
+                continue;
+            }
+        }
+        if (!buildCdf(weights, out.cdf)) {
+            result.errors.push_back(where + "probabilities must be non-negative with positive sum");
+            continue;
+        }
+        def.distributions[index] = std::move(out);
+    }
+
+    for (const auto& [key, index] : references) {
+        if (!def.distributions.count(index)) {
+            result.errors.push_back(key + " references undefined distribution D" + std::to_string(index));
+        }
+    }
+    return result;
+}
+
+SourceSampler::SourceSampler(SourceDefinition definition)
+    : definition_(std::move(definition)) {
+    if (definition_.axs && glm::length(*definition_.axs) > 0.0) {
+        axis_ = glm::normalize(*definition_.axs);
+    }
+    orthonormalBasis(axis_, basisU_, basisV_);
+    if (definition_.vec && glm::length(*definition_.vec) > 0.0) {
+        reference_ = glm::normalize(*definition_.vec);
+    }
+    orthonormalBasis(reference_, refU_, refV_);
+}
+
+double SourceSampler::sampleVariable(const SourceVariable& variable, RandomStream& stream, double fallback) const {
+    if (variable.distribution > 0) {
+        const auto it = definition_.distributions.find(variable.distribution);
+        return it == definition_.distributions.end() ? fallback : it->second.sample(stream);
+    }
+    return variable.fixed.empty() ? fallback : variable.fixed.front();
+}
+
+SourceSamples SourceSampler::sample(std::size_t count, std::uint64_t seed, std::uint64_t first, ThreadPool& pool) const {
+    SourceSamples samples;
+    samples.resize(count);
+    const CounterRng rng(seed);
+    const SourceDefinition& def = definition_;
+    const bool cylindrical = def.axs.has_value();
+
+    pool.parallelFor(count, 1u << 15, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            RandomStream stream(rng, first + i);
+
+            glm::dvec3 position = def.pos;
+            if (cylindrical) {
+                const double r = sampleVariable(def.rad, stream, 0.0);
+                const double h = sampleVariable(def.ext, stream, 0.0);
+                const double phi = 2.0 * kPi * stream.next();
+                position += h * axis_ + r * (std::cos(phi) * basisU_ + std::sin(phi) * basisV_);
+            } else if (def.rad.isSet()) {
+                const double r = sampleVariable(def.rad, stream, 0.0);
+                const double mu = 2.0 * stream.next() - 1.0;
+                const double phi = 2.0 * kPi * stream.next();
+                const double s = std::sqrt(std::max(0.0, 1.0 - mu * mu));
+                position += r * glm::dvec3(s * std::cos(phi), s * std::sin(phi), mu);
+            }
+
+            // 方向：给定 VEC 时 DIR 为与 VEC 的夹角余弦，否则各向同性
+            const double mu = def.vec ? std::clamp(sampleVariable(def.dir, stream, 2.0 * stream.next() - 1.0), -1.0, 1.0)
+                                      : 2.0 * stream.next() - 1.0;
+            const double phi = 2.0 * kPi * stream.next();
+            const double s = std::sqrt(std::max(0.0, 1.0 - mu * mu));
+            const glm::dvec3 direction = def.vec
+                ? mu * reference_ + s * (std::cos(phi) * refU_ + std::sin(phi) * refV_)
+                : glm::dvec3(s * std::cos(phi), s * std::sin(phi), mu);
+
+            samples.x[i] = static_cast<float>(position.x);
+            samples.y[i] = static_cast<float>(position.y);
+            samples.z[i] = static_cast<float>(position.z);
+            samples.u[i] = static_cast<float>(direction.x);
+            samples.v[i] = static_cast<float>(direction.y);
+            samples.w[i] = static_cast<float>(direction.z);
+            samples.energy[i] = static_cast<float>(sampleVariable(def.erg, stream, kDefaultEnergy));
+        }
+    });
+    return samples;
+}
+
+std::vector<float> energyHistogram(const std::vector<float>& energy, std::size_t bins,
+                                   float minEnergy, float maxEnergy, bool logarithmic) {
+    std::vector<float> histogram(bins, 0.0f);
+    if (bins == 0 || !(maxEnergy > minEnergy) || (logarithmic && minEnergy <= 0.0f)) {
+        return histogram;
+    }
+    const double lo = logarithmic ? std::log(static_cast<double>(minEnergy)) : minEnergy;
+    const double hi = logarithmic ? std::log(static_cast<double>(maxEnergy)) : maxEnergy;
+    const double scale = static_cast<double>(bins) / (hi - lo);
+    for (float e : energy) {
+        if (logarithmic && e <= 0.0f) {
+            continue;
+        }
+        const double x = logarithmic ? std::log(static_cast<double>(e)) : e;
+        const double position = (x - lo) * scale;
+        if (position < 0.0 || position >= static_cast<double>(bins)) {
+            continue;
+        }
+        histogram[static_cast<std::size_t>(position)] += 1.0f;
+    }
+    return histogram;
+}
+
+} // namespace mcnp::core
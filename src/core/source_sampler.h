@@ -0,0 +1,144 @@
+#ifndef SOURCE_SAMPLER_H
+#define SOURCE_SAMPLER_H
+
+#include "thread_pool.h"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mcnp::core {
+
+// 计数器型随机数发生器 (Philox4x32-10)：
+// 第 i 个粒子的随机序列只由 (seed, i) 决定，与线程划分无关，结果可复现
+class CounterRng {
+public:
+    explicit CounterRng(std::uint64_t seed = 0) noexcept : key_{static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)} {}
+
+    std::array<std::uint32_t, 4> block(std::uint64_t counter, std::uint32_t draw) const noexcept;
+
+    // 取 (0, 1) 开区间均匀数
+    static double toUnit(std::uint32_t bits) noexcept { return (static_cast<double>(bits) + 0.5) * (1.0 / 4294967296.0); }
+
+private:
+    std::array<std::uint32_t, 2> key_;
+};
+
+// 单个粒子的随机数流，按需生成 Philox 块
+class RandomStream {
+public:
+    RandomStream(const CounterRng& rng, std::uint64_t particle) noexcept : rng_(rng), particle_(particle) {}
+
+    double next() noexcept
+    {
+        if (used_ == 4) {
+            block_ = rng_.block(particle_, draw_++);
+            used_ = 0;
+        }
+        return CounterRng::toUnit(block_[used_++]);
+    }
+
+private:
+    const CounterRng& rng_;
+    std::uint64_t particle_;
+    std::uint32_t draw_{0};
+    std::array<std::uint32_t, 4> block_{};
+    int used_{4};
+};
+
+// SIn/SPn 分布
+struct SourceDistribution {
+    enum class Kind {
+        Histogram,  // SI H：分箱边界，SP 为各箱概率
+        Discrete,   // SI L：离散值
+        Linear,     // SI A：逐点线性密度
+        PowerLaw,   // SP -21 a：p(x) ∝ |x|^a
+        Maxwell,    // SP -2 a：Maxwell 裂变谱
+        Watt        // SP -3 a b：Watt 裂变谱
+    };
+
+    Kind kind = Kind::Histogram;
+    std::vector<double> values;  // SI 数据
+    std::vector<double> cdf;     // 归一化累积概率（表格型分布）
+    std::vector<double> densities;  // SI A 各点密度
+    double a = 0.0;
+    double b = 0.0;
+
+    double sample(RandomStream& stream) const;
+};
+
+// SDEF 变量：固定值或引用 Dn 分布
+struct SourceVariable {
+    std::vector<double> fixed;
+    int distribution = 0;  // >0 表示 Dn
+
+    bool isSet() const noexcept { return distribution > 0 || !fixed.empty(); }
+};
+
+// SDEF 源定义（点源、球壳 POS/RAD、圆柱 POS/AXS/RAD/EXT）
+struct SourceDefinition {
+    glm::dvec3 pos{0.0};
+    std::optional<glm::dvec3> axs;
+    std::optional<glm::dvec3> vec;
+    SourceVariable rad;
+    SourceVariable ext;
+    SourceVariable erg;
+    SourceVariable dir;
+    int particle = 1;
+    std::map<int, SourceDistribution> distributions;
+};
+
+struct SourceParseResult {
+    SourceDefinition definition;
+    std::vector<std::string> errors;
+};
+
+// 解析 SDEF/SIn/SPn 卡片文本（每行一张卡）
+SourceParseResult parseSourceCards(std::string_view text);
+
+// 抽样结果采用 SoA 布局，便于向量化处理与直接上传 GPU
+struct SourceSamples {
+    std::vector<float> x, y, z;
+    std::vector<float> u, v, w;
+    std::vector<float> energy;
+
+    std::size_t size() const noexcept { return energy.size(); }
+    void resize(std::size_t count);
+};
+
+class SourceSampler {
+public:
+    explicit SourceSampler(SourceDefinition definition);
+
+    // 抽取 [first, first + count) 号粒子；同一 seed 与粒子编号得到相同结果
+    SourceSamples sample(std::size_t count, std::uint64_t seed, std::uint64_t first = 0,
+                         ThreadPool& pool = ThreadPool::shared()) const;
+
+    const SourceDefinition& definition() const noexcept { return definition_; }
+
+private:
+    double sampleVariable(const SourceVariable& variable, RandomStream& stream, double fallback) const;
+
+    SourceDefinition definition_;
+    glm::dvec3 axis_{0.0, 0.0, 1.0};
+    glm::dvec3 basisU_{1.0, 0.0, 0.0};
+    glm::dvec3 basisV_{0.0, 1.0, 0.0};
+    glm::dvec3 reference_{0.0, 0.0, 1.0};
+    glm::dvec3 refU_{1.0, 0.0, 0.0};
+    glm::dvec3 refV_{0.0, 1.0, 0.0};
+};
+
+// 能谱直方图；logarithmic 为真时按对数能量分箱
+std::vector<float> energyHistogram(const std::vector<float>& energy, std::size_t bins,
+                                   float minEnergy, float maxEnergy, bool logarithmic = false);
+
+} // namespace mcnp::core
+
+#endif // SOURCE_SAMPLER_H
@@ -0,0 +1,784 @@
+#include "surface_table.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <limits>
+
+namespace mcnp::core {
+
+namespace {
+
+// 对称矩阵 + 一次项 + 常数项，便于做坐标变换
+struct QuadricParts {
+    glm::dmat3 a{0.0};
+    glm::dvec3 b{0.0};
+    double c = 0.0;
+};
+
+QuadricParts to_parts(const Quadric& q) {
+    QuadricParts parts;
+    parts.a[0][0] = q.c[SurfaceTable::A];
+    parts.a[1][1] = q.c[SurfaceTable::B];
+    parts.a[2][2] = q.c[SurfaceTable::C];
+    parts.a[0][1] = parts.a[1][0] = 0.5 * q.c[SurfaceTable::D];
+    parts.a[1][2] = parts.a[2][1] = 0.5 * q.c[SurfaceTable::E];
+    parts.a[0][2] = parts.a[2][0] = 0.5 * q.c[SurfaceTable::F];
+    parts.b = {q.c[SurfaceTable::G], q.c[SurfaceTable::H], q.c[SurfaceTable::J]};
+    parts.c = q.c[SurfaceTable::K];
+    return parts;
+}
+
+Quadric from_parts(const QuadricParts& parts) {
+    Quadric q;
+    q.c[SurfaceTable::A] = parts.a[0][0];
+    q.c[SurfaceTable::B] = parts.a[1][1];
+    q.c[SurfaceTable::C] = parts.a[2][2];
+    q.c[SurfaceTable::D] = parts.a[0][1] + parts.a[1][0];
+    q.c[SurfaceTable::E] = parts.a[1][2] + parts.a[2][1];
+    q.c[SurfaceTable::F] = parts.a[0][2] + parts.a[2][0];
+    q.c[SurfaceTable::G] = parts.b.x;
+    q.c[SurfaceTable::H] = parts.b.y;
+    q.c[SurfaceTable::J] = parts.b.z;
+    q.c[SurfaceTable::K] = parts.c;
+    return q;
+}
+
+// I - scale · n nᵀ
+glm::dmat3 axial_matrix(const glm::dvec3& n, double scale) {
+    glm::dmat3 m(1.0);
+    for (int col = 0; col < 3; ++col) {
+        for (int row = 0; row < 3; ++row) {
+            m[col][row] -= scale * n[row] * n[col];
+        }
+    }
+    return m;
+}
+
+// (x - p)ᵀ M (x - p) + constant
+Quadric centered(const glm::dmat3& m, const glm::dvec3& p, double constant) {
+    QuadricParts parts;
+    parts.a = m;
+    parts.b = -2.0 * (m * p);
+    parts.c = glm::dot(p, m * p) + constant;
+    return from_parts(parts);
+}
+
+std::string lower(std::string_view text) {
+    std::string out(text);
+    std::transform(out.begin(), out.end(), out.begin(),
+                   [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+    return out;
+}
+
+bool fail(std::string* error, std::string message) {
+    if (error) {
+        *error = std::move(message);
+    }
+    return false;
+}
+
+glm::dvec3 vec(std::span<const double> v, std::size_t at) {
+    return {v[at], v[at + 1], v[at + 2]};
+}
+
+glm::dvec3 axis_vector(char axis) {
+    return {axis == 'x' ? 1.0 : 0.0, axis == 'y' ? 1.0 : 0.0, axis == 'z' ? 1.0 : 0.0};
+}
+
+// 三点确定平面；原点位于负侧，过原点时 (0,0,∞)、(0,∞,0)、(∞,0,0) 依次为正侧
+Quadric plane_through_points(const glm::dvec3& p1, const glm::dvec3& p2, const glm::dvec3& p3) {
+    glm::dvec3 n = glm::cross(p2 - p1, p3 - p1);
+    double d = glm::dot(n, p1);
+    const bool flip = d != 0.0 ? d < 0.0 : (n.z != 0.0 ? n.z < 0.0 : (n.y != 0.0 ? n.y < 0.0 : n.x < 0.0));
+    if (flip) {
+        n = -n;
+        d = -d;
+    }
+    return Quadric::plane(n, d);
+}
+
+// 宏体的一个面：facet 号从 1 开始
+struct Facet {
+    SurfaceType type;
+    Quadric quadric;
+};
+
+Quadric outward_plane(const glm::dvec3& normal, const glm::dvec3& point) {
+    const glm::dvec3 n = glm::normalize(normal);
+    return Quadric::plane(n, glm::dot(n, point));
+}
+
+// 区间算术
+struct Interval {
+    double low = 0.0;
+    double high = 0.0;
+};
+
+Interval operator+(Interval a, Interval b) {
+    return {a.low + b.low, a.high + b.high};
+}
+
+Interval operator*(Interval a, Interval b) {
+    const double p[] = {a.low * b.low, a.low * b.high, a.high * b.low, a.high * b.high};
+    return {std::min({p[0], p[1], p[2], p[3]}), std::max({p[0], p[1], p[2], p[3]})};
+}
+
+Interval operator*(double k, Interval a) {
+    return k >= 0.0 ? Interval{k * a.low, k * a.high} : Interval{k * a.high, k * a.low};
+}
+
+Interval square(Interval a) {
+    if (a.low >= 0.0) {
+        return {a.low * a.low, a.high * a.high};
+    }
+    if (a.high <= 0.0) {
+        return {a.high * a.high, a.low * a.low};
+    }
+    return {0.0, std::max(a.low * a.low, a.high * a.high)};
+}
+
+// 对称 3×3 矩阵的 Jacobi 特征分解：a = V diag(values) Vᵀ，V 的列为特征向量
+void symmetric_eigen(glm::dmat3 a, glm::dvec3& values, glm::dmat3& vectors) {
+    vectors = glm::dmat3(1.0);
+    for (int sweep = 0; sweep < 32; ++sweep) {
+        const double off = a[1][0] * a[1][0] + a[2][0] * a[2][0] + a[2][1] * a[2][1];
+        if (off < 1e-30) {
+            break;
+        }
+        for (int p = 0; p < 2; ++p) {
+            for (int q = p + 1; q < 3; ++q) {
+                if (a[q][p] == 0.0) {
+                    continue;
+                }
+                const double theta = (a[q][q] - a[p][p]) / (2.0 * a[q][p]);
+                const double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+                const double c = 1.0 / std::sqrt(t * t + 1.0);
+                const double s = t * c;
+                glm::dmat3 rotation(1.0);
+                rotation[p][p] = c;
+                rotation[q][q] = c;
+                rotation[q][p] = s;
+                rotation[p][q] = -s;
+                a = glm::transpose(rotation) * a * rotation;
+                vectors = vectors * rotation;
+            }
+        }
+    }
+    values = {a[0][0], a[1][1], a[2][2]};
+}
+
+} // namespace
+
+std::optional<SurfaceTransform> SurfaceTransform::fromCard(std::span<const double> values, bool degrees,
+                                                           std::string* error) {
+    const std::size_t rest = values.size() < 3 ? 0 : values.size() - 3;
+    const bool hasM = rest == 1 || rest == 7 || rest == 10;
+    const std::size_t rotationCount = hasM ? rest - 1 : rest;
+    if (values.size() < 3 || (rotationCount != 0 && rotationCount != 6 && rotationCount != 9)) {
+        fail(error, "TR card needs 3, 9 or 12 values (optionally followed by m), got " +
+                        std::to_string(values.size()));
+        return std::nullopt;
+    }
+
+    SurfaceTransform transform;
+    auto cosine = [&](std::size_t i) { return degrees ? std::cos(glm::radians(values[3 + i])) : values[3 + i]; };
+    if (rotationCount >= 6) {
+        glm::dvec3 x(cosine(0), cosine(1), cosine(2));
+        glm::dvec3 y(cosine(3), cosine(4), cosine(5));
+        if (glm::length(x) == 0.0 || glm::length(y) == 0.0) {
+            fail(error, "TR card has a zero-length axis");
+            return std::nullopt;
+        }
+        x = glm::normalize(x);
+        y = glm::normalize(y - glm::dot(y, x) * x);
+        glm::dvec3 z = glm::cross(x, y);
+        if (rotationCount == 9) {
+            // 第三轴须与前两轴构成右手正交系（允许少量舍入误差）
+            const glm::dvec3 given(cosine(6), cosine(7), cosine(8));
+            if (glm::length(given) == 0.0 || glm::dot(glm::normalize(given), z) < 0.999) {
+                fail(error, "TR card rotation is not a right-handed orthonormal basis");
+                return std::nullopt;
+            }
+        }
+        transform.rotation = glm::dmat3(x, y, z);
+    }
+
+    const glm::dvec3 displacement = vec(values, 0);
+    const bool inverse = hasM && values.back() == -1.0;
+    // m = -1 时位移给出的是主坐标原点在辅助坐标系中的位置
+    transform.origin = inverse ? -(transform.rotation * displacement) : displacement;
+    return transform;
+}
+
+double Quadric::evaluate(const glm::dvec3& p) const noexcept {
+    return c[0] * p.x * p.x + c[1] * p.y * p.y + c[2] * p.z * p.z + c[3] * p.x * p.y + c[4] * p.y * p.z +
+           c[5] * p.z * p.x + c[6] * p.x + c[7] * p.y + c[8] * p.z + c[9];
+}
+
+Quadric Quadric::transformed(const SurfaceTransform& transform) const {
+    // 局部 x' = Rᵀ(x - o)：A = R A' Rᵀ，b = R b' - 2 A o，c = oᵀ A o - (R b')·o + c'
+    const QuadricParts local = to_parts(*this);
+    const glm::dmat3& r = transform.rotation;
+    const glm::dvec3& o = transform.origin;
+    QuadricParts world;
+    world.a = r * local.a * glm::transpose(r);
+    const glm::dvec3 rb = r * local.b;
+    world.b = rb - 2.0 * (world.a * o);
+    world.c = glm::dot(o, world.a * o) - glm::dot(rb, o) + local.c;
+    return from_parts(world);
+}
+
+Quadric Quadric::plane(const glm::dvec3& normal, double offset) {
+    Quadric q;
+    q.c[SurfaceTable::G] = normal.x;
+    q.c[SurfaceTable::H] = normal.y;
+    q.c[SurfaceTable::J] = normal.z;
+    q.c[SurfaceTable::K] = -offset;
+    return q;
+}
+
+Quadric Quadric::sphere(const glm::dvec3& center, double radius) {
+    return centered(glm::dmat3(1.0), center, -radius * radius);
+}
+
+Quadric Quadric::cylinder(const glm::dvec3& point, const glm::dvec3& axis, double radius) {
+    return centered(axial_matrix(glm::normalize(axis), 1.0), point, -radius * radius);
+}
+
+Quadric Quadric::cone(const glm::dvec3& apex, const glm::dvec3& axis, double tangentSquared) {
+    return centered(axial_matrix(glm::normalize(axis), 1.0 + tangentSquared), apex, 0.0);
+}
+
+std::size_t SurfaceTable::addRow(int id, int facet, SurfaceType type, const Quadric& quadric,
+                                 BoundaryKind boundary) {
+    const std::size_t row = ids_.size();
+    ids_.push_back(id);
+    facets_.push_back(static_cast<std::int16_t>(facet));
+    types_.push_back(type);
+    boundaries_.push_back(boundary);
+    for (int i = 0; i < CoefficientCount; ++i) {
+        columns_[i].push_back(quadric.c[i]);
+    }
+    index_[(static_cast<std::uint64_t>(static_cast<std::uint32_t>(id)) << 16) | static_cast<std::uint16_t>(facet)] =
+        row;
+    return row;
+}
+
+bool SurfaceTable::add(int id, std::string_view mnemonic, std::span<const double> values,
+                       const SurfaceTransform* transform, BoundaryKind boundary, std::string* error) {
+    const std::string name = lower(mnemonic);
+    const std::string where = "surface " + std::to_string(id) + ": ";
+    auto expect = [&](std::initializer_list<std::size_t> counts) {
+        if (std::find(counts.begin(), counts.end(), values.size()) != counts.end()) {
+            return true;
+        }
+        return fail(error, where + std::string(mnemonic) + " has wrong number of entries (" +
+                               std::to_string(values.size()) + ")");
+    };
+    auto place = [&](const Quadric& q) { return transform ? q.transformed(*transform) : q; };
+    auto place_point = [&](const glm::dvec3& p) { return transform ? transform->apply(p) : p; };
+    auto place_axis = [&](const glm::dvec3& a) { return transform ? transform->rotation * a : a; };
+
+    if (name == "rpp") {
+        return expect({6}) && addMacroBody(id, MacroBodyType::Rpp, values, transform, boundary, error);
+    }
+    if (name == "box") {
+        return expect({12}) && addMacroBody(id, MacroBodyType::Box, values, transform, boundary, error);
+    }
+    if (name == "sph") {
+        return expect({4}) && addMacroBody(id, MacroBodyType::Sph, values, transform, boundary, error);
+    }
+    if (name == "rcc") {
+        return expect({7}) && addMacroBody(id, MacroBodyType::Rcc, values, transform, boundary, error);
+    }
+    if (name == "rhp" || name == "hex") {
+        return expect({9, 15}) && addMacroBody(id, MacroBodyType::Rhp, values, transform, boundary, error);
+    }
+    if (name == "trc") {
+        return expect({8}) && addMacroBody(id, MacroBodyType::Trc, values, transform, boundary, error);
+    }
+
+    if (name == "p") {
+        if (!expect({4, 9})) {
+            return false;
+        }
+        const Quadric q = values.size() == 4 ? Quadric::plane(vec(values, 0), values[3])
+                                             : plane_through_points(vec(values, 0), vec(values, 3), vec(values, 6));
+        addRow(id, 0, SurfaceType::Plane, place(q), boundary);
+        return true;
+    }
+    if (name.size() == 2 && name[0] == 'p' && name[1] >= 'x' && name[1] <= 'z') {
+        if (!expect({1})) {
+            return false;
+        }
+        addRow(id, 0, SurfaceType::Plane, place(Quadric::plane(axis_vector(name[1]), values[0])), boundary);
+        return true;
+    }
+    if (name == "so") {
+        if (!expect({1})) {
+            return false;
+        }
+        addRow(id, 0, SurfaceType::Sphere, place(Quadric::sphere(glm::dvec3(0.0), values[0])), boundary);
+        return true;
+    }
+    if (name == "s") {
+        if (!expect({4})) {
+            return false;
+        }
+        addRow(id, 0, SurfaceType::Sphere, place(Quadric::sphere(vec(values, 0), values[3])), boundary);
+        return true;
+    }
+    if (name.size() == 2 && name[0] == 's' && name[1] >= 'x' && name[1] <= 'z') {
+        if (!expect({2})) {
+            return false;
+        }
+        const glm::dvec3 center = axis_vector(name[1]) * values[0];
+        addRow(id, 0, SurfaceType::Sphere, place(Quadric::sphere(center, values[1])), boundary);
+        return true;
+    }
+    if ((name.size() == 2 && name[0] == 'c') || (name.size() == 3 && name[0] == 'c' && name[1] == '/')) {
+        const char axis = name.back();
+        if (axis < 'x' || axis > 'z') {
+            return fail(error, where + "unknown surface mnemonic " + std::string(mnemonic));
+        }
+        const bool offAxis = name.size() == 3;
+        if (!expect({offAxis ? 3u : 1u})) {
+            return false;
+        }
+        glm::dvec3 point(0.0);
+        if (offAxis) {
+            // C/X: y z R；C/Y: x z R；C/Z: x y R
+            const int first = axis == 'x' ? 1 : 0;
+            const int second = axis == 'z' ? 1 : 2;
+            point[first] = values[0];
+            point[second] = values[1];
+        }
+        const double radius = values.back();
+        addRow(id, 0, SurfaceType::Cylinder, place(Quadric::cylinder(point, axis_vector(axis), radius)), boundary);
+        return true;
+    }
+    if ((name.size() == 2 && name[0] == 'k') || (name.size() == 3 && name[0] == 'k' && name[1] == '/')) {
+        const char axis = name.back();
+        if (axis < 'x' || axis > 'z') {
+            return fail(error, where + "unknown surface mnemonic " + std::string(mnemonic));
+        }
+        const bool offAxis = name.size() == 3;
+        const std::size_t base = offAxis ? 4 : 2;
+        if (!expect({base, base + 1})) {
+            return false;
+        }
+        const glm::dvec3 direction = axis_vector(axis);
+        const glm::dvec3 apex = offAxis ? vec(values, 0) : direction * values[0];
+        const double tangentSquared = values[base - 1];
+        const std::size_t row =
+            addRow(id, 0, SurfaceType::Cone, place(Quadric::cone(apex, direction, tangentSquared)), boundary);
+        if (values.size() == base + 1 && values.back() != 0.0) {
+            sheets_[row] = {place_point(apex), place_axis(direction * (values.back() > 0.0 ? 1.0 : -1.0))};
+        }
+        return true;
+    }
+    if (name == "sq") {
+        if (!expect({10})) {
+            return false;
+        }
+        const double a = values[0], b = values[1], c = values[2];
+        const double d = values[3], e = values[4], f = values[5], g = values[6];
+        const glm::dvec3 m = vec(values, 7);
+        Quadric q;
+        q.c[A] = a;
+        q.c[B] = b;
+        q.c[C] = c;
+        q.c[G] = 2.0 * (d - a * m.x);
+        q.c[H] = 2.0 * (e - b * m.y);
+        q.c[J] = 2.0 * (f - c * m.z);
+        q.c[K] = a * m.x * m.x + b * m.y * m.y + c * m.z * m.z - 2.0 * (d * m.x + e * m.y + f * m.z) + g;
+        addRow(id, 0, SurfaceType::Quadric, place(q), boundary);
+        return true;
+    }
+    if (name == "gq") {
+        if (!expect({10})) {
+            return false;
+        }
+        Quadric q;
+        std::copy(values.begin(), values.end(), q.c.begin());
+        addRow(id, 0, SurfaceType::Quadric, place(q), boundary);
+        return true;
+    }
+    if (name.size() == 2 && name[0] == 't' && name[1] >= 'x' && name[1] <= 'z') {
+        if (!expect({6})) {
+            return false;
+        }
+        if (values[4] <= 0.0 || values[5] <= 0.0) {
+            return fail(error, where + "torus semi-axes must be positive");
+        }
+        const std::size_t row = addRow(id, 0, SurfaceType::Torus, Quadric{}, boundary);
+        tori_[row] = {place_point(vec(values, 0)), place_axis(axis_vector(name[1])), values[3], values[4], values[5]};
+        return true;
+    }
+    return fail(error, where + "unknown surface mnemonic " + std::string(mnemonic));
+}
+
+bool SurfaceTable::addMacroBody(int id, MacroBodyType type, std::span<const double> values,
+                                const SurfaceTransform* transform, BoundaryKind boundary, std::string* error) {
+    std::vector<Facet> facets;
+    switch (type) {
+        case MacroBodyType::Rpp: {
+            for (int axis = 0; axis < 3; ++axis) {
+                const double low = values[2 * axis];
+                const double high = values[2 * axis + 1];
+                if (low > high) {
+                    return fail(error, "surface " + std::to_string(id) + ": RPP minimum exceeds maximum");
+                }
+                glm::dvec3 n(0.0);
+                n[axis] = 1.0;
+                facets.push_back({SurfaceType::Plane, Quadric::plane(n, high)});
+                facets.push_back({SurfaceType::Plane, Quadric::plane(-n, -low)});
+            }
+            break;
+        }
+        case MacroBodyType::Box: {
+            const glm::dvec3 corner = vec(values, 0);
+            for (int i = 0; i < 3; ++i) {
+                const glm::dvec3 edge = vec(values, 3 + 3 * i);
+                facets.push_back({SurfaceType::Plane, outward_plane(edge, corner + edge)});
+                facets.push_back({SurfaceType::Plane, outward_plane(-edge, corner)});
+            }
+            break;
+        }
+        case MacroBodyType::Sph:
+            facets.push_back({SurfaceType::Sphere, Quadric::sphere(vec(values, 0), values[3])});
+            break;
+        case MacroBodyType::Rcc:
+        case MacroBodyType::Trc: {
+            const glm::dvec3 base = vec(values, 0);
+            const glm::dvec3 height = vec(values, 3);
+            const double r1 = values[6];
+            const double r2 = type == MacroBodyType::Trc ? values[7] : r1;
+            const double length = glm::length(height);
+            if (length == 0.0) {
+                return fail(error, "surface " + std::to_string(id) + ": zero-length axis");
+            }
+            if (r1 == r2) {
+                facets.push_back({SurfaceType::Cylinder, Quadric::cylinder(base, height, r1)});
+            } else {
+                // 顶点在半径为 0 处；两端平面截去另一叶
+                const glm::dvec3 apex = base + height * (r1 / (r1 - r2));
+                const double tangent = (r1 - r2) / length;
+                facets.push_back({SurfaceType::Cone, Quadric::cone(apex, height, tangent * tangent)});
+            }
+            facets.push_back({SurfaceType::Plane, outward_plane(height, base + height)});
+            facets.push_back({SurfaceType::Plane, outward_plane(-height, base)});
+            break;
+        }
+        case MacroBodyType::Rhp: {
+            const glm::dvec3 base = vec(values, 0);
+            const glm::dvec3 height = vec(values, 3);
+            const glm::dvec3 r = vec(values, 6);
+            glm::dvec3 s;
+            glm::dvec3 t;
+            if (values.size() == 15) {
+                s = vec(values, 9);
+                t = vec(values, 12);
+            } else {
+                // 正六边形：r 绕轴旋转 60° 与 120°
+                const glm::dvec3 n = glm::normalize(height);
+                const glm::dvec3 side = glm::cross(n, r);
+                s = 0.5 * r + std::sqrt(3.0) * 0.5 * side;
+                t = -0.5 * r + std::sqrt(3.0) * 0.5 * side;
+            }
+            for (const glm::dvec3& v : {r, s, t}) {
+                facets.push_back({SurfaceType::Plane, outward_plane(v, base + v)});
+                facets.push_back({SurfaceType::Plane, outward_plane(-v, base - v)});
+            }
+            facets.push_back({SurfaceType::Plane, outward_plane(height, base + height)});
+            facets.push_back({SurfaceType::Plane, outward_plane(-height, base)});
+            break;
+        }
+    }
+
+    MacroBody body;
+    body.id = id;
+    body.type = type;
+    body.firstRow = static_cast<std::uint32_t>(ids_.size());
+    body.facetCount = static_cast<std::uint32_t>(facets.size());
+    for (std::size_t i = 0; i < facets.size(); ++i) {
+        const Quadric q = transform ? facets[i].quadric.transformed(*transform) : facets[i].quadric;
+        addRow(id, static_cast<int>(i + 1), facets[i].type, q, boundary);
+    }
+    macroIndex_[id] = macroBodies_.size();
+    macroBodies_.push_back(body);
+    return true;
+}
+
+void SurfaceTable::removeRow(std::size_t row) {
+    index_.erase((static_cast<std::uint64_t>(static_cast<std::uint32_t>(ids_[row])) << 16) |
+                 static_cast<std::uint16_t>(facets_[row]));
+    sheets_.erase(row);
+    tori_.erase(row);
+    ids_[row] = 0;
+}
+
+bool SurfaceTable::remove(int id) {
+    periodic_.erase(id);
+    const auto body = macroIndex_.find(id);
+    if (body != macroIndex_.end()) {
+        MacroBody& removed = macroBodies_[body->second];
+        for (std::uint32_t i = 0; i < removed.facetCount; ++i) {
+            removeRow(removed.firstRow + i);
+        }
+        removed.id = 0;
+        removed.facetCount = 0;
+        macroIndex_.erase(body);
+        return true;
+    }
+    const auto row = find(id);
+    if (!row) {
+        return false;
+    }
+    removeRow(*row);
+    return true;
+}
+
+void SurfaceTable::setPeriodicPartner(int id, int partner) {
+    periodic_[id] = partner;
+    for (std::size_t row = 0; row < ids_.size(); ++row) {
+        if (ids_[row] == id) {
+            boundaries_[row] = BoundaryKind::Periodic;
+        }
+    }
+}
+
+std::optional<int> SurfaceTable::periodicPartner(int id) const {
+    const auto it = periodic_.find(id);
+    if (it == periodic_.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+void SurfaceTable::reserve(std::size_t rows) {
+    ids_.reserve(rows);
+    facets_.reserve(rows);
+    types_.reserve(rows);
+    boundaries_.reserve(rows);
+    for (auto& column : columns_) {
+        column.reserve(rows);
+    }
+    index_.reserve(rows);
+}
+
+void SurfaceTable::clear() {
+    *this = SurfaceTable{};
+}
+
+std::optional<std::size_t> SurfaceTable::find(int id, int facet) const {
+    const auto it =
+        index_.find((static_cast<std::uint64_t>(static_cast<std::uint32_t>(id)) << 16) | static_cast<std::uint16_t>(facet));
+    if (it == index_.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+Quadric SurfaceTable::quadric(std::size_t row) const {
+    Quadric q;
+    for (int i = 0; i < CoefficientCount; ++i) {
+        q.c[i] = columns_[i][row];
+    }
+    return q;
+}
+
+double SurfaceTable::evaluate(std::size_t row, const glm::dvec3& p) const {
+    const SurfaceType type = types_[row];
+    if (type == SurfaceType::Torus) {
+        const Torus& torus = tori_.at(row);
+        const glm::dvec3 u = p - torus.center;
+        const double axial = glm::dot(u, torus.axis);
+        const double radial = std::sqrt(std::max(0.0, glm::dot(u, u) - axial * axial)) - torus.major;
+        return axial * axial / (torus.axial * torus.axial) + radial * radial / (torus.radial * torus.radial) - 1.0;
+    }
+    const double value = columns_[A][row] * p.x * p.x + columns_[B][row] * p.y * p.y + columns_[C][row] * p.z * p.z +
+                         columns_[D][row] * p.x * p.y + columns_[E][row] * p.y * p.z + columns_[F][row] * p.z * p.x +
+                         columns_[G][row] * p.x + columns_[H][row] * p.y + columns_[J][row] * p.z + columns_[K][row];
+    if (type == SurfaceType::Cone) {
+        const auto sheet = sheets_.find(row);
+        if (sheet != sheets_.end()) {
+            // 另一叶一侧视为锥外
+            return std::max(value, -glm::dot(p - sheet->second.apex, sheet->second.axis));
+        }
+    }
+    return value;
+}
+
+void SurfaceTable::evaluate(std::size_t row, std::span<const glm::dvec3> points, std::span<double> out) const {
+    const SurfaceType type = types_[row];
+    if (type == SurfaceType::Torus || (type == SurfaceType::Cone && sheets_.count(row) != 0)) {
+        for (std::size_t i = 0; i < points.size(); ++i) {
+            out[i] = evaluate(row, points[i]);
+        }
+        return;
+    }
+    const Quadric q = quadric(row);
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        out[i] = q.evaluate(points[i]);
+    }
+}
+
+const SurfaceTable::ConeSheet* SurfaceTable::coneSheet(std::size_t row) const {
+    const auto it = sheets_.find(row);
+    return it == sheets_.end() ? nullptr : &it->second;
+}
+
+const SurfaceTable::Torus* SurfaceTable::torus(std::size_t row) const {
+    const auto it = tori_.find(row);
+    return it == tori_.end() ? nullptr : &it->second;
+}
+
+SurfaceTable::ValueRange SurfaceTable::range(std::size_t row, const Aabb& box) const {
+    constexpr double inf = std::numeric_limits<double>::infinity();
+    if (!box.isFinite()) {
+        return {-inf, inf};
+    }
+    const Interval x{box.min.x, box.max.x};
+    const Interval y{box.min.y, box.max.y};
+    const Interval z{box.min.z, box.max.z};
+    const SurfaceType type = types_[row];
+    if (type == SurfaceType::Torus) {
+        const Torus& torus = tori_.at(row);
+        const Interval u[] = {Interval{x.low - torus.center.x, x.high - torus.center.x},
+                              Interval{y.low - torus.center.y, y.high - torus.center.y},
+                              Interval{z.low - torus.center.z, z.high - torus.center.z}};
+        const Interval axial = torus.axis.x * u[0] + torus.axis.y * u[1] + torus.axis.z * u[2];
+        const Interval length = square(u[0]) + square(u[1]) + square(u[2]);
+        const Interval axial2 = square(axial);
+        const Interval radial{std::sqrt(std::max(0.0, length.low - axial2.high)) - torus.major,
+                              std::sqrt(std::max(0.0, length.high - axial2.low)) - torus.major};
+        const Interval f = (1.0 / (torus.axial * torus.axial)) * axial2 +
+                           (1.0 / (torus.radial * torus.radial)) * square(radial);
+        return {f.low - 1.0, f.high - 1.0};
+    }
+    const auto coefficient = [&](Coefficient c) { return columns_[c][row]; };
+    Interval f = coefficient(A) * square(x) + coefficient(B) * square(y) + coefficient(C) * square(z) +
+                 coefficient(D) * (x * y) + coefficient(E) * (y * z) + coefficient(F) * (z * x) +
+                 coefficient(G) * x + coefficient(H) * y + coefficient(J) * z;
+    f = f + Interval{coefficient(K), coefficient(K)};
+    if (type == SurfaceType::Cone) {
+        const auto sheet = sheets_.find(row);
+        if (sheet != sheets_.end()) {
+            const glm::dvec3& apex = sheet->second.apex;
+            const glm::dvec3& axis = sheet->second.axis;
+            const Interval side = -axis.x * Interval{x.low - apex.x, x.high - apex.x} +
+                                  -axis.y * Interval{y.low - apex.y, y.high - apex.y} +
+                                  -axis.z * Interval{z.low - apex.z, z.high - apex.z};
+            return {std::max(f.low, side.low), std::max(f.high, side.high)};
+        }
+    }
+    return {f.low, f.high};
+}
+
+Aabb SurfaceTable::bounds(std::size_t row, bool negative) const {
+    constexpr double lowest = std::numeric_limits<double>::lowest();
+    constexpr double highest = std::numeric_limits<double>::max();
+    Aabb box = Aabb::infinite();
+    if (types_[row] == SurfaceType::Torus) {
+        if (!negative) {
+            return box;
+        }
+        // 环面的支撑函数：轴向分量 a_i、径向分量 w 上椭圆截面的最远点
+        const Torus& torus = tori_.at(row);
+        for (int i = 0; i < 3; ++i) {
+            const double a = torus.axis[i];
+            const double w = std::sqrt(std::max(0.0, 1.0 - a * a));
+            const double half = torus.major * w + std::sqrt(torus.axial * torus.axial * a * a +
+                                                            torus.radial * torus.radial * w * w);
+            box.min[i] = torus.center[i] - half;
+            box.max[i] = torus.center[i] + half;
+        }
+        return box;
+    }
+
+    Quadric q = quadric(row);
+    if (!negative) {
+        for (double& c : q.c) {
+            c = -c;
+        }
+    }
+    const QuadricParts parts = to_parts(q);
+    if (types_[row] == SurfaceType::Plane) {
+        // b·x + c < 0：只有法向与某坐标轴平行时在该轴上有界
+        int axis = -1;
+        for (int i = 0; i < 3; ++i) {
+            if (parts.b[i] != 0.0) {
+                axis = axis == -1 ? i : 3;
+            }
+        }
+        if (axis >= 0 && axis < 3) {
+            const double limit = -parts.c / parts.b[axis];
+            (parts.b[axis] > 0.0 ? box.max : box.min)[axis] = limit;
+        }
+        return box;
+    }
+
+    // (x - x0)ᵀA(x - x0) < r；A 须半正定，否则（双曲面、锥、椭球外部）无界
+    glm::dvec3 values;
+    glm::dmat3 vectors;
+    symmetric_eigen(parts.a, values, vectors);
+    const double scale = std::max({std::abs(values.x), std::abs(values.y), std::abs(values.z)});
+    const double tolerance = 1e-12 * scale;
+    if (scale == 0.0 || values.x < -tolerance || values.y < -tolerance || values.z < -tolerance) {
+        return box;
+    }
+    glm::dvec3 center(0.0);
+    double nullLinear = 0.0;
+    for (int k = 0; k < 3; ++k) {
+        const double projection = glm::dot(vectors[k], parts.b);
+        if (values[k] > tolerance) {
+            center -= 0.5 * projection / values[k] * vectors[k];
+        } else {
+            nullLinear += projection * projection;
+        }
+    }
+    if (nullLinear > 1e-18 * std::max(1.0, glm::dot(parts.b, parts.b))) {
+        return box;  // 抛物面
+    }
+    const double r = -(parts.c + 0.5 * glm::dot(parts.b, center));
+    if (r <= 0.0) {
+        return Aabb{};
+    }
+    for (int i = 0; i < 3; ++i) {
+        double inverse = 0.0;
+        double null = 0.0;
+        for (int k = 0; k < 3; ++k) {
+            const double v = vectors[k][i];
+            if (values[k] > tolerance) {
+                inverse += v * v / values[k];
+            } else {
+                null += v * v;
+            }
+        }
+        if (null > 1e-12) {
+            continue;  // 该轴与柱体母线不正交
+        }
+        const double half = std::sqrt(r * inverse);
+        box.min[i] = std::max(lowest, center[i] - half);
+        box.max[i] = std::min(highest, center[i] + half);
+    }
+    return box;
+}
+
+const SurfaceTable::MacroBody* SurfaceTable::findMacroBody(int id) const {
+    const auto it = macroIndex_.find(id);
+    return it == macroIndex_.end() ? nullptr : &macroBodies_[it->second];
+}
+
+bool SurfaceTable::insideMacroBody(const MacroBody& body, const glm::dvec3& p) const {
+    for (std::uint32_t i = 0; i < body.facetCount; ++i) {
+        if (evaluate(body.firstRow + i, p) >= 0.0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace mcnp::core
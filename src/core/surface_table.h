@@ -0,0 +1,163 @@
+#ifndef SURFACE_TABLE_H
+#define SURFACE_TABLE_H
+
+#include "aabb.h"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace mcnp::core {
+
+// 规范化后的曲面类型；所有二次曲面统一为 GQ 形式的十个系数
+enum class SurfaceType : std::uint8_t {
+    Plane,
+    Sphere,
+    Cylinder,
+    Cone,
+    Quadric,  // SQ/GQ 一般二次曲面
+    Torus     // TX/TY/TZ：四次曲面，参数另存
+};
+
+enum class BoundaryKind : std::uint8_t {
+    None,
+    Reflecting,  // *n
+    White,       // +n
+    Periodic     // n -m
+};
+
+enum class MacroBodyType : std::uint8_t {
+    Rpp,
+    Box,
+    Sph,
+    Rcc,
+    Rhp,
+    Trc
+};
+
+// TRn 变换：主坐标 x = origin + rotation · x'，rotation 的列为辅助坐标轴在主坐标系中的方向
+struct SurfaceTransform {
+    glm::dmat3 rotation{1.0};
+    glm::dvec3 origin{0.0};
+
+    // 由 TRn 卡片数值构造：o1 o2 o3 [xx' yx' zx' xy' yy' zy' xz' yz' zz'] [m]。
+    // degrees 对应 *TRn；支持省略旋转、给出两轴（6 个值）或全部九个值。
+    static std::optional<SurfaceTransform> fromCard(std::span<const double> values, bool degrees,
+                                                    std::string* error = nullptr);
+
+    glm::dvec3 apply(const glm::dvec3& local) const { return origin + rotation * local; }
+};
+
+// Ax² + By² + Cz² + Dxy + Eyz + Fzx + Gx + Hy + Jz + K
+struct Quadric {
+    std::array<double, 10> c{};
+
+    double evaluate(const glm::dvec3& p) const noexcept;
+    Quadric transformed(const SurfaceTransform& transform) const;
+
+    static Quadric plane(const glm::dvec3& normal, double offset);  // n·x - offset
+    static Quadric sphere(const glm::dvec3& center, double radius);
+    static Quadric cylinder(const glm::dvec3& point, const glm::dvec3& axis, double radius);
+    static Quadric cone(const glm::dvec3& apex, const glm::dvec3& axis, double tangentSquared);
+};
+
+// 编译后的曲面表：每行一个二次曲面（宏体展开为若干面，facet 从 1 开始），
+// 系数按列（SoA）存放，便于批量求值与向量化；TR 变换在入表时已合成进系数。
+class SurfaceTable {
+public:
+    enum Coefficient { A, B, C, D, E, F, G, H, J, K, CoefficientCount };
+
+    struct MacroBody {
+        int id = 0;
+        MacroBodyType type = MacroBodyType::Rpp;
+        std::uint32_t firstRow = 0;
+        std::uint32_t facetCount = 0;
+    };
+
+    // 添加一张曲面卡片；mnemonic 大小写不敏感，values 为助记符之后的数值
+    bool add(int id, std::string_view mnemonic, std::span<const double> values,
+             const SurfaceTransform* transform = nullptr, BoundaryKind boundary = BoundaryKind::None,
+             std::string* error = nullptr);
+    // 移除曲面（宏体连同全部面）；行号保持稳定，被移除的行 id 置 0 且不再能被 find 找到
+    bool remove(int id);
+    void setPeriodicPartner(int id, int partner);
+    std::optional<int> periodicPartner(int id) const;
+    void reserve(std::size_t rows);
+    void clear();
+
+    std::size_t size() const noexcept { return ids_.size(); }
+    std::optional<std::size_t> find(int id, int facet = 0) const;
+
+    int id(std::size_t row) const { return ids_[row]; }
+    int facet(std::size_t row) const { return facets_[row]; }
+    SurfaceType type(std::size_t row) const { return types_[row]; }
+    BoundaryKind boundary(std::size_t row) const { return boundaries_[row]; }
+    const std::vector<double>& column(Coefficient coefficient) const { return columns_[coefficient]; }
+    Quadric quadric(std::size_t row) const;
+
+    // f(p)：负值为曲面负侧（内部）
+    double evaluate(std::size_t row, const glm::dvec3& p) const;
+    int sense(std::size_t row, const glm::dvec3& p) const { return evaluate(row, p) < 0.0 ? -1 : 1; }
+    // 对一行批量求值；out 长度须与 points 相同
+    void evaluate(std::size_t row, std::span<const glm::dvec3> points, std::span<double> out) const;
+
+    struct ValueRange {
+        double low = 0.0;
+        double high = 0.0;
+    };
+    // 区间算术求 f 在盒上的取值范围（保守外包）；盒无界时为 (-∞, +∞)
+    ValueRange range(std::size_t row, const Aabb& box) const;
+    // 半空间（negative 为负侧）的精确轴对齐范围：平面只在法向与坐标轴平行时有界，
+    // 二次曲面由特征分解求椭球/柱体在各轴上的投影，环面取其支撑函数；无界方向为无穷
+    Aabb bounds(std::size_t row, bool negative) const;
+
+    struct ConeSheet {
+        glm::dvec3 apex;
+        glm::dvec3 axis;  // 指向所取的一叶
+    };
+    struct Torus {
+        glm::dvec3 center;
+        glm::dvec3 axis;
+        double major = 0.0;  // A：环心半径
+        double axial = 0.0;  // B：轴向半轴
+        double radial = 0.0; // C：径向半轴
+    };
+    // 单叶锥与环面的附加参数（主坐标系）；其他行返回空
+    const ConeSheet* coneSheet(std::size_t row) const;
+    const Torus* torus(std::size_t row) const;
+
+    const std::vector<MacroBody>& macroBodies() const noexcept { return macroBodies_; }
+    const MacroBody* findMacroBody(int id) const;
+    bool insideMacroBody(const MacroBody& body, const glm::dvec3& p) const;
+
+private:
+    std::size_t addRow(int id, int facet, SurfaceType type, const Quadric& quadric, BoundaryKind boundary);
+    void removeRow(std::size_t row);
+    bool addMacroBody(int id, MacroBodyType type, std::span<const double> values, const SurfaceTransform* transform,
+                      BoundaryKind boundary, std::string* error);
+
+    std::vector<int> ids_;
+    std::vector<std::int16_t> facets_;
+    std::vector<SurfaceType> types_;
+    std::vector<BoundaryKind> boundaries_;
+    std::array<std::vector<double>, CoefficientCount> columns_;
+
+    std::unordered_map<std::size_t, ConeSheet> sheets_;  // 单叶锥面，按行号索引
+    std::unordered_map<std::size_t, Torus> tori_;
+    std::unordered_map<int, int> periodic_;
+    std::unordered_map<std::uint64_t, std::size_t> index_;  // (id, facet) -> 行
+    std::vector<MacroBody> macroBodies_;
+    std::unordered_map<int, std::size_t> macroIndex_;
+};
+
+} // namespace mcnp::core
+
+#endif // SURFACE_TABLE_H
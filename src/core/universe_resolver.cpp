@@ -0,0 +1,448 @@
+#include "universe_resolver.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+namespace mcnp::core {
+
+namespace {
+
+constexpr double kSqrt3 = 1.7320508075688772;
+constexpr int kGridResolution = 8;
+constexpr std::size_t kGridMinCells = 16;
+constexpr int kMaxNesting = 64;
+
+double slabExit(double position, double direction, double half) {
+    if (direction > 0.0) {
+        return (half - position) / direction;
+    }
+    if (direction < 0.0) {
+        return (-half - position) / direction;
+    }
+    return std::numeric_limits<double>::infinity();
+}
+
+} // namespace
+
+glm::ivec3 LatticeSpec::indexOf(const glm::dvec3& p) const {
+    const int k = pitch.z > 0.0 ? static_cast<int>(std::floor(p.z / pitch.z + 0.5)) : 0;
+    if (type == LatticeType::Rectangular) {
+        const int i = pitch.x > 0.0 ? static_cast<int>(std::floor(p.x / pitch.x + 0.5)) : 0;
+        const int j = pitch.y > 0.0 ? static_cast<int>(std::floor(p.y / pitch.y + 0.5)) : 0;
+        return {i, j, k};
+    }
+    // 六角栅格：求轴向坐标 (q, r) 后做立方坐标取整，得到最近的元素中心
+    const double q = p.x / pitch.x - p.y / (pitch.x * kSqrt3);
+    const double r = 2.0 * p.y / (pitch.x * kSqrt3);
+    const double s = -q - r;
+    double rq = std::round(q);
+    double rr = std::round(r);
+    const double rs = std::round(s);
+    const double dq = std::abs(rq - q);
+    const double dr = std::abs(rr - r);
+    const double ds = std::abs(rs - s);
+    if (dq > dr && dq > ds) {
+        rq = -rr - rs;
+    } else if (dr > ds) {
+        rr = -rq - rs;
+    }
+    return {static_cast<int>(rq), static_cast<int>(rr), k};
+}
+
+glm::dvec3 LatticeSpec::centerOf(const glm::ivec3& index) const {
+    const double z = pitch.z > 0.0 ? index.z * pitch.z : 0.0;
+    if (type == LatticeType::Rectangular) {
+        return {pitch.x > 0.0 ? index.x * pitch.x : 0.0, pitch.y > 0.0 ? index.y * pitch.y : 0.0, z};
+    }
+    return {index.x * pitch.x + index.y * pitch.x * 0.5, index.y * pitch.x * kSqrt3 * 0.5, z};
+}
+
+bool LatticeSpec::inRange(const glm::ivec3& index) const {
+    return index.x >= lower.x && index.x <= upper.x && index.y >= lower.y && index.y <= upper.y &&
+           index.z >= lower.z && index.z <= upper.z;
+}
+
+int LatticeSpec::universeAt(const glm::ivec3& index) const {
+    if (!inRange(index)) {
+        return -1;
+    }
+    const glm::ivec3 extent = upper - lower + glm::ivec3(1);
+    const std::size_t offset = static_cast<std::size_t>(index.x - lower.x) +
+        static_cast<std::size_t>(extent.x) *
+            (static_cast<std::size_t>(index.y - lower.y) + static_cast<std::size_t>(extent.y) * static_cast<std::size_t>(index.z - lower.z));
+    return offset < fill.size() ? fill[offset] : -1;
+}
+
+double LatticeSpec::exitDistance(const glm::dvec3& p, const glm::dvec3& d) const {
+    double t = pitch.z > 0.0 ? slabExit(p.z, d.z, pitch.z * 0.5) : std::numeric_limits<double>::infinity();
+    if (type == LatticeType::Rectangular) {
+        if (pitch.x > 0.0) {
+            t = std::min(t, slabExit(p.x, d.x, pitch.x * 0.5));
+        }
+        if (pitch.y > 0.0) {
+            t = std::min(t, slabExit(p.y, d.y, pitch.y * 0.5));
+        }
+        return t;
+    }
+    // 六个侧面法向为 0°, 60°, 120°，平面距中心 p/2
+    const double half = pitch.x * 0.5;
+    const glm::dvec2 normals[3] = {{1.0, 0.0}, {0.5, kSqrt3 * 0.5}, {-0.5, kSqrt3 * 0.5}};
+    for (const auto& n : normals) {
+        t = std::min(t, slabExit(n.x * p.x + n.y * p.y, n.x * d.x + n.y * d.y, half));
+    }
+    return t;
+}
+
+void UniverseResolver::addUniverse(Universe universe) {
+    universes_.push_back(std::move(universe));
+    built_ = false;
+}
+
+void UniverseResolver::clear() {
+    universes_.clear();
+    index_.clear();
+    prepared_.clear();
+    maxDepth_ = 0;
+    built_ = false;
+}
+
+const Universe* UniverseResolver::findUniverse(int universeId) const {
+    const auto it = index_.find(universeId);
+    return it == index_.end() ? nullptr : &universes_[static_cast<std::size_t>(it->second)];
+}
+
+Aabb UniverseResolver::universeBounds(int universeId) const {
+    const auto it = index_.find(universeId);
+    return it == index_.end() ? Aabb{} : prepared_[static_cast<std::size_t>(it->second)].bounds;
+}
+
+bool UniverseResolver::build(std::vector<std::string>* errors) {
+    bool ok = true;
+    auto report = [&](const std::string& message) {
+        ok = false;
+        if (errors) {
+            errors->push_back(message);
+        }
+    };
+
+    index_.clear();
+    for (std::size_t u = 0; u < universes_.size(); ++u) {
+        if (!index_.emplace(universes_[u].id, static_cast<int>(u)).second) {
+            report("duplicate universe " + std::to_string(universes_[u].id));
+        }
+    }
+    auto lookup = [&](int id, const UniverseCell& cell) {
+        if (id < 0) {
+            return -1;
+        }
+        const auto it = index_.find(id);
+        if (it == index_.end()) {
+            report("cell " + std::to_string(cell.id) + " fills undefined universe " + std::to_string(id));
+            return -1;
+        }
+        return it->second;
+    };
+
+    prepared_.assign(universes_.size(), {});
+    for (std::size_t u = 0; u < universes_.size(); ++u) {
+        PreparedUniverse& pu = prepared_[u];
+        bool unboundedUniverse = false;
+        for (std::size_t c = 0; c < universes_[u].cells.size(); ++c) {
+            const UniverseCell& cell = universes_[u].cells[c];
+            PreparedCell pc;
+            pc.cell = &cell;
+            pc.fillIndex = lookup(cell.fill, cell);
+            if (cell.lattice) {
+                pc.latticeFill.reserve(cell.lattice->fill.size());
+                for (int id : cell.lattice->fill) {
+                    pc.latticeFill.push_back(lookup(id, cell));
+                }
+            }
+            pc.fillInverse = glm::inverse(cell.fillTransform);
+            pu.cells.push_back(std::move(pc));
+            pu.all.push_back(static_cast<int>(c));
+            if (cell.bounds && !cell.bounds->empty()) {
+                pu.bounds.expand(*cell.bounds);
+            } else {
+                pu.unbounded.push_back(static_cast<int>(c));
+                unboundedUniverse = true;
+            }
+        }
+
+        // 单元较多且有界部分有限时建立均匀网格
+        const std::size_t boundedCount = pu.cells.size() - pu.unbounded.size();
+        pu.gridBounds = pu.bounds;
+        if (boundedCount >= kGridMinCells && pu.bounds.isFinite()) {
+            pu.grid.assign(static_cast<std::size_t>(kGridResolution * kGridResolution * kGridResolution), {});
+            const glm::dvec3 cellSize = glm::max(pu.bounds.extent(), glm::dvec3(1e-12)) / static_cast<double>(kGridResolution);
+            for (int gz = 0; gz < kGridResolution; ++gz) {
+                for (int gy = 0; gy < kGridResolution; ++gy) {
+                    for (int gx = 0; gx < kGridResolution; ++gx) {
+                        Aabb box;
+                        box.min = pu.bounds.min + cellSize * glm::dvec3(gx, gy, gz);
+                        box.max = box.min + cellSize;
+                        auto& list = pu.grid[static_cast<std::size_t>(gx + kGridResolution * (gy + kGridResolution * gz))];
+                        for (int c : pu.all) {
+                            const UniverseCell& cell = *pu.cells[static_cast<std::size_t>(c)].cell;
+                            if (!cell.bounds || cell.bounds->empty() || cell.bounds->intersects(box)) {
+                                list.push_back(c);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        if (unboundedUniverse) {
+            pu.bounds = Aabb::infinite();
+        }
+    }
+
+    // 检测循环填充并求最大嵌套深度
+    std::vector<int> state(universes_.size(), 0);  // 0 未访问 1 访问中 2 完成
+    std::vector<int> depth(universes_.size(), 1);
+    std::function<int(int)> visit = [&](int u) -> int {
+        auto& s = state[static_cast<std::size_t>(u)];
+        if (s == 1) {
+            report("universe " + std::to_string(universes_[static_cast<std::size_t>(u)].id) + " is filled recursively");
+            return 0;
+        }
+        if (s == 2) {
+            return depth[static_cast<std::size_t>(u)];
+        }
+        s = 1;
+        int deepest = 0;
+        for (const auto& pc : prepared_[static_cast<std::size_t>(u)].cells) {
+            if (pc.fillIndex >= 0) {
+                deepest = std::max(deepest, visit(pc.fillIndex));
+            }
+            for (int child : pc.latticeFill) {
+                if (child >= 0 && state[static_cast<std::size_t>(child)] != 2) {
+                    deepest = std::max(deepest, visit(child));
+                } else if (child >= 0) {
+                    deepest = std::max(deepest, depth[static_cast<std::size_t>(child)]);
+                }
+            }
+        }
+        s = 2;
+        depth[static_cast<std::size_t>(u)] = deepest + 1;
+        return deepest + 1;
+    };
+    maxDepth_ = 0;
+    for (std::size_t u = 0; u < universes_.size(); ++u) {
+        maxDepth_ = std::max(maxDepth_, visit(static_cast<int>(u)));
+    }
+    if (maxDepth_ > kMaxNesting) {
+        report("universe nesting deeper than " + std::to_string(kMaxNesting));
+    }
+    built_ = ok;
+    return ok;
+}
+
+const std::vector<int>& UniverseResolver::candidates(const PreparedUniverse& universe, const glm::dvec3& local) const {
+    if (universe.grid.empty()) {
+        return universe.all;
+    }
+    // 网格只覆盖有界单元的包围盒并集，超出部分只可能落在无界单元中
+    const glm::dvec3& lo = universe.gridBounds.min;
+    const glm::dvec3& hi = universe.gridBounds.max;
+    if (!universe.gridBounds.contains(local)) {
+        return universe.unbounded;
+    }
+    const glm::dvec3 f = (local - lo) / glm::max(hi - lo, glm::dvec3(1e-12)) * static_cast<double>(kGridResolution);
+    const glm::ivec3 g = glm::clamp(glm::ivec3(glm::floor(f)), glm::ivec3(0), glm::ivec3(kGridResolution - 1));
+    return universe.grid[static_cast<std::size_t>(g.x + kGridResolution * (g.y + kGridResolution * g.z))];
+}
+
+bool UniverseResolver::descend(const glm::dvec3& worldPoint, int rootUniverse, PointLocation* full, CellHit& hit,
+                               const glm::dvec3* direction, double* latticeExit) const {
+    const auto root = index_.find(rootUniverse);
+    if (!built_ || root == index_.end()) {
+        return false;
+    }
+    int u = root->second;
+    glm::dvec3 local = worldPoint;
+    glm::dvec3 localDir = direction ? *direction : glm::dvec3(0.0);
+    glm::dmat4 localToWorld(1.0);
+
+    for (int level = 0; level <= kMaxNesting; ++level) {
+        const PreparedUniverse& pu = prepared_[static_cast<std::size_t>(u)];
+        const PreparedCell* match = nullptr;
+        for (int c : candidates(pu, local)) {
+            const PreparedCell& pc = pu.cells[static_cast<std::size_t>(c)];
+            if (pc.cell->bounds && !pc.cell->bounds->contains(local)) {
+                continue;
+            }
+            if (!pc.cell->contains || pc.cell->contains(local)) {
+                match = &pc;
+                break;
+            }
+        }
+        if (!match) {
+            return false;
+        }
+        const UniverseCell& cell = *match->cell;
+        hit.universe = universes_[static_cast<std::size_t>(u)].id;
+        hit.cell = cell.id;
+        hit.material = cell.material;
+
+        ResolvedLevel resolved;
+        resolved.universe = hit.universe;
+        resolved.cell = cell.id;
+
+        if (cell.lattice) {
+            const glm::dvec3 latticePoint = glm::dvec3(match->fillInverse * glm::dvec4(local, 1.0));
+            const glm::ivec3 index = cell.lattice->indexOf(latticePoint);
+            const glm::dvec3 center = cell.lattice->centerOf(index);
+            int next = -1;
+            if (cell.lattice->inRange(index)) {
+                const glm::ivec3 extent = cell.lattice->upper - cell.lattice->lower + glm::ivec3(1);
+                const glm::ivec3 o = index - cell.lattice->lower;
+                const auto offset = static_cast<std::size_t>(o.x + extent.x * (o.y + extent.y * o.z));
+                next = offset < match->latticeFill.size() ? match->latticeFill[offset] : -1;
+            }
+            resolved.inLattice = true;
+            resolved.latticeIndex = index;
+            if (full) {
+                full->path.push_back(resolved);
+            }
+            if (next < 0) {
+                return false;
+            }
+            local = latticePoint - center;
+            if (direction) {
+                localDir = glm::dvec3(match->fillInverse * glm::dvec4(localDir, 0.0));
+                *latticeExit = std::min(*latticeExit, cell.lattice->exitDistance(local, localDir));
+            }
+            if (full) {
+                localToWorld = localToWorld * cell.fillTransform;
+                localToWorld[3] += localToWorld * glm::dvec4(center, 0.0);
+            }
+            u = next;
+            continue;
+        }
+
+        if (full) {
+            full->path.push_back(resolved);
+        }
+        if (match->fillIndex >= 0) {
+            local = glm::dvec3(match->fillInverse * glm::dvec4(local, 1.0));
+            if (direction) {
+                localDir = glm::dvec3(match->fillInverse * glm::dvec4(localDir, 0.0));
+            }
+            if (full) {
+                localToWorld = localToWorld * cell.fillTransform;
+            }
+            u = match->fillIndex;
+            continue;
+        }
+
+        hit.found = true;
+        if (full) {
+            full->found = true;
+            full->cell = cell.id;
+            full->material = cell.material;
+            full->localPoint = local;
+            full->localToWorld = localToWorld;
+        }
+        return true;
+    }
+    return false;
+}
+
+PointLocation UniverseResolver::locate(const glm::dvec3& worldPoint, int rootUniverse) const {
+    PointLocation location;
+    CellHit hit;
+    descend(worldPoint, rootUniverse, &location, hit, nullptr, nullptr);
+    return location;
+}
+
+CellHit UniverseResolver::classify(const glm::dvec3& worldPoint, int rootUniverse) const {
+    CellHit hit;
+    hit.found = descend(worldPoint, rootUniverse, nullptr, hit, nullptr, nullptr);
+    return hit;
+}
+
+std::vector<CellHit> UniverseResolver::classify(const std::vector<glm::dvec3>& worldPoints, int rootUniverse,
+                                                ThreadPool& pool) const {
+    std::vector<CellHit> hits(worldPoints.size());
+    pool.parallelFor(worldPoints.size(), 4096, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            hits[i].found = descend(worldPoints[i], rootUniverse, nullptr, hits[i], nullptr, nullptr);
+        }
+    });
+    return hits;
+}
+
+std::vector<RaySegment> UniverseResolver::trace(const glm::dvec3& origin, const glm::dvec3& direction, double maxDistance,
+                                                double step, int rootUniverse) const {
+    std::vector<RaySegment> segments;
+    if (maxDistance <= 0.0 || step <= 0.0 || glm::length(direction) <= 0.0) {
+        return segments;
+    }
+    const glm::dvec3 d = glm::normalize(direction);
+    const double tolerance = 1e-9 * std::max(1.0, maxDistance);
+
+    struct Probe {
+        PointLocation location;
+        CellHit hit;
+        double exit = std::numeric_limits<double>::infinity();
+    };
+    auto probe = [&](double t) {
+        Probe p;
+        p.hit.found = descend(origin + d * t, rootUniverse, &p.location, p.hit, &d, &p.exit);
+        return p;
+    };
+    auto same = [](const Probe& a, const Probe& b) {
+        return a.hit.found == b.hit.found && a.location.path == b.location.path;
+    };
+    auto emit = [&](const Probe& p, double t0, double t1) {
+        if (!p.hit.found || t1 <= t0) {
+            return;
+        }
+        if (!segments.empty()) {
+            RaySegment& last = segments.back();
+            // 相邻栅格元素中的同一单元合并为一段
+            if (last.universe == p.hit.universe && last.cell == p.hit.cell && last.material == p.hit.material &&
+                std::abs(last.t1 - t0) <= tolerance) {
+                last.t1 = t1;
+                return;
+            }
+        }
+        segments.push_back({p.hit.universe, p.hit.cell, p.hit.material, t0, t1});
+    };
+
+    double t = 0.0;
+    double segmentStart = 0.0;
+    Probe current = probe(0.0);
+    while (t < maxDistance) {
+        const double advance = std::min(step, current.exit + tolerance);
+        const double tn = std::min(t + std::max(advance, tolerance), maxDistance);
+        Probe next = probe(tn);
+        if (same(current, next)) {
+            t = tn;
+            current.exit = next.exit;
+            continue;
+        }
+        // 二分定位边界
+        double lo = t;
+        double hi = tn;
+        while (hi - lo > tolerance) {
+            const double mid = 0.5 * (lo + hi);
+            if (same(current, probe(mid))) {
+                lo = mid;
+            } else {
+                hi = mid;
+            }
+        }
+        emit(current, segmentStart, hi);
+        segmentStart = hi;
+        t = hi;
+        current = probe(hi);
+    }
+    emit(current, segmentStart, maxDistance);
+    return segments;
+}
+
+} // namespace mcnp::core
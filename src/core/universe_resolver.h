@@ -0,0 +1,156 @@
+#ifndef UNIVERSE_RESOLVER_H
+#define UNIVERSE_RESOLVER_H
+
+#include "aabb.h"
+#include "thread_pool.h"
+
+#include <glm/glm.hpp>
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mcnp::core {
+
+// 单元内外判定由调用方提供（CSG 求值在输入层完成），参数为单元所在宇宙的局部坐标
+using CellPredicate = std::function<bool(const glm::dvec3& local)>;
+
+enum class LatticeType {
+    Rectangular,  // LAT=1：六面体栅元
+    Hexagonal     // LAT=2：六棱柱栅元，截面为正六边形
+};
+
+// LAT/FILL 栅格描述。元素 (0,0,0) 的中心位于栅格坐标系原点。
+// 矩形栅格：元素 (i,j,k) 中心 = (i·px, j·py, k·pz)
+// 六角栅格：中心 = i·(p, 0) + j·(p/2, p·√3/2)，轴向 k·pz；p 为对边距，pz<=0 表示轴向无限
+struct LatticeSpec {
+    LatticeType type = LatticeType::Rectangular;
+    glm::dvec3 pitch{1.0};
+    glm::ivec3 lower{0};
+    glm::ivec3 upper{0};
+    std::vector<int> fill;  // 各元素填充的宇宙号，i 变化最快；-1 表示空
+
+    glm::ivec3 indexOf(const glm::dvec3& latticePoint) const;
+    glm::dvec3 centerOf(const glm::ivec3& index) const;
+    bool inRange(const glm::ivec3& index) const;
+    int universeAt(const glm::ivec3& index) const;
+    // 元素内局部点沿 direction 离开该元素的距离
+    double exitDistance(const glm::dvec3& elementPoint, const glm::dvec3& direction) const;
+};
+
+struct UniverseCell {
+    int id = 0;
+    int material = 0;
+    CellPredicate contains;
+    std::optional<Aabb> bounds;       // 局部包围盒，用于快速剔除
+    int fill = -1;                    // FILL=u（非栅格单元）
+    glm::dmat4 fillTransform{1.0};    // 被填充宇宙（或栅格坐标系）到本单元坐标系的变换
+    std::optional<LatticeSpec> lattice;
+};
+
+struct Universe {
+    int id = 0;
+    std::vector<UniverseCell> cells;
+};
+
+// 定位路径中的一层
+struct ResolvedLevel {
+    int universe = 0;
+    int cell = 0;
+    bool inLattice = false;
+    glm::ivec3 latticeIndex{0};
+
+    bool operator==(const ResolvedLevel& other) const
+    {
+        return universe == other.universe && cell == other.cell && inLattice == other.inLattice &&
+               latticeIndex == other.latticeIndex;
+    }
+};
+
+struct PointLocation {
+    bool found = false;
+    std::vector<ResolvedLevel> path;  // 从根宇宙到叶单元
+    int cell = 0;
+    int material = 0;
+    glm::dvec3 localPoint{0.0};        // 叶单元所在宇宙的局部坐标
+    glm::dmat4 localToWorld{1.0};      // 叶宇宙局部坐标到世界坐标的合成变换
+};
+
+// 批量查询的轻量结果（切片图、拾取）
+struct CellHit {
+    bool found = false;
+    int universe = 0;
+    int cell = 0;
+    int material = 0;
+};
+
+struct RaySegment {
+    int universe = 0;
+    int cell = 0;
+    int material = 0;
+    double t0 = 0.0;
+    double t1 = 0.0;
+};
+
+// 嵌套宇宙/栅格的点定位器：
+// 预先计算各宇宙的包围盒与单元网格索引、填充变换的逆矩阵，
+// 栅格元素下标按坐标直接算出（每层 O(1)），不逐个测试栅格元素。
+class UniverseResolver {
+public:
+    void addUniverse(Universe universe);
+    void clear();
+
+    // 校验填充引用与循环嵌套，预计算加速结构；返回是否成功
+    bool build(std::vector<std::string>* errors = nullptr);
+
+    PointLocation locate(const glm::dvec3& worldPoint, int rootUniverse = 0) const;
+    CellHit classify(const glm::dvec3& worldPoint, int rootUniverse = 0) const;
+    std::vector<CellHit> classify(const std::vector<glm::dvec3>& worldPoints, int rootUniverse = 0,
+                                  ThreadPool& pool = ThreadPool::shared()) const;
+
+    // 沿射线给出经过的叶单元区间。栅格元素边界按解析距离步进，
+    // 单元边界在 step 步长内二分定位（step 应小于最薄单元的厚度）
+    std::vector<RaySegment> trace(const glm::dvec3& origin, const glm::dvec3& direction, double maxDistance,
+                                  double step, int rootUniverse = 0) const;
+
+    // 宇宙局部包围盒（含全部单元的包围盒并集；存在无界单元时为无穷大）
+    Aabb universeBounds(int universeId) const;
+    const Universe* findUniverse(int universeId) const;
+    int maxDepth() const noexcept { return maxDepth_; }
+
+private:
+    struct PreparedCell {
+        const UniverseCell* cell = nullptr;
+        int fillIndex = -1;                 // 被填充宇宙在 universes_ 中的下标
+        std::vector<int> latticeFill;       // 栅格元素对应宇宙下标
+        glm::dmat4 fillInverse{1.0};
+    };
+
+    struct PreparedUniverse {
+        std::vector<PreparedCell> cells;
+        Aabb bounds;
+        // 单元数较多时建立均匀网格：每个格子列出包围盒与之相交的单元
+        Aabb gridBounds;
+        std::vector<std::vector<int>> grid;
+        std::vector<int> unbounded;         // 无包围盒单元，所有格子都需测试
+        std::vector<int> all;
+    };
+
+    // 逐层下降。full 非空时记录完整路径与合成变换；
+    // direction 非空时同时求沿该方向离开当前各层栅格元素的最短距离
+    bool descend(const glm::dvec3& worldPoint, int rootUniverse, PointLocation* full, CellHit& hit,
+                 const glm::dvec3* direction, double* latticeExit) const;
+    const std::vector<int>& candidates(const PreparedUniverse& universe, const glm::dvec3& local) const;
+
+    std::vector<Universe> universes_;
+    std::unordered_map<int, int> index_;
+    std::vector<PreparedUniverse> prepared_;
+    int maxDepth_{0};
+    bool built_{false};
+};
+
+} // namespace mcnp::core
+
+#endif // UNIVERSE_RESOLVER_H
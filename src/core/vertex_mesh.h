@@ -13,10 +13,15 @@
 #include <map>
 #include <functional>
 #include <algorithm>
+#include <memory>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
 
+namespace mcnp::core {
+struct GeometryNode;
+}
+
 // 顶点结构
 struct Vertex {
     glm::vec3 position;
@@ -38,6 +43,8 @@ struct Mesh {
     unsigned int VAO;
     unsigned int VBO;
     unsigned int EBO;
+    // 布尔运算结果保留的运算树（操作数的变换记在子节点上），其余网格为空
+    std::shared_ptr<const mcnp::core::GeometryNode> csg;
     
     Mesh(std::string n = "Object") : 
         transform(glm::mat4(1.0f)), 
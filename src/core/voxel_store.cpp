@@ -0,0 +1,378 @@
+#include "voxel_store.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string>
+
+namespace mcnp::core {
+
+namespace {
+
+constexpr std::int8_t kUnscaled = std::numeric_limits<std::int8_t>::min();  // 砖块尚无非零值
+constexpr int kHalfHeadroom = 14;  // 缩放后砖块最大值落在 [2^14, 2^15)，距半精度上限留一倍余量
+
+std::uint16_t float_to_half(float value) {
+    const std::uint32_t bits = std::bit_cast<std::uint32_t>(value);
+    const std::uint32_t sign = (bits >> 16) & 0x8000u;
+    const std::uint32_t magnitude = bits & 0x7fffffffu;
+    if (magnitude >= 0x47800000u) {  // 溢出（含 inf/nan）
+        return static_cast<std::uint16_t>(sign | (magnitude > 0x7f800000u ? 0x7e00u : 0x7c00u));
+    }
+    if (magnitude < 0x38800000u) {  // 半精度次正规数或 0
+        if (magnitude < 0x33000000u) {
+            return static_cast<std::uint16_t>(sign);
+        }
+        const std::uint32_t exponent = magnitude >> 23;
+        const std::uint32_t mantissa = (magnitude & 0x7fffffu) | 0x800000u;
+        const std::uint32_t shift = 126 - exponent;
+        std::uint32_t half = mantissa >> shift;
+        const std::uint32_t rest = mantissa & ((1u << shift) - 1);
+        const std::uint32_t halfway = 1u << (shift - 1);
+        half += rest > halfway || (rest == halfway && (half & 1u));
+        return static_cast<std::uint16_t>(sign | half);
+    }
+    // 正规数：舍入到最近，平局取偶
+    std::uint32_t half = ((magnitude - 0x38000000u) >> 13);
+    const std::uint32_t rest = magnitude & 0x1fffu;
+    half += rest > 0x1000u || (rest == 0x1000u && (half & 1u));
+    return static_cast<std::uint16_t>(sign | half);
+}
+
+float half_to_float(std::uint16_t half) {
+    const std::uint32_t sign = static_cast<std::uint32_t>(half & 0x8000u) << 16;
+    const std::uint32_t exponent = (half >> 10) & 0x1fu;
+    std::uint32_t mantissa = half & 0x3ffu;
+    std::uint32_t bits = 0;
+    if (exponent == 0) {
+        if (mantissa == 0) {
+            bits = sign;
+        } else {
+            int shift = 0;
+            while ((mantissa & 0x400u) == 0) {
+                mantissa <<= 1;
+                ++shift;
+            }
+            bits = sign | static_cast<std::uint32_t>(113 - shift) << 23 | (mantissa & 0x3ffu) << 13;
+        }
+    } else if (exponent == 0x1f) {
+        bits = sign | 0x7f800000u | mantissa << 13;
+    } else {
+        bits = sign | (exponent + 112) << 23 | mantissa << 13;
+    }
+    return std::bit_cast<float>(bits);
+}
+
+std::size_t error_bytes(VoxelErrorEncoding encoding) {
+    switch (encoding) {
+    case VoxelErrorEncoding::Float32:
+        return 4;
+    case VoxelErrorEncoding::Quantized16:
+        return 2;
+    case VoxelErrorEncoding::Quantized8:
+        return 1;
+    }
+    return 4;
+}
+
+std::filesystem::path temporary_cache(const void* owner) {
+    static std::atomic<unsigned> counter{0};
+    const auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+    return std::filesystem::temp_directory_path() /
+           ("mcnp_bricks_" + std::to_string(reinterpret_cast<std::uintptr_t>(owner)) + "_" +
+            std::to_string(stamp) + "_" + std::to_string(counter++) + ".cache");
+}
+
+} // namespace
+
+VoxelBrickStore::VoxelBrickStore(std::array<std::size_t, 3> dims, std::size_t channels, VoxelStoreOptions options)
+    : dims_(dims), channels_(std::max<std::size_t>(channels, 1)), options_(std::move(options)) {
+    options_.brickSize = std::max<std::size_t>(options_.brickSize, 1);
+    const std::size_t size = options_.brickSize;
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+        bricks_[axis] = (std::max<std::size_t>(dims_[axis], 1) + size - 1) / size;
+    }
+    voxelsPerBrick_ = size * size * size;
+    valueBytes_ = options_.values == VoxelValueEncoding::Float16 ? 2 : 4;
+    errorBytes_ = error_bytes(options_.errors);
+    brickBytes_ = voxelsPerBrick_ * (valueBytes_ + errorBytes_);
+    maxPages_ = std::max<std::size_t>(1, options_.memoryBudget / brickBytes_);
+    const std::size_t count = channels_ * bricks_[0] * bricks_[1] * bricks_[2];
+    VoxelBrickInfo empty;
+    empty.exponent = kUnscaled;
+    info_.assign(count, empty);
+    onDisk_.assign(count, 0);
+}
+
+VoxelBrickStore::~VoxelBrickStore() {
+    if (cache_.is_open()) {
+        cache_.close();
+    }
+    if (ownsCache_) {
+        std::error_code ec;
+        std::filesystem::remove(options_.cacheFile, ec);
+    }
+}
+
+std::size_t VoxelBrickStore::brickIndex(std::size_t bx, std::size_t by, std::size_t bz, std::size_t channel) const {
+    return ((channel * bricks_[0] + bx) * bricks_[1] + by) * bricks_[2] + bz;
+}
+
+std::pair<std::size_t, std::size_t> VoxelBrickStore::locate(std::size_t x, std::size_t y, std::size_t z,
+                                                            std::size_t channel) const {
+    const std::size_t size = options_.brickSize;
+    const std::size_t brick = brickIndex(x / size, y / size, z / size, channel);
+    const std::size_t voxel = ((x % size) * size + y % size) * size + z % size;
+    return {brick, voxel};
+}
+
+VoxelBrickStore::Page& VoxelBrickStore::page(std::size_t brick) {
+    if (last_ && last_->brick == brick) {
+        return *last_;
+    }
+    const auto found = resident_.find(brick);
+    if (found != resident_.end()) {
+        pages_.splice(pages_.begin(), pages_, found->second);
+        last_ = &pages_.front();
+        return *last_;
+    }
+    if (pages_.size() >= maxPages_) {
+        evict();
+    }
+    Page loaded;
+    loaded.brick = brick;
+    loaded.data.assign(brickBytes_, 0);
+    if (onDisk_[brick] && cache_.is_open()) {
+        cache_.seekg(static_cast<std::streamoff>(brick * brickBytes_));
+        cache_.read(reinterpret_cast<char*>(loaded.data.data()), static_cast<std::streamsize>(brickBytes_));
+        ++pageIns_;
+    }
+    pages_.push_front(std::move(loaded));
+    resident_[brick] = pages_.begin();
+    last_ = &pages_.front();
+    return *last_;
+}
+
+void VoxelBrickStore::evict() {
+    if (!cache_.is_open()) {
+        if (options_.cacheFile.empty()) {
+            options_.cacheFile = temporary_cache(this);
+            ownsCache_ = true;
+        }
+        cache_.open(options_.cacheFile, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!cache_.is_open()) {
+            maxPages_ = std::numeric_limits<std::size_t>::max();  // 无法换出：全部常驻
+            return;
+        }
+    }
+    Page& victim = pages_.back();
+    if (victim.dirty) {
+        cache_.seekp(static_cast<std::streamoff>(victim.brick * brickBytes_));
+        cache_.write(reinterpret_cast<const char*>(victim.data.data()), static_cast<std::streamsize>(brickBytes_));
+        onDisk_[victim.brick] = 1;
+        ++pageOuts_;
+    }
+    if (last_ == &victim) {
+        last_ = nullptr;
+    }
+    resident_.erase(victim.brick);
+    pages_.pop_back();
+}
+
+void VoxelBrickStore::flush() {
+    if (!cache_.is_open()) {
+        return;
+    }
+    for (Page& page : pages_) {
+        if (page.dirty) {
+            cache_.seekp(static_cast<std::streamoff>(page.brick * brickBytes_));
+            cache_.write(reinterpret_cast<const char*>(page.data.data()), static_cast<std::streamsize>(brickBytes_));
+            onDisk_[page.brick] = 1;
+            page.dirty = false;
+            ++pageOuts_;
+        }
+    }
+    cache_.flush();
+}
+
+float VoxelBrickStore::decodeValue(const Page& page, std::size_t voxel) const {
+    const std::uint8_t* data = page.data.data();
+    if (options_.values == VoxelValueEncoding::Float32) {
+        float value;
+        std::memcpy(&value, data + voxel * 4, 4);
+        return value;
+    }
+    std::uint16_t half;
+    std::memcpy(&half, data + voxel * 2, 2);
+    const std::int8_t exponent = info_[page.brick].exponent;
+    return exponent == kUnscaled ? 0.0f : std::ldexp(half_to_float(half), exponent);
+}
+
+float VoxelBrickStore::decodeError(const Page& page, std::size_t voxel) const {
+    const std::uint8_t* data = page.data.data() + voxelsPerBrick_ * valueBytes_;
+    switch (options_.errors) {
+    case VoxelErrorEncoding::Float32: {
+        float error;
+        std::memcpy(&error, data + voxel * 4, 4);
+        return error;
+    }
+    case VoxelErrorEncoding::Quantized16: {
+        std::uint16_t quantized;
+        std::memcpy(&quantized, data + voxel * 2, 2);
+        return quantized / 65535.0f;
+    }
+    case VoxelErrorEncoding::Quantized8:
+        return data[voxel] / 255.0f;
+    }
+    return 0.0f;
+}
+
+void VoxelBrickStore::rescale(Page& page, VoxelBrickInfo& info, std::int8_t exponent) {
+    // 2 的幂缩放：已有的半精度值只移动指数，除下溢外无损
+    if (info.exponent != kUnscaled) {
+        for (std::size_t voxel = 0; voxel < voxelsPerBrick_; ++voxel) {
+            std::uint16_t half;
+            std::memcpy(&half, page.data.data() + voxel * 2, 2);
+            half = float_to_half(std::ldexp(half_to_float(half), info.exponent - exponent));
+            std::memcpy(page.data.data() + voxel * 2, &half, 2);
+        }
+    }
+    info.exponent = exponent;
+}
+
+void VoxelBrickStore::set(std::size_t x, std::size_t y, std::size_t z, std::size_t channel, float value,
+                          float error) {
+    const auto [brick, voxel] = locate(x, y, z, channel);
+    Page& target = page(brick);
+    VoxelBrickInfo& info = info_[brick];
+    target.dirty = true;
+    info.min = std::min(info.min, value);
+    info.max = std::max(info.max, value);
+    info.maxError = std::max(info.maxError, error);
+
+    std::uint8_t* data = target.data.data();
+    if (options_.values == VoxelValueEncoding::Float32) {
+        std::memcpy(data + voxel * 4, &value, 4);
+    } else {
+        const float magnitude = std::fabs(value);
+        if (magnitude > 0.0f && std::isfinite(magnitude)) {
+            const int wanted = std::clamp(std::ilogb(magnitude) - kHalfHeadroom, -127, 127);
+            if (info.exponent == kUnscaled || wanted > info.exponent) {
+                rescale(target, info, static_cast<std::int8_t>(wanted));
+            }
+        }
+        const std::uint16_t half =
+            info.exponent == kUnscaled ? std::uint16_t{0} : float_to_half(std::ldexp(value, -info.exponent));
+        std::memcpy(data + voxel * 2, &half, 2);
+    }
+
+    std::uint8_t* errors = data + voxelsPerBrick_ * valueBytes_;
+    const float clamped = std::clamp(error, 0.0f, 1.0f);
+    switch (options_.errors) {
+    case VoxelErrorEncoding::Float32:
+        std::memcpy(errors + voxel * 4, &error, 4);
+        break;
+    case VoxelErrorEncoding::Quantized16: {
+        const auto quantized = static_cast<std::uint16_t>(std::lround(clamped * 65535.0f));
+        std::memcpy(errors + voxel * 2, &quantized, 2);
+        break;
+    }
+    case VoxelErrorEncoding::Quantized8:
+        errors[voxel] = static_cast<std::uint8_t>(std::lround(clamped * 255.0f));
+        break;
+    }
+}
+
+float VoxelBrickStore::value(std::size_t x, std::size_t y, std::size_t z, std::size_t channel) {
+    const auto [brick, voxel] = locate(x, y, z, channel);
+    return decodeValue(page(brick), voxel);
+}
+
+float VoxelBrickStore::error(std::size_t x, std::size_t y, std::size_t z, std::size_t channel) {
+    const auto [brick, voxel] = locate(x, y, z, channel);
+    return decodeError(page(brick), voxel);
+}
+
+void VoxelBrickStore::readBrick(std::size_t brick, float* values) {
+    const Page& data = page(brick);
+    if (options_.values == VoxelValueEncoding::Float32) {
+        std::memcpy(values, data.data.data(), voxelsPerBrick_ * 4);
+        return;
+    }
+    const std::int8_t exponent = info_[brick].exponent;
+    if (exponent == kUnscaled) {
+        std::fill(values, values + voxelsPerBrick_, 0.0f);
+        return;
+    }
+    const float scale = std::ldexp(1.0f, exponent);
+    for (std::size_t voxel = 0; voxel < voxelsPerBrick_; ++voxel) {
+        std::uint16_t half;
+        std::memcpy(&half, data.data.data() + voxel * 2, 2);
+        values[voxel] = half_to_float(half) * scale;
+    }
+}
+
+std::pair<float, float> VoxelBrickStore::range(std::size_t channel) const {
+    const std::size_t perChannel = bricks_[0] * bricks_[1] * bricks_[2];
+    const auto begin = info_.begin() + static_cast<std::ptrdiff_t>(channel * perChannel);
+    float low = std::numeric_limits<float>::max();
+    float high = std::numeric_limits<float>::lowest();
+    for (auto it = begin; it != begin + static_cast<std::ptrdiff_t>(perChannel); ++it) {
+        low = std::min(low, it->min);
+        high = std::max(high, it->max);
+    }
+    return {low, high};
+}
+
+std::size_t VoxelBrickStore::countAtLeast(std::size_t channel, float threshold) {
+    const std::size_t size = options_.brickSize;
+    std::size_t count = 0;
+    for (std::size_t bx = 0; bx < bricks_[0]; ++bx) {
+        for (std::size_t by = 0; by < bricks_[1]; ++by) {
+            for (std::size_t bz = 0; bz < bricks_[2]; ++bz) {
+                const std::size_t brick = brickIndex(bx, by, bz, channel);
+                if (info_[brick].max < threshold) {
+                    continue;
+                }
+                const std::size_t endX = std::min(dims_[0], (bx + 1) * size);
+                const std::size_t endY = std::min(dims_[1], (by + 1) * size);
+                const std::size_t endZ = std::min(dims_[2], (bz + 1) * size);
+                if (info_[brick].min >= threshold) {  // 整块命中
+                    count += (endX - bx * size) * (endY - by * size) * (endZ - bz * size);
+                    continue;
+                }
+                const Page& data = page(brick);
+                for (std::size_t x = bx * size; x < endX; ++x) {
+                    for (std::size_t y = by * size; y < endY; ++y) {
+                        for (std::size_t z = bz * size; z < endZ; ++z) {
+                            count += decodeValue(data, ((x % size) * size + y % size) * size + z % size) >= threshold;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return count;
+}
+
+std::vector<float> VoxelBrickStore::slice(std::size_t axis, std::size_t index, std::size_t channel) {
+    const std::size_t rowAxis = axis == 0 ? 1 : 0;
+    const std::size_t columnAxis = axis == 2 ? 1 : 2;
+    std::vector<float> result(dims_[rowAxis] * dims_[columnAxis]);
+    std::array<std::size_t, 3> at{};
+    at[axis] = index;
+    for (std::size_t row = 0; row < dims_[rowAxis]; ++row) {
+        for (std::size_t column = 0; column < dims_[columnAxis]; ++column) {
+            at[rowAxis] = row;
+            at[columnAxis] = column;
+            result[row * dims_[columnAxis] + column] = value(at[0], at[1], at[2], channel);
+        }
+    }
+    return result;
+}
+
+} // namespace mcnp::core
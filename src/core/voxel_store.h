@@ -0,0 +1,122 @@
+#ifndef VOXEL_STORE_H
+#define VOXEL_STORE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace mcnp::core {
+
+enum class VoxelValueEncoding : std::uint8_t {
+    Float32,
+    Float16  // 按砖块的 2 的幂缩放后存为半精度，相对精度约 1e-3，动态范围约 2^29
+};
+
+enum class VoxelErrorEncoding : std::uint8_t {
+    Float32,
+    Quantized16,  // 相对误差 [0, 1] 线性量化为 16 位
+    Quantized8
+};
+
+struct VoxelStoreOptions {
+    std::size_t brickSize = 16;  // 砖块边长（体素）
+    VoxelValueEncoding values = VoxelValueEncoding::Float32;
+    VoxelErrorEncoding errors = VoxelErrorEncoding::Quantized16;
+    std::size_t memoryBudget = std::size_t(256) << 20;  // 常驻砖块的字节上限，超出时按 LRU 换出
+    std::filesystem::path cacheFile;  // 换出的砖块写入的文件；为空时在临时目录中创建并在析构时删除
+};
+
+// 砖块的摘要：值的上下界为保守范围（覆盖写入时不收窄），未写入的体素按 0 计
+struct VoxelBrickInfo {
+    float min = 0.0f;
+    float max = 0.0f;
+    float maxError = 0.0f;
+    std::int8_t exponent = 0;  // Float16 时的缩放：值 = half * 2^exponent
+};
+
+// 分砖存储的多通道体素数据（值与相对误差）。体素按 brickSize³ 的砖块连续编码，
+// 常驻砖块不超过内存预算，最久未用的砖块写回磁盘缓存文件，再次访问时读回，
+// 大于内存的数据集也能浏览。每块的上下界供阈值查询跳过整块。非线程安全。
+class VoxelBrickStore {
+public:
+    VoxelBrickStore(std::array<std::size_t, 3> dims, std::size_t channels, VoxelStoreOptions options = {});
+    ~VoxelBrickStore();
+
+    VoxelBrickStore(const VoxelBrickStore&) = delete;
+    VoxelBrickStore& operator=(const VoxelBrickStore&) = delete;
+
+    void set(std::size_t x, std::size_t y, std::size_t z, std::size_t channel, float value, float error);
+    float value(std::size_t x, std::size_t y, std::size_t z, std::size_t channel);
+    float error(std::size_t x, std::size_t y, std::size_t z, std::size_t channel);
+
+    const std::array<std::size_t, 3>& dims() const noexcept { return dims_; }
+    std::size_t channels() const noexcept { return channels_; }
+    const VoxelStoreOptions& options() const noexcept { return options_; }
+
+    // 砖块按 (channel, bx, by, bz) 编号，bz 变化最快
+    std::size_t brickCount() const noexcept { return info_.size(); }
+    std::array<std::size_t, 3> bricksPerAxis() const noexcept { return bricks_; }
+    std::size_t brickIndex(std::size_t bx, std::size_t by, std::size_t bz, std::size_t channel) const;
+    const VoxelBrickInfo& brickInfo(std::size_t brick) const { return info_[brick]; }
+    std::size_t brickBytes() const noexcept { return brickBytes_; }
+    // 把砖块的全部值解码到 values（brickSize³ 个，顺序同 brickIndex 内的体素编号，z 最快），必要时换入
+    void readBrick(std::size_t brick, float* values);
+
+    // 通道的值范围（由砖块摘要汇总，不读体素）
+    std::pair<float, float> range(std::size_t channel) const;
+    // 值不低于 threshold 的体素数：上界低于阈值的砖块整块跳过，只换入可能命中的砖块
+    std::size_t countAtLeast(std::size_t channel, float threshold);
+    // axis 方向第 index 层的切片（行优先，余下两轴中前一轴为行）
+    std::vector<float> slice(std::size_t axis, std::size_t index, std::size_t channel);
+
+    // 把全部脏砖块写回缓存文件
+    void flush();
+    std::size_t residentBricks() const noexcept { return pages_.size(); }
+    std::size_t pageIns() const noexcept { return pageIns_; }
+    std::size_t pageOuts() const noexcept { return pageOuts_; }
+
+private:
+    struct Page {
+        std::size_t brick = 0;
+        bool dirty = false;
+        std::vector<std::uint8_t> data;
+    };
+
+    // 体素所在砖块及其在砖块内的下标
+    std::pair<std::size_t, std::size_t> locate(std::size_t x, std::size_t y, std::size_t z, std::size_t channel) const;
+    Page& page(std::size_t brick);
+    void evict();
+    void rescale(Page& page, VoxelBrickInfo& info, std::int8_t exponent);
+    float decodeValue(const Page& page, std::size_t voxel) const;
+    float decodeError(const Page& page, std::size_t voxel) const;
+
+    std::array<std::size_t, 3> dims_;
+    std::size_t channels_;
+    VoxelStoreOptions options_;
+    std::array<std::size_t, 3> bricks_{};
+    std::size_t voxelsPerBrick_ = 0;
+    std::size_t valueBytes_ = 0;
+    std::size_t errorBytes_ = 0;
+    std::size_t brickBytes_ = 0;
+    std::size_t maxPages_ = 1;
+
+    std::vector<VoxelBrickInfo> info_;
+    std::vector<std::uint8_t> onDisk_;  // 是否已写入缓存文件
+    std::list<Page> pages_;             // 最近使用的在前
+    std::unordered_map<std::size_t, std::list<Page>::iterator> resident_;
+    Page* last_ = nullptr;  // 上次访问的砖块：连续体素多落在同一砖块内，免去查表
+    std::fstream cache_;
+    bool ownsCache_ = false;
+    std::size_t pageIns_ = 0;
+    std::size_t pageOuts_ = 0;
+};
+
+} // namespace mcnp::core
+
+#endif // VOXEL_STORE_H
@@ -0,0 +1,313 @@
+#include "card_assembler.h"
+
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+
+namespace mcnp::parser {
+
+namespace {
+
+enum class Shorthand {
+    None,
+    Repeat,
+    Interpolate,
+    LogInterpolate,
+    Multiply,
+    Jump
+};
+
+struct ShorthandInfo {
+    Shorthand kind = Shorthand::None;
+    double value = 1.0;  // 次数或乘数
+};
+
+bool ends_with_ci(std::string_view text, std::string_view suffix) {
+    if (text.size() < suffix.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < suffix.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(text[text.size() - suffix.size() + i])) != suffix[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool parse_double(std::string_view text, double& value) {
+    if (text.empty()) {
+        return false;
+    }
+    const std::string copy(text);
+    char* end = nullptr;
+    value = std::strtod(copy.c_str(), &end);
+    return end == copy.c_str() + copy.size();
+}
+
+bool parse_count(std::string_view text, double& value) {
+    if (text.empty()) {
+        value = 1.0;
+        return true;
+    }
+    for (char ch : text) {
+        if (!std::isdigit(static_cast<unsigned char>(ch))) {
+            return false;
+        }
+    }
+    value = std::atof(std::string(text).c_str());
+    return true;
+}
+
+// ZAID 形如 92235.66m（m 为多群库后缀），不能当作乘法简写
+bool looks_like_zaid(std::string_view prefix) {
+    const auto dot = prefix.find('.');
+    if (dot == std::string_view::npos || dot < 4 || prefix.size() - dot - 1 != 2) {
+        return false;
+    }
+    for (std::size_t i = 0; i < prefix.size(); ++i) {
+        if (i != dot && !std::isdigit(static_cast<unsigned char>(prefix[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+ShorthandInfo classify(std::string_view token) {
+    ShorthandInfo info;
+    if (ends_with_ci(token, "ilog")) {
+        if (parse_count(token.substr(0, token.size() - 4), info.value)) {
+            info.kind = Shorthand::LogInterpolate;
+        }
+        return info;
+    }
+    if (token.empty()) {
+        return info;
+    }
+    const char suffix = static_cast<char>(std::tolower(static_cast<unsigned char>(token.back())));
+    const std::string_view prefix = token.substr(0, token.size() - 1);
+    switch (suffix) {
+        case 'r':
+            if (parse_count(prefix, info.value)) {
+                info.kind = Shorthand::Repeat;
+            }
+            break;
+        case 'i':
+            if (parse_count(prefix, info.value)) {
+                info.kind = Shorthand::Interpolate;
+            }
+            break;
+        case 'j':
+            if (parse_count(prefix, info.value)) {
+                info.kind = Shorthand::Jump;
+            }
+            break;
+        case 'm':
+            if (!looks_like_zaid(prefix) && parse_double(prefix, info.value)) {
+                info.kind = Shorthand::Multiply;
+            }
+            break;
+        default:
+            break;
+    }
+    return info;
+}
+
+std::string format_number(double value) {
+    char buffer[64];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    return std::string(buffer, result.ptr);
+}
+
+// 去掉 $ 之后的行内注释与行尾 &，返回是否有续行符
+std::string_view strip_line(std::string_view text, bool& continued) noexcept {
+    const auto dollar = text.find('$');
+    if (dollar != std::string_view::npos) {
+        text = text.substr(0, dollar);
+    }
+    std::size_t end = text.size();
+    while (end > 0 && std::isspace(static_cast<unsigned char>(text[end - 1]))) {
+        --end;
+    }
+    continued = end > 0 && text[end - 1] == '&';
+    return text.substr(0, continued ? end - 1 : end);
+}
+
+void append_tokens(const DeckLine& line, std::vector<Token>& tokens, bool& continued) {
+    DeckLine stripped = line;
+    stripped.text = strip_line(line.text, continued);
+    tokenizeLine(stripped, tokens);
+}
+
+} // namespace
+
+bool isCommentLine(std::string_view text) noexcept {
+    std::size_t i = 0;
+    while (i < text.size() && (text[i] == ' ' || text[i] == '\t')) {
+        ++i;
+    }
+    if (i >= text.size()) {
+        return false;
+    }
+    if (text[i] == '$') {
+        return true;
+    }
+    if (i >= 5 || (text[i] != 'c' && text[i] != 'C')) {
+        return false;
+    }
+    return i + 1 == text.size() || text[i + 1] == ' ' || text[i + 1] == '\t' || text[i + 1] == '\r';
+}
+
+bool isBlankContinuation(std::string_view text) noexcept {
+    std::size_t column = 0;
+    for (char ch : text) {
+        if (ch == ' ') {
+            ++column;
+        } else if (ch == '\t') {
+            column = (column / 8 + 1) * 8;
+        } else {
+            break;
+        }
+        if (column >= 5) {
+            return !isBlankLine(text);
+        }
+    }
+    return false;
+}
+
+bool endsWithContinuation(std::string_view text) noexcept {
+    bool continued = false;
+    strip_line(text, continued);
+    return continued;
+}
+
+bool CardAssembler::peek(DeckLine& line) {
+    if (!hasPending_) {
+        if (!scanner_.next(pending_)) {
+            return false;
+        }
+        hasPending_ = true;
+    }
+    line = pending_;
+    return true;
+}
+
+bool CardAssembler::nextRawLine(DeckLine& line) {
+    if (!peek(line)) {
+        return false;
+    }
+    consume();
+    return true;
+}
+
+bool CardAssembler::next(LogicalCard& card) {
+    DeckLine first;
+    if (!peek(first)) {
+        return false;
+    }
+    consume();
+    card.tokens.clear();
+    card.line = first.number;
+    card.lastLine = first.number;
+    card.offset = first.offset;
+    card.raw = first.text;
+
+    if (isBlankLine(first.text)) {
+        card.type = LogicalCard::Type::Blank;
+        return true;
+    }
+    if (isCommentLine(first.text)) {
+        card.type = LogicalCard::Type::Comment;
+        return true;
+    }
+
+    card.type = LogicalCard::Type::Card;
+    bool continued = false;
+    append_tokens(first, card.tokens, continued);
+    DeckLine last = first;
+
+    DeckLine line;
+    while (peek(line)) {
+        if (isBlankLine(line.text)) {
+            break;
+        }
+        if (continued) {
+            // & 之后的注释行不打断续行
+            consume();
+            if (!isCommentLine(line.text)) {
+                append_tokens(line, card.tokens, continued);
+                last = line;
+            }
+            continue;
+        }
+        if (!isBlankContinuation(line.text) || isCommentLine(line.text)) {
+            break;
+        }
+        consume();
+        append_tokens(line, card.tokens, continued);
+        last = line;
+    }
+
+    card.lastLine = last.number;
+    card.raw = text_.substr(first.offset, last.offset + last.text.size() - first.offset);
+    return true;
+}
+
+bool isShorthandToken(std::string_view token) {
+    if (token.empty() || std::isdigit(static_cast<unsigned char>(token.back())) || token.back() == '.') {
+        return false;
+    }
+    return classify(token).kind != Shorthand::None;
+}
+
+std::vector<std::string> expandShorthand(const std::vector<std::string_view>& tokens) {
+    std::vector<std::string> out;
+    out.reserve(tokens.size());
+    for (std::size_t i = 0; i < tokens.size(); ++i) {
+        const ShorthandInfo info = classify(tokens[i]);
+        const int count = static_cast<int>(info.value);
+        double previous = 0.0;
+        const bool havePrevious = !out.empty() && parse_double(out.back(), previous);
+
+        switch (info.kind) {
+            case Shorthand::Repeat:
+                if (!out.empty()) {
+                    const std::string value = out.back();
+                    out.insert(out.end(), static_cast<std::size_t>(count), value);
+                    continue;
+                }
+                break;
+            case Shorthand::Jump:
+                out.insert(out.end(), static_cast<std::size_t>(count), "j");
+                continue;
+            case Shorthand::Multiply:
+                if (havePrevious) {
+                    out.push_back(format_number(previous * info.value));
+                    continue;
+                }
+                break;
+            case Shorthand::Interpolate:
+            case Shorthand::LogInterpolate: {
+                double next = 0.0;
+                const bool log = info.kind == Shorthand::LogInterpolate;
+                if (havePrevious && i + 1 < tokens.size() && parse_double(tokens[i + 1], next) &&
+                    (!log || (previous > 0.0 && next > 0.0))) {
+                    for (int k = 1; k <= count; ++k) {
+                        const double f = static_cast<double>(k) / (count + 1);
+                        const double value = log ? std::exp(std::log(previous) + f * (std::log(next) - std::log(previous)))
+                                                 : previous + f * (next - previous);
+                        out.push_back(format_number(value));
+                    }
+                    continue;
+                }
+                break;
+            }
+            case Shorthand::None:
+                break;
+        }
+        out.emplace_back(tokens[i]);
+    }
+    return out;
+}
+
+} // namespace mcnp::parser
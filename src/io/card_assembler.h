@@ -0,0 +1,67 @@
+#ifndef CARD_ASSEMBLER_H
+#define CARD_ASSEMBLER_H
+
+#include "deck_tokenizer.h"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mcnp::parser {
+
+// 由若干物理行拼成的逻辑卡片
+struct LogicalCard {
+    enum class Type {
+        Card,
+        Comment,
+        Blank  // 空行：块分隔符
+    };
+
+    Type type = Type::Card;
+    std::size_t line = 0;       // 首行行号
+    std::size_t lastLine = 0;   // 末行行号
+    std::size_t offset = 0;     // 首行在输入中的字节偏移
+    std::string_view raw;       // 从首行行首到末行行尾的原始文本
+    std::vector<Token> tokens;  // 已去掉 $ 注释与续行符 &
+};
+
+// 逻辑卡片拼装：处理 & 续行、行首 5 个空格续行、$ 行内注释与 c 注释行
+class CardAssembler {
+public:
+    explicit CardAssembler(std::string_view text, std::size_t firstLine = 1) noexcept
+        : text_(text), scanner_(text, firstLine) {}
+
+    bool next(LogicalCard& card);
+    // 直接读取下一物理行（标题卡、message 块）
+    bool nextRawLine(DeckLine& line);
+
+    // 下一条未读物理行的字节偏移与行号
+    std::size_t position() const noexcept { return hasPending_ ? pending_.offset : scanner_.position(); }
+    std::size_t nextLineNumber() const noexcept { return hasPending_ ? pending_.number : scanner_.lineNumber() + 1; }
+
+private:
+    bool peek(DeckLine& line);
+    void consume() { hasPending_ = false; }
+
+    std::string_view text_;
+    LineScanner scanner_;
+    DeckLine pending_;
+    bool hasPending_{false};
+};
+
+// c/C 出现在前 5 列且其后为空白，或首个非空白字符为 $
+bool isCommentLine(std::string_view text) noexcept;
+// 行首至少 5 个空白（制表符按跳到下一个 8 列计）
+bool isBlankContinuation(std::string_view text) noexcept;
+// 去掉 $ 注释后以 & 结尾
+bool endsWithContinuation(std::string_view text) noexcept;
+
+// 重复/插值简写：nR、nI、nILOG、xM、nJ
+bool isShorthandToken(std::string_view token);
+// 展开简写；无法展开的词元原样保留
+std::vector<std::string> expandShorthand(const std::vector<std::string_view>& tokens);
+
+} // namespace mcnp::parser
+
+#endif // CARD_ASSEMBLER_H
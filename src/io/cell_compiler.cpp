@@ -0,0 +1,715 @@
+#include "cell_compiler.h"
+#include "cell_bounds.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <limits>
+#include <string>
+#include <string_view>
+
+namespace mcnp::parser {
+
+namespace {
+
+using mcnp::core::CsgDag;
+using NodeId = CsgDag::NodeId;
+
+bool parse_int(std::string_view text, int& value) {
+    const auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+bool parse_double(std::string_view text, double& value) {
+    const auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+// 几何表达式之后的参数（IMP:N=1、U=2、FILL=...）以字母或 * 开头
+bool is_geometry_token(std::string_view text) {
+    const char first = text.front();
+    return std::isdigit(static_cast<unsigned char>(first)) || first == '-' || first == '+' || first == '(' ||
+           first == ')' || first == ':' || first == '#';
+}
+
+bool equals_ci(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool starts_with_ci(std::string_view text, std::string_view prefix) {
+    return text.size() >= prefix.size() && equals_ci(text.substr(0, prefix.size()), prefix);
+}
+
+// 从 first 起查找 name=（支持 "u=2"、"u= 2"、"u =2"、"u = 2"），value 为等号后的第一段文本，next 为其后参数的下标
+bool find_keyword(const CardView& card, std::size_t first, std::string_view name, std::string_view& value,
+                  std::size_t& next) {
+    const std::size_t count = card.parameterCount();
+    for (std::size_t i = first; i < count; ++i) {
+        std::string_view text = card.parameter(i);
+        if (!text.empty() && text.front() == '*') {
+            text.remove_prefix(1);
+        }
+        if (!starts_with_ci(text, name)) {
+            continue;
+        }
+        std::string_view rest = text.substr(name.size());
+        if (name.back() == ':') {
+            // 跳过粒子标识符（IMP:N、IMP:N,P）
+            rest.remove_prefix(std::min(rest.find('='), rest.size()));
+        }
+        next = i + 1;
+        if (rest.empty() && next < count && card.parameter(next).front() == '=') {
+            rest = card.parameter(next++);
+        }
+        if (rest.empty() || rest.front() != '=') {
+            continue;
+        }
+        rest.remove_prefix(1);
+        if (rest.empty() && next < count) {
+            rest = card.parameter(next++);
+        }
+        value = rest;
+        return true;
+    }
+    return false;
+}
+
+// name=value 的整数值（FILL=3 (...) 中取前导整数）
+bool keyword_value(const CardView& card, std::size_t first, std::string_view name, int& value) {
+    std::string_view rest;
+    std::size_t next = 0;
+    if (!find_keyword(card, first, name, rest, next)) {
+        return false;
+    }
+    const auto parsed = std::from_chars(rest.data(), rest.data() + rest.size(), value);
+    return parsed.ec == std::errc() && parsed.ptr != rest.data();
+}
+
+bool keyword_double(const CardView& card, std::size_t first, std::string_view name, double& value) {
+    std::string_view rest;
+    std::size_t next = 0;
+    return find_keyword(card, first, name, rest, next) && parse_double(rest, value);
+}
+
+// 数组中的 nR：重复前一项 n 次
+bool repeat_count(std::string_view token, int& count) {
+    if (token.size() < 2 || (token.back() != 'r' && token.back() != 'R')) {
+        return false;
+    }
+    return parse_int(token.substr(0, token.size() - 1), count) && count > 0;
+}
+
+enum class State : std::uint8_t {
+    Pending,
+    Compiling,
+    Done
+};
+
+class Compiler {
+public:
+    Compiler(const Ast& ast, CellCompileResult& result) : ast_(ast), result_(result) {}
+
+    void run() {
+        for (std::size_t i = 0; i < ast_.cardCount(); ++i) {
+            addCard(i, true);
+        }
+        compilePending();
+    }
+
+    // 沿用 previous 中不在窗口 [first, last) 且不在 dirty 中的单元
+    void update(std::size_t first, std::size_t last, const std::unordered_set<int>& dirty,
+                std::vector<CompiledCell>& previous, const std::unordered_map<int, std::size_t>& previousIndex) {
+        std::unordered_set<std::size_t> lines;
+        for (std::size_t i = 0; i < ast_.cardCount(); ++i) {
+            const bool inWindow = i >= first && i < last;
+            if (!addCard(i, inWindow)) {
+                continue;
+            }
+            CompiledCell& cell = result_.cells.back();
+            const auto old = previousIndex.find(cell.id);
+            if (!inWindow && dirty.count(cell.id) == 0 && old != previousIndex.end()) {
+                cell = std::move(previous[old->second]);
+                cell.card = i;
+                states_.back() = State::Done;
+            } else {
+                lines.insert(ast_.card(i).line());
+            }
+        }
+        auto& errors = result_.errors;
+        errors.erase(std::remove_if(errors.begin(), errors.end(),
+                                    [&](const ParseError& e) { return e.source.empty() && lines.count(e.line) != 0; }),
+                     errors.end());
+        compilePending();
+    }
+
+    // 窗口内单元号与顺序不变：原地平移卡片下标，只重新编译窗口与 dirty 中的单元
+    void recompile(std::size_t begin, const std::vector<std::size_t>& windowCards, std::ptrdiff_t cardDelta,
+                   const std::unordered_set<int>& dirty) {
+        auto& cells = result_.cells;
+        states_.assign(cells.size(), State::Done);
+        for (std::size_t k = begin + windowCards.size(); k < cells.size() && cardDelta != 0; ++k) {
+            cells[k].card = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(cells[k].card) + cardDelta);
+        }
+        std::vector<std::size_t> pending;
+        for (std::size_t k = 0; k < windowCards.size(); ++k) {
+            cells[begin + k].card = windowCards[k];
+            pending.push_back(begin + k);
+        }
+        for (const int id : dirty) {
+            const auto it = result_.index.find(id);
+            if (it != result_.index.end()) {
+                pending.push_back(it->second);
+            }
+        }
+
+        std::unordered_set<std::size_t> lines;
+        for (const std::size_t index : pending) {
+            CompiledCell& cell = cells[index];
+            CompiledCell reset;
+            reset.id = cell.id;
+            reset.card = cell.card;
+            cell = std::move(reset);
+            states_[index] = State::Pending;
+            lines.insert(ast_.card(cell.card).line());
+        }
+        auto& errors = result_.errors;
+        errors.erase(std::remove_if(errors.begin(), errors.end(),
+                                    [&](const ParseError& e) { return e.source.empty() && lines.count(e.line) != 0; }),
+                     errors.end());
+        for (const std::size_t index : pending) {
+            compileCell(index);
+        }
+    }
+
+private:
+    bool addCard(std::size_t i, bool report) {
+        const CardView card = ast_.card(i);
+        if (card.kind() != CardKind::Cell) {
+            return false;
+        }
+        int id = 0;
+        if (!parse_int(card.keyword(), id) || id <= 0) {
+            if (report) {
+                error(card, "invalid cell number " + std::string(card.keyword()));
+            }
+            return false;
+        }
+        if (result_.index.count(id) != 0) {
+            if (report) {
+                error(card, "duplicate cell " + std::to_string(id));
+            }
+            return false;
+        }
+        CompiledCell cell;
+        cell.id = id;
+        cell.card = i;
+        result_.index.emplace(id, result_.cells.size());
+        result_.cells.push_back(std::move(cell));
+        states_.push_back(State::Pending);
+        return true;
+    }
+
+    void compilePending() {
+        for (std::size_t i = 0; i < result_.cells.size(); ++i) {
+            compileCell(i);
+        }
+    }
+
+    void error(const CardView& card, std::string message) {
+        result_.errors.push_back({card.line(), std::move(message), std::string(card.source())});
+    }
+
+    // 返回单元区域；循环引用或未定义时返回空集并记录错误
+    NodeId regionOf(int id, const CardView& from) {
+        const auto it = result_.index.find(id);
+        if (it == result_.index.end()) {
+            error(from, "reference to undefined cell " + std::to_string(id));
+            return result_.dag.empty();
+        }
+        if (states_[it->second] == State::Compiling) {
+            error(from, "cyclic cell complement involving cell " + std::to_string(id));
+            return result_.dag.empty();
+        }
+        const std::size_t current = current_;
+        compileCell(it->second);
+        current_ = current;
+        return result_.cells[it->second].region;
+    }
+
+    void compileCell(std::size_t index) {
+        if (states_[index] != State::Pending) {
+            return;
+        }
+        states_[index] = State::Compiling;
+        const int id = result_.cells[index].id;
+        const CardView card = ast_.card(result_.cells[index].card);
+        const std::size_t count = card.parameterCount();
+        result_.cells[index].surfaces.clear();
+        result_.cells[index].references.clear();
+        current_ = index;
+
+        NodeId region = result_.dag.empty();
+        std::size_t keywords = count;  // 几何表达式之后第一个参数的位置
+        if (count >= 2 && equals_ci(card.parameter(0), "like")) {
+            int base = 0;
+            if (!parse_int(card.parameter(1), base)) {
+                error(card, "invalid LIKE reference on cell " + std::to_string(id));
+            } else {
+                result_.cells[index].references.push_back(base);
+                region = regionOf(base, card);
+                const auto it = result_.index.find(base);
+                if (it != result_.index.end()) {
+                    const CompiledCell& like = result_.cells[it->second];
+                    result_.cells[index].material = like.material;
+                    result_.cells[index].density = like.density;
+                    result_.cells[index].universe = like.universe;
+                    result_.cells[index].fill = like.fill;
+                    result_.cells[index].lattice = like.lattice;
+                    result_.cells[index].fillLower = like.fillLower;
+                    result_.cells[index].fillUpper = like.fillUpper;
+                    result_.cells[index].fillArray = like.fillArray;
+                    result_.cells[index].importance = like.importance;
+                }
+            }
+            keywords = 2;
+            // BUT 之后的 MAT= 与 RHO= 改写从基准单元复制的材料与密度
+            CompiledCell& cell = result_.cells[index];
+            if (keyword_value(card, keywords, "mat", cell.material) && cell.material == 0) {
+                cell.density = 0.0;
+            }
+            keyword_double(card, keywords, "rho", cell.density);
+        } else {
+            std::size_t first = 0;
+            int material = 0;
+            if (count == 0 || !parse_int(card.parameter(0), material)) {
+                error(card, "cell " + std::to_string(id) + " has no material number");
+            } else {
+                first = 1;
+                double density = 0.0;
+                if (material != 0) {
+                    if (count < 2 || !parse_double(card.parameter(1), density)) {
+                        error(card, "cell " + std::to_string(id) + " has no density");
+                    }
+                    first = 2;
+                }
+                result_.cells[index].material = material;
+                result_.cells[index].density = density;
+            }
+
+            std::string text;
+            keywords = first;
+            for (; keywords < count; ++keywords) {
+                const std::string_view token = card.parameter(keywords);
+                if (!is_geometry_token(token)) {
+                    break;
+                }
+                text += token;
+                text += ' ';
+            }
+            Lexer lexer{text, 0};
+            region = parseUnion(lexer, card);
+            lexer.skipSpace();
+            if (lexer.position < text.size()) {
+                error(card, "unexpected '" + std::string(1, text[lexer.position]) + "' in cell " +
+                                std::to_string(id));
+            }
+        }
+
+        CompiledCell& cell = result_.cells[index];
+        keyword_value(card, keywords, "u", cell.universe);
+        keyword_value(card, keywords, "lat", cell.lattice);
+        if (double importance = 0.0; keyword_double(card, keywords, "imp:", importance)) {
+            cell.importance = importance;
+        }
+        readFill(card, keywords, cell);
+        auto unique = [](std::vector<int>& values) {
+            std::sort(values.begin(), values.end());
+            values.erase(std::unique(values.begin(), values.end()), values.end());
+        };
+        unique(cell.surfaces);
+        unique(cell.references);
+        cell.region = region;
+        states_[index] = State::Done;
+    }
+
+    // FILL 的值：单个宇宙 u（其后的 (n) 或 (...) 变换被忽略），或 i1:i2 j1:j2 k1:k2 之后的宇宙数组。
+    // 数组中的 nR 重复前一项，元素后的 (...) 变换被忽略
+    void readFill(const CardView& card, std::size_t first, CompiledCell& cell) {
+        std::string_view value;
+        std::size_t next = 0;
+        if (!find_keyword(card, first, "fill", value, next)) {
+            return;
+        }
+        if (value.find(':') == std::string_view::npos) {
+            int universe = 0;
+            const auto parsed = std::from_chars(value.data(), value.data() + value.size(), universe);
+            if (parsed.ec != std::errc() || parsed.ptr == value.data()) {
+                error(card, "invalid FILL on cell " + std::to_string(cell.id));
+                return;
+            }
+            cell.fill = universe;
+            cell.fillArray.clear();
+            return;
+        }
+
+        std::vector<std::string_view> values{value};
+        for (; next < card.parameterCount() && is_geometry_token(card.parameter(next)); ++next) {
+            values.push_back(card.parameter(next));
+        }
+        glm::ivec3 lower(0);
+        glm::ivec3 upper(0);
+        std::size_t expected = 1;
+        for (int axis = 0; axis < 3; ++axis) {
+            const std::string_view range = axis < static_cast<int>(values.size()) ? values[axis] : std::string_view();
+            const std::size_t colon = range.find(':');
+            if (colon == std::string_view::npos || !parse_int(range.substr(0, colon), lower[axis]) ||
+                !parse_int(range.substr(colon + 1), upper[axis]) || upper[axis] < lower[axis]) {
+                error(card, "invalid FILL range \"" + std::string(range) + "\" on cell " + std::to_string(cell.id));
+                return;
+            }
+            expected *= static_cast<std::size_t>(upper[axis] - lower[axis] + 1);
+        }
+        std::vector<int> entries;
+        entries.reserve(expected);
+        bool inParens = false;
+        for (std::size_t v = 3; v < values.size(); ++v) {
+            const std::string_view token = values[v];
+            if (inParens || token.front() == '(') {
+                inParens = token.back() != ')';
+                continue;
+            }
+            int repeat = 0;
+            if (repeat_count(token, repeat) && !entries.empty()) {
+                entries.insert(entries.end(), static_cast<std::size_t>(repeat), entries.back());
+                continue;
+            }
+            int universe = 0;
+            const auto parsed = std::from_chars(token.data(), token.data() + token.size(), universe);
+            if (parsed.ec != std::errc() || parsed.ptr == token.data()) {
+                error(card, "invalid FILL entry " + std::string(token) + " on cell " + std::to_string(cell.id));
+                return;
+            }
+            inParens = parsed.ptr != token.data() + token.size() && *parsed.ptr == '(' && token.back() != ')';
+            entries.push_back(universe);
+        }
+        if (entries.size() != expected) {
+            error(card, "FILL array of cell " + std::to_string(cell.id) + " has " + std::to_string(entries.size()) +
+                            " entries, its ranges need " + std::to_string(expected));
+            return;
+        }
+        cell.fill = 0;
+        cell.fillLower = lower;
+        cell.fillUpper = upper;
+        cell.fillArray = std::move(entries);
+    }
+
+    struct Lexer {
+        std::string_view text;
+        std::size_t position = 0;
+
+        void skipSpace() {
+            while (position < text.size() && text[position] == ' ') {
+                ++position;
+            }
+        }
+        char peek() {
+            skipSpace();
+            return position < text.size() ? text[position] : '\0';
+        }
+    };
+
+    // union := intersection (':' intersection)*
+    NodeId parseUnion(Lexer& lexer, const CardView& card) {
+        std::vector<NodeId> terms{parseIntersection(lexer, card)};
+        while (lexer.peek() == ':') {
+            ++lexer.position;
+            terms.push_back(parseIntersection(lexer, card));
+        }
+        return terms.size() == 1 ? terms.front() : result_.dag.unite(terms);
+    }
+
+    // intersection := unary+（并列即求交）
+    NodeId parseIntersection(Lexer& lexer, const CardView& card) {
+        std::vector<NodeId> factors;
+        for (;;) {
+            const char next = lexer.peek();
+            if (next == '\0' || next == ':' || next == ')') {
+                break;
+            }
+            const std::size_t before = lexer.position;
+            factors.push_back(parseUnary(lexer, card));
+            if (lexer.position == before) {
+                break;
+            }
+        }
+        if (factors.empty()) {
+            error(card, "empty geometry expression");
+            return result_.dag.empty();
+        }
+        return factors.size() == 1 ? factors.front() : result_.dag.intersection(factors);
+    }
+
+    // unary := '#' number | '#' '(' union ')' | '(' union ')' | [+-]surface[.facet]
+    NodeId parseUnary(Lexer& lexer, const CardView& card) {
+        const char next = lexer.peek();
+        if (next == '(') {
+            ++lexer.position;
+            const NodeId inner = parseUnion(lexer, card);
+            expectClose(lexer, card);
+            return inner;
+        }
+        if (next == '#') {
+            ++lexer.position;
+            if (lexer.peek() == '(') {
+                ++lexer.position;
+                const NodeId inner = parseUnion(lexer, card);
+                expectClose(lexer, card);
+                return result_.dag.complement(inner);
+            }
+            int id = 0;
+            if (!readInteger(lexer, id)) {
+                error(card, "expected cell number after '#'");
+                return result_.dag.empty();
+            }
+            result_.cells[current_].references.push_back(id);
+            return result_.dag.complement(regionOf(id, card));
+        }
+
+        bool negative = false;
+        if (next == '-' || next == '+') {
+            negative = next == '-';
+            ++lexer.position;
+        }
+        int surface = 0;
+        if (!readInteger(lexer, surface)) {
+            error(card, "expected surface number");
+            return result_.dag.empty();
+        }
+        int facet = 0;
+        if (lexer.position < lexer.text.size() && lexer.text[lexer.position] == '.') {
+            ++lexer.position;
+            if (!readInteger(lexer, facet)) {
+                error(card, "invalid macrobody facet on surface " + std::to_string(surface));
+            }
+        }
+        result_.cells[current_].surfaces.push_back(surface);
+        return result_.dag.halfspace(surface, negative, facet);
+    }
+
+    static bool readInteger(Lexer& lexer, int& value) {
+        const char* begin = lexer.text.data() + lexer.position;
+        const char* end = lexer.text.data() + lexer.text.size();
+        const auto parsed = std::from_chars(begin, end, value);
+        if (parsed.ec != std::errc() || parsed.ptr == begin) {
+            return false;
+        }
+        lexer.position += static_cast<std::size_t>(parsed.ptr - begin);
+        return true;
+    }
+
+    void expectClose(Lexer& lexer, const CardView& card) {
+        if (lexer.peek() == ')') {
+            ++lexer.position;
+        } else {
+            error(card, "missing ')'");
+        }
+    }
+
+    const Ast& ast_;
+    CellCompileResult& result_;
+    std::vector<State> states_;
+    std::size_t current_ = 0;  // 正在解析表达式的单元
+};
+
+} // namespace
+
+const CompiledCell* CellCompileResult::find(int id) const {
+    const auto it = index.find(id);
+    return it == index.end() ? nullptr : &cells[it->second];
+}
+
+CellCompileResult compileCells(const Ast& ast) {
+    CellCompileResult result;
+    Compiler(ast, result).run();
+    return result;
+}
+
+void updateCells(const Ast& ast, std::size_t first, std::size_t last, std::ptrdiff_t cardDelta,
+                 const std::unordered_set<int>& dirty, CellCompileResult& result) {
+    // 旧窗口中的单元在 cells 中连续（按卡片顺序）
+    const std::size_t oldLast = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(last) - cardDelta);
+    auto& cells = result.cells;
+    const auto by_card = [](const CompiledCell& cell, std::size_t card) { return cell.card < card; };
+    const std::size_t begin =
+        static_cast<std::size_t>(std::lower_bound(cells.begin(), cells.end(), first, by_card) - cells.begin());
+    const std::size_t end =
+        static_cast<std::size_t>(std::lower_bound(cells.begin(), cells.end(), oldLast, by_card) - cells.begin());
+
+    std::vector<std::size_t> windowCards;
+    bool sameIds = true;
+    for (std::size_t i = first; i < last && sameIds; ++i) {
+        const CardView card = ast.card(i);
+        if (card.kind() != CardKind::Cell) {
+            continue;
+        }
+        int id = 0;
+        const std::size_t k = begin + windowCards.size();
+        sameIds = parse_int(card.keyword(), id) && k < end && cells[k].id == id;
+        windowCards.push_back(i);
+    }
+    if (sameIds && begin + windowCards.size() == end) {
+        Compiler(ast, result).recompile(begin, windowCards, cardDelta, dirty);
+        return;
+    }
+
+    std::vector<CompiledCell> previous = std::move(result.cells);
+    const std::unordered_map<int, std::size_t> previousIndex = std::move(result.index);
+    result.cells.clear();
+    result.index.clear();
+    result.cells.reserve(previous.size());
+    result.index.reserve(previousIndex.size());
+    Compiler(ast, result).update(first, last, dirty, previous, previousIndex);
+}
+
+std::vector<CompiledLattice> compileLattices(const CellCompileResult& cells, const mcnp::core::SurfaceTable& surfaces,
+                                             std::vector<std::string>* warnings) {
+    auto warn = [&](std::string message) {
+        if (warnings) {
+            warnings->push_back(std::move(message));
+        }
+    };
+    std::vector<CompiledLattice> lattices;
+    mcnp::core::CellBounds bounds(cells.dag, surfaces);
+    for (const CompiledCell& cell : cells.cells) {
+        if (cell.lattice == 0) {
+            continue;
+        }
+        const std::string name = "lattice cell " + std::to_string(cell.id);
+        if (cell.lattice != 1 && cell.lattice != 2) {
+            warn(name + " has unknown LAT=" + std::to_string(cell.lattice));
+            continue;
+        }
+        if (cell.universe == 0) {
+            warn(name + " has no U= and cannot be filled into another cell");
+            continue;
+        }
+        if (cell.fillArray.empty() && cell.fill == 0) {
+            warn(name + " has no FILL");
+            continue;
+        }
+
+        CompiledLattice lattice;
+        lattice.cell = cell.id;
+        lattice.universe = cell.universe;
+        mcnp::core::LatticeSpec& spec = lattice.spec;
+        spec.type = cell.lattice == 1 ? mcnp::core::LatticeType::Rectangular : mcnp::core::LatticeType::Hexagonal;
+
+        const mcnp::core::Aabb box =
+            cell.region == mcnp::core::CsgDag::kInvalid ? mcnp::core::Aabb() : bounds.bounds(cell.region);
+        if (box.empty()) {
+            warn(name + " has an empty element");
+            continue;
+        }
+        const double limit = std::numeric_limits<double>::max() * 0.5;
+        spec.pitch = glm::dvec3(0.0);
+        for (int axis = 0; axis < 3; ++axis) {
+            if (box.min[axis] > -limit && box.max[axis] < limit) {
+                spec.pitch[axis] = box.max[axis] - box.min[axis];
+                lattice.origin[axis] = 0.5 * (box.min[axis] + box.max[axis]);
+            }
+        }
+        if (spec.type == mcnp::core::LatticeType::Hexagonal) {
+            if (spec.pitch.x <= 0.0) {
+                warn(name + " is a hexagonal lattice whose element is not bounded in x");
+                continue;
+            }
+            if (spec.pitch.y <= 0.0) {
+                // 斜面围成的 y 向范围区间传播得不到：在有界盒内收缩求出元素中心
+                mcnp::core::CellBoundsOptions options;
+                options.slices = 32;
+                options.passes = 16;
+                const double reach = 64.0 * spec.pitch.x;
+                options.world.min = glm::dvec3(box.min.x, -reach, spec.pitch.z > 0.0 ? box.min.z : -spec.pitch.x);
+                options.world.max = glm::dvec3(box.max.x, reach, spec.pitch.z > 0.0 ? box.max.z : spec.pitch.x);
+                const mcnp::core::Aabb element =
+                    mcnp::core::CellBounds(cells.dag, surfaces, options).bounds(cell.region);
+                if (!element.empty()) {
+                    lattice.origin.y = 0.5 * (element.min.y + element.max.y);
+                }
+            }
+        }
+
+        if (cell.fillArray.empty()) {
+            spec.fill = {cell.fill == cell.universe ? -1 : cell.fill};
+        } else {
+            spec.lower = cell.fillLower;
+            spec.upper = cell.fillUpper;
+            spec.fill.reserve(cell.fillArray.size());
+            for (const int universe : cell.fillArray) {
+                spec.fill.push_back(universe == 0 || universe == cell.universe ? -1 : universe);
+            }
+        }
+        lattices.push_back(std::move(lattice));
+    }
+    return lattices;
+}
+
+bool buildUniverses(const CellCompileResult& cells, const mcnp::core::SurfaceTable& surfaces,
+                    mcnp::core::UniverseResolver& resolver, std::vector<std::string>* warnings) {
+    resolver.clear();
+    std::unordered_map<int, const CompiledLattice*> latticeOf;
+    const std::vector<CompiledLattice> lattices = compileLattices(cells, surfaces, warnings);
+    for (const CompiledLattice& lattice : lattices) {
+        latticeOf.emplace(lattice.cell, &lattice);
+    }
+
+    std::unordered_map<int, mcnp::core::Universe> universes;
+    universes[0].id = 0;
+    mcnp::core::CellBounds bounds(cells.dag, surfaces);
+    const CsgDag* dag = &cells.dag;
+    const mcnp::core::SurfaceTable* table = &surfaces;
+    for (const CompiledCell& cell : cells.cells) {
+        if (cell.region == CsgDag::kInvalid) {
+            continue;
+        }
+        mcnp::core::Universe& universe = universes[cell.universe];
+        universe.id = cell.universe;
+        mcnp::core::UniverseCell entry;
+        entry.id = cell.id;
+        entry.material = cell.material;
+        if (cell.lattice != 0) {
+            // 栅格铺满 LAT 单元所在的宇宙，单元区域只确定元素 (0,0,0)
+            const auto it = latticeOf.find(cell.id);
+            if (it == latticeOf.end()) {
+                continue;
+            }
+            entry.lattice = it->second->spec;
+            entry.fillTransform[3] = glm::dvec4(it->second->origin, 1.0);
+        } else {
+            const NodeId region = cell.region;
+            entry.contains = [dag, table, region](const glm::dvec3& p) { return dag->contains(region, p, *table); };
+            const mcnp::core::Aabb box = bounds.bounds(region);
+            if (box.isFinite()) {
+                entry.bounds = box;
+            }
+            if (cell.fill != 0 && cell.fill != cell.universe) {
+                entry.fill = cell.fill;
+            }
+        }
+        universe.cells.push_back(std::move(entry));
+    }
+    for (auto& [id, universe] : universes) {
+        resolver.addUniverse(std::move(universe));
+    }
+    return resolver.build(warnings);
+}
+
+} // namespace mcnp::parser
@@ -0,0 +1,76 @@
+#ifndef CELL_COMPILER_H
+#define CELL_COMPILER_H
+
+#include "csg_dag.h"
+#include "mcnp_parser.h"
+#include "surface_table.h"
+#include "universe_resolver.h"
+
+#include <glm/glm.hpp>
+
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace mcnp::parser {
+
+struct CompiledCell {
+    int id = 0;
+    int material = 0;
+    double density = 0.0;
+    mcnp::core::CsgDag::NodeId region = mcnp::core::CsgDag::kInvalid;
+    std::size_t card = 0;  // 在 AST 中的卡片下标
+    int universe = 0;      // U=，0 为真实世界
+    int fill = 0;          // FILL= 的宇宙号，0 表示未填充（带数组的栅格单元也为 0）
+    int lattice = 0;       // LAT=：1 为六面体栅格，2 为六角栅格
+    glm::ivec3 fillLower{0};     // FILL 数组的下标范围 [fillLower, fillUpper]
+    glm::ivec3 fillUpper{0};
+    std::vector<int> fillArray;  // FILL 数组中各元素的宇宙号，i 变化最快；0 表示元素不存在
+    std::optional<double> importance;  // 单元卡片上的 IMP:（多个粒子时取第一个），未写时由 IMP 数据卡给出
+    std::vector<int> surfaces;    // 几何表达式直接引用的曲面
+    std::vector<int> references;  // #n 与 LIKE n 引用的单元
+};
+
+struct CellCompileResult {
+    mcnp::core::CsgDag dag;
+    std::vector<CompiledCell> cells;           // 与卡片顺序一致
+    std::unordered_map<int, std::size_t> index;  // 单元号 -> cells 下标
+    std::vector<ParseError> errors;
+
+    const CompiledCell* find(int id) const;
+};
+
+// 把单元卡片的几何表达式（交、: 并、括号、#n / #(...) 补）编译到共享的 CSG DAG。
+// #n 与 LIKE n BUT 的展开按单元号缓存，补运算按 De Morgan 律下推。
+CellCompileResult compileCells(const Ast& ast);
+
+// 增量更新：卡片 [first, last) 中的单元与 dirty 中的单元重新编译，其余单元沿用原有区域与依赖。
+// cardDelta 为窗口卡片数的变化（新窗口减旧窗口）；窗口内单元号不变时原地更新，不重建索引。
+// 重新编译的单元在其卡片行上的旧错误会被清除；DAG 只增不减，旧区域节点仍然有效。
+void updateCells(const Ast& ast, std::size_t first, std::size_t last, std::ptrdiff_t cardDelta,
+                 const std::unordered_set<int>& dirty, CellCompileResult& result);
+
+// LAT 单元描述的栅格。元素 (0,0,0) 即 LAT 单元的区域：其包围盒中心为 origin，六面体栅格的间距取
+// 包围盒各轴的边长，六角栅格取 x 向边长为对边距（侧面垂直于 x 轴）；无界的轴间距为 0。
+// FILL 数组中的 0 与 LAT 单元自身的宇宙写成 -1（空元素）；FILL=u 得到只含元素 (0,0,0) 的栅格。
+struct CompiledLattice {
+    int cell = 0;
+    int universe = 0;  // LAT 单元的 U=；FILL= 此号的单元由该栅格填充
+    mcnp::core::LatticeSpec spec;
+    glm::dvec3 origin{0.0};  // 元素 (0,0,0) 的中心在 universe 坐标系中的位置
+};
+
+std::vector<CompiledLattice> compileLattices(const CellCompileResult& cells, const mcnp::core::SurfaceTable& surfaces,
+                                             std::vector<std::string>* warnings = nullptr);
+
+// 按 U= 把单元分成嵌套宇宙：FILL=u 的单元填充宇宙 u，LAT 单元按 compileLattices 展开为铺满所在宇宙的栅格。
+// 单元的内外判定引用 cells.dag 与 surfaces，二者须比 resolver 存活更久；FILL 上的坐标变换暂不支持。
+// 先清空 resolver，返回 build 的结果，校验错误与栅格警告写入 warnings
+bool buildUniverses(const CellCompileResult& cells, const mcnp::core::SurfaceTable& surfaces,
+                    mcnp::core::UniverseResolver& resolver, std::vector<std::string>* warnings = nullptr);
+
+} // namespace mcnp::parser
+
+#endif // CELL_COMPILER_H
@@ -0,0 +1,418 @@
+#include "cell_mesher.h"
+#include "cell_bounds.h"
+
+#include <manifold/manifold.h>
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <unordered_set>
+
+namespace mcnp::parser {
+
+namespace {
+
+using mcnp::core::Aabb;
+using mcnp::core::CsgDag;
+using mcnp::core::CsgNode;
+using mcnp::core::CsgOp;
+using mcnp::core::SurfaceTable;
+using mcnp::core::SurfaceType;
+using NodeId = CsgDag::NodeId;
+using manifold::Manifold;
+
+std::uint64_t mix(std::uint64_t h, std::uint64_t v) {
+    h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+    return h * 0xff51afd7ed558ccdull;
+}
+
+std::uint64_t mix(std::uint64_t h, double v) {
+    return mix(h, std::bit_cast<std::uint64_t>(v == 0.0 ? 0.0 : v));  // -0 与 +0 视为相同
+}
+
+std::uint64_t hash_row(const SurfaceTable& surfaces, std::size_t row) {
+    std::uint64_t h = mix(std::uint64_t{0x51}, static_cast<std::uint64_t>(surfaces.type(row)));
+    for (const double c : surfaces.quadric(row).c) {
+        h = mix(h, c);
+    }
+    return h;
+}
+
+// 半空间的几何内容：宏体整体引用取全部面的系数
+std::uint64_t hash_halfspace(const SurfaceTable& surfaces, const CsgNode& n) {
+    std::uint64_t h = mix(std::uint64_t{0x7f}, static_cast<std::uint64_t>(n.negative));
+    if (n.facet == 0) {
+        if (const SurfaceTable::MacroBody* body = surfaces.findMacroBody(n.surface)) {
+            h = mix(h, static_cast<std::uint64_t>(body->type));
+            for (std::uint32_t i = 0; i < body->facetCount; ++i) {
+                h = mix(h, hash_row(surfaces, body->firstRow + i));
+            }
+            return h;
+        }
+    }
+    const auto row = surfaces.find(n.surface, n.facet);
+    return row ? mix(h, hash_row(surfaces, *row)) : mix(h, std::uint64_t{0xdead});
+}
+
+manifold::vec3 to_vec(const glm::dvec3& v) {
+    return manifold::vec3(v.x, v.y, v.z);
+}
+
+double edge_length(const CellMeshOptions& options, const Aabb& domain) {
+    return options.edgeLength > 0.0 ? options.edgeLength : glm::length(domain.extent()) / 64.0;
+}
+
+Aabb world_box(const CellMeshOptions& options) {
+    Aabb world;
+    world.min = options.boundsMin;
+    world.max = options.boundsMax;
+    return world;
+}
+
+// 单元自身的包围盒，略微外扩以免与边界平面重合的面在布尔运算中退化
+Aabb cell_domain(const CsgDag& dag, NodeId region, const SurfaceTable& surfaces, const CellMeshOptions& options) {
+    mcnp::core::CellBoundsOptions boundsOptions;
+    boundsOptions.world = world_box(options);
+    Aabb domain = mcnp::core::CellBounds(dag, surfaces, boundsOptions).bounds(region);
+    if (domain.empty()) {
+        return domain;
+    }
+    const glm::dvec3 pad = domain.extent() * 0.01 + 1e-6;
+    domain.min -= pad;
+    domain.max += pad;
+    domain.intersect(boundsOptions.world);
+    return domain;
+}
+
+// 把一个单元的 CSG 翻译为 Manifold 运算；同一单元内共享的子表达式只求一次
+class CellBuilder {
+public:
+    CellBuilder(const CsgDag& dag, const SurfaceTable& surfaces, const CellMeshOptions& options, const Aabb& domain)
+        : dag_(dag), surfaces_(surfaces), options_(options), domain_(domain) {}
+
+    Manifold build(NodeId id) {
+        const auto it = built_.find(id);
+        if (it != built_.end()) {
+            return it->second;
+        }
+        const CsgNode& n = dag_.node(id);
+        Manifold result;
+        switch (n.op) {
+            case CsgOp::Empty:
+                break;
+            case CsgOp::Universe:
+                result = box();
+                break;
+            case CsgOp::Halfspace:
+                result = halfspace(n);
+                break;
+            case CsgOp::Intersection:
+            case CsgOp::Union: {
+                std::vector<Manifold> children;
+                for (const NodeId child : dag_.children(id)) {
+                    children.push_back(build(child));
+                }
+                result = Manifold::BatchBoolean(
+                    children, n.op == CsgOp::Intersection ? manifold::OpType::Intersect : manifold::OpType::Add);
+                break;
+            }
+        }
+        built_.emplace(id, result);
+        return result;
+    }
+
+    std::string error;
+
+private:
+    Manifold box() const {
+        return Manifold::Cube(to_vec(domain_.extent())).Translate(to_vec(domain_.min));
+    }
+
+    Manifold halfspace(const CsgNode& n) {
+        if (n.facet == 0) {
+            if (const SurfaceTable::MacroBody* body = surfaces_.findMacroBody(n.surface)) {
+                // 宏体内部为全部面负侧的交
+                std::vector<Manifold> facets;
+                for (std::uint32_t i = 0; i < body->facetCount; ++i) {
+                    facets.push_back(side(body->firstRow + i, true));
+                }
+                const Manifold inside = Manifold::BatchBoolean(facets, manifold::OpType::Intersect);
+                return n.negative ? inside : box() - inside;
+            }
+        }
+        const auto row = surfaces_.find(n.surface, n.facet);
+        if (!row) {
+            // 与 CsgDag::contains 一致：未定义的曲面视为正侧
+            if (error.empty()) {
+                error = "undefined surface " + std::to_string(n.surface);
+            }
+            return n.negative ? Manifold() : box();
+        }
+        return side(*row, n.negative);
+    }
+
+    Manifold side(std::size_t row, bool negative) const {
+        const mcnp::core::Quadric q = surfaces_.quadric(row);
+        switch (surfaces_.type(row)) {
+            case SurfaceType::Plane: {
+                // f = n·x + K，负侧为 n·x < -K；TrimByPlane 保留 normal·x > offset 的部分
+                const glm::dvec3 normal(q.c[SurfaceTable::G], q.c[SurfaceTable::H], q.c[SurfaceTable::J]);
+                const double length = glm::length(normal);
+                const glm::dvec3 unit = normal / length;
+                const double offset = q.c[SurfaceTable::K] / length;
+                return negative ? box().TrimByPlane(to_vec(-unit), offset) : box().TrimByPlane(to_vec(unit), -offset);
+            }
+            case SurfaceType::Sphere: {
+                const double a = q.c[SurfaceTable::A];
+                const glm::dvec3 center =
+                    -glm::dvec3(q.c[SurfaceTable::G], q.c[SurfaceTable::H], q.c[SurfaceTable::J]) / (2.0 * a);
+                const double radius = std::sqrt(std::max(0.0, glm::dot(center, center) - q.c[SurfaceTable::K] / a));
+                const Manifold ball = Manifold::Sphere(radius, options_.circularSegments).Translate(to_vec(center));
+                return negative ? (ball ^ box()) : (box() - ball);
+            }
+            default: {
+                // 柱面、锥面、一般二次曲面与环面：按曲面函数的符号提取等值面，内部为正
+                const SurfaceTable& surfaces = surfaces_;
+                auto inside = [&surfaces, row, negative](manifold::vec3 p) {
+                    const double f = surfaces.evaluate(row, glm::dvec3(p.x, p.y, p.z));
+                    return negative ? -f : f;
+                };
+                return Manifold::LevelSet(inside, manifold::Box(to_vec(domain_.min), to_vec(domain_.max)),
+                                          edge_length(options_, domain_));
+            }
+        }
+    }
+
+    const CsgDag& dag_;
+    const SurfaceTable& surfaces_;
+    const CellMeshOptions& options_;
+    const Aabb& domain_;
+    std::unordered_map<NodeId, Manifold> built_;
+};
+
+// 估计网格化代价：等值面远比平面、球面昂贵
+std::size_t estimate_cost(const CsgDag& dag, NodeId region, const SurfaceTable& surfaces) {
+    std::size_t cost = 0;
+    std::unordered_set<NodeId> visited;
+    std::vector<NodeId> pending{region};
+    while (!pending.empty()) {
+        const NodeId id = pending.back();
+        pending.pop_back();
+        if (!visited.insert(id).second) {
+            continue;
+        }
+        const CsgNode& n = dag.node(id);
+        if (n.op == CsgOp::Halfspace) {
+            const auto row = surfaces.find(n.surface, n.facet);
+            const bool cheap = row && (surfaces.type(*row) == SurfaceType::Plane || surfaces.type(*row) == SurfaceType::Sphere);
+            cost += cheap ? 1 : 16;
+        } else {
+            cost += 1;
+            const auto children = dag.children(id);
+            pending.insert(pending.end(), children.begin(), children.end());
+        }
+    }
+    return cost;
+}
+
+} // namespace
+
+std::uint64_t cellMeshKey(const CsgDag& dag, NodeId region, const SurfaceTable& surfaces,
+                          const CellMeshOptions& options) {
+    std::unordered_map<NodeId, std::uint64_t> memo;
+    auto hash = [&](auto&& self, NodeId id) -> std::uint64_t {
+        const auto it = memo.find(id);
+        if (it != memo.end()) {
+            return it->second;
+        }
+        const CsgNode& n = dag.node(id);
+        std::uint64_t h = mix(std::uint64_t{0x3c}, static_cast<std::uint64_t>(n.op));
+        if (n.op == CsgOp::Halfspace) {
+            h = mix(h, hash_halfspace(surfaces, n));
+        } else {
+            // 子节点按编号排序，与内容无关；改按哈希排序使结果与编号无关
+            std::vector<std::uint64_t> children;
+            for (const NodeId child : dag.children(id)) {
+                children.push_back(self(self, child));
+            }
+            std::sort(children.begin(), children.end());
+            for (const std::uint64_t child : children) {
+                h = mix(h, child);
+            }
+        }
+        memo.emplace(id, h);
+        return h;
+    };
+    std::uint64_t h = hash(hash, region);
+    for (int i = 0; i < 3; ++i) {
+        h = mix(h, options.boundsMin[i]);
+        h = mix(h, options.boundsMax[i]);
+    }
+    h = mix(h, options.edgeLength);
+    return mix(h, static_cast<std::uint64_t>(options.circularSegments));
+}
+
+CellMesh meshCell(const CsgDag& dag, NodeId region, const SurfaceTable& surfaces, const CellMeshOptions& options) {
+    CellMesh mesh;
+    mesh.key = cellMeshKey(dag, region, surfaces, options);
+    try {
+        const Aabb domain = cell_domain(dag, region, surfaces, options);
+        if (domain.empty()) {
+            return mesh;  // 区间传播已证明单元为空
+        }
+        CellBuilder builder(dag, surfaces, options, domain);
+        const Manifold solid = builder.build(region);
+        mesh.error = builder.error;
+        if (solid.Status() != Manifold::Error::NoError) {
+            mesh.error = "Manifold evaluation failed";
+            return mesh;
+        }
+        const manifold::MeshGL gl = solid.GetMeshGL();
+        const std::size_t vertices = gl.NumVert();
+        mesh.positions.reserve(vertices);
+        for (std::size_t i = 0; i < vertices; ++i) {
+            const std::size_t base = i * static_cast<std::size_t>(gl.numProp);
+            mesh.positions.emplace_back(gl.vertProperties[base], gl.vertProperties[base + 1],
+                                        gl.vertProperties[base + 2]);
+        }
+        mesh.indices.assign(gl.triVerts.begin(), gl.triVerts.end());
+    } catch (const std::exception& e) {
+        mesh.error = e.what();
+    }
+    return mesh;
+}
+
+std::shared_ptr<const CellMesh> CellMeshCache::find(std::uint64_t key) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = meshes_.find(key);
+    return it == meshes_.end() ? nullptr : it->second;
+}
+
+void CellMeshCache::insert(std::shared_ptr<const CellMesh> mesh) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    meshes_[mesh->key] = std::move(mesh);
+}
+
+void CellMeshCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    meshes_.clear();
+}
+
+std::size_t CellMeshCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return meshes_.size();
+}
+
+struct CellMeshStream::Job {
+    CsgDag dag;
+    SurfaceTable surfaces;
+    CellMeshOptions options;
+    std::vector<std::pair<int, NodeId>> cells;
+
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> running{true};
+    std::atomic<std::size_t> completed{0};
+    std::atomic<std::size_t> hits{0};
+    std::mutex mutex;
+    std::vector<MeshedCell> ready;
+};
+
+CellMeshStream::CellMeshStream(CellMeshCache& cache, CellMeshOptions options)
+    : cache_(cache), options_(std::move(options)) {}
+
+CellMeshStream::~CellMeshStream() {
+    cancel();
+    for (auto& future : retired_) {
+        future.wait();
+    }
+}
+
+void CellMeshStream::start(const CsgDag& dag, const SurfaceTable& surfaces, std::vector<std::pair<int, NodeId>> cells) {
+    cancel();
+    auto job = std::make_shared<Job>();
+    job->dag = dag;
+    job->surfaces = surfaces;
+    job->options = options_;
+
+    // 代价大的单元先领取，避免最后只剩一个大单元串行收尾
+    std::vector<std::pair<std::size_t, std::size_t>> order;
+    order.reserve(cells.size());
+    for (std::size_t i = 0; i < cells.size(); ++i) {
+        order.emplace_back(estimate_cost(dag, cells[i].second, surfaces), i);
+    }
+    std::stable_sort(order.begin(), order.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    job->cells.reserve(cells.size());
+    for (const auto& entry : order) {
+        job->cells.push_back(cells[entry.second]);
+    }
+    job_ = job;
+
+    CellMeshCache* cache = &cache_;
+    retired_.push_back(std::async(std::launch::async, [job, cache]() {
+        auto& pool = job->options.pool ? *job->options.pool : mcnp::core::ThreadPool::shared();
+        // grain 为 1：空闲线程逐个领取下一个单元，代价不均时也能保持负载均衡
+        pool.parallelFor(job->cells.size(), 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end && !job->cancelled.load(); ++i) {
+                const auto [id, region] = job->cells[i];
+                MeshedCell result;
+                result.cell = id;
+                result.mesh = cache->find(cellMeshKey(job->dag, region, job->surfaces, job->options));
+                result.cached = result.mesh != nullptr;
+                if (result.cached) {
+                    job->hits.fetch_add(1);
+                } else {
+                    auto mesh = std::make_shared<const CellMesh>(meshCell(job->dag, region, job->surfaces, job->options));
+                    cache->insert(mesh);
+                    result.mesh = std::move(mesh);
+                }
+                {
+                    std::lock_guard<std::mutex> lock(job->mutex);
+                    job->ready.push_back(std::move(result));
+                }
+                job->completed.fetch_add(1);
+            }
+        });
+        job->running.store(false);
+    }));
+}
+
+void CellMeshStream::cancel() {
+    if (job_) {
+        job_->cancelled.store(true);
+    }
+    job_.reset();
+    // 清理已经收尾的批次，std::async 的 future 析构会阻塞
+    retired_.erase(std::remove_if(retired_.begin(), retired_.end(),
+                                  [](const std::future<void>& f) {
+                                      return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+                                  }),
+                   retired_.end());
+}
+
+std::vector<MeshedCell> CellMeshStream::poll() {
+    if (!job_) {
+        return {};
+    }
+    std::lock_guard<std::mutex> lock(job_->mutex);
+    return std::exchange(job_->ready, {});
+}
+
+bool CellMeshStream::busy() const {
+    return job_ && job_->running.load();
+}
+
+std::size_t CellMeshStream::completed() const {
+    return job_ ? job_->completed.load() : 0;
+}
+
+std::size_t CellMeshStream::total() const {
+    return job_ ? job_->cells.size() : 0;
+}
+
+std::size_t CellMeshStream::cacheHits() const {
+    return job_ ? job_->hits.load() : 0;
+}
+
+} // namespace mcnp::parser
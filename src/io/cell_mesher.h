@@ -0,0 +1,105 @@
+#ifndef CELL_MESHER_H
+#define CELL_MESHER_H
+
+#include "csg_dag.h"
+#include "surface_table.h"
+#include "thread_pool.h"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace mcnp::parser {
+
+struct CellMeshOptions {
+    glm::dvec3 boundsMin{-100.0};  // 世界盒：单元包围盒（见 CellBounds）仍无界的方向截断到此
+    glm::dvec3 boundsMax{100.0};
+    double edgeLength = 0.0;       // 一般二次曲面等值面的网格边长；0 时取单元包围盒对角线的 1/64
+    int circularSegments = 48;     // 球面的圆周分段数
+    mcnp::core::ThreadPool* pool = nullptr;  // 为空时使用共享线程池
+};
+
+// 单元的三角网格（世界坐标），可直接转换为场景 Mesh；几何相同的单元共享同一份
+struct CellMesh {
+    std::uint64_t key = 0;  // 内容哈希，见 cellMeshKey
+    std::vector<glm::vec3> positions;
+    std::vector<std::uint32_t> indices;
+    std::string error;
+};
+
+// 单元网格的内容哈希：只取决于表达式结构、所引用曲面的系数与网格参数，
+// 与 DAG 节点编号和曲面号无关，因此全量重解析后缓存仍然命中
+std::uint64_t cellMeshKey(const mcnp::core::CsgDag& dag, mcnp::core::CsgDag::NodeId region,
+                          const mcnp::core::SurfaceTable& surfaces, const CellMeshOptions& options);
+
+// 串行网格化一个单元：每个半空间截断到单元包围盒后三角化（平面精确裁剪、球面解析、
+// 其余二次曲面与环面用等值面），再按 CSG 用 Manifold 求交、并
+CellMesh meshCell(const mcnp::core::CsgDag& dag, mcnp::core::CsgDag::NodeId region,
+                  const mcnp::core::SurfaceTable& surfaces, const CellMeshOptions& options);
+
+struct MeshedCell {
+    int cell = 0;
+    std::shared_ptr<const CellMesh> mesh;
+    bool cached = false;  // 命中缓存，未重新计算
+};
+
+// 按内容哈希缓存的单元网格；线程安全
+class CellMeshCache {
+public:
+    std::shared_ptr<const CellMesh> find(std::uint64_t key) const;
+    void insert(std::shared_ptr<const CellMesh> mesh);
+    void clear();
+    std::size_t size() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::unordered_map<std::uint64_t, std::shared_ptr<const CellMesh>> meshes_;
+};
+
+// 后台并行网格化：start 复制 DAG 与曲面表后立即返回，单元按估计代价从大到小
+// 在线程池上动态领取，完成一个就进入结果队列，UI 线程每帧 poll 取走，几何逐步出现。
+// 再次 start 会放弃上一批尚未开始的单元，调用方负责把未交付的单元并入新一批。
+class CellMeshStream {
+public:
+    explicit CellMeshStream(CellMeshCache& cache, CellMeshOptions options = {});
+    ~CellMeshStream();
+
+    CellMeshStream(const CellMeshStream&) = delete;
+    CellMeshStream& operator=(const CellMeshStream&) = delete;
+
+    // cells 为 (单元号, 区域节点)
+    void start(const mcnp::core::CsgDag& dag, const mcnp::core::SurfaceTable& surfaces,
+               std::vector<std::pair<int, mcnp::core::CsgDag::NodeId>> cells);
+    void cancel();
+    // 取走已完成的结果（缓存命中的单元同样经由这里交付）
+    std::vector<MeshedCell> poll();
+
+    bool busy() const;
+    std::size_t completed() const;
+    std::size_t total() const;
+    std::size_t cacheHits() const;
+
+    const CellMeshOptions& options() const noexcept { return options_; }
+    void setOptions(const CellMeshOptions& options) { options_ = options; }
+
+private:
+    struct Job;
+
+    CellMeshCache& cache_;
+    CellMeshOptions options_;
+    std::shared_ptr<Job> job_;
+    std::vector<std::future<void>> retired_;  // 已取消、仍在收尾的批次
+};
+
+} // namespace mcnp::parser
+
+#endif // CELL_MESHER_H
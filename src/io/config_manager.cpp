@@ -13,6 +13,7 @@ std::vector<Mesh> meshes;
 std::vector<Mesh> originalMeshes;
 int selectedMesh = -1;
 int secondMeshForBoolean = -1;
+ViewportPick viewportPick;
 
 // 全局窗口变量定义
 GLFWwindow* window;
@@ -91,6 +91,14 @@ extern std::vector<Mesh> originalMeshes;
 extern int selectedMesh;
 extern int secondMeshForBoolean;
 
+// 视口中最近一次拾取的射线（世界坐标），每次点击 serial 加一，供面板按需查询点击处的单元
+struct ViewportPick {
+    unsigned serial = 0;
+    glm::vec3 origin{0.0f};
+    glm::vec3 direction{0.0f, 0.0f, -1.0f};
+};
+extern ViewportPick viewportPick;
+
 // 在此处添加其他全局变量声明，以避免循环依赖
 extern GLFWwindow* window;
 extern const unsigned int SCR_WIDTH;
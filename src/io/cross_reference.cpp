@@ -0,0 +1,715 @@
+#include "cross_reference.h"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <limits>
+#include <string>
+
+namespace mcnp::parser {
+
+namespace {
+
+constexpr std::size_t kGrainCards = 4096;
+
+bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// 开头的无符号整数；used 为数字位数。逐位累加，比 from_chars 少一次扫描
+bool leading_id(std::string_view text, int& id, std::size_t& used) {
+    std::int64_t value = 0;
+    used = 0;
+    while (used < text.size() && is_digit(text[used])) {
+        value = value * 10 + (text[used++] - '0');
+        if (value > std::numeric_limits<int>::max()) {
+            return false;
+        }
+    }
+    id = static_cast<int>(value);
+    return used > 0;
+}
+
+// 整个词元为一个整数（可带正负号）：sign 为符号位数，id 为绝对值，used 为数字位数
+bool split_int(std::string_view text, std::size_t& sign, int& id, std::size_t& used) {
+    sign = !text.empty() && (text.front() == '-' || text.front() == '+') ? 1 : 0;
+    return leading_id(text.substr(sign), id, used) && sign + used == text.size();
+}
+
+bool parse_int(std::string_view text, int& value) {
+    std::size_t sign = 0;
+    std::size_t used = 0;
+    if (!split_int(text, sign, value, used)) {
+        return false;
+    }
+    value = text.front() == '-' ? -value : value;
+    return true;
+}
+
+bool is_alpha(char c) {
+    return std::isalpha(static_cast<unsigned char>(c)) != 0;
+}
+
+// 与小写字母组成的字面量比较，不区分大小写
+bool iequals(std::string_view text, std::string_view lowered) {
+    if (text.size() != lowered.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        if ((text[i] | 0x20) != lowered[i]) {  // 字面量只含字母
+            return false;
+        }
+    }
+    return true;
+}
+
+bool istarts_with(std::string_view text, std::string_view lowered) {
+    return text.size() >= lowered.size() && iequals(text.substr(0, lowered.size()), lowered);
+}
+
+bool is_geometry_token(std::string_view text) {
+    const char first = text.front();
+    return is_digit(first) || first == '-' || first == '+' || first == '.' || first == '(' || first == ')' ||
+           first == ':' || first == '#';
+}
+
+// 参数名以字母开头（单独的 J 为跳过简写，不算参数名）
+bool starts_field(std::string_view text) {
+    if (text.front() == '*') {
+        text.remove_prefix(1);
+    }
+    return !text.empty() && is_alpha(text.front()) && !(text.size() == 1 && (text[0] == 'j' || text[0] == 'J'));
+}
+
+bool is_repeat(std::string_view text) {
+    int count = 0;
+    return text.size() >= 2 && (text.back() == 'r' || text.back() == 'R') &&
+           parse_int(text.substr(0, text.size() - 1), count);
+}
+
+// 卡片的参数词元：直接取参数表与字符串池，不经 CardView 逐个调用
+struct Tokens {
+    const ParameterRecord* records = nullptr;
+    std::size_t count = 0;
+    const StringPool* strings = nullptr;
+
+    std::string_view operator[](std::size_t i) const { return strings->view(records[i].text); }
+};
+
+enum Relation : std::uint8_t {
+    SurfaceCells,
+    MaterialCells,
+    CellReferences,
+    FillCells,
+    UniverseCells,
+    TransformSurfaces,
+    NoRelation
+};
+
+// 逐个登记卡片中的编号：出现位置之外，趁卡片还在缓存中一并登记定义与关系。
+// 关键字先登记，其中的定义即之后各引用所在的单元或曲面
+class Scanner {
+public:
+    using Definitions = std::vector<std::pair<int, std::uint32_t>>;
+    using Pairs = std::vector<std::pair<int, int>>;
+
+    Scanner(std::vector<XrefOccurrence>& out, Definitions* definitions, Pairs* pairs, CardKind kind,
+            std::size_t card)
+        : out_(out), definitions_(definitions), pairs_(pairs), kind_(kind), card_(static_cast<std::uint32_t>(card)) {
+        for (std::size_t r = 0; r < NoRelation; ++r) {
+            cardStart_[r] = pairs_[r].size();
+        }
+    }
+
+    // 词元 parameter 中 offset 处长 length 的编号 id；编号 0 不登记
+    void add(XrefKind kind, std::size_t parameter, std::size_t offset, std::size_t length, int id,
+             bool definition = false) {
+        if (id <= 0) {
+            return;
+        }
+        XrefOccurrence& occurrence = out_.emplace_back();
+        occurrence.card = card_;
+        occurrence.parameter = static_cast<std::uint32_t>(parameter);
+        occurrence.id = id;
+        occurrence.begin = static_cast<std::uint16_t>(offset);
+        occurrence.length = static_cast<std::uint8_t>(length);
+        occurrence.kind = kind;
+        occurrence.definition = definition;
+        if (definition) {
+            if (kind == XrefKind::Universe) {
+                relate(UniverseCells, id);
+                return;
+            }
+            definitions_[static_cast<std::size_t>(kind)].emplace_back(id, card_);
+            if (parameter == XrefOccurrence::kKeyword) {
+                owner_ = id;
+            }
+            return;
+        }
+        if (owner_ != 0) {  // 计数卡等数据卡片没有所在单元
+            relate(relation(kind), id);
+        }
+    }
+
+    // text 开头的编号（可带正负号），位于词元 parameter 的 offset 处
+    bool number(XrefKind kind, std::size_t parameter, std::string_view text, std::size_t offset) {
+        const std::size_t sign = !text.empty() && (text.front() == '-' || text.front() == '+') ? 1 : 0;
+        int id = 0;
+        std::size_t used = 0;
+        if (!leading_id(text.substr(sign), id, used)) {
+            return false;
+        }
+        add(kind, parameter, offset + sign, used, id);
+        return true;
+    }
+
+    // 整个值为一个整数时才登记（TRCL=(...) 之类的就地变换不算）；id 为其绝对值
+    bool exact(XrefKind kind, std::size_t parameter, std::string_view text, std::size_t offset, int& id,
+               bool definition = false) {
+        std::size_t sign = 0;
+        std::size_t used = 0;
+        if (!split_int(text, sign, id, used)) {
+            return false;
+        }
+        add(kind, parameter, offset + sign, used, id, definition);
+        return true;
+    }
+
+    bool exact(XrefKind kind, std::size_t parameter, std::string_view text, std::size_t offset,
+               bool definition = false) {
+        int id = 0;
+        return exact(kind, parameter, text, offset, id, definition);
+    }
+
+private:
+    Relation relation(XrefKind kind) const {
+        if (kind_ == CardKind::Cell) {
+            switch (kind) {
+                case XrefKind::Surface:
+                    return SurfaceCells;
+                case XrefKind::Material:
+                    return MaterialCells;
+                case XrefKind::Cell:
+                    return CellReferences;
+                case XrefKind::Universe:
+                    return FillCells;
+                default:
+                    return NoRelation;
+            }
+        }
+        return kind_ == CardKind::Surface && kind == XrefKind::Transform ? TransformSurfaces : NoRelation;
+    }
+
+    // 同一卡片多次引用同一编号只登记一次；一张卡片引用的不同编号不多，线性查找即可
+    void relate(Relation relation, int key) {
+        if (relation == NoRelation) {
+            return;
+        }
+        Pairs& list = pairs_[relation];
+        for (std::size_t i = cardStart_[relation]; i < list.size(); ++i) {
+            if (list[i].first == key) {
+                return;
+            }
+        }
+        list.emplace_back(key, owner_);
+    }
+
+    std::vector<XrefOccurrence>& out_;
+    Definitions* definitions_;
+    Pairs* pairs_;
+    CardKind kind_;
+    std::uint32_t card_;
+    int owner_ = 0;
+    std::size_t cardStart_[NoRelation];  // 本卡片在各关系表中的第一项
+};
+
+// 几何表达式中的曲面（宏体的面 n.m 取 n）与 #n 单元
+void scan_geometry(Scanner& scanner, std::size_t parameter, std::string_view token) {
+    std::size_t i = 0;
+    while (i < token.size()) {
+        const char c = token[i];
+        if (c == '#' && i + 1 < token.size() && is_digit(token[i + 1])) {
+            int id = 0;
+            std::size_t used = 0;
+            if (leading_id(token.substr(i + 1), id, used)) {
+                scanner.add(XrefKind::Cell, parameter, i + 1, used, id);
+            }
+            i += 1 + used;
+            continue;
+        }
+        if (is_digit(c) || ((c == '-' || c == '+') && i + 1 < token.size() && is_digit(token[i + 1]))) {
+            const std::size_t start = c == '-' || c == '+' ? i + 1 : i;
+            int id = 0;
+            std::size_t used = 0;
+            if (leading_id(token.substr(start), id, used)) {
+                scanner.add(XrefKind::Surface, parameter, start, used, id);
+            }
+            i = start + used;
+            if (i < token.size() && token[i] == '.') {
+                ++i;
+                while (i < token.size() && is_digit(token[i])) {
+                    ++i;
+                }
+            }
+            continue;
+        }
+        ++i;
+    }
+}
+
+enum class FieldKind : std::uint8_t {
+    Other,
+    Universe,
+    Fill,
+    Transform,
+    Material
+};
+
+FieldKind field_kind(std::string_view name) {
+    if (iequals(name, "u")) {
+        return FieldKind::Universe;
+    }
+    if (iequals(name, "fill")) {
+        return FieldKind::Fill;
+    }
+    if (iequals(name, "trcl")) {
+        return FieldKind::Transform;
+    }
+    if (iequals(name, "mat")) {
+        return FieldKind::Material;
+    }
+    return FieldKind::Other;
+}
+
+// FILL 的值逐个送入：u、u(n)、u (n)，或三个下标范围 i1:i2 之后的宇宙数组（跳过 nR 与括号中的就地变换）
+struct FillState {
+    bool array = false;
+    bool inParens = false;
+
+    void value(Scanner& scanner, std::size_t index, std::size_t parameter, std::string_view text,
+               std::size_t offset) {
+        if (index == 0) {
+            array = text.find(':') != std::string_view::npos;
+        }
+        if (array) {
+            if (index < 3) {
+                return;
+            }
+            if (inParens || text.front() == '(') {
+                inParens = text.back() != ')';
+                return;
+            }
+            int id = 0;
+            std::size_t used = 0;
+            if (!is_repeat(text) && leading_id(text, id, used)) {
+                scanner.number(XrefKind::Universe, parameter, text, offset);
+                inParens = used < text.size() && text[used] == '(' && text.back() != ')';
+            }
+            return;
+        }
+        std::size_t used = 0;
+        if (index == 0) {
+            int id = 0;
+            if (!leading_id(text, id, used)) {
+                return;
+            }
+            scanner.number(XrefKind::Universe, parameter, text, offset);
+        } else if (index > 1) {
+            return;
+        }
+        const std::string_view rest = text.substr(used);
+        if (rest.size() > 2 && rest.front() == '(' && rest.back() == ')') {
+            scanner.exact(XrefKind::Transform, parameter, rest.substr(1, rest.size() - 2), offset + used + 1);
+        }
+    }
+};
+
+void scan_cell(std::string_view keyword, const Tokens& tokens, Scanner& scanner) {
+    if (!scanner.exact(XrefKind::Cell, XrefOccurrence::kKeyword, keyword, 0, true)) {
+        return;
+    }
+    const std::size_t count = tokens.count;
+    std::size_t k = 0;
+    if (count >= 2 && iequals(tokens[0], "like")) {
+        scanner.exact(XrefKind::Cell, 1, tokens[1], 0);
+        k = count > 2 && iequals(tokens[2], "but") ? 3 : 2;
+    } else {
+        int material = 0;
+        if (count == 0 || !scanner.exact(XrefKind::Material, 0, tokens[0], 0, material)) {
+            return;
+        }
+        k = material != 0 ? 2 : 1;
+        for (; k < count && is_geometry_token(tokens[k]); ++k) {
+            scan_geometry(scanner, k, tokens[k]);
+        }
+    }
+
+    // 参数 name=value，兼容 "u=2"、"u= 2"、"u =2"、"u = 2"；值为其后直到下一个参数名的全部词元
+    FieldKind field = FieldKind::Other;
+    std::size_t index = 0;
+    FillState fill;
+    auto value = [&](std::size_t parameter, std::string_view text, std::size_t offset) {
+        switch (field) {
+            case FieldKind::Universe:
+                if (index == 0) {
+                    scanner.exact(XrefKind::Universe, parameter, text, offset, true);
+                }
+                break;
+            case FieldKind::Fill:
+                fill.value(scanner, index, parameter, text, offset);
+                break;
+            case FieldKind::Transform:
+                if (index == 0) {
+                    scanner.exact(XrefKind::Transform, parameter, text, offset);
+                }
+                break;
+            case FieldKind::Material:
+                if (index == 0) {
+                    scanner.exact(XrefKind::Material, parameter, text, offset);
+                }
+                break;
+            case FieldKind::Other:
+                break;
+        }
+        ++index;
+    };
+    for (; k < count; ++k) {
+        const std::string_view token = tokens[k];
+        if (starts_field(token)) {
+            const std::size_t skip = token.front() == '*' ? 1 : 0;
+            const std::size_t eq = token.find('=');
+            field = field_kind(token.substr(skip, eq == std::string_view::npos ? eq : eq - skip));
+            index = 0;
+            fill = {};
+            if (field != FieldKind::Other && eq != std::string_view::npos && eq + 1 < token.size()) {
+                value(k, token.substr(eq + 1), eq + 1);
+            }
+        } else if (token.front() == '=') {
+            if (token.size() > 1) {
+                value(k, token.substr(1), 1);
+            }
+        } else if (field != FieldKind::Other) {
+            value(k, token, 0);
+        }
+    }
+}
+
+void scan_surface(std::string_view keyword, const Tokens& tokens, Scanner& scanner) {
+    const std::size_t skip = !keyword.empty() && (keyword.front() == '*' || keyword.front() == '+') ? 1 : 0;
+    if (!scanner.exact(XrefKind::Surface, XrefOccurrence::kKeyword, keyword.substr(skip), skip, true) ||
+        tokens.count == 0) {
+        return;
+    }
+    // 正数为 TR 号，负数为周期边界的配对曲面
+    const std::string_view first = tokens[0];
+    scanner.exact(first.front() == '-' ? XrefKind::Surface : XrefKind::Transform, 0, first, 0);
+}
+
+// 计数卡的单元/曲面列表："(1 2) 3 T"、"1 < 5 < 10"；方括号中的栅格下标不是编号
+void scan_tally(const Tokens& tokens, XrefKind kind, Scanner& scanner) {
+    int depth = 0;
+    for (std::size_t p = 0; p < tokens.count; ++p) {
+        const std::string_view token = tokens[p];
+        std::size_t begin = 0;
+        std::size_t end = token.size();
+        while (begin < end && token[begin] == '(') {
+            ++begin;
+        }
+        while (end > begin && token[end - 1] == ')') {
+            --end;
+        }
+        const int opens = static_cast<int>(std::count(token.begin(), token.end(), '['));
+        const int closes = static_cast<int>(std::count(token.begin(), token.end(), ']'));
+        if (depth == 0 && opens == 0) {
+            scanner.exact(kind, p, token.substr(begin, end - begin), begin);
+        }
+        depth += opens - closes;
+    }
+}
+
+void scan_data(std::string_view keyword, const Tokens& tokens, Scanner& scanner) {
+    const std::size_t skip = !keyword.empty() && keyword.front() == '*' ? 1 : 0;
+    const std::string_view name = keyword.substr(skip);
+    if (name.size() > 1 && (name.front() == 'm' || name.front() == 'M') &&
+        scanner.exact(XrefKind::Material, XrefOccurrence::kKeyword, name.substr(1), skip + 1, true)) {
+        return;
+    }
+    if (name.size() > 2 && (istarts_with(name, "mt") || istarts_with(name, "mx"))) {
+        scanner.exact(XrefKind::Material, XrefOccurrence::kKeyword, name.substr(2), skip + 2);
+    } else if (name.size() > 2 && istarts_with(name, "tr")) {
+        scanner.exact(XrefKind::Transform, XrefOccurrence::kKeyword, name.substr(2), skip + 2, true);
+    } else if (name.size() > 1 && (name.front() == 'f' || name.front() == 'F') && is_digit(name[1])) {
+        int number = 0;
+        std::size_t used = 0;
+        leading_id(name.substr(1), number, used);
+        if (1 + used < name.size() && name[1 + used] != ':') {
+            return;
+        }
+        switch (number % 10) {
+            case 1:
+            case 2:
+                scan_tally(tokens, XrefKind::Surface, scanner);
+                break;
+            case 4:
+            case 6:
+            case 7:
+            case 8:
+                scan_tally(tokens, XrefKind::Cell, scanner);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+} // namespace
+
+std::size_t XrefMap::slot(int key) const noexcept {
+    const std::uint64_t h = static_cast<std::uint64_t>(static_cast<std::uint32_t>(key)) * 0x9e3779b97f4a7c15ull;
+    return static_cast<std::size_t>(h >> 32) & (keys_.size() - 1);
+}
+
+std::uint32_t XrefMap::find(int key) const {
+    if (dense_) {
+        const std::size_t index = static_cast<std::size_t>(static_cast<std::int64_t>(key) - low_);
+        return index < values_.size() ? values_[index] : kMissing;
+    }
+    if (keys_.empty()) {
+        return kMissing;
+    }
+    const std::size_t mask = keys_.size() - 1;
+    for (std::size_t i = slot(key);; i = (i + 1) & mask) {
+        if (keys_[i] == key) {
+            return values_[i];
+        }
+        if (keys_[i] == kEmpty) {
+            return kMissing;
+        }
+    }
+}
+
+std::pair<std::uint32_t, bool> XrefMap::insert(int key, std::uint32_t value) {
+    if (dense_) {
+        const std::size_t index = static_cast<std::size_t>(static_cast<std::int64_t>(key) - low_);
+        if (index < values_.size()) {
+            if (values_[index] != kMissing) {
+                return {values_[index], false};
+            }
+            values_[index] = value;
+            ++size_;
+            return {value, true};
+        }
+        rehash(std::max<std::size_t>(16, std::bit_ceil((size_ + 1) * 2)));  // 范围外的键：改为哈希
+    }
+    if ((size_ + 1) * 2 > keys_.size()) {
+        rehash(std::max<std::size_t>(16, keys_.size() * 2));
+    }
+    const std::size_t mask = keys_.size() - 1;
+    std::size_t i = slot(key);
+    for (; keys_[i] != kEmpty; i = (i + 1) & mask) {
+        if (keys_[i] == key) {
+            return {values_[i], false};
+        }
+    }
+    keys_[i] = key;
+    values_[i] = value;
+    ++size_;
+    return {value, true};
+}
+
+void XrefMap::reserve(std::size_t count, int low, int high) {
+    if (size_ != 0 || count == 0) {
+        return;
+    }
+    const std::uint64_t range = static_cast<std::uint64_t>(static_cast<std::int64_t>(high) - low) + 1;
+    if (range <= 2 * count + 1024) {
+        dense_ = true;
+        low_ = low;
+        keys_.clear();
+        values_.assign(range, kMissing);
+        return;
+    }
+    rehash(std::max<std::size_t>(16, std::bit_ceil(count * 2)));
+}
+
+void XrefMap::rehash(std::size_t capacity) {
+    std::vector<int> keys(capacity, kEmpty);
+    std::vector<std::uint32_t> values(capacity);
+    keys.swap(keys_);
+    values.swap(values_);
+    const std::size_t mask = capacity - 1;
+    auto place = [&](int key, std::uint32_t value) {
+        std::size_t i = slot(key);
+        while (keys_[i] != kEmpty) {
+            i = (i + 1) & mask;
+        }
+        keys_[i] = key;
+        values_[i] = value;
+    };
+    if (dense_) {
+        dense_ = false;
+        for (std::size_t j = 0; j < values.size(); ++j) {
+            if (values[j] != kMissing) {
+                place(static_cast<int>(low_ + static_cast<std::int64_t>(j)), values[j]);
+            }
+        }
+        return;
+    }
+    for (std::size_t j = 0; j < keys.size(); ++j) {
+        if (keys[j] != kEmpty) {
+            place(keys[j], values[j]);
+        }
+    }
+}
+
+std::span<const int> XrefTable::find(int key) const {
+    const std::uint32_t index = index_.find(key);
+    if (index == XrefMap::kMissing) {
+        return {};
+    }
+    const auto [begin, end] = ranges_[index];
+    return std::span<const int>(values_).subspan(begin, end - begin);
+}
+
+void XrefTable::build(const std::vector<std::pair<int, int>>& pairs) {
+    index_ = {};
+    ranges_.clear();
+    if (pairs.empty()) {
+        values_.clear();
+        return;
+    }
+    int low = pairs.front().first;
+    int high = low;
+    for (const auto& [key, value] : pairs) {
+        low = std::min(low, key);
+        high = std::max(high, key);
+    }
+    index_.reserve(pairs.size(), low, high);
+    // 先计数并记下各项所属的键，再按前缀和就地填入
+    std::vector<std::uint32_t> slots(pairs.size());
+    for (std::size_t p = 0; p < pairs.size(); ++p) {
+        const auto [index, added] = index_.insert(pairs[p].first, static_cast<std::uint32_t>(ranges_.size()));
+        if (added) {
+            ranges_.emplace_back(0, 0);
+        }
+        ++ranges_[index].second;
+        slots[p] = index;
+    }
+    std::uint32_t offset = 0;
+    for (auto& range : ranges_) {
+        const std::uint32_t size = range.second;
+        range = {offset, offset};
+        offset += size;
+    }
+    values_.resize(pairs.size());
+    for (std::size_t p = 0; p < pairs.size(); ++p) {
+        values_[ranges_[slots[p]].second++] = pairs[p].second;
+    }
+}
+
+std::size_t CrossReference::definition(XrefKind kind, int id) const {
+    if (kind == XrefKind::Universe) {
+        return npos;
+    }
+    const std::uint32_t card = definitions_[static_cast<std::size_t>(kind)].find(id);
+    return card == XrefMap::kMissing ? npos : card;
+}
+
+void XrefBuilder::reserve(std::size_t textBytes) {
+    // 典型卡片约每十个字节出现一个编号；预留而未写入的部分不占物理内存
+    occurrences_.reserve(occurrences_.size() + textBytes / 8);
+    definitions_[static_cast<std::size_t>(XrefKind::Cell)].reserve(textBytes / 32);
+    definitions_[static_cast<std::size_t>(XrefKind::Surface)].reserve(textBytes / 32);
+    pairs_[SurfaceCells].reserve(textBytes / 16);
+}
+
+void XrefBuilder::record(const Ast& ast, std::size_t card) {
+    const CardRecord& record = ast.cards()[card];
+    const StringPool& strings = ast.strings();
+    const Tokens tokens{ast.parameters().data() + record.firstParameter, record.parameterCount, &strings};
+    const std::string_view keyword = strings.view(record.keyword);
+    Scanner scanner(occurrences_, definitions_, pairs_, record.kind, card);
+    switch (record.kind) {
+        case CardKind::Cell:
+            scan_cell(keyword, tokens, scanner);
+            break;
+        case CardKind::Surface:
+            scan_surface(keyword, tokens, scanner);
+            break;
+        case CardKind::Data:
+            scan_data(keyword, tokens, scanner);
+            break;
+        default:
+            break;
+    }
+}
+
+void XrefBuilder::append(XrefBuilder&& other, std::uint32_t cardBase) {
+    occurrences_.reserve(occurrences_.size() + other.occurrences_.size());
+    for (XrefOccurrence occurrence : other.occurrences_) {
+        occurrence.card += cardBase;
+        occurrences_.push_back(occurrence);
+    }
+    for (std::size_t kind = 0; kind < 4; ++kind) {
+        for (const auto& [id, card] : other.definitions_[kind]) {
+            definitions_[kind].emplace_back(id, card + cardBase);
+        }
+    }
+    for (std::size_t r = 0; r < kRelations; ++r) {
+        pairs_[r].insert(pairs_[r].end(), other.pairs_[r].begin(), other.pairs_[r].end());
+    }
+    other = {};
+}
+
+CrossReference XrefBuilder::finish() {
+    CrossReference xref;
+    for (std::size_t kind = 0; kind < 4; ++kind) {
+        const auto& definitions = definitions_[kind];
+        if (definitions.empty()) {
+            continue;
+        }
+        int low = definitions.front().first;
+        int high = low;
+        for (const auto& definition : definitions) {
+            low = std::min(low, definition.first);
+            high = std::max(high, definition.first);
+        }
+        // 重复定义时保留第一张卡片
+        xref.definitions_[kind].reserve(definitions.size(), low, high);
+        for (const auto& [id, card] : definitions) {
+            xref.definitions_[kind].insert(id, card);
+        }
+    }
+    xref.surfaceCells_.build(pairs_[SurfaceCells]);
+    xref.materialCells_.build(pairs_[MaterialCells]);
+    xref.cellReferences_.build(pairs_[CellReferences]);
+    xref.fillCells_.build(pairs_[FillCells]);
+    xref.universeCells_.build(pairs_[UniverseCells]);
+    xref.transformSurfaces_.build(pairs_[TransformSurfaces]);
+    xref.occurrences_ = std::move(occurrences_);
+    *this = {};
+    return xref;
+}
+
+CrossReference buildCrossReference(const Ast& ast, mcnp::core::ThreadPool* pool) {
+    const std::size_t count = ast.cardCount();
+    auto& workers = pool ? *pool : mcnp::core::ThreadPool::shared();
+    // 单线程时整体作为一块，省去合并各块结果的复制
+    const std::size_t grain = workers.size() > 1 ? kGrainCards : std::max<std::size_t>(1, count);
+    std::vector<XrefBuilder> chunks((count + grain - 1) / grain);
+    workers.parallelFor(count, grain, [&](std::size_t begin, std::size_t end) {
+        XrefBuilder& builder = chunks[begin / grain];
+        for (std::size_t i = begin; i < end; ++i) {
+            builder.record(ast, i);
+        }
+    });
+    if (chunks.empty()) {
+        return {};
+    }
+    for (std::size_t c = 1; c < chunks.size(); ++c) {
+        chunks.front().append(std::move(chunks[c]), 0);
+    }
+    return chunks.front().finish();
+}
+
+} // namespace mcnp::parser
@@ -0,0 +1,135 @@
+#ifndef CROSS_REFERENCE_H
+#define CROSS_REFERENCE_H
+
+#include "input_ast.h"
+#include "thread_pool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace mcnp::parser {
+
+enum class XrefKind : std::uint8_t {
+    Cell,
+    Surface,
+    Material,
+    Transform,
+    Universe
+};
+
+// 卡片中出现的一个编号：定义（单元/曲面卡片号、Mn、TRn、U=）或引用
+struct XrefOccurrence {
+    static constexpr std::uint32_t kKeyword = std::numeric_limits<std::uint32_t>::max();
+
+    std::uint32_t card = 0;
+    std::uint32_t parameter = kKeyword;  // kKeyword 表示位于关键字中
+    int id = 0;
+    std::uint16_t begin = 0;  // 编号在词元中的起始位置与长度（不含正负号，int 至多十位）
+    std::uint8_t length : 4 = 0;
+    XrefKind kind : 3 = XrefKind::Cell;
+    bool definition : 1 = false;
+};
+
+// int -> uint32 表。键的范围紧凑（卡片号通常连续）时直接按 key - low 下标存放，否则为开放寻址
+// （线性探测，装载率不超过一半）。与 StringPool 一样整块分配槽位，大型卡片文件建表时不逐项分配节点
+class XrefMap {
+public:
+    static constexpr std::uint32_t kMissing = std::numeric_limits<std::uint32_t>::max();
+
+    std::uint32_t find(int key) const;
+    // 键不存在时登记 value；返回表中的值及是否新登记
+    std::pair<std::uint32_t, bool> insert(int key, std::uint32_t value);
+    std::size_t size() const noexcept { return size_; }
+    // 预计 count 个键，范围 [low, high]
+    void reserve(std::size_t count, int low, int high);
+
+private:
+    static constexpr int kEmpty = std::numeric_limits<int>::min();
+
+    std::size_t slot(int key) const noexcept;
+    void rehash(std::size_t capacity);
+
+    bool dense_ = false;
+    int low_ = 0;
+    std::vector<int> keys_;  // 开放寻址时的键
+    std::vector<std::uint32_t> values_;
+    std::size_t size_ = 0;
+};
+
+// 扁平的一对多表：键 -> values 中连续的一段，值按卡片顺序排列且同一卡片只出现一次
+class XrefTable {
+public:
+    std::span<const int> find(int key) const;
+    std::size_t keys() const noexcept { return ranges_.size(); }
+
+    // pairs 为 (键, 值)，按值的卡片顺序给出
+    void build(const std::vector<std::pair<int, int>>& pairs);
+
+private:
+    XrefMap index_;  // 键 -> ranges_ 下标
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> ranges_;
+    std::vector<int> values_;
+};
+
+// 交叉引用索引：曲面 -> 单元、材料 -> 单元、单元 -> 以 #n/LIKE n 引用它的单元、宇宙 -> 填充它的单元、
+// 宇宙 -> 其中的单元、TR -> 曲面，查询均为一次哈希查找。另保存全部编号出现的位置（occurrences），
+// 供重新编号时逐词元改写。F1/F2 与 F4/F6/F7/F8 计数卡中的曲面与单元号只登记位置，不进入上述表。
+class CrossReference {
+public:
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    std::span<const int> cellsUsingSurface(int surface) const { return surfaceCells_.find(surface); }
+    std::span<const int> cellsUsingMaterial(int material) const { return materialCells_.find(material); }
+    std::span<const int> cellsReferencingCell(int cell) const { return cellReferences_.find(cell); }
+    std::span<const int> cellsFilledWith(int universe) const { return fillCells_.find(universe); }
+    std::span<const int> cellsInUniverse(int universe) const { return universeCells_.find(universe); }
+    std::span<const int> surfacesUsingTransform(int transform) const { return transformSurfaces_.find(transform); }
+
+    // 首次定义该编号的卡片下标；未定义返回 npos。宇宙没有定义卡片，用 cellsInUniverse
+    std::size_t definition(XrefKind kind, int id) const;
+    const std::vector<XrefOccurrence>& occurrences() const noexcept { return occurrences_; }
+
+private:
+    friend class XrefBuilder;
+
+    std::vector<XrefOccurrence> occurrences_;
+    XrefMap definitions_[4];  // Cell、Surface、Material、Transform
+    XrefTable surfaceCells_;
+    XrefTable materialCells_;
+    XrefTable cellReferences_;
+    XrefTable fillCells_;
+    XrefTable universeCells_;
+    XrefTable transformSurfaces_;
+};
+
+// 边解析边建索引：解析器每组装好一张卡片（关键字与参数已加入 AST）就调用 record，扫描出的编号
+// 当即登记为出现位置、定义与各关系表的项，不必在解析后重新遍历 AST；finish 只把关系表排成连续数组。
+// 卡片须按下标顺序登记
+class XrefBuilder {
+public:
+    // 按输入的字节数预留，大型卡片文件解析时出现位置表不必反复扩容复制
+    void reserve(std::size_t textBytes);
+    void record(const Ast& ast, std::size_t card);
+    // 接上紧随其后的一段卡片（并行解析的后续分块），other 中的卡片下标加上 cardBase
+    void append(XrefBuilder&& other, std::uint32_t cardBase);
+    // 交出索引，构建器恢复为空
+    CrossReference finish();
+
+private:
+    static constexpr std::size_t kRelations = 6;
+
+    std::vector<XrefOccurrence> occurrences_;
+    std::vector<std::pair<int, std::uint32_t>> definitions_[4];  // (编号, 卡片)，按卡片顺序
+    std::vector<std::pair<int, int>> pairs_[kRelations];         // 各关系的 (键, 所在单元或曲面)，按卡片顺序
+};
+
+// 对已有的 AST 按卡片分块并行登记，再建表；pool 为空时使用共享线程池
+CrossReference buildCrossReference(const Ast& ast, mcnp::core::ThreadPool* pool = nullptr);
+
+} // namespace mcnp::parser
+
+#endif // CROSS_REFERENCE_H
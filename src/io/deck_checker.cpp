@@ -0,0 +1,671 @@
+#include "deck_checker.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace mcnp::parser {
+
+namespace {
+
+enum class SymbolKind : std::uint8_t {
+    Cell,
+    Surface,
+    Material,
+    Transform,
+    Universe
+};
+
+constexpr std::string_view kKindNames[] = {"cell", "surface", "material", "transform", "universe"};
+constexpr std::string_view kUndefinedRules[] = {"undefined-cell", "undefined-surface", "undefined-material",
+                                                "undefined-transform", "undefined-universe"};
+constexpr std::string_view kDuplicateRules[] = {"duplicate-cell", "duplicate-surface", "duplicate-material",
+                                                "duplicate-transform"};
+constexpr std::string_view kMissingImportance = "missing-importance";
+constexpr std::string_view kMissingDelimiter = "missing-delimiter";
+constexpr std::string_view kColumnLimit = "column-limit";
+constexpr std::string_view kUniverseCycle = "universe-cycle";
+constexpr std::string_view kFillSize = "fill-size";
+
+struct Symbol {
+    SymbolKind kind = SymbolKind::Cell;
+    int id = 0;
+};
+
+struct LocalDiagnostic {
+    std::uint32_t lineOffset = 0;  // 相对卡片首行
+    std::uint32_t column = 0;
+    std::string_view rule;
+    std::string message;
+};
+
+bool parse_int(std::string_view text, int& value) {
+    const auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+// 开头的整数（"3(2)" 中的 3）；没有数字时返回 false
+bool leading_int(std::string_view text, int& value, std::size_t& used) {
+    const auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    used = static_cast<std::size_t>(result.ptr - text.data());
+    return result.ec == std::errc();
+}
+
+bool is_alpha(char c) {
+    return std::isalpha(static_cast<unsigned char>(c)) != 0;
+}
+
+bool is_digit(char c) {
+    return std::isdigit(static_cast<unsigned char>(c)) != 0;
+}
+
+std::string lower(std::string_view text) {
+    std::string out(text);
+    for (char& c : out) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return out;
+}
+
+// 几何表达式之后的参数（IMP:N=1、U=2、FILL=...）以字母或 * 开头
+bool is_geometry_token(std::string_view text) {
+    const char first = text.front();
+    return is_digit(first) || first == '-' || first == '+' || first == '.' || first == '(' || first == ')' ||
+           first == ':' || first == '#';
+}
+
+// 参数名：以字母开头（单独的 J 为跳过简写，不算参数名）
+bool starts_field(std::string_view text) {
+    if (!text.empty() && text.front() == '*') {
+        text.remove_prefix(1);
+    }
+    return !text.empty() && is_alpha(text.front()) && !(text.size() == 1 && (text[0] == 'j' || text[0] == 'J'));
+}
+
+// nR 重复简写
+bool repeat_count(std::string_view text, int& count) {
+    if (text.size() < 2 || (text.back() != 'r' && text.back() != 'R')) {
+        return false;
+    }
+    return parse_int(text.substr(0, text.size() - 1), count) && count > 0;
+}
+
+// name=value 形式的参数，兼容 "u=2"、"u= 2"、"u =2"、"u = 2"；值为其后直到下一个参数名的全部词元
+struct Field {
+    std::string name;  // 小写，去掉前导 *
+    std::vector<std::string_view> values;
+};
+
+std::vector<Field> parse_fields(const CardView& card, std::size_t first) {
+    std::vector<Field> fields;
+    const std::size_t count = card.parameterCount();
+    std::size_t k = first;
+    while (k < count) {
+        std::string_view token = card.parameter(k++);
+        if (!token.empty() && token.front() == '*') {
+            token.remove_prefix(1);
+        }
+        Field field;
+        const std::size_t eq = token.find('=');
+        std::string_view rest;
+        if (eq != std::string_view::npos) {
+            field.name = lower(token.substr(0, eq));
+            rest = token.substr(eq + 1);
+        } else {
+            field.name = lower(token);
+            if (k < count && card.parameter(k).front() == '=') {
+                rest = card.parameter(k++).substr(1);
+            }
+        }
+        if (!rest.empty()) {
+            field.values.push_back(rest);
+        }
+        while (k < count && !starts_field(card.parameter(k))) {
+            field.values.push_back(card.parameter(k++));
+        }
+        fields.push_back(std::move(field));
+    }
+    return fields;
+}
+
+// 几何表达式中的曲面（含宏体的面 n.m）与 #n 单元引用
+template <typename OnSurface, typename OnCell>
+void scan_geometry(std::string_view token, OnSurface&& onSurface, OnCell&& onCell) {
+    std::size_t i = 0;
+    while (i < token.size()) {
+        const char c = token[i];
+        if (c == '#') {
+            ++i;
+            int id = 0;
+            std::size_t used = 0;
+            if (i < token.size() && is_digit(token[i]) && leading_int(token.substr(i), id, used)) {
+                onCell(id);
+                i += used;
+            }
+            continue;
+        }
+        if (is_digit(c) || ((c == '-' || c == '+') && i + 1 < token.size() && is_digit(token[i + 1]))) {
+            if (c == '-' || c == '+') {
+                ++i;
+            }
+            int id = 0;
+            std::size_t used = 0;
+            leading_int(token.substr(i), id, used);
+            onSurface(id);
+            i += used;
+            // 宏体的面号
+            if (i < token.size() && token[i] == '.') {
+                ++i;
+                while (i < token.size() && is_digit(token[i])) {
+                    ++i;
+                }
+            }
+            continue;
+        }
+        ++i;
+    }
+}
+
+} // namespace
+
+struct DeckChecker::CardFacts {
+    CardKind kind = CardKind::Unknown;
+    bool defines = false;
+    Symbol definition;
+    int universe = 0;  // 单元的 U=
+    int like = 0;      // LIKE n BUT 的 n
+    bool importance = false;
+    std::int64_t importanceEntries = -1;  // IMP 数据卡片的项数；-1 表示不是 IMP 卡片
+    std::vector<Symbol> references;
+    std::vector<int> fills;  // 单元填充的宇宙（不含栅格填充自身所在的宇宙）
+    std::vector<LocalDiagnostic> local;
+
+    void error(std::string_view rule, std::string message, std::uint32_t lineOffset = 0, std::uint32_t column = 0) {
+        local.push_back({lineOffset, column, rule, std::move(message)});
+    }
+    void reference(SymbolKind kind, int id) { references.push_back({kind, id}); }
+};
+
+namespace {
+
+using CardFacts = DeckChecker::CardFacts;
+
+void check_columns(std::string_view raw, std::size_t limit, CardFacts& facts) {
+    std::uint32_t lineOffset = 0;
+    std::size_t begin = 0;
+    while (begin <= raw.size()) {
+        std::size_t end = raw.find('\n', begin);
+        if (end == std::string_view::npos) {
+            end = raw.size();
+        }
+        std::string_view line = raw.substr(begin, end - begin);
+        // $ 之后的行内注释超出列限制也无妨
+        line = line.substr(0, std::min(line.size(), line.find('$')));
+        while (!line.empty() && (line.back() == ' ' || line.back() == '\t' || line.back() == '\r')) {
+            line.remove_suffix(1);
+        }
+        if (line.size() > limit) {
+            std::string_view excess = line.substr(limit);
+            excess.remove_prefix(std::min(excess.size(), excess.find_first_not_of(" \t")));
+            facts.error(kColumnLimit,
+                        "text beyond column " + std::to_string(limit) + " is ignored by MCNP: \"" +
+                            std::string(excess.substr(0, 16)) + "\"",
+                        lineOffset, static_cast<std::uint32_t>(limit + 1));
+        }
+        ++lineOffset;
+        begin = end + 1;
+    }
+}
+
+// FILL 的值：单个宇宙 u 或 u(n)，栅格为 i1:i2 j1:j2 k1:k2 之后的宇宙数组
+void check_fill(const Field& field, int id, int universe, bool lattice, CardFacts& facts) {
+    const std::vector<std::string_view>& values = field.values;
+    if (values.empty()) {
+        facts.error(kFillSize, "FILL of cell " + std::to_string(id) + " has no universe");
+        return;
+    }
+    auto add_fill = [&](int u) {
+        if (u == 0 || (lattice && u == universe)) {
+            return;
+        }
+        facts.reference(SymbolKind::Universe, u);
+        if (std::find(facts.fills.begin(), facts.fills.end(), u) == facts.fills.end()) {
+            facts.fills.push_back(u);
+        }
+    };
+    if (values.front().find(':') == std::string_view::npos) {
+        int u = 0;
+        std::size_t used = 0;
+        if (!leading_int(values.front(), u, used)) {
+            facts.error(kFillSize, "invalid FILL " + std::string(values.front()) + " on cell " + std::to_string(id));
+            return;
+        }
+        add_fill(u);
+        // u(n) 或 u (n)：n 为 TR 号
+        std::string_view rest = values.front().substr(used);
+        if (rest.empty() && values.size() > 1) {
+            rest = values[1];
+        }
+        int transform = 0;
+        if (!rest.empty() && rest.front() == '(' && rest.back() == ')' &&
+            parse_int(rest.substr(1, rest.size() - 2), transform)) {
+            facts.reference(SymbolKind::Transform, transform);
+        }
+        return;
+    }
+
+    if (!lattice) {
+        facts.error(kFillSize, "FILL array on cell " + std::to_string(id) + " without LAT");
+    }
+    long long expected = 1;
+    std::size_t v = 0;
+    for (; v < 3; ++v) {
+        const std::string_view range = v < values.size() ? values[v] : std::string_view();
+        const std::size_t colon = range.find(':');
+        int low = 0;
+        int high = 0;
+        if (colon == std::string_view::npos || !parse_int(range.substr(0, colon), low) ||
+            !parse_int(range.substr(colon + 1), high) || high < low) {
+            facts.error(kFillSize, "invalid FILL range \"" + std::string(range) + "\" on cell " + std::to_string(id));
+            return;
+        }
+        expected *= high - low + 1;
+    }
+    long long entries = 0;
+    bool inParens = false;
+    for (; v < values.size(); ++v) {
+        const std::string_view token = values[v];
+        if (inParens || token.front() == '(') {
+            inParens = token.back() != ')';
+            continue;
+        }
+        int repeat = 0;
+        if (repeat_count(token, repeat)) {
+            entries += repeat;
+            continue;
+        }
+        int u = 0;
+        std::size_t used = 0;
+        if (!leading_int(token, u, used)) {
+            facts.error(kFillSize, "invalid FILL entry " + std::string(token) + " on cell " + std::to_string(id));
+            return;
+        }
+        inParens = used < token.size() && token[used] == '(' && token.back() != ')';
+        add_fill(u);
+        ++entries;
+    }
+    if (entries != expected) {
+        facts.error(kFillSize, "FILL array of cell " + std::to_string(id) + " has " + std::to_string(entries) +
+                                   " entries, its ranges need " + std::to_string(expected));
+    }
+}
+
+void extract_cell(const CardView& card, CardFacts& facts) {
+    int id = 0;
+    if (!parse_int(card.keyword(), id)) {
+        facts.error(kMissingDelimiter, "card '" + std::string(card.keyword()) +
+                                           "' in the cell block (missing blank line before the surface block?)");
+        return;
+    }
+    facts.defines = true;
+    facts.definition = {SymbolKind::Cell, id};
+    const std::size_t count = card.parameterCount();
+    if (count > 0 && is_alpha(card.parameter(0).front()) && lower(card.parameter(0)) != "like") {
+        facts.error(kMissingDelimiter, "cell " + std::to_string(id) + " looks like a surface card (" +
+                                           std::string(card.parameter(0)) + "); is a blank line missing?");
+        return;
+    }
+
+    std::size_t first = 0;
+    if (count >= 2 && lower(card.parameter(0)) == "like") {
+        if (!parse_int(card.parameter(1), facts.like)) {
+            return;  // 编译器已报告
+        }
+        facts.reference(SymbolKind::Cell, facts.like);
+        first = count > 2 && lower(card.parameter(2)) == "but" ? 3 : 2;
+    } else {
+        int material = 0;
+        if (count == 0 || !parse_int(card.parameter(0), material)) {
+            return;
+        }
+        if (material > 0) {
+            facts.reference(SymbolKind::Material, material);
+        }
+        first = material != 0 ? 2 : 1;
+        for (; first < count && is_geometry_token(card.parameter(first)); ++first) {
+            scan_geometry(
+                card.parameter(first), [&](int surface) { facts.reference(SymbolKind::Surface, surface); },
+                [&](int cell) { facts.reference(SymbolKind::Cell, cell); });
+        }
+    }
+
+    const std::vector<Field> fields = parse_fields(card, first);
+    bool lattice = false;
+    const Field* fill = nullptr;
+    for (const Field& field : fields) {
+        const std::string_view value = field.values.empty() ? std::string_view() : field.values.front();
+        if (field.name.starts_with("imp")) {
+            facts.importance = true;
+        } else if (field.name == "u") {
+            parse_int(value, facts.universe);
+        } else if (field.name == "lat") {
+            lattice = true;
+        } else if (field.name == "fill") {
+            fill = &field;
+        } else if (field.name == "mat") {
+            int material = 0;
+            if (parse_int(value, material) && material > 0) {
+                facts.reference(SymbolKind::Material, material);
+            }
+        } else if (field.name == "trcl") {
+            int transform = 0;
+            if (parse_int(value, transform) && transform > 0) {
+                facts.reference(SymbolKind::Transform, transform);
+            }
+        }
+    }
+    if (fill) {
+        check_fill(*fill, id, facts.universe, lattice, facts);
+    } else if (lattice && facts.like == 0) {
+        facts.error(kFillSize, "lattice cell " + std::to_string(id) + " has no FILL");
+    }
+}
+
+void extract_surface(const CardView& card, CardFacts& facts) {
+    std::string_view keyword = card.keyword();
+    if (!keyword.empty() && (keyword.front() == '*' || keyword.front() == '+')) {
+        keyword.remove_prefix(1);
+    }
+    int id = 0;
+    if (!parse_int(keyword, id)) {
+        facts.error(kMissingDelimiter, "card '" + std::string(card.keyword()) +
+                                           "' in the surface block (missing blank line before the data block?)");
+        return;
+    }
+    facts.defines = true;
+    facts.definition = {SymbolKind::Surface, id};
+    std::size_t p = 0;
+    int number = 0;
+    if (p < card.parameterCount() && parse_int(card.parameter(p), number)) {
+        // 正数为 TR 号，负数为周期边界的配对曲面
+        facts.reference(number > 0 ? SymbolKind::Transform : SymbolKind::Surface, std::abs(number));
+        ++p;
+    }
+    if (p >= card.parameterCount() || !is_alpha(card.parameter(p).front())) {
+        facts.error(kMissingDelimiter,
+                    "surface " + std::to_string(id) + " has no mnemonic (cell card in the surface block?)");
+    }
+}
+
+void extract_data(const CardView& card, CardFacts& facts) {
+    std::string keyword = lower(card.keyword());
+    if (!keyword.empty() && keyword.front() == '*') {
+        keyword.erase(0, 1);
+    }
+    int number = 0;
+    if (parse_int(keyword, number)) {
+        facts.error(kMissingDelimiter, "card " + std::string(card.keyword()) +
+                                           " in the data block looks like a cell or surface card (extra blank line?)");
+        return;
+    }
+    if (keyword.size() > 1 && keyword.front() == 'm' && parse_int(std::string_view(keyword).substr(1), number)) {
+        facts.defines = true;
+        facts.definition = {SymbolKind::Material, number};
+    } else if (keyword.size() > 2 && keyword.starts_with("tr") &&
+               parse_int(std::string_view(keyword).substr(2), number)) {
+        facts.defines = true;
+        facts.definition = {SymbolKind::Transform, number};
+    } else if (keyword.starts_with("imp:")) {
+        facts.importanceEntries = static_cast<std::int64_t>(
+            card.hasShorthand() ? card.expandedParameters().size() : card.parameterCount());
+    }
+}
+
+// 卡片的描述，用于跨卡片规则的消息
+std::string describe(const CardFacts& facts, const CardView& card) {
+    if (facts.defines) {
+        return std::string(kKindNames[static_cast<std::size_t>(facts.definition.kind)]) + " " +
+               std::to_string(facts.definition.id);
+    }
+    return "card " + std::string(card.keyword());
+}
+
+} // namespace
+
+DeckChecker::DeckChecker(CheckerOptions options) : options_(options) {}
+
+DeckChecker::~DeckChecker() = default;
+
+void DeckChecker::extract(const Ast& ast, std::size_t first, std::size_t last) {
+    auto& pool = options_.pool ? *options_.pool : mcnp::core::ThreadPool::shared();
+    const std::size_t limit = options_.columnLimit;
+    pool.parallelFor(last - first, std::max<std::size_t>(1, options_.grainCards), [&](std::size_t begin,
+                                                                                      std::size_t end) {
+        for (std::size_t i = first + begin; i < first + end; ++i) {
+            const CardView card = ast.card(i);
+            CardFacts& facts = facts_[i];
+            facts = CardFacts{};
+            facts.kind = card.kind();
+            switch (card.kind()) {
+                case CardKind::Cell:
+                    extract_cell(card, facts);
+                    break;
+                case CardKind::Surface:
+                    extract_surface(card, facts);
+                    break;
+                case CardKind::Data:
+                    extract_data(card, facts);
+                    break;
+                default:
+                    break;
+            }
+            // 纵向格式的各列共用同一段原文，只在第一列检查
+            const bool sharedRaw = i > 0 && ast.cards()[i - 1].raw.data() == card.raw().data();
+            if (card.kind() != CardKind::Comment && !sharedRaw) {
+                check_columns(card.raw(), limit, facts);
+            }
+        }
+    });
+    extracted_ = last - first;
+}
+
+const std::vector<DeckDiagnostic>& DeckChecker::check(const Ast& ast) {
+    facts_.clear();
+    facts_.resize(ast.cardCount());
+    extract(ast, 0, ast.cardCount());
+    resolve(ast);
+    return diagnostics_;
+}
+
+const std::vector<DeckDiagnostic>& DeckChecker::update(const Ast& ast, std::size_t first, std::size_t last,
+                                                       std::ptrdiff_t cardDelta) {
+    const std::ptrdiff_t oldLast = static_cast<std::ptrdiff_t>(last) - cardDelta;
+    if (oldLast < static_cast<std::ptrdiff_t>(first) || static_cast<std::size_t>(oldLast) > facts_.size() ||
+        facts_.size() + static_cast<std::size_t>(cardDelta) != ast.cardCount()) {
+        return check(ast);
+    }
+    facts_.erase(facts_.begin() + static_cast<std::ptrdiff_t>(first), facts_.begin() + oldLast);
+    facts_.insert(facts_.begin() + static_cast<std::ptrdiff_t>(first), last - first, CardFacts{});
+    extract(ast, first, last);
+    resolve(ast);
+    return diagnostics_;
+}
+
+const std::vector<DeckDiagnostic>& DeckChecker::apply(const Ast& ast, const DeckUpdate& update) {
+    if (update.fullReparse || facts_.empty()) {
+        return check(ast);
+    }
+    return this->update(ast, update.firstCard, update.lastCard, update.cardDelta);
+}
+
+void DeckChecker::resolve(const Ast& ast) {
+    diagnostics_.clear();
+    const std::vector<CardRecord>& records = ast.cards();
+    auto emit = [&](std::vector<DeckDiagnostic>& out, std::size_t card, std::string_view rule, std::string message,
+                    std::size_t lineOffset = 0, std::size_t column = 0,
+                    DiagnosticSeverity severity = DiagnosticSeverity::Error) {
+        const CardRecord& record = records[card];
+        out.push_back({record.line + lineOffset, column, rule, severity, std::move(message),
+                       record.source == 0 ? std::string() : std::string(ast.sourceName(record.source)), card});
+    };
+
+    // 卡内问题与定义表
+    std::unordered_map<int, std::size_t> definitions[4];
+    std::unordered_set<int> universes{0};
+    std::size_t cellCount = 0;
+    bool hasSurfaces = false;
+    std::vector<std::size_t> importanceCards;
+    for (auto& table : definitions) {
+        table.reserve(facts_.size() / 2);
+    }
+    for (std::size_t i = 0; i < facts_.size(); ++i) {
+        const CardFacts& facts = facts_[i];
+        for (const LocalDiagnostic& local : facts.local) {
+            emit(diagnostics_, i, local.rule, local.message, local.lineOffset, local.column,
+                 local.rule == kColumnLimit ? DiagnosticSeverity::Warning : DiagnosticSeverity::Error);
+        }
+        hasSurfaces = hasSurfaces || facts.kind == CardKind::Surface;
+        if (facts.importanceEntries >= 0) {
+            importanceCards.push_back(i);
+        }
+        if (!facts.defines) {
+            continue;
+        }
+        const std::size_t kind = static_cast<std::size_t>(facts.definition.kind);
+        const auto [it, added] = definitions[kind].emplace(facts.definition.id, i);
+        if (!added) {
+            emit(diagnostics_, i, kDuplicateRules[kind],
+                 std::string(kKindNames[kind]) + " " + std::to_string(facts.definition.id) +
+                     " is already defined on line " + std::to_string(records[it->second].line));
+        }
+        if (facts.definition.kind == SymbolKind::Cell) {
+            ++cellCount;
+            universes.insert(facts.universe);
+        }
+    }
+
+    // 引用：各块并行查表
+    auto& pool = options_.pool ? *options_.pool : mcnp::core::ThreadPool::shared();
+    const std::size_t grain = std::max<std::size_t>(1, options_.grainCards);
+    std::vector<std::vector<DeckDiagnostic>> chunks((facts_.size() + grain - 1) / grain);
+    pool.parallelFor(facts_.size(), grain, [&](std::size_t begin, std::size_t end) {
+        std::vector<DeckDiagnostic>& out = chunks[begin / grain];
+        for (std::size_t i = begin; i < end; ++i) {
+            const CardFacts& facts = facts_[i];
+            for (const Symbol& reference : facts.references) {
+                const std::size_t kind = static_cast<std::size_t>(reference.kind);
+                const bool defined = reference.kind == SymbolKind::Universe
+                                         ? universes.count(reference.id) != 0
+                                         : definitions[kind].count(reference.id) != 0;
+                if (!defined) {
+                    emit(out, i, kUndefinedRules[kind],
+                         describe(facts, ast.card(i)) + " uses undefined " + std::string(kKindNames[kind]) + " " +
+                             std::to_string(reference.id));
+                }
+            }
+        }
+    });
+    for (std::vector<DeckDiagnostic>& chunk : chunks) {
+        std::move(chunk.begin(), chunk.end(), std::back_inserter(diagnostics_));
+    }
+
+    // 重要性：IMP 数据卡片的项数须等于单元数，否则每个单元须自带 IMP
+    const auto& cells = definitions[static_cast<std::size_t>(SymbolKind::Cell)];
+    if (!importanceCards.empty()) {
+        for (const std::size_t i : importanceCards) {
+            const std::int64_t entries = facts_[i].importanceEntries;
+            if (entries != static_cast<std::int64_t>(cellCount)) {
+                emit(diagnostics_, i, kMissingImportance,
+                     std::string(ast.card(i).keyword()) + " has " + std::to_string(entries) + " entries for " +
+                         std::to_string(cellCount) + " cells");
+            }
+        }
+    } else if (options_.requireImportance) {
+        for (std::size_t i = 0; i < facts_.size(); ++i) {
+            const CardFacts& facts = facts_[i];
+            if (!facts.defines || facts.definition.kind != SymbolKind::Cell || facts.importance) {
+                continue;
+            }
+            // LIKE n BUT 继承 n 的重要性
+            bool inherited = false;
+            const CardFacts* base = &facts;
+            for (int depth = 0; depth < 64 && base->like != 0 && !inherited; ++depth) {
+                const auto it = cells.find(base->like);
+                if (it == cells.end()) {
+                    break;
+                }
+                base = &facts_[it->second];
+                inherited = base->importance;
+            }
+            if (!inherited) {
+                emit(diagnostics_, i, kMissingImportance,
+                     "cell " + std::to_string(facts.definition.id) + " has no importance");
+            }
+        }
+    }
+
+    // 宇宙嵌套不能成环：宇宙 u -> 其单元 FILL 的宇宙
+    std::unordered_map<int, std::vector<std::pair<int, std::size_t>>> edges;
+    for (std::size_t i = 0; i < facts_.size(); ++i) {
+        for (const int fill : facts_[i].fills) {
+            edges[facts_[i].universe].emplace_back(fill, i);
+        }
+    }
+    if (!edges.empty()) {
+        enum : std::uint8_t { White, Gray, Black };
+        std::unordered_map<int, std::uint8_t> color;
+        struct Frame {
+            int universe;
+            std::size_t next;
+        };
+        std::vector<int> roots;
+        roots.reserve(edges.size());
+        for (const auto& [universe, list] : edges) {
+            roots.push_back(universe);
+        }
+        std::sort(roots.begin(), roots.end());
+        for (const int root : roots) {
+            if (color[root] != White) {
+                continue;
+            }
+            std::vector<Frame> stack{{root, 0}};
+            color[root] = Gray;
+            while (!stack.empty()) {
+                Frame& frame = stack.back();
+                const auto it = edges.find(frame.universe);
+                if (it == edges.end() || frame.next >= it->second.size()) {
+                    color[frame.universe] = Black;
+                    stack.pop_back();
+                    continue;
+                }
+                const auto [target, card] = it->second[frame.next++];
+                std::uint8_t& state = color[target];
+                if (state == Gray) {
+                    std::string path;
+                    auto from = std::find_if(stack.begin(), stack.end(),
+                                             [target = target](const Frame& f) { return f.universe == target; });
+                    for (; from != stack.end(); ++from) {
+                        path += std::to_string(from->universe) + " -> ";
+                    }
+                    emit(diagnostics_, card, kUniverseCycle, "universe cycle: " + path + std::to_string(target));
+                } else if (state == White) {
+                    state = Gray;
+                    stack.push_back({target, 0});
+                }
+            }
+        }
+    }
+
+    if (cellCount > 0 && !hasSurfaces) {
+        emit(diagnostics_, cells.begin()->second, kMissingDelimiter,
+             "deck has cells but no surface block (missing blank line delimiter?)");
+    }
+
+    std::stable_sort(diagnostics_.begin(), diagnostics_.end(), [](const DeckDiagnostic& a, const DeckDiagnostic& b) {
+        return a.card != b.card ? a.card < b.card : a.line != b.line ? a.line < b.line : a.column < b.column;
+    });
+}
+
+} // namespace mcnp::parser
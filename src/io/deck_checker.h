@@ -0,0 +1,80 @@
+#ifndef DECK_CHECKER_H
+#define DECK_CHECKER_H
+
+#include "incremental_deck.h"
+#include "input_ast.h"
+#include "thread_pool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mcnp::parser {
+
+enum class DiagnosticSeverity : std::uint8_t {
+    Error,
+    Warning
+};
+
+// 规则检查结果；rule 为规则名（如 "undefined-surface"），指向静态字符串
+struct DeckDiagnostic {
+    std::size_t line = 0;
+    std::size_t column = 0;  // 0 表示整张卡片
+    std::string_view rule;
+    DiagnosticSeverity severity = DiagnosticSeverity::Error;
+    std::string message;
+    std::string source;    // 出错的文件；空表示主输入
+    std::size_t card = 0;  // AST 中的卡片下标
+};
+
+struct CheckerOptions {
+    std::size_t columnLimit = 128;  // MCNP6 每行 128 列；MCNP5 为 80
+    bool requireImportance = true;
+    std::size_t grainCards = 2048;  // 并行提取时每块的卡片数
+    mcnp::core::ThreadPool* pool = nullptr;  // 为空时使用共享线程池
+};
+
+// MCNP 规则检查：
+//   undefined-surface / undefined-material / undefined-transform / undefined-cell / undefined-universe
+//   duplicate-cell / duplicate-surface / duplicate-material / duplicate-transform
+//   missing-importance、missing-delimiter（卡片落在错误的块中）、column-limit、universe-cycle、fill-size
+// 每张卡片先并行提取出定义、引用与卡内问题（只依赖卡片自身，按卡片缓存），再在缓存上汇总跨卡片规则。
+// 编辑后只重新提取被替换的卡片；跨卡片规则在紧凑的提取结果上重算，不再扫描卡片文本。
+class DeckChecker {
+public:
+    explicit DeckChecker(CheckerOptions options = {});
+    ~DeckChecker();
+
+    DeckChecker(const DeckChecker&) = delete;
+    DeckChecker& operator=(const DeckChecker&) = delete;
+
+    const std::vector<DeckDiagnostic>& check(const Ast& ast);
+    // 卡片 [first, last)（新 AST 中的下标）被替换，卡片总数变化 cardDelta，其余卡片沿用缓存
+    const std::vector<DeckDiagnostic>& update(const Ast& ast, std::size_t first, std::size_t last,
+                                              std::ptrdiff_t cardDelta);
+    // 按 IncrementalDeck 的更新结果选择全量或增量检查
+    const std::vector<DeckDiagnostic>& apply(const Ast& ast, const DeckUpdate& update);
+
+    // 按行号排序
+    const std::vector<DeckDiagnostic>& diagnostics() const noexcept { return diagnostics_; }
+    // 上一次检查重新提取的卡片数
+    std::size_t extractedCards() const noexcept { return extracted_; }
+
+    struct CardFacts;  // 单张卡片的提取结果，定义见 deck_checker.cpp
+
+private:
+
+    void extract(const Ast& ast, std::size_t first, std::size_t last);
+    void resolve(const Ast& ast);
+
+    CheckerOptions options_;
+    std::vector<CardFacts> facts_;
+    std::vector<DeckDiagnostic> diagnostics_;
+    std::size_t extracted_ = 0;
+};
+
+} // namespace mcnp::parser
+
+#endif // DECK_CHECKER_H
@@ -0,0 +1,336 @@
+#include "deck_diff.h"
+
+#include <algorithm>
+#include <charconv>
+#include <string_view>
+#include <unordered_map>
+
+namespace mcnp::parser {
+
+namespace {
+
+constexpr std::uint64_t kFnvOffset = 1469598103934665603ull;
+constexpr std::uint64_t kFnvPrime = 1099511628211ull;
+
+// 几何与参数中的分隔符：两侧的空白不影响含义
+bool is_delimiter(char c) {
+    return c == '(' || c == ')' || c == ':' || c == '=';
+}
+
+char lower(char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c | 0x20) : c;
+}
+
+// 规范化字符流的 FNV-1a 哈希：词元之间只保留一个空格，分隔符两侧不留空格，
+// 数值按值重写（1.0、1、1e0 相同），其余字符转小写
+class Fingerprint {
+public:
+    void token(std::string_view text) {
+        space_ = !first_;
+        first_ = false;
+        std::size_t i = 0;
+        while (i < text.size()) {
+            if (is_delimiter(text[i])) {
+                put(text[i++]);
+                space_ = false;
+                continue;
+            }
+            std::size_t end = i;
+            while (end < text.size() && !is_delimiter(text[end])) {
+                ++end;
+            }
+            run(text.substr(i, end - i));
+            i = end;
+        }
+    }
+
+    std::uint64_t value() const noexcept { return hash_; }
+
+private:
+    void run(std::string_view text) {
+        if (space_ && !is_delimiter(last_)) {
+            put(' ');
+        }
+        space_ = false;
+        char buffer[32];
+        const std::size_t length = number(text, buffer);
+        if (length > 0) {
+            for (std::size_t i = 0; i < length; ++i) {
+                put(buffer[i]);
+            }
+            return;
+        }
+        for (const char c : text) {
+            put(lower(c));
+        }
+    }
+
+    // 整段为十进制数时写出最短的规范形式，返回长度；否则返回 0
+    static std::size_t number(std::string_view text, char (&buffer)[32]) {
+        if (text.empty()) {
+            return 0;
+        }
+        const char first = text.front();
+        if (!(first >= '0' && first <= '9') && first != '-' && first != '+' && first != '.') {
+            return 0;
+        }
+        if (first == '+') {
+            text.remove_prefix(1);
+        }
+        double value = 0.0;
+        const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (error != std::errc() || end != text.data() + text.size()) {
+            return 0;
+        }
+        if (value == 0.0) {
+            value = 0.0;  // -0 与 0 相同
+        }
+        const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        return result.ec == std::errc() ? static_cast<std::size_t>(result.ptr - buffer) : 0;
+    }
+
+    void put(char c) {
+        hash_ = (hash_ ^ static_cast<unsigned char>(c)) * kFnvPrime;
+        last_ = c;
+    }
+
+    std::uint64_t hash_ = kFnvOffset;
+    char last_ = ' ';
+    bool first_ = true;
+    bool space_ = false;
+};
+
+bool is_numbered(CardKind kind) {
+    return kind == CardKind::Cell || kind == CardKind::Surface;
+}
+
+bool is_compared(CardKind kind) {
+    return kind != CardKind::Comment && kind != CardKind::Include;
+}
+
+// 单元/曲面卡片的编号（曲面可带 * 或 + 前缀）；prefix 为前缀长度
+bool card_number(std::string_view keyword, int& number, std::size_t& prefix) {
+    prefix = !keyword.empty() && (keyword.front() == '*' || keyword.front() == '+') ? 1 : 0;
+    keyword.remove_prefix(prefix);
+    const auto [end, error] = std::from_chars(keyword.data(), keyword.data() + keyword.size(), number);
+    return error == std::errc() && end == keyword.data() + keyword.size() && number > 0;
+}
+
+std::string lowered(std::string_view text) {
+    std::string result(text);
+    for (char& c : result) {
+        c = lower(c);
+    }
+    return result;
+}
+
+// 一份卡片文件的匹配索引：单元/曲面按编号，其余卡片按 "关键字#序号"
+struct DeckKeys {
+    std::vector<int> numbers;      // 按编号匹配的卡片的编号，其余为 0
+    std::vector<std::string> keys;  // 其余卡片的键
+    XrefMap cells;
+    XrefMap surfaces;
+    std::unordered_map<std::string, std::uint32_t> named;
+
+    void build(const Ast& ast) {
+        const std::size_t count = ast.cardCount();
+        numbers.assign(count, 0);
+        keys.assign(count, std::string());
+        std::unordered_map<std::string, std::uint32_t> seen;
+        for (std::size_t i = 0; i < count; ++i) {
+            const CardView card = ast.card(i);
+            if (!is_compared(card.kind())) {
+                continue;
+            }
+            int number = 0;
+            std::size_t prefix = 0;
+            if (is_numbered(card.kind()) && card_number(card.keyword(), number, prefix)) {
+                XrefMap& map = card.kind() == CardKind::Cell ? cells : surfaces;
+                if (map.insert(number, static_cast<std::uint32_t>(i)).second) {
+                    numbers[i] = number;
+                    continue;
+                }
+            }
+            // 重复的编号、标题与数据卡：同一关键字按出现次序区分
+            std::string key = card.kind() == CardKind::Title ? std::string("title") : lowered(card.keyword());
+            if (is_numbered(card.kind())) {
+                key.insert(0, card.kind() == CardKind::Cell ? "cell " : "surface ");
+            }
+            const std::uint32_t ordinal = seen[key]++;
+            if (ordinal > 0) {
+                key += '#' + std::to_string(ordinal);
+            }
+            named.emplace(key, static_cast<std::uint32_t>(i));
+            keys[i] = std::move(key);
+        }
+    }
+
+    // 另一份文件中卡片 card（类型 kind）在本文件中的对应卡片
+    std::uint32_t find(CardKind kind, const DeckKeys& other, std::size_t card) const {
+        const int number = other.numbers[card];
+        if (number != 0) {
+            return (kind == CardKind::Cell ? cells : surfaces).find(number);
+        }
+        const auto it = named.find(other.keys[card]);
+        return it == named.end() ? XrefMap::kMissing : it->second;
+    }
+};
+
+std::vector<std::uint64_t> fingerprints(const Ast& ast, const DiffOptions& options) {
+    std::vector<std::uint64_t> result(ast.cardCount(), 0);
+    auto& pool = options.pool ? *options.pool : mcnp::core::ThreadPool::shared();
+    pool.parallelFor(result.size(), std::max<std::size_t>(1, options.grainCards),
+                     [&](std::size_t begin, std::size_t end) {
+                         for (std::size_t i = begin; i < end; ++i) {
+                             const CardView card = ast.card(i);
+                             if (is_compared(card.kind())) {
+                                 result[i] = cardFingerprint(card);
+                             }
+                         }
+                     });
+    return result;
+}
+
+// 材料卡 Mn 的编号；MT/MX 等不算
+int material_number(std::string_view key) {
+    int number = 0;
+    if (key.size() < 2 || key.front() != 'm') {
+        return 0;
+    }
+    const auto [end, error] = std::from_chars(key.data() + 1, key.data() + key.size(), number);
+    return error == std::errc() && end == key.data() + key.size() ? number : 0;
+}
+
+} // namespace
+
+std::uint64_t cardFingerprint(const CardView& card) {
+    Fingerprint fingerprint;
+    int number = 0;
+    std::size_t prefix = 0;
+    if (is_numbered(card.kind()) && card_number(card.keyword(), number, prefix)) {
+        fingerprint.token(card.keyword().substr(0, prefix));  // 反射面/白边界前缀属于内容
+    } else {
+        fingerprint.token(card.keyword());
+    }
+    if (card.hasShorthand()) {
+        for (const std::string& parameter : card.expandedParameters()) {
+            fingerprint.token(parameter);
+        }
+    } else {
+        for (std::size_t i = 0; i < card.parameterCount(); ++i) {
+            fingerprint.token(card.parameter(i));
+        }
+    }
+    return fingerprint.value();
+}
+
+DeckDiff diffDecks(const Ast& before, const Ast& after, const DiffOptions& options) {
+    const std::vector<std::uint64_t> oldPrints = fingerprints(before, options);
+    const std::vector<std::uint64_t> newPrints = fingerprints(after, options);
+    DeckKeys oldKeys;
+    DeckKeys newKeys;
+    oldKeys.build(before);
+    newKeys.build(after);
+
+    // 第一遍：按键匹配
+    constexpr std::uint32_t kUnmatched = XrefMap::kMissing;
+    std::vector<std::uint32_t> match(after.cardCount(), kUnmatched);
+    std::vector<char> matched(before.cardCount(), 0);
+    for (std::size_t i = 0; i < after.cardCount(); ++i) {
+        const CardKind kind = after.card(i).kind();
+        if (!is_compared(kind)) {
+            continue;
+        }
+        const std::uint32_t found = oldKeys.find(kind, newKeys, i);
+        if (found != XrefMap::kMissing && before.card(found).kind() == kind) {
+            match[i] = found;
+            matched[found] = 1;
+        }
+    }
+
+    // 旧文件中未匹配的单元/曲面按 (类型, 指纹) 登记，供识别改号
+    auto content_key = [](CardKind kind, std::uint64_t print) {
+        return print ^ (kind == CardKind::Cell ? 0 : 0x9e3779b97f4a7c15ull);
+    };
+    std::unordered_map<std::uint64_t, std::uint32_t> orphans;
+    for (std::size_t i = 0; i < before.cardCount(); ++i) {
+        if (!matched[i] && oldKeys.numbers[i] != 0) {
+            orphans.emplace(content_key(before.card(i).kind(), oldPrints[i]), static_cast<std::uint32_t>(i));
+        }
+    }
+
+    DeckDiff diff;
+    auto entry = [&](DiffChange change, std::size_t oldCard, std::size_t newCard) {
+        DeckDiffEntry item;
+        item.change = change;
+        const bool isNew = newCard != DeckDiffEntry::npos;
+        const CardView card = isNew ? after.card(newCard) : before.card(oldCard);
+        const DeckKeys& keys = isNew ? newKeys : oldKeys;
+        const std::size_t index = isNew ? newCard : oldCard;
+        item.kind = card.kind();
+        item.number = keys.numbers[index];
+        item.key = item.number != 0 ? std::to_string(item.number) : keys.keys[index];
+        item.before = oldCard;
+        item.after = newCard;
+        if (oldCard != DeckDiffEntry::npos) {
+            item.beforeLine = before.card(oldCard).line();
+            item.previousNumber = oldKeys.numbers[oldCard];
+        }
+        if (isNew) {
+            item.afterLine = card.line();
+        }
+        diff.entries.push_back(std::move(item));
+    };
+
+    // 第二遍：按新文件顺序输出
+    for (std::size_t i = 0; i < after.cardCount(); ++i) {
+        if (!is_compared(after.card(i).kind())) {
+            continue;
+        }
+        if (match[i] != kUnmatched) {
+            if (oldPrints[match[i]] == newPrints[i]) {
+                ++diff.unchanged;
+            } else {
+                entry(DiffChange::Changed, match[i], i);
+            }
+            continue;
+        }
+        if (newKeys.numbers[i] != 0) {
+            const auto orphan = orphans.find(content_key(after.card(i).kind(), newPrints[i]));
+            if (orphan != orphans.end()) {
+                matched[orphan->second] = 1;
+                entry(DiffChange::Renumbered, orphan->second, i);
+                orphans.erase(orphan);
+                continue;
+            }
+        }
+        entry(DiffChange::Added, DeckDiffEntry::npos, i);
+    }
+    for (std::size_t i = 0; i < before.cardCount(); ++i) {
+        if (!matched[i] && is_compared(before.card(i).kind())) {
+            entry(DiffChange::Removed, i, DeckDiffEntry::npos);
+        }
+    }
+
+    // 需要高亮的单元
+    const CrossReference* xref = options.afterXref;
+    for (const DeckDiffEntry& item : diff.entries) {
+        if (item.after == DeckDiffEntry::npos) {
+            continue;
+        }
+        if (item.kind == CardKind::Cell && item.number != 0) {
+            diff.changedCells.push_back(item.number);
+        } else if (xref && item.kind == CardKind::Surface && item.number != 0) {
+            const auto cells = xref->cellsUsingSurface(item.number);
+            diff.changedCells.insert(diff.changedCells.end(), cells.begin(), cells.end());
+        } else if (xref && item.kind == CardKind::Data && material_number(item.key) != 0) {
+            const auto cells = xref->cellsUsingMaterial(material_number(item.key));
+            diff.changedCells.insert(diff.changedCells.end(), cells.begin(), cells.end());
+        }
+    }
+    std::sort(diff.changedCells.begin(), diff.changedCells.end());
+    diff.changedCells.erase(std::unique(diff.changedCells.begin(), diff.changedCells.end()), diff.changedCells.end());
+    return diff;
+}
+
+} // namespace mcnp::parser
@@ -0,0 +1,64 @@
+#ifndef DECK_DIFF_H
+#define DECK_DIFF_H
+
+#include "cross_reference.h"
+#include "input_ast.h"
+#include "thread_pool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace mcnp::parser {
+
+enum class DiffChange : std::uint8_t {
+    Added,
+    Removed,
+    Changed,
+    Renumbered  // 单元/曲面内容不变，只有编号不同
+};
+
+struct DeckDiffEntry {
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    DiffChange change = DiffChange::Changed;
+    CardKind kind = CardKind::Data;
+    std::string key;            // 匹配用的键：单元/曲面为编号，数据卡为小写关键字（重复时带 #序号）
+    int number = 0;             // 单元/曲面在新卡片文件中的编号（删除时为旧编号）
+    int previousNumber = 0;     // Renumbered 时的旧编号
+    std::size_t before = npos;  // 旧/新 AST 中的卡片下标
+    std::size_t after = npos;
+    std::size_t beforeLine = 0;
+    std::size_t afterLine = 0;
+};
+
+struct DeckDiff {
+    // 先按新卡片文件的顺序列出新增、修改与改号，再按旧文件顺序列出删除
+    std::vector<DeckDiffEntry> entries;
+    std::size_t unchanged = 0;
+    // 新卡片文件中需要高亮的单元：本身新增/修改/改号，或（给出交叉引用时）所用的曲面、材料有变化
+    std::vector<int> changedCells;
+
+    bool empty() const noexcept { return entries.empty(); }
+};
+
+struct DiffOptions {
+    const CrossReference* afterXref = nullptr;  // 新卡片文件的交叉引用；为空时只按单元卡片本身判断
+    std::size_t grainCards = 4096;              // 并行计算卡片指纹时每块的卡片数
+    mcnp::core::ThreadPool* pool = nullptr;     // 为空时使用共享线程池
+};
+
+// 两个卡片文件的结构比较：每张逻辑卡片展开简写、统一大小写与空白、数值按值规范化后取 64 位指纹，
+// 单元与曲面按编号匹配，数据卡按关键字（及其出现次序）匹配，与卡片的顺序和折行无关。
+// 按编号匹配不上的单元/曲面再按内容匹配，识别为改号。注释卡与 READ 卡本身不参与比较。
+// 只做一遍指纹与哈希查找，时间与两份卡片总数成线性。
+DeckDiff diffDecks(const Ast& before, const Ast& after, const DiffOptions& options = {});
+
+// 卡片的规范化指纹（不含单元/曲面编号）；格式不同但语义相同的卡片指纹相同
+std::uint64_t cardFingerprint(const CardView& card);
+
+} // namespace mcnp::parser
+
+#endif // DECK_DIFF_H
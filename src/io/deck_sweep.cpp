@@ -0,0 +1,455 @@
+#include "deck_sweep.h"
+#include "card_assembler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace mcnp::parser {
+
+namespace {
+
+char lower(char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c | 0x20) : c;
+}
+
+std::string lowered(std::string_view text) {
+    std::string result(text);
+    std::transform(result.begin(), result.end(), result.begin(), lower);
+    return result;
+}
+
+bool istarts_with(std::string_view text, std::string_view prefix) {
+    if (text.size() < prefix.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < prefix.size(); ++i) {
+        if (lower(text[i]) != lower(prefix[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 按有效数字写出最短形式（0.3 而非 0.30000000000000004），-0 写为 0
+std::size_t format_value(double value, int precision, char (&buffer)[32]) {
+    if (value == 0.0) {
+        value = 0.0;
+    }
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, precision);
+    return static_cast<std::size_t>(result.ptr - buffer);
+}
+
+// 匹配卡片用的键：单元 "c 10"、曲面 "s 3"、数据卡 "d m1"
+std::string request_key(CardKind kind, int number, std::string_view keyword) {
+    if (kind == CardKind::Cell || kind == CardKind::Surface) {
+        return (kind == CardKind::Cell ? "c " : "s ") + std::to_string(number);
+    }
+    return "d " + lowered(keyword);
+}
+
+std::string describe(const SweepField& field) {
+    std::string card = field.kind == CardKind::Cell      ? "cell " + std::to_string(field.number)
+                       : field.kind == CardKind::Surface ? "surface " + std::to_string(field.number)
+                                                         : "card " + field.keyword;
+    return card + (field.parameter == SweepField::kNamed ? " field " + field.name
+                                                         : " parameter " + std::to_string(field.parameter));
+}
+
+// 卡片中字段值所在的词元与词元内的起止位置
+struct FieldSpan {
+    std::size_t parameter = 0;
+    std::size_t begin = 0;
+    std::size_t length = 0;
+};
+
+bool locate_named(const CardView& card, std::string_view name, FieldSpan& span) {
+    const std::size_t count = card.parameterCount();
+    for (std::size_t i = 0; i < count; ++i) {
+        const std::string_view token = card.parameter(i);
+        if (!istarts_with(token, name)) {
+            continue;
+        }
+        std::string_view rest = token.substr(name.size());
+        std::size_t next = i + 1;
+        if (!rest.empty() && rest.front() != '=') {
+            continue;  // 只是前缀相同（如 IMP:N 与 IMP:N,P）
+        }
+        if (rest.empty() && next < count) {
+            // "NAME = v"、"NAME =v" 或 "NAME v"
+            const std::string_view following = card.parameter(next);
+            if (following.front() != '=') {
+                span = {next, 0, following.size()};
+                return true;
+            }
+            if (following.size() > 1) {
+                span = {next, 1, following.size() - 1};
+                return true;
+            }
+            if (next + 1 < count) {
+                span = {next + 1, 0, card.parameter(next + 1).size()};
+                return true;
+            }
+            return false;
+        }
+        if (rest.size() > 1) {  // "NAME=v"
+            span = {i, name.size() + 1, rest.size() - 1};
+            return true;
+        }
+        if (rest.size() == 1 && next < count) {  // "NAME= v"
+            span = {next, 0, card.parameter(next).size()};
+            return true;
+        }
+        return false;
+    }
+    return false;
+}
+
+std::size_t digits(std::size_t value) {
+    std::size_t count = 1;
+    while (value >= 10) {
+        value /= 10;
+        ++count;
+    }
+    return count;
+}
+
+} // namespace
+
+SweepField SweepField::cell(int number, std::size_t parameter) {
+    SweepField field;
+    field.kind = CardKind::Cell;
+    field.number = number;
+    field.parameter = parameter;
+    return field;
+}
+
+SweepField SweepField::cell(int number, std::string name) {
+    SweepField field;
+    field.kind = CardKind::Cell;
+    field.number = number;
+    field.name = std::move(name);
+    return field;
+}
+
+SweepField SweepField::surface(int number, std::size_t parameter) {
+    SweepField field;
+    field.kind = CardKind::Surface;
+    field.number = number;
+    field.parameter = parameter;
+    return field;
+}
+
+SweepField SweepField::data(std::string keyword, std::size_t parameter) {
+    SweepField field;
+    field.keyword = std::move(keyword);
+    field.parameter = parameter;
+    return field;
+}
+
+SweepField SweepField::data(std::string keyword, std::string name) {
+    SweepField field;
+    field.keyword = std::move(keyword);
+    field.name = std::move(name);
+    return field;
+}
+
+std::vector<double> sweepRange(double first, double last, std::size_t count) {
+    std::vector<double> values;
+    values.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        values.push_back(count == 1 ? first : first + (last - first) * static_cast<double>(i) / (count - 1));
+    }
+    return values;
+}
+
+bool DeckSweep::loadFile(const std::filesystem::path& path, const ParserOptions& options) {
+    errors_.clear();
+    patches_.clear();
+    owned_.clear();
+    std::string error;
+    path_ = path;
+    mapped_ = file_.open(path, &error);
+    if (!mapped_) {
+        errors_.push_back(error);
+        return false;
+    }
+    parserOptions_ = options;
+    if (parserOptions_.baseDirectory.empty()) {
+        parserOptions_.baseDirectory = path.parent_path();
+    }
+    return true;
+}
+
+void DeckSweep::loadText(std::string text, const ParserOptions& options) {
+    errors_.clear();
+    patches_.clear();
+    file_.close();
+    mapped_ = false;
+    owned_ = std::move(text);
+    path_.clear();
+    parserOptions_ = options;
+}
+
+std::string_view DeckSweep::text() const noexcept {
+    return mapped_ ? file_.view() : std::string_view(owned_);
+}
+
+bool DeckSweep::bind(std::vector<SweepParameter> parameters) {
+    parameters_ = std::move(parameters);
+    patches_.clear();
+    if (!path_.empty() && !mapped_) {
+        return false;  // 文件未能打开，保留 loadFile 的错误
+    }
+    errors_.clear();
+    ParserOptions options = parserOptions_;
+    options.crossReference = false;
+    const ParseResult parsed = MCNPParser(options).parse(text());
+    for (const ParseError& error : parsed.errors) {
+        errors_.push_back("line " + std::to_string(error.line) + ": " + error.message);
+    }
+    return errors_.empty() && resolve(parsed.ast);
+}
+
+bool DeckSweep::resolve(const Ast& ast) {
+    // 待定位的字段按卡片键分组，一遍扫描卡片
+    std::unordered_map<std::string, std::vector<std::pair<std::size_t, std::size_t>>> wanted;
+    for (std::size_t p = 0; p < parameters_.size(); ++p) {
+        if (parameters_[p].values.empty()) {
+            errors_.push_back("parameter " + parameters_[p].name + " has no values");
+        }
+        for (std::size_t f = 0; f < parameters_[p].fields.size(); ++f) {
+            const SweepField& field = parameters_[p].fields[f];
+            wanted[request_key(field.kind, field.number, field.keyword)].emplace_back(p, f);
+        }
+    }
+
+    const std::string_view text = this->text();
+    std::size_t found = 0;
+    for (std::size_t c = 0; c < ast.cardCount() && found < wanted.size(); ++c) {
+        const CardView card = ast.card(c);
+        const CardKind kind = card.kind();
+        if (kind != CardKind::Cell && kind != CardKind::Surface && kind != CardKind::Data) {
+            continue;
+        }
+        std::string_view keyword = card.keyword();
+        int number = 0;
+        if (kind != CardKind::Data) {
+            if (!keyword.empty() && (keyword.front() == '*' || keyword.front() == '+')) {
+                keyword.remove_prefix(1);
+            }
+            const auto [end, error] = std::from_chars(keyword.data(), keyword.data() + keyword.size(), number);
+            if (error != std::errc() || end != keyword.data() + keyword.size()) {
+                continue;
+            }
+        }
+        const auto it = wanted.find(request_key(kind, number, keyword));
+        if (it == wanted.end() || it->second.empty()) {
+            continue;
+        }
+        ++found;
+        for (const auto& [p, f] : std::exchange(it->second, {})) {
+            const SweepField& field = parameters_[p].fields[f];
+            if (card.record().source != 0) {
+                errors_.push_back(describe(field) + " is in an included file");
+                continue;
+            }
+            FieldSpan span;
+            bool located = false;
+            if (field.parameter == SweepField::kNamed) {
+                located = locate_named(card, field.name, span);
+            } else if (field.parameter < card.parameterCount()) {
+                span = {field.parameter, 0, card.parameter(field.parameter).size()};
+                located = true;
+            }
+            if (!located) {
+                errors_.push_back(describe(field) + " not found");
+                continue;
+            }
+            const std::string_view token = card.parameter(span.parameter);
+            if (isShorthandToken(token.substr(span.begin, span.length))) {
+                errors_.push_back(describe(field) + " is a repeat/interpolate shorthand");
+                continue;
+            }
+            // 参数所在行的行首：从卡片首行起数换行
+            const ParameterRecord& record = card.parameterRecord(span.parameter);
+            std::size_t lineStart = card.offset();
+            for (std::size_t line = card.line(); line < record.line; ++line) {
+                lineStart = text.find('\n', lineStart) + 1;
+            }
+            const std::size_t begin = lineStart + record.column - 1;
+            if (text.substr(begin, token.size()) != token) {
+                errors_.push_back(describe(field) + " cannot be mapped to the file text");
+                continue;
+            }
+            patches_.push_back({begin + span.begin, span.length, p, f});
+        }
+    }
+    for (const auto& [key, requests] : wanted) {
+        for (const auto& [p, f] : requests) {
+            errors_.push_back(describe(parameters_[p].fields[f]) + ": card not found");
+        }
+    }
+
+    std::sort(patches_.begin(), patches_.end(), [](const Patch& a, const Patch& b) { return a.begin < b.begin; });
+    for (std::size_t i = 1; i < patches_.size(); ++i) {
+        if (patches_[i].begin < patches_[i - 1].begin + patches_[i - 1].length) {
+            errors_.push_back(describe(parameters_[patches_[i].parameter].fields[patches_[i].field]) +
+                              " is bound more than once");
+        }
+    }
+    if (!errors_.empty()) {
+        patches_.clear();
+        return false;
+    }
+    return true;
+}
+
+std::size_t DeckSweep::variantCount() const noexcept {
+    if (parameters_.empty() || !errors_.empty()) {
+        return 0;
+    }
+    std::size_t count = 1;
+    for (const SweepParameter& parameter : parameters_) {
+        count *= parameter.values.size();
+    }
+    return count;
+}
+
+std::vector<double> DeckSweep::values(std::size_t variant) const {
+    std::vector<double> result(parameters_.size());
+    for (std::size_t p = parameters_.size(); p-- > 0;) {
+        const auto& values = parameters_[p].values;
+        result[p] = values[variant % values.size()];
+        variant /= values.size();
+    }
+    return result;
+}
+
+double DeckSweep::fieldValue(const std::vector<double>& values, const Patch& patch) const {
+    const SweepField& field = parameters_[patch.parameter].fields[patch.field];
+    return values[patch.parameter] * field.scale + field.offset;
+}
+
+std::size_t DeckSweep::writeVariant(std::ostream& out, std::size_t variant, int precision) const {
+    const std::string_view text = this->text();
+    const std::vector<double> values = this->values(variant);
+    std::size_t position = 0;
+    std::size_t bytes = 0;
+    char buffer[32];
+    for (const Patch& patch : patches_) {
+        out.write(text.data() + position, static_cast<std::streamsize>(patch.begin - position));
+        const std::size_t length = format_value(fieldValue(values, patch), precision, buffer);
+        out.write(buffer, static_cast<std::streamsize>(length));
+        bytes += patch.begin - position + length;
+        position = patch.begin + patch.length;
+    }
+    out.write(text.data() + position, static_cast<std::streamsize>(text.size() - position));
+    return bytes + text.size() - position;
+}
+
+std::vector<std::string> DeckSweep::columnWarnings(std::size_t columnLimit, int precision) const {
+    std::vector<std::string> warnings;
+    const std::string_view text = this->text();
+    char buffer[32];
+    for (std::size_t i = 0; i < patches_.size();) {
+        // 同一行上的替换一起计算最长的情形
+        const std::size_t lineStart = text.rfind('\n', patches_[i].begin) == std::string_view::npos
+                                          ? 0
+                                          : text.rfind('\n', patches_[i].begin) + 1;
+        std::size_t lineEnd = text.find('\n', patches_[i].begin);
+        lineEnd = lineEnd == std::string_view::npos ? text.size() : lineEnd;
+        if (lineEnd > lineStart && text[lineEnd - 1] == '\r') {
+            --lineEnd;
+        }
+        std::size_t width = lineEnd - lineStart;
+        for (; i < patches_.size() && patches_[i].begin < lineEnd; ++i) {
+            const Patch& patch = patches_[i];
+            std::size_t longest = 0;
+            for (const double value : parameters_[patch.parameter].values) {
+                const SweepField& field = parameters_[patch.parameter].fields[patch.field];
+                longest = std::max(longest, format_value(value * field.scale + field.offset, precision, buffer));
+            }
+            width = width - patch.length + longest;
+        }
+        if (width > columnLimit) {
+            const std::size_t line = static_cast<std::size_t>(std::count(text.begin(), text.begin() + lineStart, '\n')) + 1;
+            warnings.push_back("line " + std::to_string(line) + " may reach " + std::to_string(width) +
+                               " columns (limit " + std::to_string(columnLimit) + ")");
+        }
+    }
+    return warnings;
+}
+
+SweepStats DeckSweep::writeAll(const SweepOptions& options) const {
+    SweepStats stats;
+    stats.errors = errors_;
+    if (!errors_.empty()) {
+        return stats;
+    }
+    std::error_code ec;
+    std::filesystem::create_directories(options.directory, ec);
+    if (ec) {
+        stats.errors.push_back("Cannot create " + options.directory.string() + ": " + ec.message());
+        return stats;
+    }
+    stats.warnings = columnWarnings(options.columnLimit, options.precision);
+
+    const std::string prefix =
+        !options.prefix.empty() ? options.prefix : path_.empty() ? std::string("deck") : path_.stem().string();
+    const std::size_t count = variantCount();
+    const std::size_t width = digits(count == 0 ? 0 : count - 1);
+    stats.files.reserve(count);
+    for (std::size_t v = 0; v < count; ++v) {
+        std::string index = std::to_string(v);
+        index.insert(0, width - index.size(), '0');
+        stats.files.push_back(options.directory / (prefix + "_" + index + options.extension));
+    }
+
+    if (options.manifest) {
+        std::ofstream manifest(options.directory / (prefix + "_sweep.csv"));
+        manifest << "variant,file";
+        for (const SweepParameter& parameter : parameters_) {
+            manifest << ',' << parameter.name;
+        }
+        manifest << '\n';
+        char buffer[32];
+        for (std::size_t v = 0; v < count; ++v) {
+            manifest << v << ',' << stats.files[v].filename().string();
+            for (const double value : values(v)) {
+                manifest << ',' << std::string_view(buffer, format_value(value, options.precision, buffer));
+            }
+            manifest << '\n';
+        }
+        if (!manifest) {
+            stats.errors.push_back("Cannot write the sweep manifest");
+        }
+    }
+
+    // 每个变体一个文件，按文件并行；未改动的段直接从原文写入，不经中间缓冲拼接
+    std::atomic<std::size_t> bytes{0};
+    std::mutex mutex;
+    auto& pool = options.pool ? *options.pool : mcnp::core::ThreadPool::shared();
+    pool.parallelFor(count, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t v = begin; v < end; ++v) {
+            std::ofstream out(stats.files[v], std::ios::binary);
+            const std::size_t written = out ? writeVariant(out, v, options.precision) : 0;
+            out.close();
+            if (!out) {
+                std::lock_guard<std::mutex> lock(mutex);
+                stats.errors.push_back("Cannot write " + stats.files[v].string());
+                continue;
+            }
+            bytes += written;
+        }
+    });
+    stats.bytes = bytes;
+    stats.variants = count;
+    return stats;
+}
+
+} // namespace mcnp::parser
@@ -0,0 +1,115 @@
+#ifndef DECK_SWEEP_H
+#define DECK_SWEEP_H
+
+#include "deck_tokenizer.h"
+#include "input_ast.h"
+#include "mcnp_parser.h"
+#include "thread_pool.h"
+
+#include <cstddef>
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mcnp::parser {
+
+// 参数绑定的卡片字段：单元/曲面按编号、数据卡按关键字（不区分大小写）找到卡片，
+// 再按参数下标（按原文写法计数，不展开简写）或按名称（IMP:N=1、VOL 2、FILL = 5 的值）定位
+struct SweepField {
+    static constexpr std::size_t kNamed = static_cast<std::size_t>(-1);
+
+    CardKind kind = CardKind::Data;
+    int number = 0;
+    std::string keyword;
+    std::size_t parameter = kNamed;
+    std::string name;
+    double scale = 1.0;  // 写入 value * scale + offset，便于一个参数驱动多个字段（如栅距的 ±p/2）
+    double offset = 0.0;
+
+    static SweepField cell(int number, std::size_t parameter);
+    static SweepField cell(int number, std::string name);
+    static SweepField surface(int number, std::size_t parameter);
+    static SweepField data(std::string keyword, std::size_t parameter);
+    static SweepField data(std::string keyword, std::string name);
+};
+
+struct SweepParameter {
+    std::string name;
+    std::vector<SweepField> fields;
+    std::vector<double> values;
+};
+
+// first 到 last 的 count 个等间距取值
+std::vector<double> sweepRange(double first, double last, std::size_t count);
+
+struct SweepOptions {
+    std::filesystem::path directory;  // 变体写入的目录，不存在时创建
+    std::string prefix;               // 文件名前缀，空时取原文件名；文件名为 <prefix>_<序号><扩展名>
+    std::string extension = ".i";
+    bool manifest = true;             // 另写 <prefix>_sweep.csv：序号、文件名与各参数取值
+    int precision = 10;               // 有效数字
+    std::size_t columnLimit = 128;    // 替换后超出该列数的行给出警告
+    mcnp::core::ThreadPool* pool = nullptr;  // 为空时使用共享线程池
+};
+
+struct SweepStats {
+    std::size_t variants = 0;
+    std::size_t bytes = 0;  // 写出的总字节数
+    std::vector<std::filesystem::path> files;
+    std::vector<std::string> warnings;
+    std::vector<std::string> errors;
+};
+
+// 参数扫描：把参数绑定到原卡片文件中字段的字节区间，各参数取值的笛卡尔积（末个参数变化最快）
+// 即全部变体。写变体时只格式化被替换的几个字段，其余内容直接从原文件（内存映射）整段写出，
+// 注释、折行与格式保持原样；变体之间按文件并行写出，耗时主要在磁盘 I/O。
+class DeckSweep {
+public:
+    // 内存映射读取卡片文件；失败返回 false，原因见 errors()
+    bool loadFile(const std::filesystem::path& path, const ParserOptions& options = {});
+    // 复制一份文本（编辑器中的卡片、测试）
+    void loadText(std::string text, const ParserOptions& options = {});
+
+    // 解析字段的位置；找不到卡片或字段、字段位于 READ 包含的文件中、是简写或被重复绑定时记为错误
+    bool bind(std::vector<SweepParameter> parameters);
+
+    std::size_t variantCount() const noexcept;
+    // 变体 variant 中各参数的取值
+    std::vector<double> values(std::size_t variant) const;
+    // 写出一个变体，返回字节数
+    std::size_t writeVariant(std::ostream& out, std::size_t variant, int precision = 10) const;
+    SweepStats writeAll(const SweepOptions& options) const;
+
+    std::string_view text() const noexcept;
+    const std::vector<SweepParameter>& parameters() const noexcept { return parameters_; }
+    const std::vector<std::string>& errors() const noexcept { return errors_; }
+    // 以 precision 位有效数字替换后超出 columnLimit 列的行
+    std::vector<std::string> columnWarnings(std::size_t columnLimit, int precision) const;
+
+private:
+    // 原文中的一处替换
+    struct Patch {
+        std::size_t begin = 0;
+        std::size_t length = 0;
+        std::size_t parameter = 0;
+        std::size_t field = 0;
+    };
+
+    bool resolve(const Ast& ast);
+    double fieldValue(const std::vector<double>& values, const Patch& patch) const;
+
+    MappedFile file_;
+    std::string owned_;
+    bool mapped_ = false;
+    std::filesystem::path path_;
+    ParserOptions parserOptions_;
+    std::vector<SweepParameter> parameters_;
+    std::vector<Patch> patches_;  // 按 begin 排序
+    std::vector<std::string> errors_;
+};
+
+} // namespace mcnp::parser
+
+#endif // DECK_SWEEP_H
@@ -0,0 +1,258 @@
+#include "deck_tokenizer.h"
+
+#include <cstring>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define MCNP_TOKENIZER_SSE2 1
+    #include <emmintrin.h>
+#endif
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace mcnp::parser {
+
+namespace {
+
+inline bool is_space(unsigned char ch) noexcept {
+    return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\v' || ch == '\f';
+}
+
+#ifdef MCNP_TOKENIZER_SSE2
+// 16 字节块中空白字符的位掩码
+inline unsigned whitespace_mask(const char* p) noexcept {
+    const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i ws = _mm_cmpeq_epi8(chunk, _mm_set1_epi8(' '));
+    ws = _mm_or_si128(ws, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t')));
+    ws = _mm_or_si128(ws, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r')));
+    ws = _mm_or_si128(ws, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\v')));
+    ws = _mm_or_si128(ws, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\f')));
+    return static_cast<unsigned>(_mm_movemask_epi8(ws));
+}
+
+inline unsigned count_trailing_zeros(unsigned value) noexcept {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index = 0;
+    _BitScanForward(&index, value);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(value));
+#endif
+}
+#endif
+
+} // namespace
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        opened_ = std::exchange(other.opened_, false);
+#ifdef _WIN32
+        fileHandle_ = std::exchange(other.fileHandle_, nullptr);
+        mappingHandle_ = std::exchange(other.mappingHandle_, nullptr);
+#endif
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::filesystem::path& path, std::string* error) {
+    close();
+    auto fail = [&](const char* what) {
+        if (error) {
+            *error = std::string(what) + ": " + path.string();
+        }
+        close();
+        return false;
+    };
+#ifdef _WIN32
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return fail("cannot open file");
+    }
+    fileHandle_ = file;
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file, &size)) {
+        return fail("cannot stat file");
+    }
+    opened_ = true;
+    size_ = static_cast<std::size_t>(size.QuadPart);
+    if (size_ == 0) {
+        return true;
+    }
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        return fail("cannot map file");
+    }
+    mappingHandle_ = mapping;
+    data_ = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!data_) {
+        return fail("cannot map file");
+    }
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return fail("cannot open file");
+    }
+    struct stat info {};
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        return fail("cannot stat file");
+    }
+    opened_ = true;
+    size_ = static_cast<std::size_t>(info.st_size);
+    if (size_ > 0) {
+        void* mapped = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            ::close(fd);
+            return fail("cannot map file");
+        }
+        data_ = static_cast<const char*>(mapped);
+        // 顺序读取提示，加快预读
+        ::madvise(mapped, size_, MADV_SEQUENTIAL);
+    }
+    ::close(fd);
+#endif
+    return true;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    if (data_) {
+        UnmapViewOfFile(data_);
+    }
+    if (mappingHandle_) {
+        CloseHandle(static_cast<HANDLE>(mappingHandle_));
+        mappingHandle_ = nullptr;
+    }
+    if (fileHandle_) {
+        CloseHandle(static_cast<HANDLE>(fileHandle_));
+        fileHandle_ = nullptr;
+    }
+#else
+    if (data_) {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+    data_ = nullptr;
+    size_ = 0;
+    opened_ = false;
+}
+
+const char* findNewline(const char* begin, const char* end) noexcept {
+    const char* p = begin;
+#ifdef MCNP_TOKENIZER_SSE2
+    const __m128i newline = _mm_set1_epi8('\n');
+    while (end - p >= 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)));
+        if (mask != 0) {
+            return p + count_trailing_zeros(mask);
+        }
+        p += 16;
+    }
+#endif
+    const void* found = std::memchr(p, '\n', static_cast<std::size_t>(end - p));
+    return found ? static_cast<const char*>(found) : end;
+}
+
+bool LineScanner::next(DeckLine& line) noexcept {
+    if (position_ >= text_.size()) {
+        return false;
+    }
+    const char* begin = text_.data() + position_;
+    const char* end = text_.data() + text_.size();
+    const char* newline = findNewline(begin, end);
+    std::size_t length = static_cast<std::size_t>(newline - begin);
+    if (length > 0 && begin[length - 1] == '\r') {
+        --length;
+    }
+    line.text = std::string_view(begin, length);
+    line.number = ++lineNumber_;
+    line.offset = position_;
+    position_ = static_cast<std::size_t>(newline - text_.data()) + (newline == end ? 0 : 1);
+    return true;
+}
+
+void tokenizeLine(const DeckLine& line, std::vector<Token>& out) {
+    const char* const base = line.text.data();
+    const std::size_t size = line.text.size();
+    const auto lineNumber = static_cast<std::uint32_t>(line.number);
+    std::size_t i = 0;
+    std::size_t tokenStart = 0;
+    bool inToken = false;
+
+    auto emit = [&](std::size_t end) {
+        out.push_back({std::string_view(base + tokenStart, end - tokenStart), lineNumber,
+                       static_cast<std::uint32_t>(tokenStart + 1)});
+    };
+
+#ifdef MCNP_TOKENIZER_SSE2
+    // 按 16 字节块取得空白掩码，在位掩码上找词元边界
+    for (; i + 16 <= size; i += 16) {
+        unsigned ws = whitespace_mask(base + i);
+        if (ws == 0xFFFFu && !inToken) {
+            continue;
+        }
+        if (ws == 0u && inToken) {
+            continue;
+        }
+        unsigned consumed = 0;
+        while (consumed < 16) {
+            const unsigned remaining = inToken ? (ws >> consumed) : (~ws & 0xFFFFu) >> consumed;
+            if (remaining == 0) {
+                break;
+            }
+            const unsigned offset = consumed + count_trailing_zeros(remaining);
+            if (inToken) {
+                emit(i + offset);
+            } else {
+                tokenStart = i + offset;
+            }
+            inToken = !inToken;
+            consumed = offset;
+        }
+    }
+#endif
+    for (; i < size; ++i) {
+        const bool space = is_space(static_cast<unsigned char>(base[i]));
+        if (inToken && space) {
+            emit(i);
+            inToken = false;
+        } else if (!inToken && !space) {
+            tokenStart = i;
+            inToken = true;
+        }
+    }
+    if (inToken) {
+        emit(size);
+    }
+}
+
+bool isBlankLine(std::string_view text) noexcept {
+    for (char ch : text) {
+        if (!is_space(static_cast<unsigned char>(ch))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace mcnp::parser
@@ -0,0 +1,82 @@
+#ifndef DECK_TOKENIZER_H
+#define DECK_TOKENIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mcnp::parser {
+
+// 只读内存映射文件；映射失败时 data() 为空
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    bool open(const std::filesystem::path& path, std::string* error = nullptr);
+    void close();
+
+    std::string_view view() const noexcept { return {data_, size_}; }
+    bool isOpen() const noexcept { return opened_; }
+
+private:
+    const char* data_{nullptr};
+    std::size_t size_{0};
+    bool opened_{false};  // 空文件也视为已打开
+#ifdef _WIN32
+    void* fileHandle_{nullptr};
+    void* mappingHandle_{nullptr};
+#endif
+};
+
+// 物理行（不含换行符和行尾 '\r'）
+struct DeckLine {
+    std::string_view text;
+    std::size_t number = 0;  // 从 1 开始
+    std::size_t offset = 0;  // 行首在整个输入中的字节偏移
+};
+
+// 指向输入缓冲区的词元，不复制字符
+struct Token {
+    std::string_view text;
+    std::uint32_t line = 0;
+    std::uint32_t column = 0;  // 从 1 开始
+};
+
+// 逐行扫描；换行符用 SIMD 查找
+class LineScanner {
+public:
+    // firstLine 为首行行号；分块解析时用于保持与整篇解析相同的行号
+    explicit LineScanner(std::string_view text, std::size_t firstLine = 1) noexcept
+        : text_(text), lineNumber_(firstLine - 1) {}
+
+    bool next(DeckLine& line) noexcept;
+    std::size_t position() const noexcept { return position_; }
+    std::size_t lineNumber() const noexcept { return lineNumber_; }
+
+private:
+    std::string_view text_;
+    std::size_t position_{0};
+    std::size_t lineNumber_{0};
+};
+
+// 查找 [begin, end) 中第一个 '\n'，不存在时返回 end
+const char* findNewline(const char* begin, const char* end) noexcept;
+
+// 以空白（空格、制表符、'\r' 等）切分一行，结果追加到 out；out 可在多行间复用以避免分配
+void tokenizeLine(const DeckLine& line, std::vector<Token>& out);
+
+// 行内是否只有空白
+bool isBlankLine(std::string_view text) noexcept;
+
+} // namespace mcnp::parser
+
+#endif // DECK_TOKENIZER_H
@@ -0,0 +1,892 @@
+#include "fluka_parser.h"
+#include "deck_tokenizer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+
+namespace mcnp::parser {
+
+namespace {
+
+using mcnp::core::CsgDag;
+using mcnp::core::Quadric;
+using mcnp::core::SurfaceTable;
+using NodeId = CsgDag::NodeId;
+
+enum class Section {
+    Cards,
+    Title,          // TITLE 卡之后的标题行
+    GeometryTitle,  // GEOBEGIN 之后的几何标题行
+    Bodies,
+    Regions,
+    Lattices        // 区域 END 与 GEOEND 之间的 LATTICE 等卡片
+};
+
+constexpr std::string_view kBodyCodes[] = {"ARB", "BOX", "ELL", "PLA", "QUA", "RAW", "RCC", "REC", "RPP", "SPH", "TRC",
+                                           "WED", "XCC", "XEC", "XYP", "XZP", "YCC", "YEC", "YZP", "ZCC", "ZEC"};
+
+struct PredefinedMaterial {
+    const char* name;
+    double density;
+};
+
+// FLUKA 预定义材料，顺序即材料号
+constexpr PredefinedMaterial kPredefined[] = {
+    {"BLCKHOLE", 0.0},     {"VACUUM", 0.0},     {"HYDROGEN", 8.37e-5}, {"HELIUM", 1.66e-4}, {"BERYLLIU", 1.848},
+    {"CARBON", 2.0},       {"NITROGEN", 1.17e-3}, {"OXYGEN", 1.33e-3}, {"MAGNESIU", 1.74},  {"ALUMINUM", 2.699},
+    {"IRON", 7.874},       {"COPPER", 8.96},    {"SILVER", 10.5},      {"SILICON", 2.329},  {"GOLD", 19.32},
+    {"MERCURY", 13.546},   {"LEAD", 11.35},     {"TANTALUM", 16.654},  {"SODIUM", 0.971},   {"ARGON", 1.66e-3},
+    {"CALCIUM", 1.55},     {"TIN", 7.31},       {"TUNGSTEN", 19.3},    {"TITANIUM", 4.54},  {"NICKEL", 8.902},
+};
+
+std::string upper(std::string_view text) {
+    std::string out(text);
+    for (char& c : out) {
+        c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+    return out;
+}
+
+// 卡片名只比较前 8 个字符（ASSIGNMAT 与 ASSIGNMA 等价）
+std::string card_name(std::string_view keyword) {
+    return upper(keyword.substr(0, 8));
+}
+
+bool is_body_code(std::string_view token) {
+    if (token.size() != 3) {
+        return false;
+    }
+    const std::string code = upper(token);
+    return std::find(std::begin(kBodyCodes), std::end(kBodyCodes), code) != std::end(kBodyCodes);
+}
+
+bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && is_blank(text.front())) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && is_blank(text.back())) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+// 定长字段（first 从 0 起）；超出行尾为空
+Token fixed_field(const DeckLine& line, std::size_t first, std::size_t width) {
+    Token token{std::string_view{}, static_cast<std::uint32_t>(line.number), static_cast<std::uint32_t>(first + 1)};
+    if (first >= line.text.size()) {
+        return token;
+    }
+    std::string_view field = line.text.substr(first, width);
+    std::size_t lead = 0;
+    while (lead < field.size() && is_blank(field[lead])) {
+        ++lead;
+    }
+    token.text = trim(field);
+    token.column += static_cast<std::uint32_t>(lead);
+    return token;
+}
+
+// 自由格式：连续空白为一个分隔符，逗号、分号各结束一个字段（两个逗号之间为空字段）
+void split_free(const DeckLine& line, std::string_view text, std::vector<Token>& out) {
+    out.clear();
+    bool separated = false;
+    std::size_t i = 0;
+    while (i < text.size()) {
+        if (is_blank(text[i])) {
+            ++i;
+            continue;
+        }
+        if (text[i] == ',' || text[i] == ';') {
+            if (separated) {
+                out.push_back({std::string_view{}, static_cast<std::uint32_t>(line.number),
+                               static_cast<std::uint32_t>(i + 1)});
+            }
+            separated = true;
+            ++i;
+            continue;
+        }
+        const std::size_t start = i;
+        while (i < text.size() && !is_blank(text[i]) && text[i] != ',' && text[i] != ';') {
+            ++i;
+        }
+        out.push_back({text.substr(start, i - start), static_cast<std::uint32_t>(line.number),
+                       static_cast<std::uint32_t>(start + 1)});
+        separated = false;
+    }
+}
+
+// 自由格式与几何行的 ! 行内注释
+std::string_view strip_comment(std::string_view text) {
+    const std::size_t bang = text.find('!');
+    return bang == std::string_view::npos ? text : text.substr(0, bang);
+}
+
+// 区域表达式切分为 +名、-名、+(、-(、)、| 词元
+bool lex_region(const DeckLine& line, std::size_t from, std::vector<Token>& out, std::string& error) {
+    const std::string_view text = line.text;
+    auto token = [&](std::string_view t, std::size_t column) {
+        out.push_back({t, static_cast<std::uint32_t>(line.number), static_cast<std::uint32_t>(column + 1)});
+    };
+    std::size_t i = from;
+    while (i < text.size()) {
+        const char c = text[i];
+        if (is_blank(c)) {
+            ++i;
+        } else if (c == '!') {
+            break;
+        } else if (c == '|' || c == ')') {
+            token(text.substr(i, 1), i);
+            ++i;
+        } else if (c == '(') {
+            token("+(", i);
+            ++i;
+        } else if (c == '+' || c == '-') {
+            std::size_t j = i + 1;
+            while (j < text.size() && is_blank(text[j])) {
+                ++j;
+            }
+            if (j < text.size() && text[j] == '(') {
+                token(c == '+' ? "+(" : "-(", i);
+                i = j + 1;
+                continue;
+            }
+            const std::size_t start = j;
+            while (j < text.size() && (std::isalnum(static_cast<unsigned char>(text[j])) || text[j] == '_')) {
+                ++j;
+            }
+            if (j == start) {
+                error = "expected a body name after '" + std::string(1, c) + "'";
+                return false;
+            }
+            if (start != i + 1) {
+                error = "whitespace between sign and body name at column " + std::to_string(i + 1);
+                return false;
+            }
+            token(text.substr(i, j - i), i);
+            i = j;
+        } else {
+            error = "unexpected '" + std::string(1, c) + "' in region expression";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool parse_number(std::string_view text, double& value) {
+    if (!text.empty() && text.front() == '+') {
+        text.remove_prefix(1);
+    }
+    // Fortran 的 D 指数
+    char buffer[64] = {};
+    if (text.empty() || text.size() >= sizeof(buffer)) {
+        return false;
+    }
+    std::size_t n = 0;
+    for (const char c : text) {
+        buffer[n++] = c == 'd' || c == 'D' ? 'e' : c;
+    }
+    const auto result = std::from_chars(buffer, buffer + n, value);
+    return result.ec == std::errc() && result.ptr == buffer + n;
+}
+
+// 卡片在构造中：几何体与区域可以跨多行
+struct Pending {
+    bool open = false;
+    CardKind kind = CardKind::Data;
+    std::string keyword;
+    std::vector<Token> parameters;
+    std::size_t line = 0;
+    std::size_t begin = 0;
+    std::size_t end = 0;
+};
+
+struct ParseState {
+    ParseState(std::string_view input, bool freeFormat) : text(input), freeCards(freeFormat) {}
+
+    std::string_view text;
+    ParseResult result;
+    Section section = Section::Cards;
+    bool freeCards = false;
+    bool freeGeometry = false;
+    std::size_t bodyCount = 0;
+    std::size_t regionCount = 0;
+    Pending pending;
+    std::vector<Token> tokens;
+
+    void error(std::size_t line, std::string message) { result.errors.push_back({line, std::move(message), {}}); }
+
+    void flush() {
+        if (!pending.open) {
+            return;
+        }
+        result.ast.addCard(pending.kind, pending.line, pending.keyword,
+                           text.substr(pending.begin, pending.end - pending.begin), 0, pending.begin);
+        for (const Token& t : pending.parameters) {
+            result.ast.addParameter(t.text, t.line, t.column);
+        }
+        pending.open = false;
+        pending.parameters.clear();
+    }
+
+    void start(CardKind kind, std::string keyword, const DeckLine& line) {
+        flush();
+        pending.open = true;
+        pending.kind = kind;
+        pending.keyword = std::move(keyword);
+        pending.line = line.number;
+        pending.begin = line.offset;
+        pending.end = line.offset + line.text.size();
+    }
+
+    void extend(const DeckLine& line) { pending.end = line.offset + line.text.size(); }
+
+    void card(const DeckLine& line);
+    void body(const DeckLine& line);
+    void region(const DeckLine& line);
+    void process(const DeckLine& line);
+};
+
+// 普通卡片：WHAT(1..6) 与 SDUM 总是补齐为 7 个参数
+void ParseState::card(const DeckLine& line) {
+    Token keyword;
+    std::vector<Token> fields;
+    if (freeCards) {
+        split_free(line, strip_comment(line.text), tokens);
+        if (tokens.empty()) {
+            return;
+        }
+        keyword = tokens.front();
+        fields.assign(tokens.begin() + 1, tokens.begin() + std::min<std::size_t>(tokens.size(), 8));
+        if (tokens.size() > 8) {
+            error(line.number, "too many fields on " + std::string(keyword.text));
+        }
+    } else {
+        keyword = fixed_field(line, 0, 10);
+        for (std::size_t i = 0; i < 6; ++i) {
+            fields.push_back(fixed_field(line, 10 + 10 * i, 10));
+        }
+        fields.push_back(fixed_field(line, 70, 10));
+    }
+    while (fields.size() < 7) {
+        fields.push_back({std::string_view{}, static_cast<std::uint32_t>(line.number), 0});
+    }
+    if (keyword.text.empty()) {
+        error(line.number, "card without keyword");
+        return;
+    }
+
+    start(CardKind::Data, std::string(keyword.text), line);
+    pending.parameters = fields;
+    flush();
+
+    const std::string name = card_name(keyword.text);
+    if (name == "FREE") {
+        freeCards = true;
+    } else if (name == "FIXED") {
+        freeCards = false;
+    } else if (name == "GLOBAL") {
+        double mode = 0.0;
+        if (parse_number(fields[3].text, mode) && mode > 0.0) {
+            const int flags = static_cast<int>(mode);
+            freeCards = flags == 1 || flags == 3;
+            freeGeometry = flags >= 2;
+        }
+    } else if (name == "TITLE") {
+        section = Section::Title;
+    } else if (name == "GEOBEGIN") {
+        double unit = 0.0;
+        if (parse_number(fields[2].text, unit) && unit > 0.0) {
+            error(line.number, "geometry read from another logical unit is not supported");
+        }
+        // 自由格式中 COMBNAME 常直接写在卡片名之后
+        const bool combined = std::any_of(fields.begin(), fields.end(),
+                                          [](const Token& field) { return upper(field.text) == "COMBNAME"; });
+        freeGeometry = freeGeometry || combined;
+        section = Section::GeometryTitle;
+    } else if (name == "GEOEND") {
+        section = Section::Cards;
+    }
+}
+
+void ParseState::body(const DeckLine& line) {
+    if (freeGeometry) {
+        split_free(line, strip_comment(line.text), tokens);
+        if (tokens.empty()) {
+            return;
+        }
+        const std::string_view first = tokens.front().text;
+        if (upper(first) == "END") {
+            flush();
+            section = Section::Regions;
+            return;
+        }
+        if (first.front() == '$') {
+            flush();
+            error(line.number, "geometry directive " + std::string(first) + " is not supported");
+            return;
+        }
+        if (is_body_code(first)) {
+            if (tokens.size() < 2) {
+                error(line.number, "body without name");
+                return;
+            }
+            start(CardKind::Surface, std::string(tokens[1].text), line);
+            pending.parameters.push_back(tokens[0]);
+            pending.parameters.insert(pending.parameters.end(), tokens.begin() + 2, tokens.end());
+            ++bodyCount;
+            return;
+        }
+        if (!pending.open) {
+            error(line.number, "values outside of a body definition");
+            return;
+        }
+        extend(line);
+        pending.parameters.insert(pending.parameters.end(), tokens.begin(), tokens.end());
+        return;
+    }
+
+    // 旧式定长：2X,A3,I5,6D10.3，续行类型码为空
+    const Token code = fixed_field(line, 2, 3);
+    if (upper(code.text) == "END") {
+        flush();
+        section = Section::Regions;
+        return;
+    }
+    if (!code.text.empty()) {
+        if (!is_body_code(code.text)) {
+            error(line.number, "unknown body type " + std::string(code.text));
+            return;
+        }
+        ++bodyCount;
+        start(CardKind::Surface, std::to_string(bodyCount), line);
+        pending.parameters.push_back(code);
+    } else if (!pending.open) {
+        error(line.number, "values outside of a body definition");
+        return;
+    } else {
+        extend(line);
+    }
+    for (std::size_t i = 0; i < 6; ++i) {
+        const Token value = fixed_field(line, 10 + 10 * i, 10);
+        if (!value.text.empty()) {
+            pending.parameters.push_back(value);
+        }
+    }
+}
+
+void ParseState::region(const DeckLine& line) {
+    std::string message;
+    if (freeGeometry) {
+        if (!line.text.empty() && !is_blank(line.text.front())) {
+            split_free(line, strip_comment(line.text), tokens);
+            if (tokens.empty()) {
+                return;
+            }
+            if (upper(tokens.front().text) == "END") {
+                flush();
+                section = Section::Lattices;
+                return;
+            }
+            if (tokens.size() < 2) {
+                error(line.number, "region " + std::string(tokens.front().text) + " needs NAZ and an expression");
+                return;
+            }
+            start(CardKind::Cell, std::string(tokens[0].text), line);
+            ++regionCount;
+            pending.parameters.push_back(tokens[1]);
+            const std::size_t from = tokens[1].column - 1 + tokens[1].text.size();
+            if (!lex_region(line, from, pending.parameters, message)) {
+                error(line.number, message);
+            }
+            return;
+        }
+        if (!pending.open) {
+            if (!trim(line.text).empty()) {
+                error(line.number, "expression outside of a region definition");
+            }
+            return;
+        }
+        extend(line);
+        if (!lex_region(line, 0, pending.parameters, message)) {
+            error(line.number, message);
+        }
+        return;
+    }
+
+    // 旧式定长：2X,A3,I5,9(A2,I5)，操作符 OR 表示并，续行名称为空
+    const Token name = fixed_field(line, 2, 3);
+    if (upper(name.text) == "END") {
+        flush();
+        section = Section::Lattices;
+        return;
+    }
+    if (!name.text.empty()) {
+        ++regionCount;
+        start(CardKind::Cell, std::to_string(regionCount), line);
+        Token naz = fixed_field(line, 5, 5);
+        if (naz.text.empty()) {
+            naz.text = "5";
+        }
+        pending.parameters.push_back(naz);
+    } else if (!pending.open) {
+        return;
+    } else {
+        extend(line);
+    }
+    for (std::size_t i = 0; i < 9; ++i) {
+        const std::size_t column = 10 + 7 * i;
+        const Token op = fixed_field(line, column, 2);
+        Token body = fixed_field(line, column + 2, 5);
+        if (upper(op.text) == "OR") {
+            pending.parameters.push_back({"|", op.line, op.column});
+        } else if (!op.text.empty()) {
+            error(line.number, "unknown region operator " + std::string(op.text));
+        }
+        if (body.text.empty()) {
+            continue;
+        }
+        // 旧式中正号可省略
+        const std::string signedBody = body.text.front() == '-' || body.text.front() == '+'
+                                           ? std::string(body.text)
+                                           : "+" + std::string(body.text);
+        body.text = result.ast.storeText(signedBody);
+        pending.parameters.push_back(body);
+    }
+}
+
+void ParseState::process(const DeckLine& line) {
+    // 几何标题与 TITLE 后的标题行原样保留
+    if (section == Section::Title || section == Section::GeometryTitle) {
+        result.ast.addCard(CardKind::Title, line.number, "title", line.text, 0, line.offset);
+        section = section == Section::Title ? Section::Cards : Section::Bodies;
+        return;
+    }
+    if (!line.text.empty() && line.text.front() == '*') {
+        result.ast.addCard(CardKind::Comment, line.number, "comment", line.text, 0, line.offset);
+        return;
+    }
+    if (!line.text.empty() && line.text.front() == '#') {
+        error(line.number, "preprocessor directive is not supported: " + std::string(trim(line.text)));
+        return;
+    }
+    if (isBlankLine(line.text)) {
+        return;
+    }
+    switch (section) {
+        case Section::Bodies:
+            body(line);
+            break;
+        case Section::Regions:
+            region(line);
+            break;
+        default:
+            card(line);
+            break;
+    }
+}
+
+// 材料号或区域号：按名称查找，纯数字按编号
+int lookup(std::string_view text, const std::unordered_map<std::string, int>& index, std::size_t count) {
+    const auto it = index.find(upper(text));
+    if (it != index.end()) {
+        return it->second;
+    }
+    double value = 0.0;
+    if (parse_number(text, value) && value >= 1.0 && value <= static_cast<double>(count) &&
+        value == std::floor(value)) {
+        return static_cast<int>(value);
+    }
+    return 0;
+}
+
+Quadric from_matrix(const glm::dmat3& m, const glm::dvec3& center, double constant) {
+    // (p - c)ᵀ M (p - c) + constant
+    Quadric q;
+    q.c[SurfaceTable::A] = m[0][0];
+    q.c[SurfaceTable::B] = m[1][1];
+    q.c[SurfaceTable::C] = m[2][2];
+    q.c[SurfaceTable::D] = 2.0 * m[0][1];
+    q.c[SurfaceTable::E] = 2.0 * m[1][2];
+    q.c[SurfaceTable::F] = 2.0 * m[0][2];
+    const glm::dvec3 linear = -2.0 * (m * center);
+    q.c[SurfaceTable::G] = linear.x;
+    q.c[SurfaceTable::H] = linear.y;
+    q.c[SurfaceTable::J] = linear.z;
+    q.c[SurfaceTable::K] = glm::dot(center, m * center) + constant;
+    return q;
+}
+
+// 一张区域卡片的表达式：zone { | zone }，zone 为若干 +体 / -体 / ±( … ) 的交
+class RegionBuilder {
+public:
+    RegionBuilder(const CardView& card, FlukaModel& model) : card_(card), model_(model) {}
+
+    NodeId build(std::string& error) {
+        position_ = 1;  // 参数 0 为 NAZ
+        const NodeId root = expression(error);
+        if (error.empty() && position_ < card_.parameterCount()) {
+            error = "unbalanced ')' in region " + std::string(card_.keyword());
+        }
+        return root;
+    }
+
+private:
+    NodeId expression(std::string& error) {
+        std::vector<NodeId> zones;
+        std::vector<NodeId> terms;
+        auto close_zone = [&]() {
+            if (terms.empty()) {
+                return;
+            }
+            zones.push_back(terms.size() == 1 ? terms.front() : model_.dag.intersection(terms));
+            terms.clear();
+        };
+        while (position_ < card_.parameterCount() && error.empty()) {
+            const std::string_view token = card_.parameter(position_);
+            if (token == ")") {
+                break;
+            }
+            ++position_;
+            if (token == "|") {
+                close_zone();
+                continue;
+            }
+            if (token == "+(" || token == "-(") {
+                const NodeId inner = expression(error);
+                if (position_ >= card_.parameterCount() || card_.parameter(position_) != ")") {
+                    error = error.empty() ? "missing ')' in region " + std::string(card_.keyword()) : error;
+                    return model_.dag.empty();
+                }
+                ++position_;
+                terms.push_back(token.front() == '-' ? model_.dag.complement(inner) : inner);
+                continue;
+            }
+            if (token.size() < 2 || (token.front() != '+' && token.front() != '-')) {
+                error = "unexpected token '" + std::string(token) + "' in region " + std::string(card_.keyword());
+                return model_.dag.empty();
+            }
+            const int body = model_.findBody(token.substr(1));
+            if (body == 0) {
+                error = "undefined body " + std::string(token.substr(1)) + " in region " +
+                        std::string(card_.keyword());
+                return model_.dag.empty();
+            }
+            terms.push_back(model_.dag.halfspace(body, token.front() == '+'));
+        }
+        close_zone();
+        if (zones.empty()) {
+            if (error.empty()) {
+                error = "empty expression in region " + std::string(card_.keyword());
+            }
+            return model_.dag.empty();
+        }
+        return zones.size() == 1 ? zones.front() : model_.dag.unite(zones);
+    }
+
+    const CardView& card_;
+    FlukaModel& model_;
+    std::size_t position_ = 1;
+};
+
+} // namespace
+
+bool addFlukaBody(SurfaceTable& table, int id, std::string_view code, std::span<const double> v, std::string* error) {
+    const std::string type = upper(code);
+    auto count = [&](std::size_t n) {
+        if (v.size() == n) {
+            return true;
+        }
+        if (error) {
+            *error = type + " needs " + std::to_string(n) + " values, got " + std::to_string(v.size());
+        }
+        return false;
+    };
+    auto add = [&](std::string_view mnemonic, std::span<const double> values) {
+        return table.add(id, mnemonic, values, nullptr, mcnp::core::BoundaryKind::None, error);
+    };
+    auto add_quadric = [&](const Quadric& q) { return add("gq", q.c); };
+
+    if (type == "RPP") {
+        return count(6) && add("rpp", v);
+    }
+    if (type == "BOX") {
+        return count(12) && add("box", v);
+    }
+    if (type == "SPH") {
+        return count(4) && add("s", v);
+    }
+    if (type == "RCC") {
+        return count(7) && add("rcc", v);
+    }
+    if (type == "TRC") {
+        return count(8) && add("trc", v);
+    }
+    if (type == "XYP" || type == "XZP" || type == "YZP") {
+        const char* mnemonic = type == "XYP" ? "pz" : type == "XZP" ? "py" : "px";
+        return count(1) && add(mnemonic, v);
+    }
+    if (type == "PLA") {
+        if (!count(6)) {
+            return false;
+        }
+        const glm::dvec3 n(v[0], v[1], v[2]);
+        const double values[] = {n.x, n.y, n.z, glm::dot(n, glm::dvec3(v[3], v[4], v[5]))};
+        return add("p", values);
+    }
+    if (type == "XCC" || type == "ZCC") {
+        return count(3) && add(type == "XCC" ? "c/x" : "c/z", v);
+    }
+    if (type == "YCC") {
+        // FLUKA 为 z x R，MCNP C/Y 为 x z R
+        if (!count(3)) {
+            return false;
+        }
+        const double values[] = {v[1], v[0], v[2]};
+        return add("c/y", values);
+    }
+    if (type == "XEC" || type == "YEC" || type == "ZEC") {
+        if (!count(4)) {
+            return false;
+        }
+        // 两个横向坐标按 FLUKA 的顺序：XEC y z，YEC z x，ZEC x y
+        const int first = type == "XEC" ? 1 : type == "YEC" ? 2 : 0;
+        const int second = type == "XEC" ? 2 : type == "YEC" ? 0 : 1;
+        if (v[2] <= 0.0 || v[3] <= 0.0) {
+            if (error) {
+                *error = type + " semi-axes must be positive";
+            }
+            return false;
+        }
+        glm::dmat3 m(0.0);
+        glm::dvec3 center(0.0);
+        m[first][first] = 1.0 / (v[2] * v[2]);
+        m[second][second] = 1.0 / (v[3] * v[3]);
+        center[first] = v[0];
+        center[second] = v[1];
+        return add_quadric(from_matrix(m, center, -1.0));
+    }
+    if (type == "ELL") {
+        if (!count(7)) {
+            return false;
+        }
+        // 两焦点与长轴长度：a = L/2，b² = a² - (焦距/2)²
+        const glm::dvec3 f1(v[0], v[1], v[2]);
+        const glm::dvec3 f2(v[3], v[4], v[5]);
+        const double a = 0.5 * v[6];
+        const double e = 0.5 * glm::length(f2 - f1);
+        if (!(a > e)) {
+            if (error) {
+                *error = "ELL major axis must exceed the focal distance";
+            }
+            return false;
+        }
+        const double b2 = a * a - e * e;
+        const glm::dvec3 axis = e > 0.0 ? (f2 - f1) / (2.0 * e) : glm::dvec3(0.0, 0.0, 1.0);
+        glm::dmat3 m(0.0);
+        for (int c = 0; c < 3; ++c) {
+            for (int r = 0; r < 3; ++r) {
+                m[c][r] = (c == r ? 1.0 / b2 : 0.0) + (1.0 / (a * a) - 1.0 / b2) * axis[c] * axis[r];
+            }
+        }
+        return add_quadric(from_matrix(m, 0.5 * (f1 + f2), -1.0));
+    }
+    if (type == "QUA") {
+        if (!count(10)) {
+            return false;
+        }
+        // FLUKA：Axx Ayy Azz Axy Axz Ayz Ax Ay Az A0；GQ 的 E 为 yz、F 为 zx
+        const double values[] = {v[0], v[1], v[2], v[3], v[5], v[4], v[6], v[7], v[8], v[9]};
+        return add("gq", values);
+    }
+    if (error) {
+        *error = "unsupported FLUKA body " + type;
+    }
+    return false;
+}
+
+FlukaParser::FlukaParser(FlukaParserOptions options) : options_(options) {}
+
+ParseResult FlukaParser::parse(std::string_view text) const {
+    auto owned = std::make_shared<const std::string>(text);
+    const std::string_view view = *owned;
+    return parseText(view, std::move(owned));
+}
+
+ParseResult FlukaParser::parseText(std::string_view text, std::shared_ptr<const void> owner) const {
+    ParseState state(text, options_.freeFormat);
+    state.result.ast.retainSource(0, std::move(owner));
+    LineScanner scanner(text);
+    DeckLine line;
+    while (scanner.next(line)) {
+        state.process(line);
+    }
+    state.flush();
+    if (state.section != Section::Cards) {
+        state.error(scanner.lineNumber(), "geometry is not terminated by GEOEND");
+    }
+    return std::move(state.result);
+}
+
+ParseResult FlukaParser::parseFile(const std::filesystem::path& path) const {
+    auto file = std::make_shared<MappedFile>();
+    std::string error;
+    if (!file->open(path, &error)) {
+        ParseResult result;
+        result.errors.push_back({0, error, path.string()});
+        return result;
+    }
+    const std::string_view view = file->view();
+    return parseText(view, std::move(file));
+}
+
+int FlukaModel::findBody(std::string_view name) const {
+    const auto it = bodyIndex.find(upper(name));
+    return it == bodyIndex.end() ? 0 : it->second;
+}
+
+int FlukaModel::findRegion(std::string_view name) const {
+    const auto it = regionIndex.find(upper(name));
+    return it == regionIndex.end() ? 0 : it->second;
+}
+
+int FlukaModel::findMaterial(std::string_view name) const {
+    const auto it = materialIndex.find(upper(name));
+    return it == materialIndex.end() ? 0 : it->second;
+}
+
+FlukaModel compileFluka(const Ast& ast) {
+    FlukaModel model;
+    for (const PredefinedMaterial& material : kPredefined) {
+        model.materials.push_back({material.name, material.density});
+        model.materialIndex.emplace(material.name, static_cast<int>(model.materials.size()));
+    }
+
+    std::vector<double> values;
+    std::vector<std::size_t> regionCards;
+    std::vector<std::size_t> dataCards;
+    auto fail = [&](const CardView& card, std::string message) {
+        model.errors.push_back({card.line(), std::move(message), {}});
+    };
+    auto number = [&](const CardView& card, std::size_t index, double fallback) {
+        double value = fallback;
+        const std::string_view text = index < card.parameterCount() ? card.parameter(index) : std::string_view{};
+        if (!text.empty() && !parse_number(text, value)) {
+            fail(card, "invalid number '" + std::string(text) + "' on " + std::string(card.keyword()));
+            return fallback;
+        }
+        return value;
+    };
+
+    // 几何体与 MATERIAL 先于区域与 ASSIGNMA 处理，卡片顺序不影响引用
+    for (std::size_t i = 0; i < ast.cardCount(); ++i) {
+        const CardView card = ast.card(i);
+        if (card.kind() == CardKind::Cell) {
+            regionCards.push_back(i);
+            continue;
+        }
+        if (card.kind() == CardKind::Title) {
+            if (model.title.empty()) {
+                model.title = std::string(trim(card.raw()));
+            }
+            continue;
+        }
+        if (card.kind() == CardKind::Data) {
+            const std::string name = card_name(card.keyword());
+            if (name == "MATERIAL") {
+                const std::string material = upper(card.parameterCount() > 6 ? card.parameter(6) : "");
+                if (material.empty()) {
+                    fail(card, "MATERIAL without name");
+                    continue;
+                }
+                const double density = number(card, 2, 0.0);
+                auto [it, added] = model.materialIndex.emplace(material, static_cast<int>(model.materials.size()) + 1);
+                if (added) {
+                    model.materials.push_back({material, density});
+                } else {
+                    model.materials[it->second - 1].density = density;
+                }
+            } else if (name == "ASSIGNMA" || name == "LATTICE") {
+                dataCards.push_back(i);
+            }
+            continue;
+        }
+        if (card.kind() != CardKind::Surface || card.parameterCount() == 0) {
+            continue;
+        }
+        const int id = static_cast<int>(model.bodies.size()) + 1;
+        const std::string name = upper(card.keyword());
+        if (!model.bodyIndex.emplace(name, id).second) {
+            fail(card, "body " + std::string(card.keyword()) + " is defined twice");
+            continue;
+        }
+        model.bodies.push_back(std::string(card.keyword()));
+        values.clear();
+        bool valid = true;
+        for (std::size_t p = 1; p < card.parameterCount() && valid; ++p) {
+            double value = 0.0;
+            valid = parse_number(card.parameter(p), value);
+            values.push_back(value);
+        }
+        std::string error;
+        if (!valid) {
+            fail(card, "invalid number on body " + std::string(card.keyword()));
+        } else if (!addFlukaBody(model.surfaces, id, card.parameter(0), values, &error)) {
+            fail(card, "body " + std::string(card.keyword()) + ": " + error);
+        }
+    }
+
+    model.regions.reserve(regionCards.size());
+    for (const std::size_t i : regionCards) {
+        const CardView card = ast.card(i);
+        FlukaRegion region;
+        region.name = std::string(card.keyword());
+        region.card = i;
+        if (!model.regionIndex.emplace(upper(region.name), static_cast<int>(model.regions.size()) + 1).second) {
+            fail(card, "region " + region.name + " is defined twice");
+            continue;
+        }
+        std::string error;
+        region.region = RegionBuilder(card, model).build(error);
+        if (!error.empty()) {
+            fail(card, error);
+        }
+        model.regions.push_back(std::move(region));
+    }
+
+    for (const std::size_t i : dataCards) {
+        const CardView card = ast.card(i);
+        const bool assign = card_name(card.keyword()) == "ASSIGNMA";
+        // ASSIGNMA：WHAT(1) 材料，WHAT(2..4) 区域范围与步长；LATTICE：WHAT(1..3) 区域范围与步长
+        const std::size_t first = assign ? 1 : 0;
+        const int material = assign ? lookup(card.parameter(0), model.materialIndex, model.materials.size()) : 0;
+        if (assign && material == 0) {
+            fail(card, "undefined material " + std::string(card.parameter(0)));
+            continue;
+        }
+        const int lower = lookup(card.parameter(first), model.regionIndex, model.regions.size());
+        const std::string_view upperText = card.parameter(first + 1);
+        const int upperRegion = upperText.empty() ? lower
+                                                  : lookup(upperText, model.regionIndex, model.regions.size());
+        const int step = std::max(1, static_cast<int>(number(card, first + 2, 1.0)));
+        if (lower == 0 || upperRegion == 0) {
+            fail(card, "undefined region on " + std::string(card.keyword()));
+            continue;
+        }
+        for (int r = lower; r <= upperRegion; r += step) {
+            if (assign) {
+                model.regions[r - 1].material = material;
+            } else {
+                model.lattices.push_back({r, std::string(card.parameter(6))});
+            }
+        }
+    }
+    return model;
+}
+
+} // namespace mcnp::parser
@@ -0,0 +1,97 @@
+#ifndef FLUKA_PARSER_H
+#define FLUKA_PARSER_H
+
+#include "csg_dag.h"
+#include "mcnp_parser.h"
+#include "surface_table.h"
+
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace mcnp::parser {
+
+struct FlukaParserOptions {
+    bool freeFormat = false;  // 普通卡片一开始就按自由格式读（等价于首行的 FREE 卡）
+};
+
+// FLUKA 输入映射到与 MCNP 相同的扁平 AST：
+// - 普通卡片为 Data，关键字为卡片名，参数依次为 WHAT(1)…WHAT(6) 与 SDUM，空字段为空串；
+// - GEOBEGIN 与 GEOEND 之间的几何体为 Surface，关键字为几何体名，参数为类型码与数值；
+// - 区域为 Cell，关键字为区域名，参数为 NAZ 与表达式词元（+名、-名、+(、-(、)、|）；
+// - TITLE 卡与几何标题行为 Title，* 开头的行为 Comment。
+// 普通卡片支持定长（A10 + 6×10 列 + SDUM）与自由格式（FREE/FIXED 卡、GLOBAL WHAT(4) 切换）；
+// 几何支持按名称的自由格式（GEOBEGIN 的 SDUM 为 COMBNAME）与旧式的定长编号格式。
+class FlukaParser final : public InputParser {
+public:
+    explicit FlukaParser(FlukaParserOptions options = {});
+    // 输入整体复制一次，卡片的原始文本引用这份副本
+    ParseResult parse(std::string_view text) const override;
+    // 结果持有文件映射，不复制文件内容
+    ParseResult parseFile(const std::filesystem::path& path) const;
+
+private:
+    // owner 持有 text，交给结果中的 AST 保管
+    ParseResult parseText(std::string_view text, std::shared_ptr<const void> owner) const;
+
+    FlukaParserOptions options_;
+};
+
+struct FlukaMaterial {
+    std::string name;
+    double density = 0.0;  // g/cm³；0 表示未给出
+};
+
+struct FlukaRegion {
+    std::string name;
+    mcnp::core::CsgDag::NodeId region = mcnp::core::CsgDag::kInvalid;
+    int material = 0;      // materials 下标 + 1；0 表示未赋材料
+    std::size_t card = 0;  // 在 AST 中的卡片下标
+};
+
+struct FlukaLattice {
+    int region = 0;         // regions 下标 + 1
+    std::string transform;  // LATTICE 的 SDUM：ROT-DEFI 变换名
+};
+
+// 编译结果与 MCNP 共用曲面表与 CSG DAG：几何体 i（从 1 起）即曲面号 i，
+// 区域中的 +体 为曲面负侧（内部），-体 为正侧
+struct FlukaModel {
+    std::string title;  // TITLE 卡的标题
+    mcnp::core::SurfaceTable surfaces;
+    mcnp::core::CsgDag dag;
+    std::vector<std::string> bodies;
+    std::vector<FlukaRegion> regions;
+    std::vector<FlukaMaterial> materials;  // 前 25 个为 FLUKA 预定义材料（BLCKHOLE、VACUUM…）
+    std::vector<FlukaLattice> lattices;
+    std::vector<ParseError> errors;
+
+    int findBody(std::string_view name) const;    // 曲面号，不存在时为 0
+    int findRegion(std::string_view name) const;  // 区域编号，不存在时为 0
+    int findMaterial(std::string_view name) const;
+
+    std::unordered_map<std::string, int> bodyIndex;
+    std::unordered_map<std::string, int> regionIndex;
+    std::unordered_map<std::string, int> materialIndex;
+};
+
+// 编译几何体、区域与 MATERIAL/ASSIGNMA/LATTICE 卡；数值在这一遍中只解析一次
+FlukaModel compileFluka(const Ast& ast);
+
+// 按 FLUKA 几何体类型码与数值向曲面表添加曲面 id；RPP/BOX/RCC/TRC 为宏体，SPH、平面与圆柱
+// 使用对应的 MCNP 助记符，XEC/YEC/ZEC、ELL 与 QUA 写成 GQ。REC、WED、RAW、ARB 暂不支持。
+bool addFlukaBody(mcnp::core::SurfaceTable& table, int id, std::string_view code, std::span<const double> values,
+                  std::string* error = nullptr);
+
+// FLUKA 预定义材料的编号
+inline constexpr int kFlukaBlackhole = 1;
+inline constexpr int kFlukaVacuum = 2;
+inline constexpr int kFlukaPredefinedMaterials = 25;
+
+} // namespace mcnp::parser
+
+#endif // FLUKA_PARSER_H
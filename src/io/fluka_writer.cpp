@@ -0,0 +1,463 @@
+#include "fluka_writer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <span>
+
+namespace mcnp::parser {
+
+namespace {
+
+using mcnp::core::CsgDag;
+using mcnp::core::CsgNode;
+using mcnp::core::CsgOp;
+using mcnp::core::Quadric;
+using mcnp::core::SurfaceTable;
+using NodeId = CsgDag::NodeId;
+
+struct FlukaBody {
+    std::string code;  // 空表示 FLUKA 无法表示（环面）
+    std::vector<double> values;
+};
+
+// 卡片名（也可以是整行定长卡片）：首个空白之前、最多 8 个字符，大写
+std::string card_name(std::string_view keyword) {
+    std::string out(keyword.substr(0, std::min<std::size_t>(8, keyword.find(' '))));
+    for (char& c : out) {
+        c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+    return out;
+}
+
+// 定长字段最多 10 列：先取最短表示，放不下时降低有效位数
+std::string fixed_number(double value) {
+    char buffer[32];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value == 0.0 ? 0.0 : value);
+    std::string text(buffer, result.ptr);
+    for (int digits = 9; text.size() > 10 && digits > 0; --digits) {
+        std::snprintf(buffer, sizeof(buffer), "%.*G", digits, value);
+        text = buffer;
+    }
+    return text;
+}
+
+// 定长卡片：A10，6 个 10 列右对齐的 WHAT，SDUM 从第 71 列起
+std::string fixed_card(std::string_view keyword, std::span<const std::string> what, std::string_view sdum = {}) {
+    std::string line(keyword);
+    line.resize(std::max<std::size_t>(line.size(), 10), ' ');
+    for (std::size_t i = 0; i < 6; ++i) {
+        const std::string& field = i < what.size() ? what[i] : std::string();
+        line.append(field.size() < 10 ? 10 - field.size() : 0, ' ');
+        line += field;
+    }
+    if (!sdum.empty()) {
+        line += sdum;
+    } else {
+        while (!line.empty() && line.back() == ' ') {
+            line.pop_back();
+        }
+    }
+    return line;
+}
+
+FlukaBody fluka_body(const SurfaceCard& card, const SurfaceTable& table, std::size_t row) {
+    const std::string& m = card.mnemonic;
+    const std::vector<double>& v = card.values;
+    if (!card.transform) {
+        if (m == "px" || m == "py" || m == "pz") {
+            return {m == "px" ? "YZP" : m == "py" ? "XZP" : "XYP", v};
+        }
+        if (m == "p" && v.size() == 4) {
+            const glm::dvec3 n(v[0], v[1], v[2]);
+            const glm::dvec3 point = n * (v[3] / glm::dot(n, n));
+            return {"PLA", {n.x, n.y, n.z, point.x, point.y, point.z}};
+        }
+        if (m == "so") {
+            return {"SPH", {0.0, 0.0, 0.0, v[0]}};
+        }
+        if (m == "sx" || m == "sy" || m == "sz") {
+            std::vector<double> values{0.0, 0.0, 0.0, v[1]};
+            values[static_cast<std::size_t>(m[1] - 'x')] = v[0];
+            return {"SPH", values};
+        }
+        if (m == "s") {
+            return {"SPH", v};
+        }
+        if (m == "cx" || m == "cy" || m == "cz") {
+            return {std::string(1, static_cast<char>(std::toupper(m[1]))) + "CC", {0.0, 0.0, v[0]}};
+        }
+        if (m == "c/x" || m == "c/z") {
+            return {m == "c/x" ? "XCC" : "ZCC", v};
+        }
+        if (m == "c/y") {
+            return {"YCC", {v[1], v[0], v[2]}};  // C/Y 为 x z R，YCC 为 z x R
+        }
+    }
+    if (table.torus(row)) {
+        return {};
+    }
+    const Quadric q = table.quadric(row);
+    return {"QUA",
+            {q.c[SurfaceTable::A], q.c[SurfaceTable::B], q.c[SurfaceTable::C], q.c[SurfaceTable::D],
+             q.c[SurfaceTable::F], q.c[SurfaceTable::E], q.c[SurfaceTable::G], q.c[SurfaceTable::H],
+             q.c[SurfaceTable::J], q.c[SurfaceTable::K]}};
+}
+
+std::string body_name(const SurfaceTable& table, std::size_t row) {
+    const int facet = table.facet(row);
+    return "S" + std::to_string(table.id(row)) + (facet > 0 ? "F" + std::to_string(facet) : std::string());
+}
+
+} // namespace
+
+DeckWriteStats writeFluka(std::ostream& out, const DeckModel& model, const FlukaWriterOptions& options) {
+    DeckWriteStats stats;
+    const CsgDag& dag = *model.dag;
+    const SurfaceTable& table = *model.surfaces;
+
+    const SurfaceUsage usage = collectSurfaces(model, options.tolerance);
+    for (const int id : usage.undefined) {
+        stats.warnings.push_back("surface " + std::to_string(id) + " is not defined");
+    }
+    stats.mergedSurfaces = usage.merged;
+
+    // 几何体与方向：写出的几何体内部可能是代表行的正侧
+    const std::size_t uniqueCount = usage.dedup.size();
+    std::vector<FlukaBody> bodies;
+    std::vector<char> bodyFlipped(uniqueCount, 0);
+    bodies.reserve(uniqueCount);
+    SurfaceTable scratch;
+    for (std::size_t u = 0; u < uniqueCount; ++u) {
+        const std::size_t row = usage.dedup.representative(u);
+        FlukaBody body = fluka_body(describeSurface(table, row, std::max(options.tolerance, 1e-12)), table, row);
+        if (table.coneSheet(row)) {
+            stats.warnings.push_back("one-sheet cone " + std::to_string(table.id(row)) +
+                                     " is written as a two-sheet QUA");
+        }
+        if (!body.code.empty()) {
+            scratch.clear();
+            if (addFlukaBody(scratch, 1, body.code, body.values)) {
+                const Quadric written = scratch.quadric(0);
+                const Quadric original = table.quadric(row);
+                double dot = 0.0;
+                for (int i = 0; i < SurfaceTable::CoefficientCount; ++i) {
+                    dot += written.c[i] * original.c[i];
+                }
+                bodyFlipped[u] = dot < 0.0;
+            }
+        }
+        bodies.push_back(std::move(body));
+    }
+
+    // 引用环面的节点（按节点缓存），这样的单元无法写出
+    std::vector<std::int8_t> torusMemo(dag.size(), -1);
+    auto uses_torus = [&](auto&& self, NodeId id) -> bool {
+        if (torusMemo[id] >= 0) {
+            return torusMemo[id] != 0;
+        }
+        const CsgNode& n = dag.node(id);
+        bool found = false;
+        if (n.op == CsgOp::Halfspace) {
+            const SurfaceTable::MacroBody* body = n.facet == 0 ? table.findMacroBody(n.surface) : nullptr;
+            const std::optional<std::size_t> row = body ? std::nullopt : table.find(n.surface, n.facet);
+            found = row && bodies[static_cast<std::size_t>(usage.rowEntry[*row] / 2)].code.empty();
+        } else {
+            for (const NodeId child : dag.children(id)) {
+                found = found || self(self, child);
+            }
+        }
+        torusMemo[id] = found ? 1 : 0;
+        return found;
+    };
+
+    CardWriter writer(out, DeckWriterOptions{options.lineWidth, false, options.tolerance, 1 << 16});
+    std::vector<std::string> what(6);
+    auto fixed = [&](std::string_view keyword, std::string_view sdum = {}) {
+        writer.line(fixed_card(keyword, what, sdum));
+        std::fill(what.begin(), what.end(), std::string());
+    };
+    std::vector<const std::string*> before;
+    std::vector<const std::string*> after;
+    std::vector<const std::string*> last;
+    for (const std::string& card : options.cards) {
+        const std::string name = card_name(card);
+        (name == "GLOBAL" || name == "DEFAULTS" ? before : name == "START" ? last : after).push_back(&card);
+    }
+
+    fixed("TITLE");
+    writer.line(model.title);
+    for (const std::string* card : before) {
+        writer.line(*card);
+    }
+    fixed("GEOBEGIN", "COMBNAME");
+    writer.line("    0    0          " + model.title);
+
+    for (std::size_t u = 0; u < uniqueCount; ++u) {
+        const FlukaBody& body = bodies[u];
+        if (body.code.empty()) {
+            stats.warnings.push_back("torus " + std::to_string(table.id(usage.dedup.representative(u))) +
+                                     " has no FLUKA body");
+            continue;
+        }
+        writer.begin(body.code);
+        writer.field(body_name(table, usage.dedup.representative(u)));
+        for (const double v : body.values) {
+            writer.field(v);
+        }
+        writer.end();
+        ++stats.surfaces;
+    }
+    writer.line("END");
+
+    // 区域：complement 为真时按 De Morgan 律取补（#n 的展开），并在交中加括号
+    auto token = [&](std::size_t row, bool inside) {
+        const std::int64_t entry = usage.rowEntry[row];
+        const std::size_t unique = static_cast<std::size_t>(entry / 2);
+        const bool flip = ((entry & 1) != 0) != (bodyFlipped[unique] != 0);
+        writer.field(std::string(inside != flip ? "+" : "-") + body_name(table, usage.dedup.representative(unique)));
+    };
+    auto region = [&](auto&& self, NodeId id, bool complement, bool inIntersection) -> void {
+        const CsgNode& n = dag.node(id);
+        const bool conjunction = (n.op == CsgOp::Intersection) != complement;
+        switch (n.op) {
+            case CsgOp::Halfspace: {
+                const bool inside = n.negative != complement;
+                const SurfaceTable::MacroBody* body = n.facet == 0 ? table.findMacroBody(n.surface) : nullptr;
+                if (body) {
+                    // 宏体内部为各面内部的交，外部为各面外部的并
+                    const bool parens = !inside && inIntersection && body->facetCount > 1;
+                    if (parens) {
+                        writer.field("(");
+                    }
+                    for (std::uint32_t i = 0; i < body->facetCount; ++i) {
+                        if (i > 0 && !inside) {
+                            writer.field("|");
+                        }
+                        token(body->firstRow + i, inside);
+                    }
+                    if (parens) {
+                        writer.field(")");
+                    }
+                } else if (const auto row = table.find(n.surface, n.facet)) {
+                    token(*row, inside);
+                } else {
+                    writer.field(std::string(inside ? "+S" : "-S") + std::to_string(n.surface));
+                }
+                break;
+            }
+            case CsgOp::Intersection:
+            case CsgOp::Union: {
+                const bool parens = !conjunction && inIntersection;
+                if (parens) {
+                    writer.field("(");
+                }
+                bool first = true;
+                for (const NodeId child : dag.children(id)) {
+                    if (!first && !conjunction) {
+                        writer.field("|");
+                    }
+                    first = false;
+                    self(self, child, complement, conjunction);
+                }
+                if (parens) {
+                    writer.field(")");
+                }
+                break;
+            }
+            case CsgOp::Empty:
+            case CsgOp::Universe:
+                break;
+        }
+    };
+
+    std::unordered_map<int, NodeId> cellRegions;
+    for (const DeckCell& cell : model.cells) {
+        cellRegions.emplace(cell.id, cell.region);
+    }
+    auto writable = [&](NodeId id) {
+        return id != CsgDag::kInvalid && dag.node(id).op != CsgOp::Empty && dag.node(id).op != CsgOp::Universe;
+    };
+    std::vector<const DeckCell*> written;
+    written.reserve(model.cells.size());
+    for (const DeckCell& cell : model.cells) {
+        const bool hasRegion = writable(cell.region);
+        bool torus = hasRegion && uses_torus(uses_torus, cell.region);
+        bool complete = hasRegion;
+        for (const int excluded : cell.excluded) {
+            const auto it = cellRegions.find(excluded);
+            complete = complete && it != cellRegions.end() && writable(it->second);
+            torus = torus || (complete && uses_torus(uses_torus, it->second));
+        }
+        if (!complete || torus) {
+            stats.warnings.push_back("cell " + std::to_string(cell.id) +
+                                     (torus ? " uses a torus and was skipped" : " cannot be written as a FLUKA region"));
+            continue;
+        }
+        if (cell.universe != 0 || cell.fill != 0) {
+            stats.warnings.push_back("cell " + std::to_string(cell.id) + ": universes are not converted");
+        }
+        writer.begin("R" + std::to_string(cell.id));
+        writer.field("5");
+        const bool intersected = !cell.excluded.empty();
+        region(region, cell.region, false, intersected);
+        for (const int excluded : cell.excluded) {
+            region(region, cellRegions.at(excluded), true, true);
+        }
+        writer.end();
+        written.push_back(&cell);
+        ++stats.cells;
+    }
+    writer.line("END");
+    for (const FlukaLattice& lattice : options.lattices) {
+        what[0] = "R" + std::to_string(lattice.region);
+        fixed("LATTICE", lattice.transform);
+    }
+    writer.line("GEOEND");
+
+    // 材料：同一材料号的不同密度各占一个 FLUKA 材料
+    std::unordered_map<int, std::vector<std::pair<double, std::string>>> variants;
+    std::vector<std::string> assigned;
+    assigned.reserve(written.size());
+    for (const DeckCell* cell : written) {
+        if (cell->importance == 0.0) {
+            assigned.push_back("BLCKHOLE");
+            continue;
+        }
+        if (cell->material == 0) {
+            assigned.push_back("VACUUM");
+            continue;
+        }
+        auto& list = variants[cell->material];
+        const auto found = std::find_if(list.begin(), list.end(),
+                                        [&](const auto& variant) { return variant.first == cell->density; });
+        if (found != list.end()) {
+            assigned.push_back(found->second);
+            continue;
+        }
+        const auto named = options.materialNames.find(cell->material);
+        std::string name;
+        if (named != options.materialNames.end()) {
+            name = named->second;
+            if (!list.empty()) {
+                stats.warnings.push_back("material " + name + " is used with several densities");
+            }
+        } else {
+            const std::string number = std::to_string(cell->material);
+            name = list.empty() ? "MAT" + number : "M" + number + "_" + std::to_string(list.size() + 1);
+            if (cell->density > 0.0) {
+                stats.warnings.push_back("atom density of cell " + std::to_string(cell->id) +
+                                         " cannot be written as a FLUKA density");
+            } else {
+                what[2] = fixed_number(-cell->density);
+            }
+            if (list.empty()) {
+                writer.line("* composition of material " + number + " is not converted");
+                stats.warnings.push_back("material " + number + " needs a FLUKA composition");
+            }
+            fixed("MATERIAL", name);
+        }
+        list.emplace_back(cell->density, name);
+        assigned.push_back(name);
+    }
+    for (const std::string* card : after) {
+        writer.line(*card);
+    }
+
+    // 相邻且材料相同的区域合成一张 ASSIGNMA（WHAT(2)..WHAT(3) 范围）
+    for (std::size_t i = 0; i < written.size();) {
+        std::size_t j = i + 1;
+        while (j < written.size() && assigned[j] == assigned[i] && written[j]->id == written[j - 1]->id + 1) {
+            ++j;
+        }
+        what[0] = assigned[i];
+        what[1] = "R" + std::to_string(written[i]->id);
+        if (j - i > 1) {
+            what[2] = "R" + std::to_string(written[j - 1]->id);
+        }
+        fixed("ASSIGNMA");
+        i = j;
+    }
+    for (const std::string* card : last) {
+        writer.line(*card);
+    }
+    writer.line("STOP");
+    writer.flush();
+    stats.lines = writer.lines();
+    stats.bytes = writer.bytes();
+    return stats;
+}
+
+FlukaConversion convertFluka(const FlukaModel& model, const Ast* ast) {
+    FlukaConversion conversion;
+    // 其余卡片按 7 个字段重排为定长格式；几何、ASSIGNMA 与格式切换卡由 writeFluka 重新生成
+    if (ast) {
+        std::vector<std::string> what(6);
+        for (std::size_t i = 0; i < ast->cardCount(); ++i) {
+            const CardView card = ast->card(i);
+            if (card.kind() != CardKind::Data) {
+                continue;
+            }
+            const std::string name = card_name(card.keyword());
+            if (name == "TITLE" || name == "GEOBEGIN" || name == "GEOEND" || name == "ASSIGNMA" || name == "LATTICE" ||
+                name == "FREE" || name == "FIXED" || name == "STOP") {
+                continue;
+            }
+            for (std::size_t w = 0; w < 6; ++w) {
+                what[w] = w < card.parameterCount() ? std::string(card.parameter(w)) : std::string();
+                if (what[w].size() > 10) {
+                    conversion.warnings.push_back("field " + what[w] + " on " + name + " does not fit 10 columns");
+                }
+            }
+            // GLOBAL 的 WHAT(4) 为输入格式，写出的文件总是定长格式
+            if (name == "GLOBAL") {
+                what[3].clear();
+            }
+            const std::string_view sdum = card.parameterCount() > 6 ? card.parameter(6) : std::string_view{};
+            conversion.fluka.cards.push_back(fixed_card(card.keyword(), what, sdum));
+        }
+    }
+
+    DeckModel& deck = conversion.deck;
+    deck.title = model.title.empty() ? "fluka geometry" : model.title;
+    deck.dag = &model.dag;
+    deck.surfaces = &model.surfaces;
+    deck.cells.reserve(model.regions.size());
+
+    std::vector<char> used(model.materials.size() + 1, 0);
+    for (std::size_t i = 0; i < model.regions.size(); ++i) {
+        const FlukaRegion& region = model.regions[i];
+        DeckCell cell;
+        cell.id = static_cast<int>(i) + 1;
+        cell.region = region.region;
+        if (region.material == kFlukaBlackhole) {
+            cell.importance = 0.0;
+        } else if (region.material != 0 && region.material != kFlukaVacuum) {
+            const FlukaMaterial& material = model.materials[region.material - 1];
+            cell.material = region.material;
+            cell.density = -material.density;
+            if (!used[region.material]) {
+                used[region.material] = 1;
+                // 用户定义的材料只有在其 MATERIAL 卡随 ast 一并写出时才能沿用名称
+                if (region.material <= kFlukaPredefinedMaterials || ast) {
+                    conversion.fluka.materialNames.emplace(region.material, material.name);
+                }
+                deck.dataCards.push_back("c m" + std::to_string(region.material) + " " + material.name);
+                if (material.density <= 0.0) {
+                    conversion.warnings.push_back("material " + material.name + " has no density");
+                }
+            }
+        }
+        deck.cells.push_back(std::move(cell));
+    }
+    for (const FlukaLattice& lattice : model.lattices) {
+        conversion.warnings.push_back("LATTICE region " + model.regions[lattice.region - 1].name +
+                                      " has no MCNP equivalent and is written as an ordinary cell");
+    }
+    conversion.fluka.lattices = model.lattices;
+    return conversion;
+}
+
+} // namespace mcnp::parser
@@ -0,0 +1,43 @@
+#ifndef FLUKA_WRITER_H
+#define FLUKA_WRITER_H
+
+#include "fluka_parser.h"
+#include "mcnp_writer.h"
+
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mcnp::parser {
+
+struct FlukaWriterOptions {
+    std::size_t lineWidth = 132;  // 几何自由格式的行宽，续行以空格开头
+    double tolerance = 1e-9;      // 曲面去重容差
+    // 材料号 -> FLUKA 材料名（预定义材料或在 cards 中定义）；其余材料写成 MAT<n> 并补 MATERIAL 卡
+    std::unordered_map<int, std::string> materialNames;
+    std::vector<FlukaLattice> lattices;  // region 为 DeckCell::id
+    // 原样写出的定长卡片：GLOBAL、DEFAULTS 在几何之前，START 在 ASSIGNMA 之后，其余在几何与 ASSIGNMA 之间
+    std::vector<std::string> cards;
+};
+
+// 以 FLUKA 按名称的几何格式流式写出卡片模型：每个去重后的曲面一个几何体（S<曲面号>，宏体的面为
+// S<号>F<面>），单元为区域 R<单元号>，#n 按 De Morgan 律就地展开。曲面按系数写成 XYP/PLA、SPH、
+// XCC 等，其余写成 QUA；FLUKA 没有环面，引用环面的单元跳过并给出警告。
+// 普通卡片为定长格式；材料 0 写成 VACUUM，IMP 为 0 的单元写成 BLCKHOLE。
+DeckWriteStats writeFluka(std::ostream& out, const DeckModel& model, const FlukaWriterOptions& options = {});
+
+// FLUKA 编译结果转成卡片模型：单元号即区域编号，材料号即 FLUKA 材料号，密度写为质量密度；
+// 未赋材料与 VACUUM 为 0，BLCKHOLE 的重要性为 0。fluka 中带回材料名与 LATTICE，供 writeFluka 使用；
+// 给出 ast 时其余普通卡片（MATERIAL、COMPOUND、BEAM 等）按定长格式带回 fluka.cards。
+struct FlukaConversion {
+    DeckModel deck;
+    FlukaWriterOptions fluka;
+    std::vector<std::string> warnings;
+};
+
+FlukaConversion convertFluka(const FlukaModel& model, const Ast* ast = nullptr);
+
+} // namespace mcnp::parser
+
+#endif // FLUKA_WRITER_H
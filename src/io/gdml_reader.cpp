@@ -0,0 +1,1195 @@
+#include "gdml_reader.h"
+#include "deck_tokenizer.h"
+#include "xml_stream.h"
+
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <functional>
+#include <initializer_list>
+
+namespace mcnp::parser {
+
+namespace {
+
+using mcnp::core::Aabb;
+using mcnp::core::CsgDag;
+using mcnp::core::SurfaceTable;
+using mcnp::core::SurfaceTransform;
+using NodeId = CsgDag::NodeId;
+
+constexpr double kTwoPi = 2.0 * glm::pi<double>();
+constexpr double kMillimetre = 0.1;  // GDML 的长度以 mm 计，中间表示以 cm 计
+
+// CLHEP 单位（长度以 mm、角度以 rad、密度以 g/cm³ 为 1）
+struct Unit {
+    std::string_view name;
+    double value;
+};
+
+constexpr Unit kUnits[] = {
+    {"mm", 1.0},         {"millimeter", 1.0},  {"cm", 10.0},     {"centimeter", 10.0}, {"m", 1000.0},
+    {"meter", 1000.0},   {"km", 1.0e6},        {"um", 1.0e-3},   {"micrometer", 1e-3}, {"nm", 1.0e-6},
+    {"rad", 1.0},        {"radian", 1.0},      {"mrad", 1.0e-3}, {"deg", glm::pi<double>() / 180.0},
+    {"degree", glm::pi<double>() / 180.0},     {"g/cm3", 1.0},   {"mg/cm3", 1.0e-3},   {"kg/m3", 1.0e-3},
+};
+
+std::optional<double> unit_value(std::string_view name) {
+    for (const Unit& unit : kUnits) {
+        if (unit.name == name) {
+            return unit.value;
+        }
+    }
+    return std::nullopt;
+}
+
+// 属性值表达式：+ - * / ^、括号、常用函数，标识符为 define 中的常量、变量、数量与单位
+class Evaluator {
+public:
+    Evaluator() {
+        symbols_.emplace("pi", glm::pi<double>());
+        symbols_.emplace("twopi", kTwoPi);
+        symbols_.emplace("halfpi", 0.5 * glm::pi<double>());
+        for (const Unit& unit : kUnits) {
+            symbols_.emplace(std::string(unit.name), unit.value);
+        }
+    }
+
+    void define(std::string_view name, double value) { symbols_[std::string(name)] = value; }
+
+    bool evaluate(std::string_view text, double& value, std::string& error) {
+        // 绝大多数属性是纯数字
+        const char* first = text.data();
+        const char* last = text.data() + text.size();
+        while (first < last && *first == ' ') {
+            ++first;
+        }
+        while (last > first && last[-1] == ' ') {
+            --last;
+        }
+        if (first < last && *first == '+') {
+            ++first;
+        }
+        const auto result = std::from_chars(first, last, value);
+        if (result.ec == std::errc() && result.ptr == last) {
+            return true;
+        }
+        text_ = text;
+        position_ = 0;
+        error_.clear();
+        value = expression();
+        skip();
+        if (error_.empty() && position_ < text_.size()) {
+            error_ = "unexpected '" + std::string(text_.substr(position_, 1)) + "'";
+        }
+        if (!error_.empty()) {
+            error = "cannot evaluate '" + std::string(text) + "': " + error_;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    void skip() {
+        while (position_ < text_.size() && (text_[position_] == ' ' || text_[position_] == '\t')) {
+            ++position_;
+        }
+    }
+
+    bool accept(char c) {
+        skip();
+        if (position_ < text_.size() && text_[position_] == c) {
+            ++position_;
+            return true;
+        }
+        return false;
+    }
+
+    double expression() {
+        double value = term();
+        for (;;) {
+            if (accept('+')) {
+                value += term();
+            } else if (accept('-')) {
+                value -= term();
+            } else {
+                return value;
+            }
+        }
+    }
+
+    double term() {
+        double value = power();
+        for (;;) {
+            if (accept('*')) {
+                value *= power();
+            } else if (accept('/')) {
+                value /= power();
+            } else {
+                return value;
+            }
+        }
+    }
+
+    double power() {
+        const double base = unary();
+        if (accept('^')) {
+            return std::pow(base, power());
+        }
+        return base;
+    }
+
+    double unary() {
+        if (accept('-')) {
+            return -unary();
+        }
+        if (accept('+')) {
+            return unary();
+        }
+        return primary();
+    }
+
+    double primary() {
+        skip();
+        if (!error_.empty() || position_ >= text_.size()) {
+            if (error_.empty()) {
+                error_ = "unexpected end of expression";
+            }
+            return 0.0;
+        }
+        if (accept('(')) {
+            const double value = expression();
+            if (!accept(')')) {
+                error_ = "missing ')'";
+            }
+            return value;
+        }
+        const char c = text_[position_];
+        if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+            double value = 0.0;
+            const auto result = std::from_chars(text_.data() + position_, text_.data() + text_.size(), value);
+            if (result.ec != std::errc()) {
+                error_ = "invalid number";
+                return 0.0;
+            }
+            position_ = static_cast<std::size_t>(result.ptr - text_.data());
+            return value;
+        }
+        if (!std::isalpha(static_cast<unsigned char>(c)) && c != '_') {
+            error_ = "unexpected '" + std::string(1, c) + "'";
+            return 0.0;
+        }
+        const std::size_t start = position_;
+        while (position_ < text_.size() &&
+               (std::isalnum(static_cast<unsigned char>(text_[position_])) || text_[position_] == '_')) {
+            ++position_;
+        }
+        const std::string name(text_.substr(start, position_ - start));
+        if (accept('(')) {
+            std::vector<double> arguments{expression()};
+            while (accept(',')) {
+                arguments.push_back(expression());
+            }
+            if (!accept(')')) {
+                error_ = "missing ')' after arguments of " + name;
+                return 0.0;
+            }
+            return call(name, arguments);
+        }
+        const auto it = symbols_.find(name);
+        if (it == symbols_.end()) {
+            error_ = "undefined symbol " + name;
+            return 0.0;
+        }
+        return it->second;
+    }
+
+    double call(const std::string& name, const std::vector<double>& a) {
+        using Function = double (*)(double);
+        static const std::pair<std::string_view, Function> unary[] = {
+            {"sin", [](double x) { return std::sin(x); }},   {"cos", [](double x) { return std::cos(x); }},
+            {"tan", [](double x) { return std::tan(x); }},   {"asin", [](double x) { return std::asin(x); }},
+            {"acos", [](double x) { return std::acos(x); }}, {"atan", [](double x) { return std::atan(x); }},
+            {"sqrt", [](double x) { return std::sqrt(x); }}, {"exp", [](double x) { return std::exp(x); }},
+            {"log", [](double x) { return std::log(x); }},   {"abs", [](double x) { return std::abs(x); }},
+        };
+        for (const auto& [function, f] : unary) {
+            if (function == name && a.size() == 1) {
+                return f(a[0]);
+            }
+        }
+        if (name == "pow" && a.size() == 2) {
+            return std::pow(a[0], a[1]);
+        }
+        if (name == "atan2" && a.size() == 2) {
+            return std::atan2(a[0], a[1]);
+        }
+        error_ = "unknown function " + name + " with " + std::to_string(a.size()) + " arguments";
+        return 0.0;
+    }
+
+    std::unordered_map<std::string, double> symbols_;
+    std::string_view text_;
+    std::size_t position_ = 0;
+    std::string error_;
+};
+
+SurfaceTransform compose(const SurfaceTransform* outer, const GdmlTransform& inner) {
+    SurfaceTransform local;
+    local.rotation = inner.rotationMatrix();
+    local.origin = inner.position;
+    if (!outer) {
+        return local;
+    }
+    SurfaceTransform result;
+    result.rotation = outer->rotation * local.rotation;
+    result.origin = outer->apply(local.origin);
+    return result;
+}
+
+Aabb transform_bounds(const Aabb& box, const glm::dmat4& m) {
+    Aabb out;
+    if (box.empty()) {
+        return out;
+    }
+    for (int corner = 0; corner < 8; ++corner) {
+        const glm::dvec3 p((corner & 1) ? box.max.x : box.min.x, (corner & 2) ? box.max.y : box.min.y,
+                           (corner & 4) ? box.max.z : box.min.z);
+        out.expand(glm::dvec3(m * glm::dvec4(p, 1.0)));
+    }
+    return out;
+}
+
+Aabb centered_box(double x, double y, double z) {
+    Aabb box;
+    box.min = glm::dvec3(-x, -y, -z);
+    box.max = glm::dvec3(x, y, z);
+    return box;
+}
+
+// 刚体变换的逆：转置旋转并反向平移
+glm::dmat4 rigid_inverse(const glm::dmat4& m) {
+    const glm::dmat3 r = glm::transpose(glm::dmat3(glm::dvec3(m[0]), glm::dvec3(m[1]), glm::dvec3(m[2])));
+    const glm::dvec3 t = -(r * glm::dvec3(m[3]));
+    glm::dmat4 inverse(1.0);
+    for (int c = 0; c < 3; ++c) {
+        inverse[c] = glm::dvec4(r[c], 0.0);
+    }
+    inverse[3] = glm::dvec4(t, 1.0);
+    return inverse;
+}
+
+// 实体编入曲面表与 CSG DAG；每个基本实体的曲面各占新的曲面号
+class CsgBuilder {
+public:
+    explicit CsgBuilder(GdmlModel& model) : model_(model) {}
+
+    // transform 为空时使用实体自身的坐标系（布尔运算的第二个实体之外都是这种情况）
+    NodeId build(const GdmlSolid& solid, const SurfaceTransform* transform, std::string& error) {
+        transform_ = transform;
+        error_ = &error;
+        const std::vector<double>& p = solid.parameters;
+        switch (solid.type) {
+            case GdmlSolidType::Box:
+                return body("rpp", {-p[0] / 2, p[0] / 2, -p[1] / 2, p[1] / 2, -p[2] / 2, p[2] / 2});
+            case GdmlSolidType::Tube:
+                return cut(shell(body("rcc", {0, 0, -p[2] / 2, 0, 0, p[2], p[1]}), p[0], "cz", {p[0]}), p[3], p[4]);
+            case GdmlSolidType::Cone: {
+                const NodeId outer = frustum(-p[4] / 2, p[4] / 2, p[1], p[3]);
+                const NodeId inner = p[0] > 0.0 || p[2] > 0.0 ? frustum(-p[4] / 2, p[4] / 2, p[0], p[2]) : kNone;
+                return cut(subtract(outer, inner), p[5], p[6]);
+            }
+            case GdmlSolidType::Sphere:
+                if (p[4] > 0.0 || p[5] < glm::pi<double>() - 1e-12) {
+                    error = "sphere " + solid.name + ": theta segments are not supported";
+                    return model_.dag.empty();
+                }
+                return cut(shell(surface("so", {p[1]}, true), p[0], "so", {p[0]}), p[2], p[3]);
+            case GdmlSolidType::Orb:
+                return surface("so", {p[0]}, true);
+            case GdmlSolidType::Torus:
+            {
+                const NodeId outer = surface("tz", {0, 0, 0, p[2], p[1], p[1]}, true);
+                return cut(shell(outer, p[0], "tz", {0, 0, 0, p[2], p[0], p[0]}), p[3], p[4]);
+            }
+            case GdmlSolidType::EllipticalTube:
+                return all({surface("gq", {1 / (p[0] * p[0]), 1 / (p[1] * p[1]), 0, 0, 0, 0, 0, 0, 0, -1}, true),
+                            surface("pz", {p[2]}, true), surface("pz", {-p[2]}, false)});
+            case GdmlSolidType::Ellipsoid: {
+                const double a = 1 / (p[0] * p[0]);
+                const double b = 1 / (p[1] * p[1]);
+                const double c = 1 / (p[2] * p[2]);
+                std::vector<NodeId> terms{surface("gq", {a, b, c, 0, 0, 0, 0, 0, 0, -1}, true)};
+                if (p[4] != 0.0 && p[4] < p[2]) {
+                    terms.push_back(surface("pz", {p[4]}, true));
+                }
+                if (p[3] != 0.0 && p[3] > -p[2]) {
+                    terms.push_back(surface("pz", {p[3]}, false));
+                }
+                return all(terms);
+            }
+            case GdmlSolidType::Trd: {
+                const double dz = p[4] / 2;
+                const double kx = (p[1] - p[0]) / (4 * dz);
+                const double ky = (p[3] - p[2]) / (4 * dz);
+                const double cx = p[0] / 2 + kx * dz;
+                const double cy = p[2] / 2 + ky * dz;
+                return all({surface("p", {1, 0, -kx, cx}, true), surface("p", {-1, 0, -kx, cx}, true),
+                            surface("p", {0, 1, -ky, cy}, true), surface("p", {0, -1, -ky, cy}, true),
+                            surface("pz", {dz}, true), surface("pz", {-dz}, false)});
+            }
+            case GdmlSolidType::Polycone: {
+                std::vector<NodeId> sections;
+                for (std::size_t i = 2; i + 5 < p.size(); i += 3) {
+                    const bool forward = p[i + 2] <= p[i + 5];
+                    const std::size_t lo = forward ? i : i + 3;
+                    const std::size_t hi = forward ? i + 3 : i;
+                    if (p[lo + 2] == p[hi + 2] || (p[lo + 1] <= 0.0 && p[hi + 1] <= 0.0)) {
+                        continue;
+                    }
+                    const NodeId outer = frustum(p[lo + 2], p[hi + 2], p[lo + 1], p[hi + 1]);
+                    const NodeId inner =
+                        p[lo] > 0.0 || p[hi] > 0.0 ? frustum(p[lo + 2], p[hi + 2], p[lo], p[hi]) : kNone;
+                    sections.push_back(subtract(outer, inner));
+                }
+                if (sections.empty()) {
+                    error = "polycone " + solid.name + " has no sections";
+                    return model_.dag.empty();
+                }
+                const NodeId joined = sections.size() == 1 ? sections.front() : model_.dag.unite(sections);
+                return cut(joined, p[0], p[1]);
+            }
+            case GdmlSolidType::Union:
+            case GdmlSolidType::Subtraction:
+            case GdmlSolidType::Intersection: {
+                const GdmlSolid& first = model_.solids[static_cast<std::size_t>(solid.first)];
+                const GdmlSolid& second = model_.solids[static_cast<std::size_t>(solid.second)];
+                if (first.region == CsgDag::kInvalid || second.region == CsgDag::kInvalid) {
+                    error = "boolean solid " + solid.name + " needs CSG operands";
+                    return model_.dag.empty();
+                }
+                const SurfaceTransform* outer = transform;
+                // 自身坐标系中第一个实体直接复用其区域，第二个实体只在有变换时重新编入
+                const NodeId a = outer ? build(first, outer, error) : first.region;
+                NodeId b = second.region;
+                if (outer || !solid.operand.identity()) {
+                    const SurfaceTransform placed = compose(outer, solid.operand);
+                    b = build(second, &placed, error);
+                }
+                const NodeId pair[] = {a, solid.type == GdmlSolidType::Subtraction ? model_.dag.complement(b) : b};
+                return solid.type == GdmlSolidType::Union ? model_.dag.unite(pair) : model_.dag.intersection(pair);
+            }
+            case GdmlSolidType::Tessellated:
+                break;
+        }
+        return CsgDag::kInvalid;
+    }
+
+private:
+    static constexpr NodeId kNone = CsgDag::kInvalid;
+
+    NodeId surface(std::string_view mnemonic, std::initializer_list<double> values, bool negative) {
+        const int id = ++next_;
+        std::string message;
+        if (!model_.surfaces.add(id, mnemonic, std::span<const double>(values.begin(), values.size()), transform_,
+                                 mcnp::core::BoundaryKind::None, &message)) {
+            if (error_->empty()) {
+                *error_ = message;
+            }
+            return model_.dag.empty();
+        }
+        return model_.dag.halfspace(id, negative);
+    }
+
+    // 宏体内部
+    NodeId body(std::string_view mnemonic, std::initializer_list<double> values) {
+        return surface(mnemonic, values, true);
+    }
+
+    // z0..z1 之间半径 r0..r1 的圆台
+    NodeId frustum(double z0, double z1, double r0, double r1) {
+        if (r0 == r1) {
+            return body("rcc", {0, 0, z0, 0, 0, z1 - z0, r0});
+        }
+        return body("trc", {0, 0, z0, 0, 0, z1 - z0, r0, r1});
+    }
+
+    // 去掉内半径 rmin 以内的部分
+    NodeId shell(NodeId outer, double rmin, std::string_view mnemonic, std::initializer_list<double> values) {
+        if (rmin <= 0.0) {
+            return outer;
+        }
+        const NodeId pair[] = {outer, surface(mnemonic, values, false)};
+        return model_.dag.intersection(pair);
+    }
+
+    NodeId subtract(NodeId outer, NodeId inner) {
+        if (inner == kNone) {
+            return outer;
+        }
+        const NodeId pair[] = {outer, model_.dag.complement(inner)};
+        return model_.dag.intersection(pair);
+    }
+
+    NodeId all(std::span<const NodeId> terms) { return model_.dag.intersection(terms); }
+    NodeId all(std::initializer_list<NodeId> terms) {
+        return all(std::span<const NodeId>(terms.begin(), terms.size()));
+    }
+
+    // 方位角 [start, start + delta] 的楔形：delta ≤ π 时为两个半空间的交，否则为并
+    NodeId cut(NodeId region, double start, double delta) {
+        if (delta >= kTwoPi - 1e-12) {
+            return region;
+        }
+        const double end = start + delta;
+        const NodeId wedge[] = {surface("p", {-std::sin(start), std::cos(start), 0, 0}, false),
+                                surface("p", {-std::sin(end), std::cos(end), 0, 0}, true)};
+        const NodeId sector = delta <= glm::pi<double>() ? model_.dag.intersection(wedge) : model_.dag.unite(wedge);
+        const NodeId pair[] = {region, sector};
+        return model_.dag.intersection(pair);
+    }
+
+    GdmlModel& model_;
+    const SurfaceTransform* transform_ = nullptr;
+    std::string* error_ = nullptr;
+    int next_ = 0;
+};
+
+Aabb solid_bounds(const GdmlModel& model, const GdmlSolid& solid) {
+    const std::vector<double>& p = solid.parameters;
+    switch (solid.type) {
+        case GdmlSolidType::Box:
+            return centered_box(p[0] / 2, p[1] / 2, p[2] / 2);
+        case GdmlSolidType::Tube:
+            return centered_box(p[1], p[1], p[2] / 2);
+        case GdmlSolidType::Cone:
+            return centered_box(std::max(p[1], p[3]), std::max(p[1], p[3]), p[4] / 2);
+        case GdmlSolidType::Sphere:
+            return centered_box(p[1], p[1], p[1]);
+        case GdmlSolidType::Orb:
+            return centered_box(p[0], p[0], p[0]);
+        case GdmlSolidType::Torus:
+            return centered_box(p[2] + p[1], p[2] + p[1], p[1]);
+        case GdmlSolidType::EllipticalTube:
+            return centered_box(p[0], p[1], p[2]);
+        case GdmlSolidType::Ellipsoid: {
+            Aabb box = centered_box(p[0], p[1], p[2]);
+            box.min.z = p[3] != 0.0 ? std::max(box.min.z, p[3]) : box.min.z;
+            box.max.z = p[4] != 0.0 ? std::min(box.max.z, p[4]) : box.max.z;
+            return box;
+        }
+        case GdmlSolidType::Trd:
+            return centered_box(std::max(p[0], p[1]) / 2, std::max(p[2], p[3]) / 2, p[4] / 2);
+        case GdmlSolidType::Polycone: {
+            Aabb box;
+            for (std::size_t i = 2; i + 2 < p.size(); i += 3) {
+                box.expand(glm::dvec3(-p[i + 1], -p[i + 1], p[i + 2]));
+                box.expand(glm::dvec3(p[i + 1], p[i + 1], p[i + 2]));
+            }
+            return box;
+        }
+        case GdmlSolidType::Union:
+        case GdmlSolidType::Subtraction:
+        case GdmlSolidType::Intersection: {
+            Aabb box = model.solids[static_cast<std::size_t>(solid.first)].bounds;
+            const Aabb second =
+                transform_bounds(model.solids[static_cast<std::size_t>(solid.second)].bounds, solid.operand.matrix());
+            if (solid.type == GdmlSolidType::Union) {
+                box.expand(second);
+            } else if (solid.type == GdmlSolidType::Intersection) {
+                box.intersect(second);
+            }
+            return box;
+        }
+        case GdmlSolidType::Tessellated: {
+            Aabb box;
+            for (std::size_t t = solid.firstTriangle; t < solid.firstTriangle + solid.triangleCount; ++t) {
+                for (const std::uint32_t v : model.triangles[t]) {
+                    box.expand(model.vertices[v]);
+                }
+            }
+            return box;
+        }
+    }
+    return {};
+}
+
+enum class Section {
+    None,
+    Define,
+    Materials,
+    Solids,
+    Structure,
+    Setup
+};
+
+// 属性：名称、单位类别与缺省值
+enum class Quantity {
+    Length,
+    Angle
+};
+
+struct SolidSpec {
+    std::string_view element;
+    GdmlSolidType type;
+    std::initializer_list<std::pair<std::string_view, Quantity>> attributes;
+};
+
+const SolidSpec kSolidSpecs[] = {
+    {"box", GdmlSolidType::Box, {{"x", Quantity::Length}, {"y", Quantity::Length}, {"z", Quantity::Length}}},
+    {"tube",
+     GdmlSolidType::Tube,
+     {{"rmin", Quantity::Length},
+      {"rmax", Quantity::Length},
+      {"z", Quantity::Length},
+      {"startphi", Quantity::Angle},
+      {"deltaphi", Quantity::Angle}}},
+    {"cone",
+     GdmlSolidType::Cone,
+     {{"rmin1", Quantity::Length},
+      {"rmax1", Quantity::Length},
+      {"rmin2", Quantity::Length},
+      {"rmax2", Quantity::Length},
+      {"z", Quantity::Length},
+      {"startphi", Quantity::Angle},
+      {"deltaphi", Quantity::Angle}}},
+    {"sphere",
+     GdmlSolidType::Sphere,
+     {{"rmin", Quantity::Length},
+      {"rmax", Quantity::Length},
+      {"startphi", Quantity::Angle},
+      {"deltaphi", Quantity::Angle},
+      {"starttheta", Quantity::Angle},
+      {"deltatheta", Quantity::Angle}}},
+    {"orb", GdmlSolidType::Orb, {{"r", Quantity::Length}}},
+    {"torus",
+     GdmlSolidType::Torus,
+     {{"rmin", Quantity::Length},
+      {"rmax", Quantity::Length},
+      {"rtor", Quantity::Length},
+      {"startphi", Quantity::Angle},
+      {"deltaphi", Quantity::Angle}}},
+    {"eltube",
+     GdmlSolidType::EllipticalTube,
+     {{"dx", Quantity::Length}, {"dy", Quantity::Length}, {"dz", Quantity::Length}}},
+    {"ellipsoid",
+     GdmlSolidType::Ellipsoid,
+     {{"ax", Quantity::Length},
+      {"by", Quantity::Length},
+      {"cz", Quantity::Length},
+      {"zcut1", Quantity::Length},
+      {"zcut2", Quantity::Length}}},
+    {"trd",
+     GdmlSolidType::Trd,
+     {{"x1", Quantity::Length},
+      {"x2", Quantity::Length},
+      {"y1", Quantity::Length},
+      {"y2", Quantity::Length},
+      {"z", Quantity::Length}}},
+    {"polycone", GdmlSolidType::Polycone, {{"startphi", Quantity::Angle}, {"deltaphi", Quantity::Angle}}},
+};
+
+class GdmlReader {
+public:
+    explicit GdmlReader(std::string_view text) : xml_(text), text_(text), builder_(model_) {}
+
+    GdmlModel read() {
+        for (;;) {
+            const XmlReader::Event event = xml_.next();
+            if (event == XmlReader::Event::Eof) {
+                break;
+            }
+            if (event == XmlReader::Event::Error) {
+                error(xml_.error());
+                break;
+            }
+            if (event == XmlReader::Event::Start) {
+                start(xml_.name());
+            } else {
+                end(xml_.name());
+            }
+        }
+        if (model_.world < 0 && !model_.volumes.empty()) {
+            error("no world volume in <setup>");
+        }
+        return std::move(model_);
+    }
+
+private:
+    void error(std::string message) { model_.errors.push_back({xml_.line(), std::move(message), {}}); }
+
+    double number(std::string_view attribute, double fallback = 0.0) {
+        const std::string_view text = xml_.attribute(attribute);
+        if (text.empty()) {
+            return fallback;
+        }
+        double value = 0.0;
+        std::string message;
+        if (!evaluator_.evaluate(text, value, message)) {
+            error(message);
+            return fallback;
+        }
+        return value;
+    }
+
+    double unit(std::string_view attribute, double fallback) {
+        const std::string_view name = xml_.attribute(attribute);
+        if (name.empty()) {
+            return fallback;
+        }
+        if (const auto value = unit_value(name)) {
+            return *value;
+        }
+        error("unknown unit " + std::string(name));
+        return fallback;
+    }
+
+    // 以 unit 属性（position、rotation）或 lunit/aunit（实体）给出的三个分量
+    glm::dvec3 vector(std::string_view unitAttribute, double scale) {
+        return glm::dvec3(number("x"), number("y"), number("z")) * scale * unit(unitAttribute, 1.0);
+    }
+
+    std::string_view reference() {
+        const std::string_view ref = xml_.attribute("ref");
+        if (ref.empty()) {
+            error("<" + std::string(xml_.name()) + "> without ref");
+        }
+        return ref;
+    }
+
+    // 当前 position/rotation（内联或引用）写入 transform
+    bool placement(std::string_view name, GdmlTransform& transform) {
+        if (name == "position") {
+            transform.position = vector("unit", kMillimetre);
+        } else if (name == "rotation") {
+            transform.rotation = vector("unit", 1.0);
+        } else if (name == "positionref") {
+            const auto it = positions_.find(std::string(reference()));
+            if (it == positions_.end()) {
+                error("undefined position " + std::string(xml_.attribute("ref")));
+            } else {
+                transform.position = it->second;
+            }
+        } else if (name == "rotationref") {
+            const auto it = rotations_.find(std::string(reference()));
+            if (it == rotations_.end()) {
+                error("undefined rotation " + std::string(xml_.attribute("ref")));
+            } else {
+                transform.rotation = it->second;
+            }
+        } else if (name == "scale" || name == "scaleref") {
+            error("reflections and scaled placements are not supported");
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    int find_solid(std::string_view name) {
+        const int index = model_.findSolid(name);
+        if (index < 0) {
+            error("undefined solid " + std::string(name));
+        }
+        return index;
+    }
+
+    void start(std::string_view name) {
+        if (xml_.depth() == 2) {
+            section_ = name == "define"      ? Section::Define
+                       : name == "materials" ? Section::Materials
+                       : name == "solids"    ? Section::Solids
+                       : name == "structure" ? Section::Structure
+                       : name == "setup"     ? Section::Setup
+                                             : Section::None;
+            if (section_ == Section::Materials) {
+                materialsBegin_ = xml_.tagOffset();
+            }
+            if (section_ == Section::Setup && model_.world < 0) {
+                setup_ = true;
+            }
+            return;
+        }
+        switch (section_) {
+            case Section::Define:
+                define(name);
+                break;
+            case Section::Materials:
+                material(name);
+                break;
+            case Section::Solids:
+                solid(name);
+                break;
+            case Section::Structure:
+                structure(name);
+                break;
+            case Section::Setup:
+                if (name == "world" && setup_) {
+                    const std::string_view ref = reference();
+                    model_.world = model_.findVolume(ref);
+                    if (model_.world < 0) {
+                        error("undefined world volume " + std::string(ref));
+                    }
+                    setup_ = false;
+                }
+                break;
+            case Section::None:
+                break;
+        }
+    }
+
+    void end(std::string_view name) {
+        if (xml_.depth() == 1) {
+            if (section_ == Section::Materials) {
+                model_.materialsXml.assign(text_.substr(materialsBegin_, xml_.offset() - materialsBegin_));
+            }
+            section_ = Section::None;
+            return;
+        }
+        if (section_ == Section::Materials && name == "material" && material_) {
+            const std::string key = material_->name;
+            if (!model_.materialIndex.emplace(key, static_cast<int>(model_.materials.size())).second) {
+                error("material " + key + " is defined twice");
+            } else {
+                model_.materials.push_back(std::move(*material_));
+            }
+            material_.reset();
+        } else if (section_ == Section::Solids && solidOpen_ && xml_.depth() == 2) {
+            finish_solid();
+        } else if (section_ == Section::Structure) {
+            if ((name == "volume" || name == "assembly") && volume_) {
+                finish_volume();
+            } else if (name == "physvol" && physvol_ && volume_) {
+                if (physvol_->volume >= 0) {
+                    volume_->daughters.push_back(std::move(*physvol_));
+                } else {
+                    error("physvol " + physvol_->name + " has no volumeref");
+                }
+                physvol_.reset();
+            } else if (name == "replicavol" && replica_ && volume_) {
+                if (replica_->volume < 0 || replica_->count <= 0 || replica_->width <= 0.0) {
+                    error("replicavol in " + volume_->name + " needs volumeref, number and width");
+                } else if (volume_->replica || !volume_->daughters.empty()) {
+                    error("volume " + volume_->name + " mixes a replica with other daughters");
+                } else {
+                    volume_->replica = *replica_;
+                }
+                replica_.reset();
+            }
+        }
+    }
+
+    void define(std::string_view name) {
+        const std::string key(xml_.attribute("name"));
+        if (name == "constant" || name == "variable") {
+            evaluator_.define(key, number("value"));
+        } else if (name == "quantity") {
+            evaluator_.define(key, number("value") * unit("unit", 1.0));
+        } else if (name == "position") {
+            positions_[key] = vector("unit", kMillimetre);
+        } else if (name == "rotation") {
+            rotations_[key] = vector("unit", 1.0);
+        } else if (name == "scale") {
+            // 只在 physvol 中引用时报错
+        } else {
+            error("unsupported define <" + std::string(name) + ">");
+        }
+    }
+
+    void material(std::string_view name) {
+        if (name == "material") {
+            material_ = GdmlMaterial{std::string(xml_.attribute("name")), 0.0};
+        } else if (name == "D" && material_) {
+            material_->density = number("value") * unit("unit", 1.0);
+        } else if (name == "Dref" && material_) {
+            double value = 0.0;
+            std::string message;
+            if (!evaluator_.evaluate(reference(), value, message)) {
+                error(message);
+            }
+            material_->density = value;
+        }
+    }
+
+    void solid(std::string_view name) {
+        if (xml_.depth() == 3) {
+            solid_ = GdmlSolid{};
+            solid_.name = std::string(xml_.attribute("name"));
+            solidOpen_ = true;
+            lengthUnit_ = unit("lunit", 1.0) * kMillimetre;
+            angleUnit_ = unit("aunit", 1.0);
+            for (const SolidSpec& spec : kSolidSpecs) {
+                if (spec.element != name) {
+                    continue;
+                }
+                solid_.type = spec.type;
+                for (const auto& [attribute, kind] : spec.attributes) {
+                    const bool fullTurn = attribute == "deltaphi" || attribute == "deltatheta";
+                    const double fallback = !fullTurn ? 0.0 : attribute == "deltaphi" ? kTwoPi : glm::pi<double>();
+                    const double scale = kind == Quantity::Length ? lengthUnit_ : angleUnit_;
+                    solid_.parameters.push_back(xml_.hasAttribute(attribute) ? number(attribute) * scale : fallback);
+                }
+                return;
+            }
+            if (name == "union" || name == "subtraction" || name == "intersection") {
+                solid_.type = name == "union"         ? GdmlSolidType::Union
+                              : name == "subtraction" ? GdmlSolidType::Subtraction
+                                                      : GdmlSolidType::Intersection;
+            } else if (name == "tessellated") {
+                solid_.type = GdmlSolidType::Tessellated;
+                solid_.firstTriangle = model_.triangles.size();
+            } else {
+                error("unsupported solid <" + std::string(name) + "> " + solid_.name);
+                solidOpen_ = false;
+            }
+            return;
+        }
+        if (!solidOpen_) {
+            return;
+        }
+        if (solid_.type == GdmlSolidType::Polycone && name == "zplane") {
+            solid_.parameters.push_back(number("rmin") * lengthUnit_);
+            solid_.parameters.push_back(number("rmax") * lengthUnit_);
+            solid_.parameters.push_back(number("z") * lengthUnit_);
+        } else if (name == "first") {
+            solid_.first = find_solid(reference());
+        } else if (name == "second") {
+            solid_.second = find_solid(reference());
+        } else if (name == "firstposition" || name == "firstrotation" || name == "firstpositionref" ||
+                   name == "firstrotationref") {
+            error("boolean solid " + solid_.name + ": transformed first operands are not supported");
+        } else if (name == "triangular" || name == "quadrangular") {
+            facet(name == "quadrangular");
+        } else {
+            placement(name, solid_.operand);
+        }
+    }
+
+    // 镶嵌实体的面：顶点为 define 中 position 的名字，共享顶点池按名字去重
+    void facet(bool quad) {
+        std::uint32_t corner[4] = {};
+        const int count = quad ? 4 : 3;
+        const bool relative = xml_.attribute("type") == "RELATIVE";
+        static constexpr std::string_view kNames[] = {"vertex1", "vertex2", "vertex3", "vertex4"};
+        glm::dvec3 origin(0.0);
+        for (int i = 0; i < count; ++i) {
+            const std::string key(xml_.attribute(kNames[i]));
+            const auto position = positions_.find(key);
+            if (position == positions_.end()) {
+                error("undefined vertex " + key + " in " + solid_.name);
+                return;
+            }
+            if (relative && i > 0) {
+                // RELATIVE 的顶点是相对第一个顶点的偏移，不能共享
+                corner[i] = static_cast<std::uint32_t>(model_.vertices.size());
+                model_.vertices.push_back(origin + position->second);
+                continue;
+            }
+            const auto [it, added] = vertexPool_.emplace(key, static_cast<std::uint32_t>(model_.vertices.size()));
+            if (added) {
+                model_.vertices.push_back(position->second);
+            }
+            corner[i] = it->second;
+            origin = position->second;
+        }
+        model_.triangles.push_back({corner[0], corner[1], corner[2]});
+        if (quad) {
+            model_.triangles.push_back({corner[0], corner[2], corner[3]});
+        }
+    }
+
+    void finish_solid() {
+        solidOpen_ = false;
+        GdmlSolid& solid = solid_;
+        const bool boolean = solid.type == GdmlSolidType::Union || solid.type == GdmlSolidType::Subtraction ||
+                             solid.type == GdmlSolidType::Intersection;
+        if (boolean && (solid.first < 0 || solid.second < 0)) {
+            error("boolean solid " + solid.name + " needs first and second");
+            return;
+        }
+        if (solid.type == GdmlSolidType::Tessellated) {
+            solid.triangleCount = model_.triangles.size() - solid.firstTriangle;
+        } else {
+            std::string message;
+            solid.region = builder_.build(solid, nullptr, message);
+            if (!message.empty()) {
+                error(message);
+            }
+        }
+        solid.bounds = solid_bounds(model_, solid);
+        if (!model_.solidIndex.emplace(solid.name, static_cast<int>(model_.solids.size())).second) {
+            error("solid " + solid.name + " is defined twice");
+            return;
+        }
+        model_.solids.push_back(std::move(solid));
+    }
+
+    void structure(std::string_view name) {
+        if (name == "volume" || name == "assembly") {
+            if (volume_) {
+                error("nested <" + std::string(name) + ">");
+                return;
+            }
+            volume_ = GdmlVolume{};
+            volume_->name = std::string(xml_.attribute("name"));
+            volume_->assembly = name == "assembly";
+        } else if (!volume_) {
+            return;
+        } else if (name == "materialref" && !physvol_) {
+            const std::string_view ref = reference();
+            volume_->material = model_.findMaterial(ref);
+            if (volume_->material < 0) {
+                error("undefined material " + std::string(ref));
+            }
+        } else if (name == "solidref" && !physvol_) {
+            volume_->solid = find_solid(reference());
+        } else if (name == "physvol") {
+            physvol_ = GdmlPhysvol{};
+            physvol_->name = std::string(xml_.attribute("name"));
+            physvol_->copy = static_cast<int>(number("copynumber"));
+        } else if (name == "replicavol") {
+            replica_ = GdmlReplica{};
+            replica_->count = static_cast<int>(number("number"));
+        } else if (name == "volumeref") {
+            const std::string_view ref = reference();
+            const int volume = model_.findVolume(ref);
+            if (volume < 0) {
+                error("undefined volume " + std::string(ref) + " (volumes must be defined before use)");
+            }
+            if (physvol_) {
+                physvol_->volume = volume;
+            } else if (replica_) {
+                replica_->volume = volume;
+            }
+        } else if (replica_ && name == "direction") {
+            const glm::dvec3 direction(number("x"), number("y"), number("z"));
+            const int axis = direction.x != 0.0 ? 0 : direction.y != 0.0 ? 1 : 2;
+            if (direction[axis] == 0.0 || glm::length(direction) != std::abs(direction[axis])) {
+                error("replicas along rho, phi or oblique axes are not supported");
+            }
+            replica_->axis = axis;
+        } else if (replica_ && name == "width") {
+            replica_->width = number("value") * unit("unit", 1.0) * kMillimetre;
+        } else if (replica_ && name == "offset") {
+            replica_->offset = number("value") * unit("unit", 1.0) * kMillimetre;
+        } else if (name == "file") {
+            error("physvol from an external file is not supported");
+        } else if (name == "divisionvol" || name == "paramvol") {
+            error("<" + std::string(name) + "> in " + volume_->name + " is not supported");
+        } else if (physvol_) {
+            placement(name, physvol_->transform);
+        }
+    }
+
+    void finish_volume() {
+        GdmlVolume& volume = *volume_;
+        if (!volume.assembly && (volume.solid < 0 || volume.material < 0)) {
+            error("volume " + volume.name + " needs solidref and materialref");
+        }
+        if (!model_.volumeIndex.emplace(volume.name, static_cast<int>(model_.volumes.size())).second) {
+            error("volume " + volume.name + " is defined twice");
+        } else {
+            model_.volumes.push_back(std::move(volume));
+        }
+        volume_.reset();
+    }
+
+    XmlReader xml_;
+    std::string_view text_;
+    GdmlModel model_;
+    CsgBuilder builder_;
+    Evaluator evaluator_;
+    Section section_ = Section::None;
+    std::unordered_map<std::string, glm::dvec3> positions_;
+    std::unordered_map<std::string, glm::dvec3> rotations_;
+    std::unordered_map<std::string, std::uint32_t> vertexPool_;
+    std::size_t materialsBegin_ = 0;
+    bool setup_ = false;
+
+    std::optional<GdmlMaterial> material_;
+    GdmlSolid solid_;
+    bool solidOpen_ = false;
+    double lengthUnit_ = kMillimetre;
+    double angleUnit_ = 1.0;
+    std::optional<GdmlVolume> volume_;
+    std::optional<GdmlPhysvol> physvol_;
+    std::optional<GdmlReplica> replica_;
+};
+
+// Möller–Trumbore：射线 origin + t·direction（t > 0）是否穿过三角形
+bool ray_hits(const glm::dvec3& origin, const glm::dvec3& direction, const glm::dvec3& a, const glm::dvec3& b,
+              const glm::dvec3& c) {
+    const glm::dvec3 e1 = b - a;
+    const glm::dvec3 e2 = c - a;
+    const glm::dvec3 p = glm::cross(direction, e2);
+    const double det = glm::dot(e1, p);
+    if (std::abs(det) < 1e-300) {
+        return false;
+    }
+    const double inv = 1.0 / det;
+    const glm::dvec3 s = origin - a;
+    const double u = glm::dot(s, p) * inv;
+    if (u < 0.0 || u > 1.0) {
+        return false;
+    }
+    const glm::dvec3 q = glm::cross(s, e1);
+    const double v = glm::dot(direction, q) * inv;
+    if (v < 0.0 || u + v > 1.0) {
+        return false;
+    }
+    return glm::dot(e2, q) * inv > 0.0;
+}
+
+} // namespace
+
+glm::dmat3 GdmlTransform::rotationMatrix() const {
+    // Geant4 的 GetRotationMatrix 依次 rotateX、rotateY、rotateZ 得到 R = Rz·Ry·Rx，放置时取其逆
+    const double cx = std::cos(rotation.x), sx = std::sin(rotation.x);
+    const double cy = std::cos(rotation.y), sy = std::sin(rotation.y);
+    const double cz = std::cos(rotation.z), sz = std::sin(rotation.z);
+    const glm::dmat3 rx(glm::dvec3(1, 0, 0), glm::dvec3(0, cx, sx), glm::dvec3(0, -sx, cx));
+    const glm::dmat3 ry(glm::dvec3(cy, 0, -sy), glm::dvec3(0, 1, 0), glm::dvec3(sy, 0, cy));
+    const glm::dmat3 rz(glm::dvec3(cz, sz, 0), glm::dvec3(-sz, cz, 0), glm::dvec3(0, 0, 1));
+    return glm::transpose(rz * ry * rx);
+}
+
+glm::dmat4 GdmlTransform::matrix() const {
+    const glm::dmat3 r = rotationMatrix();
+    glm::dmat4 m(1.0);
+    for (int c = 0; c < 3; ++c) {
+        m[c] = glm::dvec4(r[c], 0.0);
+    }
+    m[3] = glm::dvec4(position, 1.0);
+    return m;
+}
+
+int GdmlModel::findSolid(std::string_view name) const {
+    const auto it = solidIndex.find(std::string(name));
+    return it == solidIndex.end() ? -1 : it->second;
+}
+
+int GdmlModel::findMaterial(std::string_view name) const {
+    const auto it = materialIndex.find(std::string(name));
+    return it == materialIndex.end() ? -1 : it->second;
+}
+
+int GdmlModel::findVolume(std::string_view name) const {
+    const auto it = volumeIndex.find(std::string(name));
+    return it == volumeIndex.end() ? -1 : it->second;
+}
+
+bool GdmlModel::contains(int solid, const glm::dvec3& local) const {
+    const GdmlSolid& s = solids[static_cast<std::size_t>(solid)];
+    if (!s.bounds.contains(local)) {
+        return false;
+    }
+    if (s.type != GdmlSolidType::Tessellated) {
+        return s.region != CsgDag::kInvalid && dag.contains(s.region, local, surfaces);
+    }
+    // 方向取无理分量，避免射线恰好穿过棱或顶点
+    const glm::dvec3 direction = glm::normalize(glm::dvec3(0.5773502691896258, 0.5590169943749474, 0.5958758547680685));
+    bool inside = false;
+    for (std::size_t t = s.firstTriangle; t < s.firstTriangle + s.triangleCount; ++t) {
+        const auto& tri = triangles[t];
+        if (ray_hits(local, direction, vertices[tri[0]], vertices[tri[1]], vertices[tri[2]])) {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
+
+void GdmlModel::buildUniverses(mcnp::core::UniverseResolver& resolver) const {
+    using mcnp::core::UniverseCell;
+    if (world < 0) {
+        return;
+    }
+    auto universe_id = [&](int volume) { return volume == world ? 0 : volume + 1; };
+    for (std::size_t v = 0; v < volumes.size(); ++v) {
+        const GdmlVolume& volume = volumes[v];
+        if (volume.assembly || volume.solid < 0) {
+            continue;
+        }
+        mcnp::core::Universe universe;
+        universe.id = universe_id(static_cast<int>(v));
+        int nextCell = 1;
+        // 组件在放置处展开为其子体
+        std::function<void(const GdmlVolume&, const glm::dmat4&)> place = [&](const GdmlVolume& holder,
+                                                                              const glm::dmat4& parent) {
+            for (const GdmlPhysvol& daughter : holder.daughters) {
+                const glm::dmat4 m = parent * daughter.transform.matrix();
+                const GdmlVolume& placed = volumes[static_cast<std::size_t>(daughter.volume)];
+                if (placed.assembly) {
+                    place(placed, m);
+                    continue;
+                }
+                if (placed.solid < 0) {
+                    continue;
+                }
+                UniverseCell cell;
+                cell.id = nextCell++;
+                cell.fill = universe_id(daughter.volume);
+                cell.fillTransform = m;
+                const glm::dmat4 inverse = rigid_inverse(m);
+                const int solid = placed.solid;
+                cell.contains = [this, solid, inverse](const glm::dvec3& p) {
+                    return contains(solid, glm::dvec3(inverse * glm::dvec4(p, 1.0)));
+                };
+                cell.bounds = transform_bounds(solids[static_cast<std::size_t>(solid)].bounds, m);
+                universe.cells.push_back(std::move(cell));
+            }
+        };
+        place(volume, glm::dmat4(1.0));
+
+        if (volume.replica && !volumes[static_cast<std::size_t>(volume.replica->volume)].assembly) {
+            // Geant4 的笛卡尔复制体第 i 份中心在 (i - (n-1)/2)·width，offset 只用于 rho/phi
+            const GdmlReplica& replica = *volume.replica;
+            mcnp::core::LatticeSpec lattice;
+            lattice.pitch = glm::dvec3(0.0);
+            lattice.pitch[replica.axis] = replica.width;
+            lattice.upper[replica.axis] = replica.count - 1;
+            lattice.fill.assign(static_cast<std::size_t>(replica.count), universe_id(replica.volume));
+            UniverseCell cell;
+            cell.id = nextCell++;
+            glm::dvec3 shift(0.0);
+            shift[replica.axis] = -0.5 * (replica.count - 1) * replica.width;
+            cell.fillTransform[3] = glm::dvec4(shift, 1.0);
+            cell.lattice = std::move(lattice);
+            universe.cells.push_back(std::move(cell));
+        }
+
+        // 母体材料单元：只有世界体需要判定自身实体，其余宇宙只在填充单元内被访问
+        UniverseCell own;
+        own.id = nextCell++;
+        own.material = volume.material + 1;
+        if (static_cast<int>(v) == world) {
+            const int solid = volume.solid;
+            own.contains = [this, solid](const glm::dvec3& p) { return contains(solid, p); };
+            own.bounds = solids[static_cast<std::size_t>(solid)].bounds;
+        }
+        universe.cells.push_back(std::move(own));
+        resolver.addUniverse(std::move(universe));
+    }
+}
+
+GdmlModel readGdml(std::string_view text) {
+    return GdmlReader(text).read();
+}
+
+GdmlModel readGdmlFile(const std::filesystem::path& path) {
+    MappedFile file;
+    std::string error;
+    if (!file.open(path, &error)) {
+        GdmlModel model;
+        model.errors.push_back({0, error, path.string()});
+        return model;
+    }
+    GdmlModel model = readGdml(file.view());
+    for (ParseError& e : model.errors) {
+        e.source = path.string();
+    }
+    return model;
+}
+
+} // namespace mcnp::parser
@@ -0,0 +1,138 @@
+#ifndef GDML_READER_H
+#define GDML_READER_H
+
+#include "aabb.h"
+#include "csg_dag.h"
+#include "mcnp_parser.h"
+#include "surface_table.h"
+#include "universe_resolver.h"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace mcnp::parser {
+
+// 支持的 GDML 实体；parameters 的顺序与 GDML 属性一致，长度为 cm、角度为 rad
+enum class GdmlSolidType {
+    Box,             // x y z（全长）
+    Tube,            // rmin rmax z startphi deltaphi
+    Cone,            // rmin1 rmax1 rmin2 rmax2 z startphi deltaphi
+    Sphere,          // rmin rmax startphi deltaphi starttheta deltatheta（只支持完整的 theta）
+    Orb,             // r
+    Torus,           // rmin rmax rtor startphi deltaphi
+    EllipticalTube,  // dx dy dz（半长）
+    Ellipsoid,       // ax by cz zcut1 zcut2（zcut 为 0 表示不截）
+    Trd,             // x1 x2 y1 y2 z（全长）
+    Polycone,        // startphi deltaphi，之后每个 zplane 依次为 rmin rmax z
+    Union,
+    Subtraction,
+    Intersection,
+    Tessellated
+};
+
+// GDML 的位置与旋转：rotation 为绕 x、y、z 的角度，按 Geant4 的约定子体到母体的旋转为
+// (Rz·Ry·Rx) 的逆
+struct GdmlTransform {
+    glm::dvec3 position{0.0};
+    glm::dvec3 rotation{0.0};
+
+    bool identity() const noexcept { return position == glm::dvec3(0.0) && rotation == glm::dvec3(0.0); }
+    glm::dmat3 rotationMatrix() const;
+    // 子体（或布尔运算的第二个实体）坐标到母体坐标
+    glm::dmat4 matrix() const;
+};
+
+struct GdmlSolid {
+    std::string name;
+    GdmlSolidType type = GdmlSolidType::Box;
+    std::vector<double> parameters;
+    // 布尔实体：second 按 operand 放置在 first 的坐标系中
+    int first = -1;
+    int second = -1;
+    GdmlTransform operand;
+    // 镶嵌实体：GdmlModel::triangles 中的区间
+    std::size_t firstTriangle = 0;
+    std::size_t triangleCount = 0;
+    // CSG 实体在自身坐标系中的区域；镶嵌实体为 kInvalid
+    mcnp::core::CsgDag::NodeId region = mcnp::core::CsgDag::kInvalid;
+    mcnp::core::Aabb bounds;
+};
+
+struct GdmlMaterial {
+    std::string name;
+    double density = 0.0;  // g/cm³
+};
+
+struct GdmlPhysvol {
+    std::string name;
+    int volume = -1;  // 逻辑体或组件的下标
+    int copy = 0;
+    GdmlTransform transform;
+};
+
+// 沿 x/y/z 轴的复制体：count 份 volume，间距 width，第 i 份中心在 (i - (count-1)/2)·width
+struct GdmlReplica {
+    int volume = -1;
+    int count = 0;
+    int axis = 0;
+    double width = 0.0;
+    double offset = 0.0;
+};
+
+struct GdmlVolume {
+    std::string name;
+    bool assembly = false;  // 组件没有实体与材料，放置时其子体直接进入母体
+    int solid = -1;
+    int material = -1;
+    std::vector<GdmlPhysvol> daughters;
+    std::optional<GdmlReplica> replica;
+};
+
+// GDML 几何的中间表示。CSG 实体编入与 MCNP 共用的曲面表与 CSG DAG；镶嵌实体的顶点放在共享的
+// 顶点池中（按 define 中的 position 名去重）。逻辑体只存一份，物理体只记录引用与变换。
+struct GdmlModel {
+    mcnp::core::SurfaceTable surfaces;
+    mcnp::core::CsgDag dag;
+    std::vector<glm::dvec3> vertices;
+    std::vector<std::array<std::uint32_t, 3>> triangles;
+    std::vector<GdmlSolid> solids;
+    std::vector<GdmlMaterial> materials;
+    std::vector<GdmlVolume> volumes;
+    int world = -1;
+    std::string materialsXml;  // 输入中的 <materials> 段原文，写出时原样保留
+    std::vector<ParseError> errors;
+
+    std::unordered_map<std::string, int> solidIndex;
+    std::unordered_map<std::string, int> materialIndex;
+    std::unordered_map<std::string, int> volumeIndex;
+
+    int findSolid(std::string_view name) const;  // 不存在时为 -1
+    int findMaterial(std::string_view name) const;
+    int findVolume(std::string_view name) const;
+
+    // 点（实体自身坐标系）是否在实体内；镶嵌实体按射线奇偶判定
+    bool contains(int solid, const glm::dvec3& local) const;
+
+    // 每个逻辑体一个宇宙（世界体为宇宙 0，其余为下标 + 1）：物理体是以子体实体为边界、
+    // 填充子体宇宙的单元，复制体是一维栅格，母体材料单元排在子体之后（定位器取第一个命中的单元）。
+    // 重复使用的逻辑体只对应一个宇宙。单元的判定闭包引用本模型，resolver 不能比模型活得更久。
+    void buildUniverses(mcnp::core::UniverseResolver& resolver) const;
+};
+
+// 流式读取 GDML：边读边建实体与体，内存与不同实体、逻辑体的数量成正比而与展开后的物理体无关。
+// 支持 define（constant、variable、quantity、position、rotation，属性值可为表达式）、
+// 上面列出的实体、volume/assembly/physvol/replicavol 与 setup；不支持的元素记错误后跳过。
+GdmlModel readGdml(std::string_view text);
+GdmlModel readGdmlFile(const std::filesystem::path& path);
+
+} // namespace mcnp::parser
+
+#endif // GDML_READER_H
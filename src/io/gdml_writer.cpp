@@ -0,0 +1,266 @@
+#include "gdml_writer.h"
+#include "xml_stream.h"
+
+#include <array>
+#include <initializer_list>
+#include <string_view>
+
+namespace mcnp::parser {
+
+namespace {
+
+// 与读取时的属性顺序一致；参数已是 cm 与 rad
+struct SolidElement {
+    GdmlSolidType type;
+    std::string_view element;
+    std::initializer_list<std::string_view> attributes;
+};
+
+const SolidElement kSolidElements[] = {
+    {GdmlSolidType::Box, "box", {"x", "y", "z"}},
+    {GdmlSolidType::Tube, "tube", {"rmin", "rmax", "z", "startphi", "deltaphi"}},
+    {GdmlSolidType::Cone, "cone", {"rmin1", "rmax1", "rmin2", "rmax2", "z", "startphi", "deltaphi"}},
+    {GdmlSolidType::Sphere, "sphere", {"rmin", "rmax", "startphi", "deltaphi", "starttheta", "deltatheta"}},
+    {GdmlSolidType::Orb, "orb", {"r"}},
+    {GdmlSolidType::Torus, "torus", {"rmin", "rmax", "rtor", "startphi", "deltaphi"}},
+    {GdmlSolidType::EllipticalTube, "eltube", {"dx", "dy", "dz"}},
+    {GdmlSolidType::Ellipsoid, "ellipsoid", {"ax", "by", "cz", "zcut1", "zcut2"}},
+    {GdmlSolidType::Trd, "trd", {"x1", "x2", "y1", "y2", "z"}},
+    {GdmlSolidType::Polycone, "polycone", {"startphi", "deltaphi"}},
+    {GdmlSolidType::Union, "union", {}},
+    {GdmlSolidType::Subtraction, "subtraction", {}},
+    {GdmlSolidType::Intersection, "intersection", {}},
+    {GdmlSolidType::Tessellated, "tessellated", {}},
+};
+
+const SolidElement& element_of(GdmlSolidType type) {
+    for (const SolidElement& element : kSolidElements) {
+        if (element.type == type) {
+            return element;
+        }
+    }
+    return kSolidElements[0];
+}
+
+class GdmlWriter {
+public:
+    GdmlWriter(std::ostream& out, const GdmlModel& model, const GdmlWriterOptions& options)
+        : xml_(out, options.bufferSize), model_(model), options_(options) {}
+
+    GdmlWriteStats write() {
+        xml_.declaration();
+        xml_.start("gdml");
+        xml_.attribute("xmlns:xsi", "http://www.w3.org/2001/XMLSchema-instance");
+        xml_.attribute("xsi:noNamespaceSchemaLocation", options_.schema);
+        define();
+        materials();
+        solids();
+        structure();
+        xml_.start("setup");
+        xml_.attribute("name", "Default");
+        xml_.attribute("version", "1.0");
+        if (model_.world >= 0) {
+            xml_.start("world");
+            xml_.attribute("ref", volume_name(model_.world));
+            xml_.end();
+        } else {
+            stats_.warnings.push_back("model has no world volume");
+        }
+        xml_.end();
+        xml_.end();
+        xml_.raw("");
+        xml_.flush();
+        stats_.bytes = xml_.bytes();
+        return std::move(stats_);
+    }
+
+private:
+    const std::string& volume_name(int volume) const { return model_.volumes[static_cast<std::size_t>(volume)].name; }
+
+    void vector(std::string_view element, std::string_view name, const glm::dvec3& value, std::string_view unit) {
+        xml_.start(element);
+        xml_.attribute("name", name);
+        xml_.attribute("unit", unit);
+        xml_.attribute("x", value.x);
+        xml_.attribute("y", value.y);
+        xml_.attribute("z", value.z);
+        xml_.end();
+    }
+
+    // 内联的位置与旋转，恒等部分省略
+    void transform(const std::string& owner, const GdmlTransform& transform) {
+        if (transform.position != glm::dvec3(0.0)) {
+            vector("position", owner + "_pos", transform.position, "cm");
+        }
+        if (transform.rotation != glm::dvec3(0.0)) {
+            vector("rotation", owner + "_rot", transform.rotation, "rad");
+        }
+    }
+
+    void define() {
+        xml_.start("define");
+        std::string name;
+        for (std::size_t i = 0; i < model_.vertices.size(); ++i) {
+            name = "v" + std::to_string(i);
+            vector("position", name, model_.vertices[i], "cm");
+        }
+        stats_.vertices = model_.vertices.size();
+        xml_.end();
+    }
+
+    void materials() {
+        if (options_.keepMaterials && !model_.materialsXml.empty()) {
+            xml_.raw(model_.materialsXml);
+            return;
+        }
+        xml_.start("materials");
+        if (!model_.materials.empty()) {
+            xml_.comment("only densities are kept; compositions were not converted");
+        }
+        for (const GdmlMaterial& material : model_.materials) {
+            xml_.start("material");
+            xml_.attribute("name", material.name);
+            xml_.start("D");
+            xml_.attribute("value", material.density);
+            xml_.attribute("unit", "g/cm3");
+            xml_.end();
+            xml_.end();
+        }
+        xml_.end();
+    }
+
+    void solids() {
+        xml_.start("solids");
+        for (const GdmlSolid& solid : model_.solids) {
+            const SolidElement& element = element_of(solid.type);
+            xml_.start(element.element);
+            xml_.attribute("name", solid.name);
+            switch (solid.type) {
+                case GdmlSolidType::Union:
+                case GdmlSolidType::Subtraction:
+                case GdmlSolidType::Intersection:
+                    xml_.start("first");
+                    xml_.attribute("ref", model_.solids[static_cast<std::size_t>(solid.first)].name);
+                    xml_.end();
+                    xml_.start("second");
+                    xml_.attribute("ref", model_.solids[static_cast<std::size_t>(solid.second)].name);
+                    xml_.end();
+                    transform(solid.name, solid.operand);
+                    break;
+                case GdmlSolidType::Tessellated:
+                    xml_.attribute("lunit", "cm");
+                    for (std::size_t t = solid.firstTriangle; t < solid.firstTriangle + solid.triangleCount; ++t) {
+                        static constexpr std::array<std::string_view, 3> kNames = {"vertex1", "vertex2", "vertex3"};
+                        xml_.start("triangular");
+                        for (int c = 0; c < 3; ++c) {
+                            xml_.attribute(kNames[c], "v" + std::to_string(model_.triangles[t][c]));
+                        }
+                        xml_.end();
+                    }
+                    break;
+                default:
+                {
+                    xml_.attribute("lunit", "cm");
+                    xml_.attribute("aunit", "rad");
+                    std::size_t i = 0;
+                    for (const std::string_view attribute : element.attributes) {
+                        if (i < solid.parameters.size()) {
+                            xml_.attribute(attribute, solid.parameters[i++]);
+                        }
+                    }
+                    // 多锥的 zplane 依次为 rmin rmax z
+                    for (; solid.type == GdmlSolidType::Polycone && i + 2 < solid.parameters.size(); i += 3) {
+                        xml_.start("zplane");
+                        xml_.attribute("rmin", solid.parameters[i]);
+                        xml_.attribute("rmax", solid.parameters[i + 1]);
+                        xml_.attribute("z", solid.parameters[i + 2]);
+                        xml_.end();
+                    }
+                    break;
+                }
+            }
+            xml_.end();
+        }
+        stats_.solids = model_.solids.size();
+        xml_.end();
+    }
+
+    void structure() {
+        xml_.start("structure");
+        for (const GdmlVolume& volume : model_.volumes) {
+            xml_.start(volume.assembly ? "assembly" : "volume");
+            xml_.attribute("name", volume.name);
+            if (!volume.assembly) {
+                if (volume.material >= 0) {
+                    xml_.start("materialref");
+                    xml_.attribute("ref", model_.materials[static_cast<std::size_t>(volume.material)].name);
+                    xml_.end();
+                }
+                if (volume.solid >= 0) {
+                    xml_.start("solidref");
+                    xml_.attribute("ref", model_.solids[static_cast<std::size_t>(volume.solid)].name);
+                    xml_.end();
+                }
+            }
+            for (const GdmlPhysvol& daughter : volume.daughters) {
+                xml_.start("physvol");
+                if (!daughter.name.empty()) {
+                    xml_.attribute("name", daughter.name);
+                }
+                if (daughter.copy != 0) {
+                    xml_.attribute("copynumber", daughter.copy);
+                }
+                xml_.start("volumeref");
+                xml_.attribute("ref", volume_name(daughter.volume));
+                xml_.end();
+                const std::string owner = daughter.name.empty() ? volume.name + "_pv" + std::to_string(stats_.placements)
+                                                                : daughter.name;
+                transform(owner, daughter.transform);
+                xml_.end();
+                ++stats_.placements;
+            }
+            if (volume.replica) {
+                replica(*volume.replica);
+            }
+            xml_.end();
+        }
+        stats_.volumes = model_.volumes.size();
+        xml_.end();
+    }
+
+    void replica(const GdmlReplica& replica) {
+        xml_.start("replicavol");
+        xml_.attribute("number", replica.count);
+        xml_.start("volumeref");
+        xml_.attribute("ref", volume_name(replica.volume));
+        xml_.end();
+        xml_.start("replicate_along_axis");
+        xml_.start("direction");
+        xml_.attribute(replica.axis == 0 ? "x" : replica.axis == 1 ? "y" : "z", 1);
+        xml_.end();
+        xml_.start("width");
+        xml_.attribute("value", replica.width);
+        xml_.attribute("unit", "cm");
+        xml_.end();
+        xml_.start("offset");
+        xml_.attribute("value", replica.offset);
+        xml_.attribute("unit", "cm");
+        xml_.end();
+        xml_.end();
+        xml_.end();
+        ++stats_.placements;
+    }
+
+    XmlWriter xml_;
+    const GdmlModel& model_;
+    const GdmlWriterOptions& options_;
+    GdmlWriteStats stats_;
+};
+
+} // namespace
+
+GdmlWriteStats writeGdml(std::ostream& out, const GdmlModel& model, const GdmlWriterOptions& options) {
+    return GdmlWriter(out, model, options).write();
+}
+
+} // namespace mcnp::parser
@@ -0,0 +1,35 @@
+#ifndef GDML_WRITER_H
+#define GDML_WRITER_H
+
+#include "gdml_reader.h"
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace mcnp::parser {
+
+struct GdmlWriterOptions {
+    std::string schema = "http://service-spi.web.cern.ch/service-spi/app/releases/GDML/schema/gdml.xsd";
+    bool keepMaterials = true;  // 模型带有 <materials> 原文时原样写回
+    std::size_t bufferSize = 1 << 16;
+};
+
+struct GdmlWriteStats {
+    std::size_t solids = 0;
+    std::size_t volumes = 0;
+    std::size_t placements = 0;  // physvol 与 replicavol
+    std::size_t vertices = 0;
+    std::size_t bytes = 0;
+    std::vector<std::string> warnings;
+};
+
+// 以 GDML 流式写出中间表示：长度统一为 cm、角度为 rad，实体按存储的参数重建（不展开成曲面），
+// 镶嵌实体的顶点池写成 define 中的 v<i>。逻辑体按下标顺序写出，保证引用在定义之后；
+// 物理体的位置与旋转内联在 physvol 中。
+GdmlWriteStats writeGdml(std::ostream& out, const GdmlModel& model, const GdmlWriterOptions& options = {});
+
+} // namespace mcnp::parser
+
+#endif // GDML_WRITER_H
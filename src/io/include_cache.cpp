@@ -0,0 +1,43 @@
+#include "include_cache.h"
+
+namespace mcnp::parser {
+
+std::shared_ptr<IncludeCache::Entry> IncludeCache::entryFor(const std::filesystem::path& path) {
+    std::error_code ec;
+    const std::filesystem::path canonical = std::filesystem::weakly_canonical(path, ec);
+    const std::string key = (ec ? path : canonical).string();
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& entry = entries_[key];
+    if (!entry) {
+        entry = std::make_shared<Entry>();
+    }
+    return entry;
+}
+
+void IncludeCache::load(Entry& entry, const std::filesystem::path& path) {
+    std::call_once(entry.once, [&]() {
+        auto file = std::make_shared<IncludedFile>();
+        file->path = path;
+        file->file.open(path, &file->error);
+        entry.file = std::move(file);
+    });
+}
+
+void IncludeCache::prefetch(const std::filesystem::path& path) {
+    auto entry = entryFor(path);
+    pool_.submit([entry, path]() { load(*entry, path); });
+}
+
+std::shared_ptr<const IncludedFile> IncludeCache::get(const std::filesystem::path& path) {
+    auto entry = entryFor(path);
+    // call_once 保证只加载一次；若预取任务正在执行则等待其完成
+    load(*entry, path);
+    return entry->file;
+}
+
+void IncludeCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+}
+
+} // namespace mcnp::parser
@@ -0,0 +1,50 @@
+#ifndef INCLUDE_CACHE_H
+#define INCLUDE_CACHE_H
+
+#include "deck_tokenizer.h"
+#include "thread_pool.h"
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace mcnp::parser {
+
+struct IncludedFile {
+    std::filesystem::path path;
+    MappedFile file;
+    std::string error;  // 非空表示读取失败
+
+    std::string_view text() const noexcept { return file.view(); }
+};
+
+// READ FILE= 包含文件缓存：prefetch 在线程池中并发映射文件，
+// get 取得结果；若文件尚未被加载，调用线程直接加载，不会等待排队中的任务。
+class IncludeCache {
+public:
+    explicit IncludeCache(mcnp::core::ThreadPool& pool = mcnp::core::ThreadPool::shared()) : pool_(pool) {}
+
+    void prefetch(const std::filesystem::path& path);
+    std::shared_ptr<const IncludedFile> get(const std::filesystem::path& path);
+    void clear();
+
+private:
+    struct Entry {
+        std::once_flag once;
+        std::shared_ptr<IncludedFile> file;
+    };
+
+    std::shared_ptr<Entry> entryFor(const std::filesystem::path& path);
+    static void load(Entry& entry, const std::filesystem::path& path);
+
+    mcnp::core::ThreadPool& pool_;
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<Entry>> entries_;
+};
+
+} // namespace mcnp::parser
+
+#endif // INCLUDE_CACHE_H
@@ -0,0 +1,518 @@
+#include "incremental_deck.h"
+#include "card_assembler.h"
+#include "deck_tokenizer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <unordered_set>
+
+namespace mcnp::parser {
+
+namespace {
+
+constexpr std::uint64_t kFnvOffset = 0xcbf29ce484222325ull;
+constexpr std::uint64_t kFnvPrime = 0x100000001b3ull;
+
+std::uint64_t fnv(std::uint64_t h, std::string_view text) {
+    for (const char ch : text) {
+        h = (h ^ static_cast<unsigned char>(std::tolower(static_cast<unsigned char>(ch)))) * kFnvPrime;
+    }
+    return (h ^ 0xffu) * kFnvPrime;  // 分隔符，避免 "ab" "c" 与 "a" "bc" 相同
+}
+
+// 内容哈希只看关键字与参数：改动注释、空白或换行位置不算变化
+std::uint64_t card_hash(const CardView& card) {
+    std::uint64_t h = (kFnvOffset ^ static_cast<std::uint64_t>(card.kind())) * kFnvPrime;
+    h = fnv(h, card.keyword());
+    for (std::size_t i = 0; i < card.parameterCount(); ++i) {
+        h = fnv(h, card.parameter(i));
+    }
+    return h;
+}
+
+int parse_id(std::string_view text) {
+    int value = 0;
+    const auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size() && value > 0 ? value : 0;
+}
+
+// 曲面号（去掉 * / + 边界前缀）；无效时为 0
+int surface_number(const CardView& card) {
+    std::string_view name = card.keyword();
+    if (!name.empty() && (name.front() == '*' || name.front() == '+')) {
+        name.remove_prefix(1);
+    }
+    return parse_id(name);
+}
+
+// TRn、*TRn 的编号；非变换卡为 0
+int transform_number(const CardView& card) {
+    std::string_view name = card.keyword();
+    if (!name.empty() && name.front() == '*') {
+        name.remove_prefix(1);
+    }
+    if (name.size() < 3 || std::tolower(static_cast<unsigned char>(name[0])) != 't' ||
+        std::tolower(static_cast<unsigned char>(name[1])) != 'r') {
+        return 0;
+    }
+    return parse_id(name.substr(2));
+}
+
+std::size_t count_newlines(std::string_view text) {
+    return static_cast<std::size_t>(std::count(text.begin(), text.end(), '\n'));
+}
+
+bool has_blank_line(std::string_view text) {
+    LineScanner scanner(text);
+    DeckLine line;
+    while (scanner.next(line)) {
+        if (isBlankLine(line.text)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 片段首行若是空白续行，整篇解析时可能并入上一张卡
+bool starts_with_continuation(std::string_view text) {
+    LineScanner scanner(text);
+    DeckLine line;
+    return scanner.next(line) && isBlankContinuation(line.text);
+}
+
+// 片段末行以 & 结尾时，窗口之后的卡片会被并入
+bool ends_with_continuation(std::string_view text) {
+    const std::size_t newline = text.rfind('\n');
+    return endsWithContinuation(newline == std::string_view::npos ? text : text.substr(newline + 1));
+}
+
+bool has_vertical_header(std::string_view text) {
+    LineScanner scanner(text);
+    DeckLine line;
+    while (scanner.next(line)) {
+        const std::size_t first = line.text.find_first_not_of(" \t");
+        if (first != std::string_view::npos && line.text[first] == '#') {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<int> sorted(const std::unordered_set<int>& values) {
+    std::vector<int> out(values.begin(), values.end());
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+// 删除旧窗口行范围内的错误，窗口之后的错误按行差平移
+void shift_errors(std::vector<ParseError>& errors, std::size_t firstLine, std::size_t lastLine,
+                  std::ptrdiff_t lineDelta) {
+    errors.erase(std::remove_if(errors.begin(), errors.end(),
+                                [&](const ParseError& e) {
+                                    return e.source.empty() && e.line >= firstLine && e.line <= lastLine;
+                                }),
+                 errors.end());
+    for (ParseError& e : errors) {
+        if (e.source.empty() && e.line > lastLine) {
+            e.line = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(e.line) + lineDelta);
+        }
+    }
+}
+
+} // namespace
+
+IncrementalDeck::IncrementalDeck(ParserOptions options)
+    : parser_(std::move(options)), text_(std::make_shared<const std::string>()) {}
+
+DeckUpdate IncrementalDeck::load(std::string text) {
+    const auto start = std::chrono::steady_clock::now();
+    text_ = std::make_shared<const std::string>(std::move(text));
+    DeckUpdate update;
+    reparseAll(update);
+    update.milliseconds =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return update;
+}
+
+DeckUpdate IncrementalDeck::applyEdit(const DeckEdit& edit) {
+    const auto start = std::chrono::steady_clock::now();
+    const std::size_t offset = std::min(edit.offset, text_->size());
+    const std::size_t length = std::min(edit.length, text_->size() - offset);
+
+    Window window;
+    const bool local = planWindow(offset, length, window);
+    const std::size_t oldLines =
+        local ? count_newlines(std::string_view(*text_).substr(window.begin, window.end - window.begin)) : 0;
+    auto next = std::make_shared<std::string>(*text_);
+    next->replace(offset, length, edit.text);
+    text_ = std::move(next);
+    const std::ptrdiff_t delta = static_cast<std::ptrdiff_t>(edit.text.size()) - static_cast<std::ptrdiff_t>(length);
+
+    DeckUpdate update;
+    if (!local || !reparseWindow(window, oldLines, delta, update)) {
+        update = DeckUpdate{};
+        reparseAll(update);
+    }
+    update.milliseconds =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return update;
+}
+
+bool IncrementalDeck::planWindow(std::size_t offset, std::size_t length, Window& window) const {
+    const auto& cards = parsed_.ast.cards();
+    if (hasIncludes_) {
+        return false;
+    }
+    std::size_t body = 0;
+    while (body < cards.size() && (cards[body].kind == CardKind::Title || cards[body].kind == CardKind::Message)) {
+        ++body;
+    }
+    if (body == cards.size() || offset < cards[body].offset) {
+        return false;
+    }
+
+    // 与编辑区相交或相邻的卡片，两侧各多取一张
+    const std::size_t editEnd = offset + length;
+    auto card_end = [](const CardRecord& card) { return card.offset + card.raw.size(); };
+    const auto bodyBegin = cards.begin() + static_cast<std::ptrdiff_t>(body);
+    std::size_t first = static_cast<std::size_t>(
+        std::partition_point(bodyBegin, cards.end(), [&](const CardRecord& c) { return card_end(c) < offset; }) -
+        cards.begin());
+    std::size_t last = static_cast<std::size_t>(
+        std::partition_point(bodyBegin, cards.end(), [&](const CardRecord& c) { return c.offset <= editEnd; }) -
+        cards.begin());
+    // 邻卡与窗口之间隔着空行时属于另一块，不必纳入
+    auto same_block = [&](std::size_t before, std::size_t after) {
+        const std::size_t gap = card_end(cards[before]) + 1;  // 跳过前一卡片末行的换行符
+        return cards[after].offset <= gap ||
+               !has_blank_line(std::string_view(*text_).substr(gap, cards[after].offset - gap));
+    };
+    if (first > body && (first == cards.size() || same_block(first - 1, first))) {
+        --first;
+    }
+    if (last < cards.size() && (last == 0 || same_block(last - 1, last))) {
+        ++last;
+    }
+    // 纵向格式生成的卡片共用表头偏移，不能拆开
+    while (first > body && cards[first - 1].offset == cards[first].offset) {
+        --first;
+    }
+    while (last < cards.size() && cards[last].offset == cards[last - 1].offset) {
+        ++last;
+    }
+
+    window.first = first;
+    window.last = last;
+    window.begin = cards[first].offset;
+    window.end = editEnd;
+    window.block = CardKind::Unknown;
+    for (std::size_t i = first; i < last; ++i) {
+        window.end = std::max(window.end, card_end(cards[i]));
+        if (window.block == CardKind::Unknown && cards[i].kind != CardKind::Comment) {
+            window.block = cards[i].kind;
+        }
+    }
+    if (window.block != CardKind::Cell && window.block != CardKind::Surface && window.block != CardKind::Data) {
+        return false;
+    }
+    if (last < cards.size() && isBlankContinuation(cards[last].raw)) {
+        return false;
+    }
+    return !has_blank_line(std::string_view(*text_).substr(window.begin, window.end - window.begin));
+}
+
+bool IncrementalDeck::reparseWindow(const Window& window, std::size_t oldLines, std::ptrdiff_t offsetDelta,
+                                    DeckUpdate& update) {
+    const std::size_t newEnd = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(window.end) + offsetDelta);
+    const std::string_view fragmentText = std::string_view(*text_).substr(window.begin, newEnd - window.begin);
+    if (has_blank_line(fragmentText) || ends_with_continuation(fragmentText) ||
+        (window.first > 0 && starts_with_continuation(fragmentText)) ||
+        (window.block == CardKind::Data && has_vertical_header(fragmentText))) {
+        return false;
+    }
+
+    Ast& ast = parsed_.ast;
+    const std::size_t firstLine = ast.cards()[window.first].line;
+    ParseResult fragment = parser_.parseFragment(fragmentText, window.block, firstLine, window.begin);
+    const Ast& fresh = fragment.ast;
+    for (const CardRecord& card : fresh.cards()) {
+        if (card.kind == CardKind::Include) {
+            return false;
+        }
+    }
+
+    // 按内容哈希配对新旧卡片，未配上的才算变化
+    std::unordered_map<std::uint64_t, int> unmatched;
+    for (std::size_t i = window.first; i < window.last; ++i) {
+        ++unmatched[hashes_[i]];
+    }
+    std::vector<std::uint64_t> freshHashes(fresh.cardCount());
+    std::vector<bool> freshChanged(fresh.cardCount(), false);
+    for (std::size_t i = 0; i < fresh.cardCount(); ++i) {
+        freshHashes[i] = card_hash(fresh.card(i));
+        const auto it = unmatched.find(freshHashes[i]);
+        if (it != unmatched.end() && it->second > 0) {
+            --it->second;
+        } else {
+            freshChanged[i] = true;
+        }
+    }
+
+    std::unordered_set<int> changedSurfaces;
+    std::unordered_set<int> changedCells;
+    std::unordered_set<int> changedTransforms;
+    std::vector<int> windowSurfaces;  // 旧窗口中的全部曲面，重新入表前先移除
+    std::vector<int> windowCells;
+    auto classify = [&](const CardView& card) {
+        switch (card.kind()) {
+            case CardKind::Surface:
+                changedSurfaces.insert(surface_number(card));
+                break;
+            case CardKind::Cell:
+                changedCells.insert(parse_id(card.keyword()));
+                break;
+            case CardKind::Data:
+                if (const int number = transform_number(card)) {
+                    changedTransforms.insert(number);
+                } else {
+                    update.dataChanged = true;
+                }
+                break;
+            default:
+                break;
+        }
+    };
+    for (std::size_t i = window.first; i < window.last; ++i) {
+        const CardView card = ast.card(i);
+        if (card.kind() == CardKind::Surface) {
+            windowSurfaces.push_back(surface_number(card));
+        } else if (card.kind() == CardKind::Cell) {
+            windowCells.push_back(parse_id(card.keyword()));
+        }
+        auto it = unmatched.find(hashes_[i]);
+        if (it->second > 0) {
+            --it->second;
+            classify(card);
+        }
+    }
+    for (std::size_t i = 0; i < fresh.cardCount(); ++i) {
+        if (freshChanged[i]) {
+            classify(fresh.card(i));
+        }
+        if (fresh.cards()[i].kind == CardKind::Cell) {
+            windowCells.push_back(parse_id(fresh.card(i).keyword()));
+        }
+    }
+    changedSurfaces.erase(0);
+    changedCells.erase(0);
+
+    // 拼接 AST 与哈希，窗口之后的行号、偏移与错误整体平移
+    const std::ptrdiff_t lineDelta =
+        static_cast<std::ptrdiff_t>(count_newlines(fragmentText)) - static_cast<std::ptrdiff_t>(oldLines);
+    const std::size_t lastLine = firstLine + oldLines;
+    const std::size_t freshFirst = window.first;
+    const std::size_t freshLast = window.first + fresh.cardCount();
+    ast.splice(window.first, window.last, fresh, lineDelta, offsetDelta, *text_, text_);
+    hashes_.erase(hashes_.begin() + static_cast<std::ptrdiff_t>(window.first),
+                  hashes_.begin() + static_cast<std::ptrdiff_t>(window.last));
+    hashes_.insert(hashes_.begin() + static_cast<std::ptrdiff_t>(window.first), freshHashes.begin(),
+                   freshHashes.end());
+    shift_errors(parsed_.errors, firstLine, lastLine, lineDelta);
+    parsed_.errors.insert(parsed_.errors.end(), fragment.errors.begin(), fragment.errors.end());
+    update.reparsedCards = fresh.cardCount();
+    update.firstCard = freshFirst;
+    update.lastCard = freshLast;
+    update.cardDelta =
+        static_cast<std::ptrdiff_t>(fresh.cardCount()) - static_cast<std::ptrdiff_t>(window.last - window.first);
+
+    // 曲面：TR 变化时整表重新编译（少见），否则只替换窗口中的曲面
+    if (!changedTransforms.empty()) {
+        auto collect = [&](const SurfaceCompileResult& surfaces) {
+            for (const auto& [surface, transform] : surfaces.transformOf) {
+                if (changedTransforms.count(transform) != 0) {
+                    changedSurfaces.insert(surface);
+                }
+            }
+        };
+        collect(surfaces_);
+        surfaces_ = compileSurfaces(ast);
+        collect(surfaces_);
+    } else {
+        shift_errors(surfaces_.errors, firstLine, lastLine, lineDelta);
+        std::vector<std::size_t> cards;
+        for (std::size_t i = freshFirst; i < freshLast; ++i) {
+            if (ast.cards()[i].kind == CardKind::Surface) {
+                cards.push_back(i);
+            }
+        }
+        updateSurfaces(ast, cards, windowSurfaces, surfaces_);
+    }
+
+    // 单元：直接变化的、引用变化曲面的，再沿 #n / LIKE 反向闭包
+    std::unordered_set<int> dirty = changedCells;
+    for (const int surface : changedSurfaces) {
+        const auto it = surfaceUsers_.find(surface);
+        if (it != surfaceUsers_.end()) {
+            dirty.insert(it->second.begin(), it->second.end());
+        }
+    }
+    std::vector<int> pending(dirty.begin(), dirty.end());
+    while (!pending.empty()) {
+        const int id = pending.back();
+        pending.pop_back();
+        const auto it = cellUsers_.find(id);
+        if (it == cellUsers_.end()) {
+            continue;
+        }
+        for (const int user : it->second) {
+            if (dirty.insert(user).second) {
+                pending.push_back(user);
+            }
+        }
+    }
+
+    std::unordered_set<int> touched = dirty;
+    touched.insert(windowCells.begin(), windowCells.end());
+    std::vector<CompiledCell> previous;
+    for (const int id : touched) {
+        if (const CompiledCell* cell = cells_.find(id)) {
+            previous.push_back(*cell);
+            link(*cell, false);
+        }
+    }
+    shift_errors(cells_.errors, firstLine, lastLine, lineDelta);
+    updateCells(ast, freshFirst, freshLast,
+                static_cast<std::ptrdiff_t>(fresh.cardCount()) - static_cast<std::ptrdiff_t>(window.last - window.first),
+                dirty, cells_);
+    for (const int id : touched) {
+        if (const CompiledCell* cell = cells_.find(id)) {
+            link(*cell, true);
+        }
+    }
+
+    // 重新网格化：重新编译的单元，以及沿 FILL 向上包含它们的单元
+    std::unordered_set<int> impacted = dirty;
+    std::unordered_set<int> universes;
+    std::vector<int> queue;
+    auto visit_universe = [&](int universe) {
+        if (universe != 0 && universes.insert(universe).second) {
+            queue.push_back(universe);
+        }
+    };
+    for (const CompiledCell& cell : previous) {
+        if (dirty.count(cell.id) != 0) {
+            visit_universe(cell.universe);
+        }
+    }
+    for (const int id : dirty) {
+        if (const CompiledCell* cell = cells_.find(id)) {
+            visit_universe(cell->universe);
+        }
+    }
+    while (!queue.empty()) {
+        const int universe = queue.back();
+        queue.pop_back();
+        const auto it = fillUsers_.find(universe);
+        if (it == fillUsers_.end()) {
+            continue;
+        }
+        for (const int id : it->second) {
+            impacted.insert(id);
+            if (const CompiledCell* cell = cells_.find(id)) {
+                visit_universe(cell->universe);
+            }
+        }
+    }
+
+    update.changedSurfaces = sorted(changedSurfaces);
+    update.recompiledCells = sorted(dirty);
+    update.impactedCells = sorted(impacted);
+    return true;
+}
+
+void IncrementalDeck::reparseAll(DeckUpdate& update) {
+    parsed_ = parser_.parse(text_);
+    const Ast& ast = parsed_.ast;
+    hashes_.resize(ast.cardCount());
+    hasIncludes_ = false;
+    for (std::size_t i = 0; i < ast.cardCount(); ++i) {
+        hashes_[i] = card_hash(ast.card(i));
+        hasIncludes_ = hasIncludes_ || ast.cards()[i].kind == CardKind::Include;
+    }
+    surfaces_ = compileSurfaces(ast);
+    cells_ = compileCells(ast);
+    rebuildDependencies();
+
+    update.fullReparse = true;
+    update.reparsedCards = ast.cardCount();
+    update.firstCard = 0;
+    update.lastCard = ast.cardCount();
+    update.dataChanged = true;
+    for (const CompiledCell& cell : cells_.cells) {
+        update.impactedCells.push_back(cell.id);
+    }
+    std::sort(update.impactedCells.begin(), update.impactedCells.end());
+    update.recompiledCells = update.impactedCells;
+}
+
+void IncrementalDeck::link(const CompiledCell& cell, bool add) {
+    auto edit = [&](std::unordered_map<int, std::vector<int>>& users, int key) {
+        std::vector<int>& list = users[key];
+        if (add) {
+            list.push_back(cell.id);
+        } else {
+            list.erase(std::remove(list.begin(), list.end(), cell.id), list.end());
+        }
+    };
+    for (const int surface : cell.surfaces) {
+        edit(surfaceUsers_, surface);
+    }
+    for (const int reference : cell.references) {
+        edit(cellUsers_, reference);
+    }
+    if (cell.fill != 0) {
+        edit(fillUsers_, cell.fill);
+    }
+    // 栅格单元按数组中出现的每个宇宙各登记一次
+    std::vector<int> fills(cell.fillArray);
+    std::sort(fills.begin(), fills.end());
+    fills.erase(std::unique(fills.begin(), fills.end()), fills.end());
+    for (const int universe : fills) {
+        if (universe != 0 && universe != cell.universe) {
+            edit(fillUsers_, universe);
+        }
+    }
+}
+
+void IncrementalDeck::rebuildDependencies() {
+    surfaceUsers_.clear();
+    cellUsers_.clear();
+    fillUsers_.clear();
+    for (const CompiledCell& cell : cells_.cells) {
+        link(cell, true);
+    }
+}
+
+std::vector<ParseError> IncrementalDeck::errors() const {
+    std::vector<ParseError> out = parsed_.errors;
+    out.insert(out.end(), surfaces_.errors.begin(), surfaces_.errors.end());
+    out.insert(out.end(), cells_.errors.begin(), cells_.errors.end());
+    std::stable_sort(out.begin(), out.end(), [](const ParseError& a, const ParseError& b) {
+        return a.source != b.source ? a.source < b.source : a.line < b.line;
+    });
+    return out;
+}
+
+std::vector<int> IncrementalDeck::cellsUsingSurface(int surface) const {
+    const auto it = surfaceUsers_.find(surface);
+    if (it == surfaceUsers_.end()) {
+        return {};
+    }
+    std::vector<int> users = it->second;
+    std::sort(users.begin(), users.end());
+    return users;
+}
+
+} // namespace mcnp::parser
@@ -0,0 +1,89 @@
+#ifndef INCREMENTAL_DECK_H
+#define INCREMENTAL_DECK_H
+
+#include "cell_compiler.h"
+#include "mcnp_parser.h"
+#include "surface_compiler.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mcnp::parser {
+
+// 一次文本编辑：把 [offset, offset + length) 替换为 text
+struct DeckEdit {
+    std::size_t offset = 0;
+    std::size_t length = 0;
+    std::string text;
+};
+
+struct DeckUpdate {
+    bool fullReparse = false;
+    std::size_t reparsedCards = 0;     // 重新解析得到的卡片数
+    std::size_t firstCard = 0;         // 新 AST 中重新解析的卡片 [firstCard, lastCard)
+    std::size_t lastCard = 0;
+    std::ptrdiff_t cardDelta = 0;      // 卡片总数的变化
+    std::vector<int> changedSurfaces;  // 定义有变化（含新增、删除、所用 TR 变化）的曲面
+    std::vector<int> recompiledCells;  // 区域重新编译的单元（含 #n、LIKE 的依赖者）
+    std::vector<int> impactedCells;    // 需要重新网格化的单元（另含沿 FILL 向上传播到的单元）
+    bool dataChanged = false;          // 数据块中 TR 以外的卡片有变化
+    double milliseconds = 0.0;
+};
+
+// 可编辑的卡片文件会话：持有文本、扁平 AST、曲面表与 CSG DAG，以及
+// 曲面 -> 单元、单元 -> 引用它的单元、宇宙 -> 填充它的单元三张反向依赖表。
+// 编辑只重新解析受影响的卡片窗口（两侧各多取一张），按内容哈希找出真正变化的卡片，
+// 再沿依赖表只重新编译受影响的曲面与单元。窗口跨越块分隔空行、续行边界不确定、
+// 含 READ、落在标题区或涉及纵向格式时退回全量解析。
+class IncrementalDeck {
+public:
+    explicit IncrementalDeck(ParserOptions options = {});
+
+    DeckUpdate load(std::string text);
+    // 超出文本的编辑范围会被截断到文本末尾
+    DeckUpdate applyEdit(const DeckEdit& edit);
+
+    const std::string& text() const noexcept { return *text_; }
+    const Ast& ast() const noexcept { return parsed_.ast; }
+    const SurfaceCompileResult& surfaces() const noexcept { return surfaces_; }
+    const CellCompileResult& cells() const noexcept { return cells_; }
+    // 解析与编译错误，按行号排序
+    std::vector<ParseError> errors() const;
+
+    std::vector<int> cellsUsingSurface(int surface) const;
+
+private:
+    struct Window {
+        std::size_t first = 0;  // 卡片下标 [first, last)
+        std::size_t last = 0;
+        std::size_t begin = 0;  // 旧文本中的字节范围 [begin, end)
+        std::size_t end = 0;
+        CardKind block = CardKind::Unknown;
+    };
+
+    bool planWindow(std::size_t offset, std::size_t length, Window& window) const;
+    bool reparseWindow(const Window& window, std::size_t oldLines, std::ptrdiff_t offsetDelta, DeckUpdate& update);
+    void reparseAll(DeckUpdate& update);
+    void link(const CompiledCell& cell, bool add);
+    void rebuildDependencies();
+
+    MCNPParser parser_;
+    std::shared_ptr<const std::string> text_;  // 每次编辑换新缓冲区，AST 卡片文本引用它
+    ParseResult parsed_;
+    std::vector<std::uint64_t> hashes_;  // 每张卡片的内容哈希（关键字与参数，不含注释和空白）
+    bool hasIncludes_ = false;
+    SurfaceCompileResult surfaces_;
+    CellCompileResult cells_;
+
+    std::unordered_map<int, std::vector<int>> surfaceUsers_;
+    std::unordered_map<int, std::vector<int>> cellUsers_;
+    std::unordered_map<int, std::vector<int>> fillUsers_;
+};
+
+} // namespace mcnp::parser
+
+#endif // INCREMENTAL_DECK_H
@@ -1,8 +1,383 @@
 #include "input_ast.h"
+#include "card_assembler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
 
 namespace mcnp::parser {
 
-AstNode::AstNode(NodeKind kind, std::string value)
-    : kind(kind), value(std::move(value)) {}
+namespace {
+
+// splice 留下的死字符串超过存活量加这么多字节时重建存储
+constexpr std::size_t kCompactSlack = 1 << 20;
+
+// 记录分配总量的上游资源，便于统计 arena 占用
+class CountingResource final : public std::pmr::memory_resource {
+public:
+    std::size_t allocated = 0;
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        allocated += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+} // namespace
+
+StringId StringPool::intern(std::string_view text) {
+    return insert(text, true);
+}
+
+StringId StringPool::adopt(std::string_view text) {
+    return insert(text, false);
+}
+
+StringId StringPool::insert(std::string_view text, bool copy) {
+    if ((strings_.size() + 1) * 2 > slots_.size()) {
+        grow();
+    }
+    const auto hash = static_cast<std::uint32_t>(std::hash<std::string_view>{}(text));
+    const std::size_t mask = slots_.size() - 1;
+    std::size_t index = hash & mask;
+    while (slots_[index].id != kEmpty) {
+        const Slot& slot = slots_[index];
+        if (slot.hash == hash && strings_[slot.id] == text) {
+            return slot.id;
+        }
+        index = (index + 1) & mask;
+    }
+
+    if (copy) {
+        char* bytes = static_cast<char*>(resource_->allocate(text.size() == 0 ? 1 : text.size(), 1));
+        std::memcpy(bytes, text.data(), text.size());
+        text = std::string_view(bytes, text.size());
+    }
+    const auto id = static_cast<StringId>(strings_.size());
+    strings_.push_back(text);
+    slots_[index] = {id, hash};
+    return id;
+}
+
+void StringPool::grow() {
+    std::vector<Slot> slots(std::max<std::size_t>(64, slots_.size() * 2), Slot{kEmpty, 0});
+    const std::size_t mask = slots.size() - 1;
+    for (const Slot& slot : slots_) {
+        if (slot.id == kEmpty) {
+            continue;
+        }
+        std::size_t index = slot.hash & mask;
+        while (slots[index].id != kEmpty) {
+            index = (index + 1) & mask;
+        }
+        slots[index] = slot;
+    }
+    slots_ = std::move(slots);
+}
+
+struct Ast::Storage {
+    CountingResource upstream;
+    std::pmr::monotonic_buffer_resource arena{64 * 1024, &upstream};
+    StringPool strings{&arena};
+    std::vector<CardRecord> cards;
+    std::vector<ParameterRecord> parameters;
+    std::vector<std::string_view> sources{std::string_view{}};
+    std::vector<std::shared_ptr<const void>> owners{nullptr};  // 各来源文本的持有者，与 sources 对应
+    std::vector<std::shared_ptr<const void>> borrowed;         // append(const Ast&) 引用的其他 AST 的来源文本
+    std::vector<std::unique_ptr<Storage>> adopted;             // append(Ast&&) 接管的 arena
+    std::size_t deadParameters = 0;                            // splice 替换掉、尚未压缩的参数
+    std::size_t liveBytes = 0;                                 // 首次 splice 或上次重建时 arena 的分配量
+
+    std::string_view store(std::string_view text) {
+        if (text.empty()) {
+            return {};
+        }
+        char* bytes = static_cast<char*>(arena.allocate(text.size(), 1));
+        std::memcpy(bytes, text.data(), text.size());
+        return {bytes, text.size()};
+    }
+
+    // 本存储与接管的存储引用的全部来源文本
+    void collectOwners(std::vector<std::shared_ptr<const void>>& out) const {
+        for (const auto& owner : owners) {
+            if (owner) {
+                out.push_back(owner);
+            }
+        }
+        out.insert(out.end(), borrowed.begin(), borrowed.end());
+        for (const auto& storage : adopted) {
+            storage->collectOwners(out);
+        }
+    }
+};
+
+std::string_view CardView::keyword() const {
+    return ast_->strings().view(record_->keyword);
+}
+
+std::string_view CardView::parameter(std::size_t index) const {
+    return ast_->strings().view(parameterRecord(index).text);
+}
+
+const ParameterRecord& CardView::parameterRecord(std::size_t index) const {
+    return ast_->parameters()[record_->firstParameter + index];
+}
+
+std::string_view CardView::source() const {
+    return ast_->sourceName(record_->source);
+}
+
+std::vector<std::string> CardView::expandedParameters() const {
+    std::vector<std::string_view> compact;
+    compact.reserve(parameterCount());
+    for (std::size_t i = 0; i < parameterCount(); ++i) {
+        compact.push_back(parameter(i));
+    }
+    if (!hasShorthand()) {
+        return std::vector<std::string>(compact.begin(), compact.end());
+    }
+    return expandShorthand(compact);
+}
+
+Ast::Ast() : storage_(std::make_unique<Storage>()) {}
+Ast::~Ast() = default;
+Ast::Ast(Ast&&) noexcept = default;
+Ast& Ast::operator=(Ast&&) noexcept = default;
+
+std::size_t Ast::cardCount() const noexcept {
+    return storage_->cards.size();
+}
+
+CardView Ast::card(std::size_t index) const {
+    return CardView(*this, storage_->cards[index]);
+}
+
+const std::vector<CardRecord>& Ast::cards() const noexcept {
+    return storage_->cards;
+}
+
+const std::vector<ParameterRecord>& Ast::parameters() const noexcept {
+    return storage_->parameters;
+}
+
+std::size_t Ast::addCard(CardKind kind, std::size_t line, std::string_view keyword, std::string_view raw,
+                         std::uint32_t source, std::size_t offset) {
+    CardRecord record;
+    record.kind = kind;
+    record.source = source;
+    record.offset = offset;
+    record.line = static_cast<std::uint32_t>(line);
+    record.keyword = storage_->strings.intern(keyword);
+    record.firstParameter = static_cast<std::uint32_t>(storage_->parameters.size());
+    record.raw = raw;
+    storage_->cards.push_back(record);
+    return storage_->cards.size() - 1;
+}
+
+void Ast::addParameter(std::string_view text, std::size_t line, std::size_t column) {
+    storage_->parameters.push_back({storage_->strings.intern(text), static_cast<std::uint32_t>(line),
+                                    static_cast<std::uint32_t>(column)});
+    CardRecord& card = storage_->cards.back();
+    ++card.parameterCount;
+    if (isShorthandToken(text)) {
+        card.flags |= CardRecord::HasShorthand;
+    }
+}
+
+void Ast::reserve(std::size_t cards, std::size_t parameters) {
+    storage_->cards.reserve(cards);
+    storage_->parameters.reserve(parameters);
+}
+
+void Ast::append(const Ast& other) {
+    other.storage_->collectOwners(storage_->borrowed);
+    reserve(cardCount() + other.cardCount(), parameters().size() + other.parameters().size());
+    for (const auto& record : other.cards()) {
+        const CardView view(other, record);
+        const std::uint32_t source = record.source == 0 ? 0 : addSource(other.sourceName(record.source));
+        addCard(record.kind, record.line, view.keyword(), view.raw(), source, record.offset);
+        for (std::size_t i = 0; i < view.parameterCount(); ++i) {
+            const ParameterRecord& parameter = view.parameterRecord(i);
+            addParameter(other.strings().view(parameter.text), parameter.line, parameter.column);
+        }
+    }
+}
+
+void Ast::append(Ast&& other) {
+    Storage& source = *other.storage_;
+    Storage& target = *storage_;
+
+    std::vector<StringId> strings(source.strings.size());
+    for (std::size_t i = 0; i < strings.size(); ++i) {
+        strings[i] = target.strings.adopt(source.strings.view(static_cast<StringId>(i)));
+    }
+    std::vector<std::uint32_t> sources(source.sources.size(), 0);
+    for (std::size_t i = 1; i < sources.size(); ++i) {
+        sources[i] = addSource(source.sources[i]);
+        if (source.owners[i]) {
+            retainSource(sources[i], source.owners[i]);
+        }
+    }
+
+    const auto parameterBase = static_cast<std::uint32_t>(target.parameters.size());
+    target.cards.reserve(target.cards.size() + source.cards.size());
+    for (CardRecord record : source.cards) {
+        record.keyword = strings[record.keyword];
+        record.source = sources[record.source];
+        record.firstParameter += parameterBase;
+        target.cards.push_back(record);
+    }
+    target.parameters.reserve(target.parameters.size() + source.parameters.size());
+    for (ParameterRecord parameter : source.parameters) {
+        parameter.text = strings[parameter.text];
+        target.parameters.push_back(parameter);
+    }
+
+    target.adopted.push_back(std::move(other.storage_));
+    other.storage_ = std::make_unique<Storage>();
+}
+
+void Ast::splice(std::size_t first, std::size_t last, const Ast& replacement, std::ptrdiff_t lineDelta,
+                 std::ptrdiff_t offsetDelta, std::string_view text, std::shared_ptr<const void> owner) {
+    Storage& target = *storage_;
+    if (target.liveBytes == 0) {
+        target.liveBytes = arenaBytes();
+    }
+    auto shift = [](auto value, std::ptrdiff_t delta) {
+        return static_cast<decltype(value)>(static_cast<std::ptrdiff_t>(value) + delta);
+    };
+
+    for (std::size_t i = first; i < last; ++i) {
+        target.deadParameters += target.cards[i].parameterCount;
+    }
+    for (std::size_t i = last; i < target.cards.size(); ++i) {
+        CardRecord& record = target.cards[i];
+        record.line = shift(record.line, lineDelta);
+        record.offset = shift(record.offset, offsetDelta);
+        for (std::uint32_t p = 0; p < record.parameterCount; ++p) {
+            ParameterRecord& parameter = target.parameters[record.firstParameter + p];
+            parameter.line = shift(parameter.line, lineDelta);
+        }
+    }
+
+    // 新卡片的参数追加在参数表末尾
+    std::vector<CardRecord> inserted;
+    inserted.reserve(replacement.cardCount());
+    for (const auto& source : replacement.cards()) {
+        const CardView view(replacement, source);
+        CardRecord record = source;
+        record.keyword = target.strings.intern(view.keyword());
+        record.source = source.source == 0 ? 0 : addSource(replacement.sourceName(source.source));
+        record.firstParameter = static_cast<std::uint32_t>(target.parameters.size());
+        for (std::size_t p = 0; p < view.parameterCount(); ++p) {
+            ParameterRecord parameter = view.parameterRecord(p);
+            parameter.text = target.strings.intern(replacement.strings().view(parameter.text));
+            target.parameters.push_back(parameter);
+        }
+        inserted.push_back(record);
+    }
+    target.cards.erase(target.cards.begin() + static_cast<std::ptrdiff_t>(first),
+                       target.cards.begin() + static_cast<std::ptrdiff_t>(last));
+    target.cards.insert(target.cards.begin() + static_cast<std::ptrdiff_t>(first), inserted.begin(), inserted.end());
+
+    // 主输入换成编辑后的文本：偏移已平移，raw 按偏移重新指向新文本，旧文本随持有者释放
+    for (CardRecord& record : target.cards) {
+        if (record.source == 0 && record.offset + record.raw.size() <= text.size()) {
+            record.raw = text.substr(record.offset, record.raw.size());
+        }
+    }
+    target.owners[0] = std::move(owner);
+
+    // 死参数超过一半，或驻留的死字符串明显超过存活量时整体重建
+    if (target.deadParameters * 2 > target.parameters.size() ||
+        arenaBytes() > 2 * target.liveBytes + kCompactSlack) {
+        compact();
+    }
+}
+
+void Ast::compact() {
+    const Storage& old = *storage_;
+    auto fresh = std::make_unique<Storage>();
+    for (std::size_t i = 1; i < old.sources.size(); ++i) {
+        fresh->sources.push_back(fresh->store(old.sources[i]));
+    }
+    fresh->owners = old.owners;
+    fresh->borrowed = old.borrowed;
+    for (const auto& storage : old.adopted) {
+        storage->collectOwners(fresh->borrowed);
+    }
+    fresh->cards.reserve(old.cards.size());
+    fresh->parameters.reserve(old.parameters.size() - old.deadParameters);
+    for (CardRecord record : old.cards) {
+        record.keyword = fresh->strings.intern(old.strings.view(record.keyword));
+        const auto begin = old.parameters.begin() + record.firstParameter;
+        record.firstParameter = static_cast<std::uint32_t>(fresh->parameters.size());
+        for (auto it = begin; it != begin + record.parameterCount; ++it) {
+            ParameterRecord parameter = *it;
+            parameter.text = fresh->strings.intern(old.strings.view(parameter.text));
+            fresh->parameters.push_back(parameter);
+        }
+        fresh->cards.push_back(record);
+    }
+    fresh->liveBytes = fresh->upstream.allocated;
+    storage_ = std::move(fresh);
+}
+
+std::uint32_t Ast::addSource(std::string_view name) {
+    auto& sources = storage_->sources;
+    for (std::size_t i = 1; i < sources.size(); ++i) {
+        if (sources[i] == name) {
+            return static_cast<std::uint32_t>(i);
+        }
+    }
+    sources.push_back(storeText(name));
+    storage_->owners.push_back(nullptr);
+    return static_cast<std::uint32_t>(sources.size() - 1);
+}
+
+void Ast::retainSource(std::uint32_t source, std::shared_ptr<const void> owner) {
+    auto& owners = storage_->owners;
+    if (owners.size() <= source) {
+        owners.resize(source + 1);
+    }
+    owners[source] = std::move(owner);
+}
+
+std::string_view Ast::sourceName(std::uint32_t source) const {
+    return source < storage_->sources.size() ? storage_->sources[source] : std::string_view{};
+}
+
+StringPool& Ast::strings() noexcept {
+    return storage_->strings;
+}
+
+const StringPool& Ast::strings() const noexcept {
+    return storage_->strings;
+}
+
+std::string_view Ast::storeText(std::string_view text) {
+    return storage_->store(text);
+}
+
+std::size_t Ast::arenaBytes() const {
+    std::size_t bytes = 0;
+    std::vector<const Storage*> pending{storage_.get()};
+    while (!pending.empty()) {
+        const Storage* storage = pending.back();
+        pending.pop_back();
+        bytes += storage->upstream.allocated;
+        for (const auto& adopted : storage->adopted) {
+            pending.push_back(adopted.get());
+        }
+    }
+    return bytes;
+}
 
 } // namespace mcnp::parser
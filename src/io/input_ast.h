@@ -2,51 +2,157 @@
 #define INPUT_AST_H
 
 #include <cstddef>
+#include <cstdint>
 #include <memory>
-#include <optional>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace mcnp::parser {
 
-enum class CardKind {
+enum class CardKind : std::uint8_t {
     Cell,
     Surface,
     Data,
     Comment,
-    Unknown
+    Unknown,
+    Title,    // 标题卡（首行）
+    Message,  // message: 块
+    Include   // READ FILE= 卡，其后紧跟被包含文件的卡片
 };
 
-enum class NodeKind {
-    Root,
-    Card,
-    Parameter
+using StringId = std::uint32_t;
+
+// 字符串驻留池：相同内容只保存一份，字符数据放在单调分配器中。
+// 查找表为开放寻址的扁平数组，避免大型卡片文件中逐节点分配与指针追逐。
+class StringPool {
+public:
+    explicit StringPool(std::pmr::memory_resource* resource) : resource_(resource) {}
+
+    StringId intern(std::string_view text);
+    // 登记已位于稳定存储中的字符串，不复制字符
+    StringId adopt(std::string_view text);
+    std::string_view view(StringId id) const { return strings_[id]; }
+    std::size_t size() const noexcept { return strings_.size(); }
+
+private:
+    struct Slot {
+        StringId id;
+        std::uint32_t hash;  // 哈希低 32 位，先比较哈希再比较内容
+    };
+    static constexpr StringId kEmpty = ~StringId{0};
+
+    StringId insert(std::string_view text, bool copy);
+    void grow();
+
+    std::pmr::memory_resource* resource_;
+    std::vector<std::string_view> strings_;
+    std::vector<Slot> slots_;
 };
 
-struct CardInfo {
+struct ParameterRecord {
+    StringId text = 0;
+    std::uint32_t line = 0;
+    std::uint32_t column = 0;
+};
+
+// 连续存放的卡片记录；参数为 parameters 表中的 [firstParameter, firstParameter + parameterCount)
+struct CardRecord {
+    enum Flags : std::uint8_t {
+        HasShorthand = 1  // 参数中含 nR/nI/nM/nJ/ILOG 简写
+    };
+
     CardKind kind = CardKind::Unknown;
-    std::size_t line = 0;
-    std::string keyword;
-    std::string raw;
-    std::vector<std::string> parameters;
+    std::uint8_t flags = 0;
+    std::uint32_t line = 0;
+    std::uint32_t source = 0;  // 来源文件（0 为主输入，其余为 READ 包含的文件）
+    StringId keyword = 0;
+    std::uint32_t firstParameter = 0;
+    std::uint32_t parameterCount = 0;
+    std::size_t offset = 0;  // 首行在来源文本中的字节偏移
+    std::string_view raw;    // 原始卡片文本，直接引用来源文本，不复制
 };
 
-struct AstNode {
-    NodeKind kind;
-    std::string value;
-    std::optional<CardInfo> card;
-    std::vector<std::unique_ptr<AstNode>> children;
-
-    explicit AstNode(NodeKind kind, std::string value = {});
-    AstNode(const AstNode&) = delete;
-    AstNode& operator=(const AstNode&) = delete;
-    AstNode(AstNode&&) noexcept = default;
-    AstNode& operator=(AstNode&&) noexcept = default;
-    ~AstNode() = default;
+class Ast;
+
+// 只读卡片视图
+class CardView {
+public:
+    CardView(const Ast& ast, const CardRecord& record) : ast_(&ast), record_(&record) {}
+
+    CardKind kind() const noexcept { return record_->kind; }
+    std::size_t line() const noexcept { return record_->line; }
+    std::size_t offset() const noexcept { return record_->offset; }
+    std::string_view keyword() const;
+    std::string_view raw() const noexcept { return record_->raw; }
+    std::size_t parameterCount() const noexcept { return record_->parameterCount; }
+    std::string_view parameter(std::size_t index) const;
+    const ParameterRecord& parameterRecord(std::size_t index) const;
+    std::string_view source() const;
+    bool hasShorthand() const noexcept { return (record_->flags & CardRecord::HasShorthand) != 0; }
+    // 按需展开简写；AST 中始终保留紧凑形式
+    std::vector<std::string> expandedParameters() const;
+    const CardRecord& record() const noexcept { return *record_; }
+
+private:
+    const Ast* ast_;
+    const CardRecord* record_;
 };
 
-struct Ast {
-    AstNode root{NodeKind::Root};
+// 扁平 AST：卡片表、参数表与字符串池，驻留字符串放在 AST 自带的单调 arena 中；
+// 卡片的原始文本不复制，引用由 retainSource 交给 AST 保管的来源文本（如内存映射的文件）。
+// 存储放在堆上的 Storage 中，移动 AST 只移动一个指针，arena 地址保持不变。
+class Ast {
+public:
+    Ast();
+    ~Ast();
+    Ast(Ast&&) noexcept;
+    Ast& operator=(Ast&&) noexcept;
+    Ast(const Ast&) = delete;
+    Ast& operator=(const Ast&) = delete;
+
+    std::size_t cardCount() const noexcept;
+    CardView card(std::size_t index) const;
+    const std::vector<CardRecord>& cards() const noexcept;
+    const std::vector<ParameterRecord>& parameters() const noexcept;
+
+    // 构建接口：addParameter 追加到最近一次 addCard 的卡片。raw 不复制，须位于已登记的来源文本中
+    // （或比 AST 存活更久）；主输入卡片的 raw 须等于来源文本中从 offset 起的一段
+    std::size_t addCard(CardKind kind, std::size_t line, std::string_view keyword, std::string_view raw,
+                        std::uint32_t source = 0, std::size_t offset = 0);
+    void addParameter(std::string_view text, std::size_t line, std::size_t column);
+    void reserve(std::size_t cards, std::size_t parameters);
+
+    // 把另一棵 AST 的卡片追加到末尾（字符串重新驻留到本 AST）
+    void append(const Ast& other);
+    // 接管另一棵 AST 的 arena，只重映射字符串编号，不复制字符；other 变为空 AST
+    void append(Ast&& other);
+    // 用 replacement 的卡片替换 [first, last)，其后卡片的行号与偏移按 lineDelta/offsetDelta 平移。
+    // 用于增量重解析：text 为编辑后的主输入（owner 持有），主输入卡片的 raw 按偏移改为引用 text，
+    // 旧的主输入随之释放。只驻留窗口内的少量字符串；被替换卡片的参数与字符串累积过多时整体重建存储。
+    void splice(std::size_t first, std::size_t last, const Ast& replacement, std::ptrdiff_t lineDelta,
+                std::ptrdiff_t offsetDelta, std::string_view text, std::shared_ptr<const void> owner);
+
+    // 登记来源文件名，返回其编号；主输入固定为 0（名称为空）
+    std::uint32_t addSource(std::string_view name);
+    std::string_view sourceName(std::uint32_t source) const;
+    // 来源文本的持有者交给 AST 保管，卡片的 raw 引用其中的文本；同一来源再次登记时替换
+    void retainSource(std::uint32_t source, std::shared_ptr<const void> owner);
+
+    StringPool& strings() noexcept;
+    const StringPool& strings() const noexcept;
+    // 复制文本到 arena，返回的视图与 AST 同生命周期（用于来源文本中不存在的合成文本）
+    std::string_view storeText(std::string_view text);
+    // arena 已分配的字节数（用于统计内存）
+    std::size_t arenaBytes() const;
+
+private:
+    struct Storage;
+    // 按卡片顺序把卡片、参数与字符串重新写入新的存储，丢弃 splice 留下的死数据
+    void compact();
+
+    std::unique_ptr<Storage> storage_;
 };
 
 } // namespace mcnp::parser
@@ -1,8 +1,11 @@
 #include "mcnp_parser.h"
+#include "card_assembler.h"
+#include "deck_tokenizer.h"
+#include "include_cache.h"
 
 #include <algorithm>
 #include <cctype>
-#include <sstream>
+#include <iterator>
 
 namespace mcnp::parser {
 
@@ -14,21 +17,6 @@ enum class Section {
     Data
 };
 
-std::string trim(std::string value) {
-    auto not_space = [](unsigned char ch) { return !std::isspace(ch); };
-    value.erase(value.begin(), std::find_if(value.begin(), value.end(), not_space));
-    value.erase(std::find_if(value.rbegin(), value.rend(), not_space).base(), value.end());
-    return value;
-}
-
-bool is_comment_line(const std::string& line) {
-    if (line.empty()) {
-        return false;
-    }
-    const char first = line.front();
-    return first == 'c' || first == 'C' || first == '$';
-}
-
 CardKind kind_for_section(Section section) {
     switch (section) {
         case Section::Cell:
@@ -42,79 +30,410 @@ CardKind kind_for_section(Section section) {
     }
 }
 
-std::vector<std::string> split_tokens(const std::string& line) {
-    std::istringstream stream(line);
-    std::vector<std::string> tokens;
-    std::string token;
-    while (stream >> token) {
-        tokens.push_back(token);
+bool equals_ci(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+               return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+           });
+}
+
+bool starts_with_ci(std::string_view text, std::string_view prefix) {
+    return text.size() >= prefix.size() && equals_ci(text.substr(0, prefix.size()), prefix);
+}
+
+bool is_integer(std::string_view text) {
+    return !text.empty() && std::all_of(text.begin(), text.end(), [](char ch) {
+        return std::isdigit(static_cast<unsigned char>(ch)) != 0;
+    });
+}
+
+// READ 卡的 FILE= 参数，支持 "file=x"、"file= x"、"file = x"
+std::string_view read_file_argument(const std::vector<Token>& tokens) {
+    for (std::size_t i = 1; i < tokens.size(); ++i) {
+        const std::string_view text = tokens[i].text;
+        if (!starts_with_ci(text, "file")) {
+            continue;
+        }
+        std::string_view value = text.substr(4);
+        std::size_t next = i + 1;
+        if (value.empty() && next < tokens.size() && tokens[next].text.front() == '=') {
+            value = tokens[next++].text;
+        }
+        if (!value.empty() && value.front() == '=') {
+            value.remove_prefix(1);
+            if (value.empty() && next < tokens.size()) {
+                value = tokens[next].text;
+            }
+            return value;
+        }
+    }
+    return {};
+}
+
+// 预扫描 READ 卡的 FILE= 参数
+std::vector<std::string_view> scan_read_files(std::string_view text) {
+    std::vector<std::string_view> files;
+    LineScanner scanner(text);
+    DeckLine line;
+    std::vector<Token> tokens;
+    while (scanner.next(line)) {
+        const auto first = line.text.find_first_not_of(" \t");
+        if (first == std::string_view::npos || first >= 5 || !starts_with_ci(line.text.substr(first), "read")) {
+            continue;
+        }
+        tokens.clear();
+        tokenizeLine(line, tokens);
+        if (!tokens.empty() && equals_ci(tokens.front().text, "read")) {
+            files.push_back(read_file_argument(tokens));
+        }
     }
-    return tokens;
+    return files;
 }
 
-AstNode* append_card(Ast& ast, CardInfo info) {
-    auto node = std::make_unique<AstNode>(NodeKind::Card, info.keyword);
-    node->card = std::move(info);
-    AstNode* node_ptr = node.get();
-    ast.root.children.push_back(std::move(node));
-    return node_ptr;
+// READ 会改变块状态且需要递归，含 READ 的输入走串行路径
+bool use_parallel(const ParserOptions& options, std::string_view text) {
+    return options.parallel && text.size() >= options.parallelThreshold && scan_read_files(text).empty();
+}
+
+void parse_header(CardAssembler& assembler, std::string_view text, std::uint32_t source, Ast& ast) {
+    DeckLine line;
+    bool haveLine = assembler.nextRawLine(line);
+    if (haveLine && starts_with_ci(line.text, "message:")) {
+        // message 块持续到第一个空行，之后才是标题卡
+        const std::size_t begin = line.offset;
+        const std::size_t first = line.number;
+        std::size_t end = line.offset + line.text.size();
+        while (assembler.nextRawLine(line) && !isBlankLine(line.text)) {
+            end = line.offset + line.text.size();
+        }
+        ast.addCard(CardKind::Message, first, "message", text.substr(begin, end - begin), source, begin);
+        haveLine = assembler.nextRawLine(line);
+    }
+    if (haveLine) {
+        ast.addCard(CardKind::Title, line.number, "title", line.text, source, line.offset);
+    }
+}
+
+// 并行分块：起点总是逻辑卡片或空行的首行，记录该处的块状态
+struct BodyChunk {
+    std::size_t begin = 0;
+    std::size_t end = 0;
+    std::size_t line = 1;
+    Section section = Section::Cell;
+    bool sawContent = false;
+};
+
+// 边界扫描：只判断每一物理行是否开始新的逻辑单元，规则与 CardAssembler 一致。
+// 数据块含纵向格式等跨卡结构，整体留在最后一块。
+std::vector<BodyChunk> split_body(std::string_view text, std::size_t begin, std::size_t firstLine,
+                                  std::size_t targetBytes) {
+    std::vector<BodyChunk> chunks{{begin, text.size(), firstLine, Section::Cell, false}};
+    LineScanner scanner(text.substr(begin), firstLine);
+    DeckLine line;
+    Section section = Section::Cell;
+    bool sawContent = false;
+    bool inCard = false;
+    bool continued = false;
+
+    while (scanner.next(line)) {
+        const bool blank = isBlankLine(line.text);
+        const bool comment = !blank && isCommentLine(line.text);
+        if (inCard && !blank && (continued || (isBlankContinuation(line.text) && !comment))) {
+            if (!comment) {
+                continued = endsWithContinuation(line.text);
+            }
+            continue;
+        }
+
+        if (section == Section::Data) {
+            break;
+        }
+        const std::size_t offset = begin + line.offset;
+        if (offset - chunks.back().begin >= targetBytes) {
+            chunks.back().end = offset;
+            chunks.push_back({offset, text.size(), line.number, section, sawContent});
+        }
+
+        inCard = false;
+        if (blank) {
+            if (sawContent) {
+                section = section == Section::Cell ? Section::Surface : Section::Data;
+                sawContent = false;
+            }
+            continue;
+        }
+        sawContent = true;
+        if (!comment) {
+            inCard = true;
+            continued = endsWithContinuation(line.text);
+        }
+    }
+    return chunks;
+}
+
+void add_tokens(Ast& ast, const std::vector<Token>& tokens, std::size_t first) {
+    for (std::size_t i = first; i < tokens.size(); ++i) {
+        ast.addParameter(tokens[i].text, tokens[i].line, tokens[i].column);
+    }
 }
 
 } // namespace
 
-ParseResult MCNPParser::parse(std::string_view text) const {
+struct MCNPParser::Context {
     ParseResult result;
     Section section = Section::Cell;
-    std::istringstream stream{std::string(text)};
-    std::string line;
-    std::size_t line_number = 0;
-    bool saw_content = false;
-
-    while (std::getline(stream, line)) {
-        ++line_number;
-        const std::string trimmed = trim(line);
-        if (trimmed.empty()) {
-            if (saw_content) {
-                if (section == Section::Cell) {
-                    section = Section::Surface;
-                } else if (section == Section::Surface) {
-                    section = Section::Data;
+    bool sawContent = false;
+    std::size_t baseOffset = 0;  // 片段在主输入中的起始偏移（并行分块与增量重解析）
+    bool recordXref = false;  // 组装卡片时顺带登记交叉引用
+    XrefBuilder xref;
+    std::vector<std::filesystem::path> includeStack;  // 用于检测循环包含
+    IncludeCache includes;                            // 每次解析独立，文件修改后重新读取
+};
+
+MCNPParser::MCNPParser(ParserOptions options) : options_(std::move(options)) {}
+
+void MCNPParser::parseInto(std::string_view text, std::uint32_t source, const std::filesystem::path& baseDirectory,
+                           bool hasTitle, Context& context) const {
+    // 提前把被包含文件交给线程池映射
+    for (const std::string_view file : scan_read_files(text)) {
+        if (!file.empty()) {
+            context.includes.prefetch(baseDirectory / std::filesystem::path(file));
+        }
+    }
+    if (context.recordXref) {
+        context.xref.reserve(text.size());
+    }
+    CardAssembler assembler(text);
+    if (hasTitle) {
+        parse_header(assembler, text, source, context.result.ast);
+    }
+    parseBody(assembler, text, source, baseDirectory, context);
+}
+
+void MCNPParser::parseBody(CardAssembler& assembler, std::string_view text, std::uint32_t source,
+                           const std::filesystem::path& baseDirectory, Context& context) const {
+    Ast& ast = context.result.ast;
+    const std::string sourceName(ast.sourceName(source));
+    // 被包含文件的偏移相对于该文件本身
+    const std::size_t base = source == 0 ? context.baseOffset : 0;
+
+    LogicalCard card;
+    LogicalCard lookahead;
+    bool haveLookahead = false;
+    auto next_card = [&](LogicalCard& out) {
+        if (haveLookahead) {
+            std::swap(out, lookahead);
+            haveLookahead = false;
+            return true;
+        }
+        return assembler.next(out);
+    };
+
+    while (next_card(card)) {
+        if (card.type == LogicalCard::Type::Blank) {
+            if (context.sawContent) {
+                if (context.section == Section::Cell) {
+                    context.section = Section::Surface;
+                } else if (context.section == Section::Surface) {
+                    context.section = Section::Data;
                 }
-                saw_content = false;
+                context.sawContent = false;
             }
             continue;
         }
 
-        saw_content = true;
-        if (is_comment_line(trimmed)) {
-            CardInfo info;
-            info.kind = CardKind::Comment;
-            info.line = line_number;
-            info.raw = line;
-            info.keyword = "comment";
-            append_card(result.ast, std::move(info));
+        context.sawContent = true;
+        if (card.type == LogicalCard::Type::Comment) {
+            ast.addCard(CardKind::Comment, card.line, "comment", card.raw, source, base + card.offset);
             continue;
         }
 
-        auto tokens = split_tokens(trimmed);
-        if (tokens.empty()) {
+        // 只有续行符的卡片（如单独一行 &）没有关键字
+        if (card.tokens.empty()) {
+            context.result.errors.push_back({card.line, "card has no keyword", sourceName});
             continue;
         }
+        const std::string_view keyword = card.tokens.front().text;
 
-        CardInfo info;
-        info.kind = kind_for_section(section);
-        info.line = line_number;
-        info.keyword = tokens.front();
-        info.raw = line;
-        info.parameters.assign(tokens.begin() + 1, tokens.end());
+        if (equals_ci(keyword, "read")) {
+            ast.addCard(CardKind::Include, card.line, keyword, card.raw, source, base + card.offset);
+            add_tokens(ast, card.tokens, 1);
+            const std::string_view file = read_file_argument(card.tokens);
+            if (file.empty()) {
+                context.result.errors.push_back({card.line, "READ card without FILE=", sourceName});
+                continue;
+            }
+            const std::filesystem::path path = baseDirectory / std::filesystem::path(file);
+            std::error_code ec;
+            const std::filesystem::path canonical = std::filesystem::weakly_canonical(path, ec);
+            const auto& stack = context.includeStack;
+            if (std::find(stack.begin(), stack.end(), canonical) != stack.end()) {
+                context.result.errors.push_back({card.line, "recursive READ of " + path.string(), sourceName});
+                continue;
+            }
+            if (stack.size() >= options_.maxIncludeDepth) {
+                context.result.errors.push_back({card.line, "READ nesting too deep: " + path.string(), sourceName});
+                continue;
+            }
+            const auto included = context.includes.get(path);
+            if (!included->error.empty()) {
+                context.result.errors.push_back({card.line, included->error, sourceName});
+                continue;
+            }
+            context.includeStack.push_back(canonical);
+            const std::uint32_t includedSource = ast.addSource(path.string());
+            ast.retainSource(includedSource, included);
+            parseInto(included->text(), includedSource, path.parent_path(), false, context);
+            context.includeStack.pop_back();
+            continue;
+        }
 
-        AstNode* card_node = append_card(result.ast, info);
-        for (const auto& param : info.parameters) {
-            card_node->children.push_back(std::make_unique<AstNode>(NodeKind::Parameter, param));
+        // 纵向格式：# 开头的表头，之后每行首个词元为整数，每一列生成一张卡
+        if (context.section == Section::Data && keyword.front() == '#') {
+            std::vector<std::string_view> names;
+            std::vector<Token> header(card.tokens.begin() + (keyword.size() == 1 ? 1 : 0), card.tokens.end());
+            if (keyword.size() > 1) {
+                header.front().text.remove_prefix(1);
+            }
+            std::vector<std::vector<Token>> columns(header.size());
+            const std::size_t begin = card.offset;
+            std::size_t end = card.offset + card.raw.size();
+            while (next_card(lookahead)) {
+                if (lookahead.type == LogicalCard::Type::Comment) {
+                    continue;
+                }
+                if (lookahead.type != LogicalCard::Type::Card || lookahead.tokens.empty() ||
+                    !is_integer(lookahead.tokens.front().text)) {
+                    haveLookahead = true;
+                    break;
+                }
+                for (std::size_t c = 0; c < columns.size() && c + 1 < lookahead.tokens.size(); ++c) {
+                    columns[c].push_back(lookahead.tokens[c + 1]);
+                }
+                if (lookahead.tokens.size() != header.size() + 1) {
+                    context.result.errors.push_back(
+                        {lookahead.line, "vertical format row does not match header", sourceName});
+                }
+                end = lookahead.offset + lookahead.raw.size();
+            }
+            const std::string_view raw = text.substr(begin, end - begin);
+            for (std::size_t c = 0; c < header.size(); ++c) {
+                const std::size_t index =
+                    ast.addCard(CardKind::Data, header[c].line, header[c].text, raw, source, base + begin);
+                add_tokens(ast, columns[c], 0);
+                if (context.recordXref) {
+                    context.xref.record(ast, index);
+                }
+            }
+            continue;
+        }
+
+        const std::size_t index =
+            ast.addCard(kind_for_section(context.section), card.line, keyword, card.raw, source, base + card.offset);
+        add_tokens(ast, card.tokens, 1);
+        if (context.recordXref) {
+            context.xref.record(ast, index);
         }
     }
+}
 
-    return result;
+ParseResult MCNPParser::parse(std::string_view text) const {
+    return parse(std::make_shared<const std::string>(text));
+}
+
+ParseResult MCNPParser::parse(std::shared_ptr<const std::string> text) const {
+    const std::string_view view = *text;
+    Context context;
+    context.recordXref = options_.crossReference;
+    if (use_parallel(options_, view)) {
+        parseParallel(view, context);
+    } else {
+        parseInto(view, 0, options_.baseDirectory, options_.hasTitleCard, context);
+    }
+    context.result.ast.retainSource(0, std::move(text));
+    return finish(context);
+}
+
+ParseResult MCNPParser::finish(Context& context) const {
+    if (context.recordXref) {
+        context.result.xref = context.xref.finish();
+    }
+    return std::move(context.result);
+}
+
+void MCNPParser::parseParallel(std::string_view text, Context& context) const {
+    CardAssembler assembler(text);
+    if (options_.hasTitleCard) {
+        parse_header(assembler, text, 0, context.result.ast);
+    }
+    const std::vector<BodyChunk> chunks =
+        split_body(text, assembler.position(), assembler.nextLineNumber(), std::max<std::size_t>(1, options_.chunkBytes));
+
+    std::vector<Context> parts(chunks.size());
+    auto& pool = options_.pool ? *options_.pool : core::ThreadPool::shared();
+    pool.parallelFor(chunks.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            const BodyChunk& chunk = chunks[i];
+            const std::string_view slice = text.substr(chunk.begin, chunk.end - chunk.begin);
+            parts[i].section = chunk.section;
+            parts[i].sawContent = chunk.sawContent;
+            parts[i].baseOffset = chunk.begin;
+            parts[i].recordXref = context.recordXref;
+            if (parts[i].recordXref) {
+                parts[i].xref.reserve(slice.size());
+            }
+            CardAssembler chunkAssembler(slice, chunk.line);
+            parseBody(chunkAssembler, slice, 0, options_.baseDirectory, parts[i]);
+        }
+    });
+
+    // 按块顺序合并，结果与串行解析逐卡一致；各块登记的卡片下标加上之前的卡片数
+    std::size_t cards = context.result.ast.cardCount();
+    std::size_t parameters = context.result.ast.parameters().size();
+    for (const Context& part : parts) {
+        cards += part.result.ast.cardCount();
+        parameters += part.result.ast.parameters().size();
+    }
+    context.result.ast.reserve(cards, parameters);
+    for (Context& part : parts) {
+        const auto base = static_cast<std::uint32_t>(context.result.ast.cardCount());
+        context.result.ast.append(std::move(part.result.ast));
+        std::move(part.result.errors.begin(), part.result.errors.end(), std::back_inserter(context.result.errors));
+        context.xref.append(std::move(part.xref), base);
+    }
+}
+
+ParseResult MCNPParser::parseFragment(std::string_view text, CardKind block, std::size_t firstLine,
+                                      std::size_t baseOffset) const {
+    Context context;
+    context.section = block == CardKind::Surface ? Section::Surface
+                      : block == CardKind::Data  ? Section::Data
+                                                 : Section::Cell;
+    context.sawContent = true;
+    context.baseOffset = baseOffset;
+    CardAssembler assembler(text, firstLine);
+    parseBody(assembler, text, 0, options_.baseDirectory, context);
+    return std::move(context.result);
+}
+
+ParseResult MCNPParser::parseFile(const std::filesystem::path& path) const {
+    auto file = std::make_shared<MappedFile>();
+    std::string error;
+    if (!file->open(path, &error)) {
+        ParseResult result;
+        result.errors.push_back({0, error, path.string()});
+        return result;
+    }
+    Context context;
+    context.recordXref = options_.crossReference;
+    if (use_parallel(options_, file->view())) {
+        parseParallel(file->view(), context);
+    } else {
+        std::error_code ec;
+        context.includeStack.push_back(std::filesystem::weakly_canonical(path, ec));
+        parseInto(file->view(), 0, path.parent_path(), options_.hasTitleCard, context);
+    }
+    context.result.ast.retainSource(0, std::move(file));
+    return finish(context);
 }
 
 } // namespace mcnp::parser
@@ -1,20 +1,31 @@
 #ifndef MCNP_PARSER_H
 #define MCNP_PARSER_H
 
+#include "cross_reference.h"
 #include "input_ast.h"
+#include "thread_pool.h"
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <string>
 #include <string_view>
 #include <vector>
 
 namespace mcnp::parser {
 
+class CardAssembler;
+
 struct ParseError {
     std::size_t line = 0;
     std::string message;
+    std::string source;  // 出错的文件；空表示主输入
 };
 
+// 解析结果；驻留字符串位于 ast 持有的 arena 中，卡片的原始文本引用 ast 保管的输入，随结果一起释放
 struct ParseResult {
     Ast ast;
     std::vector<ParseError> errors;
+    CrossReference xref;  // ParserOptions::crossReference 为真时建立
 };
 
 class InputParser {
@@ -23,9 +34,47 @@ public:
     virtual ParseResult parse(std::string_view text) const = 0;
 };
 
+struct ParserOptions {
+    bool hasTitleCard = true;             // 首行（或 message 块之后的首行）为标题卡
+    std::filesystem::path baseDirectory;  // READ FILE= 相对路径的基准目录
+    std::size_t maxIncludeDepth = 16;
+
+    // 超过 parallelThreshold 字节且不含 READ 的输入按 chunkBytes 分块并行解析
+    bool parallel = true;
+    std::size_t parallelThreshold = 1 << 20;
+    std::size_t chunkBytes = 256 * 1024;
+    mcnp::core::ThreadPool* pool = nullptr;  // 为空时使用共享线程池
+
+    bool crossReference = false;  // 组装卡片时登记编号，解析结束时建立交叉引用索引（ParseResult::xref）
+};
+
 class MCNPParser final : public InputParser {
 public:
+    explicit MCNPParser(ParserOptions options = {});
+    // 调用方的缓冲区不归结果所有：输入整体复制一次，卡片的原始文本引用这份副本
     ParseResult parse(std::string_view text) const override;
+    // 结果共同持有 text，不复制
+    ParseResult parse(std::shared_ptr<const std::string> text) const;
+    // 内存映射读取卡片文件，结果持有映射，不复制文件内容；READ 相对路径以该文件所在目录为基准
+    ParseResult parseFile(const std::filesystem::path& path) const;
+    // 解析某一块内不跨空行的卡片片段，供增量重解析使用；block 为 Cell/Surface/Data，
+    // 行号从 firstLine、偏移从 baseOffset 起算。卡片的原始文本引用 text，由调用方保证其存活
+    ParseResult parseFragment(std::string_view text, CardKind block, std::size_t firstLine,
+                              std::size_t baseOffset) const;
+
+    const ParserOptions& options() const noexcept { return options_; }
+
+private:
+    struct Context;
+    void parseInto(std::string_view text, std::uint32_t source, const std::filesystem::path& baseDirectory,
+                   bool hasTitle, Context& context) const;
+    void parseBody(CardAssembler& assembler, std::string_view text, std::uint32_t source,
+                   const std::filesystem::path& baseDirectory, Context& context) const;
+    void parseParallel(std::string_view text, Context& context) const;
+    // 由解析时登记的出现位置建交叉引用索引（按选项），交出解析结果
+    ParseResult finish(Context& context) const;
+
+    ParserOptions options_;
 };
 
 } // namespace mcnp::parser
@@ -0,0 +1,1144 @@
+#include "mcnp_writer.h"
+#include "cell_bounds.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <optional>
+#include <unordered_set>
+
+namespace mcnp::parser {
+
+namespace {
+
+using mcnp::core::CsgDag;
+using mcnp::core::CsgNode;
+using mcnp::core::CsgOp;
+using mcnp::core::Quadric;
+using mcnp::core::SurfaceTable;
+using mcnp::core::SurfaceTransform;
+using NodeId = CsgDag::NodeId;
+
+constexpr char kAxes[] = "xyz";
+
+std::uint64_t mix(std::uint64_t h, std::uint64_t v) {
+    h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+    return h * 0xff51afd7ed558ccdull;
+}
+
+std::string_view format(double value, char (&buffer)[32]) {
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value == 0.0 ? 0.0 : value);
+    return {buffer, static_cast<std::size_t>(result.ptr - buffer)};
+}
+
+std::string_view format(long long value, char (&buffer)[32]) {
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    return {buffer, static_cast<std::size_t>(result.ptr - buffer)};
+}
+
+bool near(double a, double b, double eps) {
+    return std::abs(a - b) <= eps * std::max({1.0, std::abs(a), std::abs(b)});
+}
+
+bool is_zero(double v, double eps) {
+    return std::abs(v) <= eps;
+}
+
+// 单位向量与某坐标轴（不计方向）平行时返回轴号
+int aligned_axis(const glm::dvec3& v, double eps) {
+    for (int i = 0; i < 3; ++i) {
+        if (near(std::abs(v[i]), 1.0, eps) && is_zero(v[(i + 1) % 3], eps) && is_zero(v[(i + 2) % 3], eps)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// 以 origin 为原点、axis 为 z' 轴的 TR 变换
+SurfaceTransform frame(const glm::dvec3& origin, const glm::dvec3& axis) {
+    const glm::dvec3 z = glm::normalize(axis);
+    const glm::dvec3 helper = std::abs(z.x) < 0.9 ? glm::dvec3(1.0, 0.0, 0.0) : glm::dvec3(0.0, 1.0, 0.0);
+    const glm::dvec3 x = glm::normalize(glm::cross(helper, z));
+    SurfaceTransform transform;
+    transform.rotation = glm::dmat3(x, glm::cross(z, x), z);
+    transform.origin = origin;
+    return transform;
+}
+
+glm::dmat3 quadratic_matrix(const Quadric& q) {
+    glm::dmat3 a(0.0);
+    a[0][0] = q.c[SurfaceTable::A];
+    a[1][1] = q.c[SurfaceTable::B];
+    a[2][2] = q.c[SurfaceTable::C];
+    a[0][1] = a[1][0] = 0.5 * q.c[SurfaceTable::D];
+    a[1][2] = a[2][1] = 0.5 * q.c[SurfaceTable::E];
+    a[0][2] = a[2][0] = 0.5 * q.c[SurfaceTable::F];
+    return a;
+}
+
+double quadratic_scale(const Quadric& q) {
+    double scale = 0.0;
+    for (int i = SurfaceTable::A; i <= SurfaceTable::F; ++i) {
+        scale = std::max(scale, std::abs(q.c[i]));
+    }
+    return scale;
+}
+
+glm::dvec3 linear_part(const Quadric& q) {
+    return {q.c[SurfaceTable::G], q.c[SurfaceTable::H], q.c[SurfaceTable::J]};
+}
+
+// 二次项相对一次项可忽略时按平面处理
+bool is_planar(const Quadric& q) {
+    const double quad = quadratic_scale(q);
+    return quad == 0.0 || quad <= 1e-14 * glm::length(linear_part(q));
+}
+
+// 按系数识别最简助记符；识别不出的二次曲面写成 SQ 或 GQ
+SurfaceCard describe(const SurfaceTable& table, std::size_t row, double eps) {
+    if (const SurfaceTable::Torus* torus = table.torus(row)) {
+        const std::vector<double> shape{torus->major, torus->axial, torus->radial};
+        const int axis = aligned_axis(torus->axis, eps);
+        if (axis >= 0) {
+            SurfaceCard card{std::string("t") + kAxes[axis], {torus->center.x, torus->center.y, torus->center.z}, {}};
+            card.values.insert(card.values.end(), shape.begin(), shape.end());
+            return card;
+        }
+        SurfaceCard card{"tz", {0.0, 0.0, 0.0}, frame(torus->center, torus->axis)};
+        card.values.insert(card.values.end(), shape.begin(), shape.end());
+        return card;
+    }
+
+    const Quadric raw = table.quadric(row);
+    if (is_planar(raw)) {
+        const glm::dvec3 linear = linear_part(raw);
+        const double length = glm::length(linear);
+        const glm::dvec3 n = linear / length;
+        const double d = -raw.c[SurfaceTable::K] / length;
+        const int axis = aligned_axis(n, eps);
+        if (axis >= 0) {
+            return {std::string("p") + kAxes[axis], {d / n[axis]}, {}};
+        }
+        return {"p", {n.x, n.y, n.z, d}, {}};
+    }
+
+    Quadric q = raw;
+    const double scale = quadratic_scale(raw);
+    for (double& c : q.c) {
+        c /= scale;
+    }
+    const SurfaceTable::ConeSheet* sheet = table.coneSheet(row);
+    const glm::dvec3 diagonal(q.c[SurfaceTable::A], q.c[SurfaceTable::B], q.c[SurfaceTable::C]);
+    const glm::dvec3 linear = linear_part(q);
+    const double k = q.c[SurfaceTable::K];
+    const bool crossFree =
+        is_zero(q.c[SurfaceTable::D], eps) && is_zero(q.c[SurfaceTable::E], eps) && is_zero(q.c[SurfaceTable::F], eps);
+
+    if (crossFree) {
+        if (near(diagonal.x, diagonal.y, eps) && near(diagonal.y, diagonal.z, eps)) {
+            const glm::dvec3 center = -linear / (2.0 * diagonal.x);
+            const double r2 = glm::dot(center, center) - k / diagonal.x;
+            if (r2 > 0.0) {
+                const double r = std::sqrt(r2);
+                int nonzero = 0;
+                int axis = 0;
+                for (int i = 0; i < 3; ++i) {
+                    if (!is_zero(center[i], eps)) {
+                        ++nonzero;
+                        axis = i;
+                    }
+                }
+                if (nonzero == 0) {
+                    return {"so", {r}, {}};
+                }
+                if (nonzero == 1) {
+                    return {std::string("s") + kAxes[axis], {center[axis], r}, {}};
+                }
+                return {"s", {center.x, center.y, center.z, r}, {}};
+            }
+        }
+        for (int i = 0; i < 3; ++i) {
+            const int j = i == 0 ? 1 : 0;  // C/X: y z；C/Y: x z；C/Z: x y
+            const int l = 3 - i - j;
+            const double a = diagonal[j];
+            if (!near(a, diagonal[l], eps) || is_zero(a, eps)) {
+                continue;
+            }
+            const double pj = -linear[j] / (2.0 * a);
+            const double pl = -linear[l] / (2.0 * a);
+            const bool onAxis = is_zero(pj, eps) && is_zero(pl, eps);
+            if (is_zero(diagonal[i], eps) && is_zero(linear[i], eps)) {
+                const double r2 = pj * pj + pl * pl - k / a;
+                if (r2 > 0.0) {
+                    if (onAxis) {
+                        return {std::string("c") + kAxes[i], {std::sqrt(r2)}, {}};
+                    }
+                    return {std::string("c/") + kAxes[i], {pj, pl, std::sqrt(r2)}, {}};
+                }
+            } else if (diagonal[i] / a < 0.0) {
+                const double t2 = -diagonal[i] / a;
+                glm::dvec3 apex;
+                apex[i] = -linear[i] / (2.0 * diagonal[i]);
+                apex[j] = pj;
+                apex[l] = pl;
+                const double residual = k - a * (pj * pj + pl * pl) - diagonal[i] * apex[i] * apex[i];
+                if (is_zero(residual / std::max(1.0, std::abs(k)), eps * 1e3)) {
+                    SurfaceCard card = onAxis ? SurfaceCard{std::string("k") + kAxes[i], {apex[i], t2}, {}}
+                                              : SurfaceCard{std::string("k/") + kAxes[i], {apex.x, apex.y, apex.z, t2}, {}};
+                    if (sheet) {
+                        card.values.push_back(sheet->axis[i] > 0.0 ? 1.0 : -1.0);
+                    }
+                    return card;
+                }
+            }
+        }
+        if (!sheet) {
+            return {"sq",
+                    {diagonal.x, diagonal.y, diagonal.z, linear.x / 2.0, linear.y / 2.0, linear.z / 2.0, k, 0.0, 0.0, 0.0},
+                    {}};
+        }
+    }
+
+    if (sheet) {
+        // 斜置的单叶锥：在以锥轴为 z' 的局部坐标系中写 K/Z
+        const glm::dvec3 axis = glm::normalize(sheet->axis);
+        const glm::dmat3 a = quadratic_matrix(q);
+        const SurfaceTransform transform = frame(sheet->apex, axis);
+        const glm::dvec3 across = transform.rotation[0];
+        const double t2 = -glm::dot(axis, a * axis) / glm::dot(across, a * across);
+        return {"k/z", {0.0, 0.0, 0.0, t2, 1.0}, transform};
+    }
+    return {"gq", std::vector<double>(q.c.begin(), q.c.end()), {}};
+}
+
+// 仿射变换 x_local = M⁻¹ x 下的二次曲面：q_world(x) = q_local(L x + t)
+Quadric affine(const Quadric& local, const glm::dmat4& matrix) {
+    const glm::dmat4 inverse = glm::inverse(matrix);
+    const glm::dmat3 l(inverse);
+    const glm::dvec3 t(inverse[3]);
+    const glm::dmat3 a = quadratic_matrix(local);
+    const glm::dvec3 b = linear_part(local);
+    const glm::dmat3 aw = glm::transpose(l) * a * l;
+    const glm::dvec3 bw = glm::transpose(l) * (2.0 * (a * t) + b);
+    Quadric world;
+    world.c[SurfaceTable::A] = aw[0][0];
+    world.c[SurfaceTable::B] = aw[1][1];
+    world.c[SurfaceTable::C] = aw[2][2];
+    world.c[SurfaceTable::D] = aw[0][1] + aw[1][0];
+    world.c[SurfaceTable::E] = aw[1][2] + aw[2][1];
+    world.c[SurfaceTable::F] = aw[0][2] + aw[2][0];
+    world.c[SurfaceTable::G] = bw.x;
+    world.c[SurfaceTable::H] = bw.y;
+    world.c[SurfaceTable::J] = bw.z;
+    world.c[SurfaceTable::K] = glm::dot(t, a * t) + glm::dot(b, t) + local.c[SurfaceTable::K];
+    return world;
+}
+
+} // namespace
+
+CardWriter::CardWriter(std::ostream& out, DeckWriterOptions options) : out_(out), options_(options) {
+    buffer_.reserve(options_.bufferSize + options_.lineWidth * 2);
+}
+
+CardWriter::~CardWriter() {
+    flush();
+}
+
+void CardWriter::newline() {
+    buffer_ += '\n';
+    ++lines_;
+    column_ = 0;
+    if (buffer_.size() >= options_.bufferSize) {
+        bytes_ += buffer_.size();
+        out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        buffer_.clear();
+    }
+}
+
+void CardWriter::put(std::string_view token) {
+    if (column_ > 0) {
+        if (column_ + 1 + token.size() > options_.lineWidth) {
+            newline();
+            buffer_.append(5, ' ');
+            column_ = 5;
+        } else {
+            buffer_ += ' ';
+            ++column_;
+        }
+    }
+    buffer_ += token;
+    column_ += token.size();
+}
+
+void CardWriter::line(std::string_view text) {
+    end();
+    buffer_ += text;
+    newline();
+}
+
+void CardWriter::comment(std::string_view text) {
+    end();
+    buffer_ += "c ";
+    buffer_ += text;
+    newline();
+}
+
+void CardWriter::blank() {
+    end();
+    newline();
+}
+
+void CardWriter::begin(std::string_view name) {
+    end();
+    open_ = true;
+    put(name);
+}
+
+void CardWriter::field(std::string_view token) {
+    put(token);
+}
+
+void CardWriter::field(int value) {
+    char buffer[32];
+    put(format(static_cast<long long>(value), buffer));
+}
+
+void CardWriter::field(double value) {
+    char buffer[32];
+    put(format(value, buffer));
+}
+
+void CardWriter::numbers(std::span<const double> values) {
+    char buffer[32];
+    std::size_t i = 0;
+    while (i < values.size()) {
+        field(values[i]);
+        if (!options_.compressRuns) {
+            ++i;
+            continue;
+        }
+        std::size_t j = i + 1;
+        while (j < values.size() && values[j] == values[i]) {
+            ++j;
+        }
+        if (j - i - 1 >= 2) {
+            std::string_view count = format(static_cast<long long>(j - i - 1), buffer);
+            put(std::string(count) + "r");
+            i = j;
+            continue;
+        }
+        // 等差段 a nI b：中间至少两个值才比直接写出更短
+        std::size_t k = i + 1;
+        const double step = k < values.size() ? values[k] - values[i] : 0.0;
+        if (step != 0.0) {
+            while (k + 1 < values.size()) {
+                const double expected = values[i] + step * static_cast<double>(k + 1 - i);
+                const double scale = std::max(std::abs(values[k + 1]), std::abs(values[i]));
+                if (std::abs(values[k + 1] - expected) > options_.tolerance * scale) {
+                    break;
+                }
+                ++k;
+            }
+        }
+        if (step != 0.0 && k - i - 1 >= 2) {
+            std::string_view count = format(static_cast<long long>(k - i - 1), buffer);
+            put(std::string(count) + "i");
+            i = k;
+        } else {
+            ++i;
+        }
+    }
+}
+
+void CardWriter::end() {
+    if (open_) {
+        open_ = false;
+        newline();
+    }
+}
+
+void CardWriter::card(std::string_view text) {
+    // 注释卡不能折行
+    if (text == "c" || text == "C" || text.starts_with("c ") || text.starts_with("C ")) {
+        line(text);
+        return;
+    }
+    std::size_t pos = 0;
+    bool first = true;
+    while (pos < text.size()) {
+        while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) {
+            ++pos;
+        }
+        const std::size_t start = pos;
+        while (pos < text.size() && !std::isspace(static_cast<unsigned char>(text[pos]))) {
+            ++pos;
+        }
+        if (pos > start) {
+            first ? begin(text.substr(start, pos - start)) : field(text.substr(start, pos - start));
+            first = false;
+        }
+    }
+    end();
+}
+
+void CardWriter::card(const CardView& view) {
+    switch (view.kind()) {
+        case CardKind::Title:
+        case CardKind::Comment:
+        case CardKind::Message: {
+            std::string_view raw = view.raw();
+            while (!raw.empty() && (raw.back() == '\n' || raw.back() == '\r')) {
+                raw.remove_suffix(1);
+            }
+            line(raw);
+            return;
+        }
+        default:
+            break;
+    }
+    begin(view.keyword());
+    for (std::size_t i = 0; i < view.parameterCount(); ++i) {
+        field(view.parameter(i));
+    }
+    end();
+}
+
+void CardWriter::flush() {
+    if (!buffer_.empty()) {
+        bytes_ += buffer_.size();
+        out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        buffer_.clear();
+    }
+    out_.flush();
+}
+
+SurfaceDeduplicator::Entry SurfaceDeduplicator::add(const SurfaceTable& table, std::size_t row) {
+    // 不参与合并的曲面各占一个编号
+    const bool special = table.torus(row) || table.coneSheet(row) || table.periodicPartner(table.id(row));
+    const std::uint8_t tag = static_cast<std::uint8_t>(table.boundary(row));
+
+    Coefficients c = table.quadric(row).c;
+    double scale = quadratic_scale(table.quadric(row));
+    if (is_planar(table.quadric(row))) {
+        std::fill(c.begin(), c.begin() + SurfaceTable::G, 0.0);
+        scale = glm::length(linear_part(table.quadric(row)));
+    }
+    if (scale > 0.0) {
+        for (double& v : c) {
+            v /= scale;
+        }
+    }
+    bool flipped = false;
+    for (const double v : c) {
+        if (std::abs(v) > tolerance_) {
+            flipped = v < 0.0;
+            break;
+        }
+    }
+    if (flipped) {
+        for (double& v : c) {
+            v = -v;
+        }
+    }
+
+    // 量化步长随数量级（2 的幂）放大，同一数量级内的近似值落入同一格
+    std::uint64_t key = mix(std::uint64_t{0x5f}, tag);
+    for (const double v : c) {
+        const double step = tolerance_ * std::exp2(std::ceil(std::log2(std::max(1.0, std::abs(v)))));
+        key = mix(key, static_cast<std::uint64_t>(std::llround(v / step)));
+    }
+
+    if (!special) {
+        auto& bucket = buckets_[key];
+        for (const std::size_t unique : bucket) {
+            if (tags_[unique] == tag && same(canonical_[unique], c)) {
+                return {unique, flipped};
+            }
+        }
+        bucket.push_back(representatives_.size());
+    }
+    // 代表行自身的方向作为基准
+    representatives_.push_back(row);
+    canonical_.push_back(c);
+    tags_.push_back(special ? std::uint8_t{0xff} : tag);
+    return {representatives_.size() - 1, false};
+}
+
+bool SurfaceDeduplicator::same(const Coefficients& a, const Coefficients& b) const {
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        if (!near(a[i], b[i], 2.0 * tolerance_)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+SurfaceCard describeSurface(const SurfaceTable& table, std::size_t row, double tolerance) {
+    SurfaceCard card = describe(table, row, tolerance);
+    // 相对最大值的舍入残差写成 0
+    double largest = 0.0;
+    for (const double v : card.values) {
+        largest = std::max(largest, std::abs(v));
+    }
+    for (double& v : card.values) {
+        v = std::abs(v) <= 1e-12 * largest ? 0.0 : v;
+    }
+    return card;
+}
+
+SurfaceUsage collectSurfaces(const DeckModel& model, double tolerance) {
+    const CsgDag& dag = *model.dag;
+    const SurfaceTable& table = *model.surfaces;
+    SurfaceUsage usage{SurfaceDeduplicator(tolerance), std::vector<std::int64_t>(table.size(), -1), {}, 0};
+    std::unordered_set<int> undefined;
+    std::vector<char> visited(dag.size(), 0);
+    auto register_row = [&](std::size_t row) {
+        if (usage.rowEntry[row] < 0) {
+            const SurfaceDeduplicator::Entry entry = usage.dedup.add(table, row);
+            usage.rowEntry[row] = static_cast<std::int64_t>(entry.unique * 2 + (entry.flipped ? 1 : 0));
+        }
+    };
+    // 按单元与表达式中首次出现的顺序登记，写出的曲面块与原卡片顺序相近
+    std::vector<NodeId> pending;
+    for (auto cell = model.cells.rbegin(); cell != model.cells.rend(); ++cell) {
+        if (cell->region != CsgDag::kInvalid) {
+            pending.push_back(cell->region);
+        }
+    }
+    while (!pending.empty()) {
+        const NodeId id = pending.back();
+        pending.pop_back();
+        if (visited[id]) {
+            continue;
+        }
+        visited[id] = 1;
+        const CsgNode& n = dag.node(id);
+        if (n.op != CsgOp::Halfspace) {
+            const auto children = dag.children(id);
+            pending.insert(pending.end(), children.rbegin(), children.rend());
+            continue;
+        }
+        const SurfaceTable::MacroBody* body = n.facet == 0 ? table.findMacroBody(n.surface) : nullptr;
+        if (body) {
+            for (std::uint32_t i = 0; i < body->facetCount; ++i) {
+                register_row(body->firstRow + i);
+            }
+        } else if (const auto row = table.find(n.surface, n.facet)) {
+            register_row(*row);
+        } else if (undefined.insert(n.surface).second) {
+            usage.undefined.push_back(n.surface);
+        }
+    }
+    const auto used = std::count_if(usage.rowEntry.begin(), usage.rowEntry.end(), [](std::int64_t e) { return e >= 0; });
+    usage.merged = static_cast<std::size_t>(used) - usage.dedup.size();
+    return usage;
+}
+
+std::vector<int> assignSurfaceIds(const SurfaceTable& table, const SurfaceUsage& usage, bool keepNumbers) {
+    const SurfaceDeduplicator& dedup = usage.dedup;
+    std::vector<int> outputId(dedup.size(), 0);
+    std::unordered_set<int> used(usage.undefined.begin(), usage.undefined.end());
+    int next = 1;
+    for (std::size_t row = 0; row < table.size(); ++row) {
+        next = std::max(next, table.id(row) + 1);
+    }
+    for (const int id : usage.undefined) {
+        next = std::max(next, id + 1);
+    }
+    if (keepNumbers) {
+        for (std::size_t u = 0; u < dedup.size(); ++u) {
+            const std::size_t row = dedup.representative(u);
+            if (table.facet(row) == 0 && used.insert(table.id(row)).second) {
+                outputId[u] = table.id(row);
+            }
+        }
+    } else {
+        next = 1;
+    }
+    for (std::size_t u = 0; u < dedup.size(); ++u) {
+        if (outputId[u] == 0) {
+            while (used.count(next)) {
+                ++next;
+            }
+            outputId[u] = next;
+            used.insert(next++);
+        }
+    }
+    return outputId;
+}
+
+DeckWriteStats writeDeck(std::ostream& out, const DeckModel& model, const DeckWriterOptions& options) {
+    DeckWriteStats stats;
+    const CsgDag& dag = *model.dag;
+    const SurfaceTable& table = *model.surfaces;
+    const double eps = std::max(options.tolerance, 1e-12);
+
+    // 第一遍：登记单元区域用到的曲面行并去重
+    SurfaceUsage usage = collectSurfaces(model, options.tolerance);
+    const SurfaceDeduplicator& dedup = usage.dedup;
+    const std::vector<std::int64_t>& rowEntry = usage.rowEntry;
+    for (const int id : usage.undefined) {
+        stats.warnings.push_back("surface " + std::to_string(id) + " is not defined");
+    }
+    stats.mergedSurfaces = usage.merged;
+
+    // 卡片形式与方向：写出的卡片可能与代表行差一个符号
+    std::vector<SurfaceCard> cards;
+    std::vector<char> cardFlipped(dedup.size(), 0);
+    cards.reserve(dedup.size());
+    SurfaceTable scratch;
+    for (std::size_t u = 0; u < dedup.size(); ++u) {
+        const std::size_t row = dedup.representative(u);
+        SurfaceCard card = describeSurface(table, row, eps);
+        scratch.clear();
+        if (!scratch.add(1, card.mnemonic, card.values, card.transform ? &*card.transform : nullptr)) {
+            const Quadric q = table.quadric(row);
+            card = {"gq", std::vector<double>(q.c.begin(), q.c.end()), {}};
+        } else if (!table.torus(row)) {
+            const Quadric written = scratch.quadric(0);
+            const Quadric original = table.quadric(row);
+            double dot = 0.0;
+            for (int i = 0; i < SurfaceTable::CoefficientCount; ++i) {
+                dot += written.c[i] * original.c[i];
+            }
+            cardFlipped[u] = dot < 0.0;
+        }
+        cards.push_back(std::move(card));
+    }
+
+    const std::vector<int> outputId = assignSurfaceIds(table, usage, model.keepSurfaceNumbers);
+
+    CardWriter writer(out, options);
+    char buffer[32];
+    auto halfspace_token = [&](std::size_t row, bool negative) {
+        const std::int64_t entry = rowEntry[row];
+        const std::size_t unique = static_cast<std::size_t>(entry / 2);
+        const bool flip = (entry & 1) != 0;
+        const bool minus = (negative != flip) != (cardFlipped[unique] != 0);
+        char* p = buffer;
+        if (minus) {
+            *p++ = '-';
+        }
+        const auto result = std::to_chars(p, buffer + sizeof(buffer), outputId[unique]);
+        writer.field(std::string_view(buffer, static_cast<std::size_t>(result.ptr - buffer)));
+    };
+    // 交的优先级高于并：只有交中的并需要括号
+    auto region = [&](auto&& self, NodeId id, bool inIntersection) -> void {
+        const CsgNode& n = dag.node(id);
+        switch (n.op) {
+            case CsgOp::Halfspace: {
+                const SurfaceTable::MacroBody* body = n.facet == 0 ? table.findMacroBody(n.surface) : nullptr;
+                if (body) {
+                    // 宏体内部为各面负侧的交，外部为各面正侧的并
+                    const bool parens = !n.negative && inIntersection && body->facetCount > 1;
+                    if (parens) {
+                        writer.field("(");
+                    }
+                    for (std::uint32_t i = 0; i < body->facetCount; ++i) {
+                        if (i > 0 && !n.negative) {
+                            writer.field(":");
+                        }
+                        halfspace_token(body->firstRow + i, n.negative);
+                    }
+                    if (parens) {
+                        writer.field(")");
+                    }
+                } else if (const auto row = table.find(n.surface, n.facet)) {
+                    halfspace_token(*row, n.negative);
+                } else {
+                    writer.field(std::string(n.negative ? "-" : "") + std::to_string(n.surface));
+                }
+                break;
+            }
+            case CsgOp::Intersection:
+                for (const NodeId child : dag.children(id)) {
+                    self(self, child, true);
+                }
+                break;
+            case CsgOp::Union: {
+                if (inIntersection) {
+                    writer.field("(");
+                }
+                bool first = true;
+                for (const NodeId child : dag.children(id)) {
+                    if (!first) {
+                        writer.field(":");
+                    }
+                    first = false;
+                    self(self, child, false);
+                }
+                if (inIntersection) {
+                    writer.field(")");
+                }
+                break;
+            }
+            case CsgOp::Empty:
+            case CsgOp::Universe:
+                break;
+        }
+    };
+
+    writer.line(model.title);
+    std::vector<double> importances;
+    importances.reserve(model.cells.size());
+    for (const DeckCell& cell : model.cells) {
+        const bool hasRegion = cell.region != CsgDag::kInvalid && dag.node(cell.region).op != CsgOp::Empty &&
+                               dag.node(cell.region).op != CsgOp::Universe;
+        if (!hasRegion && cell.excluded.empty()) {
+            stats.warnings.push_back("cell " + std::to_string(cell.id) + " has no bounding surfaces and was skipped");
+            continue;
+        }
+        writer.begin(std::string_view(buffer, static_cast<std::size_t>(
+                                                  std::to_chars(buffer, buffer + sizeof(buffer), cell.id).ptr - buffer)));
+        writer.field(cell.material);
+        if (cell.material != 0) {
+            writer.field(cell.density);
+        }
+        if (hasRegion) {
+            region(region, cell.region, !cell.excluded.empty());
+        }
+        for (const int excluded : cell.excluded) {
+            writer.field("#" + std::to_string(excluded));
+        }
+        if (cell.universe != 0) {
+            writer.field("u=" + std::to_string(cell.universe));
+        }
+        if (cell.fill != 0) {
+            writer.field("fill=" + std::to_string(cell.fill));
+        }
+        writer.end();
+        importances.push_back(cell.importance);
+        ++stats.cells;
+    }
+    writer.blank();
+
+    // TR 号从数据卡片中已有的最大号之后开始
+    int nextTransform = 1;
+    for (const std::string& card : model.dataCards) {
+        std::string_view text(card);
+        text.remove_prefix(std::min(text.find_first_not_of(" \t"), text.size()));
+        if (!text.empty() && text.front() == '*') {
+            text.remove_prefix(1);
+        }
+        if (text.size() > 2 && (text[0] == 't' || text[0] == 'T') && (text[1] == 'r' || text[1] == 'R')) {
+            int id = 0;
+            std::from_chars(text.data() + 2, text.data() + text.size(), id);
+            nextTransform = std::max(nextTransform, id + 1);
+        }
+    }
+    std::vector<std::pair<int, SurfaceTransform>> transforms;
+    for (std::size_t u = 0; u < dedup.size(); ++u) {
+        const std::size_t row = dedup.representative(u);
+        const SurfaceCard& card = cards[u];
+        const char* prefix = table.boundary(row) == mcnp::core::BoundaryKind::Reflecting ? "*"
+                             : table.boundary(row) == mcnp::core::BoundaryKind::White   ? "+"
+                                                                                         : "";
+        writer.begin(prefix + std::to_string(outputId[u]));
+        if (const auto partner = table.periodicPartner(table.id(row))) {
+            const auto partnerRow = table.find(*partner);
+            if (partnerRow && rowEntry[*partnerRow] >= 0) {
+                writer.field(-outputId[static_cast<std::size_t>(rowEntry[*partnerRow] / 2)]);
+            } else {
+                stats.warnings.push_back("periodic partner of surface " + std::to_string(table.id(row)) +
+                                         " is not used by any cell");
+            }
+        }
+        if (card.transform) {
+            transforms.emplace_back(nextTransform, *card.transform);
+            writer.field(nextTransform++);
+        }
+        writer.field(std::string_view(card.mnemonic));
+        for (const double v : card.values) {
+            writer.field(v);
+        }
+        writer.end();
+        ++stats.surfaces;
+    }
+    writer.blank();
+
+    if (!importances.empty()) {
+        writer.begin("imp:" + model.particles);
+        writer.numbers(importances);
+        writer.end();
+    }
+    for (const auto& [id, transform] : transforms) {
+        writer.begin("tr" + std::to_string(id));
+        for (int i = 0; i < 3; ++i) {
+            writer.field(transform.origin[i]);
+        }
+        for (int axis = 0; axis < 3; ++axis) {
+            for (int i = 0; i < 3; ++i) {
+                const double cosine = transform.rotation[axis][i];
+                writer.field(std::abs(cosine) <= 1e-12 ? 0.0 : cosine);
+            }
+        }
+        writer.end();
+    }
+    stats.transforms = transforms.size();
+    for (const std::string& card : model.dataCards) {
+        writer.card(card);
+    }
+    writer.flush();
+    stats.lines = writer.lines();
+    stats.bytes = writer.bytes();
+    return stats;
+}
+
+DeckModel buildDeckModel(const Ast& ast, const CellCompileResult& cells, const SurfaceCompileResult& surfaces,
+                         std::vector<std::string>* warnings) {
+    auto lower = [](std::string_view text) {
+        std::string out(text);
+        std::transform(out.begin(), out.end(), out.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return out;
+    };
+    auto warn = [&](std::string message) {
+        if (warnings) {
+            warnings->push_back(std::move(message));
+        }
+    };
+
+    DeckModel model;
+    model.dag = &cells.dag;
+    model.surfaces = &surfaces.table;
+    std::vector<double> imported;  // IMP 数据卡，按单元卡片顺序
+    std::string modeParticles;
+    for (std::size_t i = 0; i < ast.cardCount(); ++i) {
+        const CardView card = ast.card(i);
+        if (card.kind() == CardKind::Title) {
+            model.title = std::string(card.raw());
+            continue;
+        }
+        if (card.kind() != CardKind::Data) {
+            continue;
+        }
+        std::string keyword = lower(card.keyword());
+        const bool starred = !keyword.empty() && keyword.front() == '*';
+        const std::string_view name = std::string_view(keyword).substr(starred ? 1 : 0);
+        if (name.rfind("imp:", 0) == 0) {
+            if (imported.empty()) {
+                model.particles = std::string(name.substr(4));
+                for (const std::string& value : card.expandedParameters()) {
+                    double importance = 1.0;
+                    const auto parsed = std::from_chars(value.data(), value.data() + value.size(), importance);
+                    imported.push_back(parsed.ec == std::errc() ? importance : 1.0);
+                }
+            }
+            continue;
+        }
+        if (name.size() >= 2 && name.substr(0, 2) == "tr" &&
+            std::all_of(name.begin() + 2, name.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)); })) {
+            continue;
+        }
+        if (name == "mode") {
+            for (std::size_t k = 0; k < card.parameterCount(); ++k) {
+                modeParticles += (k ? "," : "") + lower(card.parameter(k));
+            }
+        }
+        std::string text = std::move(keyword);
+        for (std::size_t k = 0; k < card.parameterCount(); ++k) {
+            text += ' ';
+            text += card.parameter(k);
+        }
+        model.dataCards.push_back(std::move(text));
+    }
+    if (imported.empty() && !modeParticles.empty()) {
+        model.particles = modeParticles;
+    }
+    if (!imported.empty() && imported.size() != cells.cells.size()) {
+        warn("IMP card has " + std::to_string(imported.size()) + " entries for " + std::to_string(cells.cells.size()) +
+             " cells");
+    }
+
+    model.cells.reserve(cells.cells.size());
+    for (std::size_t i = 0; i < cells.cells.size(); ++i) {
+        const CompiledCell& cell = cells.cells[i];
+        DeckCell deckCell;
+        deckCell.id = cell.id;
+        deckCell.material = cell.material;
+        deckCell.density = cell.density;
+        deckCell.region = cell.region;
+        deckCell.universe = cell.universe;
+        deckCell.fill = cell.fill;
+        deckCell.importance = cell.importance.value_or(i < imported.size() ? imported[i] : 1.0);
+        model.cells.push_back(std::move(deckCell));
+    }
+    return model;
+}
+
+RenumberStats writeRenumbered(std::ostream& out, const Ast& ast, const CrossReference& xref,
+                              const Renumbering& renumbering, const DeckWriterOptions& options) {
+    static constexpr std::string_view kNames[] = {"cell", "surface", "material", "transform", "universe"};
+    const std::unordered_map<int, int>* maps[] = {&renumbering.cells, &renumbering.surfaces, &renumbering.materials,
+                                                  &renumbering.transforms, &renumbering.universes};
+    RenumberStats stats;
+
+    // 冲突检查：目标编号已被未改动的编号占用，或被多个编号共用
+    for (std::size_t kind = 0; kind < std::size(maps); ++kind) {
+        std::unordered_map<int, int> targets;
+        for (const auto& [from, to] : *maps[kind]) {
+            if (from == to) {
+                continue;
+            }
+            const auto [it, added] = targets.emplace(to, from);
+            if (!added) {
+                stats.warnings.push_back(std::string(kNames[kind]) + "s " + std::to_string(std::min(from, it->second)) +
+                                         " and " + std::to_string(std::max(from, it->second)) +
+                                         " are both renumbered to " + std::to_string(to));
+            }
+            const XrefKind k = static_cast<XrefKind>(kind);
+            const bool used = k == XrefKind::Universe
+                                  ? !xref.cellsInUniverse(to).empty() || !xref.cellsFilledWith(to).empty()
+                                  : xref.definition(k, to) != CrossReference::npos;
+            if (used && maps[kind]->count(to) == 0) {
+                stats.warnings.push_back(std::string(kNames[kind]) + " " + std::to_string(from) + " is renumbered to " +
+                                         std::to_string(to) + ", which is already in use");
+            }
+        }
+    }
+
+    CardWriter writer(out, options);
+    const std::vector<XrefOccurrence>& occurrences = xref.occurrences();
+    std::size_t next = 0;  // occurrences 按卡片顺序排列
+    int section = 0;       // 0 单元块、1 曲面块、2 数据块
+    std::string keyword;
+    std::vector<std::string> parameters;
+    char buffer[32];
+    for (std::size_t i = 0; i < ast.cardCount(); ++i) {
+        const CardView card = ast.card(i);
+        const int cardSection = card.kind() == CardKind::Surface ? 1 : card.kind() == CardKind::Data ? 2 : -1;
+        for (; cardSection > section; ++section) {
+            writer.blank();
+        }
+
+        const std::size_t first = next;
+        bool changed = false;
+        for (; next < occurrences.size() && occurrences[next].card == i; ++next) {
+            const XrefOccurrence& occurrence = occurrences[next];
+            const auto& map = *maps[static_cast<std::size_t>(occurrence.kind)];
+            const auto it = map.find(occurrence.id);
+            changed = changed || (it != map.end() && it->second != occurrence.id);
+        }
+        if (!changed) {
+            writer.card(card);
+            if (card.kind() == CardKind::Message) {
+                writer.blank();
+            }
+            continue;
+        }
+
+        // 同一词元中靠后的编号先改写，前面的位置不受影响
+        keyword.assign(card.keyword());
+        parameters.assign(card.parameterCount(), std::string());
+        for (std::size_t p = 0; p < card.parameterCount(); ++p) {
+            parameters[p].assign(card.parameter(p));
+        }
+        for (std::size_t o = next; o-- > first;) {
+            const XrefOccurrence& occurrence = occurrences[o];
+            const auto& map = *maps[static_cast<std::size_t>(occurrence.kind)];
+            const auto it = map.find(occurrence.id);
+            if (it == map.end() || it->second == occurrence.id) {
+                continue;
+            }
+            std::string& token =
+                occurrence.parameter == XrefOccurrence::kKeyword ? keyword : parameters[occurrence.parameter];
+            token.replace(occurrence.begin, occurrence.length, format(static_cast<long long>(it->second), buffer));
+            ++stats.rewritten;
+        }
+        writer.begin(keyword);
+        for (const std::string& parameter : parameters) {
+            writer.field(std::string_view(parameter));
+        }
+        writer.end();
+        ++stats.cards;
+    }
+    writer.flush();
+    stats.lines = writer.lines();
+    stats.bytes = writer.bytes();
+    return stats;
+}
+
+DeckWriteStats exportGeometry(std::ostream& out, std::span<const GeometryCell> cells, const DeckWriterOptions& options,
+                              std::string_view title) {
+    using mcnp::core::GeometryNode;
+    using mcnp::core::PrimitiveType;
+
+    CsgDag dag;
+    SurfaceTable table;
+    std::vector<std::string> warnings;
+    int nextSurface = 1;
+    auto add_surface = [&](Quadric q) {
+        // 编辑器的变换为单精度：清掉舍入噪声，轴向的平面与柱面才能识别并得到有界包围盒
+        double largest = 0.0;
+        for (int i = SurfaceTable::A; i < SurfaceTable::K; ++i) {
+            largest = std::max(largest, std::abs(q.c[i]));
+        }
+        for (int i = SurfaceTable::A; i < SurfaceTable::K; ++i) {
+            q.c[i] = std::abs(q.c[i]) <= 1e-6 * largest ? 0.0 : q.c[i];
+        }
+        const int id = nextSurface++;
+        if (is_planar(q)) {
+            const glm::dvec3 n = linear_part(q);
+            table.add(id, "p", std::vector<double>{n.x, n.y, n.z, -q.c[SurfaceTable::K]});
+        } else {
+            table.add(id, "gq", q.c);
+        }
+        return id;
+    };
+    auto inside = [&](const Quadric& local, const glm::dmat4& matrix) {
+        return dag.halfspace(add_surface(affine(local, matrix)), true);
+    };
+
+    const glm::dvec3 ex(1.0, 0.0, 0.0);
+    const glm::dvec3 ey(0.0, 1.0, 0.0);
+    const glm::dvec3 ez(0.0, 0.0, 1.0);
+    auto primitive = [&](const GeometryNode& node, const glm::dmat4& m) -> NodeId {
+        std::vector<NodeId> sides;
+        switch (node.primitive) {
+            case PrimitiveType::Sphere:
+                sides.push_back(inside(Quadric::sphere(glm::dvec3(0.0), 1.0), m));
+                break;
+            case PrimitiveType::Box:
+                for (const glm::dvec3& axis : {ex, ey, ez}) {
+                    sides.push_back(inside(Quadric::plane(axis, 0.5), m));
+                    sides.push_back(inside(Quadric::plane(-axis, 0.5), m));
+                }
+                break;
+            case PrimitiveType::Cylinder:
+                sides.push_back(inside(Quadric::cylinder(glm::dvec3(0.0), ey, 0.5), m));
+                sides.push_back(inside(Quadric::plane(ey, 0.5), m));
+                sides.push_back(inside(Quadric::plane(-ey, 0.5), m));
+                break;
+            case PrimitiveType::Cone:
+                sides.push_back(inside(Quadric::cone(glm::dvec3(0.0, 0.5, 0.0), ey, 0.25), m));
+                sides.push_back(inside(Quadric::plane(ey, 0.5), m));
+                sides.push_back(inside(Quadric::plane(-ey, 0.5), m));
+                break;
+            case PrimitiveType::Plane:
+                sides.push_back(inside(Quadric::plane(ey, 0.0), m));
+                break;
+            case PrimitiveType::Unknown:
+                warnings.push_back("node '" + node.label + "' has no primitive and was left empty");
+                return dag.empty();
+        }
+        return dag.intersection(sides);
+    };
+    auto build = [&](auto&& self, const GeometryNode& node, const glm::dmat4& parent) -> NodeId {
+        const glm::dmat4 m = parent * glm::dmat4(node.transform.toMatrix());
+        if (!node.booleanOp) {
+            return primitive(node, m);
+        }
+        std::vector<NodeId> children;
+        for (const auto& child : node.children) {
+            if (child) {
+                children.push_back(self(self, *child, m));
+            }
+        }
+        if (children.empty()) {
+            return dag.empty();
+        }
+        switch (*node.booleanOp) {
+            case mcnp::core::BooleanOperation::Union:
+                return dag.unite(children);
+            case mcnp::core::BooleanOperation::Intersection:
+                return dag.intersection(children);
+            case mcnp::core::BooleanOperation::Difference:
+                for (std::size_t i = 1; i < children.size(); ++i) {
+                    children[i] = dag.complement(children[i]);
+                }
+                return dag.intersection(children);
+        }
+        return dag.empty();
+    };
+
+    DeckModel model;
+    model.title = std::string(title);
+    model.keepSurfaceNumbers = false;
+    std::unordered_map<std::string, int> materials;
+    for (const GeometryCell& cell : cells) {
+        if (!cell.root) {
+            continue;
+        }
+        const NodeId region = build(build, *cell.root, cell.placement);
+        if (region == dag.empty()) {
+            warnings.push_back("node '" + cell.root->label + "' is empty and was not exported");
+            continue;
+        }
+        DeckCell deckCell;
+        deckCell.id = static_cast<int>(model.cells.size()) + 1;
+        deckCell.region = region;
+        if (const auto& material = cell.root->material) {
+            auto [it, added] = materials.emplace(material->name, static_cast<int>(materials.size()) + 1);
+            if (added) {
+                model.dataCards.push_back("c m" + std::to_string(it->second) + " " + material->name +
+                                          ": composition is not defined in the editor");
+                warnings.push_back("material '" + material->name + "' needs an M" + std::to_string(it->second) +
+                                   " card");
+            }
+            deckCell.material = it->second;
+            deckCell.density = material->density > 0.0 ? -material->density : -1.0;
+        }
+        model.cells.push_back(std::move(deckCell));
+    }
+
+    // 包围球：有界单元的包围盒外扩 10%；无界的单元（如平面图元）截断到球内
+    mcnp::core::CellBounds bounds(dag, table);
+    mcnp::core::Aabb world;
+    std::vector<std::size_t> unbounded;
+    for (std::size_t i = 0; i < model.cells.size(); ++i) {
+        const mcnp::core::Aabb box = bounds.bounds(model.cells[i].region);
+        if (box.isFinite()) {
+            world.expand(box);
+        } else if (!box.empty()) {
+            unbounded.push_back(i);
+        }
+    }
+    if (world.empty()) {
+        world.expand(glm::dvec3(-1.0));
+        world.expand(glm::dvec3(1.0));
+    }
+    const glm::dvec3 center = world.center();
+    const double radius = 0.55 * glm::length(world.extent()) + 1.0;
+    const int sphere = nextSurface++;
+    table.add(sphere, "s", std::vector<double>{center.x, center.y, center.z, radius});
+    for (const std::size_t i : unbounded) {
+        const std::vector<NodeId> clipped{model.cells[i].region, dag.halfspace(sphere, true)};
+        model.cells[i].region = dag.intersection(clipped);
+        warnings.push_back("cell " + std::to_string(model.cells[i].id) + " is unbounded and was clipped to the world sphere");
+    }
+
+    // 编辑器里的物体可以相互重叠：靠前的单元优先，后面的单元用 #n 扣掉包围盒与之相交的前面单元
+    std::vector<mcnp::core::Aabb> boxes;
+    boxes.reserve(model.cells.size());
+    for (DeckCell& cell : model.cells) {
+        boxes.push_back(bounds.bounds(cell.region));
+        for (std::size_t j = 0; j + 1 < boxes.size(); ++j) {
+            if (boxes.back().intersects(boxes[j])) {
+                cell.excluded.push_back(model.cells[j].id);
+            }
+        }
+    }
+
+    DeckCell voidCell;
+    voidCell.id = static_cast<int>(model.cells.size()) + 1;
+    voidCell.region = dag.halfspace(sphere, true);
+    for (const DeckCell& cell : model.cells) {
+        voidCell.excluded.push_back(cell.id);
+    }
+    DeckCell graveyard;
+    graveyard.id = voidCell.id + 1;
+    graveyard.region = dag.halfspace(sphere, false);
+    graveyard.importance = 0.0;
+    model.cells.push_back(std::move(voidCell));
+    model.cells.push_back(std::move(graveyard));
+    model.dataCards.insert(model.dataCards.begin(), "mode " + model.particles);
+
+    model.dag = &dag;
+    model.surfaces = &table;
+    DeckWriteStats stats = writeDeck(out, model, options);
+    stats.warnings.insert(stats.warnings.begin(), warnings.begin(), warnings.end());
+    return stats;
+}
+
+} // namespace mcnp::parser
@@ -0,0 +1,216 @@
+#ifndef MCNP_WRITER_H
+#define MCNP_WRITER_H
+
+#include "cell_compiler.h"
+#include "cross_reference.h"
+#include "csg_dag.h"
+#include "geometry_model.h"
+#include "input_ast.h"
+#include "surface_compiler.h"
+#include "surface_table.h"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace mcnp::parser {
+
+struct DeckWriterOptions {
+    std::size_t lineWidth = 80;        // 每行最多列数（含续行的 5 个空格缩进）
+    bool compressRuns = true;          // 数值序列压缩为 nR / nI
+    double tolerance = 1e-9;           // 曲面去重与 nI 判定的相对容差
+    std::size_t bufferSize = 1 << 16;  // 缓冲区攒够这么多字节才写入流
+};
+
+// 流式写卡片：文本先进入固定大小的缓冲区，满了就写入 ostream，不在内存中拼出整个文件。
+// 超出行宽的卡片在词边界折行，续行以 5 个空格开头。
+class CardWriter {
+public:
+    explicit CardWriter(std::ostream& out, DeckWriterOptions options = {});
+    ~CardWriter();
+
+    CardWriter(const CardWriter&) = delete;
+    CardWriter& operator=(const CardWriter&) = delete;
+
+    // 原样写一行（标题卡等）
+    void line(std::string_view text);
+    void comment(std::string_view text);
+    // 块分隔空行
+    void blank();
+
+    void begin(std::string_view name);
+    void field(std::string_view token);
+    void field(int value);
+    void field(double value);
+    // 数值序列：连续相同值写为 x nR，等差段写为 a nI b
+    void numbers(std::span<const double> values);
+    void end();
+
+    // 以空白分隔的整张卡片
+    void card(std::string_view text);
+    // AST 中的卡片：关键字与参数（保留原有简写）重新折行；标题、注释与 message 块原样写出
+    void card(const CardView& view);
+
+    void flush();
+    std::size_t lines() const noexcept { return lines_; }
+    std::size_t bytes() const noexcept { return bytes_ + buffer_.size(); }
+
+private:
+    void put(std::string_view token);
+    void newline();
+
+    std::ostream& out_;
+    DeckWriterOptions options_;
+    std::string buffer_;
+    std::size_t column_ = 0;
+    bool open_ = false;
+    std::size_t lines_ = 0;
+    std::size_t bytes_ = 0;
+};
+
+// 按系数去重的曲面登记表。系数先归一化（平面取单位法向，其余取二次项最大绝对值为 1，
+// 首个非零系数为正），再按容差量化后哈希，同一桶内逐项比较；互为相反数的曲面视为同一曲面、
+// 方向相反。边界条件不同的曲面不合并；环面、单叶锥与周期边界曲面不参与合并。
+class SurfaceDeduplicator {
+public:
+    struct Entry {
+        std::size_t unique = 0;  // 去重后的编号，从 0 连续分配
+        bool flipped = false;    // 该行与代表行方向相反
+    };
+
+    explicit SurfaceDeduplicator(double tolerance = 1e-9) : tolerance_(tolerance) {}
+
+    Entry add(const mcnp::core::SurfaceTable& table, std::size_t row);
+    std::size_t size() const noexcept { return representatives_.size(); }
+    // 首次登记该曲面的行
+    std::size_t representative(std::size_t unique) const { return representatives_[unique]; }
+
+private:
+    using Coefficients = std::array<double, mcnp::core::SurfaceTable::CoefficientCount>;
+
+    bool same(const Coefficients& a, const Coefficients& b) const;
+
+    double tolerance_;
+    std::vector<std::size_t> representatives_;
+    std::vector<Coefficients> canonical_;
+    std::vector<std::uint8_t> tags_;
+    std::unordered_map<std::uint64_t, std::vector<std::size_t>> buckets_;
+};
+
+struct DeckCell {
+    int id = 0;
+    int material = 0;
+    double density = 0.0;  // 正值为原子密度，负值为质量密度 g/cm³
+    mcnp::core::CsgDag::NodeId region = mcnp::core::CsgDag::kInvalid;
+    std::vector<int> excluded;  // 另写成 #n 的单元
+    double importance = 1.0;
+    int universe = 0;
+    int fill = 0;
+};
+
+struct DeckModel {
+    std::string title = "mcnp deck";
+    const mcnp::core::CsgDag* dag = nullptr;
+    const mcnp::core::SurfaceTable* surfaces = nullptr;
+    std::vector<DeckCell> cells;
+    std::string particles = "n";         // IMP 数据卡的粒子
+    std::vector<std::string> dataCards;  // 原样写出的其余数据卡片（MODE、材料等）
+    bool keepSurfaceNumbers = true;      // 保留原曲面号；宏体的面和号码冲突的曲面另行编号
+};
+
+struct DeckWriteStats {
+    std::size_t cells = 0;
+    std::size_t surfaces = 0;        // 写出的曲面卡片
+    std::size_t mergedSurfaces = 0;  // 与其他曲面合并掉的曲面行
+    std::size_t transforms = 0;      // 为环面、单叶锥新增的 TR 卡片
+    std::size_t lines = 0;
+    std::size_t bytes = 0;
+    std::vector<std::string> warnings;
+};
+
+// 一张曲面卡片的助记符与数值；transform 非空时需另写 TR 卡片
+struct SurfaceCard {
+    std::string mnemonic;
+    std::vector<double> values;
+    std::optional<mcnp::core::SurfaceTransform> transform;
+};
+
+// 按系数识别曲面行的最简助记符（P/PX、S/SO、C/Z、K/Z、SQ 等，环面与斜置单叶锥另带 TR），
+// 识别不出的写成 GQ；相对最大值的舍入残差写成 0
+SurfaceCard describeSurface(const mcnp::core::SurfaceTable& table, std::size_t row, double tolerance);
+
+// 单元区域用到的曲面行，按首次出现的顺序去重登记
+struct SurfaceUsage {
+    SurfaceDeduplicator dedup;
+    std::vector<std::int64_t> rowEntry;  // unique * 2 + flipped；未用到的行为 -1
+    std::vector<int> undefined;          // 被引用但未定义的曲面号
+    std::size_t merged = 0;              // 与其他曲面合并掉的行数
+};
+
+SurfaceUsage collectSurfaces(const DeckModel& model, double tolerance);
+
+// 去重后各曲面的输出编号：keepNumbers 时尽量保留原号（宏体的面与号码冲突的曲面除外），
+// 其余从最大号之后顺延；否则从 1 连续编号。引用了但未定义的曲面号不会被占用
+std::vector<int> assignSurfaceIds(const mcnp::core::SurfaceTable& table, const SurfaceUsage& usage, bool keepNumbers);
+
+// 写出完整卡片文件：先遍历全部单元区域登记用到的曲面并去重，再依次流式写出单元块、
+// 曲面块与数据块。区域按否定范式写出，宏体整体引用展开为各面的交（或补的并）；
+// 曲面按系数识别为 P/PX、S/SO、C/Z、K/Z、SQ 等最简形式，其余写成 GQ。
+DeckWriteStats writeDeck(std::ostream& out, const DeckModel& model, const DeckWriterOptions& options = {});
+
+// 编译后的卡片文件转换为写出模型（writeDeck、writeOpenMc、writeFluka、writeGdml 共用）。
+// 单元的 IMP 取单元卡片上的 IMP:（LIKE BUT 可改写），否则取 IMP 数据卡，都没有时为 1；粒子取 MODE 卡。
+// TR 已并入曲面系数、IMP 由写出器重新生成，其余数据卡片按关键字与参数（保留简写）传递。
+// 模型引用 cells 与 surfaces 中的 DAG 与曲面表，二者须比模型存活更久
+DeckModel buildDeckModel(const Ast& ast, const CellCompileResult& cells, const SurfaceCompileResult& surfaces,
+                         std::vector<std::string>* warnings = nullptr);
+
+// 重新编号的映射，未列出的编号保持不变
+struct Renumbering {
+    std::unordered_map<int, int> cells;
+    std::unordered_map<int, int> surfaces;
+    std::unordered_map<int, int> materials;
+    std::unordered_map<int, int> transforms;
+    std::unordered_map<int, int> universes;
+};
+
+struct RenumberStats {
+    std::size_t cards = 0;      // 改写过的卡片
+    std::size_t rewritten = 0;  // 改写的编号（定义与引用）
+    std::size_t lines = 0;
+    std::size_t bytes = 0;
+    std::vector<std::string> warnings;
+};
+
+// 按交叉引用索引中记录的位置一次遍历改写全部定义与引用（单元、曲面、材料、TR、宇宙，含计数卡中的
+// 单元与曲面），流式写出新的卡片文件。没有改动的卡片经 CardWriter 重新折行，块之间补空行。
+// 新编号与未改动的既有编号冲突，或多个编号映射到同一编号时给出警告，仍照映射写出。
+RenumberStats writeRenumbered(std::ostream& out, const Ast& ast, const CrossReference& xref,
+                              const Renumbering& renumbering, const DeckWriterOptions& options = {});
+
+struct GeometryCell {
+    std::shared_ptr<const mcnp::core::GeometryNode> root;
+    glm::dmat4 placement{1.0};  // 整棵树再施加的世界变换
+};
+
+// 编辑器的几何树导出为卡片文件：每棵树一个单元（子节点的 transform 相对父节点），
+// 另加包围球内的空腔单元与球外的墓地单元（IMP=0）。单位图元与 vertex_mesh 中的网格一致：
+// 球半径 1，立方体边长 1，圆柱半径 0.5、高 1 沿 y 轴，锥底半径 0.5 在 y=-0.5、顶点在 y=0.5，
+// 平面取 y<0 一侧。材料按名称编号，密度写为质量密度。相互重叠的树以靠前者为准，
+// 后面的单元以 #n 扣除前面的单元，导出的单元互不重叠。
+DeckWriteStats exportGeometry(std::ostream& out, std::span<const GeometryCell> cells,
+                              const DeckWriterOptions& options = {}, std::string_view title = "exported geometry");
+
+} // namespace mcnp::parser
+
+#endif // MCNP_WRITER_H
@@ -0,0 +1,560 @@
+#include "mctal_reader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <string_view>
+
+namespace mcnp::parser {
+
+namespace {
+
+constexpr std::size_t kPairWidth = 20;            // 1PE13.5 + 0PF7.4
+constexpr std::size_t kPairsPerLine = 4;
+constexpr std::size_t kParallelBytes = 4 << 20;   // 数值区超过该大小时分块并行解码
+constexpr std::size_t kChunkBytes = 1 << 20;
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+bool is_letter(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+// 按行读取映射的文本，行不含换行符与行尾 '\r'
+class Lines {
+public:
+    explicit Lines(std::string_view text, std::size_t position = 0) : text_(text), position_(position) {}
+
+    bool next(std::string_view& line) {
+        if (position_ >= text_.size()) {
+            return false;
+        }
+        start_ = position_;
+        const void* found = std::memchr(text_.data() + position_, '\n', text_.size() - position_);
+        const std::size_t end = found ? static_cast<const char*>(found) - text_.data() : text_.size();
+        line = text_.substr(position_, end - position_);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        position_ = found ? end + 1 : end;
+        return true;
+    }
+
+    // 下一行首字节（不消耗）
+    char peek() const { return position_ < text_.size() ? text_[position_] : '\0'; }
+    std::size_t position() const noexcept { return position_; }
+    std::size_t lineStart() const noexcept { return start_; }
+    void seek(std::size_t position) { position_ = position; }
+
+private:
+    std::string_view text_;
+    std::size_t position_;
+    std::size_t start_ = 0;
+};
+
+// 以空白分隔的下一个词元
+bool next_token(std::string_view text, std::size_t& position, std::string_view& token) {
+    while (position < text.size() && is_space(text[position])) {
+        ++position;
+    }
+    if (position >= text.size()) {
+        return false;
+    }
+    const std::size_t begin = position;
+    while (position < text.size() && !is_space(text[position])) {
+        ++position;
+    }
+    token = text.substr(begin, position - begin);
+    return true;
+}
+
+std::vector<std::string_view> split(std::string_view line) {
+    std::vector<std::string_view> tokens;
+    std::size_t position = 0;
+    std::string_view token;
+    while (next_token(line, position, token)) {
+        tokens.push_back(token);
+    }
+    return tokens;
+}
+
+template <typename T>
+bool parse_integer(std::string_view text, T& value) {
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return error == std::errc() && end == text.data() + text.size();
+}
+
+// Fortran 实数：三位指数时省略 E（1.23456-100）
+bool parse_real(std::string_view text, double& value) {
+    const char* end = text.data() + text.size();
+    const auto result = std::from_chars(text.data(), end, value);
+    if (result.ec != std::errc()) {
+        return false;
+    }
+    if (result.ptr == end) {
+        return true;
+    }
+    int exponent = 0;
+    const char* exponentBegin = result.ptr + (*result.ptr == '+' ? 1 : 0);
+    if ((*result.ptr != '-' && *result.ptr != '+') || std::from_chars(exponentBegin, end, exponent).ptr != end) {
+        return false;
+    }
+    value *= std::pow(10.0, exponent);
+    return true;
+}
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && is_space(text.front())) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && is_space(text.back())) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+int axis_of(char letter) {
+    static constexpr char kLetters[] = "fdusmcet";
+    const char* found = std::strchr(kLetters, letter | 0x20);
+    return found && *found ? static_cast<int>(found - kLetters) : -1;
+}
+
+// tfc 行的行首：先按固定格式算出的位置校验，不符时在数值区后查找。
+// 数值区只含数字、E、正负号与小数点，不会出现小写 f，memchr 可整段跳过
+std::size_t find_fluctuation(std::string_view text, std::size_t begin, std::size_t valueCount) {
+    const void* newline = std::memchr(text.data() + begin, '\n', text.size() - begin);
+    if (newline) {
+        const std::size_t lineEnd = static_cast<const char*>(newline) - text.data();
+        const std::size_t terminator = lineEnd > begin && text[lineEnd - 1] == '\r' ? 2 : 1;
+        const std::size_t full = valueCount / kPairsPerLine;
+        const std::size_t rest = valueCount % kPairsPerLine;
+        const std::size_t expected = begin + full * (kPairsPerLine * kPairWidth + terminator) +
+                                     (rest ? rest * kPairWidth + terminator : 0);
+        if (expected + 3 <= text.size() && text.compare(expected, 3, "tfc") == 0) {
+            return expected;
+        }
+    }
+    std::size_t position = begin;
+    while (position < text.size()) {
+        const void* found = std::memchr(text.data() + position, 'f', text.size() - position);
+        if (!found) {
+            break;
+        }
+        const std::size_t at = static_cast<const char*>(found) - text.data();
+        if (at >= 1 && text[at - 1] == 't' && at + 1 < text.size() && text[at + 1] == 'c' &&
+            (at == 1 || text[at - 2] == '\n')) {
+            return at - 1;
+        }
+        position = at + 1;
+    }
+    return std::string_view::npos;
+}
+
+std::vector<double> parse_list(std::string_view text) {
+    std::vector<double> values;
+    std::size_t position = 0;
+    std::string_view token;
+    double value = 0.0;
+    while (next_token(text, position, token)) {
+        values.push_back(parse_real(token, value) ? value : 0.0);
+    }
+    return values;
+}
+
+std::size_t count_tokens(std::string_view text) {
+    std::size_t count = 0;
+    bool inToken = false;
+    for (const char c : text) {
+        const bool space = is_space(c);
+        count += !space && !inToken;
+        inToken = !space;
+    }
+    return count;
+}
+
+// 数值区第 first 个词元起：偶数为值，奇数为相对误差
+bool parse_values(std::string_view text, std::size_t first, MctalTally& tally) {
+    std::size_t position = 0;
+    std::size_t index = first;
+    std::string_view token;
+    double value = 0.0;
+    while (next_token(text, position, token)) {
+        if (index / 2 >= tally.values.size() || !parse_real(token, value)) {
+            return false;
+        }
+        if (index % 2 == 0) {
+            tally.values[index / 2] = value;
+        } else {
+            tally.errors[index / 2] = static_cast<float>(value);
+        }
+        ++index;
+    }
+    return true;
+}
+
+} // namespace
+
+std::size_t MctalTally::index(const std::array<std::size_t, kTallyAxisCount>& bin) const {
+    std::size_t result = 0;
+    for (std::size_t axis = 0; axis < kTallyAxisCount; ++axis) {
+        result = result * counts[axis] + bin[axis];
+    }
+    return result;
+}
+
+std::size_t MctalTally::memoryBytes() const {
+    std::size_t bytes = sizeof(*this) + values.capacity() * sizeof(double) + errors.capacity() * sizeof(float) +
+                        fluctuation.capacity() * sizeof(MctalFluctuation);
+    for (const auto& list : bins) {
+        bytes += list.capacity() * sizeof(double);
+    }
+    return bytes;
+}
+
+struct MctalFile::State {
+    MappedFile file;
+    MctalHeader header;
+    std::vector<MctalTallyHeader> tallies;
+    bool kcode = false;
+    std::string error;
+
+    std::mutex mutex;
+    std::vector<std::weak_ptr<const MctalTally>> cache;
+    std::vector<std::shared_future<std::shared_ptr<const MctalTally>>> pending;  // 正在解码的请求
+
+    bool index();
+    bool indexTally(Lines& lines, std::string_view first);
+    std::shared_ptr<const MctalTally> decode(std::size_t index, mcnp::core::ThreadPool& pool) const;
+};
+
+bool MctalFile::State::index() {
+    const std::string_view text = file.view();
+    Lines lines(text);
+    std::string_view line;
+
+    // kod ver probid knod nps rnr
+    if (!lines.next(line)) {
+        error = "Empty MCTAL file";
+        return false;
+    }
+    const auto first = split(line);
+    if (first.size() < 5 || !parse_integer(first[first.size() - 3], header.dumps) ||
+        !parse_integer(first[first.size() - 2], header.nps) ||
+        !parse_integer(first[first.size() - 1], header.randomNumbers)) {
+        error = "Not an MCTAL file: bad header line";
+        return false;
+    }
+    header.code = first[0];
+    header.version = first[1];
+    for (std::size_t i = 2; i + 3 < first.size(); ++i) {
+        header.problemId += (header.problemId.empty() ? "" : " ") + std::string(first[i]);
+    }
+    if (!lines.next(line)) {
+        error = "Truncated MCTAL header";
+        return false;
+    }
+    header.title = trim(line);
+
+    // ntal n [npert m]
+    std::size_t tallyCount = 0;
+    if (!lines.next(line)) {
+        error = "Truncated MCTAL header";
+        return false;
+    }
+    const auto counts = split(line);
+    if (counts.size() < 2 || counts[0] != "ntal" || !parse_integer(counts[1], tallyCount)) {
+        error = "Missing ntal line";
+        return false;
+    }
+    if (counts.size() >= 4 && counts[2] == "npert") {
+        parse_integer(counts[3], header.perturbations);
+    }
+    while (header.tallyNumbers.size() < tallyCount && lines.next(line)) {
+        for (const std::string_view token : split(line)) {
+            int number = 0;
+            if (parse_integer(token, number)) {
+                header.tallyNumbers.push_back(number);
+            }
+        }
+    }
+    tallies.reserve(tallyCount);
+
+    while (lines.next(line)) {
+        if (line.rfind("tally", 0) == 0) {
+            if (!indexTally(lines, line)) {
+                return false;
+            }
+        } else if (line.rfind("kcode", 0) == 0) {
+            kcode = true;
+            break;
+        }
+    }
+    if (tallies.size() != tallyCount) {
+        error = "Expected " + std::to_string(tallyCount) + " tallies, found " + std::to_string(tallies.size());
+        return false;
+    }
+    cache.resize(tallies.size());
+    pending.resize(tallies.size());
+    return true;
+}
+
+bool MctalFile::State::indexTally(Lines& lines, std::string_view first) {
+    const std::string_view text = file.view();
+    MctalTallyHeader tally;
+    const auto fields = split(first);
+    if (fields.size() < 2 || !parse_integer(fields[1], tally.number)) {
+        error = "Bad tally line: " + std::string(first);
+        return false;
+    }
+    if (fields.size() >= 3) {
+        parse_integer(fields[2], tally.particle);
+    }
+    if (fields.size() >= 4) {
+        parse_integer(fields[3], tally.detectorType);
+    }
+    const std::string context = "tally " + std::to_string(tally.number) + ": ";
+    std::string_view line;
+    if (tally.particle < 0) {
+        lines.next(line);  // 粒子列表
+    }
+    // FC 注释行缩进，直到维度行
+    while (lines.peek() != '\0' && !is_letter(lines.peek()) && lines.next(line)) {
+        const std::string_view comment = trim(line);
+        if (!comment.empty()) {
+            tally.comment += (tally.comment.empty() ? "" : " ") + std::string(comment);
+        }
+    }
+
+    // 维度行：字母（可带 t/c 标志）与分档数，其后缩进的行为分档列表
+    bool sawValues = false;
+    while (lines.next(line)) {
+        if (line.rfind("vals", 0) == 0) {
+            sawValues = true;
+            break;
+        }
+        const auto tokens = split(line);
+        const int axis = tokens.empty() ? -1 : axis_of(tokens[0].front());
+        std::size_t count = 0;
+        if (axis < 0 || tokens.size() < 2 || tokens[0].size() > 2 || !parse_integer(tokens[1], count)) {
+            error = context + "unexpected line: " + std::string(line);
+            return false;
+        }
+        MctalAxis& target = tally.axes[static_cast<std::size_t>(axis)];
+        target.count = std::max<std::size_t>(count, 1);
+        target.flag = tokens[0].size() == 2 ? static_cast<char>(tokens[0][1] | 0x20) : ' ';
+        target.listBegin = lines.position();
+        while (lines.peek() != '\0' && !is_letter(lines.peek())) {
+            lines.next(line);
+        }
+        target.listEnd = lines.position();
+    }
+    if (!sawValues) {
+        error = context + "missing vals";
+        return false;
+    }
+
+    tally.valueCount = 1;
+    for (const MctalAxis& axis : tally.axes) {
+        tally.valueCount *= axis.count;
+    }
+    tally.valuesBegin = lines.position();
+    const std::size_t fluctuation = find_fluctuation(text, tally.valuesBegin, tally.valueCount);
+    if (fluctuation == std::string_view::npos) {
+        error = context + "missing tfc";
+        return false;
+    }
+    tally.valuesEnd = fluctuation;
+    tally.fluctuationBegin = fluctuation;
+
+    // tfc n jtf(8)，其后 n 行
+    lines.seek(fluctuation);
+    lines.next(line);
+    const auto header = split(line);
+    std::size_t rows = 0;
+    if (header.size() < 2 || !parse_integer(header[1], rows)) {
+        error = context + "bad tfc line";
+        return false;
+    }
+    for (std::size_t i = 0; i < rows && lines.next(line); ++i) {
+    }
+    tally.end = lines.position();
+    tallies.push_back(std::move(tally));
+    return true;
+}
+
+std::shared_ptr<const MctalTally> MctalFile::State::decode(std::size_t index, mcnp::core::ThreadPool& pool) const {
+    const std::string_view text = file.view();
+    const MctalTallyHeader& header = tallies[index];
+    auto tally = std::make_shared<MctalTally>();
+    tally->number = header.number;
+    for (std::size_t axis = 0; axis < kTallyAxisCount; ++axis) {
+        tally->counts[axis] = header.axes[axis].count;
+        const MctalAxis& source = header.axes[axis];
+        tally->bins[axis] = parse_list(text.substr(source.listBegin, source.listEnd - source.listBegin));
+    }
+    tally->values.resize(header.valueCount);
+    tally->errors.resize(header.valueCount);
+
+    // 数值区按换行切块：先并行数各块的词元数，前缀和得到起始下标，再并行解析
+    const std::string_view values = text.substr(header.valuesBegin, header.valuesEnd - header.valuesBegin);
+    std::vector<std::size_t> bounds{0};
+    if (values.size() > kParallelBytes) {
+        for (std::size_t at = kChunkBytes; at < values.size(); at += kChunkBytes) {
+            const std::size_t newline = values.find('\n', at);
+            if (newline == std::string_view::npos) {
+                break;
+            }
+            bounds.push_back(newline + 1);
+            at = newline + 1;
+        }
+    }
+    bounds.push_back(values.size());
+    const std::size_t chunks = bounds.size() - 1;
+    std::vector<std::size_t> starts(chunks + 1, 0);
+    pool.parallelFor(chunks, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t c = begin; c < end; ++c) {
+            starts[c + 1] = count_tokens(values.substr(bounds[c], bounds[c + 1] - bounds[c]));
+        }
+    });
+    for (std::size_t c = 0; c < chunks; ++c) {
+        starts[c + 1] += starts[c];
+    }
+    if (starts.back() != 2 * header.valueCount) {
+        tally->error = "tally " + std::to_string(header.number) + ": expected " +
+                       std::to_string(header.valueCount) + " values, found " + std::to_string(starts.back() / 2);
+        return tally;
+    }
+    std::vector<char> ok(chunks, 1);
+    pool.parallelFor(chunks, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t c = begin; c < end; ++c) {
+            ok[c] = parse_values(values.substr(bounds[c], bounds[c + 1] - bounds[c]), starts[c], *tally);
+        }
+    });
+    if (std::find(ok.begin(), ok.end(), 0) != ok.end()) {
+        tally->error = "tally " + std::to_string(header.number) + ": malformed value";
+        return tally;
+    }
+
+    // tfc 行之后：nps 均值 误差 FOM
+    Lines lines(text.substr(0, header.end), header.fluctuationBegin);
+    std::string_view line;
+    lines.next(line);
+    while (lines.next(line)) {
+        const auto tokens = split(line);
+        MctalFluctuation point;
+        if (tokens.size() >= 4 && parse_integer(tokens[0], point.nps) && parse_real(tokens[1], point.mean) &&
+            parse_real(tokens[2], point.error) && parse_real(tokens[3], point.fom)) {
+            tally->fluctuation.push_back(point);
+        }
+    }
+    return tally;
+}
+
+MctalFile::MctalFile() : state_(std::make_shared<State>()) {}
+
+MctalFile::~MctalFile() = default;
+
+bool MctalFile::open(const std::filesystem::path& path) {
+    close();
+    if (!state_->file.open(path, &state_->error)) {
+        return false;
+    }
+    if (!state_->index()) {
+        const std::string error = std::move(state_->error);
+        close();
+        state_->error = error;
+        return false;
+    }
+    return true;
+}
+
+void MctalFile::close() {
+    // 进行中的解码任务持有旧状态，换一份新状态即可
+    state_ = std::make_shared<State>();
+}
+
+const MctalHeader& MctalFile::header() const noexcept {
+    return state_->header;
+}
+
+const std::vector<MctalTallyHeader>& MctalFile::tallies() const noexcept {
+    return state_->tallies;
+}
+
+std::size_t MctalFile::find(int number) const {
+    const auto& tallies = state_->tallies;
+    for (std::size_t i = 0; i < tallies.size(); ++i) {
+        if (tallies[i].number == number) {
+            return i;
+        }
+    }
+    return npos;
+}
+
+bool MctalFile::hasKcode() const noexcept {
+    return state_->kcode;
+}
+
+const std::string& MctalFile::error() const noexcept {
+    return state_->error;
+}
+
+std::shared_ptr<const MctalTally> MctalFile::load(std::size_t index) const {
+    const std::shared_ptr<State> state = state_;
+    std::shared_future<std::shared_ptr<const MctalTally>> pending;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (auto cached = state->cache[index].lock()) {
+            return cached;
+        }
+        pending = state->pending[index];
+    }
+    if (pending.valid()) {
+        return pending.get();
+    }
+    std::shared_ptr<const MctalTally> tally = state->decode(index, mcnp::core::ThreadPool::shared());
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (auto cached = state->cache[index].lock()) {
+        return cached;  // 其他线程同时解码完成，沿用先缓存的一份
+    }
+    state->cache[index] = tally;
+    return tally;
+}
+
+std::shared_future<std::shared_ptr<const MctalTally>> MctalFile::request(std::size_t index,
+                                                                          mcnp::core::ThreadPool* pool) const {
+    const std::shared_ptr<State> state = state_;
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (auto cached = state->cache[index].lock()) {
+        std::promise<std::shared_ptr<const MctalTally>> ready;
+        ready.set_value(std::move(cached));
+        return ready.get_future().share();
+    }
+    if (state->pending[index].valid()) {
+        return state->pending[index];
+    }
+    auto& workers = pool ? *pool : mcnp::core::ThreadPool::shared();
+    auto future = workers
+                      .submit([state, index, &workers]() -> std::shared_ptr<const MctalTally> {
+                          std::shared_ptr<const MctalTally> tally = state->decode(index, workers);
+                          std::lock_guard<std::mutex> guard(state->mutex);
+                          state->cache[index] = tally;
+                          state->pending[index] = {};  // 结果只由调用方持有
+                          return tally;
+                      })
+                      .share();
+    state->pending[index] = future;
+    return future;
+}
+
+std::size_t MctalFile::residentTallies() const {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return static_cast<std::size_t>(std::count_if(state_->cache.begin(), state_->cache.end(),
+                                                  [](const auto& entry) { return !entry.expired(); }));
+}
+
+} // namespace mcnp::parser
@@ -0,0 +1,132 @@
+#ifndef MCTAL_READER_H
+#define MCTAL_READER_H
+
+#include "deck_tokenizer.h"
+#include "thread_pool.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mcnp::parser {
+
+// MCTAL 中计数的八个维度，按文件中的顺序；值数组中 Time 变化最快、Entity 最慢
+enum class TallyAxis : std::uint8_t {
+    Entity,      // f：单元/曲面/探测器
+    Direct,      // d：直接/散射贡献
+    User,        // u：FT/FU 用户分档
+    Segment,     // s：FS 分段
+    Multiplier,  // m：FM 乘子
+    Cosine,      // c
+    Energy,      // e
+    Time         // t
+};
+
+constexpr std::size_t kTallyAxisCount = 8;
+
+// 一个维度的头部：分档数（含总计档）与分档列表在文件中的字节区间
+struct MctalAxis {
+    std::size_t count = 1;
+    char flag = ' ';  // 't' 含总计档，'c' 为累计分档
+    std::size_t listBegin = 0;
+    std::size_t listEnd = 0;
+};
+
+// 打开文件时建立的计数索引：只含头部与各段的字节偏移，不解码数值
+struct MctalTallyHeader {
+    int number = 0;
+    int particle = 0;      // 小于 0 时另有粒子列表行
+    int detectorType = 0;
+    std::string comment;   // FC 注释
+    std::array<MctalAxis, kTallyAxisCount> axes;
+    std::size_t valueCount = 0;  // 各维度分档数之积
+    std::size_t valuesBegin = 0;  // vals 之后的数值区
+    std::size_t valuesEnd = 0;
+    std::size_t fluctuationBegin = 0;  // tfc 行
+    std::size_t end = 0;
+
+    const MctalAxis& axis(TallyAxis which) const { return axes[static_cast<std::size_t>(which)]; }
+};
+
+struct MctalFluctuation {
+    std::int64_t nps = 0;
+    double mean = 0.0;
+    double error = 0.0;
+    double fom = 0.0;
+};
+
+// 解码后的计数
+struct MctalTally {
+    int number = 0;
+    std::array<std::size_t, kTallyAxisCount> counts{};
+    // 各维度文件中列出的分档：Entity 为单元/曲面号，Cosine/Energy/Time 为分档上界（不含总计档）
+    std::array<std::vector<double>, kTallyAxisCount> bins;
+    std::vector<double> values;
+    std::vector<float> errors;  // 相对误差
+    std::vector<MctalFluctuation> fluctuation;
+    std::string error;          // 解码失败的原因；为空表示成功
+
+    // 各维度分档下标对应的值下标
+    std::size_t index(const std::array<std::size_t, kTallyAxisCount>& bin) const;
+    std::size_t memoryBytes() const;
+};
+
+struct MctalHeader {
+    std::string code;
+    std::string version;
+    std::string problemId;  // 运行日期与时间
+    int dumps = 0;
+    std::int64_t nps = 0;
+    std::int64_t randomNumbers = 0;
+    std::string title;
+    int perturbations = 0;
+    std::vector<int> tallyNumbers;
+};
+
+// 内存映射的 MCTAL 文件：打开时一遍扫描建立计数头部与数值区偏移的索引。数值区按固定的
+// 4(1PE13.5,0PF7.4) 格式直接算出长度跳过，格式不符时再按字节查找 tfc 行，不逐行读取数值。
+// 计数在首次请求时才解码（可在线程池上异步进行），解码结果只以弱引用缓存：
+// 调用方持有的计数常驻内存，不再使用的计数随之释放。
+class MctalFile {
+public:
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    MctalFile();
+    ~MctalFile();
+
+    MctalFile(const MctalFile&) = delete;
+    MctalFile& operator=(const MctalFile&) = delete;
+
+    // 失败返回 false，原因见 error()
+    bool open(const std::filesystem::path& path);
+    void close();
+
+    const MctalHeader& header() const noexcept;
+    const std::vector<MctalTallyHeader>& tallies() const noexcept;
+    // 计数号对应的索引下标；不存在返回 npos
+    std::size_t find(int number) const;
+    bool hasKcode() const noexcept;
+    const std::string& error() const noexcept;
+
+    // 同步解码（已缓存则直接返回）
+    std::shared_ptr<const MctalTally> load(std::size_t index) const;
+    // 在线程池上解码；pool 为空时使用共享线程池。同一计数的并发请求共享一次解码
+    std::shared_future<std::shared_ptr<const MctalTally>> request(std::size_t index,
+                                                                 mcnp::core::ThreadPool* pool = nullptr) const;
+    // 当前仍被持有的已解码计数
+    std::size_t residentTallies() const;
+
+private:
+    struct State;
+    std::shared_ptr<State> state_;  // 异步解码任务持有同一份状态，关闭文件不影响进行中的任务
+};
+
+} // namespace mcnp::parser
+
+#endif // MCTAL_READER_H
@@ -0,0 +1,513 @@
+#include "meshtal_reader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <string_view>
+
+namespace mcnp::parser {
+
+namespace {
+
+constexpr std::string_view kTallyMarker = "Mesh Tally Number";
+constexpr std::size_t kBlockBytes = 16 << 20;  // 每次解析后写入存储的文本量，决定解析结果的内存上限
+constexpr std::size_t kChunkBytes = 1 << 20;   // 块内并行解析的粒度
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// 按行读取映射的文本，行不含换行符与行尾 '\r'
+class Lines {
+public:
+    Lines(std::string_view text, std::size_t position) : text_(text), position_(position) {}
+
+    bool next(std::string_view& line) {
+        if (position_ >= text_.size()) {
+            return false;
+        }
+        const void* found = std::memchr(text_.data() + position_, '\n', text_.size() - position_);
+        const std::size_t end = found ? static_cast<const char*>(found) - text_.data() : text_.size();
+        line = text_.substr(position_, end - position_);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        position_ = found ? end + 1 : end;
+        return true;
+    }
+
+    std::size_t position() const noexcept { return position_; }
+
+private:
+    std::string_view text_;
+    std::size_t position_;
+};
+
+bool next_token(std::string_view text, std::size_t& position, std::string_view& token) {
+    while (position < text.size() && is_space(text[position])) {
+        ++position;
+    }
+    if (position >= text.size()) {
+        return false;
+    }
+    const std::size_t begin = position;
+    while (position < text.size() && !is_space(text[position])) {
+        ++position;
+    }
+    token = text.substr(begin, position - begin);
+    return true;
+}
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && is_space(text.front())) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && is_space(text.back())) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+bool starts_with(std::string_view text, std::string_view prefix) {
+    return text.substr(0, prefix.size()) == prefix;
+}
+
+bool parse_real(std::string_view text, double& value) {
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return error == std::errc() && end == text.data() + text.size();
+}
+
+bool is_number_start(char c) {
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.';
+}
+
+void append_list(std::string_view text, std::vector<double>& list) {
+    std::size_t position = 0;
+    std::string_view token;
+    double value = 0.0;
+    while (next_token(text, position, token)) {
+        if (parse_real(token, value)) {
+            list.push_back(value);
+        }
+    }
+}
+
+std::string_view after_colon(std::string_view line) {
+    const std::size_t colon = line.find(':');
+    return colon == std::string_view::npos ? std::string_view{} : line.substr(colon + 1);
+}
+
+// 列标题行：多词列名（Rel Error、Rslt * Vol）合为一列
+bool parse_columns(std::string_view line, MeshGeometry geometry, std::vector<MeshColumn>& columns) {
+    std::size_t position = 0;
+    std::string_view token;
+    while (next_token(line, position, token)) {
+        if (token == "Energy") {
+            columns.push_back(MeshColumn::Energy);
+        } else if (token == "Time") {
+            columns.push_back(MeshColumn::Time);
+        } else if (token == "X" || token == "R") {
+            columns.push_back(MeshColumn::Axis0);
+        } else if (token == "Y") {
+            columns.push_back(MeshColumn::Axis1);
+        } else if (token == "Z") {
+            columns.push_back(geometry == MeshGeometry::Cylindrical ? MeshColumn::Axis1 : MeshColumn::Axis2);
+        } else if (token == "Th" || token == "Theta") {
+            columns.push_back(MeshColumn::Axis2);
+        } else if (token == "Result") {
+            columns.push_back(MeshColumn::Result);
+        } else if (token == "Rel") {
+            columns.push_back(MeshColumn::Error);
+            next_token(line, position, token);  // Error
+        } else if (token == "Volume") {
+            columns.push_back(MeshColumn::Volume);
+        } else if (token == "Rslt") {
+            columns.push_back(MeshColumn::ResultVolume);
+            next_token(line, position, token);  // *
+            next_token(line, position, token);  // Vol
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 分档中心所在的档
+std::size_t cell_of(const std::vector<double>& bounds, double center) {
+    const auto above = std::upper_bound(bounds.begin(), bounds.end(), center);
+    const std::size_t cell = above == bounds.begin() ? 0 : static_cast<std::size_t>(above - bounds.begin()) - 1;
+    return std::min(cell, bounds.size() - 2);
+}
+
+// 能量/时间列给出分档上界（按输出精度比较）；Total 为最后的总计档
+bool bin_of(std::string_view token, const std::vector<double>& bounds, std::size_t channels, std::size_t& bin) {
+    if (token == "Total") {
+        bin = channels - 1;
+        return channels > 1;
+    }
+    double value = 0.0;
+    if (!parse_real(token, value)) {
+        return false;
+    }
+    if (bounds.size() < 2) {
+        bin = 0;
+        return true;
+    }
+    const double low = value - 1e-4 * std::fabs(value);
+    const auto at = std::lower_bound(bounds.begin() + 1, bounds.end(), low);
+    bin = std::min(static_cast<std::size_t>(at - bounds.begin()) - 1, bounds.size() - 2);
+    return true;
+}
+
+struct Row {
+    std::uint32_t x = 0;
+    std::uint32_t y = 0;
+    std::uint32_t z = 0;
+    std::uint32_t channel = 0;
+    float value = 0.0f;
+    float error = 0.0f;
+};
+
+bool parse_row(std::string_view line, const MeshtalTallyHeader& header, Row& row) {
+    std::size_t position = 0;
+    std::string_view token;
+    std::size_t energy = 0;
+    std::size_t time = 0;
+    std::array<std::size_t, 3> at{};
+    double number = 0.0;
+    for (const MeshColumn column : header.columns) {
+        if (!next_token(line, position, token)) {
+            return false;
+        }
+        switch (column) {
+        case MeshColumn::Energy:
+            if (!bin_of(token, header.energyBounds, header.energyChannels(), energy)) {
+                return false;
+            }
+            break;
+        case MeshColumn::Time:
+            if (!bin_of(token, header.timeBounds, header.timeChannels(), time)) {
+                return false;
+            }
+            break;
+        case MeshColumn::Axis0:
+        case MeshColumn::Axis1:
+        case MeshColumn::Axis2: {
+            if (!parse_real(token, number)) {
+                return false;
+            }
+            const std::size_t axis = static_cast<std::size_t>(column) - static_cast<std::size_t>(MeshColumn::Axis0);
+            at[axis] = cell_of(header.bounds[axis], number);
+            break;
+        }
+        case MeshColumn::Result:
+            if (!parse_real(token, number)) {
+                return false;
+            }
+            row.value = static_cast<float>(number);
+            break;
+        case MeshColumn::Error:
+            if (!parse_real(token, number)) {
+                return false;
+            }
+            row.error = static_cast<float>(number);
+            break;
+        case MeshColumn::Volume:
+        case MeshColumn::ResultVolume:
+            break;
+        }
+    }
+    row.x = static_cast<std::uint32_t>(at[0]);
+    row.y = static_cast<std::uint32_t>(at[1]);
+    row.z = static_cast<std::uint32_t>(at[2]);
+    row.channel = static_cast<std::uint32_t>(energy * header.timeChannels() + time);
+    return true;
+}
+
+// 一个网格计数的头部：从 Mesh Tally Number 行到列标题行
+void parse_tally(std::string_view text, std::size_t begin, MeshtalTallyHeader& tally) {
+    Lines lines(text, begin);
+    std::string_view line;
+    lines.next(line);
+    const std::string_view number = trim(line.substr(kTallyMarker.size()));
+    std::from_chars(number.data(), number.data() + number.size(), tally.number);
+
+    std::vector<double>* list = nullptr;  // 可能跨行续写的边界列表
+    bool seenParticle = false;
+    while (lines.next(line)) {
+        const std::string_view content = trim(line);
+        if (content.empty()) {
+            list = nullptr;
+            continue;
+        }
+        if (list && is_number_start(content.front())) {
+            append_list(content, *list);
+            continue;
+        }
+        list = nullptr;
+        if (starts_with(content, "X direction")) {
+            list = &tally.bounds[0];
+        } else if (starts_with(content, "Y direction")) {
+            list = &tally.bounds[1];
+        } else if (starts_with(content, "R direction")) {
+            tally.geometry = MeshGeometry::Cylindrical;
+            list = &tally.bounds[0];
+        } else if (starts_with(content, "Z direction")) {
+            list = &tally.bounds[tally.geometry == MeshGeometry::Cylindrical ? 1 : 2];
+        } else if (starts_with(content, "Theta direction")) {
+            tally.geometry = MeshGeometry::Cylindrical;
+            list = &tally.bounds[2];
+        } else if (starts_with(content, "Energy bin boundaries")) {
+            list = &tally.energyBounds;
+        } else if (starts_with(content, "Time bin boundaries")) {
+            list = &tally.timeBounds;
+        } else if (starts_with(content, "Cylinder origin")) {
+            tally.cylinder = std::string(content);
+        } else if (content.find("Result") != std::string_view::npos &&
+                   content.find("Rel Error") != std::string_view::npos) {
+            if (!parse_columns(content, tally.geometry, tally.columns)) {
+                tally.error = "unrecognized column header: " + std::string(content);
+            }
+            tally.dataBegin = lines.position();
+            break;
+        } else if (content.find("Bin:") != std::string_view::npos || content.find("bin:") != std::string_view::npos) {
+            tally.error = "matrix format is not supported; write the mesh tally in column format";
+            break;
+        } else if (!seenParticle && !starts_with(content, "Tally bin boundaries")) {
+            std::size_t position = 0;
+            std::string_view particle;
+            next_token(content, position, particle);
+            tally.particle = std::string(particle);
+        }
+        if (list) {
+            append_list(after_colon(content), *list);
+        }
+        seenParticle = true;
+    }
+    if (!tally.error.empty()) {
+        return;
+    }
+    if (tally.columns.empty()) {
+        tally.error = "missing column header";
+        return;
+    }
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+        if (tally.bounds[axis].size() < 2) {
+            tally.error = "missing bin boundaries for mesh direction " + std::to_string(axis + 1);
+            return;
+        }
+        const auto column = static_cast<MeshColumn>(static_cast<std::size_t>(MeshColumn::Axis0) + axis);
+        if (std::find(tally.columns.begin(), tally.columns.end(), column) == tally.columns.end()) {
+            tally.error = "missing coordinate column for mesh direction " + std::to_string(axis + 1);
+            return;
+        }
+    }
+    const auto has = [&](MeshColumn column) {
+        return std::find(tally.columns.begin(), tally.columns.end(), column) != tally.columns.end();
+    };
+    if (!has(MeshColumn::Result) || !has(MeshColumn::Error)) {
+        tally.error = "missing result or error column";
+    } else if (tally.energyChannels() > 1 && !has(MeshColumn::Energy)) {
+        tally.error = "missing energy column";
+    } else if (tally.timeChannels() > 1 && !has(MeshColumn::Time)) {
+        tally.error = "missing time column";
+    }
+}
+
+std::size_t bin_channels(const std::vector<double>& bounds) {
+    const std::size_t bins = bounds.size() > 1 ? bounds.size() - 1 : 1;
+    return bins > 1 ? bins + 1 : 1;
+}
+
+} // namespace
+
+std::array<std::size_t, 3> MeshtalTallyHeader::dims() const {
+    std::array<std::size_t, 3> result{};
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+        result[axis] = bounds[axis].size() > 1 ? bounds[axis].size() - 1 : 0;
+    }
+    return result;
+}
+
+std::size_t MeshtalTallyHeader::energyChannels() const {
+    return bin_channels(energyBounds);
+}
+
+std::size_t MeshtalTallyHeader::timeChannels() const {
+    return bin_channels(timeBounds);
+}
+
+bool MeshtalFile::open(const std::filesystem::path& path) {
+    close();
+    if (!file_.open(path, &error_)) {
+        return false;
+    }
+    if (!index()) {
+        const std::string error = std::move(error_);
+        close();
+        error_ = error;
+        return false;
+    }
+    return true;
+}
+
+void MeshtalFile::close() {
+    file_.close();
+    header_ = MeshtalHeader{};
+    tallies_.clear();
+    error_.clear();
+}
+
+bool MeshtalFile::index() {
+    const std::string_view text = file_.view();
+    std::size_t position = text.find(kTallyMarker);
+    if (position == std::string_view::npos) {
+        error_ = "no mesh tallies found";
+        return false;
+    }
+
+    // 文件头：mcnp version 6 ld=... probid = ...，标题行，归一化历史数
+    Lines lines(text.substr(0, position), 0);
+    std::string_view line;
+    if (lines.next(line)) {
+        std::size_t at = 0;
+        std::string_view token;
+        if (next_token(line, at, token)) {
+            header_.code = std::string(token);
+        }
+        while (next_token(line, at, token)) {
+            if (token == "version" && next_token(line, at, token)) {
+                header_.version = std::string(token);
+                break;
+            }
+        }
+        const std::size_t probid = line.find("probid");
+        if (probid != std::string_view::npos) {
+            const std::size_t equals = line.find('=', probid);
+            header_.problemId = std::string(trim(line.substr(equals == std::string_view::npos ? probid + 6 : equals + 1)));
+        }
+    }
+    if (lines.next(line)) {
+        header_.title = std::string(trim(line));
+    }
+    while (lines.next(line)) {
+        if (line.find("Number of histories") != std::string_view::npos) {
+            const std::size_t equals = line.find('=');
+            if (equals != std::string_view::npos) {
+                parse_real(trim(line.substr(equals + 1)), header_.histories);
+            }
+        }
+    }
+
+    // 数据区只含数字与 Total，按标记查找下一计数可整段跳过数据行
+    while (position != std::string_view::npos) {
+        const std::size_t next = text.find(kTallyMarker, position + kTallyMarker.size());
+        const std::size_t end = next == std::string_view::npos ? text.size() : next;
+        MeshtalTallyHeader tally;
+        parse_tally(text.substr(0, end), position, tally);
+        tally.dataEnd = end;
+        if (tally.dataBegin == 0) {
+            tally.dataBegin = end;
+        }
+        tallies_.push_back(std::move(tally));
+        position = next;
+    }
+    return true;
+}
+
+std::size_t MeshtalFile::find(int number) const {
+    for (std::size_t i = 0; i < tallies_.size(); ++i) {
+        if (tallies_[i].number == number) {
+            return i;
+        }
+    }
+    return npos;
+}
+
+std::unique_ptr<mcnp::core::VoxelBrickStore> MeshtalFile::load(std::size_t index,
+                                                               const mcnp::core::VoxelStoreOptions& options,
+                                                               mcnp::core::ThreadPool* pool) {
+    if (index >= tallies_.size()) {
+        error_ = "no mesh tally at index " + std::to_string(index);
+        return nullptr;
+    }
+    const MeshtalTallyHeader& header = tallies_[index];
+    const std::string prefix = "mesh tally " + std::to_string(header.number) + ": ";
+    if (!header.error.empty()) {
+        error_ = prefix + header.error;
+        return nullptr;
+    }
+    mcnp::core::ThreadPool& workers = pool ? *pool : mcnp::core::ThreadPool::shared();
+    const auto dims = header.dims();
+    auto store = std::make_unique<mcnp::core::VoxelBrickStore>(dims, header.channels(), options);
+
+    const std::string_view data = file_.view().substr(header.dataBegin, header.dataEnd - header.dataBegin);
+    std::size_t rows = 0;
+    std::vector<std::size_t> bounds;
+    std::vector<std::vector<Row>> parsed;
+    std::vector<std::size_t> bad;
+    for (std::size_t blockBegin = 0; blockBegin < data.size();) {
+        std::size_t blockEnd = std::min(data.size(), blockBegin + kBlockBytes);
+        if (blockEnd < data.size()) {
+            const std::size_t newline = data.find('\n', blockEnd);
+            blockEnd = newline == std::string_view::npos ? data.size() : newline + 1;
+        }
+
+        // 块内按换行切片并行解析，再按文件顺序写入存储（相邻行多落在同一砖块内）
+        bounds.assign(1, blockBegin);
+        for (std::size_t at = blockBegin + kChunkBytes; at < blockEnd; at += kChunkBytes) {
+            const std::size_t newline = data.find('\n', at);
+            if (newline == std::string_view::npos || newline + 1 >= blockEnd) {
+                break;
+            }
+            bounds.push_back(newline + 1);
+            at = newline + 1;
+        }
+        bounds.push_back(blockEnd);
+        const std::size_t chunks = bounds.size() - 1;
+        parsed.resize(chunks);
+        bad.assign(chunks, npos);
+        workers.parallelFor(chunks, 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t c = begin; c < end; ++c) {
+                parsed[c].clear();
+                Lines lines(data.substr(0, bounds[c + 1]), bounds[c]);
+                std::string_view line;
+                std::size_t lineStart = bounds[c];
+                Row row;
+                while (lines.next(line)) {
+                    if (!trim(line).empty()) {
+                        if (!parse_row(line, header, row)) {
+                            bad[c] = lineStart;
+                            break;
+                        }
+                        parsed[c].push_back(row);
+                    }
+                    lineStart = lines.position();
+                }
+            }
+        });
+        for (std::size_t c = 0; c < chunks; ++c) {
+            if (bad[c] != npos) {
+                const std::string_view line = data.substr(bad[c], data.find('\n', bad[c]) - bad[c]);
+                error_ = prefix + "malformed row: " + std::string(trim(line));
+                return nullptr;
+            }
+            for (const Row& row : parsed[c]) {
+                store->set(row.x, row.y, row.z, row.channel, row.value, row.error);
+            }
+            rows += parsed[c].size();
+        }
+        blockBegin = blockEnd;
+    }
+
+    const std::size_t expected = dims[0] * dims[1] * dims[2] * header.channels();
+    if (rows != expected) {
+        error_ = prefix + "expected " + std::to_string(expected) + " rows, found " + std::to_string(rows);
+        return nullptr;
+    }
+    error_.clear();
+    return store;
+}
+
+} // namespace mcnp::parser
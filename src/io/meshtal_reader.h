@@ -0,0 +1,100 @@
+#ifndef MESHTAL_READER_H
+#define MESHTAL_READER_H
+
+#include "deck_tokenizer.h"
+#include "thread_pool.h"
+#include "voxel_store.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mcnp::parser {
+
+enum class MeshGeometry : std::uint8_t {
+    Rectangular,  // X/Y/Z
+    Cylindrical   // R/Z/Theta（Theta 以圈为单位）
+};
+
+// 列格式数据行中的列
+enum class MeshColumn : std::uint8_t {
+    Energy,
+    Time,
+    Axis0,   // X 或 R
+    Axis1,   // Y 或 Z
+    Axis2,   // Z 或 Theta
+    Result,
+    Error,
+    Volume,
+    ResultVolume
+};
+
+// 打开文件时建立的网格计数索引：头部与数据区的字节区间，不解析数据行
+struct MeshtalTallyHeader {
+    int number = 0;
+    std::string particle;
+    MeshGeometry geometry = MeshGeometry::Rectangular;
+    std::array<std::vector<double>, 3> bounds;  // 三个方向的分档边界
+    std::vector<double> energyBounds;
+    std::vector<double> timeBounds;
+    std::string cylinder;  // 柱网格的原点与轴向说明行
+    std::vector<MeshColumn> columns;
+    std::size_t dataBegin = 0;
+    std::size_t dataEnd = 0;
+    std::string error;  // 无法加载的原因（如矩阵格式）；为空表示可加载
+
+    std::array<std::size_t, 3> dims() const;
+    // 多于一个分档时另有总计档，排在最后
+    std::size_t energyChannels() const;
+    std::size_t timeChannels() const;
+    // 通道 = 能量档 * 时间通道数 + 时间档
+    std::size_t channels() const { return energyChannels() * timeChannels(); }
+};
+
+struct MeshtalHeader {
+    std::string code;
+    std::string version;
+    std::string problemId;
+    std::string title;
+    double histories = 0.0;
+};
+
+// 内存映射的 meshtal 文件（FMESH 列格式，TMESH 按相同列布局读取）。打开时只定位各网格计数的
+// 头部与数据区；加载时按块流式解析数据行（块内在线程池上并行），逐体素写入分砖存储，
+// 不在内存中保留整份文本解析结果，体素数超过内存时由存储换出到磁盘缓存。
+class MeshtalFile {
+public:
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    // 失败返回 false，原因见 error()
+    bool open(const std::filesystem::path& path);
+    void close();
+
+    const MeshtalHeader& header() const noexcept { return header_; }
+    const std::vector<MeshtalTallyHeader>& tallies() const noexcept { return tallies_; }
+    // 计数号对应的索引下标；不存在返回 npos
+    std::size_t find(int number) const;
+    const std::string& error() const noexcept { return error_; }
+
+    // 读入一个网格计数；失败返回空指针，原因见 error()。pool 为空时使用共享线程池
+    std::unique_ptr<mcnp::core::VoxelBrickStore> load(std::size_t index,
+                                                      const mcnp::core::VoxelStoreOptions& options = {},
+                                                      mcnp::core::ThreadPool* pool = nullptr);
+
+private:
+    bool index();
+
+    MappedFile file_;
+    MeshtalHeader header_;
+    std::vector<MeshtalTallyHeader> tallies_;
+    std::string error_;
+};
+
+} // namespace mcnp::parser
+
+#endif // MESHTAL_READER_H
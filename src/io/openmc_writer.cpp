@@ -0,0 +1,749 @@
+#include "openmc_writer.h"
+#include "xml_stream.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <unordered_map>
+
+namespace mcnp::parser {
+
+namespace {
+
+using mcnp::core::CsgDag;
+using mcnp::core::CsgNode;
+using mcnp::core::CsgOp;
+using mcnp::core::Quadric;
+using mcnp::core::SurfaceTable;
+using NodeId = CsgDag::NodeId;
+
+// 无间距方向（无限长）的栅格轴写成一个足够宽的元素
+constexpr double kUnboundedPitch = 1.0e10;
+
+constexpr std::string_view kElements[] = {
+    "H",  "He", "Li", "Be", "B",  "C",  "N",  "O",  "F",  "Ne", "Na", "Mg", "Al", "Si", "P",  "S",  "Cl", "Ar",
+    "K",  "Ca", "Sc", "Ti", "V",  "Cr", "Mn", "Fe", "Co", "Ni", "Cu", "Zn", "Ga", "Ge", "As", "Se", "Br", "Kr",
+    "Rb", "Sr", "Y",  "Zr", "Nb", "Mo", "Tc", "Ru", "Rh", "Pd", "Ag", "Cd", "In", "Sn", "Sb", "Te", "I",  "Xe",
+    "Cs", "Ba", "La", "Ce", "Pr", "Nd", "Pm", "Sm", "Eu", "Gd", "Tb", "Dy", "Ho", "Er", "Tm", "Yb", "Lu", "Hf",
+    "Ta", "W",  "Re", "Os", "Ir", "Pt", "Au", "Hg", "Tl", "Pb", "Bi", "Po", "At", "Rn", "Fr", "Ra", "Ac", "Th",
+    "Pa", "U",  "Np", "Pu", "Am", "Cm", "Bk", "Cf", "Es", "Fm", "Md", "No", "Lr", "Rf", "Db", "Sg", "Bh", "Hs",
+    "Mt", "Ds", "Rg", "Cn", "Nh", "Fl", "Mc", "Lv", "Ts", "Og"};
+
+// MCNP 的 S(α,β) 表名（去掉后缀）到 OpenMC 的名字
+struct ThermalName {
+    std::string_view mcnp;
+    std::string_view openmc;
+};
+
+constexpr ThermalName kThermalNames[] = {
+    {"lwtr", "c_H_in_H2O"},   {"hwtr", "c_D_in_D2O"},    {"grph", "c_Graphite"}, {"poly", "c_H_in_CH2"},
+    {"be", "c_Be"},           {"beo", "c_Be_in_BeO"},    {"o/be", "c_O_in_BeO"}, {"h/zr", "c_H_in_ZrH"},
+    {"zr/h", "c_Zr_in_ZrH"},  {"benz", "c_Benzine"},     {"lmeth", "c_H_in_CH4_liquid"},
+    {"smeth", "c_H_in_CH4_solid"}, {"u/o2", "c_U_in_UO2"}, {"o2/u", "c_O_in_UO2"},
+};
+
+struct Constituent {
+    std::string name;
+    bool element = false;  // 天然元素（ZAID 的 A 为 0）
+    double fraction = 0.0;  // 正值为原子份额，负值为质量份额
+};
+
+struct Composition {
+    std::vector<Constituent> constituents;
+    std::vector<std::string> thermal;
+};
+
+bool keyword_number(std::string_view keyword, std::string_view prefix, int& number) {
+    if (keyword.size() <= prefix.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < prefix.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(keyword[i])) != prefix[i]) {
+            return false;
+        }
+    }
+    const char* first = keyword.data() + prefix.size();
+    const char* last = keyword.data() + keyword.size();
+    const auto result = std::from_chars(first, last, number);
+    return result.ec == std::errc() && result.ptr == last && number > 0;
+}
+
+// ZAID（如 92235.80c、8000）转成 OpenMC 的核素名（U235、Am242_m1）或元素名；无法识别时返回空
+std::string nuclide_name(std::string_view zaid, bool& element) {
+    int value = 0;
+    const auto result = std::from_chars(zaid.data(), zaid.data() + zaid.size(), value);
+    if (result.ec != std::errc() || (result.ptr != zaid.data() + zaid.size() && *result.ptr != '.')) {
+        return {};
+    }
+    const int z = value / 1000;
+    int a = value % 1000;
+    if (z < 1 || z > static_cast<int>(std::size(kElements))) {
+        return {};
+    }
+    std::string name(kElements[z - 1]);
+    element = a == 0;
+    if (element) {
+        return name;
+    }
+    // 同质异能态：A' = A + 300 + 100·m
+    int state = 0;
+    if (a > 300) {
+        state = (a - 300) / 100;
+        a -= 300 + 100 * state;
+    }
+    name += std::to_string(a);
+    if (state > 0) {
+        name += "_m" + std::to_string(state);
+    }
+    return name;
+}
+
+std::string thermal_name(std::string_view table) {
+    std::string key(table.substr(0, table.find('.')));
+    for (char& c : key) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    for (const ThermalName& name : kThermalNames) {
+        if (name.mcnp == key) {
+            return std::string(name.openmc);
+        }
+    }
+    return {};
+}
+
+// AST 中的 Mn 与 MTn 卡片；参数中的 NLIB= 等关键字忽略
+std::unordered_map<int, Composition> collect_compositions(const Ast& ast, std::vector<std::string>& warnings) {
+    std::unordered_map<int, Composition> compositions;
+    for (std::size_t i = 0; i < ast.cardCount(); ++i) {
+        const CardView card = ast.card(i);
+        if (card.kind() != CardKind::Data) {
+            continue;
+        }
+        int id = 0;
+        if (keyword_number(card.keyword(), "mt", id)) {
+            for (const std::string& table : card.expandedParameters()) {
+                std::string name = thermal_name(table);
+                if (name.empty()) {
+                    warnings.push_back("thermal table " + table + " of material " + std::to_string(id) +
+                                       " has no OpenMC name");
+                } else {
+                    compositions[id].thermal.push_back(std::move(name));
+                }
+            }
+            continue;
+        }
+        if (!keyword_number(card.keyword(), "m", id)) {
+            continue;
+        }
+        Composition& composition = compositions[id];
+        const std::vector<std::string> parameters = card.expandedParameters();
+        for (std::size_t p = 0; p < parameters.size(); ++p) {
+            if (parameters[p].find('=') != std::string::npos) {
+                continue;
+            }
+            Constituent constituent;
+            constituent.name = nuclide_name(parameters[p], constituent.element);
+            double fraction = 0.0;
+            const std::string_view text = p + 1 < parameters.size() ? std::string_view(parameters[p + 1]) : "";
+            const auto result = std::from_chars(text.data(), text.data() + text.size(), fraction);
+            if (constituent.name.empty() || result.ec != std::errc()) {
+                warnings.push_back("material " + std::to_string(id) + ": cannot convert " + parameters[p]);
+                continue;
+            }
+            constituent.fraction = fraction;
+            composition.constituents.push_back(std::move(constituent));
+            ++p;
+        }
+    }
+    return compositions;
+}
+
+void append_number(std::string& out, double value) {
+    char buffer[32];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value == 0.0 ? 0.0 : value);
+    out.append(buffer, result.ptr);
+}
+
+void append_number(std::string& out, long long value) {
+    char buffer[24];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+struct OpenMcSurface {
+    std::string_view type;  // 空表示 OpenMC 无法表示（斜置环面）
+    std::vector<double> coeffs;
+    bool quadric = false;   // 直接取自曲面表的二次系数，方向与代表行一致
+};
+
+OpenMcSurface openmc_surface(const SurfaceCard& card, const SurfaceTable& table, std::size_t row) {
+    const std::string& m = card.mnemonic;
+    const std::vector<double>& v = card.values;
+    if (card.transform && table.torus(row)) {
+        return {};
+    }
+    if (!card.transform) {
+        static constexpr std::string_view kPlanes[] = {"x-plane", "y-plane", "z-plane"};
+        static constexpr std::string_view kCylinders[] = {"x-cylinder", "y-cylinder", "z-cylinder"};
+        static constexpr std::string_view kCones[] = {"x-cone", "y-cone", "z-cone"};
+        static constexpr std::string_view kTori[] = {"x-torus", "y-torus", "z-torus"};
+        const std::size_t axis = m.empty() ? 0 : static_cast<std::size_t>(std::max(0, m.back() - 'x'));
+        if (m == "px" || m == "py" || m == "pz") {
+            return {kPlanes[axis], v};
+        }
+        if (m == "p" && v.size() == 4) {
+            return {"plane", v};
+        }
+        if (m == "so") {
+            return {"sphere", {0.0, 0.0, 0.0, v[0]}};
+        }
+        if (m == "sx" || m == "sy" || m == "sz") {
+            std::vector<double> coeffs{0.0, 0.0, 0.0, v[1]};
+            coeffs[axis] = v[0];
+            return {"sphere", coeffs};
+        }
+        if (m == "s") {
+            return {"sphere", v};
+        }
+        // C/X 为 y z R、C/Y 为 x z R、C/Z 为 x y R，与 OpenMC 的系数顺序相同
+        if (m == "cx" || m == "cy" || m == "cz") {
+            return {kCylinders[axis], {0.0, 0.0, v[0]}};
+        }
+        if (m == "c/x" || m == "c/y" || m == "c/z") {
+            return {kCylinders[axis], v};
+        }
+        if (m == "kx" || m == "ky" || m == "kz") {
+            std::vector<double> coeffs{0.0, 0.0, 0.0, v[1]};
+            coeffs[axis] = v[0];
+            return {kCones[axis], coeffs};
+        }
+        if (m == "k/x" || m == "k/y" || m == "k/z") {
+            return {kCones[axis], {v[0], v[1], v[2], v[3]}};
+        }
+        if (m == "tx" || m == "ty" || m == "tz") {
+            return {kTori[axis], v};
+        }
+    }
+    const Quadric q = table.quadric(row);
+    return {"quadric", std::vector<double>(q.c.begin(), q.c.end()), true};
+}
+
+struct MaterialVariant {
+    int id = 0;
+    int material = 0;
+    double density = 0.0;
+};
+
+} // namespace
+
+OpenMcWriteStats writeOpenMc(std::ostream& geometry, std::ostream& materials, const DeckModel& model,
+                             const OpenMcWriterOptions& options, const Ast* ast) {
+    OpenMcWriteStats stats;
+    const CsgDag& dag = *model.dag;
+    const SurfaceTable& table = *model.surfaces;
+    const double eps = std::max(options.tolerance, 1e-12);
+
+    const SurfaceUsage usage = collectSurfaces(model, options.tolerance);
+    for (const int id : usage.undefined) {
+        stats.warnings.push_back("surface " + std::to_string(id) + " is not defined");
+    }
+    stats.mergedSurfaces = usage.merged;
+    const std::vector<int> outputId = assignSurfaceIds(table, usage, model.keepSurfaceNumbers);
+
+    // 曲面形式与方向：写出的曲面可能与代表行差一个符号
+    const std::size_t uniqueCount = usage.dedup.size();
+    std::vector<OpenMcSurface> surfaces;
+    std::vector<char> surfaceFlipped(uniqueCount, 0);
+    surfaces.reserve(uniqueCount);
+    SurfaceTable scratch;
+    for (std::size_t u = 0; u < uniqueCount; ++u) {
+        const std::size_t row = usage.dedup.representative(u);
+        const SurfaceCard card = describeSurface(table, row, eps);
+        OpenMcSurface surface = openmc_surface(card, table, row);
+        if (table.coneSheet(row)) {
+            stats.warnings.push_back("one-sheet cone " + std::to_string(table.id(row)) +
+                                     " is written as a two-sheet cone");
+        }
+        if (!surface.type.empty() && !surface.quadric && !table.torus(row)) {
+            scratch.clear();
+            if (scratch.add(1, card.mnemonic, card.values)) {
+                const Quadric written = scratch.quadric(0);
+                const Quadric original = table.quadric(row);
+                double dot = 0.0;
+                for (int i = 0; i < SurfaceTable::CoefficientCount; ++i) {
+                    dot += written.c[i] * original.c[i];
+                }
+                surfaceFlipped[u] = dot < 0.0;
+            }
+        }
+        surfaces.push_back(std::move(surface));
+    }
+
+    // 节点是否引用了无法写出的曲面（按节点缓存）；visit 遍历区域用到的曲面行
+    auto visit_rows = [&](auto&& self, NodeId id, std::vector<char>& seen, auto&& onRow) -> void {
+        if (seen[id]) {
+            return;
+        }
+        seen[id] = 1;
+        const CsgNode& n = dag.node(id);
+        if (n.op != CsgOp::Halfspace) {
+            for (const NodeId child : dag.children(id)) {
+                self(self, child, seen, onRow);
+            }
+            return;
+        }
+        const SurfaceTable::MacroBody* body = n.facet == 0 ? table.findMacroBody(n.surface) : nullptr;
+        if (body) {
+            for (std::uint32_t i = 0; i < body->facetCount; ++i) {
+                onRow(body->firstRow + i);
+            }
+        } else if (const auto row = table.find(n.surface, n.facet)) {
+            onRow(*row);
+        }
+    };
+    std::vector<std::int8_t> unwritableMemo(dag.size(), -1);
+    auto unwritable = [&](auto&& self, NodeId id) -> bool {
+        if (unwritableMemo[id] >= 0) {
+            return unwritableMemo[id] != 0;
+        }
+        const CsgNode& n = dag.node(id);
+        bool found = false;
+        if (n.op == CsgOp::Halfspace) {
+            const SurfaceTable::MacroBody* body = n.facet == 0 ? table.findMacroBody(n.surface) : nullptr;
+            const std::optional<std::size_t> row = body ? std::nullopt : table.find(n.surface, n.facet);
+            found = row && surfaces[static_cast<std::size_t>(usage.rowEntry[*row] / 2)].type.empty();
+        } else {
+            for (const NodeId child : dag.children(id)) {
+                found = found || self(self, child);
+            }
+        }
+        unwritableMemo[id] = found ? 1 : 0;
+        return found;
+    };
+
+    // IMP=0 的单元不写出，其边界曲面为真空边界
+    std::vector<char> vacuum(uniqueCount, 0);
+    {
+        std::vector<char> seen(dag.size(), 0);
+        for (const DeckCell& cell : model.cells) {
+            if (cell.importance == 0.0 && cell.region != CsgDag::kInvalid) {
+                visit_rows(visit_rows, cell.region, seen, [&](std::size_t row) {
+                    vacuum[static_cast<std::size_t>(usage.rowEntry[row] / 2)] = 1;
+                });
+            }
+        }
+    }
+
+    std::unordered_map<int, const OpenMcLattice*> lattices;
+    for (const OpenMcLattice& lattice : options.lattices) {
+        lattices.emplace(lattice.id, &lattice);
+    }
+
+    std::unordered_map<int, NodeId> cellRegions;
+    for (const DeckCell& cell : model.cells) {
+        cellRegions.emplace(cell.id, cell.region);
+    }
+    auto writable = [&](NodeId id) {
+        return id != CsgDag::kInvalid && dag.node(id).op != CsgOp::Empty && dag.node(id).op != CsgOp::Universe;
+    };
+
+    // 区域表达式：交为空格，并为 |，补为 ~(...)；交的优先级高于并，只有交中的并需要括号
+    std::string text;
+    auto token = [&](std::size_t row, bool negative) {
+        const std::int64_t entry = usage.rowEntry[row];
+        const std::size_t unique = static_cast<std::size_t>(entry / 2);
+        const bool flip = ((entry & 1) != 0) != (surfaceFlipped[unique] != 0);
+        if (negative != flip) {
+            text += '-';
+        }
+        append_number(text, static_cast<long long>(outputId[unique]));
+    };
+    auto region = [&](auto&& self, NodeId id, bool inIntersection) -> void {
+        const CsgNode& n = dag.node(id);
+        switch (n.op) {
+            case CsgOp::Halfspace: {
+                const SurfaceTable::MacroBody* body = n.facet == 0 ? table.findMacroBody(n.surface) : nullptr;
+                if (body) {
+                    // 宏体内部为各面负侧的交，外部为各面正侧的并
+                    const bool parens = !n.negative && inIntersection && body->facetCount > 1;
+                    if (parens) {
+                        text += '(';
+                    }
+                    for (std::uint32_t i = 0; i < body->facetCount; ++i) {
+                        if (i > 0) {
+                            text += n.negative ? " " : " | ";
+                        }
+                        token(body->firstRow + i, n.negative);
+                    }
+                    if (parens) {
+                        text += ')';
+                    }
+                } else if (const auto row = table.find(n.surface, n.facet)) {
+                    token(*row, n.negative);
+                } else {
+                    text += n.negative ? "-" : "";
+                    append_number(text, static_cast<long long>(n.surface));
+                }
+                break;
+            }
+            case CsgOp::Intersection:
+            case CsgOp::Union: {
+                const bool conjunction = n.op == CsgOp::Intersection;
+                const bool parens = !conjunction && inIntersection;
+                if (parens) {
+                    text += '(';
+                }
+                bool first = true;
+                for (const NodeId child : dag.children(id)) {
+                    if (!first) {
+                        text += conjunction ? " " : " | ";
+                    }
+                    first = false;
+                    self(self, child, conjunction);
+                }
+                if (parens) {
+                    text += ')';
+                }
+                break;
+            }
+            case CsgOp::Empty:
+            case CsgOp::Universe:
+                break;
+        }
+    };
+
+    XmlWriter xml(geometry, options.bufferSize);
+    xml.declaration();
+    xml.start("geometry");
+    for (std::size_t u = 0; u < uniqueCount; ++u) {
+        const OpenMcSurface& surface = surfaces[u];
+        const std::size_t row = usage.dedup.representative(u);
+        if (surface.type.empty()) {
+            stats.warnings.push_back("oblique torus " + std::to_string(table.id(row)) + " has no OpenMC surface");
+            continue;
+        }
+        xml.start("surface");
+        xml.attribute("id", outputId[u]);
+        xml.attribute("type", surface.type);
+        text.clear();
+        for (const double c : surface.coeffs) {
+            if (!text.empty()) {
+                text += ' ';
+            }
+            append_number(text, std::abs(c) <= 1e-14 ? 0.0 : c);
+        }
+        xml.attribute("coeffs", text);
+        switch (table.boundary(row)) {
+            case mcnp::core::BoundaryKind::Reflecting:
+                xml.attribute("boundary", "reflective");
+                break;
+            case mcnp::core::BoundaryKind::White:
+                xml.attribute("boundary", "white");
+                break;
+            case mcnp::core::BoundaryKind::Periodic:
+                xml.attribute("boundary", "periodic");
+                if (const auto partner = table.periodicPartner(table.id(row))) {
+                    const auto partnerRow = table.find(*partner);
+                    if (partnerRow && usage.rowEntry[*partnerRow] >= 0) {
+                        xml.attribute("periodic_surface_id",
+                                      outputId[static_cast<std::size_t>(usage.rowEntry[*partnerRow] / 2)]);
+                    }
+                }
+                break;
+            case mcnp::core::BoundaryKind::None:
+                if (vacuum[u]) {
+                    xml.attribute("boundary", "vacuum");
+                }
+                break;
+        }
+        xml.end();
+        ++stats.surfaces;
+    }
+
+    // 单元；同一材料号的不同密度各对应一个 OpenMC 材料
+    std::vector<MaterialVariant> variants;
+    std::unordered_map<int, std::vector<std::size_t>> variantsOf;
+    int nextMaterial = 1;
+    int maxCell = 0;
+    int maxUniverse = 0;
+    for (const DeckCell& cell : model.cells) {
+        nextMaterial = std::max(nextMaterial, cell.material + 1);
+        maxCell = std::max(maxCell, cell.id);
+        maxUniverse = std::max({maxUniverse, cell.universe, cell.fill});
+    }
+    for (const OpenMcLattice& lattice : options.lattices) {
+        maxUniverse = std::max(maxUniverse, lattice.id);
+        for (const int fill : lattice.spec.fill) {
+            maxUniverse = std::max(maxUniverse, fill);
+        }
+    }
+    auto material_id = [&](const DeckCell& cell) {
+        auto& list = variantsOf[cell.material];
+        for (const std::size_t v : list) {
+            if (variants[v].density == cell.density) {
+                return variants[v].id;
+            }
+        }
+        const int id = list.empty() ? cell.material : nextMaterial++;
+        list.push_back(variants.size());
+        variants.push_back({id, cell.material, cell.density});
+        return id;
+    };
+
+    for (const DeckCell& cell : model.cells) {
+        if (cell.importance == 0.0 || lattices.count(cell.universe)) {
+            continue;
+        }
+        const bool hasRegion = writable(cell.region);
+        bool skip = hasRegion && unwritable(unwritable, cell.region);
+        bool complete = true;
+        for (const int excluded : cell.excluded) {
+            const auto it = cellRegions.find(excluded);
+            complete = complete && it != cellRegions.end() && writable(it->second);
+            skip = skip || (complete && unwritable(unwritable, it->second));
+        }
+        if (!complete || skip || (cell.region != CsgDag::kInvalid && dag.node(cell.region).op == CsgOp::Empty)) {
+            stats.warnings.push_back("cell " + std::to_string(cell.id) +
+                                     (skip ? " uses an oblique torus and was skipped"
+                                           : " cannot be written as an OpenMC region"));
+            continue;
+        }
+        text.clear();
+        if (hasRegion) {
+            region(region, cell.region, !cell.excluded.empty());
+        }
+        for (const int excluded : cell.excluded) {
+            text += text.empty() ? "~(" : " ~(";
+            region(region, cellRegions.at(excluded), false);
+            text += ')';
+        }
+        xml.start("cell");
+        xml.attribute("id", cell.id);
+        if (cell.fill != 0) {
+            xml.attribute("fill", cell.fill);
+        } else if (cell.material == 0) {
+            xml.attribute("material", "void");
+        } else {
+            xml.attribute("material", material_id(cell));
+        }
+        if (!text.empty()) {
+            xml.attribute("region", text);
+        }
+        if (cell.universe != 0) {
+            xml.attribute("universe", cell.universe);
+        }
+        xml.end();
+        ++stats.cells;
+    }
+
+    // 栅格：矩形栅格每层从 y 最大的一行写起；六角栅格取 orientation="x"（侧面垂直于 x 轴），
+    // 以元素 (0,0) 为中心按环数补齐成完整的六边形，每层从 y 最大的一行写起、行内 x 递增
+    int voidUniverse = 0;
+    auto universe_text = [&](int universe) {
+        if (universe < 0) {
+            voidUniverse = voidUniverse != 0 ? voidUniverse : maxUniverse + 1;
+            universe = voidUniverse;
+        }
+        append_number(text, static_cast<long long>(universe));
+    };
+    for (const OpenMcLattice& lattice : options.lattices) {
+        const mcnp::core::LatticeSpec& spec = lattice.spec;
+        const glm::ivec3 size = spec.upper - spec.lower + glm::ivec3(1);
+        if (size.x <= 0 || size.y <= 0 || size.z <= 0 ||
+            spec.fill.size() != static_cast<std::size_t>(size.x) * size.y * size.z) {
+            stats.warnings.push_back("lattice " + std::to_string(lattice.id) + " has an inconsistent fill");
+            continue;
+        }
+        const bool layered = spec.pitch.z > 0.0;
+        if (!layered && size.z != 1) {
+            stats.warnings.push_back("lattice " + std::to_string(lattice.id) + " has several layers but no axial pitch");
+            continue;
+        }
+        const bool hexagonal = spec.type == mcnp::core::LatticeType::Hexagonal;
+        // 六角栅格的环数：覆盖全部数组元素的最小六边形（轴向坐标的六角距离 max(|i|, |j|, |i + j|)）
+        int rings = 1;
+        for (int j = spec.lower.y; hexagonal && j <= spec.upper.y; ++j) {
+            for (int i = spec.lower.x; i <= spec.upper.x; ++i) {
+                rings = std::max(rings, 1 + std::max({std::abs(i), std::abs(j), std::abs(i + j)}));
+            }
+        }
+        auto vector_text = [&](int axes, auto value) {
+            text.clear();
+            for (int a = 0; a < axes; ++a) {
+                if (a > 0) {
+                    text += ' ';
+                }
+                append_number(text, value(a));
+            }
+            return std::string_view(text);
+        };
+
+        if (!hexagonal) {
+            const int axes = layered ? 3 : 2;
+            glm::dvec3 pitch = spec.pitch;
+            glm::dvec3 lowerLeft(0.0);
+            for (int a = 0; a < 3; ++a) {
+                if (pitch[a] <= 0.0) {
+                    pitch[a] = kUnboundedPitch;
+                }
+                lowerLeft[a] = lattice.origin[a] + (spec.lower[a] - 0.5) * pitch[a];
+            }
+            xml.start("lattice");
+            xml.attribute("id", lattice.id);
+            xml.start("pitch");
+            xml.text(vector_text(axes, [&](int a) { return pitch[a]; }));
+            xml.end();
+            xml.start("dimension");
+            xml.text(vector_text(axes, [&](int a) { return static_cast<long long>(size[a]); }));
+            xml.end();
+            xml.start("lower_left");
+            xml.text(vector_text(axes, [&](int a) { return lowerLeft[a]; }));
+            xml.end();
+        } else {
+            const double axialCenter =
+                layered ? lattice.origin.z + 0.5 * (spec.lower.z + spec.upper.z) * spec.pitch.z : 0.0;
+            const int axes = layered ? 3 : 2;
+            xml.start("hex_lattice");
+            xml.attribute("id", lattice.id);
+            xml.attribute("n_rings", rings);
+            if (layered) {
+                xml.attribute("n_axial", size.z);
+            }
+            xml.attribute("orientation", "x");
+            xml.start("pitch");
+            xml.text(vector_text(layered ? 2 : 1, [&](int a) { return a == 0 ? spec.pitch.x : spec.pitch.z; }));
+            xml.end();
+            xml.start("center");
+            xml.text(vector_text(axes, [&](int a) { return a == 2 ? axialCenter : lattice.origin[a]; }));
+            xml.end();
+        }
+        if (lattice.outer >= 0) {
+            xml.start("outer");
+            xml.text(std::to_string(lattice.outer));
+            xml.end();
+        }
+        xml.start("universes");
+        for (int k = 0; k < size.z; ++k) {
+            if (!hexagonal) {
+                for (int j = size.y - 1; j >= 0; --j) {
+                    text.clear();
+                    for (int i = 0; i < size.x; ++i) {
+                        if (i > 0) {
+                            text += ' ';
+                        }
+                        universe_text(spec.fill[(static_cast<std::size_t>(k) * size.y + j) * size.x + i]);
+                    }
+                    xml.raw(text);
+                }
+                continue;
+            }
+            const int n = rings - 1;
+            for (int j = n; j >= -n; --j) {
+                // 行首缩进半个元素，使文本呈六边形
+                text.assign(static_cast<std::size_t>(std::abs(j)), ' ');
+                const int first = std::max(-n, -n - j);
+                const int last = std::min(n, n - j);
+                for (int i = first; i <= last; ++i) {
+                    if (i > first) {
+                        text += ' ';
+                    }
+                    universe_text(spec.universeAt(glm::ivec3(i, j, spec.lower.z + k)));
+                }
+                xml.raw(text);
+            }
+        }
+        xml.end();
+        xml.end();
+        ++stats.lattices;
+    }
+    if (voidUniverse != 0) {
+        // 栅格中的空元素：一个充满真空的宇宙
+        xml.start("cell");
+        xml.attribute("id", maxCell + 1);
+        xml.attribute("material", "void");
+        xml.attribute("universe", voidUniverse);
+        xml.end();
+    }
+    xml.end();
+    xml.raw("");
+    xml.flush();
+    stats.bytes = xml.bytes();
+
+    // materials.xml：只写被单元引用的材料
+    std::unordered_map<int, Composition> compositions;
+    if (ast) {
+        compositions = collect_compositions(*ast, stats.warnings);
+    }
+    XmlWriter out(materials, options.bufferSize);
+    out.declaration();
+    out.start("materials");
+    if (!options.crossSections.empty()) {
+        out.start("cross_sections");
+        out.text(options.crossSections);
+        out.end();
+    }
+    for (const MaterialVariant& variant : variants) {
+        out.start("material");
+        out.attribute("id", variant.id);
+        out.attribute("name", "m" + std::to_string(variant.material));
+        out.start("density");
+        if (variant.density > 0.0) {
+            out.attribute("units", "atom/b-cm");
+            out.attribute("value", variant.density);
+        } else if (variant.density < 0.0) {
+            out.attribute("units", "g/cm3");
+            out.attribute("value", -variant.density);
+        } else {
+            out.attribute("units", "sum");
+            stats.warnings.push_back("material " + std::to_string(variant.material) +
+                                     " is used without a density; written with units=\"sum\"");
+        }
+        out.end();
+        const auto it = compositions.find(variant.material);
+        if (it == compositions.end() || it->second.constituents.empty()) {
+            out.comment("composition of material " + std::to_string(variant.material) + " is not converted");
+            if (variant.id == variant.material) {
+                stats.warnings.push_back("material " + std::to_string(variant.material) +
+                                         " needs an OpenMC composition");
+            }
+        } else {
+            for (const Constituent& constituent : it->second.constituents) {
+                out.start(constituent.element ? "element" : "nuclide");
+                out.attribute("name", constituent.name);
+                out.attribute(constituent.fraction < 0.0 ? "wo" : "ao", std::abs(constituent.fraction));
+                out.end();
+            }
+            for (const std::string& thermal : it->second.thermal) {
+                out.start("sab");
+                out.attribute("name", thermal);
+                out.end();
+            }
+        }
+        out.end();
+        ++stats.materials;
+    }
+    out.end();
+    out.raw("");
+    out.flush();
+    stats.bytes += out.bytes();
+    return stats;
+}
+
+std::vector<OpenMcLattice> openMcLattices(std::span<const CompiledLattice> lattices) {
+    std::vector<OpenMcLattice> out;
+    out.reserve(lattices.size());
+    for (const CompiledLattice& lattice : lattices) {
+        OpenMcLattice& entry = out.emplace_back();
+        entry.id = lattice.universe;
+        entry.spec = lattice.spec;
+        entry.origin = lattice.origin;
+        const bool single = lattice.spec.lower == lattice.spec.upper && lattice.spec.fill.size() == 1;
+        if (single && lattice.spec.fill.front() >= 0) {
+            entry.outer = lattice.spec.fill.front();
+        }
+    }
+    return out;
+}
+
+} // namespace mcnp::parser
@@ -0,0 +1,59 @@
+#ifndef OPENMC_WRITER_H
+#define OPENMC_WRITER_H
+
+#include "cell_compiler.h"
+#include "input_ast.h"
+#include "mcnp_writer.h"
+#include "universe_resolver.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <ostream>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace mcnp::parser {
+
+// 以原生 <lattice>（矩形）或 <hex_lattice>（六角）写出的栅格。FILL= 等于 id 的单元填充该栅格；
+// U= 等于 id 的单元（MCNP 中的 LAT 单元本身）不再写出。
+struct OpenMcLattice {
+    int id = 0;
+    mcnp::core::LatticeSpec spec;  // fill 中 -1 的元素写成一个空宇宙
+    glm::dvec3 origin{0.0};        // 下标 0 元素中心在填充单元坐标系中的位置
+    int outer = -1;                // 栅格范围外的宇宙，-1 为空
+};
+
+struct OpenMcWriterOptions {
+    double tolerance = 1e-9;  // 曲面去重容差
+    std::size_t bufferSize = 1 << 16;
+    std::vector<OpenMcLattice> lattices;
+    std::string crossSections;  // 非空时写入 materials.xml 的 <cross_sections>
+};
+
+struct OpenMcWriteStats {
+    std::size_t cells = 0;
+    std::size_t surfaces = 0;
+    std::size_t mergedSurfaces = 0;
+    std::size_t lattices = 0;
+    std::size_t materials = 0;
+    std::size_t bytes = 0;  // 两个文件合计
+    std::vector<std::string> warnings;
+};
+
+// 卡片模型流式写成 OpenMC 的 geometry.xml 与 materials.xml。曲面按系数去重后写成 x-plane、sphere、
+// z-cylinder、x-cone、z-torus 等，其余写成 quadric；IMP 为 0 的单元不写出，其边界曲面为 vacuum，
+// *n/+n/周期曲面写成 reflective/white/periodic。#n 写成 ~(...)，宏体展开为各面。
+// 材料取自 ast 中的 Mn/MTn 卡片：同一材料号的不同密度各写成一个 OpenMC 材料；没有 ast 时只写密度。
+// 单叶锥写成双叶锥（给出警告），斜置环面无法表示，相关单元跳过。
+OpenMcWriteStats writeOpenMc(std::ostream& geometry, std::ostream& materials, const DeckModel& model,
+                             const OpenMcWriterOptions& options = {}, const Ast* ast = nullptr);
+
+// 卡片中 LAT/FILL 单元的栅格（compileLattices 的结果）转为 OpenMC 栅格；
+// 只给出 FILL=u 的栅格在数组之外也由 u 填充（outer）
+std::vector<OpenMcLattice> openMcLattices(std::span<const CompiledLattice> lattices);
+
+} // namespace mcnp::parser
+
+#endif // OPENMC_WRITER_H
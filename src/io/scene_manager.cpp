@@ -257,6 +257,29 @@ void computeNormals(const std::vector<glm::vec3>& positions,
 
 } // namespace
 
+std::shared_ptr<const mcnp::core::GeometryNode> meshGeometry(const Mesh& mesh)
+{
+    using mcnp::core::PrimitiveType;
+    if (mesh.csg) {
+        return mesh.csg;
+    }
+    static const std::pair<const char*, PrimitiveType> prefixes[] = {
+        {"Cube_", PrimitiveType::Box},
+        {"Sphere_", PrimitiveType::Sphere},
+        {"Cylinder_", PrimitiveType::Cylinder},
+        {"Plane_", PrimitiveType::Plane},
+    };
+    for (const auto& [prefix, type] : prefixes) {
+        if (mesh.name.rfind(prefix, 0) == 0) {
+            auto node = std::make_shared<mcnp::core::GeometryNode>();
+            node->label = mesh.name;
+            node->primitive = type;
+            return node;
+        }
+    }
+    return nullptr;
+}
+
 void performBooleanOperation(BooleanOperation operation)
 {
     if (selectedMesh < 0 || secondMeshForBoolean < 0 || 
@@ -343,6 +366,24 @@ void performBooleanOperation(BooleanOperation operation)
     }
 
     result.transform = glm::mat4(1.0f);
+
+    // 结果网格已在世界坐标中：保留运算树供导出，操作数的世界变换记在子节点上
+    const auto left = meshGeometry(mesh1);
+    const auto right = meshGeometry(mesh2);
+    if (left && right) {
+        auto operand = [](const mcnp::core::GeometryNode& geometry, const Mesh& mesh) {
+            auto node = std::make_shared<mcnp::core::GeometryNode>(geometry);
+            node->transform = mcnp::core::Transform::fromMatrix(mesh.transform * geometry.transform.toMatrix());
+            return node;
+        };
+        auto csg = std::make_shared<mcnp::core::GeometryNode>();
+        csg->label = result.name;
+        csg->booleanOp = operation == BooleanOperation::DIFFERENCE     ? mcnp::core::BooleanOperation::Difference
+                         : operation == BooleanOperation::INTERSECTION ? mcnp::core::BooleanOperation::Intersection
+                                                                       : mcnp::core::BooleanOperation::Union;
+        csg->children = {operand(*left, mesh1), operand(*right, mesh2)};
+        result.csg = std::move(csg);
+    }
     
     // 添加到场景
     meshes.push_back(result);
@@ -435,6 +476,11 @@ int pickObject(double mouseX, double mouseY, int windowWidth, int windowHeight)
             }
         }
     }
+
+    // 记下拾取射线：栅格实例等不在 meshes 中的几何由面板沿射线自行定位
+    ++viewportPick.serial;
+    viewportPick.origin = rayOrigin;
+    viewportPick.direction = rayDir;
     
     return closestMesh;
 }
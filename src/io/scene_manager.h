@@ -4,9 +4,11 @@
 #include <vector>
 #include <string>
 #include <fstream>
+#include <memory>
 #include <nlohmann/json.hpp>
 #include "vertex_mesh.h"
 #include "config_manager.h"  // 包含SceneState和KeyBindings的定义
+#include "../core/geometry_model.h"
 
 using json = nlohmann::json;
 
@@ -27,5 +29,7 @@ extern SceneState sceneState;
 void saveScene(const std::string& filename);
 void loadScene(const std::string& filename);
 void performBooleanOperation(BooleanOperation operation);
+// 网格在自身坐标中的几何树：布尔结果为保留的运算树，内置图元按名称前缀映射为单位图元，其余为空
+std::shared_ptr<const mcnp::core::GeometryNode> meshGeometry(const Mesh& mesh);
 
 #endif
\ No newline at end of file
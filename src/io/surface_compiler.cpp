@@ -0,0 +1,164 @@
+#include "surface_compiler.h"
+
+#include <cctype>
+#include <charconv>
+#include <string>
+
+namespace mcnp::parser {
+
+namespace {
+
+bool parse_number(std::string_view text, double& value) {
+    if (!text.empty() && text.front() == '+') {
+        text.remove_prefix(1);
+    }
+    const auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+bool parse_int(std::string_view text, int& value) {
+    if (!text.empty() && text.front() == '+') {
+        text.remove_prefix(1);
+    }
+    const auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+// TRn、*TRn：返回编号，非变换卡返回 -1
+int transform_number(std::string_view keyword, bool& degrees) {
+    degrees = !keyword.empty() && keyword.front() == '*';
+    if (degrees) {
+        keyword.remove_prefix(1);
+    }
+    if (keyword.size() < 3 || std::tolower(static_cast<unsigned char>(keyword[0])) != 't' ||
+        std::tolower(static_cast<unsigned char>(keyword[1])) != 'r') {
+        return -1;
+    }
+    int number = 0;
+    return parse_int(keyword.substr(2), number) && number > 0 ? number : -1;
+}
+
+std::vector<std::string> card_parameters(const CardView& card) {
+    if (card.hasShorthand()) {
+        return card.expandedParameters();
+    }
+    std::vector<std::string> out;
+    out.reserve(card.parameterCount());
+    for (std::size_t i = 0; i < card.parameterCount(); ++i) {
+        out.emplace_back(card.parameter(i));
+    }
+    return out;
+}
+
+} // namespace
+
+SurfaceCompileResult compileSurfaces(const Ast& ast) {
+    SurfaceCompileResult result;
+    std::vector<std::size_t> surfaces;
+    std::vector<double> values;
+    for (std::size_t i = 0; i < ast.cardCount(); ++i) {
+        const CardView card = ast.card(i);
+        if (card.kind() == CardKind::Surface) {
+            surfaces.push_back(i);
+            continue;
+        }
+        bool degrees = false;
+        const int number = card.kind() == CardKind::Data ? transform_number(card.keyword(), degrees) : -1;
+        if (number < 0) {
+            continue;
+        }
+        values.clear();
+        bool valid = true;
+        for (const std::string& text : card_parameters(card)) {
+            double value = 0.0;
+            valid = valid && parse_number(text, value);
+            values.push_back(value);
+        }
+        std::string error;
+        const auto transform = valid ? mcnp::core::SurfaceTransform::fromCard(values, degrees, &error) : std::nullopt;
+        if (!transform) {
+            result.errors.push_back({card.line(), valid ? error : "invalid number on " + std::string(card.keyword()),
+                                     std::string(card.source())});
+            continue;
+        }
+        result.transforms[number] = *transform;
+    }
+
+    result.table.reserve(surfaces.size());
+    updateSurfaces(ast, surfaces, {}, result);
+    return result;
+}
+
+void updateSurfaces(const Ast& ast, std::span<const std::size_t> cards, std::span<const int> removed,
+                    SurfaceCompileResult& result) {
+    using mcnp::core::BoundaryKind;
+    for (const int id : removed) {
+        result.table.remove(id);
+        result.transformOf.erase(id);
+    }
+
+    auto report = [&](const CardView& card, std::string message) {
+        result.errors.push_back({card.line(), std::move(message), std::string(card.source())});
+    };
+    std::vector<double> values;
+    std::vector<std::pair<int, int>> periodic;
+    for (const std::size_t index : cards) {
+        const CardView card = ast.card(index);
+        std::string_view name = card.keyword();
+        BoundaryKind boundary = BoundaryKind::None;
+        if (!name.empty() && (name.front() == '*' || name.front() == '+')) {
+            boundary = name.front() == '*' ? BoundaryKind::Reflecting : BoundaryKind::White;
+            name.remove_prefix(1);
+        }
+        int id = 0;
+        if (!parse_int(name, id) || id <= 0) {
+            report(card, "invalid surface number " + std::string(card.keyword()));
+            continue;
+        }
+
+        const std::vector<std::string> parameters = card_parameters(card);
+        std::size_t next = 0;
+        const mcnp::core::SurfaceTransform* transform = nullptr;
+        int modifier = 0;
+        if (!parameters.empty() && parse_int(parameters[0], modifier)) {
+            next = 1;
+            if (modifier > 0) {
+                // 即使 TR 未定义也记录依赖，补上 TR 卡后能找到受影响的曲面
+                result.transformOf[id] = modifier;
+                const auto it = result.transforms.find(modifier);
+                if (it == result.transforms.end()) {
+                    report(card, "surface " + std::to_string(id) + " uses undefined TR" + std::to_string(modifier));
+                    continue;
+                }
+                transform = &it->second;
+            } else if (modifier < 0) {
+                periodic.emplace_back(id, -modifier);
+            }
+        }
+        if (next >= parameters.size()) {
+            report(card, "surface " + std::to_string(id) + " has no mnemonic");
+            continue;
+        }
+
+        values.clear();
+        bool valid = true;
+        for (std::size_t p = next + 1; p < parameters.size() && valid; ++p) {
+            double value = 0.0;
+            valid = parse_number(parameters[p], value);
+            values.push_back(value);
+        }
+        if (!valid) {
+            report(card, "invalid number on surface " + std::to_string(id));
+            continue;
+        }
+        std::string error;
+        if (!result.table.add(id, parameters[next], values, transform, boundary, &error)) {
+            report(card, error);
+        }
+    }
+    for (const auto& [id, partner] : periodic) {
+        result.table.setPeriodicPartner(id, partner);
+    }
+}
+
+} // namespace mcnp::parser
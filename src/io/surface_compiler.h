@@ -0,0 +1,30 @@
+#ifndef SURFACE_COMPILER_H
+#define SURFACE_COMPILER_H
+
+#include "mcnp_parser.h"
+#include "surface_table.h"
+
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace mcnp::parser {
+
+struct SurfaceCompileResult {
+    mcnp::core::SurfaceTable table;
+    std::unordered_map<int, mcnp::core::SurfaceTransform> transforms;  // TRn 卡片
+    std::unordered_map<int, int> transformOf;                          // 曲面号 -> 所用 TR 号
+    std::vector<ParseError> errors;
+};
+
+// 把 AST 中的曲面卡片与 TRn/*TRn 卡片编译为 SoA 曲面表，数值只解析一次
+SurfaceCompileResult compileSurfaces(const Ast& ast);
+
+// 增量更新：先移除 removed 中的曲面，再编译 cards（曲面卡片下标）；
+// 沿用 result 中已有的 TR，TR 卡片本身变化时应重新全量编译
+void updateSurfaces(const Ast& ast, std::span<const std::size_t> cards, std::span<const int> removed,
+                    SurfaceCompileResult& result);
+
+} // namespace mcnp::parser
+
+#endif // SURFACE_COMPILER_H
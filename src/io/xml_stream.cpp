@@ -0,0 +1,448 @@
+#include "xml_stream.h"
+
+#include <algorithm>
+#include <charconv>
+
+namespace mcnp::parser {
+
+namespace {
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool is_name_char(char c) {
+    return !is_space(c) && c != '>' && c != '/' && c != '=' && c != '<' && c != '"' && c != '\'';
+}
+
+// 解码 &lt; &gt; &amp; &quot; &apos; 与数字字符引用 &#n; / &#xn;（按 UTF-8 编码）
+bool decode_entities(std::string_view raw, std::string& out) {
+    out.clear();
+    std::size_t i = 0;
+    while (i < raw.size()) {
+        const std::size_t amp = raw.find('&', i);
+        out.append(raw.substr(i, amp == std::string_view::npos ? std::string_view::npos : amp - i));
+        if (amp == std::string_view::npos) {
+            return true;
+        }
+        const std::size_t semi = raw.find(';', amp);
+        if (semi == std::string_view::npos) {
+            return false;
+        }
+        const std::string_view entity = raw.substr(amp + 1, semi - amp - 1);
+        if (entity == "lt") {
+            out += '<';
+        } else if (entity == "gt") {
+            out += '>';
+        } else if (entity == "amp") {
+            out += '&';
+        } else if (entity == "quot") {
+            out += '"';
+        } else if (entity == "apos") {
+            out += '\'';
+        } else if (entity.size() > 1 && entity.front() == '#') {
+            const bool hex = entity[1] == 'x' || entity[1] == 'X';
+            const std::string_view digits = entity.substr(hex ? 2 : 1);
+            unsigned code = 0;
+            const auto result = std::from_chars(digits.data(), digits.data() + digits.size(), code, hex ? 16 : 10);
+            if (result.ec != std::errc() || result.ptr != digits.data() + digits.size()) {
+                return false;
+            }
+            if (code < 0x80) {
+                out += static_cast<char>(code);
+            } else if (code < 0x800) {
+                out += static_cast<char>(0xC0 | (code >> 6));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            } else {
+                out += static_cast<char>(0xE0 | (code >> 12));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            }
+        } else {
+            return false;
+        }
+        i = semi + 1;
+    }
+    return true;
+}
+
+std::string_view format(double value, char (&buffer)[32]) {
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value == 0.0 ? 0.0 : value);
+    return {buffer, static_cast<std::size_t>(result.ptr - buffer)};
+}
+
+} // namespace
+
+std::string_view XmlReader::attribute(std::string_view name) const noexcept {
+    for (const XmlAttribute& a : attributes_) {
+        if (a.name == name) {
+            return a.value;
+        }
+    }
+    return {};
+}
+
+bool XmlReader::hasAttribute(std::string_view name) const noexcept {
+    return std::any_of(attributes_.begin(), attributes_.end(), [&](const XmlAttribute& a) { return a.name == name; });
+}
+
+std::size_t XmlReader::line() const noexcept {
+    const std::size_t end = std::min(position_, text_.size());
+    if (end < lineOffset_) {
+        lineOffset_ = 0;
+        lineNumber_ = 1;
+    }
+    const std::string_view scanned = text_.substr(lineOffset_, end - lineOffset_);
+    lineNumber_ += static_cast<std::size_t>(std::count(scanned.begin(), scanned.end(), '\n'));
+    lineOffset_ = end;
+    return lineNumber_;
+}
+
+XmlReader::Event XmlReader::fail(std::string message) {
+    error_ = std::move(message);
+    return Event::Error;
+}
+
+// 跳过 <? ?>、<!-- -->、<![CDATA[ ]]> 与 <!DOCTYPE …>（含内部子集）；不在标记上时返回 false
+bool XmlReader::skipMarkup() {
+    const std::string_view rest = text_.substr(position_);
+    std::string_view close;
+    if (rest.starts_with("<?")) {
+        close = "?>";
+    } else if (rest.starts_with("<!--")) {
+        close = "-->";
+    } else if (rest.starts_with("<![CDATA[")) {
+        close = "]]>";
+    } else if (rest.starts_with("<!")) {
+        // DOCTYPE 的内部子集中可能有 '>'，按方括号配对
+        int brackets = 0;
+        for (std::size_t i = position_ + 2; i < text_.size(); ++i) {
+            const char c = text_[i];
+            brackets += c == '[' ? 1 : c == ']' ? -1 : 0;
+            if (c == '>' && brackets <= 0) {
+                position_ = i + 1;
+                return true;
+            }
+        }
+        position_ = text_.size();
+        return true;
+    } else {
+        return false;
+    }
+    const std::size_t end = text_.find(close, position_);
+    position_ = end == std::string_view::npos ? text_.size() : end + close.size();
+    return true;
+}
+
+bool XmlReader::decode(std::string_view raw, std::size_t attribute) {
+    if (decoded_.size() <= attribute) {
+        decoded_.resize(attribute + 1);
+    }
+    if (!decode_entities(raw, decoded_[attribute])) {
+        error_ = "invalid entity in attribute '" + std::string(attributes_[attribute].name) + "'";
+        return false;
+    }
+    return true;
+}
+
+bool XmlReader::parseStart() {
+    std::size_t i = position_ + 1;
+    const std::size_t nameStart = i;
+    while (i < text_.size() && is_name_char(text_[i])) {
+        ++i;
+    }
+    name_ = text_.substr(nameStart, i - nameStart);
+    if (name_.empty()) {
+        error_ = "element without name";
+        return false;
+    }
+    attributes_.clear();
+    std::vector<std::size_t> entities;
+    for (;;) {
+        while (i < text_.size() && is_space(text_[i])) {
+            ++i;
+        }
+        if (i >= text_.size()) {
+            error_ = "unterminated start tag <" + std::string(name_) + ">";
+            return false;
+        }
+        if (text_[i] == '>') {
+            position_ = i + 1;
+            pendingEnd_ = false;
+            break;
+        }
+        if (text_[i] == '/') {
+            if (i + 1 >= text_.size() || text_[i + 1] != '>') {
+                error_ = "expected '/>' in <" + std::string(name_) + ">";
+                return false;
+            }
+            position_ = i + 2;
+            pendingEnd_ = true;
+            break;
+        }
+        const std::size_t attributeStart = i;
+        while (i < text_.size() && is_name_char(text_[i])) {
+            ++i;
+        }
+        const std::string_view attributeName = text_.substr(attributeStart, i - attributeStart);
+        while (i < text_.size() && is_space(text_[i])) {
+            ++i;
+        }
+        if (attributeName.empty() || i >= text_.size() || text_[i] != '=') {
+            error_ = "malformed attribute in <" + std::string(name_) + ">";
+            return false;
+        }
+        ++i;
+        while (i < text_.size() && is_space(text_[i])) {
+            ++i;
+        }
+        if (i >= text_.size() || (text_[i] != '"' && text_[i] != '\'')) {
+            error_ = "unquoted value of attribute '" + std::string(attributeName) + "'";
+            return false;
+        }
+        const char quote = text_[i];
+        const std::size_t valueStart = i + 1;
+        const std::size_t valueEnd = text_.find(quote, valueStart);
+        if (valueEnd == std::string_view::npos) {
+            error_ = "unterminated value of attribute '" + std::string(attributeName) + "'";
+            return false;
+        }
+        const std::string_view value = text_.substr(valueStart, valueEnd - valueStart);
+        attributes_.push_back({attributeName, value});
+        if (value.find('&') != std::string_view::npos) {
+            entities.push_back(attributes_.size() - 1);
+        }
+        i = valueEnd + 1;
+    }
+    // 全部属性读完后再解码，decoded_ 不再扩容，视图保持有效
+    for (const std::size_t a : entities) {
+        if (!decode(attributes_[a].value, a)) {
+            return false;
+        }
+    }
+    for (const std::size_t a : entities) {
+        attributes_[a].value = decoded_[a];
+    }
+    return true;
+}
+
+XmlReader::Event XmlReader::next() {
+    if (!error_.empty()) {
+        return Event::Error;
+    }
+    if (pendingEnd_) {
+        pendingEnd_ = false;
+        stack_.pop_back();
+        attributes_.clear();
+        return Event::End;
+    }
+    for (;;) {
+        const std::size_t lt = text_.find('<', position_);
+        // 元素间的文本只检查实体引用：外部实体（&materials; 之类）无法展开
+        const std::string_view between = text_.substr(position_, lt == std::string_view::npos ? std::string_view::npos
+                                                                                               : lt - position_);
+        if (!stack_.empty() && between.find('&') != std::string_view::npos) {
+            position_ += between.find('&');
+            return fail("entity references in element content are not supported");
+        }
+        if (lt == std::string_view::npos) {
+            position_ = text_.size();
+            if (!stack_.empty()) {
+                return fail("unexpected end of input inside <" + std::string(stack_.back()) + ">");
+            }
+            return Event::Eof;
+        }
+        position_ = lt;
+        if (skipMarkup()) {
+            continue;
+        }
+        tagOffset_ = lt;
+        if (position_ + 1 < text_.size() && text_[position_ + 1] == '/') {
+            const std::size_t gt = text_.find('>', position_);
+            if (gt == std::string_view::npos) {
+                return fail("unterminated end tag");
+            }
+            std::string_view name = text_.substr(position_ + 2, gt - position_ - 2);
+            while (!name.empty() && is_space(name.back())) {
+                name.remove_suffix(1);
+            }
+            if (stack_.empty() || stack_.back() != name) {
+                return fail("mismatched end tag </" + std::string(name) + ">");
+            }
+            stack_.pop_back();
+            name_ = name;
+            attributes_.clear();
+            position_ = gt + 1;
+            return Event::End;
+        }
+        if (!parseStart()) {
+            return Event::Error;
+        }
+        stack_.push_back(name_);
+        return Event::Start;
+    }
+}
+
+XmlWriter::XmlWriter(std::ostream& out, std::size_t bufferSize) : out_(out), bufferSize_(bufferSize) {
+    buffer_.reserve(bufferSize_ + 256);
+}
+
+XmlWriter::~XmlWriter() {
+    flush();
+}
+
+void XmlWriter::put(std::string_view text) {
+    buffer_ += text;
+    if (buffer_.size() >= bufferSize_) {
+        bytes_ += buffer_.size();
+        out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        buffer_.clear();
+    }
+}
+
+void XmlWriter::indent() {
+    buffer_ += '\n';
+    buffer_.append(2 * stack_.size(), ' ');
+}
+
+void XmlWriter::closeTag() {
+    if (tagOpen_) {
+        buffer_ += '>';
+        tagOpen_ = false;
+    }
+}
+
+void XmlWriter::escaped(std::string_view value, bool attribute) {
+    std::size_t from = 0;
+    for (std::size_t i = 0; i < value.size(); ++i) {
+        const char c = value[i];
+        const char* entity = c == '<' ? "&lt;" : c == '>' ? "&gt;" : c == '&' ? "&amp;"
+                                                : attribute && c == '"' ? "&quot;" : nullptr;
+        if (entity) {
+            buffer_.append(value.substr(from, i - from));
+            buffer_ += entity;
+            from = i + 1;
+        }
+    }
+    put(value.substr(from));
+}
+
+void XmlWriter::declaration() {
+    put("<?xml version=\"1.0\" encoding=\"UTF-8\"?>");
+}
+
+void XmlWriter::start(std::string_view name) {
+    closeTag();
+    if (!buffer_.empty() || bytes_ > 0) {
+        indent();
+    }
+    buffer_ += '<';
+    put(name);
+    stack_.emplace_back(name);
+    tagOpen_ = true;
+    inlineText_ = false;
+}
+
+void XmlWriter::attribute(std::string_view name, std::string_view value) {
+    buffer_ += ' ';
+    buffer_ += name;
+    buffer_ += "=\"";
+    escaped(value, true);
+    buffer_ += '"';
+}
+
+void XmlWriter::attribute(std::string_view name, double value) {
+    char buffer[32];
+    attribute(name, format(value, buffer));
+}
+
+void XmlWriter::attribute(std::string_view name, int value) {
+    char buffer[16];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    attribute(name, std::string_view(buffer, static_cast<std::size_t>(result.ptr - buffer)));
+}
+
+void XmlWriter::attribute(std::string_view name, std::size_t value) {
+    char buffer[24];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    attribute(name, std::string_view(buffer, static_cast<std::size_t>(result.ptr - buffer)));
+}
+
+void XmlWriter::text(std::string_view value) {
+    closeTag();
+    escaped(value, false);
+    inlineText_ = true;
+}
+
+void XmlWriter::numbers(std::span<const double> values) {
+    closeTag();
+    char buffer[32];
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        if (i > 0) {
+            buffer_ += ' ';
+        }
+        put(format(values[i], buffer));
+    }
+    inlineText_ = true;
+}
+
+void XmlWriter::numbers(std::span<const int> values) {
+    closeTag();
+    char buffer[16];
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        if (i > 0) {
+            buffer_ += ' ';
+        }
+        const auto result = std::to_chars(buffer, buffer + sizeof(buffer), values[i]);
+        put(std::string_view(buffer, static_cast<std::size_t>(result.ptr - buffer)));
+    }
+    inlineText_ = true;
+}
+
+void XmlWriter::end() {
+    if (stack_.empty()) {
+        return;
+    }
+    const std::string name = std::move(stack_.back());
+    stack_.pop_back();
+    if (tagOpen_) {
+        buffer_ += "/>";
+        tagOpen_ = false;
+    } else {
+        if (!inlineText_) {
+            indent();
+        }
+        buffer_ += "</";
+        buffer_ += name;
+        buffer_ += '>';
+    }
+    inlineText_ = false;
+    put({});
+}
+
+void XmlWriter::comment(std::string_view text) {
+    closeTag();
+    indent();
+    buffer_ += "<!-- ";
+    put(text);
+    buffer_ += " -->";
+    inlineText_ = false;
+}
+
+void XmlWriter::raw(std::string_view xml) {
+    closeTag();
+    indent();
+    put(xml);
+    inlineText_ = false;
+}
+
+void XmlWriter::flush() {
+    if (!buffer_.empty()) {
+        bytes_ += buffer_.size();
+        out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        buffer_.clear();
+    }
+    out_.flush();
+}
+
+} // namespace mcnp::parser
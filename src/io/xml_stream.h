@@ -0,0 +1,115 @@
+#ifndef XML_STREAM_H
+#define XML_STREAM_H
+
+#include <cstddef>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mcnp::parser {
+
+struct XmlAttribute {
+    std::string_view name;
+    std::string_view value;  // 实体已解码
+};
+
+// 拉取式 XML 读取器：逐个给出开始/结束标签，名称与属性值直接指向输入，不建 DOM。
+// 自闭合元素先给出 Start 再给出 End；注释、处理指令、DOCTYPE 与 CDATA 跳过，
+// 元素间的文本忽略（GDML 等几何格式不使用文本内容）。
+class XmlReader {
+public:
+    enum class Event {
+        Start,
+        End,
+        Eof,
+        Error
+    };
+
+    explicit XmlReader(std::string_view text) noexcept : text_(text) {}
+
+    Event next();
+
+    std::string_view name() const noexcept { return name_; }
+    std::span<const XmlAttribute> attributes() const noexcept { return attributes_; }
+    // 不存在时为空串
+    std::string_view attribute(std::string_view name) const noexcept;
+    bool hasAttribute(std::string_view name) const noexcept;
+
+    // Start 时为当前元素的层数（根元素为 1），End 时为其父元素的层数
+    std::size_t depth() const noexcept { return stack_.size(); }
+    // 当前标签的 '<' 与读过的位置（标签之后）在输入中的字节偏移
+    std::size_t tagOffset() const noexcept { return tagOffset_; }
+    std::size_t offset() const noexcept { return position_; }
+    // 当前位置的行号（从 1 起），按需增量计数
+    std::size_t line() const noexcept;
+    const std::string& error() const noexcept { return error_; }
+
+private:
+    Event fail(std::string message);
+    bool skipMarkup();
+    bool parseStart();
+    bool decode(std::string_view raw, std::size_t attribute);
+
+    std::string_view text_;
+    std::size_t position_ = 0;
+    std::size_t tagOffset_ = 0;
+    std::string_view name_;
+    std::vector<XmlAttribute> attributes_;
+    std::vector<std::string_view> stack_;
+    std::vector<std::string> decoded_;  // 含实体的属性值，按属性下标复用
+    bool pendingEnd_ = false;
+    std::string error_;
+    mutable std::size_t lineOffset_ = 0;
+    mutable std::size_t lineNumber_ = 1;
+};
+
+// 流式 XML 写出：与 CardWriter 相同，文本先进缓冲区，攒够 bufferSize 字节才写入流。
+// start/attribute/end 维护元素栈：子元素开始时补上父元素的 '>'，没有子元素的元素写成自闭合。
+class XmlWriter {
+public:
+    explicit XmlWriter(std::ostream& out, std::size_t bufferSize = 1 << 16);
+    ~XmlWriter();
+
+    XmlWriter(const XmlWriter&) = delete;
+    XmlWriter& operator=(const XmlWriter&) = delete;
+
+    void declaration();
+    void start(std::string_view name);
+    void attribute(std::string_view name, std::string_view value);
+    void attribute(std::string_view name, const char* value) { attribute(name, std::string_view(value)); }
+    void attribute(std::string_view name, double value);
+    void attribute(std::string_view name, int value);
+    void attribute(std::string_view name, std::size_t value);
+    // 元素文本（转义）；之后的 end 与文本写在同一行
+    void text(std::string_view value);
+    // 以空白分隔的数值序列作为元素文本
+    void numbers(std::span<const double> values);
+    void numbers(std::span<const int> values);
+    void end();
+    void comment(std::string_view text);
+    // 原样写出一段已格式化的 XML（例如从输入中保留下来的片段）
+    void raw(std::string_view xml);
+
+    void flush();
+    std::size_t bytes() const noexcept { return bytes_ + buffer_.size(); }
+
+private:
+    void closeTag();
+    void indent();
+    void escaped(std::string_view value, bool attribute);
+    void put(std::string_view text);
+
+    std::ostream& out_;
+    std::size_t bufferSize_;
+    std::string buffer_;
+    std::vector<std::string> stack_;
+    bool tagOpen_ = false;     // 当前元素的开始标签还没写 '>'
+    bool inlineText_ = false;  // 当前元素只有文本，结束标签不换行
+    std::size_t bytes_ = 0;
+};
+
+} // namespace mcnp::parser
+
+#endif // XML_STREAM_H
@@ -27,6 +27,8 @@
 #include "ui/UILayoutManager.h"
 #include "ui/input_control.h"
 #include "render/Framebuffer.h"
+#include "render/lattice_renderer.h"
+#include "render/volume_renderer.h"
 
 // 全局变量定义 - 现在从config_manager.h获取
 
@@ -53,6 +55,11 @@ static void RenderSceneToViewport(int viewportW, int viewportH)
     for (size_t i = 0; i < meshes.size(); i++) {
         renderMesh(meshes[i]);
     }
+    mcnp::ui::RenderMeshTallyIsosurface();
+    mcnp::render::SceneLatticeRenderer().Draw(sceneState.viewMatrix, sceneState.projectionMatrix, sceneState.cameraPosition);
+    mcnp::ui::RenderSourcePreview(sceneState.viewMatrix, sceneState.projectionMatrix);
+    // 体绘制在不透明几何之后，按其深度截断光线
+    mcnp::render::SceneVolumeRenderer().Draw(sceneState.viewMatrix, sceneState.projectionMatrix, sceneState.cameraPosition);
     renderCoordinateSystem(sceneState.viewMatrix, sceneState.projectionMatrix, sceneState.cameraDistance);
 }
 
@@ -0,0 +1,187 @@
+#include "lattice_renderer.h"
+#include "shader_program.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstddef>
+
+namespace mcnp::render {
+
+namespace {
+
+const char* kInstancedVertexShader = R"(
+    #version 330 core
+    layout (location = 0) in vec3 aPos;
+    layout (location = 1) in vec3 aNormal;
+    layout (location = 2) in vec3 aColor;
+    layout (location = 3) in mat4 aInstance;
+
+    out vec3 FragPos;
+    out vec3 Normal;
+    out vec3 Color;
+
+    uniform mat4 view;
+    uniform mat4 projection;
+
+    void main()
+    {
+        FragPos = vec3(aInstance * vec4(aPos, 1.0));
+        Normal = mat3(aInstance) * aNormal;
+        Color = aColor;
+        gl_Position = projection * view * vec4(FragPos, 1.0);
+    }
+)";
+
+// 与主着色器一致的简化光照
+const char* kInstancedFragmentShader = R"(
+    #version 330 core
+    in vec3 FragPos;
+    in vec3 Normal;
+    in vec3 Color;
+
+    out vec4 FragColor;
+
+    uniform vec3 viewPos;
+
+    void main()
+    {
+        vec3 norm = normalize(Normal);
+        vec3 lightDir = normalize(vec3(2.0, 5.0, 2.0) - FragPos);
+        float diff = max(dot(norm, lightDir), 0.0);
+        vec3 viewDir = normalize(viewPos - FragPos);
+        float spec = pow(max(dot(viewDir, reflect(-lightDir, norm)), 0.0), 64);
+        FragColor = vec4((0.15 + diff + 0.3 * spec) * Color, 1.0);
+    }
+)";
+
+} // namespace
+
+LatticeRenderer& SceneLatticeRenderer()
+{
+    static LatticeRenderer renderer;
+    return renderer;
+}
+
+void LatticeRenderer::SetScene(const mcnp::core::UniverseResolver* resolver, int rootUniverse)
+{
+    resolver_ = resolver;
+    rootUniverse_ = rootUniverse;
+    batches_.clear();
+}
+
+void LatticeRenderer::EnsureProgram()
+{
+    if (program_ != 0) {
+        return;
+    }
+    program_ = CompileProgram(kInstancedVertexShader, kInstancedFragmentShader, "LatticeRenderer");
+    viewLoc_ = glGetUniformLocation(program_, "view");
+    projectionLoc_ = glGetUniformLocation(program_, "projection");
+    viewPosLoc_ = glGetUniformLocation(program_, "viewPos");
+}
+
+void LatticeRenderer::SetUniverseMesh(int universe, const Mesh& mesh)
+{
+    GpuMesh& gpu = meshes_[universe];
+    Release(gpu);
+
+    glGenVertexArrays(1, &gpu.vao);
+    glGenBuffers(1, &gpu.vbo);
+    glGenBuffers(1, &gpu.ebo);
+    glGenBuffers(1, &gpu.instanceVbo);
+    glBindVertexArray(gpu.vao);
+
+    // 顶点布局与 renderMesh 相同
+    glBindBuffer(GL_ARRAY_BUFFER, gpu.vbo);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(mesh.vertices.size() * sizeof(Vertex)), mesh.vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpu.ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(mesh.indices.size() * sizeof(unsigned int)), mesh.indices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, color));
+    glEnableVertexAttribArray(2);
+
+    // 实例矩阵占用 4 个属性槽，每实例前进一次
+    glBindBuffer(GL_ARRAY_BUFFER, gpu.instanceVbo);
+    for (int column = 0; column < 4; ++column) {
+        const GLuint location = static_cast<GLuint>(3 + column);
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(sizeof(glm::vec4) * column));
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    gpu.indexCount = static_cast<GLsizei>(mesh.indices.size());
+}
+
+void LatticeRenderer::ClearMeshes()
+{
+    for (auto& entry : meshes_) {
+        Release(entry.second);
+    }
+    meshes_.clear();
+    batches_.clear();
+}
+
+void LatticeRenderer::Draw(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos)
+{
+    if (!resolver_ || meshes_.empty()) {
+        return;
+    }
+    EnsureProgram();
+    if (program_ == 0) {
+        return;
+    }
+
+    mcnp::core::LatticeInstancer instancer(*resolver_);
+    instancer.setDrawable([this](int universe) { return meshes_.count(universe) != 0; });
+    const auto frustum = mcnp::core::Frustum::fromMatrix(glm::dmat4(projection * view));
+    stats_ = instancer.collect(rootUniverse_, &frustum, batches_);
+
+    glUseProgram(program_);
+    glUniformMatrix4fv(viewLoc_, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(projectionLoc_, 1, GL_FALSE, glm::value_ptr(projection));
+    glUniform3fv(viewPosLoc_, 1, glm::value_ptr(viewPos));
+
+    for (const auto& batch : batches_) {
+        auto it = meshes_.find(batch.universe);
+        if (it == meshes_.end() || it->second.indexCount == 0) {
+            continue;
+        }
+        GpuMesh& gpu = it->second;
+        const std::size_t count = batch.transforms.size();
+        const auto bytes = static_cast<GLsizeiptr>(count * sizeof(glm::mat4));
+        glBindBuffer(GL_ARRAY_BUFFER, gpu.instanceVbo);
+        if (count > gpu.instanceCapacity) {
+            glBufferData(GL_ARRAY_BUFFER, bytes, batch.transforms.data(), GL_STREAM_DRAW);
+            gpu.instanceCapacity = count;
+        } else {
+            glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, batch.transforms.data());
+        }
+        glBindVertexArray(gpu.vao);
+        glDrawElementsInstanced(GL_TRIANGLES, gpu.indexCount, GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(count));
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void LatticeRenderer::Release(GpuMesh& mesh)
+{
+    if (mesh.instanceVbo) { glDeleteBuffers(1, &mesh.instanceVbo); mesh.instanceVbo = 0; }
+    if (mesh.ebo) { glDeleteBuffers(1, &mesh.ebo); mesh.ebo = 0; }
+    if (mesh.vbo) { glDeleteBuffers(1, &mesh.vbo); mesh.vbo = 0; }
+    if (mesh.vao) { glDeleteVertexArrays(1, &mesh.vao); mesh.vao = 0; }
+    mesh.indexCount = 0;
+    mesh.instanceCapacity = 0;
+}
+
+void LatticeRenderer::Destroy()
+{
+    ClearMeshes();
+    if (program_) { glDeleteProgram(program_); program_ = 0; }
+}
+
+} // namespace mcnp::render
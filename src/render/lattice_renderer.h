@@ -0,0 +1,62 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "lattice_instancer.h"
+#include "vertex_mesh.h"
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+namespace mcnp::render {
+
+// LAT/FILL 几何的实例化渲染：每个宇宙的网格只上传一次，
+// 每帧由 LatticeInstancer 按视锥剔除生成实例矩阵并 glDrawElementsInstanced 绘制。
+class LatticeRenderer {
+public:
+    LatticeRenderer() = default;
+    ~LatticeRenderer() { Destroy(); }
+
+    LatticeRenderer(const LatticeRenderer&) = delete;
+    LatticeRenderer& operator=(const LatticeRenderer&) = delete;
+
+    // resolver 需在渲染期间保持有效；传 nullptr 关闭绘制
+    void SetScene(const mcnp::core::UniverseResolver* resolver, int rootUniverse = 0);
+    void SetUniverseMesh(int universe, const Mesh& mesh);
+    bool HasUniverseMesh(int universe) const { return meshes_.count(universe) != 0; }
+    void ClearMeshes();
+
+    void Draw(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos);
+
+    const mcnp::core::InstanceStats& LastStats() const noexcept { return stats_; }
+
+private:
+    struct GpuMesh {
+        GLuint vao = 0;
+        GLuint vbo = 0;
+        GLuint ebo = 0;
+        GLuint instanceVbo = 0;
+        GLsizei indexCount = 0;
+        std::size_t instanceCapacity = 0;
+    };
+
+    void EnsureProgram();
+    static void Release(GpuMesh& mesh);
+    void Destroy();
+
+    const mcnp::core::UniverseResolver* resolver_{nullptr};
+    int rootUniverse_{0};
+    std::unordered_map<int, GpuMesh> meshes_;
+    std::vector<mcnp::core::InstanceBatch> batches_;
+    mcnp::core::InstanceStats stats_;
+    GLuint program_{0};
+    GLint viewLoc_{-1};
+    GLint projectionLoc_{-1};
+    GLint viewPosLoc_{-1};
+};
+
+// 视口共享的栅格渲染器（由 RenderSceneToViewport 绘制）
+LatticeRenderer& SceneLatticeRenderer();
+
+} // namespace mcnp::render
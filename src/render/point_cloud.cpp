@@ -0,0 +1,137 @@
+#include "point_cloud.h"
+#include "shader_program.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+
+namespace mcnp::render {
+
+namespace {
+
+const char* kPointVertexShader = R"(
+    #version 330 core
+    layout (location = 0) in vec4 aPointEnergy;
+
+    uniform mat4 view;
+    uniform mat4 projection;
+    uniform float pointSize;
+    uniform vec2 energyRange;
+    uniform bool logScale;
+
+    out float vT;
+
+    void main()
+    {
+        gl_Position = projection * view * vec4(aPointEnergy.xyz, 1.0);
+        gl_PointSize = pointSize;
+        float e = aPointEnergy.w;
+        float lo = energyRange.x;
+        float hi = energyRange.y;
+        if (logScale) {
+            e = log(max(e, 1e-12));
+            lo = log(max(lo, 1e-12));
+            hi = log(max(hi, 1e-12));
+        }
+        vT = clamp((e - lo) / max(hi - lo, 1e-12), 0.0, 1.0);
+    }
+)";
+
+// 近似 turbo 色图
+const char* kPointFragmentShader = R"(
+    #version 330 core
+    in float vT;
+    out vec4 FragColor;
+
+    void main()
+    {
+        vec2 c = gl_PointCoord * 2.0 - 1.0;
+        if (dot(c, c) > 1.0) discard;
+        vec3 color = clamp(vec3(
+            1.5 - abs(4.0 * vT - 3.0),
+            1.5 - abs(4.0 * vT - 2.0),
+            1.5 - abs(4.0 * vT - 1.0)), 0.0, 1.0);
+        FragColor = vec4(color, 1.0);
+    }
+)";
+
+} // namespace
+
+void PointCloud::EnsureResources()
+{
+    if (program_ == 0) {
+        program_ = CompileProgram(kPointVertexShader, kPointFragmentShader, "PointCloud");
+        viewLoc_ = glGetUniformLocation(program_, "view");
+        projectionLoc_ = glGetUniformLocation(program_, "projection");
+        pointSizeLoc_ = glGetUniformLocation(program_, "pointSize");
+        energyRangeLoc_ = glGetUniformLocation(program_, "energyRange");
+        logScaleLoc_ = glGetUniformLocation(program_, "logScale");
+    }
+    if (vao_ == 0) {
+        glGenVertexArrays(1, &vao_);
+        glGenBuffers(1, &vbo_);
+        glBindVertexArray(vao_);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), nullptr);
+        glEnableVertexAttribArray(0);
+        glBindVertexArray(0);
+    }
+}
+
+std::size_t PointCloud::Upload(const std::vector<float>& x, const std::vector<float>& y,
+                               const std::vector<float>& z, const std::vector<float>& energy,
+                               std::size_t maxPoints)
+{
+    EnsureResources();
+    const std::size_t total = std::min({x.size(), y.size(), z.size(), energy.size()});
+    const std::size_t stride = maxPoints == 0 ? 1 : std::max<std::size_t>(1, (total + maxPoints - 1) / maxPoints);
+    count_ = (total + stride - 1) / stride;
+
+    std::vector<float> interleaved(count_ * 4);
+    for (std::size_t i = 0, j = 0; i < total; i += stride, ++j) {
+        interleaved[j * 4 + 0] = x[i];
+        interleaved[j * 4 + 1] = y[i];
+        interleaved[j * 4 + 2] = z[i];
+        interleaved[j * 4 + 3] = energy[i];
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    const auto bytes = static_cast<GLsizeiptr>(interleaved.size() * sizeof(float));
+    if (count_ > capacity_) {
+        glBufferData(GL_ARRAY_BUFFER, bytes, interleaved.data(), GL_DYNAMIC_DRAW);
+        capacity_ = count_;
+    } else if (bytes > 0) {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, interleaved.data());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return count_;
+}
+
+void PointCloud::Draw(const glm::mat4& view, const glm::mat4& projection, float pointSize,
+                      float minEnergy, float maxEnergy, bool logScale) const
+{
+    if (count_ == 0 || program_ == 0) {
+        return;
+    }
+    glEnable(GL_PROGRAM_POINT_SIZE);
+    glUseProgram(program_);
+    glUniformMatrix4fv(viewLoc_, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(projectionLoc_, 1, GL_FALSE, glm::value_ptr(projection));
+    glUniform1f(pointSizeLoc_, pointSize);
+    glUniform2f(energyRangeLoc_, minEnergy, maxEnergy);
+    glUniform1i(logScaleLoc_, logScale ? 1 : 0);
+    glBindVertexArray(vao_);
+    glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(count_));
+    glBindVertexArray(0);
+    glDisable(GL_PROGRAM_POINT_SIZE);
+}
+
+void PointCloud::Destroy()
+{
+    if (vbo_) { glDeleteBuffers(1, &vbo_); vbo_ = 0; }
+    if (vao_) { glDeleteVertexArrays(1, &vao_); vao_ = 0; }
+    if (program_) { glDeleteProgram(program_); program_ = 0; }
+    count_ = capacity_ = 0;
+}
+
+} // namespace mcnp::render
@@ -0,0 +1,48 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace mcnp::render {
+
+// 源粒子点云：每点上传 (x, y, z, energy)，着色器按能量映射颜色。
+// 点数超过上限时按步长抽稀，避免千万级粒子占满显存。
+class PointCloud {
+public:
+    PointCloud() = default;
+    ~PointCloud() { Destroy(); }
+
+    PointCloud(const PointCloud&) = delete;
+    PointCloud& operator=(const PointCloud&) = delete;
+
+    // 输入为 SoA 数组；返回实际上传的点数
+    std::size_t Upload(const std::vector<float>& x, const std::vector<float>& y,
+                       const std::vector<float>& z, const std::vector<float>& energy,
+                       std::size_t maxPoints = 2'000'000);
+
+    // energy 范围用于颜色映射；logScale 为真时按对数能量着色
+    void Draw(const glm::mat4& view, const glm::mat4& projection, float pointSize,
+              float minEnergy, float maxEnergy, bool logScale) const;
+
+    void Clear() { count_ = 0; }
+    std::size_t Count() const noexcept { return count_; }
+
+private:
+    void EnsureResources();
+    void Destroy();
+
+    GLuint vao_{0};
+    GLuint vbo_{0};
+    GLuint program_{0};
+    GLint viewLoc_{-1};
+    GLint projectionLoc_{-1};
+    GLint pointSizeLoc_{-1};
+    GLint energyRangeLoc_{-1};
+    GLint logScaleLoc_{-1};
+    std::size_t count_{0};
+    std::size_t capacity_{0};
+};
+
+} // namespace mcnp::render
@@ -0,0 +1,56 @@
+#include "shader_program.h"
+
+#include <cstdio>
+
+namespace mcnp::render {
+
+namespace {
+
+GLuint CompileStage(GLenum type, const char* source, const char* label)
+{
+    const GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    GLint success = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetShaderInfoLog(shader, sizeof(infoLog), nullptr, infoLog);
+        std::fprintf(stderr, "[%s] shader compile failed: %s\n", label, infoLog);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+} // namespace
+
+GLuint CompileProgram(const char* vertexSource, const char* fragmentSource, const char* label)
+{
+    const GLuint vertex = CompileStage(GL_VERTEX_SHADER, vertexSource, label);
+    const GLuint fragment = CompileStage(GL_FRAGMENT_SHADER, fragmentSource, label);
+    if (!vertex || !fragment) {
+        if (vertex) glDeleteShader(vertex);
+        if (fragment) glDeleteShader(fragment);
+        return 0;
+    }
+    const GLuint program = glCreateProgram();
+    glAttachShader(program, vertex);
+    glAttachShader(program, fragment);
+    glLinkProgram(program);
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetProgramInfoLog(program, sizeof(infoLog), nullptr, infoLog);
+        std::fprintf(stderr, "[%s] program link failed: %s\n", label, infoLog);
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+} // namespace mcnp::render
@@ -0,0 +1,9 @@
+#pragma once
+#include <glad/glad.h>
+
+namespace mcnp::render {
+
+// 编译并链接顶点/片段着色器；失败时输出日志到 stderr 并返回 0
+GLuint CompileProgram(const char* vertexSource, const char* fragmentSource, const char* label);
+
+} // namespace mcnp::render
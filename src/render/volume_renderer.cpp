@@ -0,0 +1,621 @@
+#include "volume_renderer.h"
+#include "shader_program.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace mcnp::render {
+
+namespace {
+
+// 全屏三角形，无顶点属性
+const char* kFullscreenVertexShader = R"(
+    #version 330 core
+    void main()
+    {
+        vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+        gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);
+    }
+)";
+
+// 在等分坐标（盒内各轴按体素数等分）中步进，分档等距时即体素坐标；不等距时每个采样点在
+// 分档边界表中二分查找换算到体素坐标。砖块表为 0 的砖块直接跳到出口，其余在图集中三线性采样后
+// 查传输函数，由前向后合成；光线止于场景深度处
+const char* kRayFragmentShader = R"(
+    #version 330 core
+    out vec4 FragColor;
+
+    uniform mat4 inverseViewProjection;
+    uniform vec2 outputSize;
+    uniform vec3 boxMin;
+    uniform vec3 boxMax;
+    uniform vec3 dims;
+    uniform float brickSize;
+    uniform ivec3 brickCount;
+    uniform int slotsPerAxis;
+    uniform float atlasSize;
+    uniform float stepVoxels;
+    uniform int maxSteps;
+    uniform float density;
+    uniform sampler3D atlas;
+    uniform sampler3D brickMap;
+    uniform sampler2D transfer;
+    uniform sampler2D sceneDepth;
+    uniform bool warped;
+    uniform sampler2D edges;  // 第 axis 行为该轴归一化的分档边界
+
+    // 等分坐标 -> 体素坐标
+    float toBin(float u, int axis)
+    {
+        float f = u / dims[axis];
+        int lo = 0;
+        int hi = int(dims[axis]);
+        while (hi - lo > 1) {
+            int mid = (lo + hi) / 2;
+            if (texelFetch(edges, ivec2(mid, axis), 0).r <= f) lo = mid; else hi = mid;
+        }
+        float a = texelFetch(edges, ivec2(lo, axis), 0).r;
+        float b = texelFetch(edges, ivec2(lo + 1, axis), 0).r;
+        return float(lo) + clamp((f - a) / max(b - a, 1e-12), 0.0, 1.0);
+    }
+
+    vec3 toBins(vec3 u)
+    {
+        return warped ? vec3(toBin(u.x, 0), toBin(u.y, 1), toBin(u.z, 2)) : u;
+    }
+
+    // 体素边界（整数坐标）-> 等分坐标
+    vec3 fromBins(vec3 v)
+    {
+        if (!warped) return v;
+        ivec3 i = ivec3(min(v, dims));
+        return vec3(texelFetch(edges, ivec2(i.x, 0), 0).r, texelFetch(edges, ivec2(i.y, 1), 0).r,
+                    texelFetch(edges, ivec2(i.z, 2), 0).r) * dims;
+    }
+
+    vec3 toVoxel(vec4 clip)
+    {
+        vec4 world = inverseViewProjection * clip;
+        return (world.xyz / world.w - boxMin) / (boxMax - boxMin) * dims;
+    }
+
+    void main()
+    {
+        vec2 uv = gl_FragCoord.xy / outputSize;
+        vec2 ndc = uv * 2.0 - 1.0;
+        float depth = texture(sceneDepth, uv).r;
+        vec3 origin = toVoxel(vec4(ndc, -1.0, 1.0));
+        vec3 ray = toVoxel(vec4(ndc, depth * 2.0 - 1.0, 1.0)) - origin;
+        float limit = length(ray);
+        if (limit <= 0.0) discard;
+        vec3 dir = ray / limit;
+        dir = mix(dir, vec3(1e-7), lessThan(abs(dir), vec3(1e-7)));
+        vec3 inv = 1.0 / dir;
+
+        vec3 t0 = -origin * inv;
+        vec3 t1 = (dims - origin) * inv;
+        vec3 tmin = min(t0, t1);
+        vec3 tmax = max(t0, t1);
+        float tNear = max(max(tmin.x, tmin.y), max(tmin.z, 0.0));
+        float tFar = min(min(tmax.x, tmax.y), min(tmax.z, limit));
+        if (tNear >= tFar) discard;
+
+        float padded = brickSize + 2.0;
+        vec4 sum = vec4(0.0);
+        // 抖动起点消除步进条纹
+        float stepLength = max(stepVoxels, (tFar - tNear) / float(maxSteps));
+        float t = tNear + stepLength * fract(sin(dot(gl_FragCoord.xy, vec2(12.9898, 78.233))) * 43758.5453);
+        for (int i = 0; i < maxSteps && t < tFar; ++i) {
+            vec3 p = origin + dir * t;
+            vec3 v = toBins(p);
+            ivec3 b = clamp(ivec3(floor(v / brickSize)), ivec3(0), brickCount - 1);
+            float entry = texelFetch(brickMap, b, 0).r;
+            vec3 lo = vec3(b) * brickSize;
+            if (entry < 0.5) {
+                vec3 exits = (mix(fromBins(lo), fromBins(lo + brickSize), step(0.0, dir)) - p) * inv;
+                t += max(min(min(exits.x, exits.y), exits.z), 0.0) + 1e-3;
+                continue;
+            }
+            int slot = int(entry) - 1;
+            vec3 cell = vec3(slot % slotsPerAxis, (slot / slotsPerAxis) % slotsPerAxis,
+                             slot / (slotsPerAxis * slotsPerAxis));
+            float value = texture(atlas, (cell * padded + 1.0 + (v - lo)) / atlasSize).r;
+            vec4 c = texture(transfer, vec2(value, 0.5));
+            float a = 1.0 - pow(max(1.0 - c.a * density, 0.0), stepLength);
+            sum += (1.0 - sum.a) * vec4(c.rgb * a, a);
+            if (sum.a > 0.99) break;
+            t += stepLength;
+        }
+        FragColor = sum;
+    }
+)";
+
+const char* kCompositeFragmentShader = R"(
+    #version 330 core
+    out vec4 FragColor;
+    uniform sampler2D volume;
+    uniform vec2 outputSize;
+
+    void main()
+    {
+        FragColor = texture(volume, gl_FragCoord.xy / outputSize);
+    }
+)";
+
+GLint Uniform(GLuint program, const char* name)
+{
+    return glGetUniformLocation(program, name);
+}
+
+void SetTextureFilter(GLenum target, GLint filter)
+{
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    if (target == GL_TEXTURE_3D) {
+        glTexParameteri(target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    }
+}
+
+} // namespace
+
+VolumeRenderer& SceneVolumeRenderer()
+{
+    static VolumeRenderer renderer;
+    return renderer;
+}
+
+void VolumeRenderer::SetVolume(mcnp::core::VoxelBrickStore* store, std::size_t channel,
+                               const std::array<std::vector<double>, 3>& edges)
+{
+    store_ = store;
+    channel_ = store ? std::min(channel, store->channels() - 1) : 0;
+    mappingDirty_ = true;
+    classifyDirty_ = true;
+    edgesDirty_ = true;
+    for (auto& axis : edges_) {
+        axis.clear();
+    }
+    if (!store) {
+        return;
+    }
+
+    // 各轴边界归一化到 [0, 1]；偏离等距超过跨度的 1e-4 才启用查找表
+    bool uniform = true;
+    std::array<std::vector<float>, 3> normalized;
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+        const std::vector<double>& bounds = edges[axis];
+        const std::size_t bins = store->dims()[axis];
+        if (bounds.size() != bins + 1) {
+            boxMin_[axis] = 0.0f;
+            boxMax_[axis] = static_cast<float>(bins);
+            normalized[axis].resize(bins + 1);
+            for (std::size_t i = 0; i <= bins; ++i) {
+                normalized[axis][i] = static_cast<float>(i) / static_cast<float>(bins);
+            }
+            continue;
+        }
+        const double span = std::max(bounds.back() - bounds.front(), 1e-12);
+        boxMin_[axis] = static_cast<float>(bounds.front());
+        boxMax_[axis] = static_cast<float>(bounds.front() + span);
+        normalized[axis].reserve(bounds.size());
+        for (std::size_t i = 0; i < bounds.size(); ++i) {
+            const double f = (bounds[i] - bounds.front()) / span;
+            uniform = uniform && std::abs(f - static_cast<double>(i) / static_cast<double>(bins)) <= 1e-4;
+            normalized[axis].push_back(static_cast<float>(f));
+        }
+    }
+    if (!uniform) {
+        edges_ = std::move(normalized);
+    }
+}
+
+glm::vec3 VolumeRenderer::ToBins(const glm::vec3& uniform) const
+{
+    if (edges_[0].empty()) {
+        return uniform;
+    }
+    glm::vec3 voxel;
+    for (int axis = 0; axis < 3; ++axis) {
+        const std::vector<float>& edges = edges_[axis];
+        const auto bins = static_cast<float>(edges.size() - 1);
+        const float f = std::clamp(uniform[axis] / bins, 0.0f, 1.0f);
+        const auto above = std::upper_bound(edges.begin() + 1, edges.end() - 1, f);
+        const auto lo = static_cast<std::size_t>(above - edges.begin()) - 1;
+        const float width = std::max(edges[lo + 1] - edges[lo], 1e-12f);
+        voxel[axis] = static_cast<float>(lo) + std::clamp((f - edges[lo]) / width, 0.0f, 1.0f);
+    }
+    return voxel;
+}
+
+void VolumeRenderer::SetTransferFunction(float low, float high, bool logScale, const std::vector<TransferPoint>& points)
+{
+    if (low != low_ || high != high_ || logScale != logScale_) {
+        mappingDirty_ = true;
+    }
+    low_ = low;
+    high_ = high;
+    logScale_ = logScale;
+
+    // 控制点之间线性插值成 256 项查找表
+    for (std::size_t i = 0; i < table_.size(); ++i) {
+        const float t = static_cast<float>(i) / static_cast<float>(table_.size() - 1);
+        glm::vec4 color(0.0f);
+        if (!points.empty()) {
+            const auto above = std::find_if(points.begin(), points.end(),
+                                            [t](const TransferPoint& point) { return point.position >= t; });
+            if (above == points.begin()) {
+                color = points.front().color;
+            } else if (above == points.end()) {
+                color = points.back().color;
+            } else {
+                const TransferPoint& below = *(above - 1);
+                const float span = std::max(above->position - below.position, 1e-6f);
+                color = glm::mix(below.color, above->color, (t - below.position) / span);
+            }
+        }
+        table_[i] = glm::clamp(color, glm::vec4(0.0f), glm::vec4(1.0f));
+    }
+    tableDirty_ = true;
+    classifyDirty_ = true;
+}
+
+void VolumeRenderer::SetOptions(const VolumeRenderOptions& options)
+{
+    const bool atlasChanged = options.atlasBytes != options_.atlasBytes;
+    options_ = options;
+    options_.stepVoxels = std::max(options_.stepVoxels, 0.05f);
+    options_.maxSteps = std::max(options_.maxSteps, 1);
+    options_.resolutionScale = std::clamp(options_.resolutionScale, 0.1f, 1.0f);
+    if (atlasChanged) {
+        mappingDirty_ = true;
+    }
+}
+
+float VolumeRenderer::Normalize(float value) const
+{
+    float v = value;
+    float lo = low_;
+    float hi = high_;
+    if (logScale_) {
+        v = std::log(std::max(v, 1e-30f));
+        lo = std::log(std::max(lo, 1e-30f));
+        hi = std::log(std::max(hi, 1e-30f));
+    }
+    return std::clamp((v - lo) / std::max(hi - lo, 1e-30f), 0.0f, 1.0f);
+}
+
+void VolumeRenderer::EnsureResources()
+{
+    if (rayProgram_ == 0) {
+        rayProgram_ = CompileProgram(kFullscreenVertexShader, kRayFragmentShader, "VolumeRenderer");
+    }
+    if (compositeProgram_ == 0) {
+        compositeProgram_ = CompileProgram(kFullscreenVertexShader, kCompositeFragmentShader, "VolumeComposite");
+    }
+    if (vao_ == 0) {
+        glGenVertexArrays(1, &vao_);
+    }
+    if (transferTex_ == 0) {
+        glGenTextures(1, &transferTex_);
+        glBindTexture(GL_TEXTURE_2D, transferTex_);
+        SetTextureFilter(GL_TEXTURE_2D, GL_LINEAR);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, static_cast<GLsizei>(table_.size()), 1, 0, GL_RGBA, GL_FLOAT, nullptr);
+        tableDirty_ = true;
+    }
+    if (tableDirty_) {
+        glBindTexture(GL_TEXTURE_2D, transferTex_);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, static_cast<GLsizei>(table_.size()), 1, GL_RGBA, GL_FLOAT, table_.data());
+        tableDirty_ = false;
+    }
+}
+
+void VolumeRenderer::EnsureTargets(int width, int height)
+{
+    if (width != targetWidth_ || height != targetHeight_ || depthFbo_ == 0) {
+        if (depthTex_) { glDeleteTextures(1, &depthTex_); depthTex_ = 0; }
+        if (depthFbo_) { glDeleteFramebuffers(1, &depthFbo_); depthFbo_ = 0; }
+        targetWidth_ = width;
+        targetHeight_ = height;
+
+        // 与视口 Framebuffer 的深度格式一致，才能用 glBlitFramebuffer 复制
+        glGenTextures(1, &depthTex_);
+        glBindTexture(GL_TEXTURE_2D, depthTex_);
+        SetTextureFilter(GL_TEXTURE_2D, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, width, height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, nullptr);
+        glGenFramebuffers(1, &depthFbo_);
+        glBindFramebuffer(GL_FRAMEBUFFER, depthFbo_);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthTex_, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+
+    const int colorWidth = std::max(1, static_cast<int>(std::lround(width * options_.resolutionScale)));
+    const int colorHeight = std::max(1, static_cast<int>(std::lround(height * options_.resolutionScale)));
+    if (colorWidth != colorWidth_ || colorHeight != colorHeight_ || colorFbo_ == 0) {
+        if (colorTex_) { glDeleteTextures(1, &colorTex_); colorTex_ = 0; }
+        if (colorFbo_) { glDeleteFramebuffers(1, &colorFbo_); colorFbo_ = 0; }
+        colorWidth_ = colorWidth;
+        colorHeight_ = colorHeight;
+        glGenTextures(1, &colorTex_);
+        glBindTexture(GL_TEXTURE_2D, colorTex_);
+        SetTextureFilter(GL_TEXTURE_2D, GL_LINEAR);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, colorWidth_, colorHeight_, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glGenFramebuffers(1, &colorFbo_);
+        glBindFramebuffer(GL_FRAMEBUFFER, colorFbo_);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTex_, 0);
+    }
+}
+
+void VolumeRenderer::CreateVolumeTextures()
+{
+    if (atlasTex_) { glDeleteTextures(1, &atlasTex_); atlasTex_ = 0; }
+    if (brickMapTex_) { glDeleteTextures(1, &brickMapTex_); brickMapTex_ = 0; }
+
+    const int padded = static_cast<int>(store_->options().brickSize) + 2;
+    GLint maxSize = 256;
+    glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &maxSize);
+    const double slotBytes = static_cast<double>(padded) * padded * padded * sizeof(std::uint16_t);
+    const int budgetSlots = static_cast<int>(std::cbrt(static_cast<double>(options_.atlasBytes) / slotBytes));
+    slotsPerAxis_ = std::clamp(budgetSlots, 1, std::max(1, maxSize / padded));
+    atlasSize_ = slotsPerAxis_ * padded;
+    atlas_.reset(static_cast<std::size_t>(slotsPerAxis_) * slotsPerAxis_ * slotsPerAxis_);
+
+    // 归一化后的值存为 16 位定点，三线性插值在硬件中完成
+    glGenTextures(1, &atlasTex_);
+    glBindTexture(GL_TEXTURE_3D, atlasTex_);
+    SetTextureFilter(GL_TEXTURE_3D, GL_LINEAR);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R16, atlasSize_, atlasSize_, atlasSize_, 0, GL_RED, GL_UNSIGNED_SHORT, nullptr);
+
+    // 砖块表：槽位 + 1，0 表示整块跳过
+    const auto bricks = store_->bricksPerAxis();
+    const std::vector<float> empty(bricks[0] * bricks[1] * bricks[2], 0.0f);
+    glGenTextures(1, &brickMapTex_);
+    glBindTexture(GL_TEXTURE_3D, brickMapTex_);
+    SetTextureFilter(GL_TEXTURE_3D, GL_NEAREST);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R32F, static_cast<GLsizei>(bricks[0]), static_cast<GLsizei>(bricks[1]),
+                 static_cast<GLsizei>(bricks[2]), 0, GL_RED, GL_FLOAT, empty.data());
+}
+
+void VolumeRenderer::Reclassify()
+{
+    // 查找表中不透明项的前缀计数：砖块的值区间覆盖到任一不透明项即为可见
+    std::array<int, 257> opaque{};
+    for (std::size_t i = 0; i < table_.size(); ++i) {
+        opaque[i + 1] = opaque[i] + (table_[i].a > 0.0f ? 1 : 0);
+    }
+    const float last = static_cast<float>(table_.size() - 1);
+    atlas_.classify(*store_, channel_, [&](float low, float high) {
+        const auto first = static_cast<std::size_t>(std::floor(Normalize(low) * last));
+        const auto end = static_cast<std::size_t>(std::ceil(Normalize(high) * last)) + 1;
+        return opaque[end] > opaque[first];
+    });
+
+    // 不再可见但仍驻留的砖块在砖块表中置 0，槽位留待替换
+    const auto bricks = store_->bricksPerAxis();
+    std::vector<float> entries(bricks[0] * bricks[1] * bricks[2], 0.0f);
+    const std::size_t first = store_->brickIndex(0, 0, 0, channel_);
+    for (std::size_t local = 0; local < entries.size(); ++local) {
+        const std::size_t slot = atlas_.slot(first + local);
+        if (slot != mcnp::core::BrickAtlas::npos && atlas_.visible(first + local)) {
+            entries[local] = static_cast<float>(slot + 1);
+        }
+    }
+    // 砖块编号 bz 最快，与纹理的 x 最快相反，逐项转置
+    std::vector<float> texels(entries.size());
+    for (std::size_t bx = 0; bx < bricks[0]; ++bx) {
+        for (std::size_t by = 0; by < bricks[1]; ++by) {
+            for (std::size_t bz = 0; bz < bricks[2]; ++bz) {
+                texels[(bz * bricks[1] + by) * bricks[0] + bx] = entries[(bx * bricks[1] + by) * bricks[2] + bz];
+            }
+        }
+    }
+    glBindTexture(GL_TEXTURE_3D, brickMapTex_);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, static_cast<GLsizei>(bricks[0]), static_cast<GLsizei>(bricks[1]),
+                    static_cast<GLsizei>(bricks[2]), GL_RED, GL_FLOAT, texels.data());
+}
+
+void VolumeRenderer::SetBrickEntry(std::size_t brick, float entry)
+{
+    const auto bricks = store_->bricksPerAxis();
+    const std::size_t local = brick - store_->brickIndex(0, 0, 0, channel_);
+    const auto bz = static_cast<GLint>(local % bricks[2]);
+    const auto by = static_cast<GLint>(local / bricks[2] % bricks[1]);
+    const auto bx = static_cast<GLint>(local / (bricks[1] * bricks[2]));
+    glBindTexture(GL_TEXTURE_3D, brickMapTex_);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, bx, by, bz, 1, 1, 1, GL_RED, GL_FLOAT, &entry);
+}
+
+void VolumeRenderer::UploadEdges()
+{
+    edgesDirty_ = false;
+    if (edges_[0].empty()) {
+        return;
+    }
+    // 三行 R32F 纹理，按 texelFetch 精确取值
+    const std::size_t width = std::max({edges_[0].size(), edges_[1].size(), edges_[2].size()});
+    std::vector<float> texels(width * 3, 1.0f);
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+        std::copy(edges_[axis].begin(), edges_[axis].end(), texels.begin() + static_cast<std::ptrdiff_t>(axis * width));
+    }
+    if (edgeTex_ == 0) {
+        glGenTextures(1, &edgeTex_);
+    }
+    glBindTexture(GL_TEXTURE_2D, edgeTex_);
+    SetTextureFilter(GL_TEXTURE_2D, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, static_cast<GLsizei>(width), 3, 0, GL_RED, GL_FLOAT, texels.data());
+}
+
+void VolumeRenderer::Upload(const mcnp::core::BrickUpload& upload)
+{
+    const auto bricks = store_->bricksPerAxis();
+    const auto& dims = store_->dims();
+    const std::size_t size = store_->options().brickSize;
+    const std::size_t padded = size + 2;
+    const std::size_t local = upload.brick - store_->brickIndex(0, 0, 0, channel_);
+    const std::size_t origin[3] = {local / (bricks[1] * bricks[2]) * size, local / bricks[2] % bricks[1] * size,
+                                   local % bricks[2] * size};
+
+    // 含 1 体素边框（取相邻砖块的值，体外按边界钳制），纹理 x 最快
+    scratch_.resize(padded * padded * padded);
+    const auto clampAxis = [&](std::size_t axis, std::size_t i) {
+        const std::ptrdiff_t at = static_cast<std::ptrdiff_t>(origin[axis] + i) - 1;
+        return static_cast<std::size_t>(std::clamp<std::ptrdiff_t>(at, 0, static_cast<std::ptrdiff_t>(dims[axis]) - 1));
+    };
+    for (std::size_t i = 0; i < padded; ++i) {
+        const std::size_t x = clampAxis(0, i);
+        for (std::size_t j = 0; j < padded; ++j) {
+            const std::size_t y = clampAxis(1, j);
+            for (std::size_t k = 0; k < padded; ++k) {
+                const float value = store_->value(x, y, clampAxis(2, k), channel_);
+                scratch_[(k * padded + j) * padded + i] = static_cast<std::uint16_t>(std::lround(Normalize(value) * 65535.0f));
+            }
+        }
+    }
+
+    const auto slots = static_cast<std::size_t>(slotsPerAxis_);
+    const auto sx = static_cast<GLint>(upload.slot % slots * padded);
+    const auto sy = static_cast<GLint>(upload.slot / slots % slots * padded);
+    const auto sz = static_cast<GLint>(upload.slot / (slots * slots) * padded);
+    glBindTexture(GL_TEXTURE_3D, atlasTex_);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, sx, sy, sz, static_cast<GLsizei>(padded), static_cast<GLsizei>(padded),
+                    static_cast<GLsizei>(padded), GL_RED, GL_UNSIGNED_SHORT, scratch_.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    if (upload.evicted != mcnp::core::BrickAtlas::npos) {
+        SetBrickEntry(upload.evicted, 0.0f);
+    }
+    SetBrickEntry(upload.brick, static_cast<float>(upload.slot + 1));
+}
+
+void VolumeRenderer::Draw(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos)
+{
+    lastUploads_ = 0;
+    if (!store_) {
+        return;
+    }
+    GLint target = 0;
+    GLint viewport[4] = {0, 0, 0, 0};
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    if (viewport[2] <= 0 || viewport[3] <= 0) {
+        return;
+    }
+
+    EnsureResources();
+    if (rayProgram_ == 0 || compositeProgram_ == 0) {
+        return;
+    }
+    if (mappingDirty_) {
+        CreateVolumeTextures();
+        mappingDirty_ = false;
+        classifyDirty_ = true;
+    }
+    if (classifyDirty_) {
+        Reclassify();
+        classifyDirty_ = false;
+    }
+    if (edgesDirty_) {
+        UploadEdges();
+    }
+
+    // 由近到远补充图集，每帧限量，远处砖块在后续帧逐步出现
+    const auto& dims = store_->dims();
+    const glm::vec3 extent(dims[0], dims[1], dims[2]);
+    const glm::vec3 eye = ToBins((viewPos - boxMin_) / (boxMax_ - boxMin_) * extent);
+    for (const auto& upload : atlas_.schedule(eye, options_.uploadsPerFrame)) {
+        Upload(upload);
+        ++lastUploads_;
+    }
+
+    EnsureTargets(viewport[2], viewport[3]);
+    const GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    const GLboolean blend = glIsEnabled(GL_BLEND);
+
+    // 1) 复制场景深度
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(target));
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, depthFbo_);
+    glBlitFramebuffer(viewport[0], viewport[1], viewport[0] + viewport[2], viewport[1] + viewport[3], 0, 0,
+                      targetWidth_, targetHeight_, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+    // 2) 低分辨率光线步进
+    glBindFramebuffer(GL_FRAMEBUFFER, colorFbo_);
+    glViewport(0, 0, colorWidth_, colorHeight_);
+    const GLfloat transparent[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    glClearBufferfv(GL_COLOR, 0, transparent);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+
+    const auto bricks = store_->bricksPerAxis();
+    glUseProgram(rayProgram_);
+    glUniformMatrix4fv(Uniform(rayProgram_, "inverseViewProjection"), 1, GL_FALSE,
+                       glm::value_ptr(glm::inverse(projection * view)));
+    glUniform2f(Uniform(rayProgram_, "outputSize"), static_cast<float>(colorWidth_), static_cast<float>(colorHeight_));
+    glUniform3fv(Uniform(rayProgram_, "boxMin"), 1, glm::value_ptr(boxMin_));
+    glUniform3fv(Uniform(rayProgram_, "boxMax"), 1, glm::value_ptr(boxMax_));
+    glUniform3fv(Uniform(rayProgram_, "dims"), 1, glm::value_ptr(extent));
+    glUniform1f(Uniform(rayProgram_, "brickSize"), static_cast<float>(store_->options().brickSize));
+    glUniform3i(Uniform(rayProgram_, "brickCount"), static_cast<GLint>(bricks[0]), static_cast<GLint>(bricks[1]),
+                static_cast<GLint>(bricks[2]));
+    glUniform1i(Uniform(rayProgram_, "slotsPerAxis"), slotsPerAxis_);
+    glUniform1f(Uniform(rayProgram_, "atlasSize"), static_cast<float>(atlasSize_));
+    glUniform1f(Uniform(rayProgram_, "stepVoxels"), options_.stepVoxels);
+    glUniform1i(Uniform(rayProgram_, "maxSteps"), options_.maxSteps);
+    glUniform1f(Uniform(rayProgram_, "density"), options_.density);
+    glUniform1i(Uniform(rayProgram_, "atlas"), 0);
+    glUniform1i(Uniform(rayProgram_, "brickMap"), 1);
+    glUniform1i(Uniform(rayProgram_, "transfer"), 2);
+    glUniform1i(Uniform(rayProgram_, "sceneDepth"), 3);
+    glUniform1i(Uniform(rayProgram_, "warped"), edges_[0].empty() ? 0 : 1);
+    glUniform1i(Uniform(rayProgram_, "edges"), 4);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_3D, atlasTex_);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_3D, brickMapTex_);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, transferTex_);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, depthTex_);
+    glActiveTexture(GL_TEXTURE4);
+    glBindTexture(GL_TEXTURE_2D, edgeTex_);
+    glBindVertexArray(vao_);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    // 3) 预乘 alpha 叠加回目标帧缓冲
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(target));
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glUseProgram(compositeProgram_);
+    glUniform1i(Uniform(compositeProgram_, "volume"), 0);
+    glUniform2f(Uniform(compositeProgram_, "outputSize"), static_cast<float>(viewport[2]), static_cast<float>(viewport[3]));
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, colorTex_);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    if (!blend) glDisable(GL_BLEND);
+    if (depthTest) glEnable(GL_DEPTH_TEST);
+}
+
+void VolumeRenderer::Destroy()
+{
+    if (atlasTex_) { glDeleteTextures(1, &atlasTex_); atlasTex_ = 0; }
+    if (brickMapTex_) { glDeleteTextures(1, &brickMapTex_); brickMapTex_ = 0; }
+    if (transferTex_) { glDeleteTextures(1, &transferTex_); transferTex_ = 0; }
+    if (edgeTex_) { glDeleteTextures(1, &edgeTex_); edgeTex_ = 0; }
+    if (depthTex_) { glDeleteTextures(1, &depthTex_); depthTex_ = 0; }
+    if (colorTex_) { glDeleteTextures(1, &colorTex_); colorTex_ = 0; }
+    if (depthFbo_) { glDeleteFramebuffers(1, &depthFbo_); depthFbo_ = 0; }
+    if (colorFbo_) { glDeleteFramebuffers(1, &colorFbo_); colorFbo_ = 0; }
+    if (vao_) { glDeleteVertexArrays(1, &vao_); vao_ = 0; }
+    if (rayProgram_) { glDeleteProgram(rayProgram_); rayProgram_ = 0; }
+    if (compositeProgram_) { glDeleteProgram(compositeProgram_); compositeProgram_ = 0; }
+}
+
+} // namespace mcnp::render
@@ -0,0 +1,111 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "brick_atlas.h"
+#include "voxel_store.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mcnp::render {
+
+// 传输函数的控制点：position 为归一化值 [0, 1]，color.a 为不透明度
+struct TransferPoint {
+    float position = 0.0f;
+    glm::vec4 color{0.0f};
+};
+
+struct VolumeRenderOptions {
+    float stepVoxels = 1.0f;        // 最小光线步长（体素）
+    int maxSteps = 256;             // 每条光线的采样上限：穿过体积的长度超出时按比例放大步长
+    float density = 1.0f;           // 不透明度缩放
+    float resolutionScale = 0.5f;   // 体绘制的离屏分辨率比例，软件 OpenGL 下降低以保持交互
+    std::size_t uploadsPerFrame = 64;  // 每帧至多上传到图集的砖块数
+    std::size_t atlasBytes = std::size_t(128) << 20;  // 图集显存上限（另受 GL_MAX_3D_TEXTURE_SIZE 限制）
+};
+
+// 网格计数的体绘制：对分砖存储做光线步进。可见砖块按需上传到 3D 纹理图集（每块带 1 体素边框
+// 以便三线性插值），砖块表记录每块所在槽位；整块透明或尚未上传的砖块在着色器中整块跳过。
+// 绘制时复制当前帧缓冲的深度，光线止于不透明几何表面，再以预乘 alpha 叠加到场景上。
+class VolumeRenderer {
+public:
+    VolumeRenderer() = default;
+    ~VolumeRenderer() { Destroy(); }
+
+    VolumeRenderer(const VolumeRenderer&) = delete;
+    VolumeRenderer& operator=(const VolumeRenderer&) = delete;
+
+    // store 需在渲染期间保持有效；edges 为三个方向的分档边界（世界坐标，递增，各比体素数多一个），
+    // 可以不等距：不等距时着色器按边界查找表把采样点换算到体素坐标。传 nullptr 关闭绘制
+    void SetVolume(mcnp::core::VoxelBrickStore* store, std::size_t channel,
+                   const std::array<std::vector<double>, 3>& edges);
+    // 值 [low, high]（logScale 时按对数）映射到 [0, 1] 后查表；points 按 position 升序
+    void SetTransferFunction(float low, float high, bool logScale, const std::vector<TransferPoint>& points);
+    void SetOptions(const VolumeRenderOptions& options);
+    const VolumeRenderOptions& Options() const noexcept { return options_; }
+    bool HasVolume() const noexcept { return store_ != nullptr; }
+
+    // 叠加到当前绑定的帧缓冲（需带 GL_DEPTH24_STENCIL8 深度，如视口的 Framebuffer）
+    void Draw(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos);
+
+    const mcnp::core::BrickAtlasStats& LastStats() const noexcept { return atlas_.stats(); }
+    std::size_t LastUploads() const noexcept { return lastUploads_; }
+
+private:
+    void EnsureResources();
+    void EnsureTargets(int width, int height);
+    void CreateVolumeTextures();
+    void Reclassify();
+    void Upload(const mcnp::core::BrickUpload& upload);
+    void SetBrickEntry(std::size_t brick, float entry);
+    void UploadEdges();
+    glm::vec3 ToBins(const glm::vec3& uniform) const;
+    float Normalize(float value) const;
+    void Destroy();
+
+    mcnp::core::VoxelBrickStore* store_{nullptr};
+    std::size_t channel_{0};
+    glm::vec3 boxMin_{0.0f};
+    glm::vec3 boxMax_{1.0f};
+    std::array<std::vector<float>, 3> edges_;  // 归一化到 [0, 1] 的分档边界；全部等距时为空
+    bool edgesDirty_{true};
+    VolumeRenderOptions options_;
+
+    float low_{0.0f};
+    float high_{1.0f};
+    bool logScale_{false};
+    std::array<glm::vec4, 256> table_{};
+    bool tableDirty_{true};
+    bool mappingDirty_{true};   // 值映射变化：图集内容全部作废
+    bool classifyDirty_{true};  // 不透明区间变化：重新判定可见砖块
+
+    mcnp::core::BrickAtlas atlas_;
+    std::vector<std::uint16_t> scratch_;
+    std::size_t lastUploads_{0};
+    int slotsPerAxis_{0};
+    int atlasSize_{0};
+
+    GLuint rayProgram_{0};
+    GLuint compositeProgram_{0};
+    GLuint vao_{0};
+    GLuint atlasTex_{0};
+    GLuint brickMapTex_{0};
+    GLuint transferTex_{0};
+    GLuint edgeTex_{0};
+    GLuint depthFbo_{0};
+    GLuint depthTex_{0};
+    GLuint colorFbo_{0};
+    GLuint colorTex_{0};
+    int targetWidth_{0};
+    int targetHeight_{0};
+    int colorWidth_{0};
+    int colorHeight_{0};
+};
+
+// 视口共享的体绘制器（由 RenderSceneToViewport 在不透明几何之后绘制）
+VolumeRenderer& SceneVolumeRenderer();
+
+} // namespace mcnp::render
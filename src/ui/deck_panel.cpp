@@ -0,0 +1,601 @@
+#include "deck_panel.h"
+#include "imgui_string.h"
+#include "lattice_renderer.h"
+#include "log_manager.h"
+#include "mcnp_parser.h"
+#include "scene_manager.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+
+namespace mcnp::ui {
+
+namespace {
+
+std::string CellMeshName(int cell)
+{
+    return "Cell " + std::to_string(cell);
+}
+
+// 按材料号取色，空腔为灰色
+glm::vec3 MaterialColor(int material)
+{
+    static const std::array<glm::vec3, 8> palette = {
+        glm::vec3(0.90f, 0.60f, 0.20f), glm::vec3(0.30f, 0.60f, 0.90f), glm::vec3(0.45f, 0.80f, 0.35f),
+        glm::vec3(0.85f, 0.35f, 0.40f), glm::vec3(0.70f, 0.50f, 0.85f), glm::vec3(0.95f, 0.85f, 0.30f),
+        glm::vec3(0.35f, 0.80f, 0.80f), glm::vec3(0.75f, 0.75f, 0.70f)};
+    if (material <= 0) {
+        return glm::vec3(0.6f);
+    }
+    return palette[static_cast<std::size_t>(material) % palette.size()];
+}
+
+// 与比较基准不同的单元
+const glm::vec3 kChangedColor(1.0f, 0.15f, 0.85f);
+
+// 最后一次编辑之后等待多久再重新比较
+constexpr std::chrono::milliseconds kDiffDelay(300);
+
+int FindMesh(const std::string& name)
+{
+    for (std::size_t i = 0; i < meshes.size(); ++i) {
+        if (meshes[i].name == name) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+// 改写顶点颜色；已上传的缓冲区就地更新
+void Tint(Mesh& mesh, const glm::vec3& color)
+{
+    for (auto& vertex : mesh.vertices) {
+        vertex.color = color;
+    }
+    if (mesh.VBO != 0) {
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, mesh.vertices.size() * sizeof(Vertex), mesh.vertices.data());
+    }
+}
+
+// 平面着色：每个三角形独立的三个顶点
+void AppendTriangles(Mesh& mesh, const mcnp::parser::CellMesh& cellMesh, const glm::vec3& color)
+{
+    const auto& positions = cellMesh.positions;
+    const auto& indices = cellMesh.indices;
+    mesh.vertices.reserve(mesh.vertices.size() + indices.size());
+    mesh.indices.reserve(mesh.indices.size() + indices.size());
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+        const glm::vec3& a = positions[indices[i]];
+        const glm::vec3& b = positions[indices[i + 1]];
+        const glm::vec3& c = positions[indices[i + 2]];
+        const glm::vec3 cross = glm::cross(b - a, c - a);
+        const float length = glm::length(cross);
+        const glm::vec3 normal = length > 0.0f ? cross / length : glm::vec3(0.0f, 0.0f, 1.0f);
+        for (const glm::vec3* p : {&a, &b, &c}) {
+            mesh.indices.push_back(static_cast<unsigned int>(mesh.vertices.size()));
+            mesh.vertices.emplace_back(*p, normal, color);
+        }
+    }
+}
+
+void RemoveMesh(int index)
+{
+    releaseMeshResources(meshes[index]);
+    meshes.erase(meshes.begin() + index);
+    if (index < static_cast<int>(originalMeshes.size())) {
+        originalMeshes.erase(originalMeshes.begin() + index);
+    }
+    if (selectedMesh == index) {
+        selectedMesh = -1;
+    } else if (selectedMesh > index) {
+        --selectedMesh;
+    }
+}
+
+} // namespace
+
+DeckPanel::DeckPanel()
+    : editor_("deck\n"
+              "1 0 -1 imp:n=1\n"
+              "2 0 1 -2 imp:n=1\n"
+              "3 0 2 imp:n=0\n"
+              "\n"
+              "1 so 5\n"
+              "2 so 10\n"
+              "\n"
+              "mode n\n")
+{
+    Record(deck_.load(editor_));
+}
+
+void DeckPanel::Load()
+{
+    std::ifstream file(path_, std::ios::binary);
+    if (!file) {
+        LogManager::getInstance()->logOperation("Deck", "Cannot open " + path_);
+        return;
+    }
+    std::ostringstream content;
+    content << file.rdbuf();
+    editor_ = content.str();
+    Record(deck_.load(editor_));
+    LogManager::getInstance()->logOperation("Deck", "Loaded " + path_);
+}
+
+void DeckPanel::ApplyEditorChange()
+{
+    // 一帧内的修改总是连续的一段：去掉公共前缀与后缀即得编辑区间
+    const std::string& before = deck_.text();
+    const std::size_t limit = std::min(before.size(), editor_.size());
+    std::size_t prefix = 0;
+    while (prefix < limit && before[prefix] == editor_[prefix]) {
+        ++prefix;
+    }
+    std::size_t suffix = 0;
+    while (suffix < limit - prefix &&
+           before[before.size() - 1 - suffix] == editor_[editor_.size() - 1 - suffix]) {
+        ++suffix;
+    }
+    mcnp::parser::DeckEdit edit;
+    edit.offset = prefix;
+    edit.length = before.size() - prefix - suffix;
+    edit.text = editor_.substr(prefix, editor_.size() - prefix - suffix);
+    Record(deck_.applyEdit(edit));
+}
+
+void DeckPanel::Record(const mcnp::parser::DeckUpdate& update)
+{
+    last_ = update;
+    fullPending_ = fullPending_ || update.fullReparse;
+    impacted_.insert(impacted_.end(), update.impactedCells.begin(), update.impactedCells.end());
+    errors_ = deck_.errors();
+    checker_.apply(deck_.ast(), update);
+    diffPending_ = diffPending_ || baseline_ != nullptr;
+    editedAt_ = std::chrono::steady_clock::now();
+}
+
+void DeckPanel::LoadBaseline()
+{
+    mcnp::parser::ParseResult parsed = mcnp::parser::MCNPParser().parseFile(baselinePath_);
+    if (!parsed.errors.empty() && parsed.ast.cardCount() == 0) {
+        LogManager::getInstance()->logOperation("Deck", "Cannot compare with " + baselinePath_ + ": " +
+                                                            parsed.errors.front().message);
+        return;
+    }
+    baseline_ = std::make_shared<const mcnp::parser::Ast>(std::move(parsed.ast));
+    diffPending_ = true;
+    LogManager::getInstance()->logOperation("Deck", "Comparing with " + baselinePath_);
+}
+
+void DeckPanel::StartDiff()
+{
+    diffPending_ = false;
+    if (!baseline_) {
+        ApplyDiff({});
+        return;
+    }
+    // 交叉索引与比较在后台对文本快照重新解析后进行，不占用 UI 线程；AST 不可复制
+    diffJob_ = std::async(std::launch::async, [baseline = baseline_, text = deck_.text()]() {
+        const mcnp::parser::ParseResult parsed = mcnp::parser::MCNPParser().parse(text);
+        const mcnp::parser::CrossReference xref = mcnp::parser::buildCrossReference(parsed.ast);
+        mcnp::parser::DiffOptions options;
+        options.afterXref = &xref;
+        return mcnp::parser::diffDecks(*baseline, parsed.ast, options);
+    });
+}
+
+void DeckPanel::PollDiff()
+{
+    if (!diffJob_.valid() || diffJob_.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return;
+    }
+    ApplyDiff(diffJob_.get());
+}
+
+void DeckPanel::ApplyDiff(mcnp::parser::DeckDiff diff)
+{
+    diff_ = std::move(diff);
+    std::unordered_set<int> previous = std::exchange(highlighted_, {});
+    highlighted_.insert(diff_.changedCells.begin(), diff_.changedCells.end());
+
+    // 只重新着色高亮状态变化的单元物体
+    for (auto& mesh : meshes) {
+        if (mesh.name.rfind("Cell ", 0) != 0) {
+            continue;
+        }
+        const int cell = std::atoi(mesh.name.c_str() + 5);
+        if (previous.count(cell) != highlighted_.count(cell)) {
+            Tint(mesh, CellColor(cell, mesh.baseColor));
+        }
+    }
+}
+
+glm::vec3 DeckPanel::CellColor(int cell, const glm::vec3& base) const
+{
+    return highlighted_.count(cell) ? kChangedColor : base;
+}
+
+void DeckPanel::RestartMeshing(const std::vector<int>& cells, bool all)
+{
+    const auto& compiled = deck_.cells();
+    std::unordered_set<int> wanted(awaiting_.begin(), awaiting_.end());
+    wanted.insert(cells.begin(), cells.end());
+    if (all) {
+        // 全量重解析后单元可能整体改号：先删掉不再存在的单元物体
+        for (int i = static_cast<int>(meshes.size()) - 1; i >= 0; --i) {
+            const std::string& name = meshes[i].name;
+            if (name.rfind("Cell ", 0) == 0 && !compiled.find(std::atoi(name.c_str() + 5))) {
+                RemoveMesh(i);
+            }
+        }
+        for (const auto& cell : compiled.cells) {
+            wanted.insert(cell.id);
+        }
+    }
+
+    // 填充了宇宙的单元与宇宙内的单元不在世界坐标中直接网格化，见 RebuildUniverses
+    std::vector<std::pair<int, mcnp::core::CsgDag::NodeId>> work;
+    for (int id : wanted) {
+        const auto* cell = compiled.find(id);
+        const bool hidden = !cell || cell->fill != 0 || cell->universe != 0 ||
+                            cell->region == mcnp::core::CsgDag::kInvalid || (cell->material == 0 && !showVoid_);
+        if (hidden) {
+            const int index = FindMesh(CellMeshName(id));
+            if (index >= 0) {
+                RemoveMesh(index);
+            }
+            continue;
+        }
+        work.emplace_back(id, cell->region);
+    }
+
+    awaiting_.clear();
+    for (const auto& [id, region] : work) {
+        awaiting_.insert(id);
+    }
+    auto options = meshStream_.options();
+    options.boundsMin = glm::dvec3(-bounds_);
+    options.boundsMax = glm::dvec3(bounds_);
+    meshStream_.setOptions(options);
+    meshStream_.start(compiled.dag, deck_.surfaces().table, std::move(work));
+}
+
+void DeckPanel::Deliver(const mcnp::parser::MeshedCell& result)
+{
+    const auto* cell = deck_.cells().find(result.cell);
+    const std::string name = CellMeshName(result.cell);
+    int index = FindMesh(name);
+    if (!result.mesh->error.empty()) {
+        LogManager::getInstance()->logOperation("Deck", name + ": " + result.mesh->error);
+    }
+    if (!cell || result.mesh->indices.empty()) {
+        if (index >= 0) {
+            RemoveMesh(index);
+        }
+        return;
+    }
+
+    Mesh mesh(name);
+    mesh.baseColor = MaterialColor(cell->material);
+    AppendTriangles(mesh, *result.mesh, CellColor(result.cell, mesh.baseColor));
+
+    if (index >= 0) {
+        mesh.transform = meshes[index].transform;
+        mesh.selected = meshes[index].selected;
+        releaseMeshResources(meshes[index]);
+        meshes[index] = mesh;
+        if (index < static_cast<int>(originalMeshes.size())) {
+            originalMeshes[index] = std::move(mesh);
+        }
+    } else {
+        meshes.push_back(mesh);
+        originalMeshes.push_back(std::move(mesh));
+    }
+}
+
+void DeckPanel::RebuildUniverses()
+{
+    universesPending_ = false;
+    universesReady_ = false;
+    picked_.clear();
+    auto& renderer = mcnp::render::SceneLatticeRenderer();
+    renderer.SetScene(nullptr, 0);
+    universeCells_.clear();
+    const auto& compiled = deck_.cells();
+    const bool nested = std::any_of(compiled.cells.begin(), compiled.cells.end(),
+                                    [](const auto& cell) { return cell.universe != 0; });
+    if (!nested) {
+        universeStream_.cancel();
+        renderer.ClearMeshes();
+        return;
+    }
+    std::vector<std::string> problems;
+    const bool built = mcnp::parser::buildUniverses(compiled, deck_.surfaces().table, universes_, &problems);
+    for (const auto& problem : problems) {
+        LogManager::getInstance()->logOperation("Deck", problem);
+    }
+    if (!built) {
+        universeStream_.cancel();
+        renderer.ClearMeshes();
+        return;
+    }
+    universesReady_ = true;
+    renderer.SetScene(&universes_, 0);
+
+    // 宇宙内的无界单元（如燃料棒外的慢化剂）截断到栅格元素的包围盒，六角元素取其外接矩形
+    glm::dvec3 half(0.0);
+    for (const auto& cell : compiled.cells) {
+        const mcnp::core::Universe* universe = cell.lattice != 0 ? universes_.findUniverse(cell.universe) : nullptr;
+        if (!universe) {
+            continue;
+        }
+        for (const auto& entry : universe->cells) {
+            if (entry.id != cell.id || !entry.lattice) {
+                continue;
+            }
+            const glm::dvec3& pitch = entry.lattice->pitch;
+            const bool hex = entry.lattice->type == mcnp::core::LatticeType::Hexagonal;
+            half = glm::max(half, glm::dvec3(0.5 * pitch.x, hex ? pitch.x / std::sqrt(3.0) : 0.5 * pitch.y,
+                                             0.5 * pitch.z));
+        }
+    }
+    for (int axis = 0; axis < 3; ++axis) {
+        if (half[axis] <= 0.0) {
+            half[axis] = bounds_;
+        }
+    }
+
+    std::vector<std::pair<int, mcnp::core::CsgDag::NodeId>> work;
+    for (const auto& cell : compiled.cells) {
+        if (cell.universe != 0 && cell.fill == 0 && cell.lattice == 0 &&
+            cell.region != mcnp::core::CsgDag::kInvalid && (cell.material != 0 || showVoid_)) {
+            work.emplace_back(cell.id, cell.region);
+        }
+    }
+    auto options = universeStream_.options();
+    options.boundsMin = -half;
+    options.boundsMax = half;
+    universeStream_.setOptions(options);
+    universeStream_.start(compiled.dag, deck_.surfaces().table, std::move(work));
+    universesDirty_ = true;
+}
+
+void DeckPanel::DeliverUniverses()
+{
+    universesDirty_ = false;
+    // 同一宇宙的单元合并为一个网格，每个宇宙一次实例化绘制
+    std::map<int, Mesh> merged;
+    for (const auto& [id, cellMesh] : universeCells_) {
+        const auto* cell = deck_.cells().find(id);
+        if (!cellMesh->error.empty()) {
+            LogManager::getInstance()->logOperation("Deck", CellMeshName(id) + ": " + cellMesh->error);
+        }
+        if (!cell || cellMesh->indices.empty()) {
+            continue;
+        }
+        Mesh& mesh = merged.try_emplace(cell->universe, "Universe " + std::to_string(cell->universe)).first->second;
+        AppendTriangles(mesh, *cellMesh, MaterialColor(cell->material));
+    }
+    auto& renderer = mcnp::render::SceneLatticeRenderer();
+    renderer.ClearMeshes();
+    for (const auto& [universe, mesh] : merged) {
+        renderer.SetUniverseMesh(universe, mesh);
+    }
+}
+
+void DeckPanel::Update()
+{
+    bool full = false;
+    std::vector<int> cells = TakeImpactedCells(&full);
+    if (meshAll_ || full || !cells.empty()) {
+        RestartMeshing(cells, meshAll_ || full);
+        meshAll_ = false;
+        universesPending_ = true;
+    }
+    // 连续输入时不重复比较：停止编辑片刻且上一次比较已结束才开始新的一次
+    PollDiff();
+    if (diffPending_ && !diffJob_.valid() && std::chrono::steady_clock::now() - editedAt_ >= kDiffDelay) {
+        StartDiff();
+    }
+    for (const auto& result : meshStream_.poll()) {
+        awaiting_.erase(result.cell);
+        Deliver(result);
+    }
+
+    if (universesPending_) {
+        RebuildUniverses();
+    }
+    // 先读状态再取结果：批次已结束时本次 poll 取到的就是最后一批
+    const bool universeBusy = universeStream_.busy();
+    for (const auto& result : universeStream_.poll()) {
+        universeCells_[result.cell] = result.mesh;
+        universesDirty_ = true;
+    }
+    if (universesDirty_ && !universeBusy) {
+        DeliverUniverses();
+    }
+
+    if (viewportPick.serial != pickSerial_) {
+        pickSerial_ = viewportPick.serial;
+        if (universesReady_) {
+            Pick(glm::dvec3(viewportPick.origin), glm::dvec3(viewportPick.direction));
+        }
+    }
+}
+
+// 栅格实例不在 meshes 中，不能按三角形拾取：拾取射线裁到世界范围内，沿射线追踪到第一个可见单元，
+// 在其入射点处 locate 得到从根宇宙到叶单元的完整路径
+void DeckPanel::Pick(const glm::dvec3& origin, const glm::dvec3& direction)
+{
+    double enter = 0.0;
+    double leave = std::numeric_limits<double>::infinity();
+    for (int axis = 0; axis < 3; ++axis) {
+        if (std::abs(direction[axis]) < 1e-12) {
+            if (std::abs(origin[axis]) > bounds_) {
+                leave = -1.0;
+            }
+            continue;
+        }
+        const double a = (-bounds_ - origin[axis]) / direction[axis];
+        const double b = (bounds_ - origin[axis]) / direction[axis];
+        enter = std::max(enter, std::min(a, b));
+        leave = std::min(leave, std::max(a, b));
+    }
+    picked_ = "nothing";
+    if (enter >= leave) {
+        return;
+    }
+    const glm::dvec3 entry = origin + direction * enter;
+    const double step = bounds_ / 2048.0;
+    for (const auto& segment : universes_.trace(entry, direction, leave - enter, step)) {
+        if (segment.material == 0 && !showVoid_) {
+            continue;
+        }
+        const double t = segment.t0 + 0.5 * std::min(step, segment.t1 - segment.t0);
+        const mcnp::core::PointLocation location = universes_.locate(entry + direction * t);
+        if (!location.found) {
+            continue;
+        }
+        std::ostringstream path;
+        for (std::size_t i = 0; i < location.path.size(); ++i) {
+            const auto& level = location.path[i];
+            path << (i > 0 ? " > " : "");
+            if (level.universe != 0) {
+                path << "u" << level.universe << " ";
+            }
+            path << "cell " << level.cell;
+            if (level.inLattice) {
+                path << " [" << level.latticeIndex.x << "," << level.latticeIndex.y << "," << level.latticeIndex.z
+                     << "]";
+            }
+        }
+        path << " (m" << location.material << ")";
+        picked_ = path.str();
+        LogManager::getInstance()->logOperation("Deck", "Picked " + picked_);
+        return;
+    }
+}
+
+std::vector<int> DeckPanel::TakeImpactedCells(bool* full)
+{
+    std::sort(impacted_.begin(), impacted_.end());
+    impacted_.erase(std::unique(impacted_.begin(), impacted_.end()), impacted_.end());
+    if (full) {
+        *full = fullPending_;
+    }
+    fullPending_ = false;
+    return std::exchange(impacted_, {});
+}
+
+void DeckPanel::Draw()
+{
+    ImGui::InputText("##deckpath", path_.data(), path_.capacity() + 1, ImGuiInputTextFlags_CallbackResize,
+                     ResizeCallback, &path_);
+    ImGui::SameLine();
+    if (ImGui::Button("Load")) {
+        Load();
+    }
+
+    const float height = std::max(ImGui::GetTextLineHeight() * 12, ImGui::GetContentRegionAvail().y * 0.6f);
+    if (ImGui::InputTextMultiline("##deck", editor_.data(), editor_.capacity() + 1, ImVec2(-1.0f, height),
+                                  ImGuiInputTextFlags_CallbackResize | ImGuiInputTextFlags_AllowTabInput,
+                                  ResizeCallback, &editor_)) {
+        ApplyEditorChange();
+    }
+
+    const auto& cells = deck_.cells().cells;
+    ImGui::Text("%zu cards, %zu cells, %zu surface rows", deck_.ast().cardCount(), cells.size(),
+                deck_.surfaces().table.size());
+    ImGui::Text("%s: %zu cards in %.2f ms", last_.fullReparse ? "Full parse" : "Incremental", last_.reparsedCards,
+                last_.milliseconds);
+    if (!last_.fullReparse) {
+        ImGui::Text("%zu surfaces changed, %zu cells recompiled, %zu to re-mesh", last_.changedSurfaces.size(),
+                    last_.recompiledCells.size(), last_.impactedCells.size());
+    }
+
+    if (!errors_.empty() && ImGui::TreeNode("Errors", "Errors (%zu)", errors_.size())) {
+        for (const auto& error : errors_) {
+            ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s%s%zu: %s", error.source.c_str(),
+                               error.source.empty() ? "line " : ":", error.line, error.message.c_str());
+        }
+        ImGui::TreePop();
+    }
+    const auto& diagnostics = checker_.diagnostics();
+    if (!diagnostics.empty() && ImGui::TreeNode("Diagnostics", "Diagnostics (%zu)", diagnostics.size())) {
+        for (const auto& diagnostic : diagnostics) {
+            const bool error = diagnostic.severity == mcnp::parser::DiagnosticSeverity::Error;
+            ImGui::TextColored(error ? ImVec4(1.0f, 0.4f, 0.4f, 1.0f) : ImVec4(1.0f, 0.8f, 0.3f, 1.0f),
+                               "%s%s%zu: [%.*s] %s", diagnostic.source.c_str(), diagnostic.source.empty() ? "line " : ":",
+                               diagnostic.line, static_cast<int>(diagnostic.rule.size()), diagnostic.rule.data(),
+                               diagnostic.message.c_str());
+        }
+        ImGui::TreePop();
+    }
+
+    ImGui::Separator();
+    ImGui::InputText("##baseline", baselinePath_.data(), baselinePath_.capacity() + 1,
+                     ImGuiInputTextFlags_CallbackResize, ResizeCallback, &baselinePath_);
+    ImGui::SameLine();
+    if (ImGui::Button("Compare")) {
+        LoadBaseline();
+    }
+    if (baseline_) {
+        ImGui::SameLine();
+        if (ImGui::Button("Clear")) {
+            baseline_.reset();
+            diffPending_ = true;
+        }
+        ImGui::Text("%zu differences, %zu cards unchanged, %zu cells highlighted%s", diff_.entries.size(),
+                    diff_.unchanged, diff_.changedCells.size(), diffPending_ || diffJob_.valid() ? "..." : "");
+        if (!diff_.empty() && ImGui::TreeNode("Differences")) {
+            static const char* const kChangeNames[] = {"+", "-", "~", "#"};
+            static const char* const kKindNames[] = {"cell", "surface", "data", "comment", "card", "title", "message",
+                                                     "read"};
+            for (const auto& entry : diff_.entries) {
+                const char* change = kChangeNames[static_cast<int>(entry.change)];
+                const char* kind = kKindNames[static_cast<int>(entry.kind)];
+                if (entry.change == mcnp::parser::DiffChange::Renumbered) {
+                    ImGui::Text("%s %s %d -> %s (line %zu)", change, kind, entry.previousNumber, entry.key.c_str(),
+                                entry.afterLine);
+                } else if (entry.change == mcnp::parser::DiffChange::Removed) {
+                    ImGui::Text("%s %s %s (base line %zu)", change, kind, entry.key.c_str(), entry.beforeLine);
+                } else {
+                    ImGui::Text("%s %s %s (line %zu)", change, kind, entry.key.c_str(), entry.afterLine);
+                }
+            }
+            ImGui::TreePop();
+        }
+    }
+
+    ImGui::Separator();
+    ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x * 0.5f);
+    ImGui::DragFloat("World half-size", &bounds_, 1.0f, 1.0f, 1.0e5f, "%.0f");
+    if (ImGui::Checkbox("Show void cells", &showVoid_)) {
+        meshAll_ = true;
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Mesh")) {
+        meshAll_ = true;
+    }
+    if (meshStream_.total() > 0) {
+        ImGui::SameLine();
+        ImGui::Text("%zu / %zu cells meshed (%zu cached)%s", meshStream_.completed(), meshStream_.total(),
+                    meshStream_.cacheHits(), meshStream_.busy() ? "..." : "");
+    }
+    if (!picked_.empty()) {
+        ImGui::TextWrapped("Picked: %s", picked_.c_str());
+    }
+}
+
+} // namespace mcnp::ui
@@ -0,0 +1,88 @@
+#ifndef DECK_PANEL_H
+#define DECK_PANEL_H
+
+#include "cell_mesher.h"
+#include "deck_checker.h"
+#include "deck_diff.h"
+#include "incremental_deck.h"
+#include "universe_resolver.h"
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace mcnp::ui {
+
+// 侧边栏“Deck”页：内嵌的 MCNP 卡片编辑器。每次修改按公共前后缀求出编辑区间，
+// 交给 IncrementalDeck 局部重新解析、编译并由 DeckChecker 增量检查，受影响的单元在后台重新网格化，
+// 完成一个就替换视口中名为 "Cell <n>" 的物体。U= 不为 0 的单元在宇宙局部坐标中网格化，
+// 由 SceneLatticeRenderer 在各 FILL 处与栅格元素处实例化绘制，视口点击处的单元由 UniverseResolver 定位并列出
+// 宇宙/栅格路径。载入比较基准后，与基准结构不同的单元在视口中高亮。
+class DeckPanel {
+public:
+    DeckPanel();
+
+    void Draw();
+    // 每帧调用（与页签是否可见无关）：启动新一批网格化并取走已完成的单元
+    void Update();
+
+    // 取走自上次调用以来受影响的单元号（供视口重新网格化）；全量重解析时 full 为 true
+    std::vector<int> TakeImpactedCells(bool* full = nullptr);
+    const mcnp::parser::IncrementalDeck& Deck() const noexcept { return deck_; }
+
+private:
+    void Load();
+    void ApplyEditorChange();
+    void Record(const mcnp::parser::DeckUpdate& update);
+    void RestartMeshing(const std::vector<int>& cells, bool all);
+    void Deliver(const mcnp::parser::MeshedCell& result);
+    void RebuildUniverses();
+    void DeliverUniverses();
+    void Pick(const glm::dvec3& origin, const glm::dvec3& direction);
+    void LoadBaseline();
+    void StartDiff();
+    void PollDiff();
+    void ApplyDiff(mcnp::parser::DeckDiff diff);
+    glm::vec3 CellColor(int cell, const glm::vec3& base) const;
+
+    mcnp::parser::IncrementalDeck deck_;
+    std::string editor_;  // InputTextMultiline 直接编辑的缓冲区
+    std::string path_;
+    std::vector<int> impacted_;
+    bool fullPending_{false};
+    mcnp::parser::DeckUpdate last_;
+    std::vector<mcnp::parser::ParseError> errors_;
+    mcnp::parser::DeckChecker checker_;  // 随编辑窗口增量检查
+
+    mcnp::parser::CellMeshCache meshCache_;
+    mcnp::parser::CellMeshStream meshStream_{meshCache_};
+    std::unordered_set<int> awaiting_;  // 已排队但尚未交付的单元，新一批开始时并入
+    bool meshAll_{true};
+    bool showVoid_{false};
+    float bounds_{100.0f};
+
+    mcnp::core::UniverseResolver universes_;  // SceneLatticeRenderer 持有其指针
+    mcnp::parser::CellMeshStream universeStream_{meshCache_};
+    std::unordered_map<int, std::shared_ptr<const mcnp::parser::CellMesh>> universeCells_;  // 宇宙内单元的局部网格
+    bool universesPending_{false};
+    bool universesDirty_{false};  // 有新交付的宇宙单元，本批完成后重新上传
+    bool universesReady_{false};  // universes_ 已按当前卡片建好，视口拾取经它定位
+    unsigned pickSerial_{0};
+    std::string picked_;  // 最近一次视口拾取处的宇宙/栅格路径
+
+    std::string baselinePath_;
+    std::shared_ptr<const mcnp::parser::Ast> baseline_;  // 比较基准；停止输入片刻后在后台重新比较
+    mcnp::parser::DeckDiff diff_;
+    std::future<mcnp::parser::DeckDiff> diffJob_;
+    std::unordered_set<int> highlighted_;
+    bool diffPending_{false};
+    std::chrono::steady_clock::time_point editedAt_;
+};
+
+} // namespace mcnp::ui
+
+#endif // DECK_PANEL_H
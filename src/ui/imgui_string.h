@@ -0,0 +1,25 @@
+#ifndef IMGUI_STRING_H
+#define IMGUI_STRING_H
+
+#include <imgui.h>
+
+#include <cstddef>
+#include <string>
+
+namespace mcnp::ui {
+
+// dearimgui 目标未编译 imgui_stdlib，std::string 的扩容回调在此手写。
+// 配合 ImGuiInputTextFlags_CallbackResize 使用，UserData 为被编辑的 std::string
+inline int ResizeCallback(ImGuiInputTextCallbackData* data)
+{
+    if (data->EventFlag == ImGuiInputTextFlags_CallbackResize) {
+        auto* text = static_cast<std::string*>(data->UserData);
+        text->resize(static_cast<std::size_t>(data->BufTextLen));
+        data->Buf = text->data();
+    }
+    return 0;
+}
+
+} // namespace mcnp::ui
+
+#endif // IMGUI_STRING_H
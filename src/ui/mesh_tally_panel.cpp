@@ -0,0 +1,267 @@
+#include "mesh_tally_panel.h"
+#include "imgui_string.h"
+#include "volume_renderer.h"
+#include "render.h"
+#include "log_manager.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace mcnp::ui {
+
+namespace {
+
+double NowMilliseconds()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 与点云一致的近似 turbo 色图
+glm::vec3 Colormap(float t)
+{
+    return glm::clamp(glm::vec3(1.5f - std::fabs(4.0f * t - 3.0f), 1.5f - std::fabs(4.0f * t - 2.0f),
+                                1.5f - std::fabs(4.0f * t - 1.0f)),
+                      glm::vec3(0.0f), glm::vec3(1.0f));
+}
+
+// 视口中的等值面：面板写入，渲染回调读取
+Mesh& IsosurfaceMesh()
+{
+    static Mesh mesh("Isosurface");
+    return mesh;
+}
+
+void SetIsosurfaceMesh(Mesh mesh)
+{
+    Mesh& current = IsosurfaceMesh();
+    releaseMeshResources(current);
+    current = std::move(mesh);
+}
+
+} // namespace
+
+void MeshTallyPanel::Open()
+{
+    opened_ = meshtal_.open(path_);
+    selected_ = mcnp::parser::MeshtalFile::npos;
+    mcnp::render::SceneVolumeRenderer().SetVolume(nullptr, 0, {});
+    ResetIsosurface();
+    store_.reset();
+    loadError_.clear();
+    if (!opened_) {
+        LogManager::getInstance()->logOperation("Mesh", "Cannot open " + path_ + ": " + meshtal_.error());
+        return;
+    }
+    LogManager::getInstance()->logOperation("Mesh", "Indexed " + std::to_string(meshtal_.tallies().size()) +
+                                                        " mesh tallies in " + path_);
+}
+
+void MeshTallyPanel::Load(std::size_t index)
+{
+    selected_ = index;
+    mcnp::render::SceneVolumeRenderer().SetVolume(nullptr, 0, {});
+    ResetIsosurface();
+    store_.reset();  // 释放上一个计数及其磁盘缓存
+    loadError_.clear();
+    mcnp::core::VoxelStoreOptions options;
+    options.values = halfPrecision_ ? mcnp::core::VoxelValueEncoding::Float16 : mcnp::core::VoxelValueEncoding::Float32;
+    loadStart_ = NowMilliseconds();
+    // 读入期间面板不访问 meshtal_，解析在后台线程中进行
+    pending_ = std::async(std::launch::async, [this, index, options]() { return meshtal_.load(index, options); });
+}
+
+void MeshTallyPanel::CollectResult()
+{
+    if (!pending_.valid() || pending_.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return;
+    }
+    store_ = pending_.get();
+    loadMilliseconds_ = NowMilliseconds() - loadStart_;
+    if (!store_) {
+        loadError_ = meshtal_.error();
+        LogManager::getInstance()->logOperation("Mesh", loadError_);
+        return;
+    }
+    LogManager::getInstance()->logOperation("Mesh", "Loaded mesh tally " +
+                                                        std::to_string(meshtal_.tallies()[selected_].number));
+    channel_ = static_cast<int>(store_->channels()) - 1;  // 默认显示总计档
+    ResetRange();
+    ApplyVolume();
+    isoLevel_ = std::sqrt(std::max(low_, 1e-30f) * high_);
+}
+
+void MeshTallyPanel::ResetRange()
+{
+    const auto range = store_->range(static_cast<std::size_t>(channel_));
+    high_ = std::max(range.second, 1e-30f);
+    low_ = logScale_ ? std::max(range.first, high_ * 1e-6f) : range.first;
+    ApplyTransfer();
+}
+
+void MeshTallyPanel::ApplyVolume()
+{
+    auto& renderer = mcnp::render::SceneVolumeRenderer();
+    if (!store_ || !showVolume_ || meshtal_.tallies()[selected_].geometry != mcnp::parser::MeshGeometry::Rectangular) {
+        renderer.SetVolume(nullptr, 0, {});
+        return;
+    }
+    // 分档可以不等距，渲染器按各轴边界换算
+    renderer.SetVolume(store_.get(), static_cast<std::size_t>(channel_), meshtal_.tallies()[selected_].bounds);
+}
+
+void MeshTallyPanel::ApplyTransfer()
+{
+    // cutoff 以下透明，其上不透明度线性增至 opacity
+    std::vector<mcnp::render::TransferPoint> points;
+    points.push_back({0.0f, glm::vec4(Colormap(0.0f), 0.0f)});
+    constexpr int kSteps = 4;
+    for (int i = 0; i <= kSteps; ++i) {
+        const float t = cutoff_ + (1.0f - cutoff_) * static_cast<float>(i) / kSteps;
+        points.push_back({t, glm::vec4(Colormap(t), opacity_ * static_cast<float>(i) / kSteps)});
+    }
+    mcnp::render::SceneVolumeRenderer().SetTransferFunction(low_, high_, logScale_, points);
+}
+
+void MeshTallyPanel::ResetIsosurface()
+{
+    extractor_.reset();
+    SetIsosurfaceMesh(Mesh("Isosurface"));
+}
+
+void MeshTallyPanel::UpdateIsosurface()
+{
+    if (!showIsosurface_) {
+        SetIsosurfaceMesh(Mesh("Isosurface"));
+        return;
+    }
+    if (!extractor_) {
+        const auto& header = meshtal_.tallies()[selected_];
+        mcnp::core::IsosurfaceOptions options;
+        options.edges = header.bounds;  // 分档可以不等距
+        extractor_ = std::make_unique<mcnp::core::IsosurfaceExtractor>(*store_, static_cast<std::size_t>(channel_),
+                                                                       options);
+    }
+    const double start = NowMilliseconds();
+    SetIsosurfaceMesh(extractor_->extract(isoLevel_));
+    isoMilliseconds_ = NowMilliseconds() - start;
+}
+
+void MeshTallyPanel::Draw()
+{
+    CollectResult();
+
+    ImGui::InputText("##meshtalpath", path_.data(), path_.capacity() + 1, ImGuiInputTextFlags_CallbackResize,
+                     ResizeCallback, &path_);
+    ImGui::SameLine();
+    const bool busy = pending_.valid();
+    if (busy) {
+        ImGui::BeginDisabled();
+    }
+    if (ImGui::Button("Open")) {
+        Open();
+    }
+    if (!opened_) {
+        if (busy) {
+            ImGui::EndDisabled();
+        }
+        return;
+    }
+
+    const auto& header = meshtal_.header();
+    ImGui::TextWrapped("%s", header.title.c_str());
+    ImGui::Checkbox("Half precision", &halfPrecision_);
+    const auto& tallies = meshtal_.tallies();
+    if (ImGui::BeginListBox("##meshtallies", ImVec2(-1.0f, ImGui::GetTextLineHeightWithSpacing() * 6))) {
+        for (std::size_t i = 0; i < tallies.size(); ++i) {
+            const auto dims = tallies[i].dims();
+            std::string label = "FMESH" + std::to_string(tallies[i].number) + "  " + tallies[i].particle + "  " +
+                                std::to_string(dims[0]) + "x" + std::to_string(dims[1]) + "x" +
+                                std::to_string(dims[2]);
+            if (!tallies[i].error.empty()) {
+                label += "  (" + tallies[i].error + ")";
+            }
+            if (ImGui::Selectable(label.c_str(), selected_ == i)) {
+                Load(i);
+            }
+        }
+        ImGui::EndListBox();
+    }
+    if (busy) {
+        ImGui::EndDisabled();
+        ImGui::Text("Loading...");
+        return;
+    }
+    if (!loadError_.empty()) {
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", loadError_.c_str());
+    }
+    if (!store_) {
+        return;
+    }
+
+    ImGui::Text("%zu channels, %zu bricks (%.1f ms)", store_->channels(), store_->brickCount(), loadMilliseconds_);
+    if (tallies[selected_].geometry != mcnp::parser::MeshGeometry::Rectangular) {
+        ImGui::TextDisabled("Volume rendering needs a rectangular mesh");
+        return;
+    }
+    bool volumeChanged = ImGui::Checkbox("Show volume", &showVolume_);
+    if (store_->channels() > 1) {
+        volumeChanged |= ImGui::SliderInt("Channel", &channel_, 0, static_cast<int>(store_->channels()) - 1);
+    }
+    if (volumeChanged) {
+        ApplyVolume();
+        ResetRange();
+        extractor_.reset();  // 通道可能已变
+        UpdateIsosurface();
+    }
+
+    bool transferChanged = ImGui::Checkbox("Log scale", &logScale_);
+    if (transferChanged) {
+        ResetRange();
+    }
+    transferChanged |= ImGui::DragFloatRange2("Range", &low_, &high_, std::max(high_ - low_, 1e-30f) * 0.01f, 0.0f,
+                                              0.0f, "%.3g", "%.3g");
+    transferChanged |= ImGui::SliderFloat("Cutoff", &cutoff_, 0.0f, 0.99f);
+    transferChanged |= ImGui::SliderFloat("Opacity", &opacity_, 0.01f, 1.0f);
+    if (transferChanged) {
+        ApplyTransfer();
+    }
+
+    auto& renderer = mcnp::render::SceneVolumeRenderer();
+    mcnp::render::VolumeRenderOptions options = renderer.Options();
+    bool optionsChanged = ImGui::SliderFloat("Resolution", &options.resolutionScale, 0.1f, 1.0f);
+    optionsChanged |= ImGui::SliderFloat("Step (voxels)", &options.stepVoxels, 0.25f, 4.0f);
+    if (optionsChanged) {
+        renderer.SetOptions(options);
+    }
+    const auto& stats = renderer.LastStats();
+    ImGui::Text("%zu visible bricks, %zu skipped, %zu resident%s", stats.visibleBricks, stats.skippedBricks,
+                stats.residentBricks, stats.full ? " (atlas full)" : "");
+
+    ImGui::Separator();
+    bool isoChanged = ImGui::Checkbox("Isosurface", &showIsosurface_);
+    const auto range = store_->range(static_cast<std::size_t>(channel_));
+    const float isoLow = logScale_ ? std::max(range.first, range.second * 1e-6f) : range.first;
+    isoChanged |= ImGui::SliderFloat("Iso level", &isoLevel_, isoLow, range.second, "%.3g",
+                                     logScale_ ? ImGuiSliderFlags_Logarithmic : ImGuiSliderFlags_None);
+    if (isoChanged) {
+        UpdateIsosurface();
+    }
+    if (showIsosurface_ && extractor_) {
+        const auto& iso = extractor_->stats();
+        ImGui::Text("%zu triangles, %zu bricks skipped, %zu passes (%.1f ms)", iso.triangles, iso.skippedBricks,
+                    iso.passes, isoMilliseconds_);
+    }
+}
+
+void RenderMeshTallyIsosurface()
+{
+    const Mesh& mesh = IsosurfaceMesh();
+    if (!mesh.indices.empty()) {
+        renderMesh(mesh);
+    }
+}
+
+} // namespace mcnp::ui
@@ -0,0 +1,60 @@
+#ifndef MESH_TALLY_PANEL_H
+#define MESH_TALLY_PANEL_H
+
+#include "isosurface.h"
+#include "meshtal_reader.h"
+#include "voxel_store.h"
+
+#include <future>
+#include <memory>
+#include <string>
+
+namespace mcnp::ui {
+
+// 侧边栏“Mesh”页：打开 meshtal 文件，后台把选中的网格计数读入分砖存储，
+// 在视口中按传输函数做体绘制（由 SceneVolumeRenderer 与场景几何合成），并可提取等值面。
+class MeshTallyPanel {
+public:
+    void Draw();
+
+private:
+    void Open();
+    void Load(std::size_t index);
+    void CollectResult();
+    void ResetRange();
+    void ApplyVolume();
+    void ApplyTransfer();
+    void UpdateIsosurface();
+    void ResetIsosurface();
+
+    mcnp::parser::MeshtalFile meshtal_;
+    std::string path_;
+    bool opened_{false};
+    std::size_t selected_{mcnp::parser::MeshtalFile::npos};
+    std::future<std::unique_ptr<mcnp::core::VoxelBrickStore>> pending_;
+    std::unique_ptr<mcnp::core::VoxelBrickStore> store_;
+    std::string loadError_;
+    double loadStart_{0.0};
+    double loadMilliseconds_{0.0};
+    bool halfPrecision_{true};
+
+    int channel_{0};
+    float low_{1e-6f};
+    float high_{1.0f};
+    bool logScale_{true};
+    float cutoff_{0.2f};   // 归一化值低于该位置完全透明
+    float opacity_{0.6f};
+    bool showVolume_{true};
+
+    std::unique_ptr<mcnp::core::IsosurfaceExtractor> extractor_;  // 缓存当前通道解码后的砖块
+    bool showIsosurface_{false};
+    float isoLevel_{0.0f};
+    double isoMilliseconds_{0.0};
+};
+
+// 在视口中绘制当前的等值面网格（由 RenderSceneToViewport 在场景网格之后调用，沿用其着色器）
+void RenderMeshTallyIsosurface();
+
+} // namespace mcnp::ui
+
+#endif // MESH_TALLY_PANEL_H
@@ -4,6 +4,11 @@
 #include "../../io/scene_manager.h"
 #include "../../core/log_manager.h"
 #include "../transform_controller.h"
+#include "../shielding_panel.h"
+#include "../source_panel.h"
+#include "../deck_panel.h"
+#include "../tally_panel.h"
+#include "../mesh_tally_panel.h"
 
 namespace mcnp::ui {
 
@@ -24,6 +29,7 @@ private:
     void OnDraw() override
     {
         width_ = ImGui::GetWindowSize().x;
+        deck_.Update();
 
         if (ImGui::BeginTabBar("SideBarTabs")) {
             if (ImGui::BeginTabItem("View")) {
@@ -206,11 +212,41 @@ private:
                 ImGui::EndTabItem();
             }
 
+            if (ImGui::BeginTabItem("Shielding")) {
+                shielding_.Draw(meshes);
+                ImGui::EndTabItem();
+            }
+
+            if (ImGui::BeginTabItem("Source")) {
+                source_.Draw();
+                ImGui::EndTabItem();
+            }
+
+            if (ImGui::BeginTabItem("Deck")) {
+                deck_.Draw();
+                ImGui::EndTabItem();
+            }
+
+            if (ImGui::BeginTabItem("Tallies")) {
+                tallies_.Draw();
+                ImGui::EndTabItem();
+            }
+
+            if (ImGui::BeginTabItem("Mesh")) {
+                meshTallies_.Draw();
+                ImGui::EndTabItem();
+            }
+
             ImGui::EndTabBar();
         }
     }
 
     float width_{320.0f};
+    ShieldingPanel shielding_;
+    SourcePanel source_;
+    DeckPanel deck_;
+    TallyPanel tallies_;
+    MeshTallyPanel meshTallies_;
 };
 
 } // namespace mcnp::ui
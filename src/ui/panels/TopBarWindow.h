@@ -4,11 +4,14 @@
 #include <imgui.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <fstream>
+#include <memory>
 #include "ImGuiFileDialog.h"
 
 #include "../MWindows.h"
 #include "../../io/config_manager.h"
 #include "../../io/scene_manager.h"
+#include "../../io/mcnp_writer.h"
 #include "../../core/log_manager.h"
 #include "ViewportWindow.h"
 
@@ -72,6 +75,9 @@ private:
             if (ImGui::MenuItem("另存为...")) {
                 OpenFileDialog("ChooseFileToSaveDlgKey", "Save Scene As");
             }
+            if (ImGui::MenuItem("导出 MCNP...", nullptr, false, !meshes.empty())) {
+                OpenFileDialog("ChooseMcnpExportDlgKey", "Export MCNP Input", ".i,.inp,.txt");
+            }
             ImGui::Separator();
             if (ImGui::MenuItem("退出")) {
                 LogManager::getInstance()->logInfo("Exit requested");
@@ -246,6 +252,39 @@ private:
             }
             fileDialog_.Close();
         }
+
+        if (fileDialog_.Display("ChooseMcnpExportDlgKey")) {
+            if (fileDialog_.IsOk()) {
+                ExportMcnp(fileDialog_.GetFilePathName());
+            }
+            fileDialog_.Close();
+        }
+    }
+
+    // 内置图元按名称前缀映射为单位二次曲面，布尔结果导出其运算树；网格的变换作为放置矩阵
+    void ExportMcnp(const std::string& path)
+    {
+        std::vector<mcnp::parser::GeometryCell> cells;
+        for (const Mesh& mesh : meshes) {
+            auto node = meshGeometry(mesh);
+            if (!node) {
+                LogManager::getInstance()->logWarning("MCNP export skips mesh without primitive: " + mesh.name);
+                continue;
+            }
+            cells.push_back({std::move(node), glm::dmat4(mesh.transform)});
+        }
+
+        std::ofstream out(path, std::ios::binary);
+        if (!out) {
+            LogManager::getInstance()->logError("Cannot write MCNP input: " + path);
+            return;
+        }
+        const mcnp::parser::DeckWriteStats stats = mcnp::parser::exportGeometry(out, cells);
+        for (const std::string& warning : stats.warnings) {
+            LogManager::getInstance()->logWarning("MCNP export: " + warning);
+        }
+        LogManager::getInstance()->logOperation("File", "Export MCNP: " + path + " (" + std::to_string(stats.cells) +
+                                                            " cells, " + std::to_string(stats.surfaces) + " surfaces)");
     }
 
     void DrawAbout()
@@ -286,7 +325,7 @@ public:
     bool ConsoleLogEnabled() const noexcept { return consoleLogEnabled_; }
 
 private:
-    void OpenFileDialog(const char* key, const char* title)
+    void OpenFileDialog(const char* key, const char* title, const char* filters = ".json,.JSON")
     {
         IGFD::FileDialogConfig config;
         config.path = "user/scenes/";
@@ -296,7 +335,7 @@ private:
         dialogSize.y *= 0.6f;
         ImGui::SetNextWindowSize(dialogSize);
 
-        fileDialog_.OpenDialog(key, title, ".json,.JSON", config);
+        fileDialog_.OpenDialog(key, title, filters, config);
     }
 
     MWindows* side_{nullptr};
@@ -0,0 +1,215 @@
+#include "shielding_panel.h"
+#include "log_manager.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <limits>
+
+namespace mcnp::ui {
+
+namespace {
+
+// 约 1 MeV 光子的典型质量衰减系数与 Taylor 积累因子参数
+const mcnp::core::ShieldMaterial kPresetMaterials[] = {
+    {{"Water", 1.0, 0.0707}, {11.0, -0.104, 0.030}},
+    {{"Concrete", 2.3, 0.0635}, {9.9, -0.083, 0.019}},
+    {{"Iron", 7.874, 0.0599}, {8.0, -0.089, 0.040}},
+    {{"Lead", 11.35, 0.0710}, {2.84, -0.035, 0.029}},
+};
+
+const char* kRoleNames[] = {"None", "Shield", "Source", "Detector"};
+
+void hashCombine(std::size_t& seed, std::size_t value) {
+    seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+}
+
+bool startsWith(const std::string& text, const char* prefix) {
+    return text.rfind(prefix, 0) == 0;
+}
+
+} // namespace
+
+mcnp::core::ShieldBody ShieldingPanel::BodyFromMesh(const Mesh& mesh) {
+    mcnp::core::ShieldBody body;
+    body.label = mesh.name;
+
+    glm::vec3 lo(std::numeric_limits<float>::max());
+    glm::vec3 hi(std::numeric_limits<float>::lowest());
+    for (const auto& vertex : mesh.vertices) {
+        lo = glm::min(lo, vertex.position);
+        hi = glm::max(hi, vertex.position);
+    }
+    if (mesh.vertices.empty()) {
+        lo = glm::vec3(-0.5f);
+        hi = glm::vec3(0.5f);
+    }
+    const glm::vec3 center = (lo + hi) * 0.5f;
+    const glm::vec3 half = glm::max((hi - lo) * 0.5f, glm::vec3(1e-4f));
+
+    if (startsWith(mesh.name, "Sphere")) {
+        body.primitive = mcnp::core::PrimitiveType::Sphere;
+        body.halfExtents = glm::vec3(std::max(half.x, std::max(half.y, half.z)));
+    } else if (startsWith(mesh.name, "Cylinder")) {
+        body.primitive = mcnp::core::PrimitiveType::Cylinder;
+        body.halfExtents = glm::vec3(std::max(half.x, half.z), half.y, std::max(half.x, half.z));
+    } else {
+        body.primitive = mcnp::core::PrimitiveType::Box;
+        body.halfExtents = half;
+    }
+    // 包围盒中心偏移并入局部变换
+    body.localToWorld = mesh.transform * glm::translate(glm::mat4(1.0f), center);
+    return body;
+}
+
+glm::vec3 ShieldingPanel::WorldCenter(const Mesh& mesh) {
+    return glm::vec3(BodyFromMesh(mesh).localToWorld[3]);
+}
+
+ShieldingPanel::Binding& ShieldingPanel::BindingFor(const Mesh& mesh) {
+    auto it = std::find_if(bindings_.begin(), bindings_.end(),
+                           [&](const Binding& b) { return b.meshName == mesh.name; });
+    if (it != bindings_.end()) {
+        return *it;
+    }
+    Binding binding;
+    binding.meshName = mesh.name;
+    bindings_.push_back(binding);
+    return bindings_.back();
+}
+
+std::size_t ShieldingPanel::Fingerprint(const std::vector<Mesh>& sceneMeshes) const {
+    std::size_t seed = std::hash<float>{}(sourceStrength_);
+    for (const auto& binding : bindings_) {
+        if (binding.role == ShieldingRole::None) {
+            continue;
+        }
+        auto it = std::find_if(sceneMeshes.begin(), sceneMeshes.end(),
+                               [&](const Mesh& m) { return m.name == binding.meshName; });
+        if (it == sceneMeshes.end()) {
+            continue;
+        }
+        hashCombine(seed, std::hash<std::string>{}(binding.meshName));
+        hashCombine(seed, static_cast<std::size_t>(binding.role) * 31 + static_cast<std::size_t>(binding.material));
+        hashCombine(seed, binding.volumetric ? 1 : 0);
+        hashCombine(seed, std::hash<float>{}(binding.responseFactor));
+        for (int c = 0; c < 4; ++c) {
+            for (int r = 0; r < 4; ++r) {
+                hashCombine(seed, std::hash<float>{}(it->transform[c][r]));
+            }
+        }
+    }
+    return seed;
+}
+
+void ShieldingPanel::Recompute(const std::vector<Mesh>& sceneMeshes) {
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<mcnp::core::ShieldBody> bodies;
+    std::vector<mcnp::core::DetectorInfo> detectors;
+    mcnp::core::PointKernelSource source;
+    bool haveSource = false;
+
+    for (const auto& mesh : sceneMeshes) {
+        auto it = std::find_if(bindings_.begin(), bindings_.end(),
+                               [&](const Binding& b) { return b.meshName == mesh.name; });
+        if (it == bindings_.end() || it->role == ShieldingRole::None) {
+            continue;
+        }
+        switch (it->role) {
+            case ShieldingRole::Shield: {
+                auto body = BodyFromMesh(mesh);
+                body.material = it->material;
+                bodies.push_back(body);
+                break;
+            }
+            case ShieldingRole::Source:
+                if (!haveSource) {
+                    source.info.name = mesh.name;
+                    source.info.position = WorldCenter(mesh);
+                    source.info.strength = sourceStrength_;
+                    source.volumetric = it->volumetric;
+                    source.volume = BodyFromMesh(mesh);
+                    haveSource = true;
+                }
+                break;
+            case ShieldingRole::Detector: {
+                mcnp::core::DetectorInfo detector;
+                detector.name = mesh.name;
+                detector.id = static_cast<int>(detectors.size());
+                detector.position = WorldCenter(mesh);
+                detector.responseFactor = it->responseFactor;
+                detectors.push_back(detector);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    engine_.setBodies(std::move(bodies));
+    engine_.setDetectors(std::move(detectors));
+    engine_.setSource(source);
+    results_ = haveSource ? engine_.evaluate() : std::vector<mcnp::core::DetectorResult>{};
+
+    lastMilliseconds_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void ShieldingPanel::Draw(std::vector<Mesh>& sceneMeshes) {
+    if (!materialsReady_) {
+        for (const auto& material : kPresetMaterials) {
+            engine_.addMaterial(material);
+        }
+        materialsReady_ = true;
+    }
+
+    ImGui::DragFloat("Source Strength", &sourceStrength_, 1.0e4f, 0.0f, 1.0e12f, "%.3e");
+    ImGui::Separator();
+
+    for (const auto& mesh : sceneMeshes) {
+        Binding& binding = BindingFor(mesh);
+        ImGui::PushID(mesh.name.c_str());
+        int role = static_cast<int>(binding.role);
+        ImGui::SetNextItemWidth(110.0f);
+        if (ImGui::Combo("##role", &role, kRoleNames, IM_ARRAYSIZE(kRoleNames))) {
+            binding.role = static_cast<ShieldingRole>(role);
+            LogManager::getInstance()->logOperation("Shielding", "Role change: " + mesh.name);
+        }
+        ImGui::SameLine();
+        ImGui::TextUnformatted(mesh.name.c_str());
+        if (binding.role == ShieldingRole::Shield) {
+            const auto& materials = engine_.materials();
+            const char* preview = materials[static_cast<std::size_t>(binding.material)].info.name.c_str();
+            if (ImGui::BeginCombo("Material", preview)) {
+                for (int m = 0; m < static_cast<int>(materials.size()); ++m) {
+                    if (ImGui::Selectable(materials[static_cast<std::size_t>(m)].info.name.c_str(), binding.material == m)) {
+                        binding.material = m;
+                    }
+                }
+                ImGui::EndCombo();
+            }
+        } else if (binding.role == ShieldingRole::Source) {
+            ImGui::Checkbox("Volume Source", &binding.volumetric);
+        } else if (binding.role == ShieldingRole::Detector) {
+            ImGui::DragFloat("Response", &binding.responseFactor, 0.01f, 0.0f, 1.0e6f, "%.4g");
+        }
+        ImGui::PopID();
+    }
+
+    // 对象变换或配置改变时才重新计算
+    const std::size_t fingerprint = Fingerprint(sceneMeshes);
+    if (fingerprint != lastFingerprint_) {
+        lastFingerprint_ = fingerprint;
+        Recompute(sceneMeshes);
+    }
+
+    ImGui::Separator();
+    ImGui::Text("Detectors (%.2f ms)", lastMilliseconds_);
+    for (const auto& result : results_) {
+        ImGui::Text("%s: flux %.3e  dose %.3e", result.detector.name.c_str(), result.flux, result.dose);
+    }
+}
+
+} // namespace mcnp::ui
@@ -0,0 +1,54 @@
+#ifndef SHIELDING_PANEL_H
+#define SHIELDING_PANEL_H
+
+#include "vertex_mesh.h"
+#include "point_kernel.h"
+
+#include <vector>
+
+namespace mcnp::ui {
+
+// 场景对象在点核屏蔽计算中的角色
+enum class ShieldingRole {
+    None,
+    Shield,
+    Source,
+    Detector
+};
+
+// 侧边栏“Shielding”页：为场景对象指定屏蔽体/源/探测器角色，
+// 对象被拖拽（TransformController）或在属性页修改后，探测器结果实时刷新。
+class ShieldingPanel {
+public:
+    void Draw(std::vector<Mesh>& sceneMeshes);
+
+    // 由网格局部包围盒与名称推断屏蔽体形状
+    static mcnp::core::ShieldBody BodyFromMesh(const Mesh& mesh);
+    // 网格包围盒中心的世界坐标，与 BodyFromMesh 的局部坐标原点一致
+    static glm::vec3 WorldCenter(const Mesh& mesh);
+
+private:
+    struct Binding {
+        std::string meshName;
+        ShieldingRole role = ShieldingRole::None;
+        int material = 0;
+        bool volumetric = false;
+        float responseFactor = 1.0f;
+    };
+
+    Binding& BindingFor(const Mesh& mesh);
+    std::size_t Fingerprint(const std::vector<Mesh>& sceneMeshes) const;
+    void Recompute(const std::vector<Mesh>& sceneMeshes);
+
+    mcnp::core::PointKernelEngine engine_;
+    std::vector<Binding> bindings_;
+    std::vector<mcnp::core::DetectorResult> results_;
+    float sourceStrength_{1.0e6f};
+    std::size_t lastFingerprint_{0};
+    double lastMilliseconds_{0.0};
+    bool materialsReady_{false};
+};
+
+} // namespace mcnp::ui
+
+#endif // SHIELDING_PANEL_H
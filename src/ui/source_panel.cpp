@@ -0,0 +1,125 @@
+#include "source_panel.h"
+#include "imgui_string.h"
+#include "point_cloud.h"
+#include "log_manager.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+
+namespace mcnp::ui {
+
+namespace {
+
+// 视口预览状态：面板写入，渲染回调读取
+struct SourcePreview {
+    mcnp::render::PointCloud cloud;
+    bool visible = true;
+    float pointSize = 2.0f;
+    float minEnergy = 0.01f;
+    float maxEnergy = 20.0f;
+    bool logScale = true;
+};
+
+SourcePreview& Preview()
+{
+    static SourcePreview preview;
+    return preview;
+}
+
+double NowMilliseconds()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+SourcePanel::SourcePanel()
+    : cards_("sdef pos=0 0 0 rad=d1 erg=d2\n"
+             "si1 0 2\n"
+             "sp2 -3 0.965 2.29\n")
+{
+}
+
+void SourcePanel::StartSampling()
+{
+    auto parsed = mcnp::core::parseSourceCards(cards_);
+    errors_ = parsed.errors;
+    if (!errors_.empty()) {
+        LogManager::getInstance()->logOperation("Source", "SDEF parse failed: " + errors_.front());
+        return;
+    }
+    const std::size_t count = static_cast<std::size_t>(std::max(particleCount_, 1));
+    const auto seed = static_cast<std::uint64_t>(seed_);
+    startTime_ = NowMilliseconds();
+    // 整批抽样在后台线程中进行，内部 parallelFor 由调用线程参与，避免阻塞 UI
+    pending_ = std::async(std::launch::async, [definition = std::move(parsed.definition), count, seed]() {
+        return mcnp::core::SourceSampler(definition).sample(count, seed);
+    });
+}
+
+void SourcePanel::CollectResult()
+{
+    if (!pending_.valid() || pending_.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return;
+    }
+    const mcnp::core::SourceSamples samples = pending_.get();
+    lastMilliseconds_ = NowMilliseconds() - startTime_;
+    sampledCount_ = samples.size();
+    histogram_ = mcnp::core::energyHistogram(samples.energy, 64, minEnergy_, maxEnergy_, logEnergy_);
+    Preview().cloud.Upload(samples.x, samples.y, samples.z, samples.energy);
+    LogManager::getInstance()->logOperation("Source", "Sampled " + std::to_string(sampledCount_) + " particles");
+}
+
+void SourcePanel::Draw()
+{
+    CollectResult();
+
+    ImGui::InputTextMultiline("##sdef", cards_.data(), cards_.capacity() + 1,
+                              ImVec2(-1.0f, ImGui::GetTextLineHeight() * 8), ImGuiInputTextFlags_CallbackResize,
+                              ResizeCallback, &cards_);
+    for (const auto& error : errors_) {
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", error.c_str());
+    }
+
+    ImGui::DragInt("Particles", &particleCount_, 10000.0f, 1, 50'000'000);
+    ImGui::InputInt("Seed", &seed_);
+    const bool busy = pending_.valid();
+    if (busy) {
+        ImGui::BeginDisabled();
+    }
+    if (ImGui::Button(busy ? "Sampling..." : "Sample", ImVec2(-1, 0))) {
+        StartSampling();
+    }
+    if (busy) {
+        ImGui::EndDisabled();
+    }
+
+    SourcePreview& preview = Preview();
+    ImGui::Checkbox("Show Points", &preview.visible);
+    ImGui::SliderFloat("Point Size", &preview.pointSize, 1.0f, 8.0f);
+    ImGui::DragFloatRange2("Energy (MeV)", &minEnergy_, &maxEnergy_, 0.01f, 1e-6f, 1e3f, "%.3g", "%.3g");
+    ImGui::Checkbox("Log Energy", &logEnergy_);
+    preview.minEnergy = minEnergy_;
+    preview.maxEnergy = maxEnergy_;
+    preview.logScale = logEnergy_;
+
+    if (sampledCount_ > 0) {
+        ImGui::Text("%zu particles (%.1f ms), %zu drawn", sampledCount_, lastMilliseconds_, preview.cloud.Count());
+        ImGui::PlotHistogram("##spectrum", histogram_.data(), static_cast<int>(histogram_.size()), 0,
+                             "Energy spectrum", 0.0f, FLT_MAX, ImVec2(-1.0f, 80.0f));
+    }
+}
+
+void RenderSourcePreview(const glm::mat4& view, const glm::mat4& projection)
+{
+    const SourcePreview& preview = Preview();
+    if (!preview.visible) {
+        return;
+    }
+    preview.cloud.Draw(view, projection, preview.pointSize, preview.minEnergy, preview.maxEnergy, preview.logScale);
+}
+
+} // namespace mcnp::ui
@@ -0,0 +1,44 @@
+#ifndef SOURCE_PANEL_H
+#define SOURCE_PANEL_H
+
+#include "source_sampler.h"
+
+#include <glm/glm.hpp>
+
+#include <future>
+#include <string>
+#include <vector>
+
+namespace mcnp::ui {
+
+// 侧边栏“Source”页：编辑 SDEF/SIn/SPn 卡片，后台抽样并在视口中显示点云与能谱。
+class SourcePanel {
+public:
+    SourcePanel();
+
+    void Draw();
+
+private:
+    void StartSampling();
+    void CollectResult();
+
+    std::string cards_;
+    std::vector<std::string> errors_;
+    int particleCount_{1'000'000};
+    int seed_{12345};
+    float minEnergy_{0.01f};
+    float maxEnergy_{20.0f};
+    bool logEnergy_{true};
+    std::future<mcnp::core::SourceSamples> pending_;
+    std::vector<float> histogram_;
+    std::size_t sampledCount_{0};
+    double lastMilliseconds_{0.0};
+    double startTime_{0.0};
+};
+
+// 在视口中绘制最近一次抽样的源粒子点云（由 RenderSceneToViewport 调用）
+void RenderSourcePreview(const glm::mat4& view, const glm::mat4& projection);
+
+} // namespace mcnp::ui
+
+#endif // SOURCE_PANEL_H
@@ -0,0 +1,143 @@
+#include "tally_panel.h"
+#include "imgui_string.h"
+#include "log_manager.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+
+namespace mcnp::ui {
+
+namespace {
+
+const char* const kAxisNames[] = {"Entity", "Direct", "User", "Segment", "Multiplier", "Cosine", "Energy", "Time"};
+
+} // namespace
+
+void TallyPanel::Open()
+{
+    const auto start = std::chrono::steady_clock::now();
+    opened_ = mctal_.open(path_);
+    openMilliseconds_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    selected_ = mcnp::parser::MctalFile::npos;
+    pending_ = {};
+    tally_.reset();
+    plot_.clear();
+    plotErrors_.clear();
+    if (!opened_) {
+        LogManager::getInstance()->logOperation("Tally", "Cannot open " + path_ + ": " + mctal_.error());
+        return;
+    }
+    LogManager::getInstance()->logOperation("Tally", "Indexed " + std::to_string(mctal_.tallies().size()) +
+                                                         " tallies in " + path_);
+}
+
+void TallyPanel::Select(std::size_t index)
+{
+    selected_ = index;
+    entity_ = 0;
+    tally_.reset();  // 释放上一个计数
+    plot_.clear();
+    plotErrors_.clear();
+    pending_ = mctal_.request(index);
+}
+
+void TallyPanel::CollectResult()
+{
+    if (!pending_.valid() || pending_.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return;
+    }
+    tally_ = pending_.get();
+    pending_ = {};
+    if (!tally_->error.empty()) {
+        LogManager::getInstance()->logOperation("Tally", tally_->error);
+    }
+    BuildPlot();
+}
+
+void TallyPanel::BuildPlot()
+{
+    plot_.clear();
+    plotErrors_.clear();
+    if (!tally_ || !tally_->error.empty()) {
+        return;
+    }
+    // 其余维度取首个分档，只沿所选维度取值
+    std::array<std::size_t, mcnp::parser::kTallyAxisCount> bin{};
+    bin[0] = static_cast<std::size_t>(entity_);
+    const auto axis = static_cast<std::size_t>(axis_);
+    for (std::size_t i = 0; i < tally_->counts[axis]; ++i) {
+        bin[axis] = i;
+        const std::size_t index = tally_->index(bin);
+        plot_.push_back(static_cast<float>(tally_->values[index]));
+        plotErrors_.push_back(tally_->errors[index]);
+    }
+}
+
+void TallyPanel::Draw()
+{
+    CollectResult();
+
+    ImGui::InputText("##mctalpath", path_.data(), path_.capacity() + 1, ImGuiInputTextFlags_CallbackResize,
+                     ResizeCallback, &path_);
+    ImGui::SameLine();
+    if (ImGui::Button("Open")) {
+        Open();
+    }
+    if (!opened_) {
+        return;
+    }
+
+    const auto& header = mctal_.header();
+    ImGui::TextWrapped("%s", header.title.c_str());
+    ImGui::Text("%s %s, nps %lld, %zu tallies (indexed in %.1f ms)", header.code.c_str(), header.version.c_str(),
+                static_cast<long long>(header.nps), mctal_.tallies().size(), openMilliseconds_);
+
+    const auto& tallies = mctal_.tallies();
+    if (ImGui::BeginListBox("##tallies", ImVec2(-1.0f, ImGui::GetTextLineHeightWithSpacing() * 8))) {
+        for (std::size_t i = 0; i < tallies.size(); ++i) {
+            const std::string label = "F" + std::to_string(tallies[i].number) + "  " +
+                                      std::to_string(tallies[i].valueCount) + " bins  " + tallies[i].comment;
+            if (ImGui::Selectable(label.c_str(), selected_ == i)) {
+                Select(i);
+            }
+        }
+        ImGui::EndListBox();
+    }
+
+    if (pending_.valid()) {
+        ImGui::Text("Decoding...");
+        return;
+    }
+    if (!tally_) {
+        return;
+    }
+    if (!tally_->error.empty()) {
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", tally_->error.c_str());
+        return;
+    }
+
+    bool changed = ImGui::Combo("Along", &axis_, kAxisNames, IM_ARRAYSIZE(kAxisNames));
+    const int entities = static_cast<int>(tally_->counts[0]);
+    if (axis_ != 0 && entities > 1) {
+        changed |= ImGui::SliderInt("Entity bin", &entity_, 0, entities - 1);
+    }
+    if (changed) {
+        BuildPlot();
+    }
+    if (!plot_.empty()) {
+        ImGui::PlotHistogram("##tally", plot_.data(), static_cast<int>(plot_.size()), 0, nullptr, 0.0f, FLT_MAX,
+                             ImVec2(-1.0f, 120.0f));
+        const float worst = *std::max_element(plotErrors_.begin(), plotErrors_.end());
+        ImGui::Text("%zu bins, largest relative error %.4f", plot_.size(), worst);
+    }
+    if (!tally_->fluctuation.empty()) {
+        const auto& last = tally_->fluctuation.back();
+        ImGui::Text("TFC: mean %.5g, error %.4f, FOM %.3g", last.mean, last.error, last.fom);
+    }
+    ImGui::Text("%.1f MB decoded, %zu tallies resident", tally_->memoryBytes() / 1048576.0, mctal_.residentTallies());
+}
+
+} // namespace mcnp::ui
@@ -0,0 +1,40 @@
+#ifndef TALLY_PANEL_H
+#define TALLY_PANEL_H
+
+#include "mctal_reader.h"
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mcnp::ui {
+
+// 侧边栏“Tallies”页：打开 MCTAL 只建立索引，选中某个计数时才在线程池上解码，
+// 画出所选单元/曲面分档沿能量（或时间、余弦）的分布。切换计数后旧计数随之释放。
+class TallyPanel {
+public:
+    void Draw();
+
+private:
+    void Open();
+    void Select(std::size_t index);
+    void CollectResult();
+    void BuildPlot();
+
+    mcnp::parser::MctalFile mctal_;
+    std::string path_;
+    bool opened_{false};
+    double openMilliseconds_{0.0};
+    std::size_t selected_{mcnp::parser::MctalFile::npos};
+    std::shared_future<std::shared_ptr<const mcnp::parser::MctalTally>> pending_;
+    std::shared_ptr<const mcnp::parser::MctalTally> tally_;
+    int entity_{0};
+    int axis_{static_cast<int>(mcnp::parser::TallyAxis::Energy)};
+    std::vector<float> plot_;
+    std::vector<float> plotErrors_;
+};
+
+} // namespace mcnp::ui
+
+#endif // TALLY_PANEL_H
@@ -0,0 +1,43 @@
+// core 模块性能基准：不注册到 ctest，用 cmake --build <dir> --target bench 运行。
+// 每项基准打印实测耗时，并以 EXPECT 校验对应需求的目标，未达标时可执行文件返回失败。
+#include <gtest/gtest.h>
+#include "isosurface.h"
+#include "voxel_store.h"
+
+#include <chrono>
+#include <cstdio>
+
+// 256³ 场上拖动等值滑块的重建耗时：首次提取含解码，之后每次改变等值目标为 100 ms 以内
+TEST(IsosurfaceBench, Regenerates256CubedField) {
+    using namespace mcnp::core;
+    const std::size_t n = 256;
+    VoxelBrickStore store({n, n, n}, 1, VoxelStoreOptions{});
+    const glm::vec3 sources[3] = {{80.0f, 90.0f, 100.0f}, {170.0f, 150.0f, 120.0f}, {120.0f, 200.0f, 180.0f}};
+    for (std::size_t x = 0; x < n; ++x) {
+        for (std::size_t y = 0; y < n; ++y) {
+            for (std::size_t z = 0; z < n; ++z) {
+                float value = 0.0f;
+                for (const glm::vec3& source : sources) {
+                    const glm::vec3 d = glm::vec3(x, y, z) - source;
+                    value += 1.0f / (1.0f + glm::dot(d, d) * 1e-3f);
+                }
+                store.set(x, y, z, 0, value, 0.0f);
+            }
+        }
+    }
+    IsosurfaceExtractor extractor(store, 0);
+    bool first = true;
+    for (const float iso : {0.3f, 0.3f, 0.2f, 0.4f, 0.6f}) {
+        const auto start = std::chrono::steady_clock::now();
+        const Mesh mesh = extractor.extract(iso);
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::printf("iso %.2f: %zu triangles, %zu active / %zu skipped bricks, %zu decoded, %.1f ms\n", iso,
+                    extractor.stats().triangles, extractor.stats().activeBricks, extractor.stats().skippedBricks,
+                    extractor.stats().decodedBricks, ms);
+        EXPECT_FALSE(mesh.indices.empty());
+        if (!first) {
+            EXPECT_LT(ms, 100.0);
+        }
+        first = false;
+    }
+}
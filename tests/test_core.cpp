@@ -1,6 +1,24 @@
 #include <gtest/gtest.h>
 #include "vertex_mesh.h"
 #include "geometry_factory.h"
+#include "geometry_model.h"
+#include "thread_pool.h"
+#include "point_kernel.h"
+#include "source_sampler.h"
+#include "universe_resolver.h"
+#include "lattice_instancer.h"
+#include "surface_table.h"
+#include "csg_dag.h"
+#include "cell_bounds.h"
+#include "voxel_store.h"
+#include "brick_atlas.h"
+#include "isosurface.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <map>
+#include <random>
 
 // 测试Mesh类的基本功能
 TEST(MeshTest, ConstructorTest) {
@@ -31,3 +49,824 @@ TEST(GeometryFactoryTest, CreateBox) {
     
     EXPECT_EQ(mesh.name, "Box");
 }
+
+// 测试变换矩阵分解回平移、旋转与缩放
+TEST(GeometryModelTest, TransformRoundTripsThroughMatrix) {
+    mcnp::core::Transform transform;
+    transform.translation = glm::vec3(1.0f, -2.0f, 3.0f);
+    transform.rotation = glm::vec3(0.3f, -0.7f, 1.2f);
+    transform.scale = glm::vec3(2.0f, 0.5f, 1.5f);
+    const glm::mat4 matrix = transform.toMatrix();
+    const mcnp::core::Transform decomposed = mcnp::core::Transform::fromMatrix(matrix);
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_NEAR(decomposed.translation[i], transform.translation[i], 1e-5f);
+        EXPECT_NEAR(decomposed.rotation[i], transform.rotation[i], 1e-5f);
+        EXPECT_NEAR(decomposed.scale[i], transform.scale[i], 1e-5f);
+    }
+    // 万向锁时转角不唯一，只比较矩阵
+    transform.rotation.y = glm::half_pi<float>();
+    const glm::mat4 locked = transform.toMatrix();
+    const glm::mat4 rebuilt = mcnp::core::Transform::fromMatrix(locked).toMatrix();
+    for (int c = 0; c < 4; ++c) {
+        for (int r = 0; r < 4; ++r) {
+            EXPECT_NEAR(rebuilt[c][r], locked[c][r], 1e-4f);
+        }
+    }
+}
+
+// 测试线程池分块并行
+TEST(ThreadPoolTest, ParallelForCoversRange) {
+    mcnp::core::ThreadPool pool(4);
+    std::vector<int> hits(1000, 0);
+    pool.parallelFor(hits.size(), 7, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            hits[i] += 1;
+        }
+    });
+    EXPECT_EQ(std::count(hits.begin(), hits.end(), 1), 1000);
+}
+
+// 测试点核屏蔽计算：无屏蔽时为 1/(4πr²)，穿过平板时按 exp(-μx) 衰减
+TEST(PointKernelTest, SlabAttenuation) {
+    using namespace mcnp::core;
+    PointKernelEngine engine;
+    ShieldMaterial iron;
+    iron.info = {"Iron", 7.874, 0.0599};
+    const int ironIndex = engine.addMaterial(iron);
+
+    PointKernelSource source;
+    source.info.strength = 1.0;
+    engine.setSource(source);
+
+    DetectorInfo detector;
+    detector.position = glm::vec3(10.0f, 0.0f, 0.0f);
+    engine.setDetectors({detector});
+
+    const double pi = 3.14159265358979323846;
+    auto bare = engine.evaluate();
+    ASSERT_EQ(bare.size(), 1u);
+    EXPECT_NEAR(bare[0].flux, 1.0 / (4.0 * pi * 100.0), 1e-9);
+
+    ShieldBody slab;
+    slab.primitive = PrimitiveType::Box;
+    slab.halfExtents = glm::vec3(1.0f, 5.0f, 5.0f);
+    slab.localToWorld = glm::translate(glm::mat4(1.0f), glm::vec3(5.0f, 0.0f, 0.0f));
+    slab.material = ironIndex;
+    engine.setBodies({slab});
+
+    auto shielded = engine.evaluate();
+    const double mu = iron.linearAttenuation();
+    EXPECT_NEAR(shielded[0].uncollidedFlux, bare[0].flux * std::exp(-2.0 * mu), 1e-9);
+}
+
+// 测试 SDEF 抽样：同一 seed 结果与线程划分无关，球源粒子落在 RAD 范围内
+TEST(SourceSamplerTest, ReproducibleSphereSource) {
+    using namespace mcnp::core;
+    const auto parsed = parseSourceCards(
+        "sdef pos=1 2 3 rad=d1 erg=d2\n"
+        "si1 0 5\n"
+        "si2 h 0 1 10\n"
+        "sp2 0 1 3\n");
+    ASSERT_TRUE(parsed.errors.empty());
+
+    SourceSampler sampler(parsed.definition);
+    ThreadPool single(1);
+    ThreadPool many(4);
+    const auto a = sampler.sample(50000, 42, 0, single);
+    const auto b = sampler.sample(50000, 42, 0, many);
+    ASSERT_EQ(a.size(), 50000u);
+    EXPECT_EQ(a.x, b.x);
+    EXPECT_EQ(a.energy, b.energy);
+
+    // 按粒子编号续抽的结果与整体抽样一致
+    const auto tail = sampler.sample(10, 42, 49990, many);
+    EXPECT_EQ(tail.z[0], a.z[49990]);
+
+    std::size_t highBin = 0;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        const float dx = a.x[i] - 1.0f, dy = a.y[i] - 2.0f, dz = a.z[i] - 3.0f;
+        EXPECT_LE(std::sqrt(dx * dx + dy * dy + dz * dz), 5.0f + 1e-4f);
+        EXPECT_GE(a.energy[i], 0.0f);
+        EXPECT_LE(a.energy[i], 10.0f);
+        highBin += a.energy[i] > 1.0f ? 1 : 0;
+    }
+    EXPECT_NEAR(static_cast<double>(highBin) / a.size(), 0.75, 0.01);
+
+    const auto histogram = energyHistogram(a.energy, 10, 0.0f, 10.0f);
+    EXPECT_NEAR(histogram[0] / a.size(), 0.25, 0.01);
+}
+
+// 测试 SDEF 解析错误：引用未定义分布
+TEST(SourceSamplerTest, ReportsUndefinedDistribution) {
+    const auto parsed = mcnp::core::parseSourceCards("sdef erg=d7\n");
+    EXPECT_FALSE(parsed.errors.empty());
+}
+
+namespace {
+
+// 3x3 矩形栅格的燃料棒模型：宇宙 1 为棒元，宇宙 2 为栅格，根宇宙平移到 x=10
+mcnp::core::UniverseResolver buildPinLattice() {
+    using namespace mcnp::core;
+    UniverseResolver resolver;
+
+    Universe pin{1, {}};
+    UniverseCell fuel;
+    fuel.id = 1;
+    fuel.material = 1;
+    fuel.contains = [](const glm::dvec3& p) { return p.x * p.x + p.y * p.y < 0.16; };
+    fuel.bounds = Aabb{glm::dvec3(-0.4, -0.4, -1e3), glm::dvec3(0.4, 0.4, 1e3)};
+    UniverseCell water;
+    water.id = 2;
+    water.material = 2;
+    pin.cells = {fuel, water};
+
+    Universe lattice{2, {}};
+    UniverseCell latticeCell;
+    latticeCell.id = 10;
+    latticeCell.lattice = LatticeSpec{LatticeType::Rectangular, glm::dvec3(1.0, 1.0, 0.0),
+                                      glm::ivec3(-1, -1, 0), glm::ivec3(1, 1, 0), std::vector<int>(9, 1)};
+    lattice.cells = {latticeCell};
+
+    Universe root{0, {}};
+    UniverseCell assembly;
+    assembly.id = 100;
+    assembly.fill = 2;
+    assembly.fillTransform = glm::translate(glm::dmat4(1.0), glm::dvec3(10.0, 0.0, 0.0));
+    assembly.bounds = Aabb{glm::dvec3(8.5, -1.5, -1e3), glm::dvec3(11.5, 1.5, 1e3)};
+    UniverseCell outside;
+    outside.id = 101;
+    root.cells = {assembly, outside};
+
+    resolver.addUniverse(root);
+    resolver.addUniverse(lattice);
+    resolver.addUniverse(pin);
+    return resolver;
+}
+
+} // namespace
+
+// 测试嵌套宇宙定位：栅格下标按坐标直接求出，合成变换指向元素中心
+TEST(UniverseResolverTest, LocatesThroughLattice) {
+    auto resolver = buildPinLattice();
+    std::vector<std::string> errors;
+    ASSERT_TRUE(resolver.build(&errors));
+    EXPECT_EQ(resolver.maxDepth(), 3);
+
+    const auto fuel = resolver.locate(glm::dvec3(11.05, 0.98, 0.0));
+    ASSERT_TRUE(fuel.found);
+    EXPECT_EQ(fuel.cell, 1);
+    ASSERT_EQ(fuel.path.size(), 3u);
+    EXPECT_TRUE(fuel.path[1].inLattice);
+    EXPECT_EQ(fuel.path[1].latticeIndex, glm::ivec3(1, 1, 0));
+    const glm::dvec3 center(fuel.localToWorld * glm::dvec4(0.0, 0.0, 0.0, 1.0));
+    EXPECT_NEAR(center.x, 11.0, 1e-12);
+    EXPECT_NEAR(center.y, 1.0, 1e-12);
+
+    EXPECT_EQ(resolver.classify(glm::dvec3(10.45, 0.0, 0.0)).material, 2);
+    EXPECT_EQ(resolver.classify(glm::dvec3(20.0, 0.0, 0.0)).cell, 101);
+
+    const auto hits = resolver.classify({glm::dvec3(9.0, -1.0, 0.0), glm::dvec3(9.5, -1.0, 0.0)});
+    EXPECT_EQ(hits[0].material, 1);
+    EXPECT_EQ(hits[1].material, 2);
+}
+
+// 测试六角栅格下标：最近元素中心，边界位于半个对边距处
+TEST(UniverseResolverTest, HexLatticeIndex) {
+    using namespace mcnp::core;
+    LatticeSpec hex;
+    hex.type = LatticeType::Hexagonal;
+    hex.pitch = glm::dvec3(2.0, 0.0, 0.0);
+    EXPECT_EQ(hex.indexOf(glm::dvec3(0.99, 0.0, 0.0)), glm::ivec3(0, 0, 0));
+    EXPECT_EQ(hex.indexOf(glm::dvec3(1.01, 0.0, 0.0)), glm::ivec3(1, 0, 0));
+    const glm::ivec3 index(2, -3, 0);
+    EXPECT_EQ(hex.indexOf(hex.centerOf(index) + glm::dvec3(0.3, -0.4, 0.0)), index);
+    EXPECT_NEAR(hex.exitDistance(glm::dvec3(0.0), glm::dvec3(1.0, 0.0, 0.0)), 1.0, 1e-12);
+}
+
+// 测试射线穿行：栅格边界解析步进，单元边界二分定位
+TEST(UniverseResolverTest, TraceSegments) {
+    auto resolver = buildPinLattice();
+    ASSERT_TRUE(resolver.build());
+    const auto segments = resolver.trace(glm::dvec3(8.0, 0.0, 0.0), glm::dvec3(1.0, 0.0, 0.0), 4.0, 0.05);
+    ASSERT_EQ(segments.size(), 9u);
+    EXPECT_EQ(segments[0].cell, 101);
+    EXPECT_NEAR(segments[0].t1, 0.5, 1e-6);
+    EXPECT_EQ(segments[2].material, 1);
+    EXPECT_NEAR(segments[2].t0, 0.6, 1e-6);
+    EXPECT_NEAR(segments[2].t1, 1.4, 1e-6);
+    EXPECT_NEAR(segments[3].t1, 1.6, 1e-6);  // 跨栅格元素的慢化剂合并为一段
+    EXPECT_EQ(segments.back().cell, 101);
+}
+
+// 测试栅格实例生成：两层栅格的整堆芯按实例输出，视锥外的块整体剔除
+TEST(LatticeInstancerTest, ExpandsFullCoreAndCulls) {
+    using namespace mcnp::core;
+    UniverseResolver resolver;
+    UniverseCell pinCell;
+    pinCell.id = 1;
+    resolver.addUniverse(Universe{1, {pinCell}});
+
+    UniverseCell assemblyCell;
+    assemblyCell.id = 2;
+    assemblyCell.lattice = LatticeSpec{LatticeType::Rectangular, glm::dvec3(1.26, 1.26, 0.0),
+                                       glm::ivec3(-8, -8, 0), glm::ivec3(8, 8, 0), std::vector<int>(17 * 17, 1)};
+    resolver.addUniverse(Universe{2, {assemblyCell}});
+
+    UniverseCell coreCell;
+    coreCell.id = 3;
+    coreCell.lattice = LatticeSpec{LatticeType::Rectangular, glm::dvec3(21.42, 21.42, 0.0),
+                                   glm::ivec3(-7, -7, 0), glm::ivec3(7, 7, 0), std::vector<int>(15 * 15, 2)};
+    resolver.addUniverse(Universe{0, {coreCell}});
+    ASSERT_TRUE(resolver.build());
+
+    LatticeInstancer instancer(resolver);
+    instancer.setDrawable([](int universe) { return universe == 1; });
+    std::vector<InstanceBatch> batches;
+    const auto all = instancer.collect(0, nullptr, batches);
+    ASSERT_EQ(batches.size(), 1u);
+    EXPECT_EQ(all.instances, 15u * 15u * 17u * 17u);
+    EXPECT_EQ(batches[0].transforms.size(), all.instances);
+
+    // 相机位于堆芯一角上方向下看，只覆盖少量组件
+    const glm::dmat4 view = glm::lookAt(glm::dvec3(150.0, 150.0, 30.0), glm::dvec3(150.0, 150.0, 0.0), glm::dvec3(0.0, 1.0, 0.0));
+    const glm::dmat4 projection = glm::perspective(glm::radians(30.0), 1.0, 0.1, 100.0);
+    const Frustum frustum = Frustum::fromMatrix(projection * view);
+    const auto culled = instancer.collect(0, &frustum, batches);
+    EXPECT_GT(culled.culledBlocks, 0u);
+    EXPECT_GT(culled.instances, 0u);
+    EXPECT_LT(culled.instances, all.instances / 10);
+}
+
+// 测试 TR 变换合成进二次曲面系数：与逐点变换后求局部曲面一致
+TEST(SurfaceTableTest, TransformsAreComposedIntoQuadrics) {
+    using namespace mcnp::core;
+    // *TR：原点 (1,2,3)，x' 轴不变，y'、z' 绕 x 轴转 90°
+    const std::vector<double> card{1.0, 2.0, 3.0, 0.0, 90.0, 90.0, 90.0, 90.0, 0.0, 90.0, 180.0, 90.0};
+    std::string error;
+    const auto transform = SurfaceTransform::fromCard(card, true, &error);
+    ASSERT_TRUE(transform) << error;
+    EXPECT_FALSE(SurfaceTransform::fromCard(std::vector<double>{1.0, 2.0}, false));
+
+    SurfaceTable table;
+    const std::vector<double> cz{2.0};
+    const std::vector<double> kx{1.0, 0.25, 1.0};
+    const std::vector<double> gq{1.0, 2.0, 0.5, 0.3, -0.2, 0.1, 1.0, -1.0, 0.5, -4.0};
+    ASSERT_TRUE(table.add(1, "CZ", cz, &*transform));
+    ASSERT_TRUE(table.add(2, "kx", kx, &*transform));
+    ASSERT_TRUE(table.add(3, "GQ", gq, &*transform));
+    EXPECT_FALSE(table.add(4, "px", std::vector<double>{1.0, 2.0}, nullptr, BoundaryKind::None, &error));
+    EXPECT_FALSE(error.empty());
+
+    SurfaceTable local;
+    ASSERT_TRUE(local.add(1, "cz", cz));
+    ASSERT_TRUE(local.add(2, "KX", kx));
+    ASSERT_TRUE(local.add(3, "gq", gq));
+
+    // 主坐标点 -> 辅助坐标 x' = Rᵀ(x - o)
+    for (const glm::dvec3& world : {glm::dvec3(0.5, -1.0, 2.0), glm::dvec3(3.0, 4.0, -2.0), glm::dvec3(-2.0, 0.0, 6.0)}) {
+        const glm::dvec3 aux = glm::transpose(transform->rotation) * (world - transform->origin);
+        for (std::size_t row = 0; row < 3; ++row) {
+            EXPECT_NEAR(table.evaluate(row, world), local.evaluate(row, aux), 1e-9);
+        }
+    }
+    // z' 轴映射到主坐标 -y 方向：圆柱轴沿 y，经过 (1, *, 3)
+    EXPECT_EQ(table.type(0), SurfaceType::Cylinder);
+    EXPECT_EQ(table.sense(0, glm::dvec3(1.0, 100.0, 3.0)), -1);
+    EXPECT_EQ(table.sense(0, glm::dvec3(1.0, 0.0, 5.5)), 1);
+    // 单叶锥：x' < 1 的一侧整体在锥外
+    EXPECT_EQ(local.sense(1, glm::dvec3(3.0, 0.1, 0.0)), -1);
+    EXPECT_EQ(local.sense(1, glm::dvec3(-1.0, 0.1, 0.0)), 1);
+}
+
+// 测试偏轴圆柱 C/X、C/Y、C/Z：两个轴外坐标加半径，共三项
+TEST(SurfaceTableTest, OffAxisCylindersTakeThreeEntries) {
+    using namespace mcnp::core;
+    SurfaceTable table;
+    std::string error;
+    ASSERT_TRUE(table.add(1, "c/x", std::vector<double>{2.0, -1.0, 0.5}, nullptr, BoundaryKind::None, &error)) << error;
+    ASSERT_TRUE(table.add(2, "C/Y", std::vector<double>{1.0, 3.0, 2.0}));
+    ASSERT_TRUE(table.add(3, "c/z", std::vector<double>{-1.0, 4.0, 1.0}));
+    EXPECT_FALSE(table.add(4, "c/x", std::vector<double>{2.0, 0.5}, nullptr, BoundaryKind::None, &error));
+
+    EXPECT_EQ(table.type(0), SurfaceType::Cylinder);
+    // C/X：轴平行于 x，经过 (*, 2, -1)
+    EXPECT_EQ(table.sense(0, glm::dvec3(100.0, 2.0, -1.0)), -1);
+    EXPECT_EQ(table.sense(0, glm::dvec3(0.0, 2.0, -0.4)), 1);
+    EXPECT_EQ(table.sense(0, glm::dvec3(-5.0, 2.4, -1.0)), -1);
+    EXPECT_NEAR(table.evaluate(0, glm::dvec3(0.0, 3.0, -1.0)), 0.75, 1e-12);
+    // C/Y：轴经过 (1, *, 3)
+    EXPECT_EQ(table.sense(1, glm::dvec3(1.0, -7.0, 3.0)), -1);
+    EXPECT_EQ(table.sense(1, glm::dvec3(3.5, 0.0, 3.0)), 1);
+    // C/Z：轴经过 (-1, 4, *)
+    EXPECT_EQ(table.sense(2, glm::dvec3(-1.0, 4.0, 9.0)), -1);
+    EXPECT_EQ(table.sense(2, glm::dvec3(-1.0, 5.5, 0.0)), 1);
+}
+
+// 测试宏体展开为面并按面判定内外
+TEST(SurfaceTableTest, MacroBodiesExpandToFacets) {
+    using namespace mcnp::core;
+    SurfaceTable table;
+    ASSERT_TRUE(table.add(10, "RPP", std::vector<double>{-1.0, 1.0, -2.0, 2.0, 0.0, 5.0}));
+    ASSERT_TRUE(table.add(11, "rcc", std::vector<double>{0.0, 0.0, 0.0, 0.0, 0.0, 10.0, 1.0}));
+    ASSERT_TRUE(table.add(12, "trc", std::vector<double>{0.0, 0.0, 0.0, 0.0, 0.0, 4.0, 2.0, 1.0}));
+    ASSERT_TRUE(table.add(13, "rhp", std::vector<double>{0.0, 0.0, 0.0, 0.0, 0.0, 1.0, 1.0, 0.0, 0.0}));
+    ASSERT_TRUE(table.add(14, "tz", std::vector<double>{0.0, 0.0, 0.0, 5.0, 1.0, 1.0}));
+    EXPECT_EQ(table.size(), 6u + 3u + 3u + 8u + 1u);
+
+    const auto* box = table.findMacroBody(10);
+    ASSERT_NE(box, nullptr);
+    EXPECT_EQ(box->facetCount, 6u);
+    EXPECT_TRUE(table.insideMacroBody(*box, glm::dvec3(0.5, -1.5, 4.0)));
+    EXPECT_FALSE(table.insideMacroBody(*box, glm::dvec3(0.5, -2.5, 4.0)));
+    // 面 2 为 -x 面
+    const auto minusX = table.find(10, 2);
+    ASSERT_TRUE(minusX);
+    EXPECT_EQ(table.sense(*minusX, glm::dvec3(-0.5, 0.0, 0.0)), -1);
+    EXPECT_EQ(table.sense(*minusX, glm::dvec3(-1.5, 0.0, 0.0)), 1);
+
+    EXPECT_TRUE(table.insideMacroBody(*table.findMacroBody(11), glm::dvec3(0.5, 0.5, 9.0)));
+    EXPECT_FALSE(table.insideMacroBody(*table.findMacroBody(11), glm::dvec3(0.5, 0.5, 11.0)));
+    // 截锥在 z=2 处半径 1.5
+    EXPECT_TRUE(table.insideMacroBody(*table.findMacroBody(12), glm::dvec3(1.4, 0.0, 2.0)));
+    EXPECT_FALSE(table.insideMacroBody(*table.findMacroBody(12), glm::dvec3(1.6, 0.0, 2.0)));
+    // 六棱柱对边距 2，顶点方向外接圆半径 2/√3
+    EXPECT_TRUE(table.insideMacroBody(*table.findMacroBody(13), glm::dvec3(0.0, 1.1, 0.5)));
+    EXPECT_FALSE(table.insideMacroBody(*table.findMacroBody(13), glm::dvec3(1.1, 0.0, 0.5)));
+
+    const auto torus = table.find(14);
+    ASSERT_TRUE(torus);
+    EXPECT_EQ(table.sense(*torus, glm::dvec3(5.0, 0.0, 0.5)), -1);
+    EXPECT_EQ(table.sense(*torus, glm::dvec3(0.0, 0.0, 0.0)), 1);
+
+    // 批量求值与逐点一致
+    const std::vector<glm::dvec3> points{{0.0, 0.0, 1.0}, {2.0, 0.0, 1.0}, {0.0, 3.0, -1.0}};
+    std::vector<double> out(points.size());
+    table.evaluate(*table.find(11, 1), points, out);
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        EXPECT_DOUBLE_EQ(out[i], table.evaluate(*table.find(11, 1), points[i]));
+    }
+}
+
+// 测试 CSG DAG 的哈希共享与 De Morgan 化简
+TEST(CsgDagTest, HashConsesAndPushesComplements) {
+    using namespace mcnp::core;
+    CsgDag dag;
+    const auto a = dag.halfspace(1, true);
+    const auto b = dag.halfspace(2, false);
+    const auto c = dag.halfspace(3, true);
+    EXPECT_EQ(dag.halfspace(1, true), a);
+
+    // 交换律与嵌套展平后结构相同
+    const std::vector<CsgDag::NodeId> abc{a, b, c};
+    const std::vector<CsgDag::NodeId> cb{c, b};
+    const auto first = dag.intersection(abc);
+    const std::vector<CsgDag::NodeId> nested{dag.intersection(cb), a};
+    EXPECT_EQ(dag.intersection(nested), first);
+
+    // ~(a ∩ b ∩ c) = ~a ∪ ~b ∪ ~c，且 ~~x = x
+    const auto negated = dag.complement(first);
+    EXPECT_EQ(dag.node(negated).op, CsgOp::Union);
+    for (const auto child : dag.children(negated)) {
+        EXPECT_EQ(dag.node(child).op, CsgOp::Halfspace);
+    }
+    EXPECT_EQ(dag.complement(negated), first);
+
+    // s ∩ -s 为空，并为全空间
+    const std::vector<CsgDag::NodeId> contradiction{a, dag.complement(a)};
+    EXPECT_EQ(dag.intersection(contradiction), dag.empty());
+    EXPECT_EQ(dag.unite(contradiction), dag.universe());
+
+    SurfaceTable surfaces;
+    ASSERT_TRUE(surfaces.add(1, "so", std::vector<double>{5.0}));
+    ASSERT_TRUE(surfaces.add(2, "pz", std::vector<double>{0.0}));
+    ASSERT_TRUE(surfaces.add(3, "cz", std::vector<double>{2.0}));
+    EXPECT_TRUE(dag.contains(first, glm::dvec3(0.0, 0.0, 1.0), surfaces));
+    EXPECT_FALSE(dag.contains(first, glm::dvec3(0.0, 0.0, -1.0), surfaces));
+    EXPECT_TRUE(dag.contains(negated, glm::dvec3(0.0, 0.0, -1.0), surfaces));
+
+    // 导出的 GeometryNode 共享同一子表达式
+    const std::vector<CsgDag::NodeId> twice{dag.unite(std::vector<CsgDag::NodeId>{first, c}),
+                                            dag.unite(std::vector<CsgDag::NodeId>{first, a})};
+    const auto geometry = dag.toGeometry(dag.intersection(twice), &surfaces);
+    ASSERT_EQ(geometry->children.size(), 2u);
+    EXPECT_EQ(geometry->booleanOp, mcnp::core::BooleanOperation::Intersection);
+    auto shared = [](const std::shared_ptr<GeometryNode>& node) {
+        for (const auto& child : node->children) {
+            if (child->booleanOp) {
+                return child;
+            }
+        }
+        return std::shared_ptr<GeometryNode>();
+    };
+    ASSERT_NE(shared(geometry->children[0]), nullptr);
+    EXPECT_EQ(shared(geometry->children[0]), shared(geometry->children[1]));
+}
+
+// 测试半空间的精确范围与区间求值
+TEST(SurfaceTableTest, HalfspaceBoundsAndRanges) {
+    using namespace mcnp::core;
+    SurfaceTable table;
+    ASSERT_TRUE(table.add(1, "s", std::vector<double>{1.0, 2.0, 3.0, 5.0}));
+    ASSERT_TRUE(table.add(2, "px", std::vector<double>{3.0}));
+    ASSERT_TRUE(table.add(3, "c/z", std::vector<double>{1.0, 2.0, 3.0}));
+    ASSERT_TRUE(table.add(4, "tz", std::vector<double>{0.0, 0.0, 0.0, 5.0, 1.0, 1.0}));
+    ASSERT_TRUE(table.add(5, "p", std::vector<double>{1.0, 1.0, 0.0, 1.0}));
+    // 椭球 x² + 4y² + 9z² = 1 绕 x 轴转 90° 后平移到 (1, 2, 3)
+    const auto transform = SurfaceTransform::fromCard(
+        std::vector<double>{1.0, 2.0, 3.0, 0.0, 90.0, 90.0, 90.0, 90.0, 0.0, 90.0, 180.0, 90.0}, true);
+    ASSERT_TRUE(transform);
+    ASSERT_TRUE(table.add(6, "sq", std::vector<double>{1.0, 4.0, 9.0, 0.0, 0.0, 0.0, -1.0, 0.0, 0.0, 0.0},
+                          &*transform));
+
+    auto expect_box = [](const Aabb& box, const glm::dvec3& min, const glm::dvec3& max) {
+        for (int i = 0; i < 3; ++i) {
+            EXPECT_NEAR(box.min[i], min[i], 1e-9) << i;
+            EXPECT_NEAR(box.max[i], max[i], 1e-9) << i;
+        }
+    };
+    expect_box(table.bounds(*table.find(1), true), {-4.0, -3.0, -2.0}, {6.0, 7.0, 8.0});
+    EXPECT_FALSE(table.bounds(*table.find(1), false).isFinite());
+    const Aabb below = table.bounds(*table.find(2), true);
+    EXPECT_DOUBLE_EQ(below.max.x, 3.0);
+    EXPECT_LT(below.min.x, -1e300);
+    EXPECT_DOUBLE_EQ(table.bounds(*table.find(2), false).min.x, 3.0);
+    const Aabb cylinder = table.bounds(*table.find(3), true);
+    EXPECT_NEAR(cylinder.min.x, -2.0, 1e-9);
+    EXPECT_NEAR(cylinder.max.y, 5.0, 1e-9);
+    EXPECT_GT(cylinder.max.z, 1e300);
+    expect_box(table.bounds(*table.find(4), true), {-6.0, -6.0, -1.0}, {6.0, 6.0, 1.0});
+    EXPECT_FALSE(table.bounds(*table.find(5), true).isFinite());
+    expect_box(table.bounds(*table.find(6), true), {0.0, 2.0 - 1.0 / 3.0, 2.5}, {2.0, 2.0 + 1.0 / 3.0, 3.5});
+
+    // 区间外包真实取值
+    Aabb box;
+    box.min = glm::dvec3(0.0, 1.0, 2.0);
+    box.max = glm::dvec3(2.0, 3.0, 4.0);
+    for (std::size_t row = 0; row < table.size(); ++row) {
+        const auto range = table.range(row, box);
+        for (int i = 0; i < 27; ++i) {
+            const glm::dvec3 p = box.min + box.extent() * glm::dvec3(i % 3, (i / 3) % 3, i / 9) * 0.5;
+            EXPECT_LE(range.low, table.evaluate(row, p) + 1e-12) << row;
+            EXPECT_GE(range.high, table.evaluate(row, p) - 1e-12) << row;
+        }
+    }
+    EXPECT_GT(table.range(*table.find(1), Aabb{glm::dvec3(20.0), glm::dvec3(21.0)}).low, 0.0);
+}
+
+// 测试单元包围盒：交收缩、并扩张与切片收缩
+TEST(CellBoundsTest, PropagatesAndContractsIntervals) {
+    using namespace mcnp::core;
+    SurfaceTable surfaces;
+    ASSERT_TRUE(surfaces.add(1, "cz", std::vector<double>{2.0}));
+    ASSERT_TRUE(surfaces.add(2, "pz", std::vector<double>{-1.0}));
+    ASSERT_TRUE(surfaces.add(3, "pz", std::vector<double>{4.0}));
+    ASSERT_TRUE(surfaces.add(4, "so", std::vector<double>{1.0}));
+    ASSERT_TRUE(surfaces.add(5, "s", std::vector<double>{10.0, 0.0, 0.0, 1.0}));
+    ASSERT_TRUE(surfaces.add(6, "p", std::vector<double>{1.0, 1.0, 0.0, 1.0}));
+    ASSERT_TRUE(surfaces.add(7, "px", std::vector<double>{0.0}));
+    ASSERT_TRUE(surfaces.add(8, "py", std::vector<double>{0.0}));
+    ASSERT_TRUE(surfaces.add(9, "rpp", std::vector<double>{-1.0, 1.0, -1.0, 1.0, 0.0, 0.5}));
+
+    CsgDag dag;
+    using Ids = std::vector<CsgDag::NodeId>;
+    const auto can = dag.intersection(Ids{dag.halfspace(1, true), dag.halfspace(2, false), dag.halfspace(3, true)});
+    const auto pair = dag.unite(Ids{dag.halfspace(4, true), dag.halfspace(5, true)});
+    const auto disjoint = dag.intersection(Ids{dag.halfspace(4, true), dag.halfspace(5, true)});
+    const auto wedge = dag.intersection(Ids{dag.halfspace(6, true), dag.halfspace(7, false), dag.halfspace(8, false),
+                                            dag.halfspace(2, false), dag.halfspace(3, true)});
+    const auto undefined = dag.halfspace(42, true);
+    const auto outside = dag.halfspace(4, false);
+    const auto slab = dag.intersection(Ids{dag.halfspace(9, true), dag.halfspace(4, false)});
+
+    CellBounds unbounded(dag, surfaces);
+    const Aabb canBox = unbounded.bounds(can);
+    EXPECT_NEAR(canBox.min.x, -2.0, 1e-9);
+    EXPECT_NEAR(canBox.max.y, 2.0, 1e-9);
+    EXPECT_NEAR(canBox.min.z, -1.0, 1e-9);
+    EXPECT_NEAR(canBox.max.z, 4.0, 1e-9);
+    const Aabb pairBox = unbounded.bounds(pair);
+    EXPECT_NEAR(pairBox.min.x, -1.0, 1e-9);
+    EXPECT_NEAR(pairBox.max.x, 11.0, 1e-9);
+    EXPECT_NEAR(pairBox.max.y, 1.0, 1e-9);
+    EXPECT_TRUE(unbounded.bounds(disjoint).empty());
+    EXPECT_TRUE(unbounded.bounds(undefined).empty());
+    // 斜平面楔形在传播后 x、y 仍无界，没有世界盒时无法收缩
+    EXPECT_FALSE(unbounded.bounds(wedge).isFinite());
+    EXPECT_EQ(unbounded.classify(can, Aabb{glm::dvec3(-0.5), glm::dvec3(0.5)}), CellBounds::Coverage::Inside);
+    EXPECT_EQ(unbounded.classify(can, Aabb{glm::dvec3(3.0), glm::dvec3(4.0)}), CellBounds::Coverage::Outside);
+
+    CellBoundsOptions options;
+    options.world = Aabb{glm::dvec3(-100.0), glm::dvec3(100.0)};
+    CellBounds world(dag, surfaces, options);
+    const Aabb wedgeBox = world.bounds(wedge);
+    ASSERT_TRUE(wedgeBox.isFinite());
+    EXPECT_LE(wedgeBox.min.x, 0.0);
+    EXPECT_GE(wedgeBox.max.x, 1.0);
+    EXPECT_LT(wedgeBox.max.x, 1.5);
+    EXPECT_LT(wedgeBox.max.y, 1.5);
+    EXPECT_NEAR(wedgeBox.max.z, 4.0, 1e-9);
+    const Aabb outsideBox = world.bounds(outside);
+    EXPECT_DOUBLE_EQ(outsideBox.min.x, -100.0);
+    EXPECT_DOUBLE_EQ(outsideBox.max.z, 100.0);
+
+    // 盒减球：切片收缩保守，采样收紧不会丢掉区域
+    const Aabb slabBox = world.bounds(slab);
+    EXPECT_NEAR(slabBox.min.x, -1.0, 1e-9);
+    EXPECT_NEAR(slabBox.max.z, 0.5, 1e-9);
+    options.samples = 32;
+    CellBounds sampled(dag, surfaces, options);
+    const Aabb sampledBox = sampled.bounds(slab);
+    EXPECT_TRUE(sampledBox.contains(glm::dvec3(0.95, 0.95, 0.25)));
+    EXPECT_TRUE(sampledBox.contains(glm::dvec3(-0.95, -0.95, 0.25)));
+}
+
+// 测试分砖体素存储：小内存预算下换出/换入、误差量化、砖块摘要与阈值查询、半精度按块缩放
+TEST(VoxelStoreTest, PagesBricksThroughDiskCache) {
+    using namespace mcnp::core;
+    const std::array<std::size_t, 3> dims{40, 33, 20};
+    const auto field = [](std::size_t x, std::size_t y, std::size_t z, std::size_t c) {
+        return static_cast<float>(x * 1000 + y * 10 + z) * (c == 0 ? 1.0f : -0.5f);
+    };
+    VoxelStoreOptions options;
+    options.brickSize = 8;
+    options.errors = VoxelErrorEncoding::Quantized16;
+    options.memoryBudget = 3 * 8 * 8 * 8 * 6;
+    std::filesystem::path cache;
+    {
+        VoxelBrickStore store(dims, 2, options);
+        EXPECT_EQ(store.bricksPerAxis(), (std::array<std::size_t, 3>{5, 5, 3}));
+        EXPECT_EQ(store.brickCount(), 150u);
+        for (std::size_t c = 0; c < 2; ++c) {
+            for (std::size_t x = 0; x < dims[0]; ++x) {
+                for (std::size_t y = 0; y < dims[1]; ++y) {
+                    for (std::size_t z = 0; z < dims[2]; ++z) {
+                        store.set(x, y, z, c, field(x, y, z, c), static_cast<float>(z) / 40.0f);
+                    }
+                }
+            }
+        }
+        EXPECT_LE(store.residentBricks(), 3u);
+        EXPECT_GT(store.pageOuts(), 0u);
+        cache = store.options().cacheFile;
+        EXPECT_TRUE(std::filesystem::exists(cache));
+
+        // 按 z 最慢的顺序读回，每次都跨砖块
+        for (std::size_t z = 0; z < dims[2]; ++z) {
+            for (std::size_t y = 0; y < dims[1]; y += 4) {
+                for (std::size_t x = 0; x < dims[0]; x += 3) {
+                    ASSERT_EQ(store.value(x, y, z, 0), field(x, y, z, 0));
+                    ASSERT_EQ(store.value(x, y, z, 1), field(x, y, z, 1));
+                    ASSERT_NEAR(store.error(x, y, z, 1), z / 40.0f, 1.0f / 65535.0f);
+                }
+            }
+        }
+        EXPECT_GT(store.pageIns(), 0u);
+
+        const auto range = store.range(0);
+        EXPECT_FLOAT_EQ(range.first, 0.0f);
+        EXPECT_FLOAT_EQ(range.second, field(39, 32, 19, 0));
+        EXPECT_LE(store.range(1).first, field(39, 32, 19, 1));
+        std::size_t expected = 0;
+        for (std::size_t x = 0; x < dims[0]; ++x) {
+            for (std::size_t y = 0; y < dims[1]; ++y) {
+                for (std::size_t z = 0; z < dims[2]; ++z) {
+                    expected += field(x, y, z, 0) >= 25000.0f;
+                }
+            }
+        }
+        EXPECT_EQ(store.countAtLeast(0, 25000.0f), expected);
+
+        const auto slice = store.slice(1, 7, 0);
+        ASSERT_EQ(slice.size(), dims[0] * dims[2]);
+        EXPECT_EQ(slice[5 * dims[2] + 3], field(5, 7, 3, 0));
+    }
+    EXPECT_FALSE(std::filesystem::exists(cache));
+
+    // 半精度：同一砖块先写小值再写大值，重新缩放后小值仍保留约 1e-3 的相对精度
+    options.values = VoxelValueEncoding::Float16;
+    options.errors = VoxelErrorEncoding::Quantized8;
+    options.memoryBudget = 1;
+    VoxelBrickStore half(dims, 1, options);
+    half.set(0, 0, 0, 0, 3.0e-3f, 0.5f);
+    half.set(1, 0, 0, 0, 7.25e5f, 0.05f);
+    half.set(9, 0, 0, 0, -1.5e-12f, 1.0f);
+    half.set(0, 0, 1, 0, 1.0e3f, 0.0f);
+    EXPECT_EQ(half.residentBricks(), 1u);
+    EXPECT_NEAR(half.value(0, 0, 0, 0), 3.0e-3f, 3.0e-6f);
+    EXPECT_NEAR(half.value(1, 0, 0, 0), 7.25e5f, 7.25e2f);
+    EXPECT_NEAR(half.value(9, 0, 0, 0), -1.5e-12f, 1.5e-15f);
+    EXPECT_NEAR(half.value(0, 0, 1, 0), 1.0e3f, 1.0f);
+    EXPECT_EQ(half.value(5, 5, 5, 0), 0.0f);
+    EXPECT_NEAR(half.error(0, 0, 0, 0), 0.5f, 1.0f / 255.0f);
+    EXPECT_FLOAT_EQ(half.brickInfo(half.brickIndex(0, 0, 0, 0)).max, 7.25e5f);
+    EXPECT_FLOAT_EQ(half.brickInfo(half.brickIndex(1, 0, 0, 0)).min, -1.5e-12f);
+    EXPECT_EQ(half.brickBytes(), 8u * 8 * 8 * 3);
+    std::vector<float> decoded(8 * 8 * 8);
+    half.readBrick(half.brickIndex(0, 0, 0, 0), decoded.data());
+    EXPECT_EQ(decoded[64], half.value(1, 0, 0, 0));
+    EXPECT_EQ(decoded[1], half.value(0, 0, 1, 0));
+}
+
+// 测试体绘制砖块调度：按值区间跳过透明砖块、由近到远分配槽位、槽位不足时替换远处与不可见砖块
+TEST(BrickAtlasTest, SchedulesNearestVisibleBricks) {
+    using namespace mcnp::core;
+    VoxelStoreOptions options;
+    options.brickSize = 4;
+    VoxelBrickStore store({16, 4, 4}, 2, options);  // 沿 x 4 个砖块
+    for (std::size_t x = 0; x < 16; ++x) {
+        store.set(x, 1, 1, 0, static_cast<float>(x), 0.0f);
+        store.set(x, 1, 1, 1, 1.0f, 0.0f);
+    }
+    const auto above = [](float threshold) {
+        return [threshold](float, float high) { return high >= threshold; };
+    };
+
+    BrickAtlas atlas(2);
+    atlas.classify(store, 0, above(4.0f));  // 砖块 0 的上界为 3，整块跳过
+    EXPECT_EQ(atlas.stats().visibleBricks, 3u);
+    EXPECT_EQ(atlas.stats().skippedBricks, 1u);
+    EXPECT_TRUE(atlas.stats().full);
+    EXPECT_FALSE(atlas.visible(store.brickIndex(0, 0, 0, 0)));
+
+    // 视点在 +x 端：先上传砖块 3、2，每帧限 1 块
+    const glm::vec3 farEnd(20.0f, 2.0f, 2.0f);
+    auto uploads = atlas.schedule(farEnd, 1);
+    ASSERT_EQ(uploads.size(), 1u);
+    EXPECT_EQ(uploads[0].brick, store.brickIndex(3, 0, 0, 0));
+    uploads = atlas.schedule(farEnd, 8);
+    ASSERT_EQ(uploads.size(), 1u);
+    EXPECT_EQ(uploads[0].brick, store.brickIndex(2, 0, 0, 0));
+    EXPECT_EQ(atlas.stats().residentBricks, 2u);
+    EXPECT_TRUE(atlas.schedule(farEnd, 8).empty());
+
+    // 视点移到 -x 端：砖块 1 替换最远的砖块 3
+    uploads = atlas.schedule(glm::vec3(-4.0f, 2.0f, 2.0f), 8);
+    ASSERT_EQ(uploads.size(), 1u);
+    EXPECT_EQ(uploads[0].brick, store.brickIndex(1, 0, 0, 0));
+    EXPECT_EQ(uploads[0].evicted, store.brickIndex(3, 0, 0, 0));
+    EXPECT_EQ(atlas.slot(store.brickIndex(3, 0, 0, 0)), BrickAtlas::npos);
+    EXPECT_NE(atlas.slot(store.brickIndex(1, 0, 0, 0)), BrickAtlas::npos);
+
+    // 提高阈值后砖块 1 不再可见，其槽位先被复用
+    atlas.classify(store, 0, above(12.0f));
+    EXPECT_EQ(atlas.stats().visibleBricks, 1u);
+    uploads = atlas.schedule(glm::vec3(-4.0f, 2.0f, 2.0f), 8);
+    ASSERT_EQ(uploads.size(), 1u);
+    EXPECT_EQ(uploads[0].brick, store.brickIndex(3, 0, 0, 0));
+    EXPECT_EQ(uploads[0].evicted, store.brickIndex(1, 0, 0, 0));
+
+    // 换通道时图集清空
+    atlas.classify(store, 1, above(0.5f));
+    EXPECT_EQ(atlas.stats().visibleBricks, 4u);
+    EXPECT_EQ(atlas.slot(store.brickIndex(3, 0, 0, 0)), BrickAtlas::npos);
+    EXPECT_EQ(atlas.schedule(farEnd, 8).size(), 2u);
+    EXPECT_NE(atlas.slot(store.brickIndex(3, 0, 0, 1)), BrickAtlas::npos);
+}
+
+namespace {
+
+// 有向边 (a, b) 恰出现一次且 (b, a) 也出现一次：网格闭合、流形且绕向一致
+bool IsClosedAndOriented(const Mesh& mesh) {
+    std::map<std::pair<unsigned, unsigned>, int> edges;
+    for (std::size_t i = 0; i < mesh.indices.size(); i += 3) {
+        for (int k = 0; k < 3; ++k) {
+            ++edges[{mesh.indices[i + k], mesh.indices[i + (k + 1) % 3]}];
+        }
+    }
+    for (const auto& [edge, count] : edges) {
+        const auto reverse = edges.find({edge.second, edge.first});
+        if (count != 1 || reverse == edges.end() || reverse->second != 1) {
+            return false;
+        }
+    }
+    return !edges.empty();
+}
+
+} // namespace
+
+// 测试等值面提取：跳过不含等值的砖块、跨砖块焊接顶点、闭合且法线朝外，随机场的歧义体元也不留裂缝
+TEST(IsosurfaceTest, ExtractsWeldedClosedSurface) {
+    using namespace mcnp::core;
+    const std::array<std::size_t, 3> dims{37, 30, 41};
+    const glm::vec3 center(18.0f, 14.5f, 20.0f);
+    VoxelStoreOptions storeOptions;
+    storeOptions.brickSize = 8;
+    VoxelBrickStore store(dims, 1, storeOptions);
+    for (std::size_t x = 0; x < dims[0]; ++x) {
+        for (std::size_t y = 0; y < dims[1]; ++y) {
+            for (std::size_t z = 0; z < dims[2]; ++z) {
+                store.set(x, y, z, 0, 12.0f - glm::length(glm::vec3(x, y, z) - center), 0.0f);
+            }
+        }
+    }
+    ThreadPool pool(3);
+    IsosurfaceOptions options;
+    options.boxMin = glm::vec3(-37.0f, 0.0f, 0.0f);
+    options.boxMax = glm::vec3(37.0f, 30.0f, 41.0f);  // x 方向体素宽 2
+    options.pool = &pool;
+    IsosurfaceExtractor extractor(store, 0, options);
+
+    const Mesh sphere = extractor.extract(0.0f);
+    const auto& stats = extractor.stats();
+    EXPECT_GT(stats.skippedBricks, 0u);
+    EXPECT_EQ(stats.activeBricks + stats.skippedBricks, store.brickCount());
+    EXPECT_EQ(stats.triangles * 3, sphere.indices.size());
+    EXPECT_TRUE(IsClosedAndOriented(sphere));
+
+    // 每条穿过等值面的体素边恰好一个顶点
+    std::size_t crossings = 0;
+    for (std::size_t x = 0; x < dims[0]; ++x) {
+        for (std::size_t y = 0; y < dims[1]; ++y) {
+            for (std::size_t z = 0; z < dims[2]; ++z) {
+                const bool inside = store.value(x, y, z, 0) >= 0.0f;
+                crossings += x + 1 < dims[0] && (store.value(x + 1, y, z, 0) >= 0.0f) != inside;
+                crossings += y + 1 < dims[1] && (store.value(x, y + 1, z, 0) >= 0.0f) != inside;
+                crossings += z + 1 < dims[2] && (store.value(x, y, z + 1, 0) >= 0.0f) != inside;
+            }
+        }
+    }
+    EXPECT_EQ(sphere.vertices.size(), crossings);
+
+    const glm::vec3 worldCenter(-37.0f + (center.x + 0.5f) * 2.0f, center.y + 0.5f, center.z + 0.5f);
+    for (const Vertex& vertex : sphere.vertices) {
+        const glm::vec3 offset = vertex.position - worldCenter;
+        ASSERT_NEAR(glm::length(offset / glm::vec3(2.0f, 1.0f, 1.0f)), 12.0f, 0.05f);
+        ASSERT_GT(glm::dot(glm::normalize(offset / glm::vec3(4.0f, 1.0f, 1.0f)), vertex.normal), 0.99f);
+    }
+    for (std::size_t i = 0; i < sphere.indices.size(); i += 3) {
+        const glm::vec3 a = sphere.vertices[sphere.indices[i]].position;
+        const glm::vec3 b = sphere.vertices[sphere.indices[i + 1]].position;
+        const glm::vec3 c = sphere.vertices[sphere.indices[i + 2]].position;
+        ASSERT_GT(glm::dot(glm::cross(b - a, c - a), a - worldCenter), 0.0f);
+    }
+
+    // 改变等值只重算三角形，不再解码
+    const Mesh smaller = extractor.extract(4.0f);
+    EXPECT_EQ(extractor.stats().decodedBricks, 0u);
+    EXPECT_LT(smaller.vertices.size(), sphere.vertices.size());
+    EXPECT_TRUE(IsClosedAndOriented(smaller));
+    EXPECT_TRUE(extractor.extract(20.0f).indices.empty());
+
+    // 随机场覆盖全部角点组合（含歧义面），边界一层为 0 使等值面闭合
+    VoxelBrickStore noise({20, 19, 18}, 1, storeOptions);
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    for (std::size_t x = 1; x + 1 < 20; ++x) {
+        for (std::size_t y = 1; y + 1 < 19; ++y) {
+            for (std::size_t z = 1; z + 1 < 18; ++z) {
+                noise.set(x, y, z, 0, uniform(random), 0.0f);
+            }
+        }
+    }
+    IsosurfaceExtractor noisy(noise, 0, options);
+    EXPECT_TRUE(IsClosedAndOriented(noisy.extract(0.5f)));
+    EXPECT_TRUE(IsClosedAndOriented(noisy.extract(0.2f)));
+
+    // 缓存上限只够少数砖块时分批提取，结果不变，缓存不超出上限
+    IsosurfaceOptions bounded = options;
+    bounded.cacheBytes = 40 * 8 * 8 * 8 * sizeof(float);
+    IsosurfaceExtractor limited(store, 0, bounded);
+    const Mesh batched = limited.extract(0.0f);
+    EXPECT_GT(limited.stats().passes, 1u);
+    EXPECT_LE(limited.cachedBytes(), bounded.cacheBytes);
+    EXPECT_EQ(batched.vertices.size(), sphere.vertices.size());
+    EXPECT_EQ(batched.indices.size(), sphere.indices.size());
+    EXPECT_TRUE(IsClosedAndOriented(batched));
+}
+
+// 测试不等距分档：顶点按各轴分档边界落在世界坐标中
+TEST(IsosurfaceTest, MapsVerticesThroughBinEdges) {
+    using namespace mcnp::core;
+    const std::array<std::size_t, 3> dims{24, 20, 20};
+    IsosurfaceOptions options;
+    for (int axis = 0; axis < 3; ++axis) {
+        // 中间细、两侧粗的分档
+        for (std::size_t i = 0; i <= dims[axis]; ++i) {
+            const double u = static_cast<double>(i) / static_cast<double>(dims[axis]) * 2.0 - 1.0;
+            options.edges[axis].push_back(10.0 * (u + 0.5 * u * u * u));
+        }
+    }
+    VoxelStoreOptions storeOptions;
+    storeOptions.brickSize = 8;
+    VoxelBrickStore store(dims, 1, storeOptions);
+    const glm::vec3 center(1.0f, 0.5f, -0.5f);
+    for (std::size_t x = 0; x < dims[0]; ++x) {
+        for (std::size_t y = 0; y < dims[1]; ++y) {
+            for (std::size_t z = 0; z < dims[2]; ++z) {
+                const glm::vec3 p(0.5 * (options.edges[0][x] + options.edges[0][x + 1]),
+                                  0.5 * (options.edges[1][y] + options.edges[1][y + 1]),
+                                  0.5 * (options.edges[2][z] + options.edges[2][z + 1]));
+                store.set(x, y, z, 0, 6.0f - glm::length(p - center), 0.0f);
+            }
+        }
+    }
+    IsosurfaceExtractor extractor(store, 0, options);
+    const Mesh sphere = extractor.extract(0.0f);
+    ASSERT_FALSE(sphere.vertices.empty());
+    EXPECT_TRUE(IsClosedAndOriented(sphere));
+    for (const Vertex& vertex : sphere.vertices) {
+        const glm::vec3 offset = vertex.position - center;
+        ASSERT_NEAR(glm::length(offset), 6.0f, 0.15f);
+        ASSERT_GT(glm::dot(glm::normalize(offset), vertex.normal), 0.95f);
+    }
+}
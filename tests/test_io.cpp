@@ -1,7 +1,37 @@
 #include <gtest/gtest.h>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 #include "config_manager.h"
+#include "card_assembler.h"
 #include "command_parser.h"
+#include "deck_tokenizer.h"
+#include "mcnp_parser.h"
+#include "surface_compiler.h"
+#include "cell_compiler.h"
+#include "incremental_deck.h"
+#include "cell_mesher.h"
+#include "mcnp_writer.h"
+#include "fluka_parser.h"
+#include "fluka_writer.h"
+#include "xml_stream.h"
+#include "gdml_reader.h"
+#include "gdml_writer.h"
+#include "openmc_writer.h"
+#include "deck_checker.h"
+#include "cross_reference.h"
+#include "deck_diff.h"
+#include "deck_sweep.h"
+#include "mctal_reader.h"
+#include "meshtal_reader.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
 #include <string>
+#include <thread>
 
 // 测试命令解析功能
 TEST(CommandParserTest, ParseValidCommand) {
@@ -31,3 +61,2327 @@ TEST(ConfigManagerTest, LoadDefaultConfig) {
     // 恢复原始状态
     sceneState = originalState;
 }
+
+// 测试分词：词元为输入缓冲区视图，行列号从 1 开始，支持 CRLF 与制表符
+TEST(DeckTokenizerTest, TokensCarrySpans) {
+    using namespace mcnp::parser;
+    const std::string text = "1  0 -1\t imp:n=1\r\n\n   10   so  12.5   $ a long trailing comment here\n";
+    LineScanner scanner(text);
+    DeckLine line;
+    std::vector<Token> tokens;
+    std::vector<std::size_t> lineNumbers;
+    while (scanner.next(line)) {
+        lineNumbers.push_back(line.number);
+        tokenizeLine(line, tokens);
+    }
+    EXPECT_EQ(lineNumbers.size(), 3u);
+    ASSERT_EQ(tokens.size(), 13u);
+    EXPECT_EQ(tokens[3].text, "imp:n=1");
+    EXPECT_EQ(tokens[3].column, 10u);
+    EXPECT_EQ(tokens[4].text, "10");
+    EXPECT_EQ(tokens[4].line, 3u);
+    EXPECT_EQ(tokens[4].column, 4u);
+    EXPECT_EQ(tokens.back().text, "here");
+    EXPECT_GE(tokens.back().text.data(), text.data());
+    EXPECT_LT(tokens.back().text.data(), text.data() + text.size());
+}
+
+// 测试内存映射解析与字符串解析结果一致
+TEST(DeckTokenizerTest, MappedFileMatchesInMemoryParse) {
+    using namespace mcnp::parser;
+    const std::string deck = "test deck\n1 1 -1.0 -1 imp:n=1\n2 0 1 imp:n=0\n\n1 so 5\n\nmode n\n";
+    const auto path = std::filesystem::temp_directory_path() / "mcpvet_tokenizer_test.i";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << deck;
+    }
+    MCNPParser parser;
+    const auto fromFile = parser.parseFile(path);
+    const auto fromText = parser.parse(deck);
+    std::filesystem::remove(path);
+    ASSERT_TRUE(fromFile.errors.empty());
+    ASSERT_EQ(fromFile.ast.cardCount(), fromText.ast.cardCount());
+    for (std::size_t i = 0; i < fromText.ast.cardCount(); ++i) {
+        EXPECT_EQ(fromFile.ast.card(i).raw(), fromText.ast.card(i).raw());
+    }
+
+    const auto missing = parser.parseFile(path);
+    EXPECT_EQ(missing.errors.size(), 1u);
+}
+
+// 测试扁平 AST：参数共享驻留字符串，卡片与参数连续存放
+TEST(FlatAstTest, InternsTokensAndKeepsSpans) {
+    using namespace mcnp::parser;
+    MCNPParser parser;
+    auto result = parser.parse("flat ast\n1 1 -1.0 -1 imp:n=1\n2 1 -1.0 1 -2 imp:n=1\n\n1 so 5\n2 so 10\n");
+    ASSERT_EQ(result.ast.cardCount(), 5u);
+    EXPECT_EQ(result.ast.card(0).kind(), CardKind::Title);
+
+    const CardView second = result.ast.card(2);
+    EXPECT_EQ(second.kind(), CardKind::Cell);
+    EXPECT_EQ(second.line(), 3u);
+    EXPECT_EQ(second.keyword(), "2");
+    ASSERT_EQ(second.parameterCount(), 5u);
+    EXPECT_EQ(second.parameter(4), "imp:n=1");
+    EXPECT_EQ(second.parameterRecord(4).column, 15u);
+    EXPECT_EQ(result.ast.card(4).kind(), CardKind::Surface);
+
+    // 相同文本只驻留一次
+    EXPECT_EQ(result.ast.card(1).parameterRecord(3).text, second.parameterRecord(4).text);
+
+    // 移动后视图仍然有效
+    Ast moved = std::move(result.ast);
+    EXPECT_EQ(moved.card(3).raw(), "1 so 5");
+
+    // 原始文本不复制进 arena：AST 保管输入的副本，调用方的文本释放后仍然有效
+    std::string deck = "flat ast\n";
+    for (int i = 1; i <= 2000; ++i) {
+        deck += std::to_string(i) + " 0 -1 imp:n=1 $ cell comment that is not interned\n";
+    }
+    deck += "\n1 so 5\n";
+    const std::size_t inputBytes = deck.size();
+    auto large = parser.parse(deck);
+    deck.assign(deck.size(), 'x');
+    deck.clear();
+    deck.shrink_to_fit();
+    EXPECT_EQ(large.ast.card(2000).raw(), "2000 0 -1 imp:n=1 $ cell comment that is not interned");
+    EXPECT_LT(large.ast.arenaBytes(), inputBytes);
+}
+
+// 测试续行、简写、message 块与纵向格式
+TEST(CardSyntaxTest, ContinuationsShorthandAndVerticalFormat) {
+    using namespace mcnp::parser;
+    MCNPParser parser;
+    const auto result = parser.parse(
+        "message: i=deck.i\n"
+        "\n"
+        "syntax test\n"
+        "1 1 -1.0 -1 &\n"
+        "c inside continuation\n"
+        "     imp:n=1 $ trailing comment\n"
+        "2 0 1\n"
+        "\n"
+        "1 so 5\n"
+        "\n"
+        "e0 1 2i 4 2r 0.5 2m\n"
+        "#  imp:n  vol\n"
+        "1  1      10\n"
+        "2  0      j\n"
+        "mode n\n");
+    ASSERT_TRUE(result.errors.empty());
+    ASSERT_EQ(result.ast.cardCount(), 9u);
+    EXPECT_EQ(result.ast.card(0).kind(), CardKind::Message);
+    EXPECT_EQ(result.ast.card(1).raw(), "syntax test");
+
+    const CardView cell = result.ast.card(2);
+    EXPECT_EQ(cell.line(), 4u);
+    ASSERT_EQ(cell.parameterCount(), 4u);
+    EXPECT_EQ(cell.parameter(3), "imp:n=1");
+    EXPECT_EQ(cell.parameterRecord(3).line, 6u);
+
+    // AST 保留紧凑形式，按需展开
+    const CardView energies = result.ast.card(5);
+    EXPECT_TRUE(energies.hasShorthand());
+    EXPECT_EQ(energies.parameterCount(), 6u);
+    const std::vector<std::string> expected{"1", "2", "3", "4", "4", "4", "0.5", "1"};
+    EXPECT_EQ(energies.expandedParameters(), expected);
+    EXPECT_FALSE(isShorthandToken("92235.66m"));
+
+    EXPECT_EQ(result.ast.card(6).keyword(), "imp:n");
+    ASSERT_EQ(result.ast.card(7).parameterCount(), 2u);
+    EXPECT_EQ(result.ast.card(7).keyword(), "vol");
+    EXPECT_EQ(result.ast.card(7).parameter(1), "j");
+    EXPECT_EQ(result.ast.card(8).keyword(), "mode");
+}
+
+// 测试只有续行符的卡片报告为错误而不是取空关键字
+TEST(CardSyntaxTest, ReportsCardsWithoutKeyword) {
+    using namespace mcnp::parser;
+    MCNPParser parser;
+    const auto result = parser.parse("t\n1 0 -1\n&\n\n1 so 1\n");
+    ASSERT_EQ(result.errors.size(), 1u);
+    EXPECT_EQ(result.errors[0].line, 3u);
+    ASSERT_EQ(result.ast.cardCount(), 3u);
+    EXPECT_EQ(result.ast.card(2).keyword(), "1");
+
+    // 纵向格式的行在此结束
+    const auto vertical = parser.parse("t\n1 0 -1\n\n1 so 1\n\n# imp:n\n1 1\n&\n");
+    ASSERT_EQ(vertical.errors.size(), 1u);
+    EXPECT_EQ(vertical.errors[0].line, 8u);
+    EXPECT_EQ(vertical.ast.card(vertical.ast.cardCount() - 1).keyword(), "imp:n");
+}
+
+// 测试 READ FILE= 包含：相对路径、来源标记与循环检测
+TEST(CardSyntaxTest, ReadIncludesFiles) {
+    using namespace mcnp::parser;
+    const auto dir = std::filesystem::temp_directory_path() / "mcpvet_read_test";
+    std::filesystem::create_directories(dir);
+    {
+        std::ofstream(dir / "main.i") << "include test\n1 0 -1\n\n1 so 5\n\nread file=mats.i\nmode n\n";
+        std::ofstream(dir / "mats.i") << "m1 1001 2 8016 1\nread file=mats.i\n";
+    }
+    MCNPParser parser;
+    const auto result = parser.parseFile(dir / "main.i");
+    std::filesystem::remove_all(dir);
+
+    ASSERT_EQ(result.errors.size(), 1u);  // mats.i 包含自身
+    EXPECT_EQ(result.errors[0].line, 2u);
+    ASSERT_EQ(result.ast.cardCount(), 7u);
+    EXPECT_EQ(result.ast.card(3).kind(), CardKind::Include);
+    const CardView material = result.ast.card(4);
+    EXPECT_EQ(material.keyword(), "m1");
+    EXPECT_EQ(material.kind(), CardKind::Data);
+    EXPECT_NE(material.source().find("mats.i"), std::string_view::npos);
+    EXPECT_TRUE(result.ast.card(6).source().empty());
+}
+
+// 测试曲面卡片编译：TR 引用、边界前缀、周期面与错误报告
+TEST(SurfaceCompilerTest, CompilesSurfacesWithTransforms) {
+    using namespace mcnp::parser;
+    MCNPParser parser;
+    const auto parsed = parser.parse(
+        "surfaces\n1 0 -1 2 -3\n\n"
+        "1 3 cz 2\n*2 pz 0\n+3 -2 pz 10\n4 rpp -1 1 -1 1 -1 1\n5 7 so 1\n6 qq 1\n\n"
+        "*tr3 0 0 5 0 90 90 90 90 0 90 180 90\nmode n\n");
+    const SurfaceCompileResult compiled = compileSurfaces(parsed.ast);
+
+    ASSERT_EQ(compiled.errors.size(), 2u);  // 未定义 TR7、未知助记符 qq
+    EXPECT_EQ(compiled.errors[0].line, 8u);
+    EXPECT_EQ(compiled.transforms.count(3), 1u);
+
+    const auto& table = compiled.table;
+    EXPECT_EQ(table.size(), 3u + 6u);
+    const auto cylinder = table.find(1);
+    ASSERT_TRUE(cylinder);
+    // TR3 把 z' 轴转到 -y，并平移到 z=5
+    EXPECT_EQ(table.sense(*cylinder, glm::dvec3(0.0, 50.0, 5.0)), -1);
+    EXPECT_EQ(table.sense(*cylinder, glm::dvec3(0.0, 0.0, 8.0)), 1);
+    EXPECT_EQ(table.boundary(*table.find(2)), mcnp::core::BoundaryKind::Reflecting);
+    EXPECT_EQ(table.boundary(*table.find(3)), mcnp::core::BoundaryKind::Periodic);
+    EXPECT_EQ(table.periodicPartner(3).value_or(0), 2);
+    EXPECT_NE(table.findMacroBody(4), nullptr);
+}
+
+// 测试单元表达式编译：并、括号、#n 与 #(...) 补、LIKE BUT 与错误报告
+TEST(CellCompilerTest, CompilesComplementsAndUnions) {
+    using namespace mcnp::parser;
+    MCNPParser parser;
+    const auto parsed = parser.parse(
+        "cells\n"
+        "1 1 -1.0 -1 (2:-3) imp:n=1\n"
+        "2 0 #1 -4 imp:n=1\n"
+        "3 0 #(-1 (2:-3)) -4\n"
+        "4 like 1 but imp:n=2\n"
+        "5 0 -10.2 #6\n"
+        "6 0 #5\n"
+        "7 like 1 but mat=2 rho=-2.5\n"
+        "8 like 1 but mat = 0\n"
+        "\n"
+        "1 so 5\n2 pz 0\n3 pz -2\n4 so 20\n10 rpp -1 1 -1 1 -1 1\n\nmode n\n");
+    const CellCompileResult compiled = compileCells(parsed.ast);
+
+    ASSERT_EQ(compiled.cells.size(), 8u);
+    ASSERT_EQ(compiled.errors.size(), 1u);  // 5 与 6 互相取补
+    EXPECT_EQ(compiled.find(1)->material, 1);
+    EXPECT_DOUBLE_EQ(compiled.find(1)->density, -1.0);
+    // #1 与 #(...) 的展开共享同一节点
+    EXPECT_EQ(compiled.find(2)->region, compiled.find(3)->region);
+    EXPECT_EQ(compiled.find(4)->region, compiled.find(1)->region);
+    EXPECT_EQ(compiled.find(4)->material, 1);
+    EXPECT_DOUBLE_EQ(compiled.find(4)->density, -1.0);
+    EXPECT_EQ(compiled.find(7)->region, compiled.find(1)->region);
+    EXPECT_EQ(compiled.find(7)->material, 2);
+    EXPECT_DOUBLE_EQ(compiled.find(7)->density, -2.5);
+    EXPECT_EQ(compiled.find(8)->material, 0);
+    EXPECT_DOUBLE_EQ(compiled.find(8)->density, 0.0);
+    EXPECT_DOUBLE_EQ(compiled.find(1)->importance.value_or(-1.0), 1.0);
+    EXPECT_DOUBLE_EQ(compiled.find(4)->importance.value_or(-1.0), 2.0);
+    EXPECT_DOUBLE_EQ(compiled.find(7)->importance.value_or(-1.0), 1.0);
+    EXPECT_FALSE(compiled.find(3)->importance);
+
+    const SurfaceCompileResult surfaces = compileSurfaces(parsed.ast);
+    const auto& dag = compiled.dag;
+    EXPECT_TRUE(dag.contains(compiled.find(1)->region, glm::dvec3(0.0, 0.0, 1.0), surfaces.table));
+    EXPECT_TRUE(dag.contains(compiled.find(1)->region, glm::dvec3(0.0, 0.0, -3.0), surfaces.table));
+    EXPECT_FALSE(dag.contains(compiled.find(1)->region, glm::dvec3(0.0, 0.0, -1.0), surfaces.table));
+    EXPECT_TRUE(dag.contains(compiled.find(2)->region, glm::dvec3(0.0, 0.0, -1.0), surfaces.table));
+    EXPECT_FALSE(dag.contains(compiled.find(2)->region, glm::dvec3(0.0, 0.0, 1.0), surfaces.table));
+}
+
+TEST(CellCompilerTest, BuildsUniversesThroughLattices) {
+    using namespace mcnp::parser;
+    const auto parsed = MCNPParser().parse(
+        "universes\n"
+        "1 0 -10 fill=5 imp:n=1\n"
+        "2 0 10 imp:n=0\n"
+        "3 0 -1 2 -3 4 lat=1 u=5 fill=-1:1 -1:1 0:0 7 2r 8 7 7 0 7 7 imp:n=1\n"
+        "4 1 -10.0 -20 u=7 imp:n=1\n"
+        "5 0 20 u=7 imp:n=1\n"
+        "6 0 -1 u=8 imp:n=1\n"
+        "\n"
+        "1 px 1\n2 px -1\n3 py 1\n4 py -1\n10 so 5\n20 cz 0.4\n\nmode n\n");
+    ASSERT_TRUE(parsed.errors.empty());
+    const SurfaceCompileResult surfaces = compileSurfaces(parsed.ast);
+    const CellCompileResult cells = compileCells(parsed.ast);
+    mcnp::core::UniverseResolver resolver;
+    std::vector<std::string> warnings;
+    ASSERT_TRUE(buildUniverses(cells, surfaces.table, resolver, &warnings)) << warnings.front();
+    EXPECT_TRUE(warnings.empty());
+
+    auto cell_at = [&](const glm::dvec3& p) { return resolver.classify(p).cell; };
+    EXPECT_EQ(cell_at(glm::dvec3(0.1, 0.0, 0.0)), 4);
+    EXPECT_EQ(cell_at(glm::dvec3(0.6, 0.0, 0.0)), 5);
+    EXPECT_EQ(cell_at(glm::dvec3(2.1, 0.0, 0.0)), 4);
+    EXPECT_EQ(cell_at(glm::dvec3(-2.1, 0.0, 0.0)), 6);
+    EXPECT_EQ(cell_at(glm::dvec3(6.0, 0.0, 0.0)), 2);
+    const mcnp::core::PointLocation location = resolver.locate(glm::dvec3(-1.9, 0.1, 0.0));
+    ASSERT_TRUE(location.found);
+    ASSERT_EQ(location.path.size(), 3u);
+    EXPECT_TRUE(location.path[1].inLattice);
+    EXPECT_EQ(location.path[1].latticeIndex, glm::ivec3(-1, 0, 0));
+    EXPECT_NEAR(location.localPoint.x, 0.1, 1e-12);
+}
+
+namespace {
+
+// 生成含注释、续行和简写的大型卡片
+std::string make_large_deck(std::size_t cells) {
+    std::string deck = "message: generated\n\nlarge deck\n";
+    for (std::size_t i = 1; i <= cells; ++i) {
+        const std::string id = std::to_string(i);
+        if (i % 7 == 0) {
+            deck += "c cell " + id + "\n";
+        }
+        if (i % 5 == 0) {
+            deck += id + " 1 -1.0 -" + id + " &\n  imp:n=1\n";
+        } else if (i % 3 == 0) {
+            deck += id + " 0 -" + id + "\n      imp:n=1 $ continued\n";
+        } else {
+            deck += id + " 1 -1.0 -" + id + " imp:n=1\n";
+        }
+    }
+    deck += "\n";
+    for (std::size_t i = 1; i <= cells; ++i) {
+        deck += std::to_string(i) + " so " + std::to_string(i) + ".5\n";
+    }
+    deck += "\nmode n\nm1 1001 2 8016 1\ne0 1 3i 5 2r\n#  vol\n1  1\n2  j\nnps 1000\n";
+    return deck;
+}
+
+} // namespace
+
+// 测试分块并行解析与串行解析逐卡一致
+TEST(ParallelParseTest, MatchesSerialParse) {
+    using namespace mcnp::parser;
+    const std::string deck = make_large_deck(2000);
+
+    ParserOptions serialOptions;
+    serialOptions.parallel = false;
+    ParserOptions parallelOptions;
+    parallelOptions.parallelThreshold = 0;
+    parallelOptions.chunkBytes = 1024;
+    const auto serial = MCNPParser(serialOptions).parse(deck);
+    const auto parallel = MCNPParser(parallelOptions).parse(deck);
+
+    ASSERT_EQ(parallel.errors.size(), serial.errors.size());
+    ASSERT_EQ(parallel.ast.cardCount(), serial.ast.cardCount());
+    for (std::size_t i = 0; i < serial.ast.cardCount(); ++i) {
+        const CardView a = serial.ast.card(i);
+        const CardView b = parallel.ast.card(i);
+        ASSERT_EQ(a.kind(), b.kind()) << "card " << i;
+        ASSERT_EQ(a.line(), b.line()) << "card " << i;
+        ASSERT_EQ(a.keyword(), b.keyword());
+        ASSERT_EQ(a.raw(), b.raw());
+        ASSERT_EQ(a.hasShorthand(), b.hasShorthand());
+        ASSERT_EQ(a.parameterCount(), b.parameterCount());
+        for (std::size_t p = 0; p < a.parameterCount(); ++p) {
+            EXPECT_EQ(a.parameter(p), b.parameter(p));
+            EXPECT_EQ(a.parameterRecord(p).line, b.parameterRecord(p).line);
+            EXPECT_EQ(a.parameterRecord(p).column, b.parameterRecord(p).column);
+        }
+    }
+}
+
+namespace {
+
+const char* kIncrementalDeck =
+    "incremental\n"
+    "1 0 -1 imp:n=1\n"
+    "2 0 1 -2 imp:n=1\n"
+    "3 0 #1 -3 u=5 imp:n=1\n"
+    "4 0 -4 imp:n=1\n"
+    "10 0 -9 fill=5 imp:n=1\n"
+    "11 0 -4 2 imp:n=1\n"
+    "\n"
+    "1 so 1\n"
+    "2 so 2\n"
+    "3 so 3\n"
+    "4 so 4\n"
+    "9 so 9\n"
+    "\n"
+    "mode n\n";
+
+// 增量结果与对当前文本全量解析、编译的结果逐卡、逐单元一致
+void expect_matches_full_parse(const mcnp::parser::IncrementalDeck& deck) {
+    using namespace mcnp::parser;
+    const ParseResult full = MCNPParser().parse(deck.text());
+    ASSERT_EQ(deck.ast().cardCount(), full.ast.cardCount());
+    for (std::size_t i = 0; i < full.ast.cardCount(); ++i) {
+        const CardView a = deck.ast().card(i);
+        const CardView b = full.ast.card(i);
+        EXPECT_EQ(a.kind(), b.kind());
+        EXPECT_EQ(a.keyword(), b.keyword());
+        EXPECT_EQ(a.line(), b.line());
+        EXPECT_EQ(a.offset(), b.offset());
+        // 原始文本直接引用当前文本
+        EXPECT_EQ(a.raw(), b.raw());
+        EXPECT_EQ(a.raw().data(), deck.text().data() + a.offset());
+        ASSERT_EQ(a.parameterCount(), b.parameterCount());
+        for (std::size_t p = 0; p < a.parameterCount(); ++p) {
+            EXPECT_EQ(a.parameter(p), b.parameter(p));
+            EXPECT_EQ(a.parameterRecord(p).line, b.parameterRecord(p).line);
+        }
+    }
+    const SurfaceCompileResult surfaces = compileSurfaces(full.ast);
+    const CellCompileResult cells = compileCells(full.ast);
+    EXPECT_EQ(deck.errors().size(), full.errors.size() + surfaces.errors.size() + cells.errors.size());
+    ASSERT_EQ(deck.cells().cells.size(), cells.cells.size());
+    for (const CompiledCell& expected : cells.cells) {
+        const CompiledCell* actual = deck.cells().find(expected.id);
+        ASSERT_NE(actual, nullptr);
+        EXPECT_EQ(actual->card, expected.card);
+        EXPECT_EQ(actual->fill, expected.fill);
+        EXPECT_EQ(actual->universe, expected.universe);
+        for (double x = -10.0; x <= 10.0; x += 0.37) {
+            const glm::dvec3 p(x, 0.0, 0.0);
+            EXPECT_EQ(deck.cells().dag.contains(actual->region, p, deck.surfaces().table),
+                      cells.dag.contains(expected.region, p, surfaces.table))
+                << "cell " << expected.id << " at x=" << x;
+        }
+    }
+}
+
+} // namespace
+
+// 测试增量编辑：改一个曲面系数只重新编译依赖它的单元（含 #n 与 FILL 传播）
+TEST(IncrementalDeckTest, SurfaceEditRecompilesOnlyDependents) {
+    using namespace mcnp::parser;
+    IncrementalDeck deck;
+    const DeckUpdate loaded = deck.load(kIncrementalDeck);
+    EXPECT_TRUE(loaded.fullReparse);
+    EXPECT_EQ(deck.cellsUsingSurface(1), (std::vector<int>{1, 2}));
+
+    const std::size_t at = deck.text().find("1 so 1\n");
+    const DeckUpdate update = deck.applyEdit({at + 5, 1, "1.5"});
+    EXPECT_FALSE(update.fullReparse);
+    EXPECT_LE(update.reparsedCards, 3u);
+    EXPECT_EQ(update.changedSurfaces, (std::vector<int>{1}));
+    EXPECT_EQ(update.recompiledCells, (std::vector<int>{1, 2, 3}));
+    EXPECT_EQ(update.impactedCells, (std::vector<int>{1, 2, 3, 10}));
+    EXPECT_FALSE(update.dataChanged);
+    expect_matches_full_parse(deck);
+
+    // 只改注释与空白：卡片重新解析但没有任何单元受影响
+    const std::size_t cell4 = deck.text().find("4 0 -4 imp:n=1");
+    const DeckUpdate cosmetic = deck.applyEdit({cell4 + 14, 0, "   $ note"});
+    EXPECT_FALSE(cosmetic.fullReparse);
+    EXPECT_TRUE(cosmetic.impactedCells.empty());
+    expect_matches_full_parse(deck);
+}
+
+// 测试插入、删除卡片后行号与偏移平移，以及需要退回全量解析的编辑
+TEST(IncrementalDeckTest, InsertedCardsShiftLinesAndFallbacks) {
+    using namespace mcnp::parser;
+    IncrementalDeck deck;
+    deck.load(kIncrementalDeck);
+
+    const std::size_t at = deck.text().find("10 0 -9");
+    DeckUpdate update = deck.applyEdit({at, 0, "5 0 -3 -4\n     imp:n=1\n"});
+    EXPECT_FALSE(update.fullReparse);
+    EXPECT_EQ(update.impactedCells, (std::vector<int>{5}));
+    expect_matches_full_parse(deck);
+    EXPECT_EQ(deck.cellsUsingSurface(4), (std::vector<int>{4, 5, 11}));
+
+    // 删除单元 1：引用它的单元 3 重新编译，并报告未定义引用
+    const std::size_t cell1 = deck.text().find("1 0 -1 imp:n=1\n");
+    update = deck.applyEdit({cell1, 15, ""});
+    EXPECT_FALSE(update.fullReparse);
+    EXPECT_EQ(update.recompiledCells, (std::vector<int>{1, 3}));
+    EXPECT_EQ(update.impactedCells, (std::vector<int>{1, 3, 10}));
+    ASSERT_EQ(deck.errors().size(), 1u);
+    expect_matches_full_parse(deck);
+
+    // 插入空行会改变块划分，退回全量解析
+    const std::size_t cell4 = deck.text().find("4 0 -4");
+    update = deck.applyEdit({cell4, 0, "\n"});
+    EXPECT_TRUE(update.fullReparse);
+    expect_matches_full_parse(deck);
+
+    // 标题区编辑同样全量解析
+    update = deck.applyEdit({0, 0, "my "});
+    EXPECT_TRUE(update.fullReparse);
+    expect_matches_full_parse(deck);
+}
+
+// 测试反复编辑后 arena 不会无限增长：死字符串累积过多时重建存储
+TEST(IncrementalDeckTest, RepeatedEditsKeepArenaBounded) {
+    using namespace mcnp::parser;
+    IncrementalDeck deck;
+    deck.load(kIncrementalDeck);
+
+    // 每次编辑驻留一个约 1 KB 的新参数，不重建时累计约 3 MB
+    const std::string digits(1000, '1');
+    for (int i = 0; i < 3000; ++i) {
+        const std::size_t at = deck.text().find("\n9 so ") + 6;
+        const std::size_t end = deck.text().find('\n', at);
+        const DeckUpdate update = deck.applyEdit({at, end - at, "9." + digits + std::to_string(i)});
+        ASSERT_FALSE(update.fullReparse);
+    }
+    EXPECT_LT(deck.ast().arenaBytes(), std::size_t{2} << 20);
+    EXPECT_NE(deck.text().find("9." + digits + "2999\n"), std::string::npos);
+    expect_matches_full_parse(deck);
+}
+
+// 测试单元网格的内容哈希与后台流式网格化：几何相同的单元共享缓存
+TEST(CellMesherTest, ContentKeysAndStreamingCache) {
+    using namespace mcnp::parser;
+    const char* text =
+        "meshing\n"
+        "1 0 -1\n"
+        "2 0 1 -2 -4\n"
+        "3 0 -3\n"
+        "\n"
+        "1 so 5\n2 so 10\n3 so 5\n4 pz 2\n"
+        "\n"
+        "mode n\n";
+    const ParseResult parsed = MCNPParser().parse(text);
+    const SurfaceCompileResult surfaces = compileSurfaces(parsed.ast);
+    const CellCompileResult cells = compileCells(parsed.ast);
+    CellMeshOptions options;
+    options.boundsMin = glm::dvec3(-20.0);
+    options.boundsMax = glm::dvec3(20.0);
+
+    auto key = [&](int id) { return cellMeshKey(cells.dag, cells.find(id)->region, surfaces.table, options); };
+    EXPECT_EQ(key(1), key(3));  // 只是曲面号不同
+    EXPECT_NE(key(1), key(2));
+    const std::string moved = std::string(text).replace(std::string(text).find("1 so 5"), 6, "1 so 6");
+    const ParseResult edited = MCNPParser().parse(moved);
+    const SurfaceCompileResult editedSurfaces = compileSurfaces(edited.ast);
+    const CellCompileResult editedCells = compileCells(edited.ast);
+    EXPECT_NE(cellMeshKey(editedCells.dag, editedCells.find(1)->region, editedSurfaces.table, options), key(1));
+    EXPECT_EQ(cellMeshKey(editedCells.dag, editedCells.find(3)->region, editedSurfaces.table, options), key(3));
+
+    CellMeshCache cache;
+    CellMeshStream stream(cache, options);
+    std::vector<std::pair<int, mcnp::core::CsgDag::NodeId>> work;
+    for (const CompiledCell& cell : cells.cells) {
+        work.emplace_back(cell.id, cell.region);
+    }
+    auto drain = [&stream]() {
+        std::vector<MeshedCell> results;
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+        while (results.size() < 3 && std::chrono::steady_clock::now() < deadline) {
+            for (MeshedCell& result : stream.poll()) {
+                results.push_back(std::move(result));
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return results;
+    };
+
+    stream.start(cells.dag, surfaces.table, work);
+    const std::vector<MeshedCell> first = drain();
+    ASSERT_EQ(first.size(), 3u);
+    for (const MeshedCell& result : first) {
+        EXPECT_TRUE(result.mesh->error.empty()) << result.mesh->error;
+        EXPECT_FALSE(result.mesh->positions.empty());
+        EXPECT_EQ(result.mesh->indices.size() % 3, 0u);
+    }
+    EXPECT_LE(cache.size(), 2u);
+
+    stream.start(cells.dag, surfaces.table, work);
+    const std::vector<MeshedCell> second = drain();
+    ASSERT_EQ(second.size(), 3u);
+    EXPECT_EQ(stream.cacheHits(), 3u);
+    EXPECT_TRUE(std::all_of(second.begin(), second.end(), [](const MeshedCell& r) { return r.cached; }));
+}
+
+// 测试区间传播证明为空的单元直接得到空网格
+TEST(CellMesherTest, EmptyCellsSkipMeshing) {
+    using namespace mcnp::parser;
+    const ParseResult parsed = MCNPParser().parse("empty\n1 0 -1 -2\n2 0 -1 3\n\n1 so 1\n2 s 10 0 0 1\n3 px 0\n\nmode n\n");
+    const SurfaceCompileResult surfaces = compileSurfaces(parsed.ast);
+    const CellCompileResult cells = compileCells(parsed.ast);
+    const CellMesh disjoint = meshCell(cells.dag, cells.find(1)->region, surfaces.table, {});
+    EXPECT_TRUE(disjoint.error.empty());
+    EXPECT_TRUE(disjoint.indices.empty());
+    EXPECT_NE(disjoint.key, 0u);
+    const CellMesh half = meshCell(cells.dag, cells.find(2)->region, surfaces.table, {});
+    EXPECT_TRUE(half.error.empty());
+    EXPECT_FALSE(half.indices.empty());
+}
+
+// 测试卡片折行与 nR / nI 压缩可被读回
+TEST(McnpWriterTest, WrapsLinesAndCompressesRuns) {
+    using namespace mcnp::parser;
+    std::ostringstream out;
+    std::vector<double> values{1, 1, 1, 1, 2, 3, 4, 5, 6, 7, 0.5};
+    for (int i = 0; i < 40; ++i) {
+        values.push_back(1000.125 + i * 7.0 + (i % 3));
+    }
+    {
+        CardWriter writer(out);
+        writer.begin("e0");
+        writer.numbers(values);
+        writer.end();
+        writer.card("c comment that must stay on one line even when it is longer than the eighty column limit");
+    }
+    const std::string text = out.str();
+    EXPECT_EQ(text.rfind("e0 1 3r 2 4i 7 0.5 ", 0), 0u) << text;
+
+    std::vector<std::string> lines;
+    std::istringstream in(text);
+    for (std::string line; std::getline(in, line);) {
+        lines.push_back(line);
+    }
+    ASSERT_GE(lines.size(), 3u);
+    std::vector<std::string_view> tokens;
+    for (std::size_t i = 0; i + 1 < lines.size(); ++i) {
+        EXPECT_LE(lines[i].size(), 80u);
+        if (i > 0) {
+            EXPECT_EQ(lines[i].rfind("     ", 0), 0u);
+        }
+        std::string_view rest(lines[i]);
+        while (!rest.empty()) {
+            const std::size_t start = rest.find_first_not_of(' ');
+            if (start == std::string_view::npos) {
+                break;
+            }
+            rest.remove_prefix(start);
+            const std::size_t stop = std::min(rest.find(' '), rest.size());
+            tokens.push_back(rest.substr(0, stop));
+            rest.remove_prefix(stop);
+        }
+    }
+    EXPECT_EQ(lines.back().rfind("c comment", 0), 0u);
+    tokens.erase(tokens.begin());
+    const std::vector<std::string> expanded = expandShorthand(tokens);
+    ASSERT_EQ(expanded.size(), values.size());
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        EXPECT_NEAR(std::stod(expanded[i]), values[i], 1e-9 * std::abs(values[i])) << i;
+    }
+}
+
+// 测试卡片文件转换为写出模型：IMP 数据卡与单元卡片上的 IMP:，TR 与 IMP 以外的数据卡片原样传递
+TEST(McnpWriterTest, BuildsDeckModelFromCompiledDeck) {
+    using namespace mcnp::parser;
+    const ParseResult parsed = MCNPParser().parse(
+        "model test\n"
+        "1 1 -1.0 -1\n"
+        "2 like 1 but mat=2 rho=-3.0\n"
+        "3 0 1\n"
+        "\n"
+        "1 1 so 5\n"
+        "\n"
+        "mode n p\nimp:n,p 2 1r 0\nm1 1001 1\nm2 8016 1\ntr1 0 0 1\nnps 1e6\n");
+    ASSERT_TRUE(parsed.errors.empty());
+    const SurfaceCompileResult surfaces = compileSurfaces(parsed.ast);
+    const CellCompileResult cells = compileCells(parsed.ast);
+    std::vector<std::string> warnings;
+    const DeckModel model = buildDeckModel(parsed.ast, cells, surfaces, &warnings);
+    EXPECT_TRUE(warnings.empty());
+    EXPECT_EQ(model.title, "model test");
+    EXPECT_EQ(model.particles, "n,p");
+    ASSERT_EQ(model.cells.size(), 3u);
+    EXPECT_DOUBLE_EQ(model.cells[0].importance, 2.0);
+    EXPECT_DOUBLE_EQ(model.cells[1].importance, 2.0);
+    EXPECT_DOUBLE_EQ(model.cells[2].importance, 0.0);
+    EXPECT_EQ(model.cells[1].material, 2);
+    EXPECT_DOUBLE_EQ(model.cells[1].density, -3.0);
+    EXPECT_EQ(model.cells[1].region, model.cells[0].region);
+    const std::vector<std::string> expected{"mode n p", "m1 1001 1", "m2 8016 1", "nps 1e6"};
+    EXPECT_EQ(model.dataCards, expected);
+
+    // 单元卡片上的 IMP: 优先，粒子取 MODE 卡；IMP 数据卡的项数不符时给出警告
+    const ParseResult mixed = MCNPParser().parse(
+        "t\n1 0 -1 imp:p=4\n2 0 1\n\n1 so 5\n\nmode p\n");
+    const CellCompileResult mixedCells = compileCells(mixed.ast);
+    const SurfaceCompileResult mixedSurfaces = compileSurfaces(mixed.ast);
+    const DeckModel mixedModel = buildDeckModel(mixed.ast, mixedCells, mixedSurfaces);
+    EXPECT_EQ(mixedModel.particles, "p");
+    EXPECT_DOUBLE_EQ(mixedModel.cells[0].importance, 4.0);
+    EXPECT_DOUBLE_EQ(mixedModel.cells[1].importance, 1.0);
+    const ParseResult shortImp = MCNPParser().parse("t\n1 0 -1\n2 0 1\n\n1 so 5\n\nimp:n 1\n");
+    const CellCompileResult shortCells = compileCells(shortImp.ast);
+    const SurfaceCompileResult shortSurfaces = compileSurfaces(shortImp.ast);
+    warnings.clear();
+    buildDeckModel(shortImp.ast, shortCells, shortSurfaces, &warnings);
+    EXPECT_EQ(warnings.size(), 1u);
+}
+
+// 测试写出的卡片重新解析后单元覆盖的点不变，重复与反向的曲面被合并
+TEST(McnpWriterTest, RoundTripsCompiledDeck) {
+    using namespace mcnp::parser;
+    const ParseResult parsed = MCNPParser().parse(
+        "round trip\n"
+        "1 1 -1.0 -1 6 imp:n=1\n"
+        "2 0 -1 -2 3 -7 imp:n=1\n"
+        "3 2 0.05 -5 : -8 imp:n=2\n"
+        "4 0 -9 -4 imp:n=1\n"
+        "5 0 -10 imp:n=1\n"
+        "6 0 -11 imp:n=1\n"
+        "7 0 -4 #1 #2 #3 #4 #5 #6 imp:n=1\n"
+        "8 0 4 imp:n=0\n"
+        "\n"
+        "1 so 5\n2 pz 0\n3 pz -2\n4 so 20\n5 rpp 6 8 -1 1 -1 1\n6 pz 0\n7 p 0 0 -1 2\n"
+        "8 c/z 10 0 1\n9 1 k/x 0 0 0 0.25 1\n10 1 tz 0 0 0 3 0.5 0.5\n11 sq 1 2 3 0 0 0 -1 0 0 0\n"
+        "\n"
+        "*tr1 0 0 -10 45 90 135 90 0 90 45 90 45\nmode n\n");
+    ASSERT_TRUE(parsed.errors.empty());
+    const SurfaceCompileResult surfaces = compileSurfaces(parsed.ast);
+    const CellCompileResult cells = compileCells(parsed.ast);
+    ASSERT_TRUE(surfaces.errors.empty());
+
+    DeckModel model = buildDeckModel(parsed.ast, cells, surfaces);
+    std::ostringstream out;
+    const DeckWriteStats stats = writeDeck(out, model);
+    EXPECT_EQ(stats.cells, 8u);
+    EXPECT_EQ(stats.mergedSurfaces, 2u);  // 6 与 2 相同，7 与 3 反向
+    EXPECT_EQ(stats.transforms, 2u);      // 斜置的单叶锥与环面
+    EXPECT_EQ(std::find_if(stats.warnings.begin(), stats.warnings.end(),
+                           [](const std::string& w) { return w.find("lattice") != std::string::npos; }),
+              stats.warnings.end());
+    EXPECT_EQ(stats.bytes, out.str().size());
+
+    const ParseResult reparsed = MCNPParser().parse(out.str());
+    ASSERT_TRUE(reparsed.errors.empty()) << out.str();
+    const SurfaceCompileResult surfaces2 = compileSurfaces(reparsed.ast);
+    const CellCompileResult cells2 = compileCells(reparsed.ast);
+    ASSERT_TRUE(surfaces2.errors.empty()) << out.str();
+    ASSERT_TRUE(cells2.errors.empty()) << out.str();
+    EXPECT_EQ(out.str().find("\n2 pz"), std::string::npos) << out.str();
+    EXPECT_EQ(out.str().find("\n7 p"), std::string::npos) << out.str();
+    EXPECT_NE(out.str().find("\nimp:n 1 1 2 1 3r 0\n"), std::string::npos) << out.str();
+
+    int inside = 0;
+    for (const CompiledCell& cell : cells.cells) {
+        const CompiledCell* written = cells2.find(cell.id);
+        ASSERT_NE(written, nullptr);
+        EXPECT_EQ(written->material, cell.material);
+        for (int k = 0; k < 24; ++k) {
+            for (int j = 0; j < 24; ++j) {
+                for (int i = 0; i < 24; ++i) {
+                    const glm::dvec3 p = glm::dvec3(-22.37, -21.91, -23.13) + glm::dvec3(i, j, k) * 1.937;
+                    const bool expected = cells.dag.contains(cell.region, p, surfaces.table);
+                    EXPECT_EQ(cells2.dag.contains(written->region, p, surfaces2.table), expected)
+                        << "cell " << cell.id << " at " << p.x << " " << p.y << " " << p.z;
+                    inside += expected ? 1 : 0;
+                }
+            }
+        }
+    }
+    EXPECT_GT(inside, 0);
+}
+
+// 测试编辑器几何树导出：差集、包围球内的空腔与墓地单元
+TEST(McnpWriterTest, ExportsGeometryTrees) {
+    using namespace mcnp::parser;
+    using mcnp::core::GeometryNode;
+    using mcnp::core::PrimitiveType;
+    auto box = std::make_shared<GeometryNode>();
+    box->primitive = PrimitiveType::Box;
+    box->transform.scale = glm::vec3(4.0f);
+    auto hole = std::make_shared<GeometryNode>();
+    hole->primitive = PrimitiveType::Sphere;
+    hole->transform.translation = glm::vec3(1.0f, 0.0f, 0.0f);
+    hole->transform.scale = glm::vec3(1.5f);
+    auto shell = std::make_shared<GeometryNode>();
+    shell->label = "shell";
+    shell->booleanOp = mcnp::core::BooleanOperation::Difference;
+    shell->children = {box, hole};
+    shell->material = mcnp::core::MaterialInfo{"steel", 7.9};
+    auto cylinder = std::make_shared<GeometryNode>();
+    cylinder->primitive = PrimitiveType::Cylinder;
+    cylinder->transform.rotation = glm::vec3(0.0f, 0.0f, glm::half_pi<float>());
+
+    std::vector<GeometryCell> trees{{shell, glm::dmat4(1.0)},
+                                    {cylinder, glm::translate(glm::dmat4(1.0), glm::dvec3(10.0, 0.0, 0.0))}};
+    std::ostringstream out;
+    const DeckWriteStats stats = exportGeometry(out, trees);
+    EXPECT_EQ(stats.cells, 4u);
+    const std::string text = out.str();
+    EXPECT_NE(text.find("c m1 steel"), std::string::npos) << text;
+
+    const ParseResult parsed = MCNPParser().parse(text);
+    ASSERT_TRUE(parsed.errors.empty()) << text;
+    const SurfaceCompileResult surfaces = compileSurfaces(parsed.ast);
+    const CellCompileResult cells = compileCells(parsed.ast);
+    ASSERT_TRUE(surfaces.errors.empty()) << text;
+    ASSERT_TRUE(cells.errors.empty()) << text;
+    ASSERT_EQ(cells.cells.size(), 4u);
+    EXPECT_DOUBLE_EQ(cells.find(1)->density, -7.9);
+
+    auto cell_at = [&](const glm::dvec3& p) {
+        int found = 0;
+        for (const CompiledCell& cell : cells.cells) {
+            if (cells.dag.contains(cell.region, p, surfaces.table)) {
+                EXPECT_EQ(found, 0) << "overlap at " << p.x << " " << p.y << " " << p.z;
+                found = cell.id;
+            }
+        }
+        return found;
+    };
+    EXPECT_EQ(cell_at(glm::dvec3(-1.5, 0.1, 0.1)), 1);
+    EXPECT_EQ(cell_at(glm::dvec3(1.0, 0.1, 0.1)), 3);
+    EXPECT_EQ(cell_at(glm::dvec3(3.0, 0.1, 0.1)), 3);
+    // 圆柱绕 z 轴转 90° 后沿 x 轴
+    EXPECT_EQ(cell_at(glm::dvec3(10.45, 0.1, 0.1)), 2);
+    EXPECT_EQ(cell_at(glm::dvec3(10.1, 0.45, 0.3)), 3);
+    EXPECT_EQ(cell_at(glm::dvec3(1000.0, 0.0, 0.0)), 4);
+}
+
+// 测试相互重叠的图元以 #n 扣除靠前的单元，布尔差集导出为补集的交
+TEST(McnpWriterTest, ExcludesEarlierOverlappingCells) {
+    using namespace mcnp::parser;
+    using mcnp::core::GeometryNode;
+    using mcnp::core::PrimitiveType;
+    auto sphere = std::make_shared<GeometryNode>();
+    sphere->primitive = PrimitiveType::Sphere;
+    auto box = std::make_shared<GeometryNode>();
+    box->primitive = PrimitiveType::Box;
+    auto hole = std::make_shared<GeometryNode>(*sphere);
+    hole->transform.translation = glm::vec3(0.5f, 0.0f, 0.0f);
+    hole->transform.scale = glm::vec3(0.5f);
+    auto cut = std::make_shared<GeometryNode>();
+    cut->booleanOp = mcnp::core::BooleanOperation::Difference;
+    cut->children = {box, hole};
+
+    std::vector<GeometryCell> trees{{sphere, glm::scale(glm::dmat4(1.0), glm::dvec3(2.0))},
+                                    {box, glm::scale(glm::translate(glm::dmat4(1.0), glm::dvec3(2.0, 0.0, 0.0)),
+                                                     glm::dvec3(2.0))},
+                                    {cut, glm::scale(glm::translate(glm::dmat4(1.0), glm::dvec3(10.0, 0.0, 0.0)),
+                                                     glm::dvec3(4.0))}};
+    std::ostringstream out;
+    const DeckWriteStats stats = exportGeometry(out, trees);
+    EXPECT_EQ(stats.cells, 5u);
+    const std::string text = out.str();
+
+    const ParseResult parsed = MCNPParser().parse(text);
+    ASSERT_TRUE(parsed.errors.empty()) << text;
+    const SurfaceCompileResult surfaces = compileSurfaces(parsed.ast);
+    const CellCompileResult cells = compileCells(parsed.ast);
+    ASSERT_TRUE(surfaces.errors.empty()) << text;
+    ASSERT_TRUE(cells.errors.empty()) << text;
+    ASSERT_EQ(cells.cells.size(), 5u);
+
+    auto cell_at = [&](const glm::dvec3& p) {
+        int found = 0;
+        for (const CompiledCell& cell : cells.cells) {
+            if (cells.dag.contains(cell.region, p, surfaces.table)) {
+                EXPECT_EQ(found, 0) << "overlap at " << p.x << " " << p.y << " " << p.z << "\n" << text;
+                found = cell.id;
+            }
+        }
+        return found;
+    };
+    // 球与立方体在 x∈[1,2] 重叠，归靠前的球
+    EXPECT_EQ(cell_at(glm::dvec3(1.5, 0.1, 0.1)), 1);
+    EXPECT_EQ(cell_at(glm::dvec3(-1.5, 0.1, 0.1)), 1);
+    EXPECT_EQ(cell_at(glm::dvec3(2.5, 0.1, 0.1)), 2);
+    EXPECT_EQ(cell_at(glm::dvec3(2.5, 0.9, 0.9)), 2);
+    // 差集：立方体边长 4，扣掉中心在 x=12、半径 2 的球
+    EXPECT_EQ(cell_at(glm::dvec3(8.5, 0.1, 0.1)), 3);
+    EXPECT_EQ(cell_at(glm::dvec3(11.0, 0.1, 0.1)), 4);
+    EXPECT_EQ(cell_at(glm::dvec3(8.5, 1.8, 1.8)), 3);
+}
+
+// 测试定长与自由格式的普通卡片、按名称的几何与 ASSIGNMA/LATTICE
+TEST(FlukaParserTest, ParsesNamedGeometryAndCards) {
+    using namespace mcnp::parser;
+    const ParseResult parsed = FlukaParser().parse(
+        "TITLE\n"
+        "fluka sample\n"
+        "* fixed cards\n"
+        "BEAM         -10.0D0                                                  PROTON\n"
+        "GEOBEGIN                                                              COMBNAME\n"
+        "    0    0          sample geometry\n"
+        "RPP blkbody -100 100 -100 100\n"
+        "     -100 100 ! continued\n"
+        "SPH void 0.0 0.0 0.0 90.0\n"
+        "XYP cut 0.0\n"
+        "QUA quad 1 1 0 0 0 0 0 0 0 -4\n"
+        "END\n"
+        "BLKHOLE 5 +blkbody -void\n"
+        "LOWER 5 +void +cut -quad\n"
+        "UPPER 5 +void -cut -( +quad )\n"
+        "CELLS 5 +void +quad +cut\n"
+        "        | +void +quad -cut\n"
+        "END\n"
+        "LATTICE        CELLS                                                  ROT1\n"
+        "GEOEND\n"
+        "FREE\n"
+        "MATERIAL,,,2.5,,,,WATERISH\n"
+        "ASSIGNMA BLCKHOLE BLKHOLE\n"
+        "ASSIGNMA WATERISH LOWER UPPER\n"
+        "FIXED\n"
+        "START        1000.0\n"
+        "STOP\n");
+    ASSERT_TRUE(parsed.errors.empty()) << parsed.errors.front().message;
+    const Ast& ast = parsed.ast;
+    ASSERT_GT(ast.cardCount(), 4u);
+    const CardView beam = ast.card(3);
+    EXPECT_EQ(beam.kind(), CardKind::Data);
+    EXPECT_EQ(beam.keyword(), "BEAM");
+    ASSERT_EQ(beam.parameterCount(), 7u);
+    EXPECT_EQ(beam.parameter(0), "-10.0D0");
+    EXPECT_EQ(beam.parameter(1), "");
+    EXPECT_EQ(beam.parameter(6), "PROTON");
+
+    const FlukaModel model = compileFluka(ast);
+    ASSERT_TRUE(model.errors.empty()) << model.errors.front().message;
+    EXPECT_EQ(model.title, "fluka sample");
+    ASSERT_EQ(model.bodies.size(), 4u);
+    ASSERT_EQ(model.regions.size(), 4u);
+    EXPECT_EQ(model.findBody("VOID"), 2);
+    EXPECT_EQ(model.regions[model.findRegion("blkhole") - 1].material, kFlukaBlackhole);
+    const int water = model.findMaterial("waterish");
+    ASSERT_GT(water, kFlukaPredefinedMaterials);
+    EXPECT_DOUBLE_EQ(model.materials[water - 1].density, 2.5);
+    EXPECT_EQ(model.regions[model.findRegion("LOWER") - 1].material, water);
+    EXPECT_EQ(model.regions[model.findRegion("UPPER") - 1].material, water);
+    EXPECT_EQ(model.regions[model.findRegion("CELLS") - 1].material, 0);
+    ASSERT_EQ(model.lattices.size(), 1u);
+    EXPECT_EQ(model.lattices.front().region, model.findRegion("CELLS"));
+    EXPECT_EQ(model.lattices.front().transform, "ROT1");
+
+    // 各区域互不重叠且覆盖整个盒子
+    for (int k = 0; k < 12; ++k) {
+        for (int j = 0; j < 12; ++j) {
+            for (int i = 0; i < 12; ++i) {
+                const glm::dvec3 p = glm::dvec3(-97.3, -96.1, -95.7) + glm::dvec3(i, j, k) * 17.3;
+                int owners = 0;
+                for (const FlukaRegion& region : model.regions) {
+                    owners += model.dag.contains(region.region, p, model.surfaces) ? 1 : 0;
+                }
+                EXPECT_EQ(owners, 1) << p.x << " " << p.y << " " << p.z;
+            }
+        }
+    }
+    const auto cellsRegion = model.regions[model.findRegion("CELLS") - 1].region;
+    EXPECT_TRUE(model.dag.contains(cellsRegion, glm::dvec3(1.0, 0.5, -3.0), model.surfaces));
+    EXPECT_TRUE(model.dag.contains(cellsRegion, glm::dvec3(1.0, 0.5, 3.0), model.surfaces));
+    EXPECT_TRUE(model.dag.contains(model.regions[model.findRegion("LOWER") - 1].region, glm::dvec3(5.0, 0.0, -3.0),
+                                   model.surfaces));
+}
+
+// 测试旧式定长几何（编号几何体、OR 并）与错误报告
+TEST(FlukaParserTest, ParsesLegacyFixedGeometry) {
+    using namespace mcnp::parser;
+    const ParseResult parsed = FlukaParser().parse(
+        "GEOBEGIN\n"
+        "    0    0          legacy\n"
+        "  RPP    1     -20.0      20.0     -20.0      20.0     -20.0      20.0\n"
+        "  SPH    2       0.0       0.0       0.0\n"
+        "                 5.0\n"
+        "  ZCC    3       8.0       0.0       2.0\n"
+        "  END\n"
+        "  OUT    5     +1     -2     -3\n"
+        "  IN     5     +2OR   +3\n"
+        "  END\n"
+        "GEOEND\n");
+    ASSERT_TRUE(parsed.errors.empty()) << parsed.errors.front().message;
+    const FlukaModel model = compileFluka(parsed.ast);
+    ASSERT_TRUE(model.errors.empty()) << model.errors.front().message;
+    ASSERT_EQ(model.regions.size(), 2u);
+    const auto in = model.regions[1].region;
+    EXPECT_TRUE(model.dag.contains(in, glm::dvec3(0.0, 0.0, 4.0), model.surfaces));
+    EXPECT_TRUE(model.dag.contains(in, glm::dvec3(9.0, 0.5, 15.0), model.surfaces));
+    EXPECT_FALSE(model.dag.contains(in, glm::dvec3(0.0, 10.0, 0.0), model.surfaces));
+    EXPECT_TRUE(model.dag.contains(model.regions[0].region, glm::dvec3(0.0, 10.0, 0.0), model.surfaces));
+
+    const ParseResult broken = FlukaParser({true}).parse(
+        "GEOBEGIN COMBNAME\n"
+        "title\n"
+        "$start_translat -10 0 0\n"
+        "SPH a 0 0 0 1\n"
+        "END\n"
+        "R1 5 +a -missing\n"
+        "END\n");
+    ASSERT_EQ(broken.errors.size(), 2u);
+    EXPECT_NE(broken.errors[0].message.find("not supported"), std::string::npos);
+    EXPECT_NE(broken.errors[1].message.find("GEOEND"), std::string::npos);
+    const FlukaModel brokenModel = compileFluka(broken.ast);
+    ASSERT_EQ(brokenModel.errors.size(), 1u);
+    EXPECT_NE(brokenModel.errors.front().message.find("undefined body missing"), std::string::npos);
+}
+
+namespace {
+
+// 在 MCNP 与 FLUKA 两侧比较每个单元在格点上的覆盖
+template <typename ContainsA, typename ContainsB>
+int compare_cells(std::size_t cells, ContainsA&& a, ContainsB&& b, const glm::dvec3& origin, double step) {
+    int inside = 0;
+    for (std::size_t c = 0; c < cells; ++c) {
+        for (int k = 0; k < 20; ++k) {
+            for (int j = 0; j < 20; ++j) {
+                for (int i = 0; i < 20; ++i) {
+                    const glm::dvec3 p = origin + glm::dvec3(i, j, k) * step;
+                    const bool expected = a(c, p);
+                    EXPECT_EQ(b(c, p), expected) << "cell #" << c << " at " << p.x << " " << p.y << " " << p.z;
+                    inside += expected ? 1 : 0;
+                }
+            }
+        }
+    }
+    return inside;
+}
+
+} // namespace
+
+// 测试 MCNP 卡片写成 FLUKA 后重新读入，区域覆盖不变；环面单元跳过并给出警告
+TEST(FlukaWriterTest, ConvertsMcnpDeck) {
+    using namespace mcnp::parser;
+    const ParseResult parsed = MCNPParser().parse(
+        "to fluka\n"
+        "1 1 -7.9 -1 6 imp:n=1\n"
+        "2 0 -1 -2 3 -7 imp:n=1\n"
+        "3 2 0.05 -5 : -8 imp:n=1\n"
+        "4 0 -9 -4 imp:n=1\n"
+        "5 0 -10 imp:n=1\n"
+        "6 2 -1.0 -11 -4 #1 #4 imp:n=1\n"
+        "7 0 4 imp:n=0\n"
+        "\n"
+        "1 so 5\n2 pz 0\n3 pz -2\n4 so 20\n5 rpp 6 8 -1 1 -1 1\n6 pz 0\n7 p 0 0 -1 2\n"
+        "8 c/y 10 0 1\n9 1 k/x 0 0 0 0.25\n10 tz 0 0 -15 3 0.5 0.5\n11 cx 12\n"
+        "\n"
+        "*tr1 0 0 -10 45 90 135 90 0 90 45 90 45\nmode n\n");
+    ASSERT_TRUE(parsed.errors.empty());
+    const SurfaceCompileResult surfaces = compileSurfaces(parsed.ast);
+    CellCompileResult cells = compileCells(parsed.ast);
+    ASSERT_TRUE(surfaces.errors.empty());
+    ASSERT_TRUE(cells.errors.empty());
+
+    DeckModel model = buildDeckModel(parsed.ast, cells, surfaces);
+    // 单元 6 的 #1 #4 改为写出时展开
+    model.cells[5].region = cells.dag.intersection(std::vector<mcnp::core::CsgDag::NodeId>{
+        cells.dag.halfspace(11, true), cells.dag.halfspace(4, true)});
+    model.cells[5].excluded = {1, 4};
+    FlukaWriterOptions options;
+    options.materialNames[1] = "IRON";
+    std::ostringstream out;
+    const DeckWriteStats stats = writeFluka(out, model, options);
+    const std::string text = out.str();
+    EXPECT_EQ(stats.cells, 6u) << text;
+    EXPECT_EQ(stats.mergedSurfaces, 2u);
+    EXPECT_NE(std::find_if(stats.warnings.begin(), stats.warnings.end(),
+                           [](const std::string& w) { return w.find("cell 5 uses a torus") != std::string::npos; }),
+              stats.warnings.end());
+    EXPECT_NE(text.find("\nSPH S1 "), std::string::npos) << text;
+    EXPECT_NE(text.find("\nYCC S8 "), std::string::npos) << text;
+    EXPECT_NE(text.find("\nYZP S5F1 8\n"), std::string::npos) << text;  // 宏体按面写出
+    EXPECT_NE(text.find("\nQUA S9 "), std::string::npos) << text;
+    EXPECT_EQ(text.find("S10"), std::string::npos) << text;
+
+    const ParseResult reparsed = FlukaParser().parse(text);
+    ASSERT_TRUE(reparsed.errors.empty()) << reparsed.errors.front().message << "\n" << text;
+    const FlukaModel fluka = compileFluka(reparsed.ast);
+    ASSERT_TRUE(fluka.errors.empty()) << fluka.errors.front().message << "\n" << text;
+    ASSERT_EQ(fluka.regions.size(), 6u);
+    EXPECT_EQ(fluka.title, "to fluka");
+    // 卡片文件中 IMP:N=0 的墓地单元写成 BLCKHOLE
+    EXPECT_EQ(fluka.regions[5].material, kFlukaBlackhole);
+    EXPECT_EQ(fluka.materials[fluka.regions[0].material - 1].name, "IRON");
+    EXPECT_EQ(fluka.regions[1].material, kFlukaVacuum);
+    const int mat2 = fluka.findMaterial("MAT2");
+    ASSERT_GT(mat2, 0);
+    EXPECT_EQ(fluka.regions[2].material, mat2);
+    EXPECT_EQ(fluka.regions[4].material, fluka.findMaterial("M2_2"));
+    EXPECT_DOUBLE_EQ(fluka.materials[fluka.findMaterial("M2_2") - 1].density, 1.0);
+
+    const std::vector<int> ids{1, 2, 3, 4, 6};
+    auto mcnp_contains = [&](std::size_t c, const glm::dvec3& p) {
+        const DeckCell& cell = model.cells[static_cast<std::size_t>(ids[c] - 1)];
+        bool inside = cells.dag.contains(cell.region, p, surfaces.table);
+        for (const int excluded : cell.excluded) {
+            inside = inside && !cells.dag.contains(model.cells[excluded - 1].region, p, surfaces.table);
+        }
+        return inside;
+    };
+    auto fluka_contains = [&](std::size_t c, const glm::dvec3& p) {
+        const int region = fluka.findRegion("R" + std::to_string(ids[c]));
+        return region != 0 && fluka.dag.contains(fluka.regions[region - 1].region, p, fluka.surfaces);
+    };
+    EXPECT_GT(compare_cells(ids.size(), mcnp_contains, fluka_contains, glm::dvec3(-22.37, -21.91, -23.13), 2.3), 0);
+}
+
+// 测试 FLUKA 经共享的中间表示写成 MCNP 与 FLUKA：几何不变，材料名与其余卡片保留
+TEST(FlukaWriterTest, ConvertsFlukaInput) {
+    using namespace mcnp::parser;
+    const ParseResult parsed = FlukaParser().parse(
+        "TITLE\n"
+        "shared ir\n"
+        "BEAM         -10.0D0                                                  PROTON\n"
+        "GEOBEGIN                                                              COMBNAME\n"
+        "    0    0          geometry\n"
+        "RPP blk -50 50 -50 50 -50 50\n"
+        "SPH void 0 0 0 40\n"
+        "RCC pipe 0 0 -30 0 0 60 5\n"
+        "ZEC ell 0 0 10 20\n"
+        "PLA tilt 1 1 0 0 0 0\n"
+        "END\n"
+        "BLKHOLE 5 +blk -void\n"
+        "PIPE 5 +pipe\n"
+        "TARGET 5 +ell +tilt -pipe\n"
+        "AIR 5 +void -pipe -( +ell +tilt )\n"
+        "END\n"
+        "GEOEND\n"
+        "MATERIAL                       2.5                                    TARGETM\n"
+        "ASSIGNMA  BLCKHOLE   BLKHOLE\n"
+        "ASSIGNMA    VACUUM      PIPE\n"
+        "ASSIGNMA   TARGETM    TARGET\n"
+        "ASSIGNMA      LEAD       AIR\n"
+        "START        1000.0\n"
+        "STOP\n");
+    ASSERT_TRUE(parsed.errors.empty()) << parsed.errors.front().message;
+    const FlukaModel model = compileFluka(parsed.ast);
+    ASSERT_TRUE(model.errors.empty()) << model.errors.front().message;
+
+    const FlukaConversion plain = convertFluka(model);
+    ASSERT_EQ(plain.deck.cells.size(), 4u);
+    EXPECT_EQ(plain.deck.cells[0].importance, 0.0);
+    EXPECT_EQ(plain.deck.cells[1].material, 0);
+    EXPECT_DOUBLE_EQ(plain.deck.cells[2].density, -2.5);
+    EXPECT_EQ(plain.fluka.materialNames.count(plain.deck.cells[2].material), 0u);
+    EXPECT_EQ(plain.fluka.materialNames.at(plain.deck.cells[3].material), "LEAD");
+
+    std::ostringstream mcnp;
+    writeDeck(mcnp, plain.deck);
+    const ParseResult mcnpParsed = MCNPParser().parse(mcnp.str());
+    ASSERT_TRUE(mcnpParsed.errors.empty()) << mcnp.str();
+    const SurfaceCompileResult surfaces = compileSurfaces(mcnpParsed.ast);
+    const CellCompileResult cells = compileCells(mcnpParsed.ast);
+    ASSERT_TRUE(surfaces.errors.empty()) << mcnp.str();
+    ASSERT_TRUE(cells.errors.empty()) << mcnp.str();
+    EXPECT_NE(mcnp.str().find("c m26 TARGETM"), std::string::npos) << mcnp.str();
+
+    const FlukaConversion full = convertFluka(model, &parsed.ast);
+    EXPECT_EQ(full.fluka.materialNames.at(full.deck.cells[2].material), "TARGETM");
+    std::ostringstream out;
+    writeFluka(out, full.deck, full.fluka);
+    const std::string text = out.str();
+    EXPECT_NE(text.find("\nBEAM"), std::string::npos) << text;
+    EXPECT_NE(text.find("TARGETM"), std::string::npos) << text;
+    EXPECT_EQ(text.find("MAT26"), std::string::npos) << text;
+    EXPECT_LT(text.find("ASSIGNMA"), text.find("\nSTART"));
+    const ParseResult flukaParsed = FlukaParser().parse(text);
+    ASSERT_TRUE(flukaParsed.errors.empty()) << flukaParsed.errors.front().message << "\n" << text;
+    const FlukaModel written = compileFluka(flukaParsed.ast);
+    ASSERT_TRUE(written.errors.empty()) << written.errors.front().message << "\n" << text;
+    ASSERT_EQ(written.regions.size(), 4u);
+    EXPECT_EQ(written.regions[2].material, written.findMaterial("TARGETM"));
+    EXPECT_EQ(written.regions[0].material, kFlukaBlackhole);
+
+    auto fluka_contains = [&](std::size_t c, const glm::dvec3& p) {
+        return model.dag.contains(model.regions[c].region, p, model.surfaces);
+    };
+    auto mcnp_contains = [&](std::size_t c, const glm::dvec3& p) {
+        const CompiledCell* cell = cells.find(static_cast<int>(c) + 1);
+        return cell && cells.dag.contains(cell->region, p, surfaces.table);
+    };
+    auto rewritten_contains = [&](std::size_t c, const glm::dvec3& p) {
+        const int region = written.findRegion("R" + std::to_string(c + 1));
+        return region != 0 && written.dag.contains(written.regions[region - 1].region, p, written.surfaces);
+    };
+    const glm::dvec3 origin(-47.3, -46.1, -45.7);
+    EXPECT_GT(compare_cells(4, fluka_contains, mcnp_contains, origin, 4.9), 0);
+    EXPECT_GT(compare_cells(4, fluka_contains, rewritten_contains, origin, 4.9), 0);
+}
+
+// XML 拉取读取与流式写出
+TEST(XmlStreamTest, ReadsEventsAndWritesNestedElements) {
+    using namespace mcnp::parser;
+    XmlReader reader("<?xml version=\"1.0\"?>\n<!-- c -->\n<a x=\"1 &lt; 2\" y='q'>\n"
+                     "  <b/><![CDATA[<skip>]]>\n  <c z=\"&#65;\"></c>\n</a>\n");
+    ASSERT_EQ(reader.next(), XmlReader::Event::Start);
+    EXPECT_EQ(reader.name(), "a");
+    EXPECT_EQ(reader.depth(), 1u);
+    EXPECT_EQ(reader.attribute("x"), "1 < 2");
+    EXPECT_EQ(reader.attribute("y"), "q");
+    EXPECT_FALSE(reader.hasAttribute("z"));
+    ASSERT_EQ(reader.next(), XmlReader::Event::Start);
+    EXPECT_EQ(reader.name(), "b");
+    EXPECT_EQ(reader.depth(), 2u);
+    ASSERT_EQ(reader.next(), XmlReader::Event::End);
+    EXPECT_EQ(reader.depth(), 1u);
+    ASSERT_EQ(reader.next(), XmlReader::Event::Start);
+    EXPECT_EQ(reader.attribute("z"), "A");
+    EXPECT_EQ(reader.line(), 5u);
+    ASSERT_EQ(reader.next(), XmlReader::Event::End);
+    ASSERT_EQ(reader.next(), XmlReader::Event::End);
+    EXPECT_EQ(reader.name(), "a");
+    EXPECT_EQ(reader.next(), XmlReader::Event::Eof);
+
+    XmlReader broken("<a><b></a>");
+    while (broken.next() == XmlReader::Event::Start) {
+    }
+    EXPECT_FALSE(broken.error().empty());
+
+    std::ostringstream out;
+    {
+        XmlWriter writer(out, 8);
+        writer.start("root");
+        writer.attribute("name", "a\"b");
+        writer.start("empty");
+        writer.attribute("v", 0.25);
+        writer.end();
+        writer.start("list");
+        const int values[] = {1, 2, 3};
+        writer.numbers(values);
+        writer.end();
+        writer.end();
+    }
+    EXPECT_EQ(out.str(), "<root name=\"a&quot;b\">\n  <empty v=\"0.25\"/>\n  <list>1 2 3</list>\n</root>");
+}
+
+namespace {
+
+// 世界体中两次放置同一个燃料棒（其一旋转）、一个布尔实体、一个多锥、一个镶嵌四面体、
+// 沿 x 的复制体与一个组件
+const char* kGdmlDocument = R"(<?xml version="1.0" encoding="UTF-8"?>
+<gdml xmlns:xsi="http://www.w3.org/2001/XMLSchema-instance" xsi:noNamespaceSchemaLocation="gdml.xsd">
+  <define>
+    <constant name="HALF" value="50"/>
+    <quantity name="rpin" value="0.5" unit="cm"/>
+    <position name="shift" x="HALF" unit="mm"/>
+    <rotation name="tilt" x="90" unit="deg"/>
+    <position name="t0" x="0" y="0" z="0" unit="cm"/>
+    <position name="t1" x="4" y="0" z="0" unit="cm"/>
+    <position name="t2" x="0" y="4" z="0" unit="cm"/>
+    <position name="t3" x="0" y="0" z="4" unit="cm"/>
+  </define>
+  <materials>
+    <element name="N" formula="N" Z="7"><atom value="14.01"/></element>
+    <material name="Air" state="gas"><D value="0.0012" unit="g/cm3"/><fraction n="1" ref="N"/></material>
+    <material name="Fuel"><D value="10.4"/><fraction n="1" ref="N"/></material>
+    <material name="Steel"><D value="7900" unit="kg/m3"/><fraction n="1" ref="N"/></material>
+  </materials>
+  <solids>
+    <box name="WorldBox" x="2*HALF*10" y="1000" z="1000"/>
+    <tube name="PinTube" rmax="rpin" z="40" deltaphi="360" aunit="deg"/>
+    <box name="Cube" x="10" y="10" z="10" lunit="cm"/>
+    <orb name="Hole" r="2" lunit="cm"/>
+    <subtraction name="Block">
+      <first ref="Cube"/><second ref="Hole"/>
+      <position name="holeAt" x="3" unit="cm"/>
+    </subtraction>
+    <polycone name="Cone" startphi="0" deltaphi="2*pi" lunit="cm">
+      <zplane rmin="0" rmax="1" z="-1"/>
+      <zplane rmin="0" rmax="2" z="1"/>
+    </polycone>
+    <tessellated name="Tet">
+      <triangular vertex1="t0" vertex2="t2" vertex3="t1"/>
+      <triangular vertex1="t0" vertex2="t1" vertex3="t3"/>
+      <triangular vertex1="t0" vertex2="t3" vertex3="t2"/>
+      <triangular vertex1="t1" vertex2="t2" vertex3="t3"/>
+    </tessellated>
+    <box name="RowBox" x="10" y="2" z="2" lunit="cm"/>
+    <box name="CellBox" x="2" y="2" z="2" lunit="cm"/>
+    <orb name="Dot" r="0.3" lunit="cm"/>
+  </solids>
+  <structure>
+    <volume name="Pin"><materialref ref="Fuel"/><solidref ref="PinTube"/></volume>
+    <volume name="Blocky"><materialref ref="Steel"/><solidref ref="Block"/></volume>
+    <volume name="Cone"><materialref ref="Steel"/><solidref ref="Cone"/></volume>
+    <volume name="Tet"><materialref ref="Steel"/><solidref ref="Tet"/></volume>
+    <volume name="DotVol"><materialref ref="Fuel"/><solidref ref="Dot"/></volume>
+    <volume name="Cell">
+      <materialref ref="Air"/><solidref ref="CellBox"/>
+      <physvol><volumeref ref="DotVol"/></physvol>
+    </volume>
+    <volume name="Row">
+      <materialref ref="Air"/><solidref ref="RowBox"/>
+      <replicavol number="5">
+        <volumeref ref="Cell"/>
+        <replicate_along_axis><direction x="1"/><width value="20" unit="mm"/><offset value="0"/></replicate_along_axis>
+      </replicavol>
+    </volume>
+    <assembly name="Pair">
+      <physvol><volumeref ref="Pin"/><position name="left" x="-2" unit="cm"/></physvol>
+      <physvol><volumeref ref="Pin"/><position name="right" x="2" unit="cm"/></physvol>
+    </assembly>
+    <volume name="World">
+      <materialref ref="Air"/><solidref ref="WorldBox"/>
+      <physvol name="pin1" copynumber="1"><volumeref ref="Pin"/><positionref ref="shift"/></physvol>
+      <physvol name="pin2" copynumber="2">
+        <volumeref ref="Pin"/><position name="p2" x="-5" unit="cm"/><rotationref ref="tilt"/>
+      </physvol>
+      <physvol><volumeref ref="Blocky"/><position name="p3" y="20" unit="cm"/></physvol>
+      <physvol><volumeref ref="Cone"/><position name="p4" y="-20" unit="cm"/></physvol>
+      <physvol><volumeref ref="Tet"/><position name="p5" x="20" y="20" unit="cm"/></physvol>
+      <physvol><volumeref ref="Row"/><position name="p6" z="20" unit="cm"/></physvol>
+      <physvol><volumeref ref="Pair"/><position name="p7" z="-20" unit="cm"/></physvol>
+    </volume>
+  </structure>
+  <setup name="Default" version="1.0"><world ref="World"/></setup>
+</gdml>
+)";
+
+// 世界坐标点与期望的材料号（GDML 材料下标 + 1：Air 1、Fuel 2、Steel 3）
+const std::pair<glm::dvec3, int> kGdmlProbes[] = {
+    {{0, 0, 0}, 1},       {{5, 0, 1.5}, 2},     {{-5, 0, 1.5}, 1},     {{-5, 1.5, 0}, 2},   {{0, 20, 0}, 3},
+    {{3, 20, 0}, 1},      {{0, -20, 0.9}, 3},   {{1.8, -20, -0.9}, 1}, {{1.8, -20, 0.9}, 3}, {{20.5, 20.5, 0.5}, 3},
+    {{23, 23, 0}, 1},     {{4, 0, 20}, 2},      {{3, 0, 20}, 1},       {{-4.2, 0, 20}, 2},  {{6, 0, 20}, 1},
+    {{2, 0, -20}, 2},     {{-2, 0.4, -20}, 2},  {{0, 0, -20}, 1},
+};
+
+} // namespace
+
+// 流式读取 GDML：表达式与单位、布尔与镶嵌实体、重复放置的逻辑体、复制体与组件
+TEST(GdmlReaderTest, ReadsSolidsAndStructure) {
+    using namespace mcnp::parser;
+    const GdmlModel model = readGdml(kGdmlDocument);
+    for (const ParseError& error : model.errors) {
+        ADD_FAILURE() << error.line << ": " << error.message;
+    }
+    ASSERT_EQ(model.world, model.findVolume("World"));
+    EXPECT_EQ(model.volumes.size(), 9u);
+    EXPECT_EQ(model.vertices.size(), 4u);
+    EXPECT_EQ(model.triangles.size(), 4u);
+    EXPECT_NEAR(model.materials[static_cast<std::size_t>(model.findMaterial("Steel"))].density, 7.9, 1e-12);
+    EXPECT_NE(model.materialsXml.find("<element name=\"N\""), std::string::npos);
+
+    const GdmlSolid& tube = model.solids[static_cast<std::size_t>(model.findSolid("PinTube"))];
+    EXPECT_NEAR(tube.parameters[1], 0.5, 1e-12);
+    EXPECT_NEAR(tube.parameters[2], 4.0, 1e-12);
+    EXPECT_NEAR(tube.parameters[4], 2.0 * glm::pi<double>(), 1e-12);
+    const GdmlVolume& world = model.volumes[static_cast<std::size_t>(model.world)];
+    EXPECT_NEAR(world.daughters[0].transform.position.x, 5.0, 1e-12);
+    EXPECT_NEAR(world.daughters[1].transform.rotation.x, 0.5 * glm::pi<double>(), 1e-12);
+    const int block = model.findSolid("Block");
+    EXPECT_TRUE(model.contains(block, glm::dvec3(-3, 0, 0)));
+    EXPECT_FALSE(model.contains(block, glm::dvec3(3, 0, 0)));
+    EXPECT_TRUE(model.contains(model.findSolid("Tet"), glm::dvec3(0.5, 0.5, 0.5)));
+    EXPECT_FALSE(model.contains(model.findSolid("Tet"), glm::dvec3(2, 2, 2)));
+
+    mcnp::core::UniverseResolver resolver;
+    model.buildUniverses(resolver);
+    std::vector<std::string> errors;
+    ASSERT_TRUE(resolver.build(&errors)) << (errors.empty() ? "" : errors.front());
+    for (const auto& [point, material] : kGdmlProbes) {
+        const mcnp::core::CellHit hit = resolver.classify(point);
+        EXPECT_TRUE(hit.found) << point.x << " " << point.y << " " << point.z;
+        EXPECT_EQ(hit.material, material) << point.x << " " << point.y << " " << point.z;
+    }
+    const mcnp::core::PointLocation row = resolver.locate(glm::dvec3(4, 0, 20));
+    ASSERT_EQ(row.path.size(), 4u);  // World → Row 栅格 → Cell → DotVol
+    EXPECT_TRUE(row.path[1].inLattice);
+    EXPECT_EQ(row.path[1].latticeIndex.x, 4);
+
+    const GdmlModel broken = readGdml("<gdml><solids><box name=\"b\" x=\"1+\"/><paraboloid name=\"p\"/></solids>"
+                                      "<structure><volume name=\"v\"><solidref ref=\"missing\"/></volume>"
+                                      "</structure></gdml>");
+    EXPECT_GE(broken.errors.size(), 4u);
+}
+
+// 写出后再读回：几何与材料判定不变，materials 原样保留
+TEST(GdmlWriterTest, RoundTripsModel) {
+    using namespace mcnp::parser;
+    const GdmlModel model = readGdml(kGdmlDocument);
+    ASSERT_TRUE(model.errors.empty());
+    std::ostringstream out;
+    const GdmlWriteStats stats = writeGdml(out, model);
+    const std::string text = out.str();
+    EXPECT_EQ(stats.bytes, text.size());
+    EXPECT_EQ(stats.solids, model.solids.size());
+    EXPECT_EQ(stats.volumes, model.volumes.size());
+    EXPECT_EQ(stats.placements, 11u);
+    EXPECT_EQ(std::find_if(stats.warnings.begin(), stats.warnings.end(),
+                           [](const std::string& w) { return w.find("lattice") != std::string::npos; }),
+              stats.warnings.end());
+    EXPECT_NE(text.find("<fraction n=\"1\" ref=\"N\"/>"), std::string::npos);
+    EXPECT_NE(text.find("<replicavol number=\"5\">"), std::string::npos);
+    EXPECT_NE(text.find("<triangular vertex1=\"v0\" vertex2=\"v1\" vertex3=\"v2\"/>"), std::string::npos);
+
+    const GdmlModel reread = readGdml(text);
+    for (const ParseError& error : reread.errors) {
+        ADD_FAILURE() << error.line << ": " << error.message;
+    }
+    mcnp::core::UniverseResolver resolver;
+    reread.buildUniverses(resolver);
+    ASSERT_TRUE(resolver.build());
+    for (const auto& [point, material] : kGdmlProbes) {
+        EXPECT_EQ(resolver.classify(point).material, material) << point.x << " " << point.y << " " << point.z;
+    }
+
+    // 不保留原文时只写密度
+    GdmlWriterOptions options;
+    options.keepMaterials = false;
+    std::ostringstream bare;
+    writeGdml(bare, model, options);
+    const GdmlModel densities = readGdml(bare.str());
+    EXPECT_TRUE(densities.errors.empty());
+    ASSERT_EQ(densities.materials.size(), 3u);
+    EXPECT_NEAR(densities.materials[2].density, 7.9, 1e-12);
+}
+
+namespace {
+
+// 读回 geometry.xml：曲面按对应的 MCNP 助记符登记，单元区域按 OpenMC 的语法（空格为交、| 为并、~ 为补）求值
+struct OpenMcGeometry {
+    mcnp::core::SurfaceTable surfaces;
+    std::unordered_map<int, std::string> regions;
+    std::unordered_map<int, std::string> cells;  // 单元的全部属性，按 name=value 拼接
+
+    explicit OpenMcGeometry(std::string_view xml) {
+        using mcnp::parser::XmlReader;
+        static const std::unordered_map<std::string_view, std::string_view> kMnemonics = {
+            {"x-plane", "px"},    {"y-plane", "py"},    {"z-plane", "pz"},    {"plane", "p"},
+            {"sphere", "s"},      {"x-cylinder", "c/x"}, {"y-cylinder", "c/y"}, {"z-cylinder", "c/z"},
+            {"x-cone", "k/x"},    {"y-cone", "k/y"},    {"z-cone", "k/z"},    {"x-torus", "tx"},
+            {"y-torus", "ty"},    {"z-torus", "tz"},    {"quadric", "gq"}};
+        XmlReader reader(xml);
+        for (auto event = reader.next(); event == XmlReader::Event::Start || event == XmlReader::Event::End;
+             event = reader.next()) {
+            if (event != XmlReader::Event::Start) {
+                continue;
+            }
+            const int id = reader.hasAttribute("id") ? std::stoi(std::string(reader.attribute("id"))) : 0;
+            if (reader.name() == "surface") {
+                std::vector<double> coeffs;
+                std::istringstream in{std::string(reader.attribute("coeffs"))};
+                for (double v = 0.0; in >> v;) {
+                    coeffs.push_back(v);
+                }
+                EXPECT_TRUE(surfaces.add(id, kMnemonics.at(reader.attribute("type")), coeffs)) << id;
+            } else if (reader.name() == "cell") {
+                regions[id] = std::string(reader.attribute("region"));
+                std::string& attributes = cells[id];
+                for (const auto& attribute : reader.attributes()) {
+                    attributes += std::string(attribute.name) + "=" + std::string(attribute.value) + " ";
+                }
+            }
+        }
+    }
+
+    bool contains(int cell, const glm::dvec3& p) const {
+        const std::string& text = regions.at(cell);
+        std::size_t pos = 0;
+        auto skip = [&] {
+            while (pos < text.size() && text[pos] == ' ') {
+                ++pos;
+            }
+        };
+        std::function<bool()> expression;
+        std::function<bool()> factor = [&]() -> bool {
+            skip();
+            if (text[pos] == '~') {
+                ++pos;
+                return !factor();
+            }
+            if (text[pos] == '(') {
+                ++pos;
+                const bool value = expression();
+                skip();
+                ++pos;  // ')'
+                return value;
+            }
+            std::size_t used = 0;
+            const int token = std::stoi(text.substr(pos), &used);
+            pos += used;
+            const bool negative = surfaces.evaluate(*surfaces.find(std::abs(token)), p) < 0.0;
+            return negative == (token < 0);
+        };
+        expression = [&]() -> bool {
+            bool any = false;
+            for (;;) {
+                bool all = factor();
+                for (skip(); pos < text.size() && text[pos] != '|' && text[pos] != ')'; skip()) {
+                    all = factor() && all;
+                }
+                any = any || all;
+                if (pos >= text.size() || text[pos] != '|') {
+                    return any;
+                }
+                ++pos;
+            }
+        };
+        return text.empty() || expression();
+    }
+};
+
+} // namespace
+
+// 卡片模型写成 geometry.xml/materials.xml：读回后单元覆盖不变，同一材料的不同密度分成两个材料
+TEST(OpenMcWriterTest, ExportsDeckGeometryAndMaterials) {
+    using namespace mcnp::parser;
+    const ParseResult parsed = MCNPParser().parse(
+        "to openmc\n"
+        "1 1 -7.9 -1 6 imp:n=1\n"
+        "2 0 -1 -2 3 -7 imp:n=1\n"
+        "3 2 0.05 -5 : -8 imp:n=1\n"
+        "4 0 -9 -4 imp:n=1\n"
+        "5 0 -10 imp:n=1\n"
+        "6 2 -1.0 -11 -4 #1 #4 imp:n=1\n"
+        "7 0 4 imp:n=0\n"
+        "8 0 -12 imp:n=1\n"
+        "\n"
+        "1 so 5\n2 pz 0\n3 pz -2\n4 so 20\n5 rpp 6 8 -1 1 -1 1\n6 pz 0\n7 p 0 0 -1 2\n"
+        "8 c/y 10 0 1\n9 1 k/x 0 0 0 0.25\n10 tz 0 0 -15 3 0.5 0.5\n11 cx 12\n*12 1 tz 0 0 0 3 0.5 0.5\n"
+        "\n"
+        "*tr1 0 0 -10 45 90 135 90 0 90 45 90 45\nmode n\n"
+        "m1 26000.80c 1\nm2 1001.80c 2 8016.80c 1 nlib=80c\nmt2 lwtr.20t\n");
+    ASSERT_TRUE(parsed.errors.empty());
+    const SurfaceCompileResult surfaces = compileSurfaces(parsed.ast);
+    CellCompileResult cells = compileCells(parsed.ast);
+    ASSERT_TRUE(surfaces.errors.empty());
+    ASSERT_TRUE(cells.errors.empty());
+
+    DeckModel model = buildDeckModel(parsed.ast, cells, surfaces);
+    model.cells[5].region = cells.dag.intersection(std::vector<mcnp::core::CsgDag::NodeId>{
+        cells.dag.halfspace(11, true), cells.dag.halfspace(4, true)});
+    model.cells[5].excluded = {1, 4};
+    std::ostringstream geometry;
+    std::ostringstream materials;
+    const OpenMcWriteStats stats = writeOpenMc(geometry, materials, model, {}, &parsed.ast);
+    const std::string text = geometry.str();
+    EXPECT_EQ(stats.cells, 6u) << text;
+    EXPECT_EQ(stats.mergedSurfaces, 2u);
+    EXPECT_EQ(stats.bytes, text.size() + materials.str().size());
+    auto warned = [&](std::string_view what) {
+        return std::any_of(stats.warnings.begin(), stats.warnings.end(),
+                           [&](const std::string& w) { return w.find(what) != std::string::npos; });
+    };
+    EXPECT_TRUE(warned("cell 8 uses an oblique torus"));
+    EXPECT_NE(text.find("<surface id=\"4\" type=\"sphere\" coeffs=\"0 0 0 20\" boundary=\"vacuum\"/>"),
+              std::string::npos)
+        << text;
+    EXPECT_NE(text.find("type=\"y-cylinder\" coeffs=\"10 0 1\""), std::string::npos) << text;
+    EXPECT_NE(text.find("<surface id=\"10\" type=\"z-torus\" coeffs=\"0 0 -15 3 0.5 0.5\"/>"), std::string::npos);
+    EXPECT_NE(text.find("<surface id=\"9\" type=\"quadric\""), std::string::npos);
+    EXPECT_NE(text.find("~("), std::string::npos);
+
+    const OpenMcGeometry reread(text);
+    EXPECT_EQ(reread.cells.count(7), 0u);
+    EXPECT_EQ(reread.cells.count(8), 0u);
+    EXPECT_NE(reread.cells.at(2).find("material=void"), std::string::npos);
+    EXPECT_NE(reread.cells.at(3).find("material=2 "), std::string::npos);
+    EXPECT_NE(reread.cells.at(6).find("material=3 "), std::string::npos);
+    const std::vector<int> ids{1, 2, 3, 4, 5, 6};
+    auto mcnp_contains = [&](std::size_t c, const glm::dvec3& p) {
+        const DeckCell& cell = model.cells[static_cast<std::size_t>(ids[c] - 1)];
+        bool inside = cells.dag.contains(cell.region, p, surfaces.table);
+        for (const int excluded : cell.excluded) {
+            inside = inside && !cells.dag.contains(model.cells[excluded - 1].region, p, surfaces.table);
+        }
+        return inside;
+    };
+    auto openmc_contains = [&](std::size_t c, const glm::dvec3& p) { return reread.contains(ids[c], p); };
+    EXPECT_GT(compare_cells(ids.size(), mcnp_contains, openmc_contains, glm::dvec3(-22.37, -21.91, -23.13), 2.3), 0);
+
+    const std::string xml = materials.str();
+    EXPECT_NE(xml.find("<element name=\"Fe\" ao=\"1\"/>"), std::string::npos) << xml;
+    EXPECT_NE(xml.find("<density units=\"atom/b-cm\" value=\"0.05\"/>"), std::string::npos) << xml;
+    EXPECT_NE(xml.find("<material id=\"3\" name=\"m2\">"), std::string::npos) << xml;
+    EXPECT_NE(xml.find("<nuclide name=\"O16\" ao=\"1\"/>"), std::string::npos) << xml;
+    EXPECT_NE(xml.find("<sab name=\"c_H_in_H2O\"/>"), std::string::npos) << xml;
+    EXPECT_EQ(stats.materials, 3u);
+}
+
+// 矩形栅格写成原生 <lattice>（每层从 y 最大的一行起），空元素填充一个真空宇宙；六角栅格写成 <hex_lattice>
+TEST(OpenMcWriterTest, WritesNativeLattices) {
+    using namespace mcnp::parser;
+    mcnp::core::CsgDag dag;
+    mcnp::core::SurfaceTable table;
+    ASSERT_TRUE(table.add(20, "rpp", std::vector<double>{-3, 3, -2, 2, -1, 1}));
+    DeckModel model;
+    model.dag = &dag;
+    model.surfaces = &table;
+    const auto box = dag.halfspace(20, true);
+    model.cells.push_back({20, 0, 0.0, box, {}, 1.0, 0, 5});
+    model.cells.push_back({21, 1, -2.0, mcnp::core::CsgDag::kInvalid, {}, 1.0, 7, 0});
+    model.cells.push_back({22, 0, 0.0, box, {}, 1.0, 5, 0});  // LAT 单元本身
+    model.cells.push_back({23, 0, 0.0, box, {}, 1.0, 0, 6});
+
+    OpenMcWriterOptions options;
+    OpenMcLattice lattice;
+    lattice.id = 5;
+    lattice.spec.pitch = glm::dvec3(2.0, 2.0, 0.0);
+    lattice.spec.lower = glm::ivec3(-1, -1, 0);
+    lattice.spec.upper = glm::ivec3(1, 0, 0);
+    lattice.spec.fill = {7, -1, 7, 7, 7, 7};
+    lattice.outer = 7;
+    options.lattices.push_back(lattice);
+    OpenMcLattice hex;
+    hex.id = 6;
+    hex.spec.type = mcnp::core::LatticeType::Hexagonal;
+    hex.spec.fill = {7};
+    options.lattices.push_back(hex);
+
+    std::ostringstream geometry;
+    std::ostringstream materials;
+    const OpenMcWriteStats stats = writeOpenMc(geometry, materials, model, options);
+    const std::string text = geometry.str();
+    EXPECT_EQ(stats.lattices, 2u);
+    EXPECT_EQ(stats.cells, 3u);
+    EXPECT_NE(text.find("<cell id=\"20\" fill=\"5\" region=\"-21 22 -23 24 -25 26\"/>"), std::string::npos) << text;
+    EXPECT_NE(text.find("<cell id=\"21\" material=\"1\" universe=\"7\"/>"), std::string::npos) << text;
+    EXPECT_EQ(text.find("<cell id=\"22\""), std::string::npos);
+    EXPECT_NE(text.find("<cell id=\"23\" fill=\"6\" region=\"-21 22 -23 24 -25 26\"/>"), std::string::npos) << text;
+    EXPECT_NE(text.find("<lattice id=\"5\">\n"
+                        "    <pitch>2 2</pitch>\n"
+                        "    <dimension>3 2</dimension>\n"
+                        "    <lower_left>-3 -3</lower_left>\n"
+                        "    <outer>7</outer>\n"
+                        "    <universes>\n"
+                        "      7 7 7\n"
+                        "      7 8 7\n"
+                        "    </universes>\n"
+                        "  </lattice>"),
+              std::string::npos)
+        << text;
+    EXPECT_NE(text.find("<cell id=\"24\" material=\"void\" universe=\"8\"/>"), std::string::npos) << text;
+    EXPECT_NE(text.find("<hex_lattice id=\"6\" n_rings=\"1\" n_axial=\"1\" orientation=\"x\">\n"
+                        "    <pitch>1 1</pitch>\n"
+                        "    <center>0 0 0</center>\n"
+                        "    <universes>\n"
+                        "      7\n"
+                        "    </universes>\n"
+                        "  </hex_lattice>"),
+              std::string::npos)
+        << text;
+    EXPECT_EQ(std::find_if(stats.warnings.begin(), stats.warnings.end(),
+                           [](const std::string& w) { return w.find("lattice") != std::string::npos; }),
+              stats.warnings.end());
+    EXPECT_NE(materials.str().find("<density units=\"g/cm3\" value=\"2\"/>"), std::string::npos);
+}
+
+// 卡片中的 LAT/FILL 单元：FILL 数组（含 nR 与元素变换）编译为栅格，矩形与六角栅格都以原生栅格写出
+TEST(OpenMcWriterTest, ExportsLatticesFromDeck) {
+    using namespace mcnp::parser;
+    const ParseResult parsed = MCNPParser().parse(
+        "lattice deck\n"
+        "1 0 -10 fill=5 imp:n=1\n"
+        "2 0 10 11 imp:n=0\n"
+        "3 0 -1 2 -3 4 lat=1 u=5 fill=-1:1 -1:1 0:0 7 2r 8 7 7 0 7 7 imp:n=1\n"
+        "4 1 -10.0 -20 u=7 imp:n=1\n"
+        "5 0 20 u=7 imp:n=1\n"
+        "6 0 -1 u=8 imp:n=1\n"
+        "7 0 -11 fill = 6 imp:n=1\n"
+        "8 0 -41 42 -43 44 -45 46 lat=2 u=6 fill= -1:1 -1:1 0:0 7 7 7 7 8(1) 7 7 7 7 imp:n=1\n"
+        "\n"
+        "1 px 1\n2 px -1\n3 py 1\n4 py -1\n10 so 5\n11 s 20 0 0 5\n20 cz 0.4\n"
+        "41 px 21\n42 px 19\n43 p 0.5 0.8660254037844386 0 13.598076211353316\n"
+        "44 p 0.5 0.8660254037844386 0 11.598076211353316\n45 p -0.5 0.8660254037844386 0 -6.401923788646684\n"
+        "46 p -0.5 0.8660254037844386 0 -8.401923788646684\n"
+        "\n"
+        "tr1 0 0 1\nmode n\nm1 92235.80c 1\n");
+    ASSERT_TRUE(parsed.errors.empty());
+    const SurfaceCompileResult surfaces = compileSurfaces(parsed.ast);
+    CellCompileResult cells = compileCells(parsed.ast);
+    ASSERT_TRUE(cells.errors.empty()) << cells.errors.front().message;
+    EXPECT_EQ(cells.find(1)->fill, 5);
+    EXPECT_EQ(cells.find(7)->fill, 6);
+    EXPECT_EQ(cells.find(3)->fill, 0);
+    EXPECT_EQ(cells.find(3)->lattice, 1);
+    EXPECT_EQ(cells.find(3)->fillLower, glm::ivec3(-1, -1, 0));
+    EXPECT_EQ(cells.find(3)->fillArray, (std::vector<int>{7, 7, 7, 8, 7, 7, 0, 7, 7}));
+    EXPECT_EQ(cells.find(8)->fillArray, (std::vector<int>{7, 7, 7, 7, 8, 7, 7, 7, 7}));
+
+    std::vector<std::string> warnings;
+    const std::vector<CompiledLattice> lattices = compileLattices(cells, surfaces.table, &warnings);
+    EXPECT_TRUE(warnings.empty());
+    ASSERT_EQ(lattices.size(), 2u);
+    EXPECT_EQ(lattices[0].universe, 5);
+    EXPECT_EQ(lattices[0].spec.pitch, glm::dvec3(2.0, 2.0, 0.0));
+    EXPECT_EQ(lattices[0].spec.fill, (std::vector<int>{7, 7, 7, 8, 7, 7, -1, 7, 7}));
+    EXPECT_EQ(lattices[1].spec.type, mcnp::core::LatticeType::Hexagonal);
+    EXPECT_DOUBLE_EQ(lattices[1].spec.pitch.x, 2.0);
+    EXPECT_NEAR(lattices[1].origin.x, 20.0, 1e-9);
+    EXPECT_NEAR(lattices[1].origin.y, 3.0, 1e-6);
+
+    OpenMcWriterOptions options;
+    options.lattices = openMcLattices(lattices);
+    std::ostringstream geometry;
+    std::ostringstream materials;
+    const OpenMcWriteStats stats =
+        writeOpenMc(geometry, materials, buildDeckModel(parsed.ast, cells, surfaces), options, &parsed.ast);
+    const std::string text = geometry.str();
+    EXPECT_EQ(stats.lattices, 2u);
+    EXPECT_NE(text.find("<cell id=\"1\" fill=\"5\""), std::string::npos) << text;
+    EXPECT_NE(text.find("<cell id=\"7\" fill=\"6\""), std::string::npos) << text;
+    EXPECT_EQ(text.find("<cell id=\"3\""), std::string::npos);
+    EXPECT_EQ(text.find("<cell id=\"8\""), std::string::npos);
+    EXPECT_NE(text.find("<lattice id=\"5\">\n"
+                        "    <pitch>2 2</pitch>\n"
+                        "    <dimension>3 3</dimension>\n"
+                        "    <lower_left>-3 -3</lower_left>\n"
+                        "    <universes>\n"
+                        "      9 7 7\n"
+                        "      8 7 7\n"
+                        "      7 7 7\n"
+                        "    </universes>\n"
+                        "  </lattice>"),
+              std::string::npos)
+        << text;
+    // 轴向坐标 (i, j) 的六角距离最大为 2：三个环，行长 3 4 5 4 3，数组外的位置为空宇宙
+    const std::size_t hex = text.find("<hex_lattice id=\"6\" n_rings=\"3\" orientation=\"x\">\n"
+                                      "    <pitch>2</pitch>\n"
+                                      "    <center>20 3</center>\n");
+    ASSERT_NE(hex, std::string::npos) << text;
+    EXPECT_NE(text.find("    <universes>\n"
+                        "        9 9 9\n"
+                        "       9 7 7 7\n"
+                        "      9 7 8 7 9\n"
+                        "       7 7 7 9\n"
+                        "        9 9 9\n"
+                        "    </universes>\n"
+                        "  </hex_lattice>",
+                        hex),
+              std::string::npos)
+        << text;
+}
+
+namespace {
+
+// 诊断压缩成 "规则@行号"，便于整体比较
+std::vector<std::string> rule_lines(const std::vector<mcnp::parser::DeckDiagnostic>& diagnostics) {
+    std::vector<std::string> out;
+    for (const auto& diagnostic : diagnostics) {
+        out.push_back(std::string(diagnostic.rule) + "@" + std::to_string(diagnostic.line));
+    }
+    return out;
+}
+
+} // namespace
+
+// 测试规则检查：未定义引用、重复编号、缺少重要性、FILL 尺寸、列限制、宇宙成环与块分隔
+TEST(DeckCheckerTest, ReportsRuleViolationsWithLines) {
+    using namespace mcnp::parser;
+    const std::string deck = "checker\n"
+                             "1 1 -7.9 -1 imp:n=1\n"
+                             "2 3 -1.0 1 -2 #7 imp:n=1\n"
+                             "2 0 -3 imp:n=1\n"
+                             "4 0 -2 5\n"
+                             "5 0 -5 lat=1 u=7 fill=0:1 0:1 0:0 7 7 imp:n=1\n"
+                             "6 0 -5 fill=9 imp:n=1\n"
+                             "7 like 1 but u=7\n"
+                             "\n"
+                             "1 so 1\n"
+                             "2 so 2\n"
+                             "3 4 so 3\n"
+                             "2 so 2.5\n"
+                             "5 px 0" +
+                             std::string(130, ' ') + "1\n"
+                             "\n"
+                             "m1 26000 1\n";
+    DeckChecker checker;
+    const auto& diagnostics = checker.check(MCNPParser().parse(deck).ast);
+    EXPECT_EQ(rule_lines(diagnostics),
+              (std::vector<std::string>{"undefined-material@3", "duplicate-cell@4", "missing-importance@5",
+                                        "fill-size@6", "undefined-universe@7", "undefined-transform@12",
+                                        "duplicate-surface@13", "column-limit@14"}));
+    EXPECT_EQ(diagnostics[1].message, "cell 2 is already defined on line 3");
+    EXPECT_EQ(diagnostics[7].column, 129u);
+    EXPECT_EQ(diagnostics[7].severity, DiagnosticSeverity::Warning);
+    EXPECT_EQ(checker.extractedCards(), 14u);
+
+    const std::string cycle = "cycle\n"
+                              "1 0 -1 fill=1\n"
+                              "2 0 -1 u=1 fill=2\n"
+                              "3 0 -1 u=2 fill=1\n"
+                              "\n"
+                              "1 so 1\n"
+                              "mode n\n"
+                              "\n"
+                              "imp:n 1 2r\n";
+    checker.check(MCNPParser().parse(cycle).ast);
+    EXPECT_EQ(rule_lines(checker.diagnostics()),
+              (std::vector<std::string>{"universe-cycle@4", "missing-delimiter@7"}));
+    EXPECT_EQ(checker.diagnostics()[0].message, "universe cycle: 1 -> 2 -> 1");
+}
+
+// 测试增量检查：编辑后只重新提取窗口内的卡片，结果与全量检查一致
+TEST(DeckCheckerTest, IncrementalUpdateMatchesFullCheck) {
+    using namespace mcnp::parser;
+    IncrementalDeck deck;
+    DeckChecker checker;
+    EXPECT_TRUE(checker.apply(deck.ast(), deck.load(kIncrementalDeck)).empty());
+
+    const std::size_t at = deck.text().find("11 0 -4 2");
+    DeckUpdate update = deck.applyEdit({at + 6, 1, "8"});
+    ASSERT_FALSE(update.fullReparse);
+    checker.apply(deck.ast(), update);
+    EXPECT_LE(checker.extractedCards(), 3u);
+    EXPECT_EQ(rule_lines(checker.diagnostics()), (std::vector<std::string>{"undefined-surface@7"}));
+
+    // 插入一张没有重要性的单元卡片，其后的卡片行号随之平移
+    update = deck.applyEdit({deck.text().find("10 0 -9"), 0, "5 0 -3 -4\n"});
+    ASSERT_FALSE(update.fullReparse);
+    checker.apply(deck.ast(), update);
+    EXPECT_LE(checker.extractedCards(), 4u);
+    EXPECT_EQ(rule_lines(checker.diagnostics()),
+              (std::vector<std::string>{"missing-importance@6", "undefined-surface@8"}));
+
+    DeckChecker full;
+    EXPECT_EQ(rule_lines(full.check(deck.ast())), rule_lines(checker.diagnostics()));
+}
+
+namespace {
+
+const char* kCrossReferenceDeck =
+    "xref\n"
+    "1 1 -7.9 -1 imp:n=1\n"
+    "2 2 -1.0 1 -2 imp:n=1\n"
+    "3 0 #1 -3 u=5 imp:n=1\n"
+    "4 1 -7.9 -4.2 u=5 imp:n=1\n"
+    "10 0 -9 fill=5 (2) imp:n=1\n"
+    "11 like 4 but u=0 mat=2\n"
+    "\n"
+    "1 so 1\n"
+    "2 so 2\n"
+    "3 2 so 3\n"
+    "4 rpp -1 1 -1 1 -1 1\n"
+    "9 so 9\n"
+    "\n"
+    "m1 26000 1\n"
+    "m2 1001 2 8016 1\n"
+    "tr2 0 0 1\n"
+    "f4:n 3 (4 10) t\n";
+
+std::vector<int> to_vector(std::span<const int> values) {
+    return {values.begin(), values.end()};
+}
+
+} // namespace
+
+// 测试交叉引用索引：曲面、材料、#n/LIKE、FILL、U= 与 TR 的反查
+TEST(CrossReferenceTest, AnswersUsageQueries) {
+    using namespace mcnp::parser;
+    ParserOptions options;
+    options.crossReference = true;
+    const ParseResult parsed = MCNPParser(options).parse(kCrossReferenceDeck);
+    const CrossReference& xref = parsed.xref;
+    EXPECT_EQ(to_vector(xref.cellsUsingSurface(1)), (std::vector<int>{1, 2}));
+    EXPECT_EQ(to_vector(xref.cellsUsingSurface(4)), (std::vector<int>{4}));
+    EXPECT_EQ(to_vector(xref.cellsUsingMaterial(1)), (std::vector<int>{1, 4}));
+    EXPECT_EQ(to_vector(xref.cellsUsingMaterial(2)), (std::vector<int>{2, 11}));
+    EXPECT_EQ(to_vector(xref.cellsReferencingCell(1)), (std::vector<int>{3}));
+    EXPECT_EQ(to_vector(xref.cellsReferencingCell(4)), (std::vector<int>{11}));
+    EXPECT_EQ(to_vector(xref.cellsFilledWith(5)), (std::vector<int>{10}));
+    EXPECT_EQ(to_vector(xref.cellsInUniverse(5)), (std::vector<int>{3, 4}));
+    EXPECT_EQ(to_vector(xref.surfacesUsingTransform(2)), (std::vector<int>{3}));
+    EXPECT_TRUE(xref.cellsUsingSurface(7).empty());
+    EXPECT_EQ(xref.definition(XrefKind::Surface, 9), 11u);
+    EXPECT_EQ(xref.definition(XrefKind::Material, 3), CrossReference::npos);
+
+    // 分块并行解析时各块登记的结果合并后与整体扫描一致
+    ParserOptions chunked = options;
+    chunked.parallelThreshold = 0;
+    chunked.chunkBytes = 32;
+    const ParseResult parts = MCNPParser(chunked).parse(kCrossReferenceDeck);
+    const CrossReference scanned = buildCrossReference(parts.ast);
+    ASSERT_EQ(parts.xref.occurrences().size(), scanned.occurrences().size());
+    for (std::size_t i = 0; i < scanned.occurrences().size(); ++i) {
+        const XrefOccurrence& a = parts.xref.occurrences()[i];
+        const XrefOccurrence& b = scanned.occurrences()[i];
+        EXPECT_TRUE(a.card == b.card && a.parameter == b.parameter && a.id == b.id && a.kind == b.kind) << i;
+    }
+    EXPECT_EQ(to_vector(parts.xref.cellsInUniverse(5)), (std::vector<int>{3, 4}));
+    EXPECT_EQ(to_vector(parts.xref.cellsUsingMaterial(2)), (std::vector<int>{2, 11}));
+    EXPECT_EQ(parts.xref.definition(XrefKind::Surface, 9), 11u);
+
+    // 未开启时不建索引
+    EXPECT_TRUE(MCNPParser().parse(kCrossReferenceDeck).xref.occurrences().empty());
+}
+
+// 测试批量重新编号：宇宙 5 中的单元、曲面、材料、TR 与宇宙号一次改写，输出重新解析后引用一致
+TEST(CrossReferenceTest, RenumbersThroughWriter) {
+    using namespace mcnp::parser;
+    ParserOptions options;
+    options.crossReference = true;
+    const MCNPParser parser(options);
+    const ParseResult parsed = parser.parse(kCrossReferenceDeck);
+
+    Renumbering renumbering;
+    int next = 500;
+    for (const int cell : parsed.xref.cellsInUniverse(5)) {
+        renumbering.cells[cell] = next++;
+    }
+    renumbering.cells[1] = 100;
+    renumbering.surfaces[4] = 40;
+    renumbering.materials[1] = 7;
+    renumbering.transforms[2] = 12;
+    renumbering.universes[5] = 8;
+    std::ostringstream out;
+    const RenumberStats stats = writeRenumbered(out, parsed.ast, parsed.xref, renumbering);
+    EXPECT_EQ(std::find_if(stats.warnings.begin(), stats.warnings.end(),
+                           [](const std::string& w) { return w.find("lattice") != std::string::npos; }),
+              stats.warnings.end());
+    EXPECT_EQ(stats.cards, 10u);
+
+    const ParseResult renumbered = parser.parse(out.str());
+    ASSERT_TRUE(renumbered.errors.empty()) << out.str();
+    const CrossReference& xref = renumbered.xref;
+    EXPECT_EQ(to_vector(xref.cellsInUniverse(8)), (std::vector<int>{500, 501}));
+    EXPECT_EQ(to_vector(xref.cellsFilledWith(8)), (std::vector<int>{10}));
+    EXPECT_EQ(to_vector(xref.cellsReferencingCell(100)), (std::vector<int>{500}));
+    EXPECT_EQ(to_vector(xref.cellsReferencingCell(501)), (std::vector<int>{11}));
+    EXPECT_EQ(to_vector(xref.cellsUsingSurface(40)), (std::vector<int>{501}));
+    EXPECT_EQ(to_vector(xref.cellsUsingMaterial(7)), (std::vector<int>{100, 501}));
+    EXPECT_EQ(to_vector(xref.surfacesUsingTransform(12)), (std::vector<int>{3}));
+    EXPECT_NE(out.str().find("-40.2"), std::string::npos);
+    EXPECT_NE(out.str().find("fill=8 (12)"), std::string::npos);
+    EXPECT_NE(out.str().find("f4:n 500 (501 10) t"), std::string::npos);
+    EXPECT_EQ(renumbered.ast.cardCount(), parsed.ast.cardCount());
+    DeckChecker checker;
+    EXPECT_TRUE(checker.check(renumbered.ast).empty());
+
+    // 新编号与既有编号冲突时给出警告
+    Renumbering clash;
+    clash.surfaces[1] = 2;
+    EXPECT_EQ(writeRenumbered(out, parsed.ast, parsed.xref, clash).warnings.size(), 1u);
+}
+
+const char* const kDiffBefore =
+    "diff test\n"
+    "1 1 -7.9 -1 imp:n=1\n"
+    "2 0 1 -2 imp:n=1\n"
+    "3 0 2 imp:n=0\n"
+    "4 2 -1.0 -3 imp:n=1\n"
+    "\n"
+    "1 so 5\n"
+    "2 so 10\n"
+    "3 px 4\n"
+    "\n"
+    "m1 26000 1\n"
+    "m2 1001 2 8016 1\n"
+    "mode n\n"
+    "nps 1000\n";
+
+// 重新排序、改写格式后的版本：单元 2 与 M1 修改，单元 4 改号为 40，新增单元 5 与曲面 4，删除 MODE
+const char* const kDiffAfter =
+    "diff test\n"
+    "c reordered\n"
+    "3 0 2 IMP:N = 0\n"
+    "1 1 -7.90 -1 imp:n=1.0\n"
+    "2 0 1 -2 imp:n=1 vol=5\n"
+    "40 2 -1 -3 imp:n=1\n"
+    "5 0 -4 imp:n=1\n"
+    "\n"
+    "2 SO 10\n"
+    "1 so 5\n"
+    "3 px 4\n"
+    "4 py 2\n"
+    "\n"
+    "m2 1001 2\n"
+    "     8016 1\n"
+    "m1 26000 2\n"
+    "nps 1e3\n";
+
+// 测试结构比较：顺序、大小写、空白与数值写法不同的卡片视为相同，报告新增、删除、修改与改号
+TEST(DeckDiffTest, ReportsStructuralChanges) {
+    using namespace mcnp::parser;
+    ParserOptions options;
+    options.crossReference = true;
+    const MCNPParser parser(options);
+    const ParseResult before = parser.parse(kDiffBefore);
+    const ParseResult after = parser.parse(kDiffAfter);
+    ASSERT_TRUE(before.errors.empty());
+    ASSERT_TRUE(after.errors.empty());
+
+    const DeckDiff diff = diffDecks(before.ast, after.ast);
+    std::vector<std::string> summary;
+    for (const DeckDiffEntry& entry : diff.entries) {
+        static const char* const names[] = {"added", "removed", "changed", "renumbered"};
+        summary.push_back(std::string(names[static_cast<int>(entry.change)]) + " " + entry.key);
+    }
+    EXPECT_EQ(summary, (std::vector<std::string>{"changed 2", "renumbered 40", "added 5", "added 4", "changed m1",
+                                                 "removed mode"}));
+    EXPECT_EQ(diff.unchanged, 8u);
+    EXPECT_EQ(diff.entries[1].previousNumber, 4);
+    EXPECT_EQ(diff.entries[1].beforeLine, 5u);
+    EXPECT_EQ(diff.entries[1].afterLine, 6u);
+    EXPECT_EQ(diff.entries[5].after, DeckDiffEntry::npos);
+    EXPECT_EQ(diff.changedCells, (std::vector<int>{2, 5, 40}));
+
+    // 给出交叉引用时，用到新增曲面 4 与修改后 M1 的单元也高亮
+    DiffOptions withXref;
+    withXref.afterXref = &after.xref;
+    EXPECT_EQ(diffDecks(before.ast, after.ast, withXref).changedCells, (std::vector<int>{1, 2, 5, 40}));
+    EXPECT_TRUE(diffDecks(before.ast, before.ast).empty());
+}
+
+// 测试规范化指纹：简写展开、分隔符两侧空白与大小写不影响指纹
+TEST(DeckDiffTest, FingerprintNormalizesShorthand) {
+    using namespace mcnp::parser;
+    const MCNPParser parser;
+    const ParseResult a = parser.parse("t\n1 0 (1 -2):3 imp:n=1\n\n1 so 1\n\nimp:n 1 2r 0\n");
+    const ParseResult b = parser.parse("t\n1 0 ( 1 -2 ) : 3 IMP:N=1\n\n1 SO 1.0\n\nIMP:N 1 1 1 0\n");
+    const ParseResult c = parser.parse("t\n1 0 (1 -2) 3 imp:n=1\n\n1 so 1\n\nimp:n 1 1 0 0\n");
+    ASSERT_EQ(a.ast.cardCount(), b.ast.cardCount());
+    for (std::size_t i = 0; i < a.ast.cardCount(); ++i) {
+        EXPECT_EQ(cardFingerprint(a.ast.card(i)), cardFingerprint(b.ast.card(i))) << a.ast.card(i).raw();
+    }
+    EXPECT_NE(cardFingerprint(a.ast.card(1)), cardFingerprint(c.ast.card(1)));
+    EXPECT_NE(cardFingerprint(a.ast.card(3)), cardFingerprint(c.ast.card(3)));
+}
+
+const char* const kSweepDeck =
+    "sweep test\n"
+    "c fuel pin\n"
+    "1 1 -10.4 -1 imp:n=1   $ fuel\n"
+    "2 2 -1.0 1 -2 imp:n = 1\n"
+    "3 0 2 imp:n=0\n"
+    "\n"
+    "1 cz 0.4\n"
+    "2 rpp -0.63 0.63 -0.63 0.63\n"
+    "      -10 10\n"
+    "\n"
+    "m1 92235 0.03 92238 0.97\n"
+    "m2 1001 2 8016 1\n"
+    "f4:n 1\n"
+    "e4 1 3i 5\n"
+    "mode n\n";
+
+std::vector<mcnp::parser::SweepParameter> pin_sweep() {
+    using namespace mcnp::parser;
+    SweepParameter enrichment{"enrichment", {SweepField::data("M1", 1), SweepField::data("m1", 3)}, {0.03, 0.05}};
+    enrichment.fields[1].scale = -1.0;  // U-238 份额为 1 - e
+    enrichment.fields[1].offset = 1.0;
+    SweepParameter pitch{"pitch", {}, sweepRange(1.26, 1.5, 3)};
+    for (std::size_t i = 1; i <= 4; ++i) {
+        pitch.fields.push_back(SweepField::surface(2, i));
+        pitch.fields.back().scale = i % 2 == 1 ? -0.5 : 0.5;
+    }
+    SweepParameter importance{"imp", {SweepField::cell(2, "IMP:N")}, {1, 2}};
+    return {enrichment, pitch, importance};
+}
+
+// 测试参数扫描：字段按原文位置替换，其余字节（注释、折行）原样保留
+TEST(DeckSweepTest, PatchesBoundFields) {
+    using namespace mcnp::parser;
+    DeckSweep sweep;
+    sweep.loadText(kSweepDeck);
+    ASSERT_TRUE(sweep.bind(pin_sweep())) << sweep.errors().front();
+    EXPECT_EQ(sweep.variantCount(), 12u);
+    EXPECT_EQ(sweep.values(11), (std::vector<double>{0.05, 1.5, 2}));
+    EXPECT_EQ(sweep.values(2), (std::vector<double>{0.03, 1.38, 1}));
+
+    std::ostringstream out;
+    const std::size_t bytes = sweep.writeVariant(out, 11);
+    const std::string text = out.str();
+    EXPECT_EQ(bytes, text.size());
+    EXPECT_NE(text.find("1 1 -10.4 -1 imp:n=1   $ fuel\n"), std::string::npos);
+    EXPECT_NE(text.find("2 2 -1.0 1 -2 imp:n = 2\n"), std::string::npos);
+    EXPECT_NE(text.find("2 rpp -0.75 0.75 -0.75 0.75\n      -10 10\n"), std::string::npos);
+    EXPECT_NE(text.find("m1 92235 0.05 92238 0.95\n"), std::string::npos);
+    const ParseResult parsed = MCNPParser().parse(text);
+    EXPECT_TRUE(parsed.errors.empty());
+    EXPECT_EQ(parsed.ast.cardCount(), MCNPParser().parse(kSweepDeck).ast.cardCount());
+
+    // 取值与原文相同的变体与原文逐字节相同
+    DeckSweep identity;
+    identity.loadText(kSweepDeck);
+    ASSERT_TRUE(identity.bind({{"density", {SweepField::cell(1, 1)}, {-10.4}}}));
+    std::ostringstream same;
+    identity.writeVariant(same, 0);
+    EXPECT_EQ(same.str(), kSweepDeck);
+
+    EXPECT_TRUE(sweep.columnWarnings(128, 10).empty());
+    EXPECT_EQ(sweep.columnWarnings(24, 10).size(), 1u);
+    EXPECT_EQ(sweep.columnWarnings(22, 10).size(), 3u);
+}
+
+// 测试并行写出全部变体与清单
+TEST(DeckSweepTest, WritesAllVariantsWithManifest) {
+    using namespace mcnp::parser;
+    const auto directory = std::filesystem::temp_directory_path() / "mcnp_sweep_test";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    {
+        std::ofstream deck(directory / "pin.i", std::ios::binary);
+        deck << kSweepDeck;
+    }
+    DeckSweep sweep;
+    ASSERT_TRUE(sweep.loadFile(directory / "pin.i"));
+    ASSERT_TRUE(sweep.bind(pin_sweep()));
+    SweepOptions options;
+    options.directory = directory / "variants";
+    const SweepStats stats = sweep.writeAll(options);
+    EXPECT_TRUE(stats.errors.empty());
+    ASSERT_EQ(stats.files.size(), 12u);
+    EXPECT_EQ(stats.files[7].filename(), "pin_07.i");
+
+    std::ifstream file(stats.files[7], std::ios::binary);
+    std::ostringstream content;
+    content << file.rdbuf();
+    std::ostringstream expected;
+    sweep.writeVariant(expected, 7);
+    EXPECT_EQ(content.str(), expected.str());
+
+    std::ifstream manifest(options.directory / "pin_sweep.csv");
+    std::vector<std::string> rows;
+    for (std::string row; std::getline(manifest, row);) {
+        rows.push_back(row);
+    }
+    ASSERT_EQ(rows.size(), 13u);
+    EXPECT_EQ(rows[0], "variant,file,enrichment,pitch,imp");
+    EXPECT_EQ(rows[8], "7,pin_07.i,0.05,1.26,2");
+    std::filesystem::remove_all(directory);
+}
+
+// 测试绑定错误：卡片或字段不存在、字段为简写、同一字段绑定两次
+TEST(DeckSweepTest, ReportsBindingErrors) {
+    using namespace mcnp::parser;
+    DeckSweep sweep;
+    sweep.loadText(kSweepDeck);
+    EXPECT_FALSE(sweep.bind({{"a", {SweepField::cell(9, 1)}, {1}},
+                             {"b", {SweepField::cell(1, "imp:p")}, {1}},
+                             {"c", {SweepField::data("e4", 1)}, {1}}}));
+    EXPECT_EQ(sweep.errors().size(), 3u);
+    EXPECT_EQ(sweep.variantCount(), 0u);
+    EXPECT_FALSE(sweep.bind({{"a", {SweepField::cell(1, 1)}, {1}}, {"b", {SweepField::cell(1, 1)}, {2}}}));
+    EXPECT_EQ(sweep.errors().size(), 1u);
+    EXPECT_FALSE(sweep.loadFile("/nonexistent/deck.i"));
+    EXPECT_FALSE(sweep.bind({{"a", {SweepField::cell(1, 1)}, {1}}}));
+}
+
+const char* const kMctal =
+    "mcnp6     6     01/01/24 12:00:00     2      100000   1234567\n"
+    " sample problem title\n"
+    "ntal     2\n"
+    "    4   14\n"
+    "tally    4   -1    0\n"
+    "  1  0\n"
+    "     flux in cells\n"
+    "f        2\n"
+    "       10       20\n"
+    "d        1\n"
+    "u        1\n"
+    "s        1\n"
+    "m        1\n"
+    "c        1\n"
+    "et       3\n"
+    "  1.0000E+00  2.0000E+01\n"
+    "t        1\n"
+    "vals\n"
+    "  1.00000E-01 0.1000  2.00000E-01 0.2000  3.00000E-01 0.3000  4.00000E-01 0.0500\n"
+    "  5.00000E-01 0.0100  6.00000-100 0.0200\n"
+    "tfc    2   1   1   1   1   1   1   3   1\n"
+    "     50000  5.00000E-01  1.00000E-01  1.00000E+02\n"
+    "    100000  6.00000E-01  5.00000E-02  1.00000E+02\n"
+    "tally   14    1    0\n"
+    "f        1\n"
+    "        1\n"
+    "d        1\n"
+    "u        1\n"
+    "s        1\n"
+    "m        1\n"
+    "c        1\n"
+    "e        1\n"
+    "t        1\n"
+    "vals\n"
+    " 7.0E+00 0.003\n"
+    "tfc    1   1   1   1   1   1   1   1   1\n"
+    "    100000  7.00000E+00  3.00000E-03  4.00000E+04\n"
+    "kcode    10    2    5\n";
+
+std::filesystem::path write_temp(const std::string& name, const std::string& content) {
+    const auto path = std::filesystem::temp_directory_path() / name;
+    std::ofstream file(path, std::ios::binary);
+    file << content;
+    return path;
+}
+
+// 测试 MCTAL 索引与按需解码：头部、维度、数值区（含三位指数）、tfc 与不按固定格式排列的数值
+TEST(MctalReaderTest, IndexesAndDecodesTallies) {
+    using namespace mcnp::parser;
+    const auto path = write_temp("mcnp_test.m", kMctal);
+    MctalFile mctal;
+    ASSERT_TRUE(mctal.open(path)) << mctal.error();
+    EXPECT_EQ(mctal.header().code, "mcnp6");
+    EXPECT_EQ(mctal.header().problemId, "01/01/24 12:00:00");
+    EXPECT_EQ(mctal.header().nps, 100000);
+    EXPECT_EQ(mctal.header().title, "sample problem title");
+    EXPECT_EQ(mctal.header().tallyNumbers, (std::vector<int>{4, 14}));
+    ASSERT_EQ(mctal.tallies().size(), 2u);
+    EXPECT_TRUE(mctal.hasKcode());
+    EXPECT_EQ(mctal.residentTallies(), 0u);
+
+    const MctalTallyHeader& f4 = mctal.tallies()[0];
+    EXPECT_EQ(f4.particle, -1);
+    EXPECT_EQ(f4.comment, "flux in cells");
+    EXPECT_EQ(f4.axis(TallyAxis::Entity).count, 2u);
+    EXPECT_EQ(f4.axis(TallyAxis::Energy).count, 3u);
+    EXPECT_EQ(f4.axis(TallyAxis::Energy).flag, 't');
+    EXPECT_EQ(f4.valueCount, 6u);
+    EXPECT_EQ(mctal.find(14), 1u);
+    EXPECT_EQ(mctal.find(24), MctalFile::npos);
+
+    {
+        const auto tally = mctal.load(0);
+        ASSERT_TRUE(tally->error.empty()) << tally->error;
+        EXPECT_EQ(tally->bins[0], (std::vector<double>{10, 20}));
+        EXPECT_EQ(tally->bins[6], (std::vector<double>{1.0, 20.0}));
+        EXPECT_DOUBLE_EQ(tally->values[tally->index({1, 0, 0, 0, 0, 0, 1, 0})], 0.5);
+        EXPECT_NEAR(tally->values[5], 6e-100, 1e-110);
+        EXPECT_FLOAT_EQ(tally->errors[3], 0.05f);
+        ASSERT_EQ(tally->fluctuation.size(), 2u);
+        EXPECT_EQ(tally->fluctuation[1].nps, 100000);
+        EXPECT_EQ(mctal.residentTallies(), 1u);
+        EXPECT_EQ(mctal.load(0), tally);  // 持有期间复用同一份
+    }
+    EXPECT_EQ(mctal.residentTallies(), 0u);  // 不再持有即释放
+
+    const auto f14 = mctal.request(1).get();
+    ASSERT_TRUE(f14->error.empty()) << f14->error;
+    EXPECT_DOUBLE_EQ(f14->values[0], 7.0);
+    EXPECT_FLOAT_EQ(f14->errors[0], 0.003f);
+    EXPECT_EQ(mctal.request(1).get(), f14);
+
+    // 数值个数与维度不符
+    std::string broken = kMctal;
+    broken.replace(broken.find(" 7.0E+00 0.003"), 14, " 7.0E+00 0.003 1.0");
+    MctalFile bad;
+    ASSERT_TRUE(bad.open(write_temp("mcnp_test_bad.m", broken)));
+    EXPECT_FALSE(bad.load(1)->error.empty());
+    EXPECT_FALSE(bad.open(write_temp("mcnp_test_empty.m", "")));
+    std::filesystem::remove(path);
+}
+
+// 按 MCNP 列格式输出的行：能量最慢、z（或 theta）最快
+std::string meshtal_rows(const std::vector<std::string>& energies, const std::array<std::vector<double>, 3>& centers,
+                         bool volume) {
+    std::string rows;
+    char line[160];
+    int n = 0;
+    for (const std::string& energy : energies) {
+        for (const double a : centers[0]) {
+            for (const double b : centers[1]) {
+                for (const double c : centers[2]) {
+                    ++n;
+                    std::snprintf(line, sizeof(line), "%s %11.3E %11.3E %11.3E %12.5E %12.5E", energy.c_str(), a, b,
+                                  c, n * 1.5e-3, n / 100.0);
+                    rows += line;
+                    if (volume) {
+                        std::snprintf(line, sizeof(line), " %12.5E %12.5E", 1.0, n * 1.5e-3);
+                        rows += line;
+                    }
+                    rows += '\n';
+                }
+            }
+        }
+    }
+    return rows;
+}
+
+// 测试 meshtal 列格式：直角与柱网格、能量总计档、体积列、矩阵格式报错与行数校验
+TEST(MeshtalReaderTest, StreamsColumnFormatIntoBricks) {
+    using namespace mcnp::parser;
+    std::string text =
+        "mcnp   version 6     ld=05/08/13  probid =  01/01/24 12:00:00\n"
+        " mesh sample\n"
+        "\n"
+        " Number of histories used for normalizing tallies =      100000.00\n"
+        "\n"
+        " Mesh Tally Number        14\n"
+        " neutron   mesh tally.\n"
+        "\n"
+        " Tally bin boundaries:\n"
+        "    X direction:   -3.00   -1.00    1.00\n"
+        "                    3.00\n"
+        "    Y direction:   -1.00    0.00    1.00\n"
+        "    Z direction:    0.00    2.00    4.00\n"
+        "    Energy bin boundaries:  0.00E+00 1.00E+00 2.00E+01\n"
+        "\n"
+        "   Energy         X          Y          Z         Result     Rel Error     Volume    Rslt * Vol\n";
+    text += meshtal_rows({" 1.000E+00", " 2.000E+01", "   Total  "}, {{{-2.0, 0.0, 2.0}, {-0.5, 0.5}, {1.0, 3.0}}},
+                         true);
+    text +=
+        "\n"
+        " Mesh Tally Number        24\n"
+        " photon    mesh tally.\n"
+        "\n"
+        " Tally bin boundaries:\n"
+        "  Cylinder origin at   0.00E+00  0.00E+00  0.00E+00, axis in  0.00E+00  0.00E+00  1.00E+00 direction\n"
+        "    R direction:     0.00    1.00    2.00\n"
+        "    Z direction:     0.00    5.00\n"
+        "    Theta direction (revolutions):  0.000  0.500  1.000\n"
+        "    Energy bin boundaries:  0.00E+00 1.00E+36\n"
+        "\n"
+        "     R          Z         Th        Result     Rel Error\n";
+    text += meshtal_rows({""}, {{{0.5, 1.5}, {2.5}, {0.25, 0.75}}}, false);
+    text +=
+        "\n"
+        " Mesh Tally Number        34\n"
+        " neutron   mesh tally.\n"
+        "\n"
+        " Tally bin boundaries:\n"
+        "    X direction:   0.00  1.00\n"
+        "    Y direction:   0.00  1.00\n"
+        "    Z direction:   0.00  1.00\n"
+        "    Energy bin boundaries:  0.00E+00 1.00E+36\n"
+        "\n"
+        " Energy Bin: 0.00E+00 - 1.00E+36 MeV\n";
+    text +=
+        " Mesh Tally Number        44\n"
+        " neutron   mesh tally.\n"
+        "    X direction:   0.00  1.00  2.00\n"
+        "    Y direction:   0.00  1.00\n"
+        "    Z direction:   0.00  1.00\n"
+        "\n"
+        "       X          Y          Z         Result     Rel Error\n"
+        "  5.000E-01  5.000E-01  5.000E-01  1.00000E+00  1.00000E-01\n";
+    const auto path = write_temp("mcnp_test.msht", text);
+
+    MeshtalFile meshtal;
+    ASSERT_TRUE(meshtal.open(path)) << meshtal.error();
+    EXPECT_EQ(meshtal.header().code, "mcnp");
+    EXPECT_EQ(meshtal.header().version, "6");
+    EXPECT_EQ(meshtal.header().problemId, "01/01/24 12:00:00");
+    EXPECT_EQ(meshtal.header().title, "mesh sample");
+    EXPECT_DOUBLE_EQ(meshtal.header().histories, 100000.0);
+    ASSERT_EQ(meshtal.tallies().size(), 4u);
+
+    const MeshtalTallyHeader& rect = meshtal.tallies()[0];
+    EXPECT_EQ(rect.number, 14);
+    EXPECT_EQ(rect.particle, "neutron");
+    EXPECT_EQ(rect.geometry, MeshGeometry::Rectangular);
+    EXPECT_EQ(rect.bounds[0], (std::vector<double>{-3.0, -1.0, 1.0, 3.0}));
+    EXPECT_EQ(rect.dims(), (std::array<std::size_t, 3>{3, 2, 2}));
+    EXPECT_EQ(rect.channels(), 3u);
+    EXPECT_EQ(rect.columns.size(), 8u);
+    EXPECT_TRUE(rect.error.empty()) << rect.error;
+
+    mcnp::core::VoxelStoreOptions options;
+    options.brickSize = 2;
+    options.errors = mcnp::core::VoxelErrorEncoding::Float32;
+    auto store = meshtal.load(meshtal.find(14), options);
+    ASSERT_TRUE(store) << meshtal.error();
+    EXPECT_EQ(store->channels(), 3u);
+    EXPECT_FLOAT_EQ(store->value(0, 0, 0, 0), 1.5e-3f);
+    EXPECT_FLOAT_EQ(store->value(0, 0, 1, 0), 3.0e-3f);
+    EXPECT_FLOAT_EQ(store->value(2, 1, 1, 0), 12 * 1.5e-3f);
+    EXPECT_FLOAT_EQ(store->error(2, 1, 1, 0), 0.12f);
+    EXPECT_FLOAT_EQ(store->value(0, 0, 0, 1), 13 * 1.5e-3f);
+    EXPECT_FLOAT_EQ(store->value(1, 0, 1, 2), 30 * 1.5e-3f);
+    EXPECT_FLOAT_EQ(store->range(2).second, 36 * 1.5e-3f);
+
+    const MeshtalTallyHeader& cylinder = meshtal.tallies()[1];
+    EXPECT_EQ(cylinder.geometry, MeshGeometry::Cylindrical);
+    EXPECT_EQ(cylinder.particle, "photon");
+    EXPECT_EQ(cylinder.dims(), (std::array<std::size_t, 3>{2, 1, 2}));
+    EXPECT_EQ(cylinder.channels(), 1u);
+    EXPECT_NE(cylinder.cylinder.find("axis in"), std::string::npos);
+    store = meshtal.load(1, options);
+    ASSERT_TRUE(store) << meshtal.error();
+    EXPECT_FLOAT_EQ(store->value(1, 0, 0, 0), 3 * 1.5e-3f);
+    EXPECT_FLOAT_EQ(store->value(1, 0, 1, 0), 4 * 1.5e-3f);
+
+    EXPECT_FALSE(meshtal.load(2));
+    EXPECT_NE(meshtal.error().find("matrix format"), std::string::npos);
+    EXPECT_FALSE(meshtal.load(3));
+    EXPECT_NE(meshtal.error().find("expected 2 rows, found 1"), std::string::npos);
+    EXPECT_EQ(meshtal.find(99), MeshtalFile::npos);
+    std::filesystem::remove(path);
+}